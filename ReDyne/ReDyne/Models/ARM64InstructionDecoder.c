@@ -2,107 +2,58 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <ctype.h>
 
 // MARK: - Bit Manipulation Macros
 
 #define BITS(ins, start, end) (((ins) >> (start)) & ((1U << ((end) - (start) + 1)) - 1))
-#define BIT(ins, pos) (((ins) >> (pos)) & 1)
 
-static inline int64_t sign_extend(uint64_t value, int bits) {
-    if (value & (1ULL << (bits - 1))) {
-        return (int64_t)(value | (~0ULL << bits));
-    }
-    return (int64_t)value;
-}
+// MARK: - Register Helpers
 
-static inline uint64_t replicate(uint64_t value, int from_width, int to_width) {
-    uint64_t result = 0;
-    for (int i = 0; i < to_width; i += from_width) {
-        result |= value << i;
-    }
-    return result;
-}
+#define ARM64DEC_REGISTER_NAMES(p) { \
+    p "0", p "1", p "2", p "3", p "4", p "5", p "6", p "7", p "8", p "9", p "10", \
+    p "11", p "12", p "13", p "14", p "15", p "16", p "17", p "18", p "19", p "20", \
+    p "21", p "22", p "23", p "24", p "25", p "26", p "27", p "28", p "29", p "30", p "31" }
 
-static inline uint64_t ror64(uint64_t value, int shift) {
-    return (value >> shift) | (value << (64 - shift));
-}
+// Static names keep this safe to call from any thread
+static const char *const register_names[][32] = {
+    ARM64DEC_REGISTER_NAMES("w"), ARM64DEC_REGISTER_NAMES("x"),
+    ARM64DEC_REGISTER_NAMES("b"), ARM64DEC_REGISTER_NAMES("h"), ARM64DEC_REGISTER_NAMES("s"),
+    ARM64DEC_REGISTER_NAMES("d"), ARM64DEC_REGISTER_NAMES("q"), ARM64DEC_REGISTER_NAMES("v"),
+};
 
-static bool decode_bitmask_immediate(uint8_t n, uint8_t immr, uint8_t imms, bool is_64, uint64_t *out_value) {
-    if (!out_value) return false;
-    
-    uint8_t len = 0;
-    uint8_t levels;
-    
-    if (n == 1) {
-        len = 6;
-        levels = 0x3F;
-    } else {
-        uint8_t not_imms = (~imms) & 0x3F;
-        if (not_imms == 0) {
-            return false;
-        }
-        
-        int leading_zeros = 0;
-        for (int i = 5; i >= 0; i--) {
-            if (not_imms & (1 << i)) break;
-            leading_zeros++;
-        }
-        
-        len = 5 - leading_zeros;
-        levels = (1 << len) - 1;
-        
-        if (!is_64 && len == 5) {
-            return false;
-        }
-    }
-    
-    uint8_t s = imms & levels;
-    uint8_t r = immr & levels;
-    
-    int esize = 1 << len;
-    int ones = s + 1;
-    uint64_t pattern = (1ULL << ones) - 1;
-    
-    if (r > 0 && r < esize) {
-        uint64_t mask = (1ULL << esize) - 1;
-        pattern = ((pattern >> r) | (pattern << (esize - r))) & mask;
-    }
-    
-    int width = is_64 ? 64 : 32;
-    uint64_t result = replicate(pattern, esize, width);
-    
-    if (!is_64) {
-        result &= 0xFFFFFFFF;
-    }
-    
-    *out_value = result;
-    return true;
-}
-
-// MARK: - Register Helpers
-
-static ARM64Register make_reg(uint8_t num, bool is_64bit) {
+static ARM64Register make_reg(uint8_t num, uint8_t reg_class) {
     ARM64Register reg;
     reg.num = num;
-    reg.is_64bit = is_64bit;
-    reg.is_sp = (num == 31);
-    reg.is_zero = (num == 31);
+    reg.reg_class = reg_class;
+    reg.is_64bit = reg_class == ARM64_REG_X || reg_class == ARM64_REG_SP ||
+                   reg_class == ARM64_REG_D || reg_class == ARM64_REG_Q;
+    reg.is_sp = num == 31 && (reg_class == ARM64_REG_WSP || reg_class == ARM64_REG_SP);
+    reg.is_zero = num == 31 && (reg_class == ARM64_REG_W || reg_class == ARM64_REG_X);
     return reg;
 }
 
 const char* arm64dec_register_name(ARM64Register reg) {
-    static char buf[8];
+    if (reg.num > 31) return "???";
     
     if (reg.num == 31) {
         if (reg.is_sp) {
             return reg.is_64bit ? "sp" : "wsp";
-        } else {
+        } else if (reg.is_zero) {
             return reg.is_64bit ? "xzr" : "wzr";
         }
     }
     
-    snprintf(buf, sizeof(buf), "%c%d", reg.is_64bit ? 'x' : 'w', reg.num);
-    return buf;
+    switch (reg.reg_class) {
+        case ARM64_REG_W:
+        case ARM64_REG_WSP:
+            return register_names[0][reg.num];
+        case ARM64_REG_X:
+        case ARM64_REG_SP:
+            return register_names[1][reg.num];
+        default:
+            return (reg.reg_class <= ARM64_REG_V) ? register_names[reg.reg_class - ARM64_REG_B + 2][reg.num] : "???";
+    }
 }
 
 const char* arm64dec_condition_name(ARM64Condition cond) {
@@ -192,591 +143,198 @@ static ARM64InstructionCategory get_instruction_category(uint32_t ins) {
     switch (op0) {
         case 0b0000 ... 0b0011:
             return ARM64_INS_UNKNOWN;
-            
+        
         case 0b1000:
         case 0b1001:
             return ARM64_INS_DATA_PROCESSING_IMM;
-            
+        
         case 0b1010:
         case 0b1011:
             return ARM64_INS_BRANCH;
-            
+        
         case 0b0100:
         case 0b0110:
         case 0b1100:
         case 0b1110:
             return ARM64_INS_LOAD_STORE;
-            
+        
         case 0b0101:
         case 0b1101:
             return ARM64_INS_DATA_PROCESSING_REG;
-            
+        
         case 0b0111:
         case 0b1111:
             return ARM64_INS_DATA_PROCESSING_SIMD;
-            
+        
         default:
             return ARM64_INS_UNKNOWN;
     }
 }
 
-// MARK: - Branch Instruction Decoding
+// MARK: - Structured Decode Mapping
 
-static bool decode_branch_instruction(uint32_t ins, uint64_t addr, ARM64DecodedInstruction *decoded) {
-    decoded->category = ARM64_INS_BRANCH;
-    
-    if (BITS(ins, 26, 30) == 0b00101) {
-        bool is_link = BIT(ins, 31);
-        decoded->opcode = is_link ? ARM64_OP_BL : ARM64_OP_B;
-        
-        int64_t imm26 = sign_extend(BITS(ins, 0, 25), 26) << 2;
-        
-        decoded->operands[0].type = ARM64_OPERAND_LABEL;
-        decoded->operands[0].imm = addr + imm26;
-        decoded->operand_count = 1;
-        
-        return true;
-    }
-    
-    if (BITS(ins, 24, 30) == 0b0101010 && BIT(ins, 4) == 0) {
-        decoded->opcode = ARM64_OP_B_COND;
-        decoded->condition = (ARM64Condition)BITS(ins, 0, 3);
-        
-        int64_t imm19 = sign_extend(BITS(ins, 5, 23), 19) << 2;
-        
-        decoded->operands[0].type = ARM64_OPERAND_LABEL;
-        decoded->operands[0].imm = addr + imm19;
-        decoded->operand_count = 1;
-        
-        return true;
-    }
-    
-    if (BITS(ins, 25, 30) == 0b011010) {
-        bool is_nz = BIT(ins, 24);
-        bool is_64 = BIT(ins, 31);
-        
-        decoded->opcode = is_nz ? ARM64_OP_CBNZ : ARM64_OP_CBZ;
-        
-        uint8_t rt = BITS(ins, 0, 4);
-        decoded->operands[0].type = ARM64_OPERAND_REG;
-        decoded->operands[0].reg = make_reg(rt, is_64);
-        
-        int64_t imm19 = sign_extend(BITS(ins, 5, 23), 19) << 2;
-        decoded->operands[1].type = ARM64_OPERAND_LABEL;
-        decoded->operands[1].imm = addr + imm19;
-        decoded->operand_count = 2;
-        
-        return true;
-    }
-    
-    if (BITS(ins, 25, 30) == 0b011011) {
-        bool is_nz = BIT(ins, 24);
-        uint8_t b5 = BIT(ins, 31);
-        uint8_t b40 = BITS(ins, 19, 23);
-        uint8_t bit_pos = (b5 << 5) | b40;
-        
-        decoded->opcode = is_nz ? ARM64_OP_TBNZ : ARM64_OP_TBZ;
-        
-        uint8_t rt = BITS(ins, 0, 4);
-        decoded->operands[0].type = ARM64_OPERAND_REG;
-        decoded->operands[0].reg = make_reg(rt, b5);
-        
-        decoded->operands[1].type = ARM64_OPERAND_IMM;
-        decoded->operands[1].imm = bit_pos;
-        
-        int64_t imm14 = sign_extend(BITS(ins, 5, 18), 14) << 2;
-        decoded->operands[2].type = ARM64_OPERAND_LABEL;
-        decoded->operands[2].imm = addr + imm14;
-        decoded->operand_count = 3;
-        
-        return true;
-    }
-    
-    if (BITS(ins, 25, 31) == 0b1101011) {
-        uint8_t opc = BITS(ins, 21, 24);
-        uint8_t rn = BITS(ins, 5, 9);
-        
-        if (opc == 0b0000) {
-            decoded->opcode = ARM64_OP_BR;
-            decoded->operands[0].type = ARM64_OPERAND_REG;
-            decoded->operands[0].reg = make_reg(rn, true);
-            decoded->operand_count = 1;
-            return true;
-        } else if (opc == 0b0001) {
-            decoded->opcode = ARM64_OP_BLR;
-            decoded->operands[0].type = ARM64_OPERAND_REG;
-            decoded->operands[0].reg = make_reg(rn, true);
-            decoded->operand_count = 1;
-            return true;
-        } else if (opc == 0b0010) {
-            decoded->opcode = ARM64_OP_RET;
-            if (rn != 30) {
-                decoded->operands[0].type = ARM64_OPERAND_REG;
-                decoded->operands[0].reg = make_reg(rn, true);
-                decoded->operand_count = 1;
-            } else {
-                decoded->operand_count = 0;
-            }
-            return true;
-        }
-    }
-    
-    if (ins == 0xD503201F) {
-        decoded->opcode = ARM64_OP_NOP;
-        decoded->operand_count = 0;
-        return true;
-    }
-    
-    return false;
-}
-
-// MARK: - Load/Store Instruction Decoding
+// ARM64Opcode of each ARM64Mnemonic; aliases fold into the opcode they stand
+// for and anything unlisted is ARM64_OP_UNKNOWN
+static const uint8_t opcode_by_mnemonic[ARM64_MNEMONIC_COUNT] = {
+    [ARM64_MNEMONIC_B] = ARM64_OP_B,
+    [ARM64_MNEMONIC_BL] = ARM64_OP_BL,
+    [ARM64_MNEMONIC_B_EQ ... ARM64_MNEMONIC_B_NV] = ARM64_OP_B_COND,
+    [ARM64_MNEMONIC_CBZ] = ARM64_OP_CBZ,
+    [ARM64_MNEMONIC_CBNZ] = ARM64_OP_CBNZ,
+    [ARM64_MNEMONIC_TBZ] = ARM64_OP_TBZ,
+    [ARM64_MNEMONIC_TBNZ] = ARM64_OP_TBNZ,
+    [ARM64_MNEMONIC_BR] = ARM64_OP_BR,
+    [ARM64_MNEMONIC_BRAAZ] = ARM64_OP_BR,
+    [ARM64_MNEMONIC_BRABZ] = ARM64_OP_BR,
+    [ARM64_MNEMONIC_BRAA] = ARM64_OP_BR,
+    [ARM64_MNEMONIC_BRAB] = ARM64_OP_BR,
+    [ARM64_MNEMONIC_BLR] = ARM64_OP_BLR,
+    [ARM64_MNEMONIC_BLRAAZ] = ARM64_OP_BLR,
+    [ARM64_MNEMONIC_BLRABZ] = ARM64_OP_BLR,
+    [ARM64_MNEMONIC_BLRAA] = ARM64_OP_BLR,
+    [ARM64_MNEMONIC_BLRAB] = ARM64_OP_BLR,
+    [ARM64_MNEMONIC_RET] = ARM64_OP_RET,
+    [ARM64_MNEMONIC_RETAA] = ARM64_OP_RET,
+    [ARM64_MNEMONIC_RETAB] = ARM64_OP_RET,
+    [ARM64_MNEMONIC_SVC] = ARM64_OP_SVC,
+    [ARM64_MNEMONIC_HVC] = ARM64_OP_HVC,
+    [ARM64_MNEMONIC_SMC] = ARM64_OP_SMC,
+    [ARM64_MNEMONIC_BRK] = ARM64_OP_BRK,
+    [ARM64_MNEMONIC_HLT] = ARM64_OP_HLT,
+    [ARM64_MNEMONIC_NOP] = ARM64_OP_NOP,
+    [ARM64_MNEMONIC_ADR] = ARM64_OP_ADR,
+    [ARM64_MNEMONIC_ADRP] = ARM64_OP_ADRP,
+    [ARM64_MNEMONIC_ADD] = ARM64_OP_ADD,
+    [ARM64_MNEMONIC_ADDS] = ARM64_OP_ADDS,
+    [ARM64_MNEMONIC_SUB] = ARM64_OP_SUB,
+    [ARM64_MNEMONIC_SUBS] = ARM64_OP_SUBS,
+    [ARM64_MNEMONIC_CMN] = ARM64_OP_CMN,
+    [ARM64_MNEMONIC_CMP] = ARM64_OP_CMP,
+    [ARM64_MNEMONIC_MOV] = ARM64_OP_MOV,
+    [ARM64_MNEMONIC_MVN] = ARM64_OP_MVN,
+    [ARM64_MNEMONIC_TST] = ARM64_OP_TST,
+    [ARM64_MNEMONIC_AND] = ARM64_OP_AND,
+    [ARM64_MNEMONIC_ORR] = ARM64_OP_ORR,
+    [ARM64_MNEMONIC_EOR] = ARM64_OP_EOR,
+    [ARM64_MNEMONIC_ANDS] = ARM64_OP_ANDS,
+    [ARM64_MNEMONIC_BIC] = ARM64_OP_BIC,
+    [ARM64_MNEMONIC_EON] = ARM64_OP_EON,
+    [ARM64_MNEMONIC_MOVN] = ARM64_OP_MOVN,
+    [ARM64_MNEMONIC_MOVZ] = ARM64_OP_MOVZ,
+    [ARM64_MNEMONIC_MOVK] = ARM64_OP_MOVK,
+    [ARM64_MNEMONIC_SBFM] = ARM64_OP_SBFM,
+    [ARM64_MNEMONIC_SBFX] = ARM64_OP_SBFM,
+    [ARM64_MNEMONIC_SBFIZ] = ARM64_OP_SBFM,
+    [ARM64_MNEMONIC_BFM] = ARM64_OP_BFM,
+    [ARM64_MNEMONIC_BFI] = ARM64_OP_BFM,
+    [ARM64_MNEMONIC_BFXIL] = ARM64_OP_BFM,
+    [ARM64_MNEMONIC_UBFM] = ARM64_OP_UBFM,
+    [ARM64_MNEMONIC_UBFX] = ARM64_OP_UBFM,
+    [ARM64_MNEMONIC_UBFIZ] = ARM64_OP_UBFM,
+    [ARM64_MNEMONIC_ASR] = ARM64_OP_ASR,
+    [ARM64_MNEMONIC_LSL] = ARM64_OP_LSL,
+    [ARM64_MNEMONIC_LSR] = ARM64_OP_LSR,
+    [ARM64_MNEMONIC_ROR] = ARM64_OP_ROR,
+    [ARM64_MNEMONIC_SXTB] = ARM64_OP_SXT,
+    [ARM64_MNEMONIC_SXTH] = ARM64_OP_SXT,
+    [ARM64_MNEMONIC_SXTW] = ARM64_OP_SXT,
+    [ARM64_MNEMONIC_UXTB] = ARM64_OP_UXT,
+    [ARM64_MNEMONIC_UXTH] = ARM64_OP_UXT,
+    [ARM64_MNEMONIC_EXTR] = ARM64_OP_EXTR,
+    [ARM64_MNEMONIC_UDIV] = ARM64_OP_UDIV,
+    [ARM64_MNEMONIC_SDIV] = ARM64_OP_SDIV,
+    [ARM64_MNEMONIC_MADD] = ARM64_OP_MADD,
+    [ARM64_MNEMONIC_MSUB] = ARM64_OP_MSUB,
+    [ARM64_MNEMONIC_MUL] = ARM64_OP_MUL,
+    [ARM64_MNEMONIC_SMULL] = ARM64_OP_SMULL,
+    [ARM64_MNEMONIC_UMULL] = ARM64_OP_UMULL,
+    [ARM64_MNEMONIC_STRB] = ARM64_OP_STRB,
+    [ARM64_MNEMONIC_LDRB] = ARM64_OP_LDRB,
+    [ARM64_MNEMONIC_LDRSB] = ARM64_OP_LDRSB,
+    [ARM64_MNEMONIC_STRH] = ARM64_OP_STRH,
+    [ARM64_MNEMONIC_LDRH] = ARM64_OP_LDRH,
+    [ARM64_MNEMONIC_LDRSH] = ARM64_OP_LDRSH,
+    [ARM64_MNEMONIC_STR] = ARM64_OP_STR,
+    [ARM64_MNEMONIC_LDR] = ARM64_OP_LDR,
+    [ARM64_MNEMONIC_LDRSW] = ARM64_OP_LDRSW,
+    [ARM64_MNEMONIC_STURB] = ARM64_OP_STUR,
+    [ARM64_MNEMONIC_STURH] = ARM64_OP_STUR,
+    [ARM64_MNEMONIC_STUR] = ARM64_OP_STUR,
+    [ARM64_MNEMONIC_LDURB] = ARM64_OP_LDUR,
+    [ARM64_MNEMONIC_LDURSB] = ARM64_OP_LDUR,
+    [ARM64_MNEMONIC_LDURH] = ARM64_OP_LDUR,
+    [ARM64_MNEMONIC_LDURSH] = ARM64_OP_LDUR,
+    [ARM64_MNEMONIC_LDUR] = ARM64_OP_LDUR,
+    [ARM64_MNEMONIC_LDURSW] = ARM64_OP_LDUR,
+    [ARM64_MNEMONIC_STP] = ARM64_OP_STP,
+    [ARM64_MNEMONIC_STNP] = ARM64_OP_STP,
+    [ARM64_MNEMONIC_LDP] = ARM64_OP_LDP,
+    [ARM64_MNEMONIC_LDPSW] = ARM64_OP_LDP,
+    [ARM64_MNEMONIC_LDNP] = ARM64_OP_LDP,
+};
 
-static bool decode_load_store_instruction(uint32_t ins, uint64_t addr, ARM64DecodedInstruction *decoded) {
-    decoded->category = ARM64_INS_LOAD_STORE;
-    
-    uint8_t op0 = BITS(ins, 28, 31);
-    uint8_t op1 = BIT(ins, 26);
-    uint8_t op2 = BITS(ins, 23, 24);
-    uint8_t op3 = BITS(ins, 16, 21);
-    uint8_t op4 = BITS(ins, 10, 11);
-    
-    if ((op0 & 0b0011) == 0b0011 && op1 == 1 && op2 == 0b01) {
-        uint8_t size = BITS(ins, 30, 31);
-        bool is_load = BIT(ins, 22);
-        
-        uint8_t rt = BITS(ins, 0, 4);
-        uint8_t rn = BITS(ins, 5, 9);
-        uint16_t imm12 = BITS(ins, 10, 21);
-        
-        bool is_64 = (size == 0b11);
-        
-        if (size == 0b00) {
-            decoded->opcode = is_load ? ARM64_OP_LDRB : ARM64_OP_STRB;
-        } else if (size == 0b01) {
-            decoded->opcode = is_load ? ARM64_OP_LDRH : ARM64_OP_STRH;
-        } else if (size == 0b10) {
-            decoded->opcode = is_load ? ARM64_OP_LDR : ARM64_OP_STR;
-            is_64 = false;
-        } else {
-            decoded->opcode = is_load ? ARM64_OP_LDR : ARM64_OP_STR;
-            is_64 = true;
-        }
-        
-        decoded->operands[0].type = ARM64_OPERAND_REG;
-        decoded->operands[0].reg = make_reg(rt, is_64);
-        decoded->operands[1].type = ARM64_OPERAND_MEM;
-        decoded->operands[1].mem.base = make_reg(rn, true);
-        decoded->operands[1].mem.offset_imm = imm12 << size;
-        decoded->operands[1].mem.mode = ARM64_ADDR_OFFSET;
-        
-        decoded->operand_count = 2;
-        return true;
-    }
-    
-    if ((op0 & 0b0011) == 0b0011 && op1 == 1 && op2 == 0b00 && op4 == 0b10) {
-        uint8_t size = BITS(ins, 30, 31);
-        bool is_load = BIT(ins, 22);
-        
-        uint8_t rt = BITS(ins, 0, 4);
-        uint8_t rn = BITS(ins, 5, 9);
-        uint8_t rm = BITS(ins, 16, 20);
-        uint8_t option = BITS(ins, 13, 15);
-        uint8_t s = BIT(ins, 12);
-        
-        bool is_64 = (size == 0b11);
-        
-        if (size == 0b00) {
-            decoded->opcode = is_load ? ARM64_OP_LDRB : ARM64_OP_STRB;
-        } else if (size == 0b01) {
-            decoded->opcode = is_load ? ARM64_OP_LDRH : ARM64_OP_STRH;
-        } else if (size == 0b10) {
-            decoded->opcode = is_load ? ARM64_OP_LDR : ARM64_OP_STR;
-            is_64 = false;
-        } else {
-            decoded->opcode = is_load ? ARM64_OP_LDR : ARM64_OP_STR;
-            is_64 = true;
-        }
-        
-        decoded->operands[0].type = ARM64_OPERAND_REG;
-        decoded->operands[0].reg = make_reg(rt, is_64);
-        decoded->operands[1].type = ARM64_OPERAND_MEM;
-        decoded->operands[1].mem.base = make_reg(rn, true);
-        decoded->operands[1].mem.offset_reg = make_reg(rm, true);
-        decoded->operands[1].mem.mode = ARM64_ADDR_REG_EXTENDED;
-        decoded->operands[1].mem.extend_type = option;
-        decoded->operands[1].mem.shift_amount = s ? size : 0;
-        
-        decoded->operand_count = 2;
-        return true;
-    }
-    
-    if ((op0 & 0b0010) == 0b0010 && op1 == 1) {
-        uint8_t opc = BITS(ins, 30, 31);
-        bool is_load = BIT(ins, 22);
-        
-        uint8_t rt = BITS(ins, 0, 4);
-        uint8_t rn = BITS(ins, 5, 9);
-        uint8_t rt2 = BITS(ins, 10, 14);
-        int8_t imm7 = sign_extend(BITS(ins, 15, 21), 7);
-        
-        bool is_64 = (opc & 0b10);
-        int scale = is_64 ? 3 : 2;
-        
-        decoded->opcode = is_load ? ARM64_OP_LDP : ARM64_OP_STP;
-        
-        decoded->operands[0].type = ARM64_OPERAND_REG;
-        decoded->operands[0].reg = make_reg(rt, is_64);
-        
-        decoded->operands[1].type = ARM64_OPERAND_REG;
-        decoded->operands[1].reg = make_reg(rt2, is_64);
-        
-        decoded->operands[2].type = ARM64_OPERAND_MEM;
-        decoded->operands[2].mem.base = make_reg(rn, true);
-        decoded->operands[2].mem.offset_imm = imm7 << scale;
-        
-        if (op2 == 0b01) {
-            decoded->operands[2].mem.mode = ARM64_ADDR_POST_INDEX;
-        } else if (op2 == 0b11) {
-            decoded->operands[2].mem.mode = ARM64_ADDR_PRE_INDEX;
-        } else {
-            decoded->operands[2].mem.mode = ARM64_ADDR_OFFSET;
-        }
-        
-        decoded->operand_count = 3;
-        return true;
-    }
-    
-    if (BITS(ins, 24, 30) == 0b0011000) {
-        bool is_64 = BIT(ins, 30);
-        uint8_t rt = BITS(ins, 0, 4);
-        int32_t imm19 = sign_extend(BITS(ins, 5, 23), 19) << 2;
-        
-        decoded->opcode = ARM64_OP_LDR;
-        decoded->operands[0].type = ARM64_OPERAND_REG;
-        decoded->operands[0].reg = make_reg(rt, is_64);
-        decoded->operands[1].type = ARM64_OPERAND_MEM;
-        decoded->operands[1].mem.offset_imm = addr + imm19;
-        decoded->operands[1].mem.mode = ARM64_ADDR_LITERAL;
-        decoded->operand_count = 2;
-        return true;
-    }
-    
-    return false;
-}
-
-// MARK: - Data Processing (Immediate) Instruction Decoding
-
-static bool decode_data_processing_imm(uint32_t ins, uint64_t addr, ARM64DecodedInstruction *decoded) {
-    decoded->category = ARM64_INS_DATA_PROCESSING_IMM;
-    
-    bool is_64 = BIT(ins, 31);
-    uint8_t op = BITS(ins, 23, 25);
-    
-    if (op == 0b000) {
-        bool is_adrp = BIT(ins, 31);
-        uint8_t rd = BITS(ins, 0, 4);
-        uint32_t immlo = BITS(ins, 29, 30);
-        uint32_t immhi = BITS(ins, 5, 23);
-        int64_t imm = sign_extend((immhi << 2) | immlo, 21);
-        
-        decoded->opcode = is_adrp ? ARM64_OP_ADRP : ARM64_OP_ADR;
-        
-        decoded->operands[0].type = ARM64_OPERAND_REG;
-        decoded->operands[0].reg = make_reg(rd, true);
-        
-        decoded->operands[1].type = ARM64_OPERAND_IMM;
-        if (is_adrp) {
-            decoded->operands[1].imm = (addr & ~0xFFFULL) + (imm << 12);
-        } else {
-            decoded->operands[1].imm = addr + imm;
-        }
-        
-        decoded->operand_count = 2;
-        return true;
-    }
-    
-    if (op == 0b010 || op == 0b011) {
-        bool is_sub = BIT(ins, 30);
-        bool set_flags = BIT(ins, 29);
-        
-        uint8_t rd = BITS(ins, 0, 4);
-        uint8_t rn = BITS(ins, 5, 9);
-        uint16_t imm12 = BITS(ins, 10, 21);
-        uint8_t shift = BIT(ins, 22) ? 12 : 0;
-        
-        if (is_sub) {
-            decoded->opcode = set_flags ? ARM64_OP_SUBS : ARM64_OP_SUB;
-        } else {
-            decoded->opcode = set_flags ? ARM64_OP_ADDS : ARM64_OP_ADD;
-        }
-        
-        if (set_flags && rd == 31) {
-            decoded->opcode = is_sub ? ARM64_OP_CMP : ARM64_OP_CMN;
-            decoded->operands[0].type = ARM64_OPERAND_REG;
-            decoded->operands[0].reg = make_reg(rn, is_64);
-            decoded->operands[1].type = ARM64_OPERAND_IMM;
-            decoded->operands[1].imm = imm12 << shift;
-            decoded->operand_count = 2;
-        } else {
-            decoded->operands[0].type = ARM64_OPERAND_REG;
-            decoded->operands[0].reg = make_reg(rd, is_64);
-            decoded->operands[1].type = ARM64_OPERAND_REG;
-            decoded->operands[1].reg = make_reg(rn, is_64);
-            decoded->operands[2].type = ARM64_OPERAND_IMM;
-            decoded->operands[2].imm = imm12 << shift;
-            decoded->operand_count = 3;
-        }
-        
-        return true;
-    }
-    
-    if (op == 0b100) {
-        uint8_t opc = BITS(ins, 29, 30);
-        uint8_t rd = BITS(ins, 0, 4);
-        uint8_t rn = BITS(ins, 5, 9);
-        uint8_t n = BIT(ins, 22);
-        uint8_t immr = BITS(ins, 16, 21);
-        uint8_t imms = BITS(ins, 10, 15);
-        
-        uint64_t immediate_value = 0;
-        if (!decode_bitmask_immediate(n, immr, imms, is_64, &immediate_value)) {
-            return false;
-        }
-        
-        switch (opc) {
-            case 0b00: decoded->opcode = ARM64_OP_AND; break;
-            case 0b01: decoded->opcode = ARM64_OP_ORR; break;
-            case 0b10: decoded->opcode = ARM64_OP_EOR; break;
-            case 0b11: decoded->opcode = ARM64_OP_ANDS; break;
-        }
+static ARM64Operand make_operand(const ARM64DecodedOperand *source, uint64_t address, bool is_pc_relative_value) {
+    ARM64Operand operand;
+    memset(&operand, 0, sizeof(operand));
+    
+    uint64_t target = 0;
+    
+    switch (source->kind) {
+        case ARM64_OPND_REG:
+        case ARM64_OPND_REG_LIST:
+            // A register list is given by its first register
+            operand.type = ARM64_OPERAND_REG;
+            operand.reg = make_reg(source->reg, source->reg_class);
+            break;
         
-        if (opc == 0b11 && rd == 31) {
-            decoded->opcode = ARM64_OP_TST;
-            decoded->operands[0].type = ARM64_OPERAND_REG;
-            decoded->operands[0].reg = make_reg(rn, is_64);
-            decoded->operand_count = 2;
-        } else {
-            decoded->operands[0].type = ARM64_OPERAND_REG;
-            decoded->operands[0].reg = make_reg(rd, is_64);
+        case ARM64_OPND_MEM:
+            operand.type = ARM64_OPERAND_MEM;
+            operand.mem.base = make_reg(source->reg, ARM64_REG_SP);
+            operand.mem.offset_imm = source->imm;
             
-            decoded->operands[1].type = ARM64_OPERAND_REG;
-            decoded->operands[1].reg = make_reg(rn, is_64);
-            
-            decoded->operand_count = 3;
-        }
-        
-        decoded->operands[decoded->operand_count - 1].type = ARM64_OPERAND_IMM;
-        decoded->operands[decoded->operand_count - 1].imm = immediate_value;
-        
-        return true;
-    }
-    
-    if (op == 0b101) {
-        uint8_t opc = BITS(ins, 29, 30);
-        uint8_t rd = BITS(ins, 0, 4);
-        uint16_t imm16 = BITS(ins, 5, 20);
-        uint8_t hw = BITS(ins, 21, 22);
-        
-        switch (opc) {
-            case 0b00: decoded->opcode = ARM64_OP_MOVN; break;
-            case 0b10: decoded->opcode = ARM64_OP_MOVZ; break;
-            case 0b11: decoded->opcode = ARM64_OP_MOVK; break;
-            default: return false;
-        }
-        
-        decoded->operands[0].type = ARM64_OPERAND_REG;
-        decoded->operands[0].reg = make_reg(rd, is_64);
-        decoded->operands[1].type = ARM64_OPERAND_IMM;
-        decoded->operands[1].imm = imm16;
-        
-        if (hw > 0) {
-            decoded->operands[2].type = ARM64_OPERAND_IMM;
-            decoded->operands[2].imm = hw * 16;
-            decoded->operand_count = 3;
-        } else {
-            decoded->operand_count = 2;
-        }
-        
-        return true;
-    }
-    
-    if (op == 0b110) {
-        uint8_t opc = BITS(ins, 29, 30);
-        uint8_t rd = BITS(ins, 0, 4);
-        uint8_t rn = BITS(ins, 5, 9);
-        uint8_t immr = BITS(ins, 16, 21);
-        uint8_t imms = BITS(ins, 10, 15);
-        
-        switch (opc) {
-            case 0b00: decoded->opcode = ARM64_OP_SBFM; break;
-            case 0b01: decoded->opcode = ARM64_OP_BFM; break;
-            case 0b10: decoded->opcode = ARM64_OP_UBFM; break;
-            default: return false;
-        }
-        
-        decoded->operands[0].type = ARM64_OPERAND_REG;
-        decoded->operands[0].reg = make_reg(rd, is_64);
-        decoded->operands[1].type = ARM64_OPERAND_REG;
-        decoded->operands[1].reg = make_reg(rn, is_64);
-        decoded->operands[2].type = ARM64_OPERAND_IMM;
-        decoded->operands[2].imm = immr;
-        decoded->operands[3].type = ARM64_OPERAND_IMM;
-        decoded->operands[3].imm = imms;
-        decoded->operand_count = 4;
-        return true;
-    }
-    
-    return false;
-}
-
-// MARK: - Data Processing (Register) Instruction Decoding
-
-static bool decode_data_processing_reg(uint32_t ins, uint64_t addr, ARM64DecodedInstruction *decoded) {
-    decoded->category = ARM64_INS_DATA_PROCESSING_REG;
-    
-    bool is_64 = BIT(ins, 31);
-    uint8_t op0 = BIT(ins, 30);
-    uint8_t op1 = BIT(ins, 28);
-    uint8_t op2 = BITS(ins, 21, 24);
-    uint8_t op3 = BITS(ins, 10, 15);
-    
-    if (op1 == 0 && op2 == 0b0000) {
-        bool is_sub = BIT(ins, 30);
-        bool set_flags = BIT(ins, 29);
-        
-        uint8_t rd = BITS(ins, 0, 4);
-        uint8_t rn = BITS(ins, 5, 9);
-        uint8_t rm = BITS(ins, 16, 20);
-        uint8_t shift = BITS(ins, 22, 23);
-        uint8_t imm6 = BITS(ins, 10, 15);
-        
-        if (is_sub) {
-            decoded->opcode = set_flags ? ARM64_OP_SUBS : ARM64_OP_SUB;
-        } else {
-            decoded->opcode = set_flags ? ARM64_OP_ADDS : ARM64_OP_ADD;
-        }
-        
-        if (set_flags && rd == 31) {
-            decoded->opcode = is_sub ? ARM64_OP_CMP : ARM64_OP_CMN;
-            decoded->operands[0].type = ARM64_OPERAND_REG;
-            decoded->operands[0].reg = make_reg(rn, is_64);
-            decoded->operands[1].type = ARM64_OPERAND_REG;
-            decoded->operands[1].reg = make_reg(rm, is_64);
-            decoded->operand_count = 2;
-        } else {
-            decoded->operands[0].type = ARM64_OPERAND_REG;
-            decoded->operands[0].reg = make_reg(rd, is_64);
-            decoded->operands[1].type = ARM64_OPERAND_REG;
-            decoded->operands[1].reg = make_reg(rn, is_64);
-            decoded->operands[2].type = ARM64_OPERAND_REG;
-            decoded->operands[2].reg = make_reg(rm, is_64);
-            decoded->operand_count = 3;
-        }
-        
-        return true;
-    }
-    
-    if (op1 == 0 && (op2 == 0b0000 || op2 == 0b0001 || op2 == 0b0010 || op2 == 0b0011)) {
-        uint8_t opc = BITS(ins, 29, 30);
-        bool n = BIT(ins, 21);
-        uint8_t rd = BITS(ins, 0, 4);
-        uint8_t rn = BITS(ins, 5, 9);
-        uint8_t rm = BITS(ins, 16, 20);
-        
-        if (opc == 0b00) {
-            decoded->opcode = n ? ARM64_OP_BIC : ARM64_OP_AND;
-        } else if (opc == 0b01) {
-            decoded->opcode = n ? ARM64_OP_EON : ARM64_OP_ORR;
-        } else if (opc == 0b10) {
-            decoded->opcode = ARM64_OP_EOR;
-        } else if (opc == 0b11) {
-            decoded->opcode = n ? ARM64_OP_BIC : ARM64_OP_ANDS;
-        }
-        
-        if (decoded->opcode == ARM64_OP_ORR && rn == 31) {
-            decoded->opcode = ARM64_OP_MOV;
-            decoded->operands[0].type = ARM64_OPERAND_REG;
-            decoded->operands[0].reg = make_reg(rd, is_64);
-            decoded->operands[1].type = ARM64_OPERAND_REG;
-            decoded->operands[1].reg = make_reg(rm, is_64);
-            decoded->operand_count = 2;
-        } else {
-            decoded->operands[0].type = ARM64_OPERAND_REG;
-            decoded->operands[0].reg = make_reg(rd, is_64);
-            decoded->operands[1].type = ARM64_OPERAND_REG;
-            decoded->operands[1].reg = make_reg(rn, is_64);
-            decoded->operands[2].type = ARM64_OPERAND_REG;
-            decoded->operands[2].reg = make_reg(rm, is_64);
-            decoded->operand_count = 3;
-        }
-        
-        return true;
-    }
-    
-    if (op1 == 1 && op2 == 0b0110) {
-        uint8_t rd = BITS(ins, 0, 4);
-        uint8_t rn = BITS(ins, 5, 9);
-        uint8_t rm = BITS(ins, 16, 20);
-        uint8_t opcode = BITS(ins, 10, 15);
-        
-        switch (opcode) {
-            case 0b000010: decoded->opcode = ARM64_OP_UDIV; break;
-            case 0b000011: decoded->opcode = ARM64_OP_SDIV; break;
-            case 0b001000: decoded->opcode = ARM64_OP_LSL; break;
-            case 0b001001: decoded->opcode = ARM64_OP_LSR; break;
-            case 0b001010: decoded->opcode = ARM64_OP_ASR; break;
-            case 0b001011: decoded->opcode = ARM64_OP_ROR; break;
-            default: return false;
-        }
+            switch (source->addressing) {
+                case ARM64_MEM_PRE_INDEX: operand.mem.mode = ARM64_ADDR_PRE_INDEX; break;
+                case ARM64_MEM_POST_INDEX: operand.mem.mode = ARM64_ADDR_POST_INDEX; break;
+                case ARM64_MEM_POST_INDEX_REG:
+                    operand.mem.mode = ARM64_ADDR_POST_INDEX;
+                    operand.mem.offset_reg = make_reg(source->index, ARM64_REG_X);
+                    break;
+                case ARM64_MEM_LITERAL:
+                    operand.mem.mode = ARM64_ADDR_LITERAL;
+                    arm64_operand_address(source, address, &target);
+                    operand.mem.offset_imm = (int64_t)target;
+                    break;
+                case ARM64_MEM_REG_OFFSET:
+                    // extend_type is the option field: UXTW 2, LSL 3, SXTW 6, SXTX 7
+                    operand.mem.mode = ARM64_ADDR_REG_EXTENDED;
+                    operand.mem.offset_reg = make_reg(source->index, source->reg_class);
+                    operand.mem.extend_type = (source->shift >= ARM64_EXTEND_UXTB) ? (source->shift - ARM64_EXTEND_UXTB) : 3;
+                    operand.mem.shift_amount = source->shift_amount;
+                    break;
+                default:
+                    operand.mem.mode = ARM64_ADDR_OFFSET;
+                    break;
+            }
+            break;
         
-        decoded->operands[0].type = ARM64_OPERAND_REG;
-        decoded->operands[0].reg = make_reg(rd, is_64);
-        decoded->operands[1].type = ARM64_OPERAND_REG;
-        decoded->operands[1].reg = make_reg(rn, is_64);
-        decoded->operands[2].type = ARM64_OPERAND_REG;
-        decoded->operands[2].reg = make_reg(rm, is_64);
-        decoded->operand_count = 3;
-        return true;
-    }
-    
-    if (op1 == 1 && (op2 & 0b1000)) {
-        uint8_t op31 = BITS(ins, 15, 15);
-        uint8_t o0 = BIT(ins, 15);
-        uint8_t rd = BITS(ins, 0, 4);
-        uint8_t rn = BITS(ins, 5, 9);
-        uint8_t ra = BITS(ins, 10, 14);
-        uint8_t rm = BITS(ins, 16, 20);
+        case ARM64_OPND_LABEL:
+        case ARM64_OPND_PAGE:
+            // Resolved to the address; branch targets are labels, while ADR
+            // and ADRP compute a value
+            arm64_operand_address(source, address, &target);
+            operand.type = is_pc_relative_value ? ARM64_OPERAND_IMM : ARM64_OPERAND_LABEL;
+            operand.imm = (int64_t)target;
+            break;
         
-        if ((op2 & 0b0111) == 0b0000) {
-            decoded->opcode = o0 ? ARM64_OP_MSUB : ARM64_OP_MADD;
-            
-            if (decoded->opcode == ARM64_OP_MADD && ra == 31) {
-                decoded->opcode = ARM64_OP_MUL;
-                decoded->operands[0].type = ARM64_OPERAND_REG;
-                decoded->operands[0].reg = make_reg(rd, is_64);
-                decoded->operands[1].type = ARM64_OPERAND_REG;
-                decoded->operands[1].reg = make_reg(rn, is_64);
-                decoded->operands[2].type = ARM64_OPERAND_REG;
-                decoded->operands[2].reg = make_reg(rm, is_64);
-                decoded->operand_count = 3;
-            } else {
-                decoded->operands[0].type = ARM64_OPERAND_REG;
-                decoded->operands[0].reg = make_reg(rd, is_64);
-                decoded->operands[1].type = ARM64_OPERAND_REG;
-                decoded->operands[1].reg = make_reg(rn, is_64);
-                decoded->operands[2].type = ARM64_OPERAND_REG;
-                decoded->operands[2].reg = make_reg(rm, is_64);
-                decoded->operands[3].type = ARM64_OPERAND_REG;
-                decoded->operands[3].reg = make_reg(ra, is_64);
-                decoded->operand_count = 4;
-            }
-            
-            return true;
-        }
+        default:
+            // Immediates (bitmasks included), and the raw fields of the
+            // system operands; FP immediates carry the bits of a double
+            operand.type = ARM64_OPERAND_IMM;
+            operand.imm = source->imm;
+            break;
     }
     
-    return false;
+    return operand;
 }
 
 // MARK: - Main Decoder
@@ -788,47 +346,42 @@ bool arm64dec_decode_instruction(uint32_t raw_instruction, uint64_t address, ARM
     
     decoded->raw = raw_instruction;
     decoded->address = address;
-    decoded->condition = ARM64_COND_AL;
     decoded->category = get_instruction_category(raw_instruction);
     
-    bool success = false;
-    switch (decoded->category) {
-        case ARM64_INS_BRANCH:
-            success = decode_branch_instruction(raw_instruction, address, decoded);
-            break;
-            
-        case ARM64_INS_LOAD_STORE:
-            success = decode_load_store_instruction(raw_instruction, address, decoded);
-            break;
-            
-        case ARM64_INS_DATA_PROCESSING_IMM:
-            success = decode_data_processing_imm(raw_instruction, address, decoded);
-            break;
-            
-        case ARM64_INS_DATA_PROCESSING_REG:
-            success = decode_data_processing_reg(raw_instruction, address, decoded);
-            break;
-            
-        case ARM64_INS_DATA_PROCESSING_SIMD:
-        case ARM64_INS_UNKNOWN:
-        default:
-            decoded->opcode = ARM64_OP_UNKNOWN;
-            snprintf(decoded->mnemonic, sizeof(decoded->mnemonic), ".long");
-            snprintf(decoded->operand_str, sizeof(decoded->operand_str), "0x%08x", raw_instruction);
-            return false;
+    ARM64DecodedWord *word = &decoded->word;
+    arm64_decode_word(raw_instruction, word);
+    decoded->condition = (ARM64Condition)word->condition;
+    
+    if (word->mnemonic == ARM64_MNEMONIC_WORD || word->mnemonic == ARM64_MNEMONIC_SIMD) {
+        decoded->opcode = ARM64_OP_UNKNOWN;
+        snprintf(decoded->mnemonic, sizeof(decoded->mnemonic), ".long");
+        snprintf(decoded->operand_str, sizeof(decoded->operand_str), "0x%08x", raw_instruction);
+        return false;
     }
     
-    if (success) {
-        const char *base_mnemonic = arm64dec_opcode_mnemonic(decoded->opcode);
-        if (decoded->opcode == ARM64_OP_B_COND) {
-            snprintf(decoded->mnemonic, sizeof(decoded->mnemonic), "b.%s",
-                    arm64dec_condition_name(decoded->condition));
-        } else {
-            snprintf(decoded->mnemonic, sizeof(decoded->mnemonic), "%s", base_mnemonic);
-        }
+    decoded->opcode = (ARM64Opcode)opcode_by_mnemonic[word->mnemonic];
+    
+    bool is_pc_relative_value = word->mnemonic == ARM64_MNEMONIC_ADR || word->mnemonic == ARM64_MNEMONIC_ADRP;
+    for (uint8_t i = 0; i < word->operand_count; i++) {
+        // Conditions live in decoded->condition
+        if (word->operands[i].kind == ARM64_OPND_COND) continue;
+        decoded->operands[decoded->operand_count++] = make_operand(&word->operands[i], address, is_pc_relative_value);
+    }
+    
+    // Same text as the disassembly, in this API's lower case
+    const char *name = arm64_mnemonic_name(word->mnemonic);
+    size_t i = 0;
+    for (; name[i] && i + 1 < sizeof(decoded->mnemonic); i++) {
+        decoded->mnemonic[i] = (char)tolower((unsigned char)name[i]);
     }
+    decoded->mnemonic[i] = '\0';
     
-    return success;
+    arm64_format_operands(word, address, decoded->operand_str, sizeof(decoded->operand_str));
+    for (char *c = decoded->operand_str; *c; c++) {
+        *c = (char)tolower((unsigned char)*c);
+    }
+    
+    return true;
 }
 
 // MARK: - Formatting and Analysis
@@ -836,130 +389,27 @@ bool arm64dec_decode_instruction(uint32_t raw_instruction, uint64_t address, ARM
 size_t arm64dec_format_instruction(const ARM64DecodedInstruction *decoded, char *buffer, size_t buffer_size) {
     if (!decoded || !buffer || buffer_size == 0) return 0;
     
-    size_t written = 0;
-    
-    written += snprintf(buffer + written, buffer_size - written, "%-8s ", decoded->mnemonic);
-    
-    for (uint8_t i = 0; i < decoded->operand_count && written < buffer_size; i++) {
-        if (i > 0) {
-            written += snprintf(buffer + written, buffer_size - written, ", ");
-        }
-        
-        const ARM64Operand *op = &decoded->operands[i];
-        
-        switch (op->type) {
-            case ARM64_OPERAND_REG:
-                written += snprintf(buffer + written, buffer_size - written, "%s",
-                                  arm64dec_register_name(op->reg));
-                break;
-                
-            case ARM64_OPERAND_IMM:
-                written += snprintf(buffer + written, buffer_size - written, "#0x%llx",
-                                  (unsigned long long)op->imm);
-                break;
-                
-            case ARM64_OPERAND_LABEL:
-                written += snprintf(buffer + written, buffer_size - written, "0x%llx",
-                                  (unsigned long long)op->imm);
-                break;
-                
-            case ARM64_OPERAND_MEM: {
-                const ARM64MemoryOperand *mem = &op->mem;
-                written += snprintf(buffer + written, buffer_size - written, "[%s",
-                                  arm64dec_register_name(mem->base));
-                
-                if (mem->mode == ARM64_ADDR_LITERAL) {
-                    written += snprintf(buffer + written, buffer_size - written, "]=0x%llx",
-                                      (unsigned long long)mem->offset_imm);
-                } else if (mem->mode == ARM64_ADDR_REG_OFFSET || mem->mode == ARM64_ADDR_REG_EXTENDED) {
-                    written += snprintf(buffer + written, buffer_size - written, ", %s",
-                                      arm64dec_register_name(mem->offset_reg));
-                    if (mem->shift_amount > 0) {
-                        written += snprintf(buffer + written, buffer_size - written, ", lsl #%d",
-                                          mem->shift_amount);
-                    }
-                    written += snprintf(buffer + written, buffer_size - written, "]");
-                } else if (mem->offset_imm != 0) {
-                    written += snprintf(buffer + written, buffer_size - written, ", #%lld]",
-                                      (long long)mem->offset_imm);
-                } else {
-                    written += snprintf(buffer + written, buffer_size - written, "]");
-                }
-                
-                if (mem->mode == ARM64_ADDR_PRE_INDEX) {
-                    written += snprintf(buffer + written, buffer_size - written, "!");
-                } else if (mem->mode == ARM64_ADDR_POST_INDEX) {
-                    written += snprintf(buffer + written, buffer_size - written - 1, ", #%lld",
-                                      (long long)mem->offset_imm);
-                }
-                break;
-            }
-                
-            case ARM64_OPERAND_NONE:
-            default:
-                break;
-        }
-    }
-    
-    return written;
+    int written = snprintf(buffer, buffer_size, "%-8s %s", decoded->mnemonic, decoded->operand_str);
+    if (written < 0) return 0;
+    return ((size_t)written < buffer_size) ? (size_t)written : buffer_size - 1;
 }
 
 bool arm64dec_get_branch_target(const ARM64DecodedInstruction *decoded, uint64_t *out_target) {
     if (!decoded || !out_target) return false;
+    if (!(decoded->word.flags & INST_FLAG_HAS_BRANCH_TARGET)) return false;
     
-    switch (decoded->opcode) {
-        case ARM64_OP_B:
-        case ARM64_OP_BL:
-        case ARM64_OP_B_COND:
-            if (decoded->operand_count > 0 && decoded->operands[0].type == ARM64_OPERAND_LABEL) {
-                *out_target = decoded->operands[0].imm;
-                return true;
-            }
-            break;
-            
-        case ARM64_OP_CBZ:
-        case ARM64_OP_CBNZ:
-            if (decoded->operand_count > 1 && decoded->operands[1].type == ARM64_OPERAND_LABEL) {
-                *out_target = decoded->operands[1].imm;
-                return true;
-            }
-            break;
-            
-        case ARM64_OP_TBZ:
-        case ARM64_OP_TBNZ:
-            if (decoded->operand_count > 2 && decoded->operands[2].type == ARM64_OPERAND_LABEL) {
-                *out_target = decoded->operands[2].imm;
-                return true;
-            }
-            break;
-            
-        default:
-            break;
-    }
-    
-    return false;
+    *out_target = decoded->address + (int64_t)decoded->word.branch_delta;
+    return true;
 }
 
 bool arm64dec_is_call(const ARM64DecodedInstruction *decoded) {
-    return decoded && (decoded->opcode == ARM64_OP_BL || decoded->opcode == ARM64_OP_BLR);
+    return decoded && decoded->word.branch_type == BRANCH_CALL;
 }
 
 bool arm64dec_is_return(const ARM64DecodedInstruction *decoded) {
-    return decoded && decoded->opcode == ARM64_OP_RET;
+    return decoded && decoded->word.branch_type == BRANCH_RETURN;
 }
 
 bool arm64dec_is_conditional_branch(const ARM64DecodedInstruction *decoded) {
-    if (!decoded) return false;
-    
-    switch (decoded->opcode) {
-        case ARM64_OP_B_COND:
-        case ARM64_OP_CBZ:
-        case ARM64_OP_CBNZ:
-        case ARM64_OP_TBZ:
-        case ARM64_OP_TBNZ:
-            return true;
-        default:
-            return false;
-    }
+    return decoded && decoded->word.branch_type == BRANCH_CONDITIONAL;
 }
-
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "DisassemblyEngine.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -113,6 +114,9 @@ typedef struct {
     bool is_64bit;
     bool is_sp;
     bool is_zero;
+    
+    // ARM64_REG_* of DisassemblyEngine.h, which also covers the FP registers
+    uint8_t reg_class;
 } ARM64Register;
 
 typedef enum {
@@ -161,10 +165,17 @@ typedef struct {
     uint8_t operand_count;
     char mnemonic[32];
     char operand_str[256];
+    
+    // The arm64_decode_word() result this view is built from, with the
+    // register read/write masks and branch semantics
+    ARM64DecodedWord word;
 } ARM64DecodedInstruction;
 
 // MARK: - Decoder API
 
+// A typed-operand view over arm64_decode_word(); both always agree. Returns
+// false for words without a decoded form (data, unallocated encodings and the
+// Advanced SIMD group), which are formatted as .long.
 bool arm64dec_decode_instruction(
     uint32_t raw_instruction,
     uint64_t address,
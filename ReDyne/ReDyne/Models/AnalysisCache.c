@@ -0,0 +1,1046 @@
+#include "AnalysisCache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CACHE_NO_STRING UINT32_MAX
+#define CACHE_MAX_WORKERS 16
+
+#pragma mark - File Format
+
+// Layout: CacheFileHeader, CACHE_SECTION_COUNT CacheSectionEntry records, then
+// each section's payload at an 8-byte aligned offset. Strings live once in the
+// string pool and are referenced by offset everywhere else.
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint8_t uuid[16];
+    uint64_t content_hash;
+    uint64_t slice_size;
+    uint32_t cputype;
+    uint32_t cpusubtype;
+    uint32_t has_uuid;
+    uint32_t section_count;
+    uint64_t file_size;
+} CacheFileHeader;
+
+typedef enum {
+    CACHE_ENTRY_ABSENT = 0,
+    CACHE_ENTRY_STORED = 1,
+    CACHE_ENTRY_EMPTY = 2
+} CacheEntryState;
+
+typedef struct {
+    uint64_t offset;
+    uint64_t size;
+    uint32_t count;
+    uint32_t record_size;
+    uint32_t state;
+    uint32_t reserved;
+} CacheSectionEntry;
+
+typedef struct {
+    uint64_t address;
+    uint64_t size;
+    uint32_t name;
+    uint32_t type;
+    uint32_t scope;
+    uint16_t desc;
+    uint8_t section;
+    uint8_t n_type;
+    uint8_t flags;
+    uint8_t reserved[7];
+} CachedSymbol;
+
+enum {
+    CACHED_SYMBOL_DEFINED = 1 << 0,
+    CACHED_SYMBOL_EXTERNAL = 1 << 1,
+    CACHED_SYMBOL_DEBUG = 1 << 2,
+    CACHED_SYMBOL_THUMB = 1 << 3,
+    CACHED_SYMBOL_WEAK = 1 << 4
+};
+
+typedef struct {
+    uint64_t address;
+    uint64_t offset;
+    uint32_t content;
+    uint32_t length;
+    uint32_t section;
+    uint8_t is_cstring;
+    uint8_t is_unicode;
+    uint8_t reserved[2];
+} CachedString;
+
+// Mirrors one row of the engine's InstructionStore; the mnemonic is interned
+// and operand text is re-rendered from the code bytes when a row is shown.
+typedef struct {
+    uint64_t offset;
+    uint32_t raw_word;
+    int32_t branch_delta;
+    uint32_t regs_read;
+    uint32_t regs_written;
+    uint32_t mnemonic;
+    uint8_t length;
+    uint8_t category;
+    uint8_t branch_type;
+    uint8_t flags;
+} CachedInstruction;
+
+// The ObjC section is a stream: this header, then each class, category and
+// protocol record followed by its member arrays, all 8-byte aligned.
+typedef struct {
+    uint32_t class_count;
+    uint32_t category_count;
+    uint32_t protocol_count;
+    uint32_t method_size;
+    uint32_t property_size;
+    uint32_t ivar_size;
+    uint32_t class_size;
+    uint32_t category_size;
+    uint32_t protocol_size;
+    uint32_t reserved;
+} CachedObjCHeader;
+
+struct AnalysisCache {
+    const uint8_t *map;
+    size_t map_size;
+    const CacheFileHeader *header;
+    const CacheSectionEntry *sections;
+    const char *pool;
+    uint64_t pool_size;
+};
+
+#pragma mark - Content Hashing
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Four independent lanes keep the multiplier pipeline busy on large chunks
+static uint64_t hash_bytes(const uint8_t *data, size_t size, uint64_t seed) {
+    const uint64_t prime = 0x9E3779B185EBCA87ULL;
+    uint64_t lanes[4] = { seed, seed ^ prime, seed + prime, seed - prime };
+    size_t i = 0;
+    
+    for (; i + 32 <= size; i += 32) {
+        for (int l = 0; l < 4; l++) {
+            uint64_t word;
+            memcpy(&word, data + i + l * 8, sizeof(word));
+            lanes[l] = rotl64(lanes[l] ^ (word * prime), 31) * prime;
+        }
+    }
+    
+    uint64_t h = rotl64(lanes[0], 1) + rotl64(lanes[1], 7) + rotl64(lanes[2], 12) + rotl64(lanes[3], 18);
+    for (; i < size; i++) {
+        h = (h ^ data[i]) * 0x100000001B3ULL;
+    }
+    
+    return mix64(h ^ size);
+}
+
+typedef struct {
+    const MachOContext *ctx;
+    uint64_t *chunk_hashes;
+    uint64_t chunk_count;
+    atomic_bool failed;
+    atomic_uint_fast64_t next;
+} HashBatch;
+
+static void* hash_worker(void *arg) {
+    HashBatch *batch = (HashBatch*)arg;
+    
+    for (;;) {
+        uint64_t i = atomic_fetch_add(&batch->next, 1);
+        if (i >= batch->chunk_count) break;
+        
+        uint64_t offset = i * ANALYSIS_CACHE_HASH_CHUNK;
+        uint64_t length = batch->ctx->slice_size - offset;
+        if (length > ANALYSIS_CACHE_HASH_CHUNK) length = ANALYSIS_CACHE_HASH_CHUNK;
+        
+        MachOSpan span = macho_span(batch->ctx, offset, length);
+        if (!span.data || span.size < length) {
+            atomic_store(&batch->failed, true);
+            break;
+        }
+        batch->chunk_hashes[i] = hash_bytes(span.data, (size_t)length, i);
+    }
+    
+    return NULL;
+}
+
+bool analysis_cache_compute_key(const MachOContext *ctx, AnalysisCacheKey *key) {
+    if (!ctx || !key || ctx->slice_size == 0) return false;
+    memset(key, 0, sizeof(AnalysisCacheKey));
+    
+    HashBatch batch;
+    batch.ctx = ctx;
+    batch.chunk_count = (ctx->slice_size + ANALYSIS_CACHE_HASH_CHUNK - 1) / ANALYSIS_CACHE_HASH_CHUNK;
+    batch.chunk_hashes = (uint64_t*)calloc(batch.chunk_count, sizeof(uint64_t));
+    if (!batch.chunk_hashes) return false;
+    atomic_init(&batch.failed, false);
+    atomic_init(&batch.next, 0);
+    
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint64_t worker_count = (uint64_t)(cpus > 0 ? cpus : 1);
+    if (worker_count > batch.chunk_count) worker_count = batch.chunk_count;
+    if (worker_count > CACHE_MAX_WORKERS) worker_count = CACHE_MAX_WORKERS;
+    
+    pthread_t workers[CACHE_MAX_WORKERS];
+    uint32_t started = 0;
+    for (uint64_t i = 1; i < worker_count; i++) {
+        if (pthread_create(&workers[started], NULL, hash_worker, &batch) == 0) {
+            started++;
+        }
+    }
+    
+    hash_worker(&batch);
+    
+    for (uint32_t i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    
+    bool ok = !atomic_load(&batch.failed);
+    if (ok) {
+        key->content_hash = hash_bytes((const uint8_t*)batch.chunk_hashes,
+                                       (size_t)(batch.chunk_count * sizeof(uint64_t)), ctx->slice_size);
+        key->slice_size = ctx->slice_size;
+        key->cputype = ctx->header.cputype;
+        key->cpusubtype = ctx->header.cpusubtype;
+        key->has_uuid = ctx->has_uuid;
+        memcpy(key->uuid, ctx->uuid, sizeof(key->uuid));
+    }
+    
+    free(batch.chunk_hashes);
+    return ok;
+}
+
+bool analysis_cache_file_path(const char *cache_dir, const AnalysisCacheKey *key, char *out, size_t out_size) {
+    if (!cache_dir || !key || !out || out_size == 0) return false;
+    
+    char uuid_hex[33] = "nouuid";
+    if (key->has_uuid) {
+        for (int i = 0; i < 16; i++) {
+            snprintf(uuid_hex + i * 2, 3, "%02x", key->uuid[i]);
+        }
+    }
+    
+    int written = snprintf(out, out_size, "%s/%s-%016llx-%08x.%s", cache_dir, uuid_hex,
+                           (unsigned long long)key->content_hash, key->cputype, ANALYSIS_CACHE_EXTENSION);
+    return written > 0 && (size_t)written < out_size;
+}
+
+#pragma mark - Writer
+
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    bool failed;
+} CacheBuffer;
+
+static void buffer_append(CacheBuffer *buf, const void *bytes, size_t length) {
+    if (buf->failed || length == 0) return;
+    
+    if (buf->size + length > buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity : 4096;
+        while (capacity < buf->size + length) capacity *= 2;
+        
+        uint8_t *grown = (uint8_t*)realloc(buf->data, capacity);
+        if (!grown) {
+            buf->failed = true;
+            return;
+        }
+        buf->data = grown;
+        buf->capacity = capacity;
+    }
+    
+    memcpy(buf->data + buf->size, bytes, length);
+    buf->size += length;
+}
+
+static void buffer_align(CacheBuffer *buf) {
+    static const uint8_t zeros[8] = { 0 };
+    size_t pad = (8 - (buf->size & 7)) & 7;
+    buffer_append(buf, zeros, pad);
+}
+
+typedef struct {
+    CacheBuffer bytes;
+    uint32_t *slots;
+    uint32_t slot_count;
+    uint32_t used;
+    bool failed;
+} StringPool;
+
+static uint32_t string_hash(const char *str, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)str[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static bool pool_grow(StringPool *pool) {
+    uint32_t new_count = pool->slot_count ? pool->slot_count * 2 : 4096;
+    uint32_t *slots = (uint32_t*)calloc(new_count, sizeof(uint32_t));
+    if (!slots) return false;
+    
+    for (uint32_t i = 0; i < pool->slot_count; i++) {
+        uint32_t entry = pool->slots[i];
+        if (entry == 0) continue;
+        
+        const char *str = (const char*)pool->bytes.data + (entry - 1);
+        uint32_t slot = string_hash(str, strlen(str)) & (new_count - 1);
+        while (slots[slot] != 0) slot = (slot + 1) & (new_count - 1);
+        slots[slot] = entry;
+    }
+    
+    free(pool->slots);
+    pool->slots = slots;
+    pool->slot_count = new_count;
+    return true;
+}
+
+// Returns the pool offset of str, adding it on first sight
+static uint32_t pool_intern(StringPool *pool, const char *str) {
+    if (!str || pool->failed) return CACHE_NO_STRING;
+    
+    if ((pool->used + 1) * 2 > pool->slot_count && !pool_grow(pool)) {
+        pool->failed = true;
+        return CACHE_NO_STRING;
+    }
+    
+    size_t len = strlen(str);
+    uint32_t mask = pool->slot_count - 1;
+    uint32_t slot = string_hash(str, len) & mask;
+    
+    while (pool->slots[slot] != 0) {
+        uint32_t offset = pool->slots[slot] - 1;
+        if (strcmp((const char*)pool->bytes.data + offset, str) == 0) return offset;
+        slot = (slot + 1) & mask;
+    }
+    
+    if (pool->bytes.size + len + 1 >= CACHE_NO_STRING) {
+        pool->failed = true;
+        return CACHE_NO_STRING;
+    }
+    
+    uint32_t offset = (uint32_t)pool->bytes.size;
+    buffer_append(&pool->bytes, str, len + 1);
+    if (pool->bytes.failed) {
+        pool->failed = true;
+        return CACHE_NO_STRING;
+    }
+    
+    pool->slots[slot] = offset + 1;
+    pool->used++;
+    return offset;
+}
+
+typedef struct {
+    CacheBuffer data[CACHE_SECTION_COUNT];
+    CacheSectionEntry entries[CACHE_SECTION_COUNT];
+    StringPool pool;
+} CacheWriter;
+
+static void write_symbols(CacheWriter *w, const SymbolTableContext *sym_ctx) {
+    CacheBuffer *buf = &w->data[CACHE_SECTION_SYMBOLS];
+    
+    for (uint32_t i = 0; i < sym_ctx->symbol_count; i++) {
+        const SymbolInfo *sym = &sym_ctx->symbols[i];
+        CachedSymbol rec;
+        memset(&rec, 0, sizeof(rec));
+        
+        rec.address = sym->address;
+        rec.size = sym->size;
+        rec.name = pool_intern(&w->pool, sym->name);
+        rec.type = sym->type;
+        rec.scope = sym->scope;
+        rec.desc = sym->desc;
+        rec.section = sym->section;
+        rec.n_type = sym->n_type;
+        rec.flags = (sym->is_defined ? CACHED_SYMBOL_DEFINED : 0) |
+                    (sym->is_external ? CACHED_SYMBOL_EXTERNAL : 0) |
+                    (sym->is_debug ? CACHED_SYMBOL_DEBUG : 0) |
+                    (sym->is_thumb ? CACHED_SYMBOL_THUMB : 0) |
+                    (sym->is_weak ? CACHED_SYMBOL_WEAK : 0);
+        buffer_append(buf, &rec, sizeof(rec));
+    }
+    w->entries[CACHE_SECTION_SYMBOLS].count = sym_ctx->symbol_count;
+    w->entries[CACHE_SECTION_SYMBOLS].record_size = sizeof(CachedSymbol);
+    
+    CacheBuffer *idx = &w->data[CACHE_SECTION_SYMBOL_INDICES];
+    uint32_t counts[4] = { sym_ctx->defined_count, sym_ctx->undefined_count,
+                           sym_ctx->external_count, sym_ctx->function_count };
+    buffer_append(idx, counts, sizeof(counts));
+    if (sym_ctx->defined_indices) buffer_append(idx, sym_ctx->defined_indices, counts[0] * sizeof(uint32_t));
+    if (sym_ctx->undefined_indices) buffer_append(idx, sym_ctx->undefined_indices, counts[1] * sizeof(uint32_t));
+    if (sym_ctx->external_indices) buffer_append(idx, sym_ctx->external_indices, counts[2] * sizeof(uint32_t));
+    if (sym_ctx->function_indices) buffer_append(idx, sym_ctx->function_indices, counts[3] * sizeof(uint32_t));
+    w->entries[CACHE_SECTION_SYMBOL_INDICES].count = 4;
+    w->entries[CACHE_SECTION_SYMBOL_INDICES].record_size = sizeof(uint32_t);
+}
+
+static void write_strings(CacheWriter *w, const StringContext *str_ctx) {
+    CacheBuffer *buf = &w->data[CACHE_SECTION_STRINGS];
+    
+    for (uint32_t i = 0; i < str_ctx->count; i++) {
+        const StringInfo *info = &str_ctx->strings[i];
+        CachedString rec;
+        memset(&rec, 0, sizeof(rec));
+        
+        rec.address = info->address;
+        rec.offset = info->offset;
+        rec.content = pool_intern(&w->pool, info->content);
+        rec.length = info->length;
+        rec.section = pool_intern(&w->pool, info->section);
+        rec.is_cstring = info->is_cstring;
+        rec.is_unicode = info->is_unicode;
+        buffer_append(buf, &rec, sizeof(rec));
+    }
+    w->entries[CACHE_SECTION_STRINGS].count = str_ctx->count;
+    w->entries[CACHE_SECTION_STRINGS].record_size = sizeof(CachedString);
+}
+
+static void write_instructions(CacheWriter *w, const DisassemblyContext *disasm_ctx) {
+    CacheBuffer *buf = &w->data[CACHE_SECTION_INSTRUCTIONS];
+    const InstructionStore *store = &disasm_ctx->store;
+    
+    for (uint32_t i = 0; i < disasm_ctx->instruction_count; i++) {
+        CachedInstruction rec;
+        memset(&rec, 0, sizeof(rec));
+        
+        rec.offset = disasm_address_at(disasm_ctx, i) - disasm_ctx->code_base_addr;
+        rec.raw_word = store->raw_words[i];
+        rec.branch_delta = store->branch_deltas[i];
+        rec.regs_read = store->regs_read[i];
+        rec.regs_written = store->regs_written[i];
+        rec.mnemonic = pool_intern(&w->pool, disasm_mnemonic_at(disasm_ctx, i));
+        rec.length = disasm_length_at(disasm_ctx, i);
+        rec.category = store->categories[i];
+        rec.branch_type = store->branch_types[i];
+        rec.flags = store->flags[i];
+        buffer_append(buf, &rec, sizeof(rec));
+    }
+    w->entries[CACHE_SECTION_INSTRUCTIONS].count = disasm_ctx->instruction_count;
+    w->entries[CACHE_SECTION_INSTRUCTIONS].record_size = sizeof(CachedInstruction);
+}
+
+static void write_protocol_names(CacheWriter *w, CacheBuffer *buf, char **protocols, int count) {
+    for (int i = 0; i < count; i++) {
+        uint32_t offset = pool_intern(&w->pool, protocols ? protocols[i] : NULL);
+        buffer_append(buf, &offset, sizeof(offset));
+    }
+    buffer_align(buf);
+}
+
+static void write_array(CacheBuffer *buf, const void *items, int count, size_t item_size) {
+    if (items && count > 0) buffer_append(buf, items, (size_t)count * item_size);
+    buffer_align(buf);
+}
+
+static void write_objc(CacheWriter *w, const ObjCRuntimeInfo *info) {
+    CacheBuffer *buf = &w->data[CACHE_SECTION_OBJC];
+    
+    CachedObjCHeader header;
+    memset(&header, 0, sizeof(header));
+    header.class_count = (uint32_t)info->class_count;
+    header.category_count = (uint32_t)info->category_count;
+    header.protocol_count = (uint32_t)info->protocol_count;
+    header.method_size = sizeof(ObjCMethodInfo);
+    header.property_size = sizeof(ObjCPropertyInfo);
+    header.ivar_size = sizeof(ObjCIvarInfo);
+    header.class_size = sizeof(ObjCClassInfo);
+    header.category_size = sizeof(ObjCCategoryInfo);
+    header.protocol_size = sizeof(ObjCProtocolInfo);
+    buffer_append(buf, &header, sizeof(header));
+    
+    // Records are stored with their pointer members cleared; the loader rebuilds them
+    for (int i = 0; i < info->class_count; i++) {
+        ObjCClassInfo cls = info->classes[i];
+        cls.instance_methods = NULL;
+        cls.class_methods = NULL;
+        cls.properties = NULL;
+        cls.ivars = NULL;
+        cls.protocols = NULL;
+        buffer_append(buf, &cls, sizeof(cls));
+        buffer_align(buf);
+        
+        const ObjCClassInfo *src = &info->classes[i];
+        write_array(buf, src->instance_methods, src->instance_method_count, sizeof(ObjCMethodInfo));
+        write_array(buf, src->class_methods, src->class_method_count, sizeof(ObjCMethodInfo));
+        write_array(buf, src->properties, src->property_count, sizeof(ObjCPropertyInfo));
+        write_array(buf, src->ivars, src->ivar_count, sizeof(ObjCIvarInfo));
+        write_protocol_names(w, buf, src->protocols, src->protocol_count);
+    }
+    
+    for (int i = 0; i < info->category_count; i++) {
+        ObjCCategoryInfo cat = info->categories[i];
+        cat.instance_methods = NULL;
+        cat.class_methods = NULL;
+        cat.properties = NULL;
+        cat.protocols = NULL;
+        buffer_append(buf, &cat, sizeof(cat));
+        buffer_align(buf);
+        
+        const ObjCCategoryInfo *src = &info->categories[i];
+        write_array(buf, src->instance_methods, src->instance_method_count, sizeof(ObjCMethodInfo));
+        write_array(buf, src->class_methods, src->class_method_count, sizeof(ObjCMethodInfo));
+        write_array(buf, src->properties, src->property_count, sizeof(ObjCPropertyInfo));
+        write_protocol_names(w, buf, src->protocols, src->protocol_count);
+    }
+    
+    for (int i = 0; i < info->protocol_count; i++) {
+        ObjCProtocolInfo proto = info->protocols[i];
+        proto.methods = NULL;
+        buffer_append(buf, &proto, sizeof(proto));
+        buffer_align(buf);
+        
+        write_array(buf, info->protocols[i].methods, info->protocols[i].method_count, sizeof(ObjCMethodInfo));
+    }
+    
+    w->entries[CACHE_SECTION_OBJC].count = 1;
+    w->entries[CACHE_SECTION_OBJC].record_size = sizeof(CachedObjCHeader);
+}
+
+static void mark_section(CacheWriter *w, AnalysisCacheSection section, bool stored) {
+    w->entries[section].state = stored ? CACHE_ENTRY_STORED : CACHE_ENTRY_EMPTY;
+}
+
+static bool write_fully(int fd, const void *data, size_t size) {
+    const uint8_t *p = (const uint8_t*)data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n <= 0) return false;
+        p += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+bool analysis_cache_write(const char *path, const AnalysisCacheKey *key, const AnalysisCacheContents *contents) {
+    if (!path || !key || !contents) return false;
+    
+    CacheWriter *w = (CacheWriter*)calloc(1, sizeof(CacheWriter));
+    if (!w) return false;
+    
+    if (contents->symbols) write_symbols(w, contents->symbols);
+    mark_section(w, CACHE_SECTION_SYMBOLS, contents->symbols != NULL);
+    mark_section(w, CACHE_SECTION_SYMBOL_INDICES, contents->symbols != NULL);
+    
+    if (contents->strings) write_strings(w, contents->strings);
+    mark_section(w, CACHE_SECTION_STRINGS, contents->strings != NULL);
+    
+    if (contents->disassembly) write_instructions(w, contents->disassembly);
+    mark_section(w, CACHE_SECTION_INSTRUCTIONS, contents->disassembly != NULL);
+    
+    if (contents->objc) write_objc(w, contents->objc);
+    mark_section(w, CACHE_SECTION_OBJC, contents->objc != NULL);
+    
+    if (contents->imports) {
+        write_array(&w->data[CACHE_SECTION_IMPORTS], contents->imports->imports,
+                    contents->imports->import_count, sizeof(ImportInfo));
+        w->entries[CACHE_SECTION_IMPORTS].count = (uint32_t)contents->imports->import_count;
+        w->entries[CACHE_SECTION_IMPORTS].record_size = sizeof(ImportInfo);
+    }
+    mark_section(w, CACHE_SECTION_IMPORTS, contents->imports != NULL);
+    
+    if (contents->exports) {
+        write_array(&w->data[CACHE_SECTION_EXPORTS], contents->exports->exports,
+                    contents->exports->export_count, sizeof(ExportInfo));
+        w->entries[CACHE_SECTION_EXPORTS].count = (uint32_t)contents->exports->export_count;
+        w->entries[CACHE_SECTION_EXPORTS].record_size = sizeof(ExportInfo);
+    }
+    mark_section(w, CACHE_SECTION_EXPORTS, contents->exports != NULL);
+    
+    // The pool is filled by the other sections, so it is laid out last
+    w->data[CACHE_SECTION_STRING_POOL] = w->pool.bytes;
+    memset(&w->pool.bytes, 0, sizeof(CacheBuffer));
+    buffer_append(&w->data[CACHE_SECTION_STRING_POOL], "", 1);
+    w->entries[CACHE_SECTION_STRING_POOL].count = 1;
+    w->entries[CACHE_SECTION_STRING_POOL].record_size = 1;
+    mark_section(w, CACHE_SECTION_STRING_POOL, true);
+    
+    bool ok = !w->pool.failed;
+    uint64_t offset = sizeof(CacheFileHeader) + sizeof(w->entries);
+    for (int i = 0; i < CACHE_SECTION_COUNT; i++) {
+        if (w->data[i].failed) ok = false;
+        w->entries[i].offset = offset;
+        w->entries[i].size = w->data[i].size;
+        offset += (w->data[i].size + 7) & ~7ULL;
+    }
+    
+    CacheFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = ANALYSIS_CACHE_MAGIC;
+    header.version = ANALYSIS_CACHE_VERSION;
+    memcpy(header.uuid, key->uuid, sizeof(header.uuid));
+    header.content_hash = key->content_hash;
+    header.slice_size = key->slice_size;
+    header.cputype = key->cputype;
+    header.cpusubtype = key->cpusubtype;
+    header.has_uuid = key->has_uuid;
+    header.section_count = CACHE_SECTION_COUNT;
+    header.file_size = offset;
+    
+    char tmp_path[1024];
+    int fd = -1;
+    if (ok && snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", path, (int)getpid()) < (int)sizeof(tmp_path)) {
+        fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    
+    if (fd >= 0) {
+        static const uint8_t zeros[8] = { 0 };
+        ok = write_fully(fd, &header, sizeof(header)) && write_fully(fd, w->entries, sizeof(w->entries));
+        for (int i = 0; ok && i < CACHE_SECTION_COUNT; i++) {
+            size_t pad = (8 - (w->data[i].size & 7)) & 7;
+            ok = write_fully(fd, w->data[i].data, w->data[i].size) && write_fully(fd, zeros, pad);
+        }
+        close(fd);
+        
+        if (ok) ok = (rename(tmp_path, path) == 0);
+        if (!ok) unlink(tmp_path);
+    } else {
+        ok = false;
+    }
+    
+    for (int i = 0; i < CACHE_SECTION_COUNT; i++) free(w->data[i].data);
+    free(w->pool.bytes.data);
+    free(w->pool.slots);
+    free(w);
+    
+    if (ok) printf("[AnalysisCache] Wrote %s (%llu bytes)\n", path, (unsigned long long)offset);
+    return ok;
+}
+
+#pragma mark - Reader
+
+AnalysisCache* analysis_cache_open(const char *path, const AnalysisCacheKey *key) {
+    if (!path || !key) return NULL;
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(CacheFileHeader) + sizeof(CacheSectionEntry) * CACHE_SECTION_COUNT) {
+        close(fd);
+        return NULL;
+    }
+    
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+    
+    AnalysisCache *cache = (AnalysisCache*)calloc(1, sizeof(AnalysisCache));
+    if (!cache) {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    cache->map = (const uint8_t*)map;
+    cache->map_size = (size_t)st.st_size;
+    cache->header = (const CacheFileHeader*)map;
+    cache->sections = (const CacheSectionEntry*)(cache->map + sizeof(CacheFileHeader));
+    
+    const CacheFileHeader *h = cache->header;
+    bool valid = h->magic == ANALYSIS_CACHE_MAGIC &&
+                 h->version == ANALYSIS_CACHE_VERSION &&
+                 h->section_count == CACHE_SECTION_COUNT &&
+                 h->file_size == cache->map_size &&
+                 h->content_hash == key->content_hash &&
+                 h->slice_size == key->slice_size &&
+                 h->cputype == key->cputype &&
+                 h->cpusubtype == key->cpusubtype &&
+                 (h->has_uuid != 0) == key->has_uuid &&
+                 memcmp(h->uuid, key->uuid, sizeof(h->uuid)) == 0;
+    
+    for (int i = 0; valid && i < CACHE_SECTION_COUNT; i++) {
+        const CacheSectionEntry *e = &cache->sections[i];
+        valid = e->offset <= cache->map_size && e->size <= cache->map_size - e->offset && (e->offset & 7) == 0;
+    }
+    
+    if (valid) {
+        const CacheSectionEntry *pool = &cache->sections[CACHE_SECTION_STRING_POOL];
+        cache->pool = (const char*)(cache->map + pool->offset);
+        cache->pool_size = pool->size;
+        valid = pool->size > 0 && cache->pool[pool->size - 1] == '\0';
+    }
+    
+    if (!valid) {
+        analysis_cache_close(cache);
+        return NULL;
+    }
+    
+    printf("[AnalysisCache] Hit %s\n", path);
+    return cache;
+}
+
+bool analysis_cache_contains(const AnalysisCache *cache, AnalysisCacheSection section) {
+    if (!cache || section >= CACHE_SECTION_COUNT) return false;
+    return cache->sections[section].state != CACHE_ENTRY_ABSENT;
+}
+
+bool analysis_cache_section_empty(const AnalysisCache *cache, AnalysisCacheSection section) {
+    if (!cache || section >= CACHE_SECTION_COUNT) return false;
+    return cache->sections[section].state == CACHE_ENTRY_EMPTY;
+}
+
+void analysis_cache_close(AnalysisCache *cache) {
+    if (!cache) return;
+    if (cache->map) munmap((void*)cache->map, cache->map_size);
+    free(cache);
+}
+
+static const void* section_records(const AnalysisCache *cache, AnalysisCacheSection section,
+                                   uint32_t record_size, uint32_t *out_count) {
+    *out_count = 0;
+    const CacheSectionEntry *e = &cache->sections[section];
+    if (e->state != CACHE_ENTRY_STORED || e->record_size != record_size) return NULL;
+    if ((uint64_t)e->count * record_size > e->size) return NULL;
+    
+    *out_count = e->count;
+    return cache->map + e->offset;
+}
+
+static const char* pool_string(const AnalysisCache *cache, uint32_t offset) {
+    if (offset == CACHE_NO_STRING || offset >= cache->pool_size) return NULL;
+    return cache->pool + offset;
+}
+
+static void copy_pool_string(const AnalysisCache *cache, uint32_t offset, char *out, size_t out_size) {
+    const char *str = pool_string(cache, offset);
+    size_t len = str ? strnlen(str, out_size - 1) : 0;
+    if (len) memcpy(out, str, len);
+    out[len] = '\0';
+}
+
+SymbolTableContext* analysis_cache_load_symbols(const AnalysisCache *cache, const MachOContext *ctx) {
+    if (!cache || !ctx) return NULL;
+    
+    uint32_t count = 0;
+    const CachedSymbol *recs = (const CachedSymbol*)section_records(cache, CACHE_SECTION_SYMBOLS, sizeof(CachedSymbol), &count);
+    if (!recs) return NULL;
+    
+    SymbolTableContext *sym_ctx = (SymbolTableContext*)calloc(1, sizeof(SymbolTableContext));
+    if (!sym_ctx) return NULL;
+    sym_ctx->macho_ctx = ctx;
+    sym_ctx->symbols = (SymbolInfo*)calloc(count ? count : 1, sizeof(SymbolInfo));
+    if (!sym_ctx->symbols) {
+        symbol_table_free(sym_ctx);
+        return NULL;
+    }
+    sym_ctx->symbol_count = count;
+    symbol_table_load_strings(sym_ctx);
+    
+    for (uint32_t i = 0; i < count; i++) {
+        const CachedSymbol *rec = &recs[i];
+        SymbolInfo *sym = &sym_ctx->symbols[i];
+        sym->name = pool_string(cache, rec->name);
+        sym->address = rec->address;
+        sym->size = rec->size;
+        sym->type = (SymbolType)rec->type;
+        sym->scope = (SymbolScope)rec->scope;
+        sym->section = rec->section;
+        sym->desc = rec->desc;
+        sym->n_type = rec->n_type;
+        sym->is_defined = (rec->flags & CACHED_SYMBOL_DEFINED) != 0;
+        sym->is_external = (rec->flags & CACHED_SYMBOL_EXTERNAL) != 0;
+        sym->is_debug = (rec->flags & CACHED_SYMBOL_DEBUG) != 0;
+        sym->is_thumb = (rec->flags & CACHED_SYMBOL_THUMB) != 0;
+        sym->is_weak = (rec->flags & CACHED_SYMBOL_WEAK) != 0;
+    }
+    
+    uint32_t index_words = 0;
+    const uint32_t *words = (const uint32_t*)section_records(cache, CACHE_SECTION_SYMBOL_INDICES, sizeof(uint32_t), &index_words);
+    const CacheSectionEntry *e = &cache->sections[CACHE_SECTION_SYMBOL_INDICES];
+    if (words && index_words == 4) {
+        uint64_t total = 4;
+        for (int i = 0; i < 4; i++) total += words[i];
+        
+        if (total * sizeof(uint32_t) <= e->size) {
+            const uint32_t *p = words + 4;
+            uint32_t **targets[4] = { &sym_ctx->defined_indices, &sym_ctx->undefined_indices,
+                                      &sym_ctx->external_indices, &sym_ctx->function_indices };
+            uint32_t *counts[4] = { &sym_ctx->defined_count, &sym_ctx->undefined_count,
+                                    &sym_ctx->external_count, &sym_ctx->function_count };
+            for (int i = 0; i < 4; i++) {
+                if (words[i] > 0) {
+                    *targets[i] = (uint32_t*)malloc(words[i] * sizeof(uint32_t));
+                    if (*targets[i]) {
+                        memcpy(*targets[i], p, words[i] * sizeof(uint32_t));
+                        *counts[i] = words[i];
+                    }
+                }
+                p += words[i];
+            }
+        }
+    }
+    
+    return sym_ctx;
+}
+
+StringContext* analysis_cache_load_strings(const AnalysisCache *cache) {
+    if (!cache) return NULL;
+    
+    uint32_t count = 0;
+    const CachedString *recs = (const CachedString*)section_records(cache, CACHE_SECTION_STRINGS, sizeof(CachedString), &count);
+    if (!recs) return NULL;
+    
+    StringContext *str_ctx = string_context_create(count ? count : 1);
+    if (!str_ctx) return NULL;
+    
+    for (uint32_t i = 0; i < count; i++) {
+        const CachedString *rec = &recs[i];
+        StringInfo *info = &str_ctx->strings[str_ctx->count];
+        
+        const char *content = pool_string(cache, rec->content);
+        info->content = strdup(content ? content : "");
+        if (!info->content) break;
+        
+        info->address = rec->address;
+        info->offset = rec->offset;
+        info->length = rec->length;
+        copy_pool_string(cache, rec->section, info->section, sizeof(info->section));
+        info->is_cstring = rec->is_cstring != 0;
+        info->is_unicode = rec->is_unicode != 0;
+        str_ctx->count++;
+    }
+    
+    return str_ctx;
+}
+
+DisassemblyContext* analysis_cache_load_disassembly(const AnalysisCache *cache, const MachOContext *ctx) {
+    if (!cache || !ctx) return NULL;
+    
+    uint32_t count = 0;
+    const CachedInstruction *recs = (const CachedInstruction*)section_records(cache, CACHE_SECTION_INSTRUCTIONS,
+                                                                               sizeof(CachedInstruction), &count);
+    if (!recs) return NULL;
+    
+    DisassemblyContext *disasm_ctx = disasm_create(ctx);
+    if (!disasm_ctx) return NULL;
+    
+    // Only locates the sections and stubs so rows can be rendered later;
+    // nothing is decoded
+    disasm_load_executable(disasm_ctx);
+    
+    if (!disasm_store_reserve(disasm_ctx, count ? count : 1)) {
+        disasm_free(disasm_ctx);
+        return NULL;
+    }
+    
+    // The store only reads the fields below, so the text buffers stay untouched
+    DisassembledInstruction inst;
+    for (uint32_t i = 0; i < count; i++) {
+        const CachedInstruction *rec = &recs[i];
+        
+        inst.address = disasm_ctx->code_base_addr + rec->offset;
+        inst.raw_bytes = rec->raw_word;
+        inst.length = rec->length;
+        copy_pool_string(cache, rec->mnemonic, inst.mnemonic, sizeof(inst.mnemonic));
+        inst.category = (InstructionCategory)rec->category;
+        inst.branch_type = (BranchType)rec->branch_type;
+        inst.has_branch_target = (rec->flags & INST_FLAG_HAS_BRANCH_TARGET) != 0;
+        inst.branch_target = inst.address + (int64_t)rec->branch_delta;
+        inst.regs_read = rec->regs_read;
+        inst.regs_written = rec->regs_written;
+        inst.is_valid = (rec->flags & INST_FLAG_VALID) != 0;
+        inst.is_function_start = (rec->flags & INST_FLAG_FUNCTION_START) != 0;
+        inst.is_function_end = (rec->flags & INST_FLAG_FUNCTION_END) != 0;
+        inst.updates_pc = (rec->flags & INST_FLAG_UPDATES_PC) != 0;
+        inst.has_branch = (rec->flags & INST_FLAG_HAS_BRANCH) != 0;
+        
+        if (!disasm_store_append(disasm_ctx, &inst)) {
+            disasm_free(disasm_ctx);
+            return NULL;
+        }
+    }
+    
+    return disasm_ctx;
+}
+
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+    bool failed;
+} CacheCursor;
+
+static const void* cursor_take(CacheCursor *cur, size_t size) {
+    size_t padded = (size + 7) & ~(size_t)7;
+    if (cur->failed || (size_t)(cur->end - cur->p) < padded) {
+        cur->failed = true;
+        return NULL;
+    }
+    const void *data = cur->p;
+    cur->p += padded;
+    return data;
+}
+
+static void* cursor_copy_array(CacheCursor *cur, int count, size_t item_size) {
+    if (count < 0) {
+        cur->failed = true;
+        return NULL;
+    }
+    const void *data = cursor_take(cur, (size_t)count * item_size);
+    if (!data || count == 0) return NULL;
+    
+    void *copy = malloc((size_t)count * item_size);
+    if (!copy) {
+        cur->failed = true;
+        return NULL;
+    }
+    memcpy(copy, data, (size_t)count * item_size);
+    return copy;
+}
+
+static char** cursor_protocol_names(CacheCursor *cur, const AnalysisCache *cache, int count) {
+    if (count < 0) {
+        cur->failed = true;
+        return NULL;
+    }
+    const uint32_t *offsets = (const uint32_t*)cursor_take(cur, (size_t)count * sizeof(uint32_t));
+    if (!offsets || count == 0) return NULL;
+    
+    char **names = (char**)calloc((size_t)count, sizeof(char*));
+    if (!names) {
+        cur->failed = true;
+        return NULL;
+    }
+    for (int i = 0; i < count; i++) {
+        const char *name = pool_string(cache, offsets[i]);
+        names[i] = strdup(name ? name : "");
+    }
+    return names;
+}
+
+ObjCRuntimeInfo* analysis_cache_load_objc(const AnalysisCache *cache) {
+    if (!cache) return NULL;
+    
+    const CacheSectionEntry *e = &cache->sections[CACHE_SECTION_OBJC];
+    if (e->state != CACHE_ENTRY_STORED || e->record_size != sizeof(CachedObjCHeader)) return NULL;
+    
+    CacheCursor cur = { cache->map + e->offset, cache->map + e->offset + e->size, false };
+    const CachedObjCHeader *header = (const CachedObjCHeader*)cursor_take(&cur, sizeof(CachedObjCHeader));
+    if (!header) return NULL;
+    if (header->method_size != sizeof(ObjCMethodInfo) || header->property_size != sizeof(ObjCPropertyInfo) ||
+        header->ivar_size != sizeof(ObjCIvarInfo) || header->class_size != sizeof(ObjCClassInfo) ||
+        header->category_size != sizeof(ObjCCategoryInfo) || header->protocol_size != sizeof(ObjCProtocolInfo)) {
+        return NULL;
+    }
+    
+    ObjCRuntimeInfo *info = (ObjCRuntimeInfo*)calloc(1, sizeof(ObjCRuntimeInfo));
+    if (!info) return NULL;
+    
+    if (header->class_count > 0) {
+        info->classes = (ObjCClassInfo*)calloc(header->class_count, sizeof(ObjCClassInfo));
+        if (!info->classes) cur.failed = true;
+    }
+    for (uint32_t i = 0; i < header->class_count && !cur.failed; i++) {
+        const ObjCClassInfo *rec = (const ObjCClassInfo*)cursor_take(&cur, sizeof(ObjCClassInfo));
+        if (!rec) break;
+        
+        ObjCClassInfo *cls = &info->classes[info->class_count++];
+        *cls = *rec;
+        cls->instance_methods = (ObjCMethodInfo*)cursor_copy_array(&cur, cls->instance_method_count, sizeof(ObjCMethodInfo));
+        cls->class_methods = (ObjCMethodInfo*)cursor_copy_array(&cur, cls->class_method_count, sizeof(ObjCMethodInfo));
+        cls->properties = (ObjCPropertyInfo*)cursor_copy_array(&cur, cls->property_count, sizeof(ObjCPropertyInfo));
+        cls->ivars = (ObjCIvarInfo*)cursor_copy_array(&cur, cls->ivar_count, sizeof(ObjCIvarInfo));
+        cls->protocols = cursor_protocol_names(&cur, cache, cls->protocol_count);
+        if (!cls->protocols) cls->protocol_count = 0;
+    }
+    
+    if (header->category_count > 0 && !cur.failed) {
+        info->categories = (ObjCCategoryInfo*)calloc(header->category_count, sizeof(ObjCCategoryInfo));
+        if (!info->categories) cur.failed = true;
+    }
+    for (uint32_t i = 0; i < header->category_count && !cur.failed; i++) {
+        const ObjCCategoryInfo *rec = (const ObjCCategoryInfo*)cursor_take(&cur, sizeof(ObjCCategoryInfo));
+        if (!rec) break;
+        
+        ObjCCategoryInfo *cat = &info->categories[info->category_count++];
+        *cat = *rec;
+        cat->instance_methods = (ObjCMethodInfo*)cursor_copy_array(&cur, cat->instance_method_count, sizeof(ObjCMethodInfo));
+        cat->class_methods = (ObjCMethodInfo*)cursor_copy_array(&cur, cat->class_method_count, sizeof(ObjCMethodInfo));
+        cat->properties = (ObjCPropertyInfo*)cursor_copy_array(&cur, cat->property_count, sizeof(ObjCPropertyInfo));
+        cat->protocols = cursor_protocol_names(&cur, cache, cat->protocol_count);
+        if (!cat->protocols) cat->protocol_count = 0;
+    }
+    
+    if (header->protocol_count > 0 && !cur.failed) {
+        info->protocols = (ObjCProtocolInfo*)calloc(header->protocol_count, sizeof(ObjCProtocolInfo));
+        if (!info->protocols) cur.failed = true;
+    }
+    for (uint32_t i = 0; i < header->protocol_count && !cur.failed; i++) {
+        const ObjCProtocolInfo *rec = (const ObjCProtocolInfo*)cursor_take(&cur, sizeof(ObjCProtocolInfo));
+        if (!rec) break;
+        
+        ObjCProtocolInfo *proto = &info->protocols[info->protocol_count++];
+        *proto = *rec;
+        proto->methods = (ObjCMethodInfo*)cursor_copy_array(&cur, proto->method_count, sizeof(ObjCMethodInfo));
+    }
+    
+    // A truncated stream leaves counts that no longer match their arrays
+    if (cur.failed) {
+        objc_free_runtime_info(info);
+        return NULL;
+    }
+    
+    return info;
+}
+
+ImportList* analysis_cache_load_imports(const AnalysisCache *cache) {
+    if (!cache) return NULL;
+    
+    uint32_t count = 0;
+    const ImportInfo *recs = (const ImportInfo*)section_records(cache, CACHE_SECTION_IMPORTS, sizeof(ImportInfo), &count);
+    if (!recs && cache->sections[CACHE_SECTION_IMPORTS].state != CACHE_ENTRY_STORED) return NULL;
+    
+    ImportList *list = (ImportList*)calloc(1, sizeof(ImportList));
+    if (!list) return NULL;
+    
+    list->imports = (ImportInfo*)malloc((count ? count : 1) * sizeof(ImportInfo));
+    if (!list->imports) {
+        free(list);
+        return NULL;
+    }
+    if (count) memcpy(list->imports, recs, count * sizeof(ImportInfo));
+    list->import_count = (int)count;
+    
+    return list;
+}
+
+ExportList* analysis_cache_load_exports(const AnalysisCache *cache) {
+    if (!cache) return NULL;
+    
+    uint32_t count = 0;
+    const ExportInfo *recs = (const ExportInfo*)section_records(cache, CACHE_SECTION_EXPORTS, sizeof(ExportInfo), &count);
+    if (!recs && cache->sections[CACHE_SECTION_EXPORTS].state != CACHE_ENTRY_STORED) return NULL;
+    
+    ExportList *list = (ExportList*)calloc(1, sizeof(ExportList));
+    if (!list) return NULL;
+    
+    list->exports = (ExportInfo*)malloc((count ? count : 1) * sizeof(ExportInfo));
+    if (!list->exports) {
+        free(list);
+        return NULL;
+    }
+    if (count) memcpy(list->exports, recs, count * sizeof(ExportInfo));
+    list->export_count = (int)count;
+    
+    return list;
+}
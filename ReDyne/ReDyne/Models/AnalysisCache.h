@@ -0,0 +1,97 @@
+#ifndef AnalysisCache_h
+#define AnalysisCache_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "MachOHeader.h"
+#include "SymbolTable.h"
+#include "StringExtractor.h"
+#include "DisassemblyEngine.h"
+#include "ObjCParser.h"
+#include "DyldInfo.h"
+
+#pragma mark - Constants
+
+#define ANALYSIS_CACHE_MAGIC 0x43445952
+#define ANALYSIS_CACHE_VERSION 3
+#define ANALYSIS_CACHE_EXTENSION "rdcache"
+#define ANALYSIS_CACHE_HASH_CHUNK (4ULL * 1024 * 1024)
+
+#pragma mark - Structures
+
+typedef enum {
+    CACHE_SECTION_STRING_POOL = 0,
+    CACHE_SECTION_SYMBOLS,
+    CACHE_SECTION_SYMBOL_INDICES,
+    CACHE_SECTION_STRINGS,
+    CACHE_SECTION_INSTRUCTIONS,
+    CACHE_SECTION_OBJC,
+    CACHE_SECTION_IMPORTS,
+    CACHE_SECTION_EXPORTS,
+    CACHE_SECTION_COUNT
+} AnalysisCacheSection;
+
+// Identifies one slice of one binary. The UUID alone is not enough: patched
+// binaries keep their LC_UUID, so the key also carries a hash of every byte.
+typedef struct {
+    uint8_t uuid[16];
+    bool has_uuid;
+    uint64_t content_hash;
+    uint64_t slice_size;
+    uint32_t cputype;
+    uint32_t cpusubtype;
+} AnalysisCacheKey;
+
+// Stage results to persist. NULL members are recorded as "computed, empty" so
+// a warm open does not retry them.
+typedef struct {
+    const SymbolTableContext *symbols;
+    const StringContext *strings;
+    const DisassemblyContext *disassembly;
+    const ObjCRuntimeInfo *objc;
+    const ImportList *imports;
+    const ExportList *exports;
+} AnalysisCacheContents;
+
+typedef struct AnalysisCache AnalysisCache;
+
+#pragma mark - Function Declarations
+
+// Hashes the slice in ANALYSIS_CACHE_HASH_CHUNK pieces across all cores.
+bool analysis_cache_compute_key(const MachOContext *ctx, AnalysisCacheKey *key);
+
+bool analysis_cache_file_path(const char *cache_dir, const AnalysisCacheKey *key, char *out, size_t out_size);
+
+// Writes to a temporary file and renames it into place, so readers never see a
+// partial cache.
+bool analysis_cache_write(const char *path, const AnalysisCacheKey *key, const AnalysisCacheContents *contents);
+
+// Maps the file read-only and validates the header, key and section table.
+// Returns NULL on a miss or on any mismatch.
+AnalysisCache* analysis_cache_open(const char *path, const AnalysisCacheKey *key);
+
+// True if the section was stored, including stages that were stored as empty.
+bool analysis_cache_contains(const AnalysisCache *cache, AnalysisCacheSection section);
+
+// True if the stage ran but produced nothing, in which case its loader returns
+// NULL by design rather than because the cache is damaged.
+bool analysis_cache_section_empty(const AnalysisCache *cache, AnalysisCacheSection section);
+
+// The loaders return objects freed with the stage's usual free function. Symbol
+// names point into the mapping, so the cache must outlive the symbol table.
+SymbolTableContext* analysis_cache_load_symbols(const AnalysisCache *cache, const MachOContext *ctx);
+
+StringContext* analysis_cache_load_strings(const AnalysisCache *cache);
+
+DisassemblyContext* analysis_cache_load_disassembly(const AnalysisCache *cache, const MachOContext *ctx);
+
+ObjCRuntimeInfo* analysis_cache_load_objc(const AnalysisCache *cache);
+
+ImportList* analysis_cache_load_imports(const AnalysisCache *cache);
+
+ExportList* analysis_cache_load_exports(const AnalysisCache *cache);
+
+void analysis_cache_close(AnalysisCache *cache);
+
+#endif
@@ -0,0 +1,492 @@
+#include "AnalysisSession.h"
+#include "ChainedFixups.h"
+#include "AnalysisCache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+struct AnalysisSession {
+    atomic_int ref_count;
+    char *filepath;
+    MachOContext *macho_ctx;
+    
+    pthread_mutex_t slot_locks[SESSION_SLOT_COUNT];
+    bool slot_ready[SESSION_SLOT_COUNT];
+    void *slot_values[SESSION_SLOT_COUNT];
+    SessionFreeFunc slot_free[SESSION_SLOT_COUNT];
+    
+    pthread_mutex_t cache_lock;
+    bool has_cache_key;
+    AnalysisCacheKey cache_key;
+    AnalysisCache *cache;
+    bool loaded_from_cache;
+};
+
+#pragma mark - Lifecycle
+
+AnalysisSession* session_open(const char *filepath, const FatSliceInfo *slice, char *error_msg) {
+    if (!filepath) {
+        if (error_msg) strcpy(error_msg, "No file path given");
+        return NULL;
+    }
+    
+    MachOContext *macho_ctx = macho_open(filepath, error_msg);
+    if (!macho_ctx) return NULL;
+    
+    bool header_ok = slice ? macho_parse_header_at(macho_ctx, slice->offset, slice->size)
+                           : macho_parse_header(macho_ctx);
+    if (!header_ok) {
+        if (error_msg) strcpy(error_msg, "Invalid Mach-O header");
+        macho_close(macho_ctx);
+        return NULL;
+    }
+    
+    if (!macho_parse_load_commands(macho_ctx)) {
+        if (error_msg) strcpy(error_msg, "Failed to parse load commands");
+        macho_close(macho_ctx);
+        return NULL;
+    }
+    
+    AnalysisSession *session = session_create(filepath, macho_ctx);
+    if (!session && error_msg) strcpy(error_msg, "Memory allocation failed");
+    
+    return session;
+}
+
+AnalysisSession* session_create(const char *filepath, MachOContext *macho_ctx) {
+    if (!macho_ctx) return NULL;
+    
+    if (!macho_ctx->segments) macho_extract_segments(macho_ctx);
+    if (!macho_ctx->sections) macho_extract_sections(macho_ctx);
+    macho_resolve_chained_fixups(macho_ctx);
+    
+    AnalysisSession *session = (AnalysisSession*)calloc(1, sizeof(AnalysisSession));
+    if (!session) {
+        macho_close(macho_ctx);
+        return NULL;
+    }
+    
+    session->filepath = strdup(filepath ? filepath : "");
+    session->macho_ctx = macho_ctx;
+    atomic_init(&session->ref_count, 1);
+    
+    for (int i = 0; i < SESSION_SLOT_COUNT; i++) {
+        pthread_mutex_init(&session->slot_locks[i], NULL);
+    }
+    pthread_mutex_init(&session->cache_lock, NULL);
+    
+    return session;
+}
+
+AnalysisSession* session_retain(AnalysisSession *session) {
+    if (session) atomic_fetch_add(&session->ref_count, 1);
+    return session;
+}
+
+void session_release(AnalysisSession *session) {
+    if (!session) return;
+    if (atomic_fetch_sub(&session->ref_count, 1) != 1) return;
+    
+    // Stage results may alias the mapping, so they go before the MachOContext
+    for (int i = 0; i < SESSION_SLOT_COUNT; i++) {
+        if (session->slot_values[i] && session->slot_free[i]) {
+            session->slot_free[i](session->slot_values[i]);
+        }
+        pthread_mutex_destroy(&session->slot_locks[i]);
+    }
+    
+    // Cached symbol names point into the cache mapping
+    analysis_cache_close(session->cache);
+    pthread_mutex_destroy(&session->cache_lock);
+    
+    macho_close(session->macho_ctx);
+    free(session->filepath);
+    free(session);
+}
+
+MachOContext* session_macho_context(AnalysisSession *session) {
+    return session ? session->macho_ctx : NULL;
+}
+
+const char* session_file_path(AnalysisSession *session) {
+    return session ? session->filepath : NULL;
+}
+
+#pragma mark - Memoization
+
+void* session_memoize(AnalysisSession *session, SessionSlot slot,
+                      SessionComputeFunc compute, void *arg, SessionFreeFunc free_fn) {
+    if (!session || slot >= SESSION_SLOT_COUNT || !compute) return NULL;
+    
+    pthread_mutex_lock(&session->slot_locks[slot]);
+    
+    if (!session->slot_ready[slot]) {
+        session->slot_values[slot] = compute(session->macho_ctx, arg);
+        session->slot_free[slot] = free_fn;
+        session->slot_ready[slot] = true;
+    }
+    
+    void *value = session->slot_values[slot];
+    pthread_mutex_unlock(&session->slot_locks[slot]);
+    
+    return value;
+}
+
+#pragma mark - Stage Computation
+
+static void* compute_symbols(MachOContext *macho_ctx, void *arg) {
+    (void)arg;
+    
+    SymbolTableContext *sym_ctx = symbol_table_create(macho_ctx);
+    if (!sym_ctx) return NULL;
+    
+    symbol_table_parse(sym_ctx);
+    symbol_table_categorize(sym_ctx);
+    symbol_table_extract_functions(sym_ctx);
+    
+    return sym_ctx;
+}
+
+static void* compute_strings(MachOContext *macho_ctx, void *arg) {
+    (void)arg;
+    
+    StringContext *str_ctx = string_context_create(1024);
+    if (!str_ctx) return NULL;
+    
+    for (uint32_t i = 0; i < macho_ctx->section_count; i++) {
+        SectionInfo *sect = &macho_ctx->sections[i];
+        if (strcmp(sect->sectname, "__cstring") == 0) {
+            MachOSpan span = macho_section_span(macho_ctx, sect);
+            string_extract_cstrings(str_ctx, span.data, sect->offset, span.size, sect->addr);
+        }
+    }
+    
+    for (uint32_t i = 0; i < macho_ctx->segment_count; i++) {
+        SegmentInfo *seg = &macho_ctx->segments[i];
+        if ((seg->initprot & 0x01) && seg->filesize > 0) {
+            MachOSpan span = macho_segment_span(macho_ctx, seg);
+            if (span.data) {
+                string_extract_from_data(str_ctx, span.data, span.size, seg->vmaddr, seg->segname, 4);
+            }
+        }
+    }
+    
+    string_context_sort(str_ctx);
+    return str_ctx;
+}
+
+static void* compute_disassembly(MachOContext *macho_ctx, void *arg) {
+    (void)arg;
+    
+    DisassemblyContext *disasm_ctx = disasm_create(macho_ctx);
+    if (!disasm_ctx) return NULL;
+    
+    if (!disasm_load_executable(disasm_ctx)) {
+        disasm_free(disasm_ctx);
+        return NULL;
+    }
+    
+    disasm_all(disasm_ctx);
+    return disasm_ctx;
+}
+
+static void* compute_relocations(MachOContext *macho_ctx, void *arg) {
+    (void)arg;
+    
+    RelocationContext *reloc_ctx = reloc_create(macho_ctx);
+    if (!reloc_ctx) return NULL;
+    
+    reloc_parse_rebase(reloc_ctx);
+    reloc_parse_bind(reloc_ctx);
+    reloc_parse_lazy_bind(reloc_ctx);
+    reloc_parse_weak_bind(reloc_ctx);
+    reloc_parse_chained_fixups(reloc_ctx);
+    reloc_parse_exports(reloc_ctx);
+    
+    return reloc_ctx;
+}
+
+static void* compute_objc_runtime(MachOContext *macho_ctx, void *arg) {
+    (void)arg;
+    
+    if (!objc_has_runtime_data(macho_ctx)) return NULL;
+    return objc_parse_runtime(macho_ctx);
+}
+
+static void* compute_imports(MachOContext *macho_ctx, void *arg) {
+    (void)arg;
+    return dyld_parse_imports(macho_ctx);
+}
+
+static void* compute_exports(MachOContext *macho_ctx, void *arg) {
+    (void)arg;
+    return dyld_parse_exports(macho_ctx);
+}
+
+static void* compute_functions(MachOContext *macho_ctx, void *arg) {
+    AnalysisSession *session = (AnalysisSession*)arg;
+    
+    // Only the section layout and stubs are needed, not a sweep
+    DisassemblyContext *disasm_ctx = disasm_create(macho_ctx);
+    if (!disasm_ctx) return NULL;
+    
+    FunctionList *functions = NULL;
+    if (disasm_load_executable(disasm_ctx)) {
+        functions = function_discover(disasm_ctx, session_symbols(session), 0);
+    }
+    
+    disasm_free(disasm_ctx);
+    return functions;
+}
+
+static void* compute_cfgs(MachOContext *macho_ctx, void *arg) {
+    (void)macho_ctx;
+    AnalysisSession *session = (AnalysisSession*)arg;
+    
+    DisassemblyContext *disasm_ctx = session_disassembly(session);
+    FunctionList *functions = session_functions(session);
+    if (!disasm_ctx || !functions) return NULL;
+    
+    return cfg_build_functions(disasm_ctx, functions, 0);
+}
+
+#pragma mark - Memoized Stages
+
+SymbolTableContext* session_symbols(AnalysisSession *session) {
+    return (SymbolTableContext*)session_memoize(session, SESSION_SLOT_SYMBOLS, compute_symbols, NULL,
+                                                (SessionFreeFunc)symbol_table_free);
+}
+
+StringContext* session_strings(AnalysisSession *session) {
+    return (StringContext*)session_memoize(session, SESSION_SLOT_STRINGS, compute_strings, NULL,
+                                           (SessionFreeFunc)string_context_free);
+}
+
+DisassemblyContext* session_disassembly(AnalysisSession *session) {
+    return (DisassemblyContext*)session_memoize(session, SESSION_SLOT_DISASSEMBLY, compute_disassembly, NULL,
+                                                (SessionFreeFunc)disasm_free);
+}
+
+RelocationContext* session_relocations(AnalysisSession *session) {
+    return (RelocationContext*)session_memoize(session, SESSION_SLOT_RELOCATIONS, compute_relocations, NULL,
+                                               (SessionFreeFunc)reloc_free);
+}
+
+ObjCRuntimeInfo* session_objc_runtime(AnalysisSession *session) {
+    return (ObjCRuntimeInfo*)session_memoize(session, SESSION_SLOT_OBJC, compute_objc_runtime, NULL,
+                                             (SessionFreeFunc)objc_free_runtime_info);
+}
+
+ImportList* session_imports(AnalysisSession *session) {
+    return (ImportList*)session_memoize(session, SESSION_SLOT_IMPORTS, compute_imports, NULL,
+                                        (SessionFreeFunc)dyld_free_imports);
+}
+
+ExportList* session_exports(AnalysisSession *session) {
+    return (ExportList*)session_memoize(session, SESSION_SLOT_EXPORTS, compute_exports, NULL,
+                                        (SessionFreeFunc)dyld_free_exports);
+}
+
+FunctionList* session_functions(AnalysisSession *session) {
+    return (FunctionList*)session_memoize(session, SESSION_SLOT_FUNCTIONS, compute_functions, session,
+                                          (SessionFreeFunc)function_list_free);
+}
+
+CFGList* session_cfgs(AnalysisSession *session) {
+    return (CFGList*)session_memoize(session, SESSION_SLOT_CFGS, compute_cfgs, session,
+                                     (SessionFreeFunc)cfg_list_free);
+}
+
+#pragma mark - Parallel Prefetch
+
+typedef struct {
+    AnalysisSession *session;
+    SessionSlot slot;
+} PrefetchJob;
+
+static void* prefetch_worker(void *arg) {
+    PrefetchJob *job = (PrefetchJob*)arg;
+    
+    switch (job->slot) {
+        case SESSION_SLOT_SYMBOLS: session_symbols(job->session); break;
+        case SESSION_SLOT_STRINGS: session_strings(job->session); break;
+        case SESSION_SLOT_DISASSEMBLY: session_disassembly(job->session); break;
+        case SESSION_SLOT_RELOCATIONS: session_relocations(job->session); break;
+        case SESSION_SLOT_OBJC: session_objc_runtime(job->session); break;
+        case SESSION_SLOT_IMPORTS: session_imports(job->session); break;
+        case SESSION_SLOT_EXPORTS: session_exports(job->session); break;
+        case SESSION_SLOT_FUNCTIONS: session_functions(job->session); break;
+        case SESSION_SLOT_CFGS: session_cfgs(job->session); break;
+        default: break;
+    }
+    
+    return NULL;
+}
+
+void session_prefetch(AnalysisSession *session, const SessionSlot *slots, uint32_t count) {
+    if (!session || !slots || count == 0) return;
+    if (count > SESSION_SLOT_COUNT) count = SESSION_SLOT_COUNT;
+    
+    PrefetchJob jobs[SESSION_SLOT_COUNT];
+    pthread_t threads[SESSION_SLOT_COUNT];
+    bool started[SESSION_SLOT_COUNT] = { false };
+    
+    for (uint32_t i = 0; i < count; i++) {
+        jobs[i].session = session;
+        jobs[i].slot = slots[i];
+    }
+    
+    // The caller's thread takes the first job instead of idling in join
+    for (uint32_t i = 1; i < count; i++) {
+        started[i] = (pthread_create(&threads[i], NULL, prefetch_worker, &jobs[i]) == 0);
+    }
+    
+    prefetch_worker(&jobs[0]);
+    
+    for (uint32_t i = 1; i < count; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            prefetch_worker(&jobs[i]);
+        }
+    }
+}
+
+#pragma mark - Persistent Cache
+
+static const SessionSlot kCachedSlots[] = {
+    SESSION_SLOT_SYMBOLS,
+    SESSION_SLOT_STRINGS,
+    SESSION_SLOT_DISASSEMBLY,
+    SESSION_SLOT_OBJC,
+    SESSION_SLOT_IMPORTS,
+    SESSION_SLOT_EXPORTS
+};
+
+static const AnalysisCacheSection kCachedSections[] = {
+    CACHE_SECTION_SYMBOLS,
+    CACHE_SECTION_STRINGS,
+    CACHE_SECTION_INSTRUCTIONS,
+    CACHE_SECTION_OBJC,
+    CACHE_SECTION_IMPORTS,
+    CACHE_SECTION_EXPORTS
+};
+
+#define SESSION_CACHED_SLOT_COUNT (sizeof(kCachedSlots) / sizeof(kCachedSlots[0]))
+
+// Must be called with cache_lock held. The key hashes the whole slice, so it is
+// computed at most once per session.
+static bool session_cache_path(AnalysisSession *session, const char *cache_dir, char *out, size_t out_size) {
+    if (!session->has_cache_key) {
+        session->has_cache_key = analysis_cache_compute_key(session->macho_ctx, &session->cache_key);
+    }
+    if (!session->has_cache_key) return false;
+    
+    return analysis_cache_file_path(cache_dir, &session->cache_key, out, out_size);
+}
+
+static void* load_cached_slot(AnalysisCache *cache, SessionSlot slot, MachOContext *macho_ctx, SessionFreeFunc *free_fn) {
+    switch (slot) {
+        case SESSION_SLOT_SYMBOLS:
+            *free_fn = (SessionFreeFunc)symbol_table_free;
+            return analysis_cache_load_symbols(cache, macho_ctx);
+        case SESSION_SLOT_STRINGS:
+            *free_fn = (SessionFreeFunc)string_context_free;
+            return analysis_cache_load_strings(cache);
+        case SESSION_SLOT_DISASSEMBLY:
+            *free_fn = (SessionFreeFunc)disasm_free;
+            return analysis_cache_load_disassembly(cache, macho_ctx);
+        case SESSION_SLOT_OBJC:
+            *free_fn = (SessionFreeFunc)objc_free_runtime_info;
+            return analysis_cache_load_objc(cache);
+        case SESSION_SLOT_IMPORTS:
+            *free_fn = (SessionFreeFunc)dyld_free_imports;
+            return analysis_cache_load_imports(cache);
+        case SESSION_SLOT_EXPORTS:
+            *free_fn = (SessionFreeFunc)dyld_free_exports;
+            return analysis_cache_load_exports(cache);
+        default:
+            *free_fn = NULL;
+            return NULL;
+    }
+}
+
+bool session_load_cache(AnalysisSession *session, const char *cache_dir) {
+    if (!session || !cache_dir) return false;
+    
+    pthread_mutex_lock(&session->cache_lock);
+    
+    char path[1024];
+    AnalysisCache *cache = session->cache;
+    if (!cache && session_cache_path(session, cache_dir, path, sizeof(path))) {
+        cache = analysis_cache_open(path, &session->cache_key);
+    }
+    
+    if (!cache) {
+        pthread_mutex_unlock(&session->cache_lock);
+        return false;
+    }
+    session->cache = cache;
+    
+    uint32_t seeded = 0;
+    for (uint32_t i = 0; i < SESSION_CACHED_SLOT_COUNT; i++) {
+        SessionSlot slot = kCachedSlots[i];
+        AnalysisCacheSection section = kCachedSections[i];
+        if (!analysis_cache_contains(cache, section)) continue;
+        
+        pthread_mutex_lock(&session->slot_locks[slot]);
+        if (session->slot_ready[slot]) {
+            seeded++;
+        } else {
+            SessionFreeFunc free_fn = NULL;
+            void *value = load_cached_slot(cache, slot, session->macho_ctx, &free_fn);
+            
+            // A stored stage that fails to load is left for normal computation
+            if (value || analysis_cache_section_empty(cache, section)) {
+                session->slot_values[slot] = value;
+                session->slot_free[slot] = free_fn;
+                session->slot_ready[slot] = true;
+                seeded++;
+            }
+        }
+        pthread_mutex_unlock(&session->slot_locks[slot]);
+    }
+    
+    session->loaded_from_cache = (seeded == SESSION_CACHED_SLOT_COUNT);
+    pthread_mutex_unlock(&session->cache_lock);
+    
+    return seeded > 0;
+}
+
+bool session_save_cache(AnalysisSession *session, const char *cache_dir) {
+    if (!session || !cache_dir) return false;
+    
+    pthread_mutex_lock(&session->cache_lock);
+    bool up_to_date = session->loaded_from_cache;
+    pthread_mutex_unlock(&session->cache_lock);
+    if (up_to_date) return true;
+    
+    session_prefetch(session, kCachedSlots, SESSION_CACHED_SLOT_COUNT);
+    
+    AnalysisCacheContents contents;
+    contents.symbols = session_symbols(session);
+    contents.strings = session_strings(session);
+    contents.disassembly = session_disassembly(session);
+    contents.objc = session_objc_runtime(session);
+    contents.imports = session_imports(session);
+    contents.exports = session_exports(session);
+    
+    if (mkdir(cache_dir, 0755) != 0 && errno != EEXIST) return false;
+    
+    pthread_mutex_lock(&session->cache_lock);
+    char path[1024];
+    bool ok = session_cache_path(session, cache_dir, path, sizeof(path)) &&
+              analysis_cache_write(path, &session->cache_key, &contents);
+    if (ok) session->loaded_from_cache = true;
+    pthread_mutex_unlock(&session->cache_lock);
+    
+    return ok;
+}
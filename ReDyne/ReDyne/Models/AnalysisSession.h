@@ -0,0 +1,110 @@
+#ifndef AnalysisSession_h
+#define AnalysisSession_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "MachOHeader.h"
+#include "SymbolTable.h"
+#include "StringExtractor.h"
+#include "DisassemblyEngine.h"
+#include "RelocationInfo.h"
+#include "ObjCParser.h"
+#include "DyldInfo.h"
+#include "FunctionDiscovery.h"
+#include "ControlFlowGraph.h"
+
+#pragma mark - Structures
+
+typedef enum {
+    SESSION_SLOT_SYMBOLS,
+    SESSION_SLOT_STRINGS,
+    SESSION_SLOT_DISASSEMBLY,
+    SESSION_SLOT_RELOCATIONS,
+    SESSION_SLOT_OBJC,
+    SESSION_SLOT_IMPORTS,
+    SESSION_SLOT_EXPORTS,
+    SESSION_SLOT_FUNCTIONS,
+    SESSION_SLOT_CFGS,
+    SESSION_SLOT_COUNT
+} SessionSlot;
+
+typedef void* (*SessionComputeFunc)(MachOContext *macho_ctx, void *arg);
+typedef void (*SessionFreeFunc)(void *value);
+
+// One parsed MachOContext shared by every analysis stage. Stages attach through
+// session_memoize() (or the typed accessors below), so each result is computed
+// once per session no matter how many services ask for it. Reference counted
+// and safe to use from multiple threads.
+typedef struct AnalysisSession AnalysisSession;
+
+#pragma mark - Function Declarations
+
+// Opens the file and runs header, load command, segment and section parsing.
+// A NULL slice selects the preferred architecture. Returns a session holding
+// one reference, or NULL with error_msg filled in.
+AnalysisSession* session_open(const char *filepath, const FatSliceInfo *slice, char *error_msg);
+
+// Wraps an already parsed context (header and load commands done). The session
+// takes ownership of macho_ctx, closing it on failure as well.
+AnalysisSession* session_create(const char *filepath, MachOContext *macho_ctx);
+
+AnalysisSession* session_retain(AnalysisSession *session);
+
+void session_release(AnalysisSession *session);
+
+MachOContext* session_macho_context(AnalysisSession *session);
+
+const char* session_file_path(AnalysisSession *session);
+
+// Returns the cached value for slot, computing it on first use. Concurrent
+// callers for the same slot block until the first computation finishes; a NULL
+// result is cached too so failed stages are not retried.
+void* session_memoize(AnalysisSession *session, SessionSlot slot,
+                      SessionComputeFunc compute, void *arg, SessionFreeFunc free_fn);
+
+#pragma mark - Memoized Stages
+
+// Results are owned by the session and stay valid until the last release.
+
+SymbolTableContext* session_symbols(AnalysisSession *session);
+
+StringContext* session_strings(AnalysisSession *session);
+
+DisassemblyContext* session_disassembly(AnalysisSession *session);
+
+RelocationContext* session_relocations(AnalysisSession *session);
+
+ObjCRuntimeInfo* session_objc_runtime(AnalysisSession *session);
+
+ImportList* session_imports(AnalysisSession *session);
+
+ExportList* session_exports(AnalysisSession *session);
+
+// Recursive-descent function discovery over the code sections, seeded from
+// LC_FUNCTION_STARTS, the symbols and the stubs. Independent of
+// session_disassembly(): it decodes only the reachable code itself.
+FunctionList* session_functions(AnalysisSession *session);
+
+// One control flow graph per entry of session_functions(), built in parallel
+// over the rows of session_disassembly()
+CFGList* session_cfgs(AnalysisSession *session);
+
+// Computes the listed stages in parallel, one thread each, and returns once all
+// are cached. Stages only read the shared context, so they never contend.
+void session_prefetch(AnalysisSession *session, const SessionSlot *slots, uint32_t count);
+
+#pragma mark - Persistent Cache
+
+// Looks for a cache file matching this slice in cache_dir and, on a hit, seeds
+// every stored stage so its accessor returns without recomputing. Stages that
+// are already computed keep their value. Returns true when any stage was
+// seeded; call session_save_cache() anyway, as a partial hit leaves stages to
+// be stored.
+bool session_load_cache(AnalysisSession *session, const char *cache_dir);
+
+// Computes the cacheable stages that are still missing and writes them to
+// cache_dir, creating the directory if needed. Does nothing when the session
+// was itself loaded from a complete cache.
+bool session_save_cache(AnalysisSession *session, const char *cache_dir);
+
+#endif
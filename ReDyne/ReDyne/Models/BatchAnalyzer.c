@@ -0,0 +1,480 @@
+#include "BatchAnalyzer.h"
+#include "QuickScan.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#pragma mark - Path Collection
+
+typedef struct {
+    char **items;
+    uint32_t count;
+    uint32_t capacity;
+} PathList;
+
+static bool path_list_add(PathList *list, const char *path) {
+    if (list->count >= list->capacity) {
+        uint32_t capacity = list->capacity ? list->capacity * 2 : 256;
+        char **grown = (char**)realloc(list->items, capacity * sizeof(char*));
+        if (!grown) return false;
+        list->items = grown;
+        list->capacity = capacity;
+    }
+    
+    list->items[list->count] = strdup(path);
+    if (!list->items[list->count]) return false;
+    list->count++;
+    return true;
+}
+
+static void collect_recursive(const char *path, PathList *list) {
+    struct stat st;
+    if (lstat(path, &st) != 0) return;
+    
+    if (S_ISREG(st.st_mode)) {
+        // Smaller than a mach_header, so it cannot be a binary
+        if (st.st_size >= 28) path_list_add(list, path);
+        return;
+    }
+    if (!S_ISDIR(st.st_mode)) return;
+    
+    DIR *dir = opendir(path);
+    if (!dir) return;
+    
+    struct dirent *entry;
+    char child[4096];
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        if (snprintf(child, sizeof(child), "%s/%s", path, entry->d_name) >= (int)sizeof(child)) continue;
+        collect_recursive(child, list);
+    }
+    
+    closedir(dir);
+}
+
+uint32_t batch_collect_paths(const char *root, char ***out_paths) {
+    if (!root || !out_paths) return 0;
+    *out_paths = NULL;
+    
+    PathList candidates = { NULL, 0, 0 };
+    collect_recursive(root, &candidates);
+    if (candidates.count == 0) return 0;
+    
+    MachOQuickInfo *infos = (MachOQuickInfo*)calloc(candidates.count, sizeof(MachOQuickInfo));
+    if (!infos) {
+        batch_free_paths(candidates.items, candidates.count);
+        return 0;
+    }
+    macho_quick_scan_batch((const char *const *)candidates.items, candidates.count, infos);
+    
+    // Keep the valid entries in place and drop the rest
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < candidates.count; i++) {
+        if (infos[i].is_valid) {
+            candidates.items[kept++] = candidates.items[i];
+        } else {
+            free(candidates.items[i]);
+        }
+    }
+    free(infos);
+    
+    if (kept == 0) {
+        free(candidates.items);
+        return 0;
+    }
+    
+    *out_paths = candidates.items;
+    return kept;
+}
+
+void batch_free_paths(char **paths, uint32_t count) {
+    if (!paths) return;
+    for (uint32_t i = 0; i < count; i++) free(paths[i]);
+    free(paths);
+}
+
+#pragma mark - Memory Admission
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t released;
+    uint64_t budget;
+    uint64_t admitted;
+    uint64_t peak;
+    uint32_t in_flight;
+} AdmissionGate;
+
+// Heap the pipeline will allocate for this binary. The mapping itself is file
+// backed and not counted; the instruction store dominates everything else.
+static uint64_t estimate_cost(const MachOContext *ctx) {
+    uint64_t cost = ctx->slice_size / 4;
+    cost += (uint64_t)ctx->nsyms * sizeof(SymbolInfo);
+    
+    for (uint32_t i = 0; i < ctx->section_count; i++) {
+        const SectionInfo *sect = &ctx->sections[i];
+        
+        // A corrupt size cannot claim more than the slice holds
+        uint64_t size = sect->size < ctx->slice_size ? sect->size : ctx->slice_size;
+        
+        // Every section disasm_load_executable() decodes: __text, the stubs and any other code
+        if ((sect->flags & (S_ATTR_PURE_INSTRUCTIONS | S_ATTR_SOME_INSTRUCTIONS)) && sect->offset != 0) {
+            cost += (size / 4) * INSTRUCTION_STORE_ROW_SIZE;
+        } else if (strcmp(sect->sectname, "__cstring") == 0) {
+            cost += size / 16 * sizeof(StringInfo) + size;
+        }
+    }
+    
+    return cost;
+}
+
+static void admission_acquire(AdmissionGate *gate, uint64_t cost) {
+    pthread_mutex_lock(&gate->lock);
+    
+    while (gate->in_flight > 0 && gate->admitted + cost > gate->budget) {
+        pthread_cond_wait(&gate->released, &gate->lock);
+    }
+    
+    gate->admitted += cost;
+    gate->in_flight++;
+    if (gate->admitted > gate->peak) gate->peak = gate->admitted;
+    
+    pthread_mutex_unlock(&gate->lock);
+}
+
+static void admission_release(AdmissionGate *gate, uint64_t cost) {
+    pthread_mutex_lock(&gate->lock);
+    gate->admitted -= cost;
+    gate->in_flight--;
+    pthread_cond_broadcast(&gate->released);
+    pthread_mutex_unlock(&gate->lock);
+}
+
+#pragma mark - Result Output
+
+static void write_json_string(FILE *out, const char *str) {
+    fputc('"', out);
+    for (const unsigned char *p = (const unsigned char*)(str ? str : ""); *p; p++) {
+        switch (*p) {
+            case '"': fputs("\\\"", out); break;
+            case '\\': fputs("\\\\", out); break;
+            case '\n': fputs("\\n", out); break;
+            case '\r': fputs("\\r", out); break;
+            case '\t': fputs("\\t", out); break;
+            default:
+                if (*p < 0x20) {
+                    fprintf(out, "\\u%04x", *p);
+                } else {
+                    fputc(*p, out);
+                }
+                break;
+        }
+    }
+    fputc('"', out);
+}
+
+typedef struct {
+    const char *path;
+    const char *status;
+    const char *error;
+    MachOContext *macho_ctx;
+    SymbolTableContext *symbols;
+    StringContext *strings;
+    DisassemblyContext *disassembly;
+    ObjCRuntimeInfo *objc;
+    ImportList *imports;
+    ExportList *exports;
+    bool cache_hit;
+    double elapsed_ms;
+} BatchFileResult;
+
+static void result_file_path(const BatchOptions *options, uint32_t index, const char *path, char *out, size_t out_size) {
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    snprintf(out, out_size, "%s/%06u-%s.%s", options->output_dir, index, base, BATCH_RESULT_EXTENSION);
+}
+
+// One line of JSON per binary: identity, stage counts, and the names a corpus
+// query usually needs (imports, exports, ObjC classes)
+static bool write_result(const BatchOptions *options, uint32_t index, const BatchFileResult *result) {
+    char out_path[4096];
+    result_file_path(options, index, result->path, out_path, sizeof(out_path));
+    
+    FILE *out = fopen(out_path, "w");
+    if (!out) return false;
+    
+    fputs("{\"path\":", out);
+    write_json_string(out, result->path);
+    fputs(",\"status\":", out);
+    write_json_string(out, result->status);
+    if (result->error) {
+        fputs(",\"error\":", out);
+        write_json_string(out, result->error);
+    }
+    
+    const MachOContext *ctx = result->macho_ctx;
+    if (ctx) {
+        fputs(",\"arch\":", out);
+        write_json_string(out, macho_cpu_type_string(ctx->header.cputype));
+        fputs(",\"filetype\":", out);
+        write_json_string(out, macho_filetype_string(ctx->header.filetype));
+        if (ctx->has_uuid) {
+            fputs(",\"uuid\":\"", out);
+            for (int i = 0; i < 16; i++) fprintf(out, "%02X", ctx->uuid[i]);
+            fputc('"', out);
+        }
+        fprintf(out, ",\"slice_size\":%llu,\"segments\":%u,\"sections\":%u",
+                (unsigned long long)ctx->slice_size, ctx->segment_count, ctx->section_count);
+    }
+    
+    if (result->symbols) {
+        fprintf(out, ",\"symbols\":%u,\"functions\":%u", result->symbols->symbol_count, result->symbols->function_count);
+    }
+    if (result->strings) fprintf(out, ",\"strings\":%u", result->strings->count);
+    if (result->disassembly) fprintf(out, ",\"instructions\":%u", result->disassembly->instruction_count);
+    
+    if (result->objc) {
+        fprintf(out, ",\"objc_categories\":%d,\"objc_protocols\":%d,\"objc_classes\":[",
+                result->objc->category_count, result->objc->protocol_count);
+        for (int i = 0; i < result->objc->class_count; i++) {
+            if (i) fputc(',', out);
+            write_json_string(out, result->objc->classes[i].name);
+        }
+        fputc(']', out);
+    }
+    
+    if (result->imports) {
+        fputs(",\"imports\":[", out);
+        for (int i = 0; i < result->imports->import_count; i++) {
+            if (i) fputc(',', out);
+            write_json_string(out, result->imports->imports[i].name);
+        }
+        fputc(']', out);
+    }
+    
+    if (result->exports) {
+        fputs(",\"exports\":[", out);
+        for (int i = 0; i < result->exports->export_count; i++) {
+            if (i) fputc(',', out);
+            write_json_string(out, result->exports->exports[i].name);
+        }
+        fputc(']', out);
+    }
+    
+    fprintf(out, ",\"cache_hit\":%s,\"elapsed_ms\":%.2f}\n", result->cache_hit ? "true" : "false", result->elapsed_ms);
+    
+    bool ok = !ferror(out);
+    fclose(out);
+    return ok;
+}
+
+static bool write_summary(const BatchOptions *options, const BatchStats *stats) {
+    char out_path[4096];
+    snprintf(out_path, sizeof(out_path), "%s/summary.%s", options->output_dir, BATCH_RESULT_EXTENSION);
+    
+    FILE *out = fopen(out_path, "w");
+    if (!out) return false;
+    
+    double seconds = stats->elapsed_seconds > 0 ? stats->elapsed_seconds : 1e-9;
+    fprintf(out, "{\"files\":%u,\"ok\":%u,\"failed\":%u,\"encrypted\":%u,\"cache_hits\":%u,"
+                 "\"bytes\":%llu,\"symbols\":%llu,\"strings\":%llu,\"instructions\":%llu,"
+                 "\"peak_admitted_bytes\":%llu,\"seconds\":%.3f,\"files_per_second\":%.2f,"
+                 "\"mb_per_second\":%.2f,\"instructions_per_second\":%.0f}\n",
+            stats->files_total, stats->files_ok, stats->files_failed, stats->files_encrypted, stats->cache_hits,
+            (unsigned long long)stats->bytes_analyzed, (unsigned long long)stats->symbols,
+            (unsigned long long)stats->strings, (unsigned long long)stats->instructions,
+            (unsigned long long)stats->peak_admitted_bytes, stats->elapsed_seconds,
+            stats->files_total / seconds, stats->bytes_analyzed / seconds / (1024.0 * 1024.0),
+            stats->instructions / seconds);
+    
+    bool ok = !ferror(out);
+    fclose(out);
+    return ok;
+}
+
+#pragma mark - Worker Pool
+
+typedef struct {
+    const char *const *paths;
+    uint32_t count;
+    const BatchOptions *options;
+    AdmissionGate gate;
+    atomic_uint next;
+    
+    atomic_uint files_ok;
+    atomic_uint files_failed;
+    atomic_uint files_encrypted;
+    atomic_uint cache_hits;
+    atomic_uint_fast64_t bytes_analyzed;
+    atomic_uint_fast64_t symbols;
+    atomic_uint_fast64_t strings;
+    atomic_uint_fast64_t instructions;
+} BatchRun;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void analyze_one(BatchRun *run, uint32_t index) {
+    const BatchOptions *options = run->options;
+    double start = now_seconds();
+    
+    BatchFileResult result;
+    memset(&result, 0, sizeof(result));
+    result.path = run->paths[index];
+    result.status = "ok";
+    
+    char error_msg[256] = { 0 };
+    AnalysisSession *session = session_open(result.path, NULL, error_msg);
+    if (!session) {
+        result.status = "failed";
+        result.error = error_msg[0] ? error_msg : "Failed to open file";
+        write_result(options, index, &result);
+        atomic_fetch_add(&run->files_failed, 1);
+        return;
+    }
+    
+    result.macho_ctx = session_macho_context(session);
+    
+    if (result.macho_ctx->is_encrypted) {
+        result.status = "encrypted";
+        result.elapsed_ms = (now_seconds() - start) * 1000.0;
+        write_result(options, index, &result);
+        atomic_fetch_add(&run->files_encrypted, 1);
+        session_release(session);
+        return;
+    }
+    
+    uint64_t cost = estimate_cost(result.macho_ctx);
+    admission_acquire(&run->gate, cost);
+    
+    if (options->cache_dir) result.cache_hit = session_load_cache(session, options->cache_dir);
+    
+    // Stages run one after another here; the pool parallelizes across binaries
+    result.symbols = session_symbols(session);
+    result.strings = session_strings(session);
+    result.disassembly = session_disassembly(session);
+    result.objc = session_objc_runtime(session);
+    result.imports = session_imports(session);
+    result.exports = session_exports(session);
+    
+    if (options->cache_dir && !result.cache_hit) session_save_cache(session, options->cache_dir);
+    
+    result.elapsed_ms = (now_seconds() - start) * 1000.0;
+    if (!write_result(options, index, &result)) {
+        result.status = "failed";
+        atomic_fetch_add(&run->files_failed, 1);
+    } else {
+        atomic_fetch_add(&run->files_ok, 1);
+    }
+    
+    if (result.cache_hit) atomic_fetch_add(&run->cache_hits, 1);
+    atomic_fetch_add(&run->bytes_analyzed, result.macho_ctx->slice_size);
+    if (result.symbols) atomic_fetch_add(&run->symbols, result.symbols->symbol_count);
+    if (result.strings) atomic_fetch_add(&run->strings, result.strings->count);
+    if (result.disassembly) atomic_fetch_add(&run->instructions, result.disassembly->instruction_count);
+    
+    if (options->verbose) {
+        fprintf(stderr, "[Batch] %u/%u %s (%.1f ms%s)\n", index + 1, run->count, result.path,
+                result.elapsed_ms, result.cache_hit ? ", cached" : "");
+    }
+    
+    // Release the stage results before handing the budget to the next binary
+    session_release(session);
+    admission_release(&run->gate, cost);
+}
+
+static void* batch_worker(void *arg) {
+    BatchRun *run = (BatchRun*)arg;
+    
+    for (;;) {
+        uint32_t index = atomic_fetch_add(&run->next, 1);
+        if (index >= run->count) break;
+        analyze_one(run, index);
+    }
+    
+    return NULL;
+}
+
+bool batch_run(const char *const *paths, uint32_t count, const BatchOptions *options, BatchStats *stats) {
+    if (!paths || !options || !options->output_dir) return false;
+    
+    if (mkdir(options->output_dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "[Batch] Cannot create %s: %s\n", options->output_dir, strerror(errno));
+        return false;
+    }
+    
+    BatchRun run;
+    memset(&run, 0, sizeof(run));
+    run.paths = paths;
+    run.count = count;
+    run.options = options;
+    run.gate.budget = options->memory_budget ? options->memory_budget : BATCH_DEFAULT_MEMORY_BUDGET;
+    pthread_mutex_init(&run.gate.lock, NULL);
+    pthread_cond_init(&run.gate.released, NULL);
+    atomic_init(&run.next, 0);
+    
+    uint32_t worker_count = options->worker_count;
+    if (worker_count == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        worker_count = (uint32_t)(cpus > 0 ? cpus : 1);
+    }
+    if (worker_count > BATCH_MAX_WORKERS) worker_count = BATCH_MAX_WORKERS;
+    if (worker_count > count) worker_count = count ? count : 1;
+    
+    double start = now_seconds();
+    
+    pthread_t workers[BATCH_MAX_WORKERS];
+    uint32_t started = 0;
+    for (uint32_t i = 1; i < worker_count; i++) {
+        if (pthread_create(&workers[started], NULL, batch_worker, &run) == 0) {
+            started++;
+        }
+    }
+    
+    batch_worker(&run);
+    
+    for (uint32_t i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    
+    BatchStats local;
+    BatchStats *out = stats ? stats : &local;
+    memset(out, 0, sizeof(BatchStats));
+    out->files_total = count;
+    out->files_ok = atomic_load(&run.files_ok);
+    out->files_failed = atomic_load(&run.files_failed);
+    out->files_encrypted = atomic_load(&run.files_encrypted);
+    out->cache_hits = atomic_load(&run.cache_hits);
+    out->bytes_analyzed = atomic_load(&run.bytes_analyzed);
+    out->symbols = atomic_load(&run.symbols);
+    out->strings = atomic_load(&run.strings);
+    out->instructions = atomic_load(&run.instructions);
+    out->peak_admitted_bytes = run.gate.peak;
+    out->elapsed_seconds = now_seconds() - start;
+    
+    pthread_cond_destroy(&run.gate.released);
+    pthread_mutex_destroy(&run.gate.lock);
+    
+    return write_summary(options, out);
+}
+
+void batch_print_stats(const BatchStats *stats) {
+    if (!stats) return;
+    
+    double seconds = stats->elapsed_seconds > 0 ? stats->elapsed_seconds : 1e-9;
+    fprintf(stderr, "[Batch] %u files: %u ok, %u failed, %u encrypted, %u from cache\n",
+            stats->files_total, stats->files_ok, stats->files_failed, stats->files_encrypted, stats->cache_hits);
+    fprintf(stderr, "[Batch] %.2f s, %.1f files/s, %.1f MB/s, %.0f instructions/s (peak admitted %.1f MB)\n",
+            stats->elapsed_seconds, stats->files_total / seconds,
+            stats->bytes_analyzed / seconds / (1024.0 * 1024.0), stats->instructions / seconds,
+            stats->peak_admitted_bytes / (1024.0 * 1024.0));
+}
@@ -0,0 +1,63 @@
+#ifndef BatchAnalyzer_h
+#define BatchAnalyzer_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "AnalysisSession.h"
+
+#pragma mark - Constants
+
+#define BATCH_DEFAULT_MEMORY_BUDGET (2ULL * 1024 * 1024 * 1024)
+#define BATCH_MAX_WORKERS 64
+#define BATCH_RESULT_EXTENSION "json"
+
+#pragma mark - Structures
+
+typedef struct {
+    const char *output_dir;
+    
+    // NULL disables the persistent analysis cache
+    const char *cache_dir;
+    
+    // 0 uses one worker per online core
+    uint32_t worker_count;
+    
+    // Estimated heap for the binaries in flight; 0 uses the default
+    uint64_t memory_budget;
+    
+    bool verbose;
+} BatchOptions;
+
+typedef struct {
+    uint32_t files_total;
+    uint32_t files_ok;
+    uint32_t files_failed;
+    uint32_t files_encrypted;
+    uint32_t cache_hits;
+    uint64_t bytes_analyzed;
+    uint64_t symbols;
+    uint64_t strings;
+    uint64_t instructions;
+    uint64_t peak_admitted_bytes;
+    double elapsed_seconds;
+} BatchStats;
+
+#pragma mark - Function Declarations
+
+// Recursively lists the Mach-O files (thin or fat) below root, or root itself
+// when it is a file. Symlinks are not followed. Candidates are filtered with
+// macho_quick_scan_batch(), so non-binaries are never opened for analysis.
+uint32_t batch_collect_paths(const char *root, char ***out_paths);
+
+void batch_free_paths(char **paths, uint32_t count);
+
+// Runs the header, symbol, string, disassembly, ObjC and import/export stages
+// for every path on a bounded pool of workers. Each binary is admitted only
+// while the estimated heap of those in flight stays under the memory budget
+// (one binary is always admitted so oversized files still make progress).
+// Writes one compact JSON result per binary to output_dir plus summary.json.
+bool batch_run(const char *const *paths, uint32_t count, const BatchOptions *options, BatchStats *stats);
+
+void batch_print_stats(const BatchStats *stats);
+
+#endif
@@ -0,0 +1,291 @@
+#include "BranchScan.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define BRANCH_SCAN_NEON 1
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define BRANCH_SCAN_AVX2 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define BRANCH_SCAN_SSE2 1
+#endif
+
+// Words matched per step; each lane sets one bit of the block mask
+#define BRANCH_SCAN_BLOCK 16
+
+// A word is a candidate when it matches one of:
+//   B, BL, CBZ, CBNZ, TBZ, TBNZ    (word & 0x5C000000) == 0x14000000
+//   B.cond                         (word & 0xFF000010) == 0x54000000
+//   RET                            (word & 0xFFFFFC1F) == 0xD65F0000
+//   RETAA, RETAB                   (word | 0x00000400) == 0xD65F0FFF
+#define SCAN_DIRECT_MASK 0x5C000000U
+#define SCAN_DIRECT_VALUE 0x14000000U
+#define SCAN_COND_MASK 0xFF000010U
+#define SCAN_COND_VALUE 0x54000000U
+#define SCAN_RET_MASK 0xFFFFFC1FU
+#define SCAN_RET_VALUE 0xD65F0000U
+#define SCAN_RETA_BIT 0x00000400U
+#define SCAN_RETA_VALUE 0xD65F0FFFU
+
+#pragma mark - Block Masks
+
+#if defined(BRANCH_SCAN_NEON)
+
+static inline uint32_t scan_mask4(const uint8_t *words) {
+    static const uint32_t lane_bits[4] = { 1, 2, 4, 8 };
+    uint32x4_t w = vld1q_u32((const uint32_t*)words);
+    
+    uint32x4_t hit = vceqq_u32(vandq_u32(w, vdupq_n_u32(SCAN_DIRECT_MASK)), vdupq_n_u32(SCAN_DIRECT_VALUE));
+    hit = vorrq_u32(hit, vceqq_u32(vandq_u32(w, vdupq_n_u32(SCAN_COND_MASK)), vdupq_n_u32(SCAN_COND_VALUE)));
+    hit = vorrq_u32(hit, vceqq_u32(vandq_u32(w, vdupq_n_u32(SCAN_RET_MASK)), vdupq_n_u32(SCAN_RET_VALUE)));
+    hit = vorrq_u32(hit, vceqq_u32(vorrq_u32(w, vdupq_n_u32(SCAN_RETA_BIT)), vdupq_n_u32(SCAN_RETA_VALUE)));
+    
+    return vaddvq_u32(vandq_u32(hit, vld1q_u32(lane_bits)));
+}
+
+static uint32_t scan_block_mask(const uint8_t *words) {
+    return scan_mask4(words) | (scan_mask4(words + 16) << 4) |
+           (scan_mask4(words + 32) << 8) | (scan_mask4(words + 48) << 12);
+}
+
+#elif defined(BRANCH_SCAN_AVX2)
+
+static inline uint32_t scan_mask8(const uint8_t *words) {
+    __m256i w = _mm256_loadu_si256((const __m256i*)words);
+    
+    __m256i hit = _mm256_cmpeq_epi32(_mm256_and_si256(w, _mm256_set1_epi32((int)SCAN_DIRECT_MASK)),
+                                     _mm256_set1_epi32((int)SCAN_DIRECT_VALUE));
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi32(_mm256_and_si256(w, _mm256_set1_epi32((int)SCAN_COND_MASK)),
+                                                  _mm256_set1_epi32((int)SCAN_COND_VALUE)));
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi32(_mm256_and_si256(w, _mm256_set1_epi32((int)SCAN_RET_MASK)),
+                                                  _mm256_set1_epi32((int)SCAN_RET_VALUE)));
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi32(_mm256_or_si256(w, _mm256_set1_epi32((int)SCAN_RETA_BIT)),
+                                                  _mm256_set1_epi32((int)SCAN_RETA_VALUE)));
+    
+    return (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(hit));
+}
+
+static uint32_t scan_block_mask(const uint8_t *words) {
+    return scan_mask8(words) | (scan_mask8(words + 32) << 8);
+}
+
+#elif defined(BRANCH_SCAN_SSE2)
+
+static inline uint32_t scan_mask4(const uint8_t *words) {
+    __m128i w = _mm_loadu_si128((const __m128i*)words);
+    
+    __m128i hit = _mm_cmpeq_epi32(_mm_and_si128(w, _mm_set1_epi32((int)SCAN_DIRECT_MASK)),
+                                  _mm_set1_epi32((int)SCAN_DIRECT_VALUE));
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi32(_mm_and_si128(w, _mm_set1_epi32((int)SCAN_COND_MASK)),
+                                            _mm_set1_epi32((int)SCAN_COND_VALUE)));
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi32(_mm_and_si128(w, _mm_set1_epi32((int)SCAN_RET_MASK)),
+                                            _mm_set1_epi32((int)SCAN_RET_VALUE)));
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi32(_mm_or_si128(w, _mm_set1_epi32((int)SCAN_RETA_BIT)),
+                                            _mm_set1_epi32((int)SCAN_RETA_VALUE)));
+    
+    return (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(hit));
+}
+
+static uint32_t scan_block_mask(const uint8_t *words) {
+    return scan_mask4(words) | (scan_mask4(words + 16) << 4) |
+           (scan_mask4(words + 32) << 8) | (scan_mask4(words + 48) << 12);
+}
+
+#else
+
+static inline bool scan_is_candidate(uint32_t word) {
+    return (word & SCAN_DIRECT_MASK) == SCAN_DIRECT_VALUE ||
+           (word & SCAN_COND_MASK) == SCAN_COND_VALUE ||
+           (word & SCAN_RET_MASK) == SCAN_RET_VALUE ||
+           (word | SCAN_RETA_BIT) == SCAN_RETA_VALUE;
+}
+
+static uint32_t scan_block_mask(const uint8_t *words) {
+    uint32_t mask = 0;
+    for (uint32_t lane = 0; lane < BRANCH_SCAN_BLOCK; lane++) {
+        uint32_t word;
+        memcpy(&word, words + lane * 4, sizeof(word));
+        if (scan_is_candidate(word)) mask |= 1U << lane;
+    }
+    return mask;
+}
+
+#endif
+
+const char* branch_scan_implementation(void) {
+#if defined(BRANCH_SCAN_NEON)
+    return "NEON";
+#elif defined(BRANCH_SCAN_AVX2)
+    return "AVX2";
+#elif defined(BRANCH_SCAN_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+#pragma mark - Classification
+
+static inline int64_t scan_sign_extend(uint32_t value, uint32_t bits) {
+    uint32_t shift = 32 - bits;
+    return (int64_t)((int32_t)(value << shift) >> shift);
+}
+
+// Same kinds and displacements as arm64_decode_word(), for the encodings above
+static uint8_t scan_classify(uint32_t word, int64_t *delta) {
+    *delta = 0;
+    
+    if ((word & 0x7C000000) == 0x14000000) {
+        *delta = scan_sign_extend(word & 0x3FFFFFF, 26) * 4;
+        return (word >> 31) ? BRANCH_CALL : BRANCH_UNCONDITIONAL;
+    }
+    if ((word & 0x7E000000) == 0x34000000) {
+        *delta = scan_sign_extend((word >> 5) & 0x7FFFF, 19) * 4;
+        return BRANCH_CONDITIONAL;
+    }
+    if ((word & 0x7E000000) == 0x36000000) {
+        *delta = scan_sign_extend((word >> 5) & 0x3FFF, 14) * 4;
+        return BRANCH_CONDITIONAL;
+    }
+    if ((word & SCAN_COND_MASK) == SCAN_COND_VALUE) {
+        *delta = scan_sign_extend((word >> 5) & 0x7FFFF, 19) * 4;
+        // B.AL and B.NV always branch
+        return ((word & 0xE) == 0xE) ? BRANCH_UNCONDITIONAL : BRANCH_CONDITIONAL;
+    }
+    if ((word & SCAN_RET_MASK) == SCAN_RET_VALUE || (word | SCAN_RETA_BIT) == SCAN_RETA_VALUE) {
+        return BRANCH_RETURN;
+    }
+    
+    return BRANCH_NONE;
+}
+
+#pragma mark - Scanning
+
+static bool scan_reserve(BranchScanResult *result, uint32_t capacity) {
+    uint64_t *pcs = (uint64_t*)realloc(result->pcs, capacity * sizeof(uint64_t));
+    if (!pcs) return false;
+    result->pcs = pcs;
+    
+    uint64_t *targets = (uint64_t*)realloc(result->targets, capacity * sizeof(uint64_t));
+    if (!targets) return false;
+    result->targets = targets;
+    
+    uint8_t *kinds = (uint8_t*)realloc(result->kinds, capacity * sizeof(uint8_t));
+    if (!kinds) return false;
+    result->kinds = kinds;
+    
+    result->capacity = capacity;
+    return true;
+}
+
+static bool scan_push(BranchScanResult *result, uint64_t pc, uint64_t target, uint8_t kind) {
+    if (result->count >= result->capacity && !scan_reserve(result, result->capacity * 2)) return false;
+    
+    result->pcs[result->count] = pc;
+    result->targets[result->count] = target;
+    result->kinds[result->count] = kind;
+    result->count++;
+    
+    return true;
+}
+
+static bool scan_word(BranchScanResult *result, uint32_t word, uint64_t pc) {
+    int64_t delta;
+    uint8_t kind = scan_classify(word, &delta);
+    if (kind == BRANCH_NONE) return true;
+    
+    uint64_t target = (kind == BRANCH_RETURN) ? 0 : pc + (uint64_t)delta;
+    return scan_push(result, pc, target, kind);
+}
+
+// Scans the words of [start_offset, end_offset) of the code
+static bool scan_range(const DisassemblyContext *ctx, BranchScanResult *result, uint64_t start_offset,
+                       uint64_t end_offset, bool swapped) {
+    const uint8_t *code = ctx->code_data + start_offset;
+    uint64_t word_count = (end_offset - start_offset) / 4;
+    uint64_t base = ctx->code_base_addr + start_offset;
+    uint64_t i = 0;
+    
+    // Byte-swapped code is rare enough to be left to the word loop below
+    if (!swapped) {
+        for (; i + BRANCH_SCAN_BLOCK <= word_count; i += BRANCH_SCAN_BLOCK) {
+            uint32_t mask = scan_block_mask(code + i * 4);
+            
+            while (mask) {
+                uint32_t lane = (uint32_t)__builtin_ctz(mask);
+                mask &= mask - 1;
+                
+                uint32_t word;
+                memcpy(&word, code + (i + lane) * 4, sizeof(word));
+                if (!scan_word(result, word, base + (i + lane) * 4)) return false;
+            }
+        }
+    }
+    
+    for (; i < word_count; i++) {
+        uint32_t word;
+        memcpy(&word, code + i * 4, sizeof(word));
+        if (swapped) word = swap_uint32(word);
+        
+        if (!scan_word(result, word, base + i * 4)) return false;
+    }
+    
+    return true;
+}
+
+// Range i of the code: a loaded section, or all of code_data for a context
+// set up by hand. The bytes between sections are not code.
+static bool scan_code_range(const DisassemblyContext *ctx, uint32_t i, uint64_t *out_start, uint64_t *out_end) {
+    uint64_t start = ctx->section_count ? ctx->sections[i].offset : 0;
+    uint64_t end = ctx->section_count ? start + ctx->sections[i].size : ctx->code_size;
+    if (end > ctx->code_size) end = ctx->code_size;
+    
+    *out_start = start;
+    *out_end = end;
+    return start < end;
+}
+
+bool branch_scan_arm64(const DisassemblyContext *ctx, BranchScanResult *result) {
+    if (!result) return false;
+    memset(result, 0, sizeof(BranchScanResult));
+    
+    if (!ctx || !ctx->code_data || ctx->arch != ARCH_ARM64) return false;
+    
+    bool swapped = ctx->macho_ctx && ctx->macho_ctx->header.is_swapped;
+    uint32_t range_count = ctx->section_count ? ctx->section_count : 1;
+    uint64_t start, end;
+    
+    uint64_t word_count = 0;
+    for (uint32_t r = 0; r < range_count; r++) {
+        if (scan_code_range(ctx, r, &start, &end)) word_count += (end - start) / 4;
+    }
+    
+    // Compiled code is about one fifth branches, so this rarely grows
+    if (!scan_reserve(result, (uint32_t)(word_count / 4) + 1024)) {
+        branch_scan_free(result);
+        return false;
+    }
+    
+    for (uint32_t r = 0; r < range_count; r++) {
+        if (!scan_code_range(ctx, r, &start, &end)) continue;
+        
+        if (!scan_range(ctx, result, start, end, swapped)) {
+            branch_scan_free(result);
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+void branch_scan_free(BranchScanResult *result) {
+    if (!result) return;
+    
+    free(result->pcs);
+    free(result->targets);
+    free(result->kinds);
+    memset(result, 0, sizeof(BranchScanResult));
+}
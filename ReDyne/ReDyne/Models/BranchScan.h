@@ -0,0 +1,38 @@
+#ifndef BranchScan_h
+#define BranchScan_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "DisassemblyEngine.h"
+
+#pragma mark - Structures
+
+// Direct branches and returns of a code section as parallel arrays, in
+// address order. Returns have a target of 0.
+typedef struct {
+    uint32_t count;
+    uint32_t capacity;
+    uint64_t *pcs;
+    uint64_t *targets;
+    uint8_t *kinds;     // BranchType
+} BranchScanResult;
+
+#pragma mark - Function Declarations
+
+// Finds B, BL, B.cond, CBZ/CBNZ, TBZ/TBNZ and RET/RETAA/RETAB in the ARM64 code
+// sections of ctx, skipping the padding between them, without decoding the
+// other words: 16 words at a time are matched against the encodings with
+// vector mask/compare (NEON, AVX2 or SSE2, as the target allows) and only the
+// matching ones are looked at individually. Kinds
+// and targets agree with arm64_decode_word(). The context needs its code
+// loaded but no rows. Returns false on allocation failure or non-ARM64 code.
+// A linear sweep: branches in unreachable code and literal pools are found
+// too, which is why function discovery descends instead of seeding from it.
+bool branch_scan_arm64(const DisassemblyContext *ctx, BranchScanResult *result);
+
+void branch_scan_free(BranchScanResult *result);
+
+// "NEON", "AVX2", "SSE2" or "scalar"
+const char* branch_scan_implementation(void);
+
+#endif
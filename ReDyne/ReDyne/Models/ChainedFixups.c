@@ -0,0 +1,528 @@
+#include "ChainedFixups.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <mach-o/fixup-chains.h>
+
+#pragma mark - Page Jobs
+
+typedef struct {
+    uint64_t page_offset;
+    uint64_t first_slot;
+    uint64_t page_end;
+    uint64_t seg_fileoff;
+    uint64_t seg_vmaddr;
+    uint16_t pointer_format;
+    
+    ChainedFixup *fixups;
+    uint32_t count;
+} ChainPageJob;
+
+typedef struct {
+    const MachOContext *ctx;
+    ChainPageJob *jobs;
+    uint32_t job_count;
+    uint32_t max_slots;
+    uint64_t preferred_load_address;
+    atomic_uint next;
+} ChainWalkBatch;
+
+static bool is_supported_format(uint16_t format) {
+    switch (format) {
+        case DYLD_CHAINED_PTR_ARM64E:
+        case DYLD_CHAINED_PTR_64:
+        case DYLD_CHAINED_PTR_64_OFFSET:
+        case DYLD_CHAINED_PTR_ARM64E_USERLAND:
+        case DYLD_CHAINED_PTR_ARM64E_USERLAND24:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static inline bool is_arm64e_format(uint16_t format) {
+    return format == DYLD_CHAINED_PTR_ARM64E ||
+           format == DYLD_CHAINED_PTR_ARM64E_USERLAND ||
+           format == DYLD_CHAINED_PTR_ARM64E_USERLAND24;
+}
+
+static inline uint32_t pointer_stride(uint16_t format) {
+    return is_arm64e_format(format) ? 8 : 4;
+}
+
+#pragma mark - Batch Decoding
+
+// Decoding is split from walking so each pass is a straight loop over one
+// pointer format with no chain dependency between iterations.
+static void decode_arm64e_batch(const uint64_t *raw, const uint64_t *offsets, uint32_t count,
+                                const ChainPageJob *job, uint64_t base, ChainedFixup *out) {
+    bool target_is_offset = (job->pointer_format != DYLD_CHAINED_PTR_ARM64E);
+    uint64_t ordinal_mask = (job->pointer_format == DYLD_CHAINED_PTR_ARM64E_USERLAND24) ? 0xFFFFFF : 0xFFFF;
+    
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t value = raw[i];
+        bool is_bind = (value >> 62) & 1;
+        bool is_auth = (value >> 63) & 1;
+        ChainedFixup *f = &out[i];
+        
+        f->offset = offsets[i];
+        f->address = job->seg_vmaddr + (offsets[i] - job->seg_fileoff);
+        f->pointer_format = job->pointer_format;
+        f->kind = is_bind ? CHAINED_FIXUP_BIND : CHAINED_FIXUP_REBASE;
+        f->is_auth = is_auth;
+        f->diversity = is_auth ? (uint16_t)((value >> 32) & 0xFFFF) : 0;
+        f->addr_div = is_auth ? ((value >> 48) & 1) : false;
+        f->key = is_auth ? (uint8_t)((value >> 49) & 0x3) : 0;
+        
+        if (is_bind) {
+            f->ordinal = (uint32_t)(value & ordinal_mask);
+            f->target = 0;
+            if (is_auth) {
+                f->addend = 0;
+            } else {
+                int64_t addend = (int64_t)((value >> 32) & 0x7FFFF);
+                if (addend & 0x40000) addend |= ~0x7FFFFLL;
+                f->addend = addend;
+            }
+        } else if (is_auth) {
+            f->ordinal = 0;
+            f->addend = 0;
+            f->target = base + (value & 0xFFFFFFFFULL);
+        } else {
+            uint64_t target = value & 0x7FFFFFFFFFFULL;
+            uint64_t high8 = (value >> 43) & 0xFF;
+            f->ordinal = 0;
+            f->addend = 0;
+            f->target = (high8 << 56) | (target_is_offset ? base + target : target);
+        }
+    }
+}
+
+static void decode_ptr64_batch(const uint64_t *raw, const uint64_t *offsets, uint32_t count,
+                               const ChainPageJob *job, uint64_t base, ChainedFixup *out) {
+    uint64_t target_base = (job->pointer_format == DYLD_CHAINED_PTR_64_OFFSET) ? base : 0;
+    
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t value = raw[i];
+        bool is_bind = (value >> 63) & 1;
+        ChainedFixup *f = &out[i];
+        
+        memset(f, 0, sizeof(ChainedFixup));
+        f->offset = offsets[i];
+        f->address = job->seg_vmaddr + (offsets[i] - job->seg_fileoff);
+        f->pointer_format = job->pointer_format;
+        f->kind = is_bind ? CHAINED_FIXUP_BIND : CHAINED_FIXUP_REBASE;
+        
+        if (is_bind) {
+            f->ordinal = (uint32_t)(value & 0xFFFFFF);
+            f->addend = (int64_t)((value >> 24) & 0xFF);
+        } else {
+            uint64_t target = value & 0xFFFFFFFFFULL;
+            uint64_t high8 = (value >> 36) & 0xFF;
+            f->target = (high8 << 56) | (target_base + target);
+        }
+    }
+}
+
+#pragma mark - Page Walking
+
+static void walk_page(ChainWalkBatch *batch, ChainPageJob *job, uint64_t *raw, uint64_t *offsets) {
+    const MachOContext *ctx = batch->ctx;
+    
+    MachOSpan span = macho_span(ctx, job->page_offset, job->page_end - job->page_offset);
+    if (!span.data) return;
+    
+    uint32_t stride = pointer_stride(job->pointer_format);
+    bool arm64e = is_arm64e_format(job->pointer_format);
+    uint64_t slot = job->first_slot;
+    uint32_t count = 0;
+    
+    // The chain itself is inherently serial: each entry encodes the distance to the next
+    while (slot + 8 <= job->page_end && count < batch->max_slots) {
+        uint64_t value;
+        memcpy(&value, span.data + (slot - job->page_offset), sizeof(value));
+        
+        raw[count] = value;
+        offsets[count] = slot;
+        count++;
+        
+        uint64_t next = arm64e ? ((value >> 51) & 0x7FF) : ((value >> 51) & 0xFFF);
+        if (next == 0) break;
+        slot += next * stride;
+    }
+    
+    if (count == 0) return;
+    
+    job->fixups = (ChainedFixup*)malloc(count * sizeof(ChainedFixup));
+    if (!job->fixups) return;
+    
+    if (arm64e) {
+        decode_arm64e_batch(raw, offsets, count, job, batch->preferred_load_address, job->fixups);
+    } else {
+        decode_ptr64_batch(raw, offsets, count, job, batch->preferred_load_address, job->fixups);
+    }
+    job->count = count;
+}
+
+static void* chain_walk_worker(void *arg) {
+    ChainWalkBatch *batch = (ChainWalkBatch*)arg;
+    
+    uint64_t *raw = (uint64_t*)malloc(batch->max_slots * sizeof(uint64_t));
+    uint64_t *offsets = (uint64_t*)malloc(batch->max_slots * sizeof(uint64_t));
+    
+    if (raw && offsets) {
+        for (;;) {
+            uint32_t i = atomic_fetch_add(&batch->next, 1);
+            if (i >= batch->job_count) break;
+            walk_page(batch, &batch->jobs[i], raw, offsets);
+        }
+    }
+    
+    free(raw);
+    free(offsets);
+    return NULL;
+}
+
+static void run_chain_walk(ChainWalkBatch *batch) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t worker_count = (uint32_t)(cpus > 0 ? cpus : 1);
+    
+    // Small binaries have a handful of pages; threads would cost more than the walk
+    uint32_t useful = (batch->job_count + 31) / 32;
+    if (worker_count > useful) worker_count = useful;
+    if (worker_count > CHAINED_FIXUPS_MAX_WORKERS) worker_count = CHAINED_FIXUPS_MAX_WORKERS;
+    
+    pthread_t workers[CHAINED_FIXUPS_MAX_WORKERS];
+    uint32_t started = 0;
+    for (uint32_t i = 1; i < worker_count; i++) {
+        if (pthread_create(&workers[started], NULL, chain_walk_worker, batch) == 0) {
+            started++;
+        }
+    }
+    
+    chain_walk_worker(batch);
+    
+    for (uint32_t i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+}
+
+#pragma mark - Parsing
+
+static uint64_t find_preferred_load_address(const MachOContext *ctx) {
+    for (uint32_t i = 0; i < ctx->segment_count; i++) {
+        if (strncmp(ctx->segments[i].segname, "__TEXT", 16) == 0) {
+            return ctx->segments[i].vmaddr;
+        }
+    }
+    for (uint32_t i = 0; i < ctx->segment_count; i++) {
+        if (ctx->segments[i].fileoff == 0 && ctx->segments[i].filesize > 0) {
+            return ctx->segments[i].vmaddr;
+        }
+    }
+    return 0;
+}
+
+static inline uint32_t blob_u32(const uint8_t *blob, uint32_t offset) {
+    uint32_t v;
+    memcpy(&v, blob + offset, sizeof(v));
+    return v;
+}
+
+static inline uint64_t blob_u64(const uint8_t *blob, uint32_t offset) {
+    uint64_t v;
+    memcpy(&v, blob + offset, sizeof(v));
+    return v;
+}
+
+static inline uint16_t blob_u16(const uint8_t *blob, uint32_t offset) {
+    uint16_t v;
+    memcpy(&v, blob + offset, sizeof(v));
+    return v;
+}
+
+static void parse_imports(ChainedFixupsInfo *info, const uint8_t *blob, uint32_t blob_size,
+                          const struct dyld_chained_fixups_header *header) {
+    uint32_t entry_size;
+    switch (header->imports_format) {
+        case DYLD_CHAINED_IMPORT:           entry_size = 4; break;
+        case DYLD_CHAINED_IMPORT_ADDEND:    entry_size = 8; break;
+        case DYLD_CHAINED_IMPORT_ADDEND64:  entry_size = 16; break;
+        default: return;
+    }
+    
+    if (header->symbols_format != 0) return;
+    if (header->imports_offset > blob_size || header->symbols_offset > blob_size) return;
+    if (header->imports_count > (blob_size - header->imports_offset) / entry_size) return;
+    
+    uint32_t pool_size = blob_size - header->symbols_offset;
+    info->symbol_pool = (char*)malloc(pool_size + 1);
+    if (!info->symbol_pool) return;
+    memcpy(info->symbol_pool, blob + header->symbols_offset, pool_size);
+    info->symbol_pool[pool_size] = '\0';
+    
+    info->imports = (ChainedImport*)calloc(header->imports_count ? header->imports_count : 1, sizeof(ChainedImport));
+    if (!info->imports) return;
+    
+    for (uint32_t i = 0; i < header->imports_count; i++) {
+        uint32_t entry = header->imports_offset + i * entry_size;
+        ChainedImport *imp = &info->imports[i];
+        uint32_t name_offset;
+        
+        if (header->imports_format == DYLD_CHAINED_IMPORT_ADDEND64) {
+            uint64_t raw = blob_u64(blob, entry);
+            uint16_t ordinal = (uint16_t)(raw & 0xFFFF);
+            imp->library_ordinal = (ordinal >= 0xFFF0) ? (int16_t)ordinal : ordinal;
+            imp->is_weak = (raw >> 16) & 1;
+            name_offset = (uint32_t)(raw >> 32);
+            imp->addend = (int64_t)blob_u64(blob, entry + 8);
+        } else {
+            uint32_t raw = blob_u32(blob, entry);
+            uint8_t ordinal = (uint8_t)(raw & 0xFF);
+            imp->library_ordinal = (ordinal >= 0xF0) ? (int8_t)ordinal : ordinal;
+            imp->is_weak = (raw >> 8) & 1;
+            name_offset = raw >> 9;
+            imp->addend = (header->imports_format == DYLD_CHAINED_IMPORT_ADDEND) ? (int32_t)blob_u32(blob, entry + 4) : 0;
+        }
+        
+        imp->name = (name_offset < pool_size) ? info->symbol_pool + name_offset : "";
+    }
+    
+    info->import_count = header->imports_count;
+    info->imports_format = header->imports_format;
+}
+
+static uint32_t collect_page_jobs(const MachOContext *ctx, const uint8_t *blob, uint32_t blob_size,
+                                  uint32_t starts_offset, ChainPageJob **out_jobs,
+                                  uint32_t *out_max_slots, uint16_t *out_format) {
+    *out_jobs = NULL;
+    if (starts_offset + sizeof(uint32_t) > blob_size) return 0;
+    
+    uint32_t seg_count = blob_u32(blob, starts_offset);
+    if (seg_count > ctx->segment_count) seg_count = ctx->segment_count;
+    if (seg_count > (blob_size - starts_offset - sizeof(uint32_t)) / sizeof(uint32_t)) return 0;
+    
+    // Count pages first so the job table is a single allocation
+    uint32_t total_pages = 0;
+    for (uint32_t s = 0; s < seg_count; s++) {
+        uint32_t seg_info = blob_u32(blob, starts_offset + 4 + s * 4);
+        if (seg_info == 0) continue;
+        
+        uint32_t base = starts_offset + seg_info;
+        if (base + offsetof(struct dyld_chained_starts_in_segment, page_start) > blob_size) continue;
+        total_pages += blob_u16(blob, base + offsetof(struct dyld_chained_starts_in_segment, page_count));
+    }
+    if (total_pages == 0) return 0;
+    
+    ChainPageJob *jobs = (ChainPageJob*)calloc(total_pages, sizeof(ChainPageJob));
+    if (!jobs) return 0;
+    
+    uint32_t job_count = 0;
+    uint32_t max_slots = 0;
+    for (uint32_t s = 0; s < seg_count; s++) {
+        uint32_t seg_info = blob_u32(blob, starts_offset + 4 + s * 4);
+        if (seg_info == 0) continue;
+        
+        uint32_t base = starts_offset + seg_info;
+        uint32_t page_start_off = base + offsetof(struct dyld_chained_starts_in_segment, page_start);
+        if (page_start_off > blob_size) continue;
+        
+        uint16_t page_size = blob_u16(blob, base + offsetof(struct dyld_chained_starts_in_segment, page_size));
+        uint16_t format = blob_u16(blob, base + offsetof(struct dyld_chained_starts_in_segment, pointer_format));
+        uint16_t page_count = blob_u16(blob, base + offsetof(struct dyld_chained_starts_in_segment, page_count));
+        
+        if (page_size == 0 || !is_supported_format(format)) continue;
+        if (page_start_off + (uint64_t)page_count * sizeof(uint16_t) > blob_size) continue;
+        if (*out_format == 0) *out_format = format;
+        
+        const SegmentInfo *seg = &ctx->segments[s];
+        uint64_t seg_end = seg->fileoff + seg->filesize;
+        
+        uint32_t slots = page_size / pointer_stride(format) + 1;
+        if (slots > max_slots) max_slots = slots;
+        
+        for (uint16_t p = 0; p < page_count; p++) {
+            uint16_t start = blob_u16(blob, page_start_off + p * sizeof(uint16_t));
+            if (start == DYLD_CHAINED_PTR_START_NONE) continue;
+            // Multi-start pages only occur in 32-bit formats, which are not decoded here
+            if (start & DYLD_CHAINED_PTR_START_MULTI) continue;
+            
+            uint64_t page_offset = seg->fileoff + (uint64_t)p * page_size;
+            if (page_offset >= seg_end) break;
+            
+            ChainPageJob *job = &jobs[job_count++];
+            job->page_offset = page_offset;
+            job->first_slot = page_offset + start;
+            job->page_end = page_offset + page_size < seg_end ? page_offset + page_size : seg_end;
+            job->seg_fileoff = seg->fileoff;
+            job->seg_vmaddr = seg->vmaddr;
+            job->pointer_format = format;
+        }
+    }
+    
+    *out_jobs = jobs;
+    *out_max_slots = max_slots;
+    return job_count;
+}
+
+static int compare_fixups(const void *a, const void *b) {
+    uint64_t oa = ((const ChainedFixup*)a)->offset;
+    uint64_t ob = ((const ChainedFixup*)b)->offset;
+    return (oa > ob) - (oa < ob);
+}
+
+ChainedFixupsInfo* chained_fixups_parse(const MachOContext *ctx) {
+    if (!ctx || !ctx->has_chained_fixups || ctx->chained_fixups_size == 0) return NULL;
+    if (!ctx->segments || ctx->segment_count == 0) return NULL;
+    
+    uint32_t blob_size = ctx->chained_fixups_size;
+    const uint8_t *blob = (const uint8_t*)macho_data_at(ctx, ctx->chained_fixups_off, blob_size);
+    if (!blob || blob_size < sizeof(struct dyld_chained_fixups_header)) return NULL;
+    
+    struct dyld_chained_fixups_header header;
+    memcpy(&header, blob, sizeof(header));
+    if (header.fixups_version != 0) return NULL;
+    
+    ChainedFixupsInfo *info = (ChainedFixupsInfo*)calloc(1, sizeof(ChainedFixupsInfo));
+    if (!info) return NULL;
+    
+    info->preferred_load_address = find_preferred_load_address(ctx);
+    parse_imports(info, blob, blob_size, &header);
+    
+    ChainPageJob *jobs = NULL;
+    uint32_t max_slots = 0;
+    uint32_t job_count = collect_page_jobs(ctx, blob, blob_size, header.starts_offset,
+                                           &jobs, &max_slots, &info->pointer_format);
+    
+    if (job_count > 0) {
+        ChainWalkBatch batch;
+        batch.ctx = ctx;
+        batch.jobs = jobs;
+        batch.job_count = job_count;
+        batch.max_slots = max_slots;
+        batch.preferred_load_address = info->preferred_load_address;
+        atomic_init(&batch.next, 0);
+        
+        run_chain_walk(&batch);
+        
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < job_count; i++) total += jobs[i].count;
+        
+        if (total > 0 && total <= UINT32_MAX) {
+            info->fixups = (ChainedFixup*)malloc(total * sizeof(ChainedFixup));
+        }
+        
+        if (info->fixups) {
+            uint32_t n = 0;
+            bool sorted = true;
+            for (uint32_t i = 0; i < job_count; i++) {
+                if (jobs[i].count == 0) continue;
+                if (n > 0 && jobs[i].fixups[0].offset < info->fixups[n - 1].offset) sorted = false;
+                memcpy(&info->fixups[n], jobs[i].fixups, jobs[i].count * sizeof(ChainedFixup));
+                n += jobs[i].count;
+            }
+            info->fixup_count = n;
+            
+            // Segments are normally listed in file order, so this rarely runs
+            if (!sorted) qsort(info->fixups, n, sizeof(ChainedFixup), compare_fixups);
+        }
+        
+        for (uint32_t i = 0; i < job_count; i++) free(jobs[i].fixups);
+    }
+    free(jobs);
+    
+    printf("[ChainedFixups] %u fixups, %u imports (pointer format %u)\n",
+           info->fixup_count, info->import_count, info->pointer_format);
+    
+    return info;
+}
+
+bool macho_resolve_chained_fixups(MachOContext *ctx) {
+    if (!ctx) return false;
+    if (!ctx->has_chained_fixups || ctx->chained_fixups) return true;
+    
+    if (!ctx->segments) macho_extract_segments(ctx);
+    ctx->chained_fixups = chained_fixups_parse(ctx);
+    
+    return ctx->chained_fixups != NULL;
+}
+
+#pragma mark - Lookup
+
+static uint32_t lower_bound(const ChainedFixupsInfo *info, uint64_t offset) {
+    uint32_t lo = 0;
+    uint32_t hi = info->fixup_count;
+    
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (info->fixups[mid].offset < offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    
+    return lo;
+}
+
+const ChainedFixup* chained_fixups_find(const ChainedFixupsInfo *info, uint64_t offset) {
+    if (!info || !info->fixups) return NULL;
+    
+    uint32_t i = lower_bound(info, offset);
+    if (i < info->fixup_count && info->fixups[i].offset == offset) {
+        return &info->fixups[i];
+    }
+    
+    return NULL;
+}
+
+const char* chained_fixups_import_name(const ChainedFixupsInfo *info, uint32_t ordinal) {
+    if (!info || !info->imports || ordinal >= info->import_count) return NULL;
+    return info->imports[ordinal].name;
+}
+
+void chained_fixups_free(ChainedFixupsInfo *info) {
+    if (!info) return;
+    
+    free(info->fixups);
+    free(info->imports);
+    free(info->symbol_pool);
+    free(info);
+}
+
+#pragma mark - Resolved Reads
+
+static inline uint64_t resolved_value(const ChainedFixup *fixup) {
+    return fixup->kind == CHAINED_FIXUP_REBASE ? fixup->target : 0;
+}
+
+uint64_t macho_read_pointer(const MachOContext *ctx, uint64_t offset) {
+    if (!ctx) return 0;
+    
+    const ChainedFixup *fixup = chained_fixups_find(ctx->chained_fixups, offset);
+    if (fixup) return resolved_value(fixup);
+    
+    return macho_read_uint64(ctx, offset);
+}
+
+bool macho_read_resolved(const MachOContext *ctx, uint64_t offset, void *out, size_t size) {
+    if (!macho_read(ctx, offset, out, size)) return false;
+    
+    const ChainedFixupsInfo *info = ctx->chained_fixups;
+    if (!info || !info->fixups) return true;
+    
+    uint64_t end = offset + size;
+    for (uint32_t i = lower_bound(info, offset); i < info->fixup_count; i++) {
+        const ChainedFixup *fixup = &info->fixups[i];
+        if (fixup->offset + sizeof(uint64_t) > end) break;
+        if ((fixup->offset - offset) % sizeof(uint64_t) != 0) continue;
+        
+        uint64_t value = resolved_value(fixup);
+        memcpy((uint8_t*)out + (fixup->offset - offset), &value, sizeof(value));
+    }
+    
+    return true;
+}
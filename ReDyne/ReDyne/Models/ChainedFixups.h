@@ -0,0 +1,84 @@
+#ifndef ChainedFixups_h
+#define ChainedFixups_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "MachOHeader.h"
+
+#pragma mark - Constants
+
+#define CHAINED_FIXUPS_MAX_WORKERS 16
+
+#pragma mark - Structures
+
+typedef enum {
+    CHAINED_FIXUP_REBASE = 0,
+    CHAINED_FIXUP_BIND = 1
+} ChainedFixupKind;
+
+typedef struct {
+    uint64_t offset;
+    uint64_t address;
+    uint64_t target;
+    int64_t addend;
+    uint32_t ordinal;
+    uint16_t pointer_format;
+    uint16_t diversity;
+    uint8_t kind;
+    uint8_t key;
+    bool is_auth;
+    bool addr_div;
+} ChainedFixup;
+
+typedef struct {
+    const char *name;
+    int32_t library_ordinal;
+    int64_t addend;
+    bool is_weak;
+} ChainedImport;
+
+struct ChainedFixupsInfo {
+    // Sorted by offset; offsets are slice-relative file offsets of the pointer slots
+    ChainedFixup *fixups;
+    uint32_t fixup_count;
+    
+    ChainedImport *imports;
+    uint32_t import_count;
+    char *symbol_pool;
+    
+    uint32_t imports_format;
+    uint16_t pointer_format;
+    uint64_t preferred_load_address;
+};
+
+#pragma mark - Function Declarations
+
+// Walks every page chain described by LC_DYLD_CHAINED_FIXUPS and decodes each
+// slot into a ChainedFixup. Pages are walked concurrently. Returns NULL when the
+// binary has no chained fixups or none of its pointer formats are supported.
+ChainedFixupsInfo* chained_fixups_parse(const MachOContext *ctx);
+
+// Parses the chained fixups once and attaches the map to ctx->chained_fixups, so
+// macho_read_pointer() and macho_read_resolved() see rebased targets instead of
+// raw chain entries. Call before the context is shared between threads.
+bool macho_resolve_chained_fixups(MachOContext *ctx);
+
+const ChainedFixup* chained_fixups_find(const ChainedFixupsInfo *info, uint64_t offset);
+
+const char* chained_fixups_import_name(const ChainedFixupsInfo *info, uint32_t ordinal);
+
+void chained_fixups_free(ChainedFixupsInfo *info);
+
+#pragma mark - Resolved Reads
+
+// Reads the 64-bit pointer at offset. Rebase slots yield their target address,
+// bind slots yield 0 (the value is only known at load time), and anything else
+// is returned as stored in the file.
+uint64_t macho_read_pointer(const MachOContext *ctx, uint64_t offset);
+
+// macho_read() that also rewrites every 8-byte-aligned fixup slot inside the
+// copied range, for reading structures whose pointer fields are chained.
+bool macho_read_resolved(const MachOContext *ctx, uint64_t offset, void *out, size_t size);
+
+#endif
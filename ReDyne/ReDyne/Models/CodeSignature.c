@@ -7,39 +7,23 @@
 
 // MARK: - Helper Functions
 
-static uint32_t find_code_signature_offset(MachOContext *ctx, uint32_t *size) {
-    if (!ctx) return 0;
+static uint32_t find_code_signature_offset(const MachOContext *ctx, uint32_t *size) {
+    if (!ctx || !ctx->load_commands) return 0;
     
-    uint32_t header_size = ctx->header.is_64bit ? sizeof(struct mach_header_64) : sizeof(struct mach_header);
-    fseek(ctx->file, header_size, SEEK_SET);
-    
-    for (uint32_t i = 0; i < ctx->header.ncmds; i++) {
-        uint32_t cmd, cmdsize;
-        long cmd_start = ftell(ctx->file);
+    for (uint32_t i = 0; i < ctx->load_command_count; i++) {
+        if (ctx->load_commands[i].cmd != LC_CODE_SIGNATURE) continue;
+        if (ctx->load_commands[i].cmdsize < sizeof(struct linkedit_data_command)) return 0;
         
-        fread(&cmd, sizeof(uint32_t), 1, ctx->file);
-        fread(&cmdsize, sizeof(uint32_t), 1, ctx->file);
+        struct linkedit_data_command sig_cmd;
+        memcpy(&sig_cmd, ctx->load_commands[i].data, sizeof(struct linkedit_data_command));
         
         if (ctx->header.is_swapped) {
-            cmd = __builtin_bswap32(cmd);
-            cmdsize = __builtin_bswap32(cmdsize);
-        }
-        
-        if (cmd == LC_CODE_SIGNATURE) {
-            struct linkedit_data_command sig_cmd;
-            fseek(ctx->file, cmd_start, SEEK_SET);
-            fread(&sig_cmd, sizeof(struct linkedit_data_command), 1, ctx->file);
-            
-            if (ctx->header.is_swapped) {
-                *size = __builtin_bswap32(sig_cmd.datasize);
-                return __builtin_bswap32(sig_cmd.dataoff);
-            } else {
-                *size = sig_cmd.datasize;
-                return sig_cmd.dataoff;
-            }
+            *size = __builtin_bswap32(sig_cmd.datasize);
+            return __builtin_bswap32(sig_cmd.dataoff);
+        } else {
+            *size = sig_cmd.datasize;
+            return sig_cmd.dataoff;
         }
-        
-        fseek(ctx->file, cmd_start + cmdsize, SEEK_SET);
     }
     
     return 0;
@@ -47,12 +31,12 @@ static uint32_t find_code_signature_offset(MachOContext *ctx, uint32_t *size) {
 
 // MARK: - Public Functions
 
-bool codesign_is_signed(MachOContext *ctx) {
+bool codesign_is_signed(const MachOContext *ctx) {
     uint32_t size = 0;
     return find_code_signature_offset(ctx, &size) != 0;
 }
 
-CodeSignatureInfo* codesign_parse_signature(MachOContext *ctx) {
+CodeSignatureInfo* codesign_parse_signature(const MachOContext *ctx) {
     if (!ctx) return NULL;
     
     printf("Parsing code signature...\n");
@@ -73,28 +57,19 @@ CodeSignatureInfo* codesign_parse_signature(MachOContext *ctx) {
     info->signature_size = sig_size;
     info->is_adhoc_signed = (sig_size < 4096);
     
-    fseek(ctx->file, sig_offset, SEEK_SET);
-    
-    uint8_t *sig_data = (uint8_t*)malloc(sig_size);
+    const uint8_t *sig_data = macho_data_at(ctx, sig_offset, sig_size);
     if (!sig_data) {
-        printf("   Memory allocation failed\n");
-        return info;
-    }
-    
-    if (fread(sig_data, 1, sig_size, ctx->file) != sig_size) {
-        free(sig_data);
         printf("   Failed to read signature data\n");
         return info;
     }
     
     if (sig_size < 12) {
-        free(sig_data);
         return info;
     }
     
-    uint32_t super_magic = *(uint32_t*)sig_data;
-    uint32_t super_length = *(uint32_t*)(sig_data + 4);
-    uint32_t blob_count = *(uint32_t*)(sig_data + 8);
+    uint32_t super_magic = *(const uint32_t*)sig_data;
+    uint32_t super_length = *(const uint32_t*)(sig_data + 4);
+    uint32_t blob_count = *(const uint32_t*)(sig_data + 8);
     
     if (super_magic == 0xc00cfade) {
     } else if (super_magic == 0xfade0cc0) {
@@ -108,7 +83,6 @@ CodeSignatureInfo* codesign_parse_signature(MachOContext *ctx) {
             blob_count = __builtin_bswap32(blob_count);
             printf("   Trying big-endian interpretation: length=0x%x, count=%u\n", super_length, blob_count);
         } else {
-            free(sig_data);
             printf("   Unknown SuperBlob magic: 0x%08x - signature may be in an unsupported format\n", super_magic);
             info->is_signed = false;
             return info;
@@ -121,7 +95,7 @@ CodeSignatureInfo* codesign_parse_signature(MachOContext *ctx) {
     if (blob_count > 100 || blob_count == 0) {
         printf("   Blob count %u seems unreasonable, signature may be corrupted or unsupported format\n", blob_count);
         if (sig_size > 0x8c) {
-            uint32_t first_blob_offset = *(uint32_t*)(sig_data + 16);
+            uint32_t first_blob_offset = *(const uint32_t*)(sig_data + 16);
             if (super_magic == 0xc00cdefa) {
                 first_blob_offset = __builtin_bswap32(first_blob_offset);
             }
@@ -139,8 +113,8 @@ CodeSignatureInfo* codesign_parse_signature(MachOContext *ctx) {
     for (uint32_t i = 0; i < blob_count && i < 50; i++) {
         if (index_offset + 8 > sig_size) break;
 
-        uint32_t blob_type = *(uint32_t*)(sig_data + index_offset);
-        uint32_t blob_offset = *(uint32_t*)(sig_data + index_offset + 4);
+        uint32_t blob_type = *(const uint32_t*)(sig_data + index_offset);
+        uint32_t blob_offset = *(const uint32_t*)(sig_data + index_offset + 4);
 
         if (super_magic != 0xc00cfade) {
             blob_type = __builtin_bswap32(blob_type);
@@ -154,15 +128,15 @@ CodeSignatureInfo* codesign_parse_signature(MachOContext *ctx) {
             continue;
         }
 
-        uint8_t *blob_data = sig_data + blob_offset;
-        uint32_t blob_magic = *(uint32_t*)blob_data;
+        const uint8_t *blob_data = sig_data + blob_offset;
+        uint32_t blob_magic = *(const uint32_t*)blob_data;
         
         if (blob_type == 5 || blob_magic == 0x71177ade || blob_magic == 0xfade7171) {
             info->has_entitlements = true;
         }
         
         if (blob_type == 0 && blob_offset + 20 < sig_size) {
-            uint32_t ident_offset = *(uint32_t*)(blob_data + 20);
+            uint32_t ident_offset = *(const uint32_t*)(blob_data + 20);
             if (super_magic != 0xc00cfade) {
                 ident_offset = __builtin_bswap32(ident_offset);
             }
@@ -175,8 +149,6 @@ CodeSignatureInfo* codesign_parse_signature(MachOContext *ctx) {
         }
     }
     
-    free(sig_data);
-    
 finish_parsing:
     if (strlen(info->team_id) == 0) {
         strncpy(info->team_id, "(not embedded)", sizeof(info->team_id) - 1);
@@ -191,7 +163,7 @@ finish_parsing:
     return info;
 }
 
-EntitlementsInfo* codesign_parse_entitlements(MachOContext *ctx) {
+EntitlementsInfo* codesign_parse_entitlements(const MachOContext *ctx) {
     if (!ctx) return NULL;
     
     printf("Parsing entitlements...\n");
@@ -211,19 +183,16 @@ EntitlementsInfo* codesign_parse_entitlements(MachOContext *ctx) {
         return info;
     }
     
-    uint8_t *sig_data = (uint8_t*)malloc(sig_size);
-    if (!sig_data) return info;
-    
-    fseek(ctx->file, sig_offset, SEEK_SET);
-    fread(sig_data, 1, sig_size, ctx->file);
+    const uint8_t *sig_data = macho_data_at(ctx, sig_offset, sig_size);
+    if (!sig_data || sig_size < 8) return info;
     
     for (uint32_t i = 0; i < sig_size - 8; i++) {
-        uint32_t magic = __builtin_bswap32(*(uint32_t*)(sig_data + i));
+        uint32_t magic = __builtin_bswap32(*(const uint32_t*)(sig_data + i));
         if (magic == 0xfade7171) {
-            uint32_t length = __builtin_bswap32(*(uint32_t*)(sig_data + i + 4));
+            uint32_t length = __builtin_bswap32(*(const uint32_t*)(sig_data + i + 4));
             
             if (length > 8 && length < sig_size - i) {
-                uint8_t *entitlements_data = sig_data + i + 8;
+                const uint8_t *entitlements_data = sig_data + i + 8;
                 size_t entitlements_len = length - 8;
                 
                 info->entitlements_xml = (char*)malloc(entitlements_len + 1);
@@ -239,8 +208,6 @@ EntitlementsInfo* codesign_parse_entitlements(MachOContext *ctx) {
         }
     }
     
-    free(sig_data);
-    
     if (info->entitlement_count == 0 && !info->entitlements_xml) {
         printf("   No entitlements found\n");
     }
@@ -28,10 +28,10 @@ typedef struct {
 
 // MARK: - Public API
 
-CodeSignatureInfo* codesign_parse_signature(MachOContext *ctx);
-EntitlementsInfo* codesign_parse_entitlements(MachOContext *ctx);
+CodeSignatureInfo* codesign_parse_signature(const MachOContext *ctx);
+EntitlementsInfo* codesign_parse_entitlements(const MachOContext *ctx);
 
-bool codesign_is_signed(MachOContext *ctx);
+bool codesign_is_signed(const MachOContext *ctx);
 void codesign_free_signature(CodeSignatureInfo *info);
 void codesign_free_entitlements(EntitlementsInfo *info);
 
@@ -1,6 +1,9 @@
 #include "ControlFlowGraph.h"
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #pragma mark - String Helpers
 
@@ -17,190 +20,378 @@ const char* cfg_edge_type_string(EdgeType type) {
 
 #pragma mark - Context Management
 
-CFGContext* cfg_create(DisassemblyContext *disasm_ctx) {
+static CFGContext* cfg_create_with_capacity(DisassemblyContext *disasm_ctx, uint32_t block_capacity) {
     if (!disasm_ctx) return NULL;
     
     CFGContext *ctx = (CFGContext*)calloc(1, sizeof(CFGContext));
     if (!ctx) return NULL;
     
     ctx->disasm_ctx = disasm_ctx;
-    ctx->block_capacity = 256;
-    ctx->blocks = (BasicBlock*)calloc(ctx->block_capacity, sizeof(BasicBlock));
+    ctx->entry_block = CFG_NO_BLOCK;
     
-    if (!ctx->blocks) {
-        free(ctx);
-        return NULL;
+    if (block_capacity > 0) {
+        ctx->blocks = (BasicBlock*)calloc(block_capacity, sizeof(BasicBlock));
+        if (!ctx->blocks) {
+            free(ctx);
+            return NULL;
+        }
+        ctx->block_capacity = block_capacity;
     }
     
     return ctx;
 }
 
+CFGContext* cfg_create(DisassemblyContext *disasm_ctx) {
+    return cfg_create_with_capacity(disasm_ctx, 256);
+}
+
 void cfg_free(CFGContext *ctx) {
     if (!ctx) return;
     
-    if (ctx->blocks) {
-        for (uint32_t i = 0; i < ctx->block_count; i++) {
-            if (ctx->blocks[i].successors) free(ctx->blocks[i].successors);
-            if (ctx->blocks[i].successor_edge_types) free(ctx->blocks[i].successor_edge_types);
-            if (ctx->blocks[i].predecessors) free(ctx->blocks[i].predecessors);
-        }
-        free(ctx->blocks);
-    }
-    
-    if (ctx->exit_blocks) free(ctx->exit_blocks);
-    
+    free(ctx->blocks);
+    free(ctx->pending_edges);
+    free(ctx->edge_arena);
+    free(ctx->frontier_offsets);
+    free(ctx->frontier_blocks);
+    free(ctx->loops);
+    free(ctx->loop_bodies);
     free(ctx);
 }
 
 #pragma mark - Basic Block Management
 
-BasicBlock* cfg_add_block(CFGContext *ctx, uint64_t start_addr, uint64_t end_addr) {
-    if (!ctx || start_addr >= end_addr) return NULL;
+// Grows ctx->blocks to hold capacity blocks; builders reserve once up front
+static bool cfg_reserve_blocks(CFGContext *ctx, uint32_t capacity) {
+    if (capacity <= ctx->block_capacity) return true;
+    
+    BasicBlock *blocks = (BasicBlock*)realloc(ctx->blocks, (size_t)capacity * sizeof(BasicBlock));
+    if (!blocks) return false;
+    
+    ctx->blocks = blocks;
+    ctx->block_capacity = capacity;
+    return true;
+}
+
+static bool cfg_reserve_edges(CFGContext *ctx, uint32_t capacity) {
+    if (capacity <= ctx->pending_capacity) return true;
+    
+    CFGPendingEdge *edges = (CFGPendingEdge*)realloc(ctx->pending_edges, (size_t)capacity * sizeof(CFGPendingEdge));
+    if (!edges) return false;
+    
+    ctx->pending_edges = edges;
+    ctx->pending_capacity = capacity;
+    return true;
+}
+
+uint32_t cfg_add_block(CFGContext *ctx, uint64_t start_addr, uint64_t end_addr) {
+    if (!ctx || ctx->frozen || start_addr >= end_addr) return CFG_NO_BLOCK;
+    
+    if (ctx->block_count >= ctx->block_capacity &&
+        !cfg_reserve_blocks(ctx, ctx->block_capacity ? ctx->block_capacity * 2 : 16)) {
+        return CFG_NO_BLOCK;
+    }
     
-    if (ctx->block_count >= ctx->block_capacity) {
-        ctx->block_capacity *= 2;
-        ctx->blocks = (BasicBlock*)realloc(ctx->blocks, ctx->block_capacity * sizeof(BasicBlock));
-        if (!ctx->blocks) return NULL;
+    if (ctx->block_count > 0 && start_addr < ctx->blocks[ctx->block_count - 1].start_address) {
+        ctx->blocks_unsorted = true;
     }
     
-    BasicBlock *block = &ctx->blocks[ctx->block_count++];
+    BasicBlock *block = &ctx->blocks[ctx->block_count];
     memset(block, 0, sizeof(BasicBlock));
     
     block->start_address = start_addr;
     block->end_address = end_addr;
+    block->immediate_dominator = CFG_NO_BLOCK;
+    block->loop = CFG_NO_LOOP;
     
-    return block;
+    return ctx->block_count++;
 }
 
-bool cfg_add_edge(BasicBlock *from, BasicBlock *to, EdgeType edge_type) {
-    if (!from || !to) return false;
+bool cfg_add_edge(CFGContext *ctx, uint32_t from, uint32_t to, EdgeType edge_type) {
+    if (!ctx || ctx->frozen || from >= ctx->block_count || to >= ctx->block_count) return false;
+    
+    if (ctx->pending_count >= ctx->pending_capacity &&
+        !cfg_reserve_edges(ctx, ctx->pending_capacity ? ctx->pending_capacity * 2 : 16)) {
+        return false;
+    }
+    
+    CFGPendingEdge *edge = &ctx->pending_edges[ctx->pending_count++];
+    edge->from = from;
+    edge->to = to;
+    edge->type = (uint8_t)edge_type;
+    
+    return true;
+}
+
+typedef struct {
+    uint64_t start_address;
+    uint32_t index;
+} CFGBlockKey;
+
+static int cfg_compare_block_keys(const void *a, const void *b) {
+    const CFGBlockKey *key_a = (const CFGBlockKey*)a;
+    const CFGBlockKey *key_b = (const CFGBlockKey*)b;
+    if (key_a->start_address != key_b->start_address) {
+        return key_a->start_address < key_b->start_address ? -1 : 1;
+    }
+    return key_a->index < key_b->index ? -1 : (key_a->index > key_b->index);
+}
+
+// Fills ctx->address_order for a graph whose blocks were added out of order
+static bool cfg_sort_address_order(CFGContext *ctx) {
+    CFGBlockKey *keys = (CFGBlockKey*)malloc((size_t)ctx->block_count * sizeof(CFGBlockKey));
+    if (!keys) return false;
+    
+    for (uint32_t i = 0; i < ctx->block_count; i++) {
+        keys[i].start_address = ctx->blocks[i].start_address;
+        keys[i].index = i;
+    }
+    qsort(keys, ctx->block_count, sizeof(CFGBlockKey), cfg_compare_block_keys);
+    for (uint32_t i = 0; i < ctx->block_count; i++) {
+        ctx->address_order[i] = keys[i].index;
+    }
+    
+    free(keys);
+    return true;
+}
+
+bool cfg_freeze(CFGContext *ctx) {
+    if (!ctx || ctx->frozen) return false;
+    
+    uint32_t edge_count = ctx->pending_count;
+    uint32_t exit_count = 0;
+    for (uint32_t i = 0; i < ctx->block_count; i++) {
+        if (ctx->blocks[i].is_exit) exit_count++;
+    }
     
-    from->successor_count++;
-    from->successors = (BasicBlock**)realloc(from->successors, from->successor_count * sizeof(BasicBlock*));
-    from->successor_edge_types = (EdgeType*)realloc(from->successor_edge_types, from->successor_count * sizeof(EdgeType));
+    // Successors, predecessors, exits and the address order as uint32_t,
+    // then the edge types
+    uint32_t order_count = ctx->blocks_unsorted ? ctx->block_count : 0;
+    size_t index_count = (size_t)edge_count * 2 + exit_count + order_count;
+    uint8_t *arena = (uint8_t*)malloc(index_count * sizeof(uint32_t) + edge_count + 1);
+    if (!arena) return false;
     
-    if (!from->successors || !from->successor_edge_types) return false;
+    ctx->edge_arena = arena;
+    ctx->edge_count = edge_count;
+    ctx->successors = (uint32_t*)arena;
+    ctx->predecessors = ctx->successors + edge_count;
+    ctx->exit_blocks = ctx->predecessors + edge_count;
+    ctx->exit_block_count = exit_count;
+    ctx->address_order = order_count ? ctx->exit_blocks + exit_count : NULL;
+    ctx->successor_types = arena + index_count * sizeof(uint32_t);
     
-    from->successors[from->successor_count - 1] = to;
-    from->successor_edge_types[from->successor_count - 1] = edge_type;
+    if (ctx->address_order && !cfg_sort_address_order(ctx)) {
+        free(arena);
+        ctx->edge_arena = NULL;
+        ctx->successors = NULL;
+        ctx->predecessors = NULL;
+        ctx->exit_blocks = NULL;
+        ctx->address_order = NULL;
+        ctx->successor_types = NULL;
+        ctx->edge_count = 0;
+        ctx->exit_block_count = 0;
+        return false;
+    }
+    
+    // Counting sort on each end; edges of one block keep the order they were
+    // added in
+    for (uint32_t i = 0; i < ctx->block_count; i++) {
+        ctx->blocks[i].successor_count = 0;
+        ctx->blocks[i].predecessor_count = 0;
+    }
+    for (uint32_t e = 0; e < edge_count; e++) {
+        ctx->blocks[ctx->pending_edges[e].from].successor_count++;
+        ctx->blocks[ctx->pending_edges[e].to].predecessor_count++;
+    }
     
-    to->predecessor_count++;
-    to->predecessors = (BasicBlock**)realloc(to->predecessors, to->predecessor_count * sizeof(BasicBlock*));
+    uint32_t successor_start = 0;
+    uint32_t predecessor_start = 0;
+    uint32_t exit_index = 0;
+    for (uint32_t i = 0; i < ctx->block_count; i++) {
+        BasicBlock *block = &ctx->blocks[i];
+        block->successor_start = successor_start;
+        block->predecessor_start = predecessor_start;
+        successor_start += block->successor_count;
+        predecessor_start += block->predecessor_count;
+        block->successor_count = 0;
+        block->predecessor_count = 0;
+        
+        if (block->is_exit) ctx->exit_blocks[exit_index++] = i;
+    }
     
-    if (!to->predecessors) return false;
+    for (uint32_t e = 0; e < edge_count; e++) {
+        const CFGPendingEdge *edge = &ctx->pending_edges[e];
+        BasicBlock *from = &ctx->blocks[edge->from];
+        BasicBlock *to = &ctx->blocks[edge->to];
+        
+        uint32_t slot = from->successor_start + from->successor_count++;
+        ctx->successors[slot] = edge->to;
+        ctx->successor_types[slot] = edge->type;
+        ctx->predecessors[to->predecessor_start + to->predecessor_count++] = edge->from;
+    }
     
-    to->predecessors[to->predecessor_count - 1] = from;
+    free(ctx->pending_edges);
+    ctx->pending_edges = NULL;
+    ctx->pending_count = 0;
+    ctx->pending_capacity = 0;
+    ctx->frozen = true;
     
     return true;
 }
 
 BasicBlock* cfg_find_block(CFGContext *ctx, uint64_t address) {
-    if (!ctx || !ctx->blocks) return NULL;
+    if (!ctx || !ctx->blocks || ctx->block_count == 0) return NULL;
     
-    for (uint32_t i = 0; i < ctx->block_count; i++) {
-        if (address >= ctx->blocks[i].start_address && address < ctx->blocks[i].end_address) {
-            return &ctx->blocks[i];
+    const uint32_t *order = ctx->address_order;
+    if (ctx->blocks_unsorted && !order) {
+        for (uint32_t i = 0; i < ctx->block_count; i++) {
+            if (address >= ctx->blocks[i].start_address && address < ctx->blocks[i].end_address) {
+                return &ctx->blocks[i];
+            }
         }
+        return NULL;
     }
     
-    return NULL;
+    // Last block starting at or below address
+    uint32_t low = 0;
+    uint32_t high = ctx->block_count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        uint32_t index = order ? order[mid] : mid;
+        if (ctx->blocks[index].start_address <= address) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low == 0) return NULL;
+    
+    BasicBlock *block = &ctx->blocks[order ? order[low - 1] : low - 1];
+    return address < block->end_address ? block : NULL;
 }
 
 #pragma mark - CFG Building
 
 bool cfg_build_function(CFGContext *ctx, uint64_t func_start, uint64_t func_end) {
-    if (!ctx || !ctx->disasm_ctx || !ctx->disasm_ctx->instructions) return false;
+    if (!ctx || ctx->frozen || !ctx->disasm_ctx || ctx->disasm_ctx->instruction_count == 0) return false;
     
     ctx->function_start = func_start;
     ctx->function_end = func_end;
     
-    bool *is_leader = (bool*)calloc(ctx->disasm_ctx->instruction_count, sizeof(bool));
-    if (!is_leader) return false;
+    // Only the rows of the function are visited, so building every function
+    // of a binary stays linear in its size
+    const DisassemblyContext *disasm_ctx = ctx->disasm_ctx;
+    uint32_t first_idx = disasm_index_at_or_after(disasm_ctx, func_start);
+    uint32_t end_idx = disasm_index_at_or_after(disasm_ctx, func_end);
+    if (first_idx >= end_idx) return false;
     
-    is_leader[0] = true;
+    // Non-zero for the first row of a block, later the block of every row
+    uint32_t row_count = end_idx - first_idx;
+    uint32_t *row_block = (uint32_t*)calloc(row_count, sizeof(uint32_t));
+    if (!row_block) return false;
     
-    for (uint32_t i = 0; i < ctx->disasm_ctx->instruction_count; i++) {
-        DisassembledInstruction *inst = &ctx->disasm_ctx->instructions[i];
-        
-        if (inst->address < func_start || inst->address >= func_end) continue;
-        
-        if (inst->branch_type != BRANCH_NONE && inst->has_branch_target) {
-            int32_t target_idx = disasm_find_by_address(ctx->disasm_ctx, inst->branch_target);
-            if (target_idx >= 0) {
-                is_leader[target_idx] = true;
+    row_block[0] = 1;
+    
+    for (uint32_t i = first_idx; i < end_idx; i++) {
+        uint64_t branch_target = 0;
+        if (disasm_branch_type_at(disasm_ctx, i) != BRANCH_NONE &&
+            disasm_branch_target_at(disasm_ctx, i, &branch_target)) {
+            int32_t target_idx = disasm_find_by_address(disasm_ctx, branch_target);
+            if (target_idx >= (int32_t)first_idx && (uint32_t)target_idx < end_idx) {
+                row_block[target_idx - first_idx] = 1;
             }
             
-            if (i + 1 < ctx->disasm_ctx->instruction_count) {
-                is_leader[i + 1] = true;
+            if (i + 1 < end_idx) {
+                row_block[i + 1 - first_idx] = 1;
             }
         }
     }
     
-    uint32_t block_start_idx = 0;
-    for (uint32_t i = 1; i <= ctx->disasm_ctx->instruction_count; i++) {
-        if (i == ctx->disasm_ctx->instruction_count || is_leader[i]) {
-            if (i > block_start_idx) {
-                uint64_t start_addr = ctx->disasm_ctx->instructions[block_start_idx].address;
-                uint64_t end_addr = ctx->disasm_ctx->instructions[i - 1].address + 
-                                    ctx->disasm_ctx->instructions[i - 1].length;
-                
-                if (start_addr >= func_start && start_addr < func_end) {
-                    BasicBlock *block = cfg_add_block(ctx, start_addr, end_addr);
-                    if (block) {
-                        block->instruction_start = block_start_idx;
-                        block->instruction_count = i - block_start_idx;
-                        
-                        if (block_start_idx == 0) {
-                            block->is_entry = true;
-                            ctx->entry_block = block;
-                        }
-                    }
-                }
+    uint32_t leader_count = 0;
+    for (uint32_t r = 0; r < row_count; r++) {
+        leader_count += row_block[r];
+    }
+    
+    // A block has at most two outgoing edges
+    if (!cfg_reserve_blocks(ctx, ctx->block_count + leader_count) ||
+        !cfg_reserve_edges(ctx, ctx->pending_count + leader_count * 2)) {
+        free(row_block);
+        return false;
+    }
+    
+    uint32_t first_block = ctx->block_count;
+    uint32_t block_start_idx = first_idx;
+    for (uint32_t i = first_idx + 1; i <= end_idx; i++) {
+        if (i == end_idx || row_block[i - first_idx]) {
+            uint64_t start_addr = disasm_address_at(disasm_ctx, block_start_idx);
+            uint64_t end_addr = disasm_address_at(disasm_ctx, i - 1) + disasm_length_at(disasm_ctx, i - 1);
+            
+            uint32_t block_index = cfg_add_block(ctx, start_addr, end_addr);
+            if (block_index != CFG_NO_BLOCK) {
+                ctx->blocks[block_index].instruction_start = block_start_idx;
+                ctx->blocks[block_index].instruction_count = i - block_start_idx;
+            }
+            
+            for (uint32_t r = block_start_idx; r < i; r++) {
+                row_block[r - first_idx] = block_index;
             }
             block_start_idx = i;
         }
     }
     
-    for (uint32_t i = 0; i < ctx->block_count; i++) {
+    uint32_t end_block = ctx->block_count;
+    if (first_block < end_block) {
+        ctx->blocks[first_block].is_entry = true;
+        ctx->entry_block = first_block;
+    }
+    
+    for (uint32_t i = first_block; i < end_block; i++) {
         BasicBlock *block = &ctx->blocks[i];
         
         uint32_t last_idx = block->instruction_start + block->instruction_count - 1;
-        DisassembledInstruction *last_inst = &ctx->disasm_ctx->instructions[last_idx];
+        BranchType branch_type = disasm_branch_type_at(ctx->disasm_ctx, last_idx);
+        uint64_t branch_target = 0;
+        bool has_branch_target = disasm_branch_target_at(ctx->disasm_ctx, last_idx, &branch_target);
         
-        if (last_inst->branch_type == BRANCH_UNCONDITIONAL || last_inst->branch_type == BRANCH_CALL) {
-            if (last_inst->has_branch_target) {
-                BasicBlock *target = cfg_find_block(ctx, last_inst->branch_target);
-                if (target) {
-                    EdgeType edge_type = (last_inst->branch_type == BRANCH_CALL) ? EDGE_CALL : EDGE_UNCONDITIONAL;
-                    cfg_add_edge(block, target, edge_type);
-                }
+        // Only targets inside the function have a block; a target inside an
+        // instruction goes to the block holding it
+        uint32_t target = CFG_NO_BLOCK;
+        if (has_branch_target && branch_target >= ctx->blocks[first_block].start_address) {
+            uint32_t target_idx = disasm_index_at_or_after(disasm_ctx, branch_target);
+            if (target_idx >= end_idx || disasm_address_at(disasm_ctx, target_idx) != branch_target) target_idx--;
+            if (target_idx < end_idx &&
+                branch_target - disasm_address_at(disasm_ctx, target_idx) < disasm_length_at(disasm_ctx, target_idx)) {
+                target = row_block[target_idx - first_idx];
+            }
+        }
+        
+        if (branch_type == BRANCH_UNCONDITIONAL || branch_type == BRANCH_CALL) {
+            if (target != CFG_NO_BLOCK) {
+                EdgeType edge_type = (branch_type == BRANCH_CALL) ? EDGE_CALL : EDGE_UNCONDITIONAL;
+                cfg_add_edge(ctx, i, target, edge_type);
             }
             
-            if (last_inst->branch_type == BRANCH_CALL && i + 1 < ctx->block_count) {
-                cfg_add_edge(block, &ctx->blocks[i + 1], EDGE_UNCONDITIONAL);
+            if (branch_type == BRANCH_CALL && i + 1 < end_block) {
+                cfg_add_edge(ctx, i, i + 1, EDGE_UNCONDITIONAL);
             }
-        } else if (last_inst->branch_type == BRANCH_CONDITIONAL) {
-            if (last_inst->has_branch_target) {
-                BasicBlock *target = cfg_find_block(ctx, last_inst->branch_target);
-                if (target) {
-                    cfg_add_edge(block, target, EDGE_CONDITIONAL_TRUE);
-                }
+        } else if (branch_type == BRANCH_CONDITIONAL) {
+            if (target != CFG_NO_BLOCK) {
+                cfg_add_edge(ctx, i, target, EDGE_CONDITIONAL_TRUE);
             }
             
-            if (i + 1 < ctx->block_count) {
-                cfg_add_edge(block, &ctx->blocks[i + 1], EDGE_CONDITIONAL_FALSE);
+            if (i + 1 < end_block) {
+                cfg_add_edge(ctx, i, i + 1, EDGE_CONDITIONAL_FALSE);
             }
-        } else if (last_inst->branch_type == BRANCH_RETURN) {
+        } else if (branch_type == BRANCH_RETURN) {
             block->is_exit = true;
         } else {
-            if (i + 1 < ctx->block_count) {
-                cfg_add_edge(block, &ctx->blocks[i + 1], EDGE_UNCONDITIONAL);
+            if (i + 1 < end_block) {
+                cfg_add_edge(ctx, i, i + 1, EDGE_UNCONDITIONAL);
             }
         }
     }
     
-    free(is_leader);
-    return true;
+    free(row_block);
+    return cfg_freeze(ctx);
 }
 
 uint32_t cfg_build_all(CFGContext *ctx) {
@@ -214,182 +405,1015 @@ uint32_t cfg_build_all(CFGContext *ctx) {
     return ctx->block_count;
 }
 
+#pragma mark - Per-Function Building
+
+typedef struct {
+    uint64_t size;
+    uint32_t index;
+} CFGBuildJob;
+
+typedef struct {
+    DisassemblyContext *disasm_ctx;
+    const FunctionList *functions;
+    CFGContext **graphs;
+    
+    // Largest function first
+    const CFGBuildJob *jobs;
+    
+    atomic_uint next;
+    atomic_bool failed;
+} CFGBuildRun;
+
+static void* cfg_build_worker(void *arg) {
+    CFGBuildRun *run = (CFGBuildRun*)arg;
+    
+    for (;;) {
+        uint32_t next = atomic_fetch_add(&run->next, 1);
+        if (next >= run->functions->count || atomic_load(&run->failed)) break;
+        
+        uint32_t index = run->jobs[next].index;
+        const DiscoveredFunction *function = &run->functions->functions[index];
+        
+        CFGContext *graph = cfg_create_with_capacity(run->disasm_ctx, 0);
+        if (!graph) {
+            atomic_store(&run->failed, true);
+            break;
+        }
+        
+        // A function without rows (outside the swept sections) has no graph
+        if (cfg_build_function(graph, function->start_address, function->end_address)) {
+            run->graphs[index] = graph;
+        } else {
+            cfg_free(graph);
+        }
+    }
+    
+    return NULL;
+}
+
+static int compare_jobs(const void *a, const void *b) {
+    const CFGBuildJob *ja = (const CFGBuildJob*)a;
+    const CFGBuildJob *jb = (const CFGBuildJob*)b;
+    if (ja->size != jb->size) return ja->size > jb->size ? -1 : 1;
+    return (ja->index > jb->index) - (ja->index < jb->index);
+}
+
+CFGList* cfg_build_functions(DisassemblyContext *disasm_ctx, const FunctionList *functions, uint32_t thread_count) {
+    if (!disasm_ctx || !functions || disasm_ctx->instruction_count == 0) return NULL;
+    
+    CFGList *list = (CFGList*)calloc(1, sizeof(CFGList));
+    if (!list) return NULL;
+    
+    list->count = functions->count;
+    list->graphs = (CFGContext**)calloc(functions->count ? functions->count : 1, sizeof(CFGContext*));
+    CFGBuildJob *jobs = (CFGBuildJob*)malloc((functions->count ? functions->count : 1) * sizeof(CFGBuildJob));
+    if (!list->graphs || !jobs) {
+        free(jobs);
+        cfg_list_free(list);
+        return NULL;
+    }
+    
+    // Largest functions go first so no thread is left with a big one at the end
+    for (uint32_t i = 0; i < functions->count; i++) {
+        const DiscoveredFunction *function = &functions->functions[i];
+        jobs[i].size = function->end_address - function->start_address;
+        jobs[i].index = i;
+    }
+    qsort(jobs, functions->count, sizeof(CFGBuildJob), compare_jobs);
+    
+    if (thread_count == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = (uint32_t)(cpus > 0 ? cpus : 1);
+    }
+    if (thread_count > DISASM_MAX_THREADS) thread_count = DISASM_MAX_THREADS;
+    if (thread_count > functions->count) thread_count = functions->count;
+    if (thread_count == 0) thread_count = 1;
+    
+    CFGBuildRun run;
+    run.disasm_ctx = disasm_ctx;
+    run.functions = functions;
+    run.graphs = list->graphs;
+    run.jobs = jobs;
+    atomic_init(&run.next, 0);
+    atomic_init(&run.failed, false);
+    
+    // The caller's thread works too
+    pthread_t threads[DISASM_MAX_THREADS];
+    bool started[DISASM_MAX_THREADS] = { false };
+    for (uint32_t i = 1; i < thread_count; i++) {
+        started[i] = (pthread_create(&threads[i], NULL, cfg_build_worker, &run) == 0);
+    }
+    
+    cfg_build_worker(&run);
+    
+    for (uint32_t i = 1; i < thread_count; i++) {
+        if (started[i]) pthread_join(threads[i], NULL);
+    }
+    
+    free(jobs);
+    
+    if (atomic_load(&run.failed)) {
+        cfg_list_free(list);
+        return NULL;
+    }
+    
+    return list;
+}
+
+CFGContext* cfg_list_find(const CFGList *list, const FunctionList *functions, uint64_t address) {
+    if (!list || !functions || list->count != functions->count) return NULL;
+    
+    const DiscoveredFunction *function = function_list_find(functions, address);
+    if (!function) return NULL;
+    
+    return list->graphs[function - functions->functions];
+}
+
+void cfg_list_free(CFGList *list) {
+    if (!list) return;
+    
+    if (list->graphs) {
+        for (uint32_t i = 0; i < list->count; i++) {
+            cfg_free(list->graphs[i]);
+        }
+        free(list->graphs);
+    }
+    
+    free(list);
+}
+
 #pragma mark - Analysis
 
-bool cfg_compute_dominance(CFGContext *ctx) {
-    if (!ctx || !ctx->blocks || ctx->block_count == 0) return false;
+// Block indices of the blocks reachable from the entry in reverse postorder.
+// Iterative, so deep graphs cannot overflow the stack. Returns the number of
+// reachable blocks, or UINT32_MAX on allocation failure.
+static uint32_t cfg_reverse_postorder(CFGContext *ctx, uint32_t *order) {
+    uint32_t entry = ctx->entry_block;
     
-    uint32_t **dom_sets = calloc(ctx->block_count, sizeof(uint32_t*));
-    if (!dom_sets) return false;
+    // Block and next successor to visit, per level of the walk
+    uint32_t *stack_blocks = (uint32_t*)malloc(ctx->block_count * sizeof(uint32_t));
+    uint32_t *stack_next = (uint32_t*)malloc(ctx->block_count * sizeof(uint32_t));
+    if (!stack_blocks || !stack_next) {
+        free(stack_blocks);
+        free(stack_next);
+        return UINT32_MAX;
+    }
     
-    uint32_t words_needed = (ctx->block_count + 31) / 32;
     for (uint32_t i = 0; i < ctx->block_count; i++) {
-        dom_sets[i] = calloc(words_needed, sizeof(uint32_t));
-        if (!dom_sets[i]) {
-            for (uint32_t j = 0; j < i; j++) free(dom_sets[j]);
-            free(dom_sets);
-            return false;
+        ctx->blocks[i].visited = false;
+    }
+    
+    // Postorder fills order from the back
+    uint32_t remaining = ctx->block_count;
+    uint32_t depth = 0;
+    stack_blocks[depth] = entry;
+    stack_next[depth] = 0;
+    ctx->blocks[entry].visited = true;
+    depth++;
+    
+    while (depth > 0) {
+        BasicBlock *block = &ctx->blocks[stack_blocks[depth - 1]];
+        
+        if (stack_next[depth - 1] < block->successor_count) {
+            uint32_t succ = ctx->successors[block->successor_start + stack_next[depth - 1]++];
+            if (!ctx->blocks[succ].visited) {
+                ctx->blocks[succ].visited = true;
+                stack_blocks[depth] = succ;
+                stack_next[depth] = 0;
+                depth++;
+            }
+        } else {
+            order[--remaining] = stack_blocks[--depth];
         }
     }
     
-#define SET_BIT(set, bit) ((set)[(bit) / 32] |= (1U << ((bit) % 32)))
-#define CLEAR_BIT(set, bit) ((set)[(bit) / 32] &= ~(1U << ((bit) % 32)))
-#define TEST_BIT(set, bit) (((set)[(bit) / 32] & (1U << ((bit) % 32))) != 0)
+    uint32_t reachable = ctx->block_count - remaining;
+    memmove(order, order + remaining, reachable * sizeof(uint32_t));
+    
+    free(stack_blocks);
+    free(stack_next);
+    return reachable;
+}
 
-    SET_BIT(dom_sets[0], 0);
-    for (uint32_t i = 1; i < ctx->block_count; i++) {
-        for (uint32_t j = 0; j < ctx->block_count; j++) {
-            SET_BIT(dom_sets[i], j);
-        }
+// Dominance frontiers from the finished tree, into the CSR arrays of ctx.
+// A join point is in the frontier of every block on the dominator tree path
+// from each predecessor up to, but excluding, its immediate dominator.
+static bool cfg_compute_frontiers(CFGContext *ctx) {
+    uint32_t count = ctx->block_count;
+    
+    free(ctx->frontier_offsets);
+    free(ctx->frontier_blocks);
+    ctx->frontier_blocks = NULL;
+    ctx->frontier_offsets = (uint32_t*)calloc(count + 1, sizeof(uint32_t));
+    
+    // Last join point added to each block's frontier, to skip duplicates
+    uint32_t *last_join = (uint32_t*)malloc(count * sizeof(uint32_t));
+    if (!ctx->frontier_offsets || !last_join) {
+        free(last_join);
+        return false;
     }
     
-    bool changed = true;
-    int iterations = 0;
-    while (changed && iterations < 100) {
-        changed = false;
-        iterations++;
+    // Counts first, then the entries; both passes walk the same paths
+    uint32_t *fill = NULL;
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint32_t i = 0; i < count; i++) {
+            last_join[i] = CFG_NO_BLOCK;
+        }
         
-        for (uint32_t i = 1; i < ctx->block_count; i++) {
-            BasicBlock *block = &ctx->blocks[i];
+        for (uint32_t b = 0; b < count; b++) {
+            // The entry also has the function's caller as a predecessor
+            const BasicBlock *block = &ctx->blocks[b];
+            uint32_t predecessor_count = block->predecessor_count + (b == ctx->entry_block ? 1 : 0);
+            if (!block->visited || predecessor_count < 2) continue;
             
-            uint32_t *new_doms = calloc(words_needed, sizeof(uint32_t));
-            if (!new_doms) continue;
+            const uint32_t *predecessors = ctx->predecessors + block->predecessor_start;
+            for (uint32_t p = 0; p < block->predecessor_count; p++) {
+                uint32_t runner = predecessors[p];
+                if (!ctx->blocks[runner].visited) continue;
+                
+                while (runner != CFG_NO_BLOCK && runner != block->immediate_dominator) {
+                    if (last_join[runner] == b) break;
+                    last_join[runner] = b;
+                    
+                    if (pass == 0) {
+                        ctx->frontier_offsets[runner + 1]++;
+                    } else {
+                        ctx->frontier_blocks[fill[runner]++] = b;
+                    }
+                    runner = ctx->blocks[runner].immediate_dominator;
+                }
+            }
+        }
+        
+        if (pass == 0) {
+            for (uint32_t i = 0; i < count; i++) {
+                ctx->frontier_offsets[i + 1] += ctx->frontier_offsets[i];
+            }
             
-            for (uint32_t w = 0; w < words_needed; w++) {
-                new_doms[w] = 0xFFFFFFFF;
+            uint32_t total = ctx->frontier_offsets[count];
+            ctx->frontier_blocks = (uint32_t*)malloc((total ? total : 1) * sizeof(uint32_t));
+            fill = (uint32_t*)malloc(count * sizeof(uint32_t));
+            if (!ctx->frontier_blocks || !fill) {
+                free(fill);
+                free(last_join);
+                return false;
             }
+            memcpy(fill, ctx->frontier_offsets, count * sizeof(uint32_t));
+        }
+    }
+    
+    free(fill);
+    free(last_join);
+    return true;
+}
+
+bool cfg_compute_dominance(CFGContext *ctx) {
+    if (!ctx || ctx->block_count == 0 || ctx->entry_block >= ctx->block_count) return false;
+    if (!ctx->frozen && !cfg_freeze(ctx)) return false;
+    
+    uint32_t count = ctx->block_count;
+    uint32_t *order = (uint32_t*)malloc(count * sizeof(uint32_t));
+    uint32_t *rpo_number = (uint32_t*)malloc(count * sizeof(uint32_t));
+    uint32_t *idom = (uint32_t*)malloc(count * sizeof(uint32_t));
+    if (!order || !rpo_number || !idom) {
+        free(order);
+        free(rpo_number);
+        free(idom);
+        return false;
+    }
+    
+    uint32_t reachable = cfg_reverse_postorder(ctx, order);
+    bool ok = (reachable != UINT32_MAX);
+    
+    if (ok) {
+        for (uint32_t i = 0; i < reachable; i++) {
+            rpo_number[order[i]] = i;
+        }
+        
+        // Cooper, Harvey and Kennedy: immediate dominators by RPO number, the
+        // entry being its own, refined until nothing changes. Each pass is
+        // linear and reducible graphs settle in two or three passes.
+        for (uint32_t i = 0; i < reachable; i++) {
+            idom[i] = CFG_NO_BLOCK;
+        }
+        idom[0] = 0;
+        
+        bool changed = true;
+        while (changed) {
+            changed = false;
             
-            if (block->predecessor_count > 0) {
+            for (uint32_t i = 1; i < reachable; i++) {
+                const BasicBlock *block = &ctx->blocks[order[i]];
+                const uint32_t *predecessors = ctx->predecessors + block->predecessor_start;
+                uint32_t new_idom = CFG_NO_BLOCK;
+                
                 for (uint32_t p = 0; p < block->predecessor_count; p++) {
-                    BasicBlock *pred = block->predecessors[p];
-                    int pred_idx = -1;
-                    for (uint32_t k = 0; k < ctx->block_count; k++) {
-                        if (&ctx->blocks[k] == pred) {
-                            pred_idx = k;
-                            break;
-                        }
+                    uint32_t pred = predecessors[p];
+                    if (!ctx->blocks[pred].visited) continue;
+                    
+                    uint32_t other = rpo_number[pred];
+                    if (idom[other] == CFG_NO_BLOCK) continue;
+                    
+                    if (new_idom == CFG_NO_BLOCK) {
+                        new_idom = other;
+                        continue;
                     }
                     
-                    if (pred_idx >= 0) {
-                        for (uint32_t w = 0; w < words_needed; w++) {
-                            new_doms[w] &= dom_sets[pred_idx][w];
-                        }
+                    // Walk both up the tree to their nearest common dominator
+                    while (other != new_idom) {
+                        while (other > new_idom) other = idom[other];
+                        while (new_idom > other) new_idom = idom[new_idom];
                     }
                 }
-            }
-            
-            SET_BIT(new_doms, i);
-            
-            for (uint32_t w = 0; w < words_needed; w++) {
-                if (new_doms[w] != dom_sets[i][w]) {
+                
+                if (new_idom != idom[i]) {
+                    idom[i] = new_idom;
                     changed = true;
-                    dom_sets[i][w] = new_doms[w];
                 }
             }
-            
-            free(new_doms);
         }
+        
+        for (uint32_t i = 0; i < count; i++) {
+            ctx->blocks[i].immediate_dominator = CFG_NO_BLOCK;
+            ctx->blocks[i].dom_level = 0;
+        }
+        
+        // Dominators come first in RPO, so their level is already known
+        for (uint32_t i = 1; i < reachable; i++) {
+            BasicBlock *block = &ctx->blocks[order[i]];
+            block->immediate_dominator = order[idom[i]];
+            block->dom_level = ctx->blocks[block->immediate_dominator].dom_level + 1;
+        }
+        
+        ok = cfg_compute_frontiers(ctx);
     }
     
-    for (uint32_t i = 0; i < ctx->block_count; i++) {
-        free(dom_sets[i]);
+    free(order);
+    free(rpo_number);
+    free(idom);
+    return ok;
+}
+
+bool cfg_dominates(const CFGContext *ctx, uint32_t dominator, uint32_t block) {
+    if (!ctx || dominator >= ctx->block_count || block >= ctx->block_count) return false;
+    if (!ctx->blocks[dominator].visited || !ctx->blocks[block].visited) return false;
+    
+    uint32_t level = ctx->blocks[dominator].dom_level;
+    while (ctx->blocks[block].dom_level > level) {
+        block = ctx->blocks[block].immediate_dominator;
+    }
+    return block == dominator;
+}
+
+const uint32_t* cfg_dominance_frontier(const CFGContext *ctx, uint32_t block, uint32_t *out_count) {
+    if (out_count) *out_count = 0;
+    if (!ctx || !ctx->frontier_offsets || block >= ctx->block_count) return NULL;
+    
+    if (out_count) *out_count = ctx->frontier_offsets[block + 1] - ctx->frontier_offsets[block];
+    return ctx->frontier_blocks + ctx->frontier_offsets[block];
+}
+
+#pragma mark - Loops
+
+static inline bool cfg_bit_test(const uint64_t *bits, uint32_t index) {
+    return (bits[index >> 6] >> (index & 63)) & 1;
+}
+
+static inline void cfg_bit_set(uint64_t *bits, uint32_t index) {
+    bits[index >> 6] |= 1ULL << (index & 63);
+}
+
+// Loops as they are found, before they are put in forest order
+typedef struct {
+    CFGLoop *loops;
+    uint64_t *bodies;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t words;
+} CFGLoopSet;
+
+static uint64_t* cfg_loop_set_body(const CFGLoopSet *set, uint32_t loop) {
+    return set->bodies + (size_t)loop * set->words;
+}
+
+// Appends a loop with an empty body; returns its index or CFG_NO_LOOP
+static uint32_t cfg_loop_set_add(CFGLoopSet *set, uint32_t header, bool is_irreducible) {
+    if (set->count >= set->capacity) {
+        uint32_t capacity = set->capacity ? set->capacity * 2 : 16;
+        
+        CFGLoop *loops = (CFGLoop*)realloc(set->loops, capacity * sizeof(CFGLoop));
+        if (!loops) return CFG_NO_LOOP;
+        set->loops = loops;
+        
+        uint64_t *bodies = (uint64_t*)realloc(set->bodies, (size_t)capacity * set->words * sizeof(uint64_t));
+        if (!bodies) return CFG_NO_LOOP;
+        set->bodies = bodies;
+        set->capacity = capacity;
     }
-    free(dom_sets);
     
-    #undef SET_BIT
-    #undef CLEAR_BIT
-    #undef TEST_BIT
+    uint32_t index = set->count++;
+    CFGLoop *loop = &set->loops[index];
+    memset(loop, 0, sizeof(CFGLoop));
+    loop->header = header;
+    loop->parent = CFG_NO_LOOP;
+    loop->is_irreducible = is_irreducible;
+    memset(cfg_loop_set_body(set, index), 0, set->words * sizeof(uint64_t));
     
-    return true;
+    return index;
 }
 
-uint32_t cfg_detect_loops(CFGContext *ctx) {
-    if (!ctx || !ctx->blocks) return 0;
+// Moves the last loop into index, dropping the loop that was there
+static void cfg_loop_set_remove(CFGLoopSet *set, uint32_t index) {
+    uint32_t last = --set->count;
+    if (index == last) return;
     
-    uint32_t loop_count = 0;
+    set->loops[index] = set->loops[last];
+    memcpy(cfg_loop_set_body(set, index), cfg_loop_set_body(set, last), set->words * sizeof(uint64_t));
+}
+
+typedef struct {
+    uint32_t block_count;
+    uint32_t header_rpo;
+    uint32_t index;
+} CFGLoopKey;
+
+static int cfg_compare_loop_keys(const void *a, const void *b) {
+    const CFGLoopKey *key_a = (const CFGLoopKey*)a;
+    const CFGLoopKey *key_b = (const CFGLoopKey*)b;
+    if (key_a->block_count != key_b->block_count) return key_a->block_count > key_b->block_count ? -1 : 1;
+    if (key_a->header_rpo != key_b->header_rpo) return key_a->header_rpo < key_b->header_rpo ? -1 : 1;
+    return key_a->index < key_b->index ? -1 : (key_a->index > key_b->index);
+}
+
+// Two loops are either disjoint or one holds the other. Visiting them
+// largest first therefore reaches each loop after all that contain it, and
+// the innermost loop seen so far at its header is its parent. Fills order
+// with the visiting order and block_loop with each block's innermost loop.
+static bool cfg_nest_loops(CFGLoopSet *set, const uint32_t *rpo_number, uint32_t block_count,
+                           uint32_t *order, uint32_t *block_loop) {
+    CFGLoopKey *keys = (CFGLoopKey*)malloc((size_t)(set->count ? set->count : 1) * sizeof(CFGLoopKey));
+    if (!keys) return false;
     
-    for (uint32_t i = 0; i < ctx->block_count; i++) {
-        BasicBlock *block = &ctx->blocks[i];
-        for (uint32_t j = 0; j < block->successor_count; j++) {
-            BasicBlock *succ = block->successors[j];
-            
-            bool is_back_edge = false;
-            BasicBlock *dom = block->immediate_dominator;
-            
-            while (dom) {
-                if (dom == succ) {
-                    is_back_edge = true;
-                    break;
-                }
-                dom = dom->immediate_dominator;
+    for (uint32_t i = 0; i < set->count; i++) {
+        const uint64_t *body = cfg_loop_set_body(set, i);
+        uint32_t members = 0;
+        for (uint32_t w = 0; w < set->words; w++) {
+            members += (uint32_t)__builtin_popcountll(body[w]);
+        }
+        set->loops[i].block_count = members;
+        
+        keys[i].block_count = members;
+        keys[i].header_rpo = rpo_number[set->loops[i].header];
+        keys[i].index = i;
+    }
+    qsort(keys, set->count, sizeof(CFGLoopKey), cfg_compare_loop_keys);
+    
+    for (uint32_t i = 0; i < block_count; i++) {
+        block_loop[i] = CFG_NO_LOOP;
+    }
+    
+    for (uint32_t k = 0; k < set->count; k++) {
+        uint32_t index = keys[k].index;
+        CFGLoop *loop = &set->loops[index];
+        order[k] = index;
+        
+        loop->parent = block_loop[loop->header];
+        loop->depth = loop->parent == CFG_NO_LOOP ? 1 : set->loops[loop->parent].depth + 1;
+        
+        const uint64_t *body = cfg_loop_set_body(set, index);
+        for (uint32_t w = 0; w < set->words; w++) {
+            for (uint64_t bits = body[w]; bits; bits &= bits - 1) {
+                block_loop[w * 64 + (uint32_t)__builtin_ctzll(bits)] = index;
             }
+        }
+    }
+    
+    free(keys);
+    return true;
+}
+
+// Natural loops, one per header, from the back edges into it
+static bool cfg_find_natural_loops(CFGContext *ctx, CFGLoopSet *set, const uint32_t *order, uint32_t reachable,
+                                   const uint32_t *rpo_number, uint32_t *worklist) {
+    for (uint32_t i = 0; i < reachable; i++) {
+        uint32_t header = order[i];
+        const BasicBlock *block = &ctx->blocks[header];
+        const uint32_t *predecessors = ctx->predecessors + block->predecessor_start;
+        uint32_t loop = CFG_NO_LOOP;
+        uint32_t pending = 0;
+        
+        for (uint32_t p = 0; p < block->predecessor_count; p++) {
+            uint32_t latch = predecessors[p];
+            if (!ctx->blocks[latch].visited || rpo_number[latch] < i) continue;
+            if (!cfg_dominates(ctx, header, latch)) continue;
             
-            if (block == succ) {
-                is_back_edge = true;
+            if (loop == CFG_NO_LOOP) {
+                loop = cfg_loop_set_add(set, header, false);
+                if (loop == CFG_NO_LOOP) return false;
+                cfg_bit_set(cfg_loop_set_body(set, loop), header);
             }
+            set->loops[loop].back_edge_count++;
             
-            if (is_back_edge) {
-                succ->is_loop_header = true;
-                loop_count++;
+            uint64_t *body = cfg_loop_set_body(set, loop);
+            if (!cfg_bit_test(body, latch)) {
+                cfg_bit_set(body, latch);
+                worklist[pending++] = latch;
+            }
+        }
+        if (loop == CFG_NO_LOOP) continue;
+        
+        // Everything reaching a latch without passing the header
+        uint64_t *body = cfg_loop_set_body(set, loop);
+        while (pending > 0) {
+            const BasicBlock *member = &ctx->blocks[worklist[--pending]];
+            const uint32_t *member_predecessors = ctx->predecessors + member->predecessor_start;
+            for (uint32_t p = 0; p < member->predecessor_count; p++) {
+                uint32_t pred = member_predecessors[p];
+                if (!ctx->blocks[pred].visited || cfg_bit_test(body, pred)) continue;
+                cfg_bit_set(body, pred);
+                worklist[pending++] = pred;
             }
         }
     }
     
-    return loop_count;
+    return true;
 }
 
-#pragma mark - Export
+// Adds the cycles through the retreating edge source -> target, which target
+// does not dominate. They stay inside the innermost natural loop holding both
+// ends, off its header, so the region is the blocks there that are reachable
+// from target and reach source. Natural loops with their header in the region
+// are added whole so that loops still nest.
+static bool cfg_add_irreducible_edge(CFGContext *ctx, CFGLoopSet *set, uint32_t natural_count, const uint32_t *block_loop,
+                                     uint64_t *reached, uint32_t *worklist, uint32_t source, uint32_t target) {
+    uint32_t enclosing = block_loop[source];
+    while (enclosing != CFG_NO_LOOP && !cfg_bit_test(cfg_loop_set_body(set, enclosing), target)) {
+        enclosing = set->loops[enclosing].parent;
+    }
+    
+    // An edge inside a region found already puts no new block on its cycles
+    for (uint32_t r = natural_count; r < set->count; r++) {
+        const uint64_t *body = cfg_loop_set_body(set, r);
+        if (set->loops[r].parent == enclosing && cfg_bit_test(body, source) && cfg_bit_test(body, target)) {
+            set->loops[r].back_edge_count++;
+            return true;
+        }
+    }
+    
+    uint32_t region = cfg_loop_set_add(set, target, true);
+    if (region == CFG_NO_LOOP) return false;
+    set->loops[region].parent = enclosing;
+    set->loops[region].back_edge_count = 1;
+    
+    const uint64_t *domain = enclosing != CFG_NO_LOOP ? cfg_loop_set_body(set, enclosing) : NULL;
+    uint32_t excluded = enclosing != CFG_NO_LOOP ? set->loops[enclosing].header : CFG_NO_BLOCK;
+    
+    memset(reached, 0, set->words * sizeof(uint64_t));
+    cfg_bit_set(reached, target);
+    worklist[0] = target;
+    uint32_t pending = 1;
+    while (pending > 0) {
+        const BasicBlock *block = &ctx->blocks[worklist[--pending]];
+        const uint32_t *successors = ctx->successors + block->successor_start;
+        for (uint32_t s = 0; s < block->successor_count; s++) {
+            uint32_t succ = successors[s];
+            if (succ == excluded || cfg_bit_test(reached, succ)) continue;
+            if (domain ? !cfg_bit_test(domain, succ) : !ctx->blocks[succ].visited) continue;
+            cfg_bit_set(reached, succ);
+            worklist[pending++] = succ;
+        }
+    }
+    
+    uint64_t *body = cfg_loop_set_body(set, region);
+    cfg_bit_set(body, source);
+    worklist[0] = source;
+    pending = 1;
+    while (pending > 0) {
+        const BasicBlock *block = &ctx->blocks[worklist[--pending]];
+        const uint32_t *predecessors = ctx->predecessors + block->predecessor_start;
+        for (uint32_t p = 0; p < block->predecessor_count; p++) {
+            uint32_t pred = predecessors[p];
+            if (!cfg_bit_test(reached, pred) || cfg_bit_test(body, pred)) continue;
+            cfg_bit_set(body, pred);
+            worklist[pending++] = pred;
+        }
+    }
+    
+    for (uint32_t l = 0; l < natural_count; l++) {
+        if (!cfg_bit_test(body, set->loops[l].header)) continue;
+        const uint64_t *loop_body = cfg_loop_set_body(set, l);
+        for (uint32_t w = 0; w < set->words; w++) {
+            body[w] |= loop_body[w];
+        }
+    }
+    
+    return true;
+}
 
-bool cfg_export_dot(CFGContext *ctx, FILE *output) {
-    if (!ctx || !output) return false;
+// Regions in the same natural loop that share a block form one region. The
+// header becomes the region's first block in reverse postorder.
+static void cfg_merge_irreducible_regions(CFGLoopSet *set, uint32_t natural_count, const uint32_t *rpo_number) {
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        
+        for (uint32_t a = natural_count; a < set->count; a++) {
+            uint64_t *body_a = cfg_loop_set_body(set, a);
+            for (uint32_t b = a + 1; b < set->count; b++) {
+                if (set->loops[a].parent != set->loops[b].parent) continue;
+                
+                const uint64_t *body_b = cfg_loop_set_body(set, b);
+                bool overlaps = false;
+                for (uint32_t w = 0; w < set->words && !overlaps; w++) {
+                    overlaps = (body_a[w] & body_b[w]) != 0;
+                }
+                if (!overlaps) continue;
+                
+                for (uint32_t w = 0; w < set->words; w++) {
+                    body_a[w] |= body_b[w];
+                }
+                set->loops[a].back_edge_count += set->loops[b].back_edge_count;
+                cfg_loop_set_remove(set, b);
+                merged = true;
+                b--;
+            }
+        }
+    }
     
-    fprintf(output, "digraph CFG {\n");
-    fprintf(output, "  node [shape=box];\n\n");
+    for (uint32_t r = natural_count; r < set->count; r++) {
+        const uint64_t *body = cfg_loop_set_body(set, r);
+        uint32_t header = set->loops[r].header;
+        for (uint32_t w = 0; w < set->words; w++) {
+            for (uint64_t bits = body[w]; bits; bits &= bits - 1) {
+                uint32_t block = w * 64 + (uint32_t)__builtin_ctzll(bits);
+                if (rpo_number[block] < rpo_number[header]) header = block;
+            }
+        }
+        set->loops[r].header = header;
+    }
+}
+
+static void cfg_clear_loops(CFGContext *ctx) {
+    free(ctx->loops);
+    free(ctx->loop_bodies);
+    ctx->loops = NULL;
+    ctx->loop_bodies = NULL;
+    ctx->loop_count = 0;
+    ctx->loop_bitset_words = 0;
     
     for (uint32_t i = 0; i < ctx->block_count; i++) {
-        BasicBlock *block = &ctx->blocks[i];
-        fprintf(output, "  bb_%u [label=\"BB %u\\n0x%llx - 0x%llx\"",
-                i, i, block->start_address, block->end_address);
+        ctx->blocks[i].loop = CFG_NO_LOOP;
+        ctx->blocks[i].is_loop_header = false;
+    }
+}
+
+uint32_t cfg_detect_loops(CFGContext *ctx) {
+    if (!ctx || ctx->block_count == 0) return 0;
+    if (!ctx->frontier_offsets && !cfg_compute_dominance(ctx)) return 0;
+    
+    cfg_clear_loops(ctx);
+    
+    uint32_t count = ctx->block_count;
+    CFGLoopSet set = { NULL, NULL, 0, 0, (count + 63) / 64 };
+    uint32_t *order = (uint32_t*)malloc(count * sizeof(uint32_t));
+    uint32_t *rpo_number = (uint32_t*)malloc(count * sizeof(uint32_t));
+    uint32_t *worklist = (uint32_t*)malloc(count * sizeof(uint32_t));
+    uint32_t *block_loop = (uint32_t*)malloc(count * sizeof(uint32_t));
+    uint64_t *reached = (uint64_t*)malloc(set.words * sizeof(uint64_t));
+    uint32_t *loop_order = NULL;
+    uint32_t *new_index = NULL;
+    
+    uint32_t reachable = UINT32_MAX;
+    if (order && rpo_number && worklist && block_loop && reached) {
+        reachable = cfg_reverse_postorder(ctx, order);
+    }
+    bool ok = (reachable != UINT32_MAX);
+    
+    if (ok) {
+        // Unreachable blocks are never looked up; they get a number anyway
+        for (uint32_t i = 0; i < count; i++) {
+            rpo_number[i] = UINT32_MAX;
+        }
+        for (uint32_t i = 0; i < reachable; i++) {
+            rpo_number[order[i]] = i;
+        }
+        ok = cfg_find_natural_loops(ctx, &set, order, reachable, rpo_number, worklist);
+    }
+    
+    // Natural loops are nested first so irreducible regions can find the
+    // innermost one around them
+    uint32_t natural_count = set.count;
+    if (ok) {
+        loop_order = (uint32_t*)malloc((size_t)(natural_count ? natural_count : 1) * sizeof(uint32_t));
+        ok = loop_order && cfg_nest_loops(&set, rpo_number, count, loop_order, block_loop);
+    }
+    
+    for (uint32_t i = 0; i < reachable && ok; i++) {
+        uint32_t source = order[i];
+        const BasicBlock *block = &ctx->blocks[source];
+        const uint32_t *successors = ctx->successors + block->successor_start;
+        
+        for (uint32_t s = 0; s < block->successor_count && ok; s++) {
+            uint32_t target = successors[s];
+            if (rpo_number[target] > i || cfg_dominates(ctx, target, source)) continue;
+            ok = cfg_add_irreducible_edge(ctx, &set, natural_count, block_loop, reached, worklist, source, target);
+        }
+    }
+    
+    if (ok && set.count > natural_count) {
+        cfg_merge_irreducible_regions(&set, natural_count, rpo_number);
+        free(loop_order);
+        loop_order = (uint32_t*)malloc(set.count * sizeof(uint32_t));
+        ok = loop_order && cfg_nest_loops(&set, rpo_number, count, loop_order, block_loop);
+    }
+    
+    // Store the forest in visiting order, so parents come before children
+    if (ok && set.count > 0) {
+        new_index = (uint32_t*)malloc(set.count * sizeof(uint32_t));
+        ctx->loops = (CFGLoop*)malloc(set.count * sizeof(CFGLoop));
+        ctx->loop_bodies = (uint64_t*)malloc((size_t)set.count * set.words * sizeof(uint64_t));
+        ok = new_index && ctx->loops && ctx->loop_bodies;
+    }
+    
+    if (ok) {
+        for (uint32_t k = 0; k < set.count; k++) {
+            new_index[loop_order[k]] = k;
+        }
+        
+        for (uint32_t k = 0; k < set.count; k++) {
+            CFGLoop *loop = &ctx->loops[k];
+            *loop = set.loops[loop_order[k]];
+            if (loop->parent != CFG_NO_LOOP) loop->parent = new_index[loop->parent];
+            memcpy(ctx->loop_bodies + (size_t)k * set.words, cfg_loop_set_body(&set, loop_order[k]),
+                   set.words * sizeof(uint64_t));
+            ctx->blocks[loop->header].is_loop_header = true;
+        }
+        
+        for (uint32_t i = 0; i < count; i++) {
+            ctx->blocks[i].loop = block_loop[i] == CFG_NO_LOOP ? CFG_NO_LOOP : new_index[block_loop[i]];
+        }
+        
+        ctx->loop_count = set.count;
+        ctx->loop_bitset_words = set.words;
+    } else {
+        cfg_clear_loops(ctx);
+    }
+    
+    free(set.loops);
+    free(set.bodies);
+    free(order);
+    free(rpo_number);
+    free(worklist);
+    free(block_loop);
+    free(reached);
+    free(loop_order);
+    free(new_index);
+    return ctx->loop_count;
+}
+
+bool cfg_loop_contains(const CFGContext *ctx, uint32_t loop, uint32_t block) {
+    if (!ctx || loop >= ctx->loop_count || block >= ctx->block_count) return false;
+    return cfg_bit_test(ctx->loop_bodies + (size_t)loop * ctx->loop_bitset_words, block);
+}
+
+#pragma mark - Export
+
+// Output is gathered here and handed to write in large chunks, so export
+// costs a few calls per CFG_EXPORT_BUFFER_SIZE bytes rather than a stdio
+// call per field
+typedef struct {
+    CFGWriteFunc write;
+    void *context;
+    bool failed;
+    size_t length;
+    char buffer[CFG_EXPORT_BUFFER_SIZE];
+} CFGEmitter;
+
+static void cfg_emit_flush(CFGEmitter *emitter) {
+    if (emitter->length > 0 && !emitter->failed &&
+        !emitter->write(emitter->context, emitter->buffer, emitter->length)) {
+        emitter->failed = true;
+    }
+    emitter->length = 0;
+}
+
+static void cfg_emit(CFGEmitter *emitter, const char *text, size_t length) {
+    if (length > CFG_EXPORT_BUFFER_SIZE - emitter->length) {
+        cfg_emit_flush(emitter);
+    }
+    memcpy(emitter->buffer + emitter->length, text, length);
+    emitter->length += length;
+}
+
+#define cfg_emit_literal(emitter, text) cfg_emit((emitter), (text), sizeof(text) - 1)
+
+static void cfg_emit_u32(CFGEmitter *emitter, uint32_t value) {
+    char digits[10];
+    size_t count = 0;
+    do {
+        digits[sizeof(digits) - ++count] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    cfg_emit(emitter, digits + sizeof(digits) - count, count);
+}
+
+// "0x" and lowercase digits without padding, as "0x%llx" prints
+static void cfg_emit_hex(CFGEmitter *emitter, uint64_t value) {
+    static const char hex_digits[] = "0123456789abcdef";
+    char digits[18];
+    size_t count = 0;
+    do {
+        digits[sizeof(digits) - ++count] = hex_digits[value & 0xF];
+        value >>= 4;
+    } while (value);
+    digits[sizeof(digits) - ++count] = 'x';
+    digits[sizeof(digits) - ++count] = '0';
+    cfg_emit(emitter, digits + sizeof(digits) - count, count);
+}
+
+static void cfg_emit_bool(CFGEmitter *emitter, bool value) {
+    if (value) {
+        cfg_emit_literal(emitter, "true");
+    } else {
+        cfg_emit_literal(emitter, "false");
+    }
+}
+
+static void cfg_emit_dot(CFGContext *ctx, CFGEmitter *emitter) {
+    cfg_emit_literal(emitter, "digraph CFG {\n");
+    cfg_emit_literal(emitter, "  node [shape=box];\n\n");
+    
+    for (uint32_t i = 0; i < ctx->block_count && !emitter->failed; i++) {
+        const BasicBlock *block = &ctx->blocks[i];
+        cfg_emit_literal(emitter, "  bb_");
+        cfg_emit_u32(emitter, i);
+        cfg_emit_literal(emitter, " [label=\"BB ");
+        cfg_emit_u32(emitter, i);
+        cfg_emit_literal(emitter, "\\n");
+        cfg_emit_hex(emitter, block->start_address);
+        cfg_emit_literal(emitter, " - ");
+        cfg_emit_hex(emitter, block->end_address);
+        cfg_emit_literal(emitter, "\"");
         
-        if (block->is_entry) fprintf(output, " color=green");
-        if (block->is_exit) fprintf(output, " color=red");
-        if (block->is_loop_header) fprintf(output, " style=bold");
+        if (block->is_entry) cfg_emit_literal(emitter, " color=green");
+        if (block->is_exit) cfg_emit_literal(emitter, " color=red");
+        if (block->is_loop_header) cfg_emit_literal(emitter, " style=bold");
         
-        fprintf(output, "];\n");
+        cfg_emit_literal(emitter, "];\n");
     }
     
-    fprintf(output, "\n");
+    cfg_emit_literal(emitter, "\n");
     
-    for (uint32_t i = 0; i < ctx->block_count; i++) {
-        BasicBlock *block = &ctx->blocks[i];
+    for (uint32_t i = 0; i < ctx->block_count && !emitter->failed; i++) {
+        const BasicBlock *block = &ctx->blocks[i];
         for (uint32_t j = 0; j < block->successor_count; j++) {
-            BasicBlock *succ = block->successors[j];
-            
-            uint32_t succ_idx = 0;
-            for (uint32_t k = 0; k < ctx->block_count; k++) {
-                if (&ctx->blocks[k] == succ) {
-                    succ_idx = k;
-                    break;
-                }
-            }
-            
-            fprintf(output, "  bb_%u -> bb_%u", i, succ_idx);
+            uint32_t edge = block->successor_start + j;
+            cfg_emit_literal(emitter, "  bb_");
+            cfg_emit_u32(emitter, i);
+            cfg_emit_literal(emitter, " -> bb_");
+            cfg_emit_u32(emitter, ctx->successors[edge]);
             
-            EdgeType edge_type = block->successor_edge_types[j];
+            EdgeType edge_type = (EdgeType)ctx->successor_types[edge];
             if (edge_type == EDGE_CONDITIONAL_TRUE) {
-                fprintf(output, " [label=\"T\" color=green]");
+                cfg_emit_literal(emitter, " [label=\"T\" color=green]");
             } else if (edge_type == EDGE_CONDITIONAL_FALSE) {
-                fprintf(output, " [label=\"F\" color=red]");
+                cfg_emit_literal(emitter, " [label=\"F\" color=red]");
             } else if (edge_type == EDGE_CALL) {
-                fprintf(output, " [label=\"call\" style=dashed]");
+                cfg_emit_literal(emitter, " [label=\"call\" style=dashed]");
             }
             
-            fprintf(output, ";\n");
+            cfg_emit_literal(emitter, ";\n");
         }
     }
     
-    fprintf(output, "}\n");
+    cfg_emit_literal(emitter, "}\n");
+}
+
+static void cfg_emit_json(CFGContext *ctx, CFGEmitter *emitter) {
+    cfg_emit_literal(emitter, "{\"start\":\"");
+    cfg_emit_hex(emitter, ctx->function_start);
+    cfg_emit_literal(emitter, "\",\"end\":\"");
+    cfg_emit_hex(emitter, ctx->function_end);
+    cfg_emit_literal(emitter, "\",\"entry\":");
+    if (ctx->entry_block < ctx->block_count) {
+        cfg_emit_u32(emitter, ctx->entry_block);
+    } else {
+        cfg_emit_literal(emitter, "null");
+    }
     
-    return true;
+    cfg_emit_literal(emitter, ",\"blocks\":[");
+    for (uint32_t i = 0; i < ctx->block_count && !emitter->failed; i++) {
+        const BasicBlock *block = &ctx->blocks[i];
+        if (i > 0) cfg_emit_literal(emitter, ",");
+        cfg_emit_literal(emitter, "{\"start\":\"");
+        cfg_emit_hex(emitter, block->start_address);
+        cfg_emit_literal(emitter, "\",\"end\":\"");
+        cfg_emit_hex(emitter, block->end_address);
+        cfg_emit_literal(emitter, "\",\"instructions\":");
+        cfg_emit_u32(emitter, block->instruction_count);
+        cfg_emit_literal(emitter, ",\"entry\":");
+        cfg_emit_bool(emitter, block->is_entry);
+        cfg_emit_literal(emitter, ",\"exit\":");
+        cfg_emit_bool(emitter, block->is_exit);
+        cfg_emit_literal(emitter, ",\"loop_header\":");
+        cfg_emit_bool(emitter, block->is_loop_header);
+        cfg_emit_literal(emitter, ",\"idom\":");
+        if (block->immediate_dominator != CFG_NO_BLOCK) {
+            cfg_emit_u32(emitter, block->immediate_dominator);
+        } else {
+            cfg_emit_literal(emitter, "null");
+        }
+        cfg_emit_literal(emitter, ",\"loop\":");
+        if (block->loop != CFG_NO_LOOP) {
+            cfg_emit_u32(emitter, block->loop);
+        } else {
+            cfg_emit_literal(emitter, "null");
+        }
+        cfg_emit_literal(emitter, "}");
+    }
+    
+    cfg_emit_literal(emitter, "],\"edges\":[");
+    bool first = true;
+    for (uint32_t i = 0; i < ctx->block_count && !emitter->failed; i++) {
+        const BasicBlock *block = &ctx->blocks[i];
+        for (uint32_t j = 0; j < block->successor_count; j++) {
+            uint32_t edge = block->successor_start + j;
+            const char *type = cfg_edge_type_string((EdgeType)ctx->successor_types[edge]);
+            
+            if (!first) cfg_emit_literal(emitter, ",");
+            first = false;
+            cfg_emit_literal(emitter, "{\"from\":");
+            cfg_emit_u32(emitter, i);
+            cfg_emit_literal(emitter, ",\"to\":");
+            cfg_emit_u32(emitter, ctx->successors[edge]);
+            cfg_emit_literal(emitter, ",\"type\":\"");
+            cfg_emit(emitter, type, strlen(type));
+            cfg_emit_literal(emitter, "\"}");
+        }
+    }
+    
+    cfg_emit_literal(emitter, "],\"loops\":[");
+    for (uint32_t i = 0; i < ctx->loop_count && !emitter->failed; i++) {
+        const CFGLoop *loop = &ctx->loops[i];
+        if (i > 0) cfg_emit_literal(emitter, ",");
+        cfg_emit_literal(emitter, "{\"header\":");
+        cfg_emit_u32(emitter, loop->header);
+        cfg_emit_literal(emitter, ",\"parent\":");
+        if (loop->parent != CFG_NO_LOOP) {
+            cfg_emit_u32(emitter, loop->parent);
+        } else {
+            cfg_emit_literal(emitter, "null");
+        }
+        cfg_emit_literal(emitter, ",\"depth\":");
+        cfg_emit_u32(emitter, loop->depth);
+        cfg_emit_literal(emitter, ",\"blocks\":");
+        cfg_emit_u32(emitter, loop->block_count);
+        cfg_emit_literal(emitter, ",\"irreducible\":");
+        cfg_emit_bool(emitter, loop->is_irreducible);
+        cfg_emit_literal(emitter, "}");
+    }
+    
+    cfg_emit_literal(emitter, "]}\n");
 }
 
+static bool cfg_export(CFGContext *ctx, void (*emit)(CFGContext*, CFGEmitter*), CFGWriteFunc write, void *context) {
+    if (!ctx || !write) return false;
+    if (!ctx->frozen && !cfg_freeze(ctx)) return false;
+    
+    CFGEmitter *emitter = (CFGEmitter*)malloc(sizeof(CFGEmitter));
+    if (!emitter) return false;
+    
+    emitter->write = write;
+    emitter->context = context;
+    emitter->failed = false;
+    emitter->length = 0;
+    
+    emit(ctx, emitter);
+    cfg_emit_flush(emitter);
+    
+    bool success = !emitter->failed;
+    free(emitter);
+    return success;
+}
+
+static bool cfg_write_file(void *context, const void *data, size_t length) {
+    return fwrite(data, 1, length, (FILE*)context) == length;
+}
+
+bool cfg_export_dot(CFGContext *ctx, FILE *output) {
+    if (!output) return false;
+    return cfg_export(ctx, cfg_emit_dot, cfg_write_file, output);
+}
+
+bool cfg_export_dot_to(CFGContext *ctx, CFGWriteFunc write, void *context) {
+    return cfg_export(ctx, cfg_emit_dot, write, context);
+}
+
+bool cfg_export_json(CFGContext *ctx, FILE *output) {
+    if (!output) return false;
+    return cfg_export(ctx, cfg_emit_json, cfg_write_file, output);
+}
+
+bool cfg_export_json_to(CFGContext *ctx, CFGWriteFunc write, void *context) {
+    return cfg_export(ctx, cfg_emit_json, write, context);
+}
@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "DisassemblyEngine.h"
+#include "FunctionDiscovery.h"
 
 #pragma mark - Basic Block Structure
 
@@ -16,29 +17,68 @@ typedef enum {
     EDGE_RETURN
 } EdgeType;
 
-typedef struct BasicBlock {
+// Blocks are referred to by their index in CFGContext.blocks, loops by
+// their index in CFGContext.loops
+#define CFG_NO_BLOCK UINT32_MAX
+#define CFG_NO_LOOP UINT32_MAX
+
+typedef struct {
     uint64_t start_address;
     uint64_t end_address;
     uint32_t instruction_start;
     uint32_t instruction_count;
     
-    struct BasicBlock **successors;
+    // Ranges of the context's CSR edge arrays, set by cfg_freeze():
+    // successors[successor_start ..] and predecessors[predecessor_start ..]
+    uint32_t successor_start;
     uint32_t successor_count;
-    EdgeType *successor_edge_types;
-    
-    struct BasicBlock **predecessors;
+    uint32_t predecessor_start;
     uint32_t predecessor_count;
     
     bool is_entry;
     bool is_exit;
     bool is_loop_header;
+    
+    // Reachable from the entry; set by cfg_compute_dominance()
     bool visited;
     
-    struct BasicBlock *immediate_dominator;
+    // From cfg_compute_dominance(): CFG_NO_BLOCK for the entry and for
+    // unreachable blocks; dom_level is the depth in the dominator tree
+    // (entry 0)
+    uint32_t immediate_dominator;
     uint32_t dom_level;
     
+    // Innermost loop holding the block, from cfg_detect_loops()
+    uint32_t loop;
+    
 } BasicBlock;
 
+// A loop of the nesting forest from cfg_detect_loops(). A natural loop is
+// its header plus every block reaching a back edge (one whose target
+// dominates its source) without passing the header. An irreducible region
+// is a cycle that can be entered at more than one block: the blocks on
+// cycles through a retreating edge whose target does not dominate its
+// source. Its header is the region's first block in reverse postorder.
+typedef struct {
+    uint32_t header;
+    uint32_t parent;            // CFG_NO_LOOP for an outermost loop
+    uint32_t depth;             // 1 for an outermost loop
+    uint32_t block_count;
+    uint32_t back_edge_count;   // retreating edges, for an irreducible region
+    bool is_irreducible;
+} CFGLoop;
+
+// An edge recorded by cfg_add_edge(), waiting for cfg_freeze()
+typedef struct {
+    uint32_t from;
+    uint32_t to;
+    uint8_t type;   // EdgeType
+} CFGPendingEdge;
+
+// Built in two phases: blocks and edges are collected first (cfg_add_block(),
+// cfg_add_edge()), then cfg_freeze() lays the edges out as compressed sparse
+// rows of block indices in one allocation. Indices stay valid for the life
+// of the context; a frozen graph takes no more blocks or edges.
 typedef struct {
     DisassemblyContext *disasm_ctx;
     
@@ -46,33 +86,134 @@ typedef struct {
     uint32_t block_count;
     uint32_t block_capacity;
     
-    BasicBlock *entry_block;
-    BasicBlock **exit_blocks;
+    // Set when a block was added below an earlier one's start address. Such
+    // a graph gets address_order from cfg_freeze(): block indices by start
+    // address, inside edge_arena. Sorted graphs (cfg_build_function()'s)
+    // leave it NULL and are searched directly.
+    bool blocks_unsorted;
+    uint32_t *address_order;
+    
+    uint32_t entry_block;
+    uint32_t *exit_blocks;
     uint32_t exit_block_count;
     uint64_t function_start;
     uint64_t function_end;
     
+    CFGPendingEdge *pending_edges;
+    uint32_t pending_count;
+    uint32_t pending_capacity;
+    
+    // From cfg_freeze(), all inside edge_arena: successor indices and their
+    // EdgeType, then predecessor indices, each grouped by block in edge order
+    bool frozen;
+    void *edge_arena;
+    uint32_t edge_count;
+    uint32_t *successors;
+    uint8_t *successor_types;
+    uint32_t *predecessors;
+    
+    // Dominance frontiers from cfg_compute_dominance(): block i's frontier is
+    // frontier_blocks[frontier_offsets[i] .. frontier_offsets[i + 1]), as
+    // block indices
+    uint32_t *frontier_offsets;
+    uint32_t *frontier_blocks;
+    
+    // Loop nesting forest from cfg_detect_loops(), parents before children.
+    // Loop i's blocks are a bitset of loop_bitset_words words at
+    // loop_bodies + i * loop_bitset_words.
+    CFGLoop *loops;
+    uint32_t loop_count;
+    uint32_t loop_bitset_words;
+    uint64_t *loop_bodies;
+    
 } CFGContext;
 
+// One independent graph per function of a FunctionList, in the same order.
+// A function without rows has a NULL graph.
+typedef struct {
+    CFGContext **graphs;
+    uint32_t count;
+} CFGList;
+
 #pragma mark - Function Declarations
 
 CFGContext* cfg_create(DisassemblyContext *disasm_ctx);
 
+// Splits the rows in [func_start, func_end) into blocks, links them and
+// freezes the graph. Needs the rows of disasm_all(); only the function's own
+// rows are visited, and branches leaving the function get no edge. Fails on
+// a graph that is already frozen.
 bool cfg_build_function(CFGContext *ctx, uint64_t func_start, uint64_t func_end);
 
+// One graph over all of the code; see cfg_build_functions() for per-function
+// graphs
 uint32_t cfg_build_all(CFGContext *ctx);
 
-BasicBlock* cfg_add_block(CFGContext *ctx, uint64_t start_addr, uint64_t end_addr);
+// Builds a graph for every function on thread_count threads (0 uses every
+// online core), largest functions first. Each graph only reads disasm_ctx,
+// which must stay alive and unchanged while they are in use. Returns NULL
+// when disasm_ctx has no rows or on allocation failure.
+CFGList* cfg_build_functions(DisassemblyContext *disasm_ctx, const FunctionList *functions, uint32_t thread_count);
+
+// Graph of the function holding address; functions is the list the graphs
+// were built from
+CFGContext* cfg_list_find(const CFGList *list, const FunctionList *functions, uint64_t address);
+
+void cfg_list_free(CFGList *list);
+
+// Returns the new block's index, or CFG_NO_BLOCK
+uint32_t cfg_add_block(CFGContext *ctx, uint64_t start_addr, uint64_t end_addr);
+
+// Records an edge between two block indices until cfg_freeze()
+bool cfg_add_edge(CFGContext *ctx, uint32_t from, uint32_t to, EdgeType edge_type);
 
-bool cfg_add_edge(BasicBlock *from, BasicBlock *to, EdgeType edge_type);
+// Builds the CSR edge arrays and the exit block list from the recorded
+// edges and drops them. cfg_build_function() freezes its graph itself.
+bool cfg_freeze(CFGContext *ctx);
 
+// Block holding address, by binary search over start addresses (a linear
+// scan only for an unsorted graph that is not frozen yet)
 BasicBlock* cfg_find_block(CFGContext *ctx, uint64_t address);
 
+// Immediate dominators, dominator tree levels and dominance frontiers of
+// the blocks reachable from entry_block (Cooper-Harvey-Kennedy over reverse
+// postorder). Near-linear in blocks plus edges; no recursion, so functions
+// with very many blocks are fine. Freezes the graph first if needed.
 bool cfg_compute_dominance(CFGContext *ctx);
 
+// True when block index dominator dominates block (a block dominates
+// itself). Needs cfg_compute_dominance().
+bool cfg_dominates(const CFGContext *ctx, uint32_t dominator, uint32_t block);
+
+// Block indices of block's dominance frontier, or NULL before
+// cfg_compute_dominance()
+const uint32_t* cfg_dominance_frontier(const CFGContext *ctx, uint32_t block, uint32_t *out_count);
+
+// Natural loops from the dominator tree, irreducible regions, and the
+// nesting forest over both; sets is_loop_header and each block's innermost
+// loop. Computes dominance first if needed. Returns the number of loops.
 uint32_t cfg_detect_loops(CFGContext *ctx);
 
+// True when block belongs to loop, including the loops nested in it
+bool cfg_loop_contains(const CFGContext *ctx, uint32_t loop, uint32_t block);
+
+// Receives exporter output in chunks of up to CFG_EXPORT_BUFFER_SIZE bytes;
+// returning false stops the export
+typedef bool (*CFGWriteFunc)(void *context, const void *data, size_t length);
+
+#define CFG_EXPORT_BUFFER_SIZE 16384
+
+// Exporters stream the graph in block index order through a buffer, so
+// their cost is linear in blocks plus edges. They freeze the graph first if
+// needed.
 bool cfg_export_dot(CFGContext *ctx, FILE *output);
+bool cfg_export_dot_to(CFGContext *ctx, CFGWriteFunc write, void *context);
+
+// {"start", "end", "entry", "blocks": [...], "edges": [{"from", "to",
+// "type"}], "loops": [...]}: blocks and loops in index order, addresses as
+// hex strings, "idom" and "loop" null until computed
+bool cfg_export_json(CFGContext *ctx, FILE *output);
+bool cfg_export_json_to(CFGContext *ctx, CFGWriteFunc write, void *context);
 
 const char* cfg_edge_type_string(EdgeType type);
 
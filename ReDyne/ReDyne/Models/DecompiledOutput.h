@@ -3,6 +3,8 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+@class PagedDisassembly;
+
 #pragma mark - Header Information
 
 @interface MachOHeaderModel : NSObject
@@ -16,6 +18,8 @@ NS_ASSUME_NONNULL_BEGIN
 @property (nonatomic, copy, nullable) NSString *minVersion;
 @property (nonatomic, copy, nullable) NSString *sdkVersion;
 @property (nonatomic, assign) BOOL isEncrypted;
+@property (nonatomic, assign) uint64_t sliceOffset;
+@property (nonatomic, assign) uint64_t sliceSize;
 
 @end
 
@@ -81,6 +85,7 @@ NS_ASSUME_NONNULL_BEGIN
 
 @property (nonatomic, assign) uint64_t address;
 @property (nonatomic, copy) NSString *hexBytes;
+@property (nonatomic, assign) uint32_t rawBytes;  // The ARM64 instruction word, 0 for x86_64
 @property (nonatomic, copy) NSString *mnemonic;
 @property (nonatomic, copy) NSString *operands;
 @property (nonatomic, copy) NSString *fullDisassembly;
@@ -120,6 +125,8 @@ NS_ASSUME_NONNULL_BEGIN
 @property (nonatomic, strong) NSArray<SymbolModel *> *symbols;
 @property (nonatomic, strong) NSArray<StringModel *> *strings;
 @property (nonatomic, strong) NSArray<InstructionModel *> *instructions;
+/// __text decoded on demand for the code view; nil when there is none
+@property (nonatomic, strong, nullable) PagedDisassembly *pagedDisassembly;
 @property (nonatomic, strong) NSArray<FunctionModel *> *functions;
 @property (nonatomic, strong, nullable) id xrefAnalysis;
 @property (nonatomic, strong, nullable) id objcAnalysis;
@@ -153,5 +160,18 @@ NS_ASSUME_NONNULL_BEGIN
 
 @end
 
+#pragma mark - Universal Binary Slice
+
+/// One architecture of a universal binary: its output, or the error that stopped it
+@interface SliceOutput : NSObject
+
+@property (nonatomic, copy) NSString *cpuType;
+@property (nonatomic, copy) NSString *cpuSubtype;
+@property (nonatomic, assign) uint64_t sliceOffset;
+@property (nonatomic, strong, nullable) DecompiledOutput *output;
+@property (nonatomic, strong, nullable) NSError *error;
+
+@end
+
 NS_ASSUME_NONNULL_END
 
@@ -371,3 +371,8 @@
 
 @end
 
+#pragma mark - SliceOutput
+
+@implementation SliceOutput
+@end
+
@@ -1,6 +1,10 @@
 #include "DisassemblyEngine.h"
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #pragma mark - String Helpers
 
@@ -47,7 +51,7 @@ const char* arm64_condition_string(uint8_t cond) {
 
 #pragma mark - Context Management
 
-DisassemblyContext* disasm_create(MachOContext *macho_ctx) {
+DisassemblyContext* disasm_create(const MachOContext *macho_ctx) {
     if (!macho_ctx) return NULL;
     
     DisassemblyContext *ctx = (DisassemblyContext*)calloc(1, sizeof(DisassemblyContext));
@@ -70,1052 +74,5866 @@ DisassemblyContext* disasm_create(MachOContext *macho_ctx) {
     return ctx;
 }
 
+static void code_sections_reset(DisassemblyContext *ctx) {
+    free(ctx->sections);
+    free(ctx->stubs);
+    ctx->sections = NULL;
+    ctx->section_count = 0;
+    ctx->stubs = NULL;
+    ctx->stub_count = 0;
+}
+
 void disasm_free(DisassemblyContext *ctx) {
     if (!ctx) return;
-    if (ctx->code_data) free(ctx->code_data);
-    if (ctx->instructions) free(ctx->instructions);
+    disasm_store_clear(ctx);
+    code_sections_reset(ctx);
     free(ctx);
 }
 
 #pragma mark - Code Loading
 
+static void code_section_set(DisassemblySection *section, const SectionInfo *sect, uint64_t base_addr) {
+    memset(section, 0, sizeof(DisassemblySection));
+    memcpy(section->name, sect->sectname, 16);
+    section->address = sect->addr;
+    section->offset = sect->addr - base_addr;
+    section->size = sect->size;
+}
+
 bool disasm_load_section(DisassemblyContext *ctx, const char *section_name) {
     if (!ctx || !ctx->macho_ctx || !section_name) return false;
     
-    MachOContext *mctx = ctx->macho_ctx;
+    const MachOContext *mctx = ctx->macho_ctx;
     
-    for (uint32_t i = 0; i < mctx->section_count; i++) {
-        SectionInfo *sect = &mctx->sections[i];
-        if (strncmp(sect->sectname, section_name, 16) == 0) {
-            ctx->code_size = sect->size;
-            ctx->code_base_addr = sect->addr;
+    const SectionInfo *sect = macho_find_section(mctx, "__TEXT", section_name);
+    if (!sect) sect = macho_find_section(mctx, NULL, section_name);
+    if (!sect) return false;
+    
+    MachOSpan span = macho_section_span(mctx, sect);
+    if (!span.data) return false;
+    
+    code_sections_reset(ctx);
+    ctx->sections = (DisassemblySection*)malloc(sizeof(DisassemblySection));
+    if (!ctx->sections) return false;
+    
+    code_section_set(&ctx->sections[0], sect, sect->addr);
+    ctx->section_count = 1;
+    
+    ctx->code_data = span.data;
+    ctx->code_size = span.size;
+    ctx->code_base_addr = sect->addr;
+    
+    return true;
+}
+
+static bool is_code_section(const SectionInfo *sect) {
+    return (sect->flags & (S_ATTR_PURE_INSTRUCTIONS | S_ATTR_SOME_INSTRUCTIONS)) != 0 &&
+           sect->offset != 0 && sect->size > 0;
+}
+
+static int compare_sections_by_address(const void *a, const void *b) {
+    const SectionInfo *sa = *(const SectionInfo *const *)a;
+    const SectionInfo *sb = *(const SectionInfo *const *)b;
+    if (sa->addr < sb->addr) return -1;
+    if (sa->addr > sb->addr) return 1;
+    return 0;
+}
+
+// Names the stubs of each S_SYMBOL_STUBS section: stub i jumps to the symbol
+// at indirect symbol table entry reserved1 + i
+static bool resolve_stubs(DisassemblyContext *ctx, const SectionInfo *const *code_sects, uint32_t count) {
+    const MachOContext *mctx = ctx->macho_ctx;
+    
+    uint32_t indirect_offset = 0;
+    uint32_t indirect_count = 0;
+    for (uint32_t i = 0; i < mctx->load_command_count; i++) {
+        if (mctx->load_commands[i].cmd != LC_DYSYMTAB) continue;
+        if (mctx->load_commands[i].cmdsize < sizeof(struct dysymtab_command)) return true;
+        
+        struct dysymtab_command dysymtab;
+        memcpy(&dysymtab, mctx->load_commands[i].data, sizeof(dysymtab));
+        indirect_offset = mctx->header.is_swapped ? swap_uint32(dysymtab.indirectsymoff) : dysymtab.indirectsymoff;
+        indirect_count = mctx->header.is_swapped ? swap_uint32(dysymtab.nindirectsyms) : dysymtab.nindirectsyms;
+        break;
+    }
+    
+    uint32_t capacity = 0;
+    for (uint32_t s = 0; s < count; s++) {
+        const SectionInfo *sect = code_sects[s];
+        if ((sect->flags & SECTION_TYPE) == S_SYMBOL_STUBS && sect->reserved2 > 0) {
+            capacity += (uint32_t)(sect->size / sect->reserved2);
+        }
+    }
+    if (capacity == 0 || indirect_count == 0 || mctx->nsyms == 0) return true;
+    
+    ctx->stubs = (DisassemblyStub*)malloc(capacity * sizeof(DisassemblyStub));
+    if (!ctx->stubs) return false;
+    
+    // Sections are sorted, so the stubs come out sorted too
+    for (uint32_t s = 0; s < count; s++) {
+        const SectionInfo *sect = code_sects[s];
+        if ((sect->flags & SECTION_TYPE) != S_SYMBOL_STUBS || sect->reserved2 == 0) continue;
+        
+        uint32_t stubs = (uint32_t)(sect->size / sect->reserved2);
+        for (uint32_t i = 0; i < stubs && sect->reserved1 + i < indirect_count; i++) {
+            uint32_t symbol = macho_read_uint32(mctx, indirect_offset + (uint64_t)(sect->reserved1 + i) * 4);
+            if (symbol & (INDIRECT_SYMBOL_LOCAL | INDIRECT_SYMBOL_ABS)) continue;
+            if (symbol >= mctx->nsyms) continue;
             
-            ctx->code_data = (uint8_t*)malloc(ctx->code_size);
-            if (!ctx->code_data) return false;
+            struct nlist_64 nl;
+            if (!macho_read(mctx, mctx->symtab_offset + (uint64_t)symbol * sizeof(nl), &nl, sizeof(nl))) continue;
             
-            fseek(mctx->file, sect->offset, SEEK_SET);
-            size_t read = fread(ctx->code_data, 1, ctx->code_size, mctx->file);
-            if (read != ctx->code_size) {
-                free(ctx->code_data);
-                ctx->code_data = NULL;
-                return false;
-            }
+            uint32_t strx = mctx->header.is_swapped ? swap_uint32(nl.n_un.n_strx) : nl.n_un.n_strx;
+            if (strx == 0 || strx >= mctx->strsize) continue;
             
-            return true;
+            const char *name = macho_string_at(mctx, (uint64_t)mctx->stroff + strx, NULL);
+            if (!name || !name[0]) continue;
+            
+            DisassemblyStub *stub = &ctx->stubs[ctx->stub_count++];
+            stub->address = sect->addr + (uint64_t)i * sect->reserved2;
+            stub->size = sect->reserved2;
+            stub->name = name;
         }
     }
     
-    return false;
+    return true;
 }
 
-#pragma mark - ARM64 Instruction Decoding
-
-bool arm64_is_prologue(const DisassembledInstruction *inst) {
-    if (strstr(inst->mnemonic, "STP") &&
-        strstr(inst->operands, "X29") && 
-        strstr(inst->operands, "X30") &&
-        strstr(inst->operands, "#-")) {
-        return true;
+bool disasm_load_executable(DisassemblyContext *ctx) {
+    if (!ctx || !ctx->macho_ctx) return false;
+    
+    const MachOContext *mctx = ctx->macho_ctx;
+    
+    // __text decides the segment, and with it the file-to-VM mapping
+    const SectionInfo *anchor = macho_find_section(mctx, "__TEXT", "__text");
+    if (anchor && !is_code_section(anchor)) anchor = NULL;
+    for (uint32_t i = 0; !anchor && i < mctx->section_count; i++) {
+        if (is_code_section(&mctx->sections[i])) anchor = &mctx->sections[i];
     }
-    // don't mark all SUB SP instructions as prologues
-    return false;
+    if (!anchor) return false;
+    
+    const SectionInfo **code_sects = (const SectionInfo**)malloc(mctx->section_count * sizeof(SectionInfo*));
+    if (!code_sects) return false;
+    
+    // Sections that map like the anchor can share one span of the file
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < mctx->section_count; i++) {
+        const SectionInfo *sect = &mctx->sections[i];
+        if (!is_code_section(sect) || strncmp(sect->segname, anchor->segname, 16) != 0) continue;
+        if (sect->addr - sect->offset != anchor->addr - anchor->offset) continue;
+        code_sects[count++] = sect;
+    }
+    qsort(code_sects, count, sizeof(SectionInfo*), compare_sections_by_address);
+    
+    // Overlapping sections would give one address two rows
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (kept > 0 && code_sects[i]->addr < code_sects[kept - 1]->addr + code_sects[kept - 1]->size) continue;
+        code_sects[kept++] = code_sects[i];
+    }
+    count = kept;
+    
+    uint64_t base_addr = code_sects[0]->addr;
+    uint64_t span_size = code_sects[count - 1]->addr + code_sects[count - 1]->size - base_addr;
+    MachOSpan span = macho_span(mctx, code_sects[0]->offset, span_size);
+    
+    code_sections_reset(ctx);
+    ctx->sections = (DisassemblySection*)malloc(count * sizeof(DisassemblySection));
+    
+    bool ok = span.data && span_size <= UINT32_MAX && ctx->sections;
+    if (ok) {
+        for (uint32_t i = 0; i < count; i++) {
+            code_section_set(&ctx->sections[i], code_sects[i], base_addr);
+        }
+        ctx->section_count = count;
+        ok = resolve_stubs(ctx, code_sects, count);
+    }
+    free(code_sects);
+    
+    if (!ok) {
+        code_sections_reset(ctx);
+        return false;
+    }
+    
+    ctx->code_data = span.data;
+    ctx->code_size = span.size;
+    ctx->code_base_addr = base_addr;
+    
+    return true;
 }
 
-bool arm64_is_epilogue(const DisassembledInstruction *inst) {
-    if (strstr(inst->mnemonic, "LDP") && strstr(inst->operands, "X29") && strstr(inst->operands, "X30")) {
-        return true;
+const DisassemblySection* disasm_section_for_address(const DisassemblyContext *ctx, uint64_t address) {
+    if (!ctx) return NULL;
+    
+    for (uint32_t i = 0; i < ctx->section_count; i++) {
+        const DisassemblySection *section = &ctx->sections[i];
+        if (address >= section->address && address - section->address < section->size) return section;
     }
-    if (strcmp(inst->mnemonic, "RET") == 0) {
-        return true;
+    
+    return NULL;
+}
+
+const char* disasm_stub_name(const DisassemblyContext *ctx, uint64_t address) {
+    if (!ctx || ctx->stub_count == 0) return NULL;
+    
+    // Last stub starting at or before address
+    uint32_t low = 0;
+    uint32_t high = ctx->stub_count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (ctx->stubs[mid].address <= address) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
     }
-    return false;
+    if (low == 0) return NULL;
+    
+    const DisassemblyStub *stub = &ctx->stubs[low - 1];
+    return address - stub->address < stub->size ? stub->name : NULL;
 }
 
-bool disasm_arm64(uint32_t bytes, uint64_t address, DisassembledInstruction *inst) {
-    memset(inst, 0, sizeof(DisassembledInstruction));
-    inst->address = address;
-    inst->raw_bytes = bytes;
-    inst->length = 4;
-    inst->is_valid = false;
+#pragma mark - ARM64 Decode Table
+
+// Indexed by ARM64Mnemonic
+static const char *const arm64_mnemonics[ARM64_MNEMONIC_COUNT] = {
+    "B", "BL",
+    "B.EQ", "B.NE", "B.CS", "B.CC", "B.MI", "B.PL", "B.VS", "B.VC", "B.HI", "B.LS", "B.GE", "B.LT",
+    "B.GT", "B.LE", "B.AL", "B.NV",
+    "CBZ", "CBNZ", "TBZ", "TBNZ",
+    "BR", "BLR", "RET",
+    "BRAAZ", "BRABZ", "BLRAAZ", "BLRABZ", "RETAA", "RETAB", "BRAA", "BRAB", "BLRAA", "BLRAB",
+    "ERET", "ERETAA", "ERETAB", "DRPS",
+    "SVC", "HVC", "SMC", "BRK", "HLT", "UDF",
+    "NOP", "YIELD", "WFE", "WFI", "SEV", "SEVL",
+    "XPACLRI", "PACIA1716", "PACIB1716", "AUTIA1716", "AUTIB1716", "ESB", "PSB", "TSB", "CSDB",
+    "PACIAZ", "PACIASP", "PACIBZ", "PACIBSP", "AUTIAZ", "AUTIASP", "AUTIBZ", "AUTIBSP", "BTI",
+    "HINT",
+    "CLREX", "DSB", "DMB", "ISB", "SB", "MSR", "MRS", "SYS", "SYSL",
+    "ADR", "ADRP",
+    "ADD", "ADDS", "SUB", "SUBS", "CMN", "CMP", "MOV", "NEG", "NEGS", "MVN", "TST",
+    "AND", "ORR", "EOR", "ANDS", "BIC", "ORN", "EON", "BICS",
+    "MOVN", "MOVZ", "MOVK",
+    "SBFM", "BFM", "UBFM", "ASR", "LSL", "LSR", "ROR", "SXTB", "SXTH", "SXTW", "UXTB", "UXTH",
+    "SBFX", "UBFX", "SBFIZ", "UBFIZ", "BFI", "BFXIL", "EXTR",
+    "ADC", "ADCS", "SBC", "SBCS", "NGC", "NGCS",
+    "CCMN", "CCMP",
+    "CSEL", "CSINC", "CSINV", "CSNEG", "CSET", "CSETM", "CINC", "CINV", "CNEG",
+    "UDIV", "SDIV", "CRC32B", "CRC32H", "CRC32W", "CRC32X", "CRC32CB", "CRC32CH", "CRC32CW",
+    "CRC32CX", "PACGA",
+    "RBIT", "REV16", "REV32", "REV", "CLZ", "CLS",
+    "PACIA", "PACIB", "PACDA", "PACDB", "AUTIA", "AUTIB", "AUTDA", "AUTDB", "PACIZA", "PACIZB",
+    "PACDZA", "PACDZB", "AUTIZA", "AUTIZB", "AUTDZA", "AUTDZB", "XPACI", "XPACD",
+    "MADD", "MSUB", "MUL", "MNEG", "SMADDL", "SMSUBL", "SMULL", "SMNEGL", "SMULH", "UMADDL",
+    "UMSUBL", "UMULL", "UMNEGL", "UMULH",
+    "STRB", "LDRB", "LDRSB", "STRH", "LDRH", "LDRSH", "STR", "LDR", "LDRSW", "PRFM",
+    "STURB", "LDURB", "LDURSB", "STURH", "LDURH", "LDURSH", "STUR", "LDUR", "LDURSW", "PRFUM",
+    "STTRB", "LDTRB", "LDTRSB", "STTRH", "LDTRH", "LDTRSH", "STTR", "LDTR", "LDTRSW",
+    "LDRAA", "LDRAB",
+    "STP", "LDP", "LDPSW", "STNP", "LDNP",
+    "STXR", "STXRB", "STXRH", "STLXR", "STLXRB", "STLXRH", "LDXR", "LDXRB", "LDXRH", "LDAXR",
+    "LDAXRB", "LDAXRH", "STLLR", "STLLRB", "STLLRH", "STLR", "STLRB", "STLRH", "LDLAR", "LDLARB",
+    "LDLARH", "LDAR", "LDARB", "LDARH",
+    "STXP", "STLXP", "LDXP", "LDAXP",
+    "LDAPR", "LDAPRB", "LDAPRH",
+    "STLURB", "LDAPURB", "LDAPURSB", "STLURH", "LDAPURH", "LDAPURSH", "STLUR", "LDAPUR",
+    "LDAPURSW",
+    "CAS", "CASA", "CASL", "CASAL", "CASB", "CASAB", "CASLB", "CASALB", "CASH", "CASAH", "CASLH",
+    "CASALH",
+    "CASP", "CASPA", "CASPL", "CASPAL",
+    "LDADD", "LDADDA", "LDADDL", "LDADDAL", "LDADDB", "LDADDAB", "LDADDLB", "LDADDALB", "LDADDH",
+    "LDADDAH", "LDADDLH", "LDADDALH",
+    "LDCLR", "LDCLRA", "LDCLRL", "LDCLRAL", "LDCLRB", "LDCLRAB", "LDCLRLB", "LDCLRALB", "LDCLRH",
+    "LDCLRAH", "LDCLRLH", "LDCLRALH",
+    "LDEOR", "LDEORA", "LDEORL", "LDEORAL", "LDEORB", "LDEORAB", "LDEORLB", "LDEORALB", "LDEORH",
+    "LDEORAH", "LDEORLH", "LDEORALH",
+    "LDSET", "LDSETA", "LDSETL", "LDSETAL", "LDSETB", "LDSETAB", "LDSETLB", "LDSETALB", "LDSETH",
+    "LDSETAH", "LDSETLH", "LDSETALH",
+    "LDSMAX", "LDSMAXA", "LDSMAXL", "LDSMAXAL", "LDSMAXB", "LDSMAXAB", "LDSMAXLB", "LDSMAXALB",
+    "LDSMAXH", "LDSMAXAH", "LDSMAXLH", "LDSMAXALH",
+    "LDSMIN", "LDSMINA", "LDSMINL", "LDSMINAL", "LDSMINB", "LDSMINAB", "LDSMINLB", "LDSMINALB",
+    "LDSMINH", "LDSMINAH", "LDSMINLH", "LDSMINALH",
+    "LDUMAX", "LDUMAXA", "LDUMAXL", "LDUMAXAL", "LDUMAXB", "LDUMAXAB", "LDUMAXLB", "LDUMAXALB",
+    "LDUMAXH", "LDUMAXAH", "LDUMAXLH", "LDUMAXALH",
+    "LDUMIN", "LDUMINA", "LDUMINL", "LDUMINAL", "LDUMINB", "LDUMINAB", "LDUMINLB", "LDUMINALB",
+    "LDUMINH", "LDUMINAH", "LDUMINLH", "LDUMINALH",
+    "SWP", "SWPA", "SWPL", "SWPAL", "SWPB", "SWPAB", "SWPLB", "SWPALB", "SWPH", "SWPAH", "SWPLH",
+    "SWPALH",
+    "FMOV", "FABS", "FNEG", "FSQRT", "FCVT", "FRINTN", "FRINTP", "FRINTM", "FRINTZ", "FRINTA",
+    "FRINTX", "FRINTI",
+    "FMUL", "FDIV", "FADD", "FSUB", "FMAX", "FMIN", "FMAXNM", "FMINNM", "FNMUL",
+    "FMADD", "FMSUB", "FNMADD", "FNMSUB",
+    "FCMP", "FCMPE", "FCCMP", "FCCMPE", "FCSEL",
+    "FCVTNS", "FCVTNU", "FCVTPS", "FCVTPU", "FCVTMS", "FCVTMU", "FCVTZS", "FCVTZU", "SCVTF",
+    "UCVTF", "FCVTAS", "FCVTAU",
+    "FJCVTZS",
+    "SHADD", "SQADD", "SRHADD", "SHSUB", "SQSUB", "CMGT", "CMGE", "SSHL", "SQSHL", "SRSHL",
+    "SQRSHL", "SMAX", "SMIN", "SABD", "SABA", "ADD", "CMTST", "MLA", "MUL", "SMAXP", "SMINP",
+    "SQDMULH", "ADDP",
+    "UHADD", "UQADD", "URHADD", "UHSUB", "UQSUB", "CMHI", "CMHS", "USHL", "UQSHL", "URSHL",
+    "UQRSHL", "UMAX", "UMIN", "UABD", "UABA", "SUB", "CMEQ", "MLS", "PMUL", "UMAXP", "UMINP",
+    "SQRDMULH",
+    "AND", "BIC", "ORR", "ORN", "EOR", "BSL", "BIT", "BIF", "MOV", "MVN",
+    "REV64", "REV16", "REV32", "SADDLP", "UADDLP", "SADALP", "UADALP", "SUQADD", "USQADD", "CLS",
+    "CLZ", "CNT", "RBIT", "SQABS", "SQNEG", "ABS", "NEG", "CMLT", "CMLE",
+    "XTN", "XTN2", "SQXTN", "SQXTN2", "SQXTUN", "SQXTUN2", "UQXTN", "UQXTN2", "SHLL", "SHLL2",
+    "FCVTN", "FCVTN2", "FCVTL", "FCVTL2", "FCVTXN", "FCVTXN2",
+    "FMLA", "FMLS", "FMULX", "FABD", "FADDP", "FMAXP", "FMINP", "FMAXNMP", "FMINNMP", "FCMEQ",
+    "FCMGE", "FCMGT", "FCMLE", "FCMLT", "FACGE", "FACGT", "FRECPS", "FRSQRTS", "FRECPE", "FRSQRTE",
+    "FRECPX", "URECPE", "URSQRTE",
+    "SADDLV", "UADDLV", "SMAXV", "UMAXV", "SMINV", "UMINV", "ADDV", "FMAXV", "FMINV", "FMAXNMV",
+    "FMINNMV",
+    "DUP", "SMOV", "UMOV", "MOVI", "MVNI",
+    "SSHR", "USHR", "SSRA", "USRA", "SRSHR", "URSHR", "SRSRA", "URSRA", "SHL", "SLI", "SRI",
+    "SQSHLU",
+    "SHRN", "SHRN2", "RSHRN", "RSHRN2", "SQSHRN", "SQSHRN2", "SQRSHRN", "SQRSHRN2", "SQSHRUN",
+    "SQSHRUN2", "SQRSHRUN", "SQRSHRUN2", "UQSHRN", "UQSHRN2", "UQRSHRN", "UQRSHRN2", "SSHLL",
+    "SSHLL2", "USHLL", "USHLL2", "SXTL", "SXTL2", "UXTL", "UXTL2",
+    "SADDL", "SADDL2", "UADDL", "UADDL2", "SADDW", "SADDW2", "UADDW", "UADDW2", "SSUBL", "SSUBL2",
+    "USUBL", "USUBL2", "SSUBW", "SSUBW2", "USUBW", "USUBW2", "ADDHN", "ADDHN2", "RADDHN",
+    "RADDHN2", "SUBHN", "SUBHN2", "RSUBHN", "RSUBHN2", "SABAL", "SABAL2", "UABAL", "UABAL2",
+    "SABDL", "SABDL2", "UABDL", "UABDL2", "SMLAL", "SMLAL2", "UMLAL", "UMLAL2", "SMLSL", "SMLSL2",
+    "UMLSL", "UMLSL2", "SMULL", "SMULL2", "UMULL", "UMULL2", "SQDMLAL", "SQDMLAL2", "SQDMLSL",
+    "SQDMLSL2", "SQDMULL", "SQDMULL2", "PMULL", "PMULL2",
+    "UZP1", "TRN1", "ZIP1", "UZP2", "TRN2", "ZIP2", "EXT", "TBL", "TBX",
+    "LD1", "LD2", "LD3", "LD4", "ST1", "ST2", "ST3", "ST4", "LD1R", "LD2R", "LD3R", "LD4R",
+    "AESE", "AESD", "AESMC", "AESIMC", "SHA1C", "SHA1P", "SHA1M", "SHA1SU0", "SHA256H", "SHA256H2",
+    "SHA256SU1", "SHA1H", "SHA1SU1", "SHA256SU0",
+    "SIMD",
+    ".word"
+};
+
+typedef enum {
+    ARM64_CLASS_UNALLOCATED,
+    ARM64_CLASS_PC_REL,
+    ARM64_CLASS_ADD_SUB_IMM,
+    ARM64_CLASS_LOGICAL_IMM,
+    ARM64_CLASS_MOVE_WIDE,
+    ARM64_CLASS_BITFIELD,
+    ARM64_CLASS_EXTRACT,
+    ARM64_CLASS_BRANCH_IMM,
+    ARM64_CLASS_BRANCH_COND,
+    ARM64_CLASS_COMPARE_BRANCH,
+    ARM64_CLASS_TEST_BRANCH,
+    ARM64_CLASS_EXCEPTION,
+    ARM64_CLASS_SYSTEM,
+    ARM64_CLASS_BRANCH_REG,
+    ARM64_CLASS_LOAD_STORE_EXCLUSIVE,
+    ARM64_CLASS_LOAD_LITERAL,
+    ARM64_CLASS_LOAD_STORE_PAIR,
+    ARM64_CLASS_LOAD_STORE_REG,
+    ARM64_CLASS_LOAD_STORE_RCPC,
+    ARM64_CLASS_LOGICAL_REG,
+    ARM64_CLASS_ADD_SUB_REG,
+    ARM64_CLASS_ADD_SUB_CARRY,
+    ARM64_CLASS_COND_COMPARE,
+    ARM64_CLASS_COND_SELECT,
+    ARM64_CLASS_DP_1_2_SRC,
+    ARM64_CLASS_DP_3SRC,
+    ARM64_CLASS_FP,
+    ARM64_CLASS_SIMD,
+    ARM64_CLASS_COUNT
+} ARM64DecodeClass;
+
+typedef struct {
+    uint32_t mask;
+    uint32_t value;
+    ARM64DecodeClass decode_class;
+} ARM64ClassPattern;
+
+// Encoding groups of the A64 top-level decode, in priority order; the first
+// match wins. Every mask lies within bits 31:21, so the class of a word is a
+// function of those 11 bits and the lookup table generated from this list is
+// exact. Leaf decoders check the remaining bits and fall back to
+// arm64_decode_unallocated() for reserved encodings.
+static const ARM64ClassPattern arm64_class_patterns[] = {
+    // Data processing (immediate): op0 = 100x
+    { 0x1F000000, 0x10000000, ARM64_CLASS_PC_REL },
+    { 0x1F800000, 0x11000000, ARM64_CLASS_ADD_SUB_IMM },
+    { 0x1F800000, 0x12000000, ARM64_CLASS_LOGICAL_IMM },
+    { 0x1F800000, 0x12800000, ARM64_CLASS_MOVE_WIDE },
+    { 0x1F800000, 0x13000000, ARM64_CLASS_BITFIELD },
+    { 0x1F800000, 0x13800000, ARM64_CLASS_EXTRACT },
     
-    uint8_t op0 = (bytes >> 25) & 0xF;
-    uint8_t op1 = (bytes >> 19) & 0x3F;
+    // Branches, exception generation and system: op0 = 101x
+    { 0x7C000000, 0x14000000, ARM64_CLASS_BRANCH_IMM },
+    { 0xFE000000, 0x54000000, ARM64_CLASS_BRANCH_COND },
+    { 0x7E000000, 0x34000000, ARM64_CLASS_COMPARE_BRANCH },
+    { 0x7E000000, 0x36000000, ARM64_CLASS_TEST_BRANCH },
+    { 0xFF000000, 0xD4000000, ARM64_CLASS_EXCEPTION },
+    { 0xFFC00000, 0xD5000000, ARM64_CLASS_SYSTEM },
+    { 0xFE000000, 0xD6000000, ARM64_CLASS_BRANCH_REG },
     
-    if (((bytes >> 26) & 0x3F) == 0x5 || ((bytes >> 26) & 0x3F) == 0x25) {
-        bool is_link = ((bytes >> 31) & 0x1) == 1;
-        int32_t imm26 = bytes & 0x3FFFFFF;
-        if (imm26 & 0x2000000) imm26 |= 0xFC000000;
-        int64_t offset = (int64_t)imm26 * 4;
-        
-        strcpy(inst->mnemonic, is_link ? "BL" : "B");
-        inst->branch_target = address + offset;
-        inst->branch_offset = offset;
-        inst->has_branch_target = true;
-        inst->has_branch = true;
-        inst->branch_type = is_link ? BRANCH_CALL : BRANCH_UNCONDITIONAL;
-        
-        snprintf(inst->operands, sizeof(inst->operands), "0x%llx", inst->branch_target);
-        inst->category = INST_CATEGORY_BRANCH;
-        inst->is_valid = true;
-        inst->updates_pc = true;
+    // Loads and stores: op0 = x1x0. Advanced SIMD structures go to SIMD.
+    { 0xBE000000, 0x0C000000, ARM64_CLASS_SIMD },
+    { 0x3F000000, 0x08000000, ARM64_CLASS_LOAD_STORE_EXCLUSIVE },
+    { 0x3B000000, 0x18000000, ARM64_CLASS_LOAD_LITERAL },
+    { 0x3A000000, 0x28000000, ARM64_CLASS_LOAD_STORE_PAIR },
+    { 0x3A000000, 0x38000000, ARM64_CLASS_LOAD_STORE_REG },
+    { 0x3F200000, 0x19000000, ARM64_CLASS_LOAD_STORE_RCPC },
+    
+    // Data processing (register): op0 = x101
+    { 0x1F000000, 0x0A000000, ARM64_CLASS_LOGICAL_REG },
+    { 0x1F000000, 0x0B000000, ARM64_CLASS_ADD_SUB_REG },
+    { 0x1FE00000, 0x1A000000, ARM64_CLASS_ADD_SUB_CARRY },
+    { 0x1FE00000, 0x1A400000, ARM64_CLASS_COND_COMPARE },
+    { 0x1FE00000, 0x1A800000, ARM64_CLASS_COND_SELECT },
+    { 0x1FE00000, 0x1AC00000, ARM64_CLASS_DP_1_2_SRC },
+    { 0x1F000000, 0x1B000000, ARM64_CLASS_DP_3SRC },
+    
+    // Scalar floating point, then the rest of op0 = x111
+    { 0x7E000000, 0x1E000000, ARM64_CLASS_FP },
+    { 0x0E000000, 0x0E000000, ARM64_CLASS_SIMD },
+};
+
+#define ARM64_CLASS_KEY_SHIFT 21
+#define ARM64_CLASS_KEY_COUNT (1U << (32 - ARM64_CLASS_KEY_SHIFT))
+
+static uint8_t arm64_class_table[ARM64_CLASS_KEY_COUNT];
+static pthread_once_t arm64_class_table_once = PTHREAD_ONCE_INIT;
+
+static void arm64_build_class_table(void) {
+    size_t pattern_count = sizeof(arm64_class_patterns) / sizeof(arm64_class_patterns[0]);
+    
+    for (uint32_t key = 0; key < ARM64_CLASS_KEY_COUNT; key++) {
+        uint32_t bytes = key << ARM64_CLASS_KEY_SHIFT;
+        uint8_t decode_class = ARM64_CLASS_UNALLOCATED;
         
-        if (is_link) {
-            inst->regs_written = (1U << 30);
+        for (size_t p = 0; p < pattern_count; p++) {
+            if ((bytes & arm64_class_patterns[p].mask) == arm64_class_patterns[p].value) {
+                decode_class = (uint8_t)arm64_class_patterns[p].decode_class;
+                break;
+            }
         }
+        arm64_class_table[key] = decode_class;
     }
+}
+
+static void arm64_decode_table_init(void) {
+    pthread_once(&arm64_class_table_once, arm64_build_class_table);
+}
+
+#pragma mark - ARM64 Operand Builders
+
+#define ARM64_CONDITION_AL 0xE
+
+#define ARM64_GPR(sf) ((sf) ? ARM64_REG_X : ARM64_REG_W)
+#define ARM64_GPR_SP(sf) ((sf) ? ARM64_REG_SP : ARM64_REG_WSP)
+
+static int64_t arm64_sign_extend(uint32_t value, int bits) {
+    return (int64_t)((uint64_t)value << (64 - bits)) >> (64 - bits);
+}
+
+static void arm64_note_access(ARM64DecodedWord *out, uint8_t reg, uint8_t reg_class, uint8_t access) {
+    if (reg_class > ARM64_REG_SP) return;
+    if (reg == 31 && reg_class <= ARM64_REG_X) return;
     
-    else if (((bytes >> 21) & 0x7FF) >= 0x6B0 && ((bytes >> 21) & 0x7FF) <= 0x6B3) {
-        uint8_t rn = (bytes >> 5) & 0x1F;
-        uint8_t opc = (bytes >> 21) & 0x3;
-        
-        if (opc == 0) strcpy(inst->mnemonic, "BR");
-        else if (opc == 1) strcpy(inst->mnemonic, "BLR");
-        else if (opc == 2) strcpy(inst->mnemonic, "RET");
-        else strcpy(inst->mnemonic, "BRAA");
-        
-        if (opc == 2 && rn == 30) {
-            strcpy(inst->operands, "");
-        } else {
-            snprintf(inst->operands, sizeof(inst->operands), "%s", arm64_register_name(rn, true));
-        }
-        
-        inst->has_branch = true;
-        inst->branch_type = (opc == 2) ? BRANCH_RETURN : ((opc == 1) ? BRANCH_CALL : BRANCH_UNCONDITIONAL);
-        inst->category = INST_CATEGORY_BRANCH;
-        inst->is_valid = true;
-        inst->updates_pc = true;
-        
-        inst->regs_read = (1U << rn);
-        if (opc == 1) {
-            inst->regs_written = (1U << 30);
-        } else if (opc == 2) {
-            inst->is_function_end = true;
-        }
-    }
-    
-    else if (((bytes >> 22) & 0x3FF) >= 0x290 && ((bytes >> 22) & 0x3FF) <= 0x2BF) {
-        bool is_load = ((bytes >> 22) & 0x1) == 1;
-        bool is_64bit = ((bytes >> 31) & 0x1) == 1;
-        uint8_t rt = bytes & 0x1F;
-        uint8_t rt2 = (bytes >> 10) & 0x1F;
-        uint8_t rn = (bytes >> 5) & 0x1F;
-        int16_t imm7 = (bytes >> 15) & 0x7F;
-        if (imm7 & 0x40) imm7 |= 0xFF80;
-        int32_t offset = (int32_t)imm7 * (is_64bit ? 8 : 4);
-        
-        strcpy(inst->mnemonic, is_load ? "LDP" : "STP");
-        
-        uint8_t idx = (bytes >> 23) & 0x3;
-        if (idx == 0x3) {
-            snprintf(inst->operands, sizeof(inst->operands), "%s, %s, [%s, #%d]!",
-                     arm64_register_name(rt, is_64bit),
-                     arm64_register_name(rt2, is_64bit),
-                     arm64_register_name(rn, true),
-                     offset);
-        } else if (idx == 0x1) {
-            snprintf(inst->operands, sizeof(inst->operands), "%s, %s, [%s], #%d",
-                     arm64_register_name(rt, is_64bit),
-                     arm64_register_name(rt2, is_64bit),
-                     arm64_register_name(rn, true),
-                     offset);
-        } else {
-            snprintf(inst->operands, sizeof(inst->operands), "%s, %s, [%s, #%d]",
-                     arm64_register_name(rt, is_64bit),
-                     arm64_register_name(rt2, is_64bit),
-                     arm64_register_name(rn, true),
-                     offset);
+    uint32_t bit = 1U << reg;
+    if (access & ARM64_READ) out->regs_read |= bit;
+    if (access & ARM64_WRITE) out->regs_written |= bit;
+}
+
+// Clears everything but the operand slots, which arm64_push_operand() zeroes
+// as they are used; the decode loop is too hot for a memset of the whole word
+static void arm64_reset_word(ARM64DecodedWord *out) {
+    out->mnemonic = 0;
+    out->category = INST_CATEGORY_UNKNOWN;
+    out->branch_type = BRANCH_NONE;
+    out->flags = INST_FLAG_VALID;
+    out->condition = ARM64_CONDITION_AL;
+    out->operand_count = 0;
+    out->branch_delta = 0;
+    out->regs_read = 0;
+    out->regs_written = 0;
+}
+
+static ARM64DecodedOperand* arm64_push_operand(ARM64DecodedWord *out, uint8_t kind) {
+    if (out->operand_count >= ARM64_MAX_OPERANDS) {
+        out->operand_count = ARM64_MAX_OPERANDS - 1;
+    }
+    ARM64DecodedOperand *operand = &out->operands[out->operand_count++];
+    *operand = (ARM64DecodedOperand){ .kind = kind };
+    return operand;
+}
+
+static ARM64DecodedOperand* arm64_add_reg(ARM64DecodedWord *out, uint8_t reg, uint8_t reg_class, uint8_t access) {
+    ARM64DecodedOperand *operand = arm64_push_operand(out, ARM64_OPND_REG);
+    operand->reg = reg;
+    operand->reg_class = reg_class;
+    operand->access = access;
+    arm64_note_access(out, reg, reg_class, access);
+    return operand;
+}
+
+static void arm64_add_shifted_reg(ARM64DecodedWord *out, uint8_t reg, uint8_t reg_class, uint8_t shift, uint8_t amount) {
+    ARM64DecodedOperand *operand = arm64_add_reg(out, reg, reg_class, ARM64_READ);
+    if (shift != ARM64_SHIFT_LSL || amount != 0) {
+        operand->shift = shift;
+        operand->shift_amount = amount;
+    }
+}
+
+static ARM64DecodedOperand* arm64_add_imm(ARM64DecodedWord *out, int64_t value) {
+    ARM64DecodedOperand *operand = arm64_push_operand(out, ARM64_OPND_IMM);
+    operand->imm = value;
+    return operand;
+}
+
+static void arm64_add_value(ARM64DecodedWord *out, uint8_t kind, int64_t value) {
+    arm64_push_operand(out, kind)->imm = value;
+}
+
+// Base register reads, plus the write-back of the pre- and post-indexed forms.
+// Memory is read when a transfer register before it is written and written
+// when one is read, so the atomics and CAS get both.
+static ARM64DecodedOperand* arm64_add_mem(ARM64DecodedWord *out, uint8_t base, uint8_t addressing, int64_t offset, uint8_t access_size) {
+    uint8_t memory_access = 0;
+    for (uint8_t i = 0; i < out->operand_count; i++) {
+        if (out->operands[i].kind != ARM64_OPND_REG && out->operands[i].kind != ARM64_OPND_REG_LIST) continue;
+        if (out->operands[i].access & ARM64_WRITE) memory_access |= ARM64_READ;
+        if (out->operands[i].access & ARM64_READ) memory_access |= ARM64_WRITE;
+    }
+    
+    ARM64DecodedOperand *operand = arm64_push_operand(out, ARM64_OPND_MEM);
+    operand->reg = base;
+    operand->addressing = addressing;
+    operand->access_size = access_size;
+    operand->access = memory_access;
+    operand->imm = offset;
+    
+    if (addressing != ARM64_MEM_LITERAL) {
+        bool writeback = addressing == ARM64_MEM_PRE_INDEX || addressing == ARM64_MEM_POST_INDEX ||
+                         addressing == ARM64_MEM_POST_INDEX_REG;
+        arm64_note_access(out, base, ARM64_REG_SP, writeback ? (ARM64_READ | ARM64_WRITE) : ARM64_READ);
+    }
+    return operand;
+}
+
+// Arrangement of a whole vector of 8 << size bit elements, 64 or 128 bits
+#define ARM64_VEC(size, q) (ARM64_VEC_8B + ((size) << 1) + (q))
+
+static ARM64DecodedOperand* arm64_add_vector(ARM64DecodedWord *out, uint8_t reg, uint8_t arrangement, uint8_t access) {
+    ARM64DecodedOperand *operand = arm64_add_reg(out, reg, ARM64_REG_V, access);
+    operand->arrangement = arrangement;
+    return operand;
+}
+
+// Vn.T[lane] for an element of 8 << size bits
+static void arm64_add_element(ARM64DecodedWord *out, uint8_t reg, uint8_t size, uint8_t lane, uint8_t access) {
+    arm64_add_vector(out, reg, ARM64_VEC_B + size, access)->lane = lane;
+}
+
+static ARM64DecodedOperand* arm64_add_reg_list(ARM64DecodedWord *out, uint8_t reg, uint8_t count, uint8_t arrangement, uint8_t access) {
+    ARM64DecodedOperand *operand = arm64_push_operand(out, ARM64_OPND_REG_LIST);
+    operand->reg = reg;
+    operand->reg_class = ARM64_REG_V;
+    operand->count = count;
+    operand->arrangement = arrangement;
+    operand->access = access;
+    return operand;
+}
+
+static void arm64_set_branch(ARM64DecodedWord *out, BranchType type, int64_t delta) {
+    out->category = INST_CATEGORY_BRANCH;
+    out->branch_type = (uint8_t)type;
+    out->flags |= INST_FLAG_UPDATES_PC | INST_FLAG_HAS_BRANCH | INST_FLAG_HAS_BRANCH_TARGET;
+    out->branch_delta = (int32_t)delta;
+    arm64_add_value(out, ARM64_OPND_LABEL, delta);
+}
+
+static void arm64_set_indirect_branch(ARM64DecodedWord *out, BranchType type) {
+    out->category = INST_CATEGORY_BRANCH;
+    out->branch_type = (uint8_t)type;
+    out->flags |= INST_FLAG_UPDATES_PC | INST_FLAG_HAS_BRANCH;
+    
+    if (type == BRANCH_CALL) {
+        out->regs_written |= (1U << 30);
+    } else if (type == BRANCH_RETURN) {
+        out->flags |= INST_FLAG_FUNCTION_END;
+    }
+}
+
+// Decodes the N:immr:imms bitmask immediate of the logical instructions;
+// false for the reserved encodings
+static bool arm64_decode_bitmask(uint8_t n, uint8_t immr, uint8_t imms, bool sf, uint64_t *out_value) {
+    uint32_t combined = ((uint32_t)n << 6) | (~imms & 0x3F);
+    int len = -1;
+    for (int bit = 6; bit >= 0; bit--) {
+        if (combined & (1U << bit)) {
+            len = bit;
+            break;
         }
-        
-        inst->category = INST_CATEGORY_LOAD_STORE;
-        inst->is_valid = true;
+    }
+    if (len < 1 || (!sf && len > 5)) return false;
+    
+    uint32_t esize = 1U << len;
+    uint32_t levels = esize - 1;
+    uint32_t s = imms & levels;
+    uint32_t r = immr & levels;
+    if (s == levels) return false;
+    
+    uint64_t element_mask = (esize == 64) ? ~0ULL : ((1ULL << esize) - 1);
+    uint64_t element = (1ULL << (s + 1)) - 1;
+    if (r != 0) {
+        element = ((element >> r) | (element << (esize - r))) & element_mask;
+    }
+    
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < 64; i += esize) {
+        value |= element << i;
+    }
+    *out_value = sf ? value : (value & 0xFFFFFFFFULL);
+    return true;
+}
+
+// FMOV (immediate): imm8 = a:b:c:d:efgh encodes +-(16 + efgh) / 16 * 2^e with
+// e in -3..4
+static double arm64_expand_fp_imm(uint8_t imm8) {
+    int exponent = (imm8 & 0x40) ? (int)((imm8 >> 4) & 0x3) - 3 : (int)((imm8 >> 4) & 0x3) + 1;
+    double value = (16 + (imm8 & 0xF)) / 16.0;
+    
+    for (int i = 0; i < exponent; i++) value *= 2;
+    for (int i = 0; i > exponent; i--) value /= 2;
+    return (imm8 & 0x80) ? -value : value;
+}
+
+// Size variant index of the exclusive, ordered and atomic runs: word or
+// doubleword, byte, halfword
+static uint8_t arm64_size_variant(uint8_t size) {
+    return (size == 0) ? 1 : ((size == 1) ? 2 : 0);
+}
+
+#pragma mark - ARM64 Leaf Decoders
+
+// Also the fallback of the other leaves, which may have filled in part of out
+static void arm64_decode_unallocated(uint32_t bytes, ARM64DecodedWord *out) {
+    arm64_reset_word(out);
+    
+    if ((bytes >> 16) == 0) {
+        out->mnemonic = ARM64_MNEMONIC_UDF;
+        out->category = INST_CATEGORY_SYSTEM;
+        arm64_add_imm(out, bytes & 0xFFFF);
+    } else {
+        out->mnemonic = ARM64_MNEMONIC_WORD;
+    }
+}
+
+static void arm64_decode_pc_rel(uint32_t bytes, ARM64DecodedWord *out) {
+    bool is_page = ((bytes >> 31) & 0x1) == 1;
+    uint32_t immlo = (bytes >> 29) & 0x3;
+    uint32_t immhi = (bytes >> 5) & 0x7FFFF;
+    int64_t imm = arm64_sign_extend((immhi << 2) | immlo, 21);
+    
+    out->mnemonic = is_page ? ARM64_MNEMONIC_ADRP : ARM64_MNEMONIC_ADR;
+    out->category = INST_CATEGORY_DATA_PROCESSING;
+    arm64_add_reg(out, bytes & 0x1F, ARM64_REG_X, ARM64_WRITE);
+    arm64_add_value(out, is_page ? ARM64_OPND_PAGE : ARM64_OPND_LABEL, is_page ? imm * 4096 : imm);
+}
+
+static void arm64_decode_add_sub_imm(uint32_t bytes, ARM64DecodedWord *out) {
+    bool sf = ((bytes >> 31) & 0x1) == 1;
+    bool is_sub = ((bytes >> 30) & 0x1) == 1;
+    bool set_flags = ((bytes >> 29) & 0x1) == 1;
+    uint8_t rd = bytes & 0x1F;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint32_t imm12 = (bytes >> 10) & 0xFFF;
+    bool shifted = ((bytes >> 22) & 0x1) == 1;
+    int64_t imm = (int64_t)imm12 << (shifted ? 12 : 0);
+    
+    out->category = INST_CATEGORY_DATA_PROCESSING;
+    
+    if (set_flags && rd == 31) {
+        out->mnemonic = is_sub ? ARM64_MNEMONIC_CMP : ARM64_MNEMONIC_CMN;
+        arm64_add_reg(out, rn, ARM64_GPR_SP(sf), ARM64_READ);
+        arm64_add_imm(out, imm);
+        return;
+    }
+    
+    if (!is_sub && !set_flags && imm == 0 && (rd == 31 || rn == 31)) {
+        out->mnemonic = ARM64_MNEMONIC_MOV;
+        arm64_add_reg(out, rd, ARM64_GPR_SP(sf), ARM64_WRITE);
+        arm64_add_reg(out, rn, ARM64_GPR_SP(sf), ARM64_READ);
+        return;
+    }
+    
+    out->mnemonic = ARM64_MNEMONIC_ADD + (is_sub ? 2 : 0) + (set_flags ? 1 : 0);
+    arm64_add_reg(out, rd, set_flags ? ARM64_GPR(sf) : ARM64_GPR_SP(sf), ARM64_WRITE);
+    arm64_add_reg(out, rn, ARM64_GPR_SP(sf), ARM64_READ);
+    arm64_add_imm(out, imm);
+}
+
+static void arm64_decode_logical_imm(uint32_t bytes, ARM64DecodedWord *out) {
+    bool sf = ((bytes >> 31) & 0x1) == 1;
+    uint8_t opc = (bytes >> 29) & 0x3;
+    uint8_t n = (bytes >> 22) & 0x1;
+    uint8_t immr = (bytes >> 16) & 0x3F;
+    uint8_t imms = (bytes >> 10) & 0x3F;
+    uint8_t rd = bytes & 0x1F;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    
+    uint64_t value;
+    if ((!sf && n) || !arm64_decode_bitmask(n, immr, imms, sf, &value)) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    out->category = INST_CATEGORY_DATA_PROCESSING;
+    
+    if (opc == 3 && rd == 31) {
+        out->mnemonic = ARM64_MNEMONIC_TST;
+        arm64_add_reg(out, rn, ARM64_GPR(sf), ARM64_READ);
+    } else if (opc == 1 && rn == 31) {
+        out->mnemonic = ARM64_MNEMONIC_MOV;
+        arm64_add_reg(out, rd, ARM64_GPR_SP(sf), ARM64_WRITE);
+    } else {
+        out->mnemonic = ARM64_MNEMONIC_AND + opc;
+        arm64_add_reg(out, rd, (opc == 3) ? ARM64_GPR(sf) : ARM64_GPR_SP(sf), ARM64_WRITE);
+        arm64_add_reg(out, rn, ARM64_GPR(sf), ARM64_READ);
+    }
+    arm64_add_value(out, ARM64_OPND_BITMASK, (int64_t)value);
+}
+
+static void arm64_decode_move_wide(uint32_t bytes, ARM64DecodedWord *out) {
+    bool sf = ((bytes >> 31) & 0x1) == 1;
+    uint8_t opc = (bytes >> 29) & 0x3;
+    uint8_t hw = (bytes >> 21) & 0x3;
+    uint8_t rd = bytes & 0x1F;
+    uint64_t imm16 = (bytes >> 5) & 0xFFFF;
+    uint8_t shift = hw * 16;
+    
+    if (opc == 1 || (!sf && hw >= 2)) {
+        arm64_decode_unallocated(bytes, out);
+        return;
     }
     
-    else if ((op0 & 0x8) == 0x8) {
-        uint8_t opc = (bytes >> 29) & 0x7;
+    out->category = INST_CATEGORY_DATA_PROCESSING;
+    
+    // MOVZ and MOVN read as MOV of the value they produce, except where the
+    // alias would be ambiguous
+    bool alias = !(imm16 == 0 && hw != 0);
+    if (opc == 0 && !sf && imm16 == 0xFFFF) alias = false;
+    
+    if (opc != 3 && alias) {
+        int64_t value = (int64_t)(imm16 << shift);
+        if (opc == 0) value = sf ? ~value : (int64_t)(int32_t)~(uint32_t)value;
         
-        if (((bytes >> 23) & 0x3F) == 0x22 || ((bytes >> 23) & 0x3F) == 0x32) {
-            bool is_sub = ((bytes >> 30) & 0x1) == 1;
-            bool is_64bit = ((bytes >> 31) & 0x1) == 1;
-            uint8_t rd = bytes & 0x1F;
-            uint8_t rn = (bytes >> 5) & 0x1F;
-            uint16_t imm12 = (bytes >> 10) & 0xFFF;
-            uint8_t shift = (bytes >> 22) & 0x3;
-            uint32_t imm = imm12 << (shift * 12);
-            
-            strcpy(inst->mnemonic, is_sub ? "SUB" : "ADD");
-            snprintf(inst->operands, sizeof(inst->operands), "%s, %s, #%u",
-                     arm64_register_name(rd, is_64bit),
-                     arm64_register_name(rn, is_64bit),
-                     imm);
-            inst->category = INST_CATEGORY_DATA_PROCESSING;
-            inst->is_valid = true;
-            inst->regs_read = (1U << rn);
-            inst->regs_written = (1U << rd);
-        }
-        else if (((bytes >> 23) & 0x3F) == 0x25 || ((bytes >> 23) & 0x3F) == 0x05 || ((bytes >> 23) & 0x3F) == 0x35) {
-            uint8_t opc = (bytes >> 29) & 0x3;
-            bool is_64bit = ((bytes >> 31) & 0x1) == 1;
-            uint8_t rd = bytes & 0x1F;
-            uint16_t imm16 = (bytes >> 5) & 0xFFFF;
-            
-            if (opc == 0x2) strcpy(inst->mnemonic, "MOVZ");
-            else if (opc == 0x0) strcpy(inst->mnemonic, "MOVN");
-            else if (opc == 0x3) strcpy(inst->mnemonic, "MOVK");
-            else strcpy(inst->mnemonic, "MOV");
-            
-            snprintf(inst->operands, sizeof(inst->operands), "%s, #0x%X",
-                     arm64_register_name(rd, is_64bit), imm16);
-            inst->category = INST_CATEGORY_DATA_PROCESSING;
-            inst->is_valid = true;
-            
-            if (opc == 0x3) {
-                inst->regs_read = (1U << rd);
-                inst->regs_written = (1U << rd);
-            } else {
-                inst->regs_read = 0;
-                inst->regs_written = (1U << rd);
-            }
-        }
+        out->mnemonic = ARM64_MNEMONIC_MOV;
+        arm64_add_reg(out, rd, ARM64_GPR(sf), ARM64_WRITE);
+        arm64_add_imm(out, value);
+        return;
+    }
+    
+    out->mnemonic = (opc == 0) ? ARM64_MNEMONIC_MOVN : ((opc == 2) ? ARM64_MNEMONIC_MOVZ : ARM64_MNEMONIC_MOVK);
+    arm64_add_reg(out, rd, ARM64_GPR(sf), (opc == 3) ? (ARM64_READ | ARM64_WRITE) : ARM64_WRITE);
+    
+    ARM64DecodedOperand *imm = arm64_add_imm(out, (int64_t)imm16);
+    if (shift) {
+        imm->shift = ARM64_SHIFT_LSL;
+        imm->shift_amount = shift;
+    }
+}
+
+static void arm64_decode_bitfield(uint32_t bytes, ARM64DecodedWord *out) {
+    bool sf = ((bytes >> 31) & 0x1) == 1;
+    uint8_t opc = (bytes >> 29) & 0x3;
+    uint8_t n = (bytes >> 22) & 0x1;
+    uint8_t immr = (bytes >> 16) & 0x3F;
+    uint8_t imms = (bytes >> 10) & 0x3F;
+    uint8_t rd = bytes & 0x1F;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t width = sf ? 64 : 32;
+    
+    if (opc == 3 || n != sf || (!sf && (immr >= 32 || imms >= 32))) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    out->category = INST_CATEGORY_DATA_PROCESSING;
+    uint8_t rn_class = ARM64_GPR(sf);
+    int64_t first = -1;
+    int64_t second = -1;
+    
+    if (opc == 0 && imms == width - 1) {
+        out->mnemonic = ARM64_MNEMONIC_ASR;
+        first = immr;
+    } else if (opc == 0 && immr == 0 && (imms == 7 || imms == 15 || (sf && imms == 31))) {
+        out->mnemonic = (imms == 7) ? ARM64_MNEMONIC_SXTB : ((imms == 15) ? ARM64_MNEMONIC_SXTH : ARM64_MNEMONIC_SXTW);
+        rn_class = ARM64_REG_W;
+    } else if (opc == 2 && imms != width - 1 && imms + 1 == immr) {
+        out->mnemonic = ARM64_MNEMONIC_LSL;
+        first = width - 1 - imms;
+    } else if (opc == 2 && imms == width - 1) {
+        out->mnemonic = ARM64_MNEMONIC_LSR;
+        first = immr;
+    } else if (opc == 2 && !sf && immr == 0 && (imms == 7 || imms == 15)) {
+        out->mnemonic = (imms == 7) ? ARM64_MNEMONIC_UXTB : ARM64_MNEMONIC_UXTH;
+    } else if (imms < immr) {
+        // Insert imms + 1 bits at width - immr
+        out->mnemonic = (opc == 0) ? ARM64_MNEMONIC_SBFIZ : ((opc == 1) ? ARM64_MNEMONIC_BFI : ARM64_MNEMONIC_UBFIZ);
+        first = width - immr;
+        second = imms + 1;
+    } else {
+        // Extract imms - immr + 1 bits from immr
+        out->mnemonic = (opc == 0) ? ARM64_MNEMONIC_SBFX : ((opc == 1) ? ARM64_MNEMONIC_BFXIL : ARM64_MNEMONIC_UBFX);
+        first = immr;
+        second = imms - immr + 1;
     }
     
-    else if ((op0 & 0xE) == 0xA) {
+    arm64_add_reg(out, rd, ARM64_GPR(sf), (opc == 1) ? (ARM64_READ | ARM64_WRITE) : ARM64_WRITE);
+    arm64_add_reg(out, rn, rn_class, ARM64_READ);
+    if (first >= 0) arm64_add_imm(out, first);
+    if (second >= 0) arm64_add_imm(out, second);
+}
+
+static void arm64_decode_extract(uint32_t bytes, ARM64DecodedWord *out) {
+    bool sf = ((bytes >> 31) & 0x1) == 1;
+    uint8_t n = (bytes >> 22) & 0x1;
+    uint8_t lsb = (bytes >> 10) & 0x3F;
+    uint8_t rd = bytes & 0x1F;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t rm = (bytes >> 16) & 0x1F;
+    
+    if (((bytes >> 29) & 0x3) != 0 || ((bytes >> 21) & 0x1) != 0 || n != sf || (!sf && lsb >= 32)) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    out->category = INST_CATEGORY_DATA_PROCESSING;
+    out->mnemonic = (rn == rm) ? ARM64_MNEMONIC_ROR : ARM64_MNEMONIC_EXTR;
+    arm64_add_reg(out, rd, ARM64_GPR(sf), ARM64_WRITE);
+    arm64_add_reg(out, rn, ARM64_GPR(sf), ARM64_READ);
+    if (rn != rm) arm64_add_reg(out, rm, ARM64_GPR(sf), ARM64_READ);
+    arm64_add_imm(out, lsb);
+}
+
+static void arm64_decode_branch_imm(uint32_t bytes, ARM64DecodedWord *out) {
+    bool is_link = ((bytes >> 31) & 0x1) == 1;
+    
+    out->mnemonic = is_link ? ARM64_MNEMONIC_BL : ARM64_MNEMONIC_B;
+    arm64_set_branch(out, is_link ? BRANCH_CALL : BRANCH_UNCONDITIONAL, arm64_sign_extend(bytes & 0x3FFFFFF, 26) * 4);
+    
+    if (is_link) {
+        out->regs_written = (1U << 30);
+    }
+}
+
+static void arm64_decode_branch_cond(uint32_t bytes, ARM64DecodedWord *out) {
+    uint8_t cond = bytes & 0xF;
+    
+    // o1 (bit 24) and o0 (bit 4) are both zero in B.cond
+    if (bytes & 0x01000010) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    out->mnemonic = ARM64_MNEMONIC_B_EQ + cond;
+    out->condition = cond;
+    arm64_set_branch(out, (cond >= ARM64_CONDITION_AL) ? BRANCH_UNCONDITIONAL : BRANCH_CONDITIONAL,
+                     arm64_sign_extend((bytes >> 5) & 0x7FFFF, 19) * 4);
+}
+
+static void arm64_decode_compare_branch(uint32_t bytes, ARM64DecodedWord *out) {
+    bool sf = ((bytes >> 31) & 0x1) == 1;
+    bool is_nonzero = ((bytes >> 24) & 0x1) == 1;
+    
+    out->mnemonic = is_nonzero ? ARM64_MNEMONIC_CBNZ : ARM64_MNEMONIC_CBZ;
+    arm64_add_reg(out, bytes & 0x1F, ARM64_GPR(sf), ARM64_READ);
+    arm64_set_branch(out, BRANCH_CONDITIONAL, arm64_sign_extend((bytes >> 5) & 0x7FFFF, 19) * 4);
+}
+
+static void arm64_decode_test_branch(uint32_t bytes, ARM64DecodedWord *out) {
+    uint8_t b5 = (bytes >> 31) & 0x1;
+    bool is_nonzero = ((bytes >> 24) & 0x1) == 1;
+    
+    out->mnemonic = is_nonzero ? ARM64_MNEMONIC_TBNZ : ARM64_MNEMONIC_TBZ;
+    arm64_add_reg(out, bytes & 0x1F, ARM64_GPR(b5), ARM64_READ);
+    arm64_add_imm(out, (b5 << 5) | ((bytes >> 19) & 0x1F));
+    arm64_set_branch(out, BRANCH_CONDITIONAL, arm64_sign_extend((bytes >> 5) & 0x3FFF, 14) * 4);
+}
+
+static void arm64_decode_exception(uint32_t bytes, ARM64DecodedWord *out) {
+    uint8_t opc = (bytes >> 21) & 0x7;
+    uint8_t ll = bytes & 0x3;
+    
+    if (((bytes >> 2) & 0x7) != 0) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    if (opc == 0 && ll != 0) {
+        out->mnemonic = ARM64_MNEMONIC_SVC + ll - 1;
+    } else if (opc == 1 && ll == 0) {
+        out->mnemonic = ARM64_MNEMONIC_BRK;
+    } else if (opc == 2 && ll == 0) {
+        out->mnemonic = ARM64_MNEMONIC_HLT;
+    } else {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    out->category = INST_CATEGORY_SYSTEM;
+    arm64_add_imm(out, (bytes >> 5) & 0xFFFF);
+}
+
+static void arm64_decode_hint(uint8_t hint, ARM64DecodedWord *out) {
+    // Hints 0-5, then the pointer authentication and speculation hints by
+    // their CRm:op2 value
+    static const struct { uint8_t hint; uint16_t mnemonic; } named_hints[] = {
+        { 7, ARM64_MNEMONIC_XPACLRI }, { 8, ARM64_MNEMONIC_PACIA1716 }, { 10, ARM64_MNEMONIC_PACIB1716 },
+        { 12, ARM64_MNEMONIC_AUTIA1716 }, { 14, ARM64_MNEMONIC_AUTIB1716 }, { 16, ARM64_MNEMONIC_ESB },
+        { 17, ARM64_MNEMONIC_PSB }, { 18, ARM64_MNEMONIC_TSB }, { 20, ARM64_MNEMONIC_CSDB },
+        { 24, ARM64_MNEMONIC_PACIAZ }, { 25, ARM64_MNEMONIC_PACIASP }, { 26, ARM64_MNEMONIC_PACIBZ },
+        { 27, ARM64_MNEMONIC_PACIBSP }, { 28, ARM64_MNEMONIC_AUTIAZ }, { 29, ARM64_MNEMONIC_AUTIASP },
+        { 30, ARM64_MNEMONIC_AUTIBZ }, { 31, ARM64_MNEMONIC_AUTIBSP },
+    };
+    
+    out->category = INST_CATEGORY_SYSTEM;
+    
+    if (hint <= 5) {
+        out->mnemonic = ARM64_MNEMONIC_NOP + hint;
+        return;
+    }
+    if (hint >= 32 && hint <= 38 && (hint & 1) == 0) {
+        out->mnemonic = ARM64_MNEMONIC_BTI;
+        return;
+    }
+    
+    for (size_t i = 0; i < sizeof(named_hints) / sizeof(named_hints[0]); i++) {
+        if (named_hints[i].hint != hint) continue;
         
-        if (((bytes >> 24) & 0xFF) == 0x54) {
-            uint8_t cond = bytes & 0xF;
-            int32_t imm19 = (bytes >> 5) & 0x7FFFF;
-            if (imm19 & 0x40000) imm19 |= 0xFFF80000;
-            int64_t offset = (int64_t)imm19 * 4;
-            
-            snprintf(inst->mnemonic, sizeof(inst->mnemonic), "B.%s", arm64_condition_string(cond));
-            inst->branch_target = address + offset;
-            inst->branch_offset = offset;
-            inst->has_branch_target = true;
-            inst->has_branch = true;
-            inst->branch_type = BRANCH_CONDITIONAL;
-            
-            snprintf(inst->operands, sizeof(inst->operands), "0x%llx", inst->branch_target);
-            inst->category = INST_CATEGORY_BRANCH;
-            inst->is_valid = true;
-            inst->updates_pc = true;
-        }
-        else if (((bytes >> 24) & 0x7F) == 0x34 || ((bytes >> 24) & 0x7F) == 0x35) {
-            bool is_cbnz = ((bytes >> 24) & 0x1) == 1;
-            bool is_64bit = ((bytes >> 31) & 0x1) == 1;
-            uint8_t rt = bytes & 0x1F;
-            int32_t imm19 = (bytes >> 5) & 0x7FFFF;
-            if (imm19 & 0x40000) imm19 |= 0xFFF80000;
-            int64_t offset = (int64_t)imm19 * 4;
-            
-            strcpy(inst->mnemonic, is_cbnz ? "CBNZ" : "CBZ");
-            inst->branch_target = address + offset;
-            inst->branch_offset = offset;
-            inst->has_branch_target = true;
-            inst->has_branch = true;
-            inst->branch_type = BRANCH_CONDITIONAL;
-            
-            snprintf(inst->operands, sizeof(inst->operands), "%s, 0x%llx",
-                     arm64_register_name(rt, is_64bit), inst->branch_target);
-            inst->category = INST_CATEGORY_BRANCH;
-            inst->is_valid = true;
-            inst->updates_pc = true;
-            inst->regs_read = (1U << rt);
+        out->mnemonic = named_hints[i].mnemonic;
+        if (hint == 7 || hint >= 24) {
+            // Sign or authenticate LR, against SP for the odd hints from 24
+            out->regs_read = (1U << 30) | ((hint >= 24 && (hint & 1)) ? (1U << 31) : 0);
+            out->regs_written = (1U << 30);
+        } else if (hint >= 8 && hint <= 14) {
+            out->regs_read = (1U << 16) | (1U << 17);
+            out->regs_written = (1U << 17);
         }
+        return;
     }
     
-    else if ((op0 & 0xB) == 0x8) {
-        uint8_t size = (bytes >> 30) & 0x3;
-        
-        if ((bytes >> 24) == 0xB9 || (bytes >> 24) == 0xF9 ||
-            (bytes >> 24) == 0x39 || (bytes >> 24) == 0x79) {
-            bool is_load = ((bytes >> 22) & 0x1) == 1;
-            bool is_64bit = (size == 0x3);
-            uint8_t rt = bytes & 0x1F;
-            uint8_t rn = (bytes >> 5) & 0x1F;
-            uint16_t imm12 = (bytes >> 10) & 0xFFF;
-            uint32_t offset = imm12 << size;
-            
-            strcpy(inst->mnemonic, is_load ? "LDR" : "STR");
-            snprintf(inst->operands, sizeof(inst->operands), "%s, [%s, #%u]",
-                     arm64_register_name(rt, is_64bit),
-                     arm64_register_name(rn, true),
-                     offset);
-            inst->category = INST_CATEGORY_LOAD_STORE;
-            inst->is_valid = true;
+    out->mnemonic = ARM64_MNEMONIC_HINT;
+    arm64_add_imm(out, hint);
+}
+
+static void arm64_decode_system(uint32_t bytes, ARM64DecodedWord *out) {
+    bool is_read = ((bytes >> 21) & 0x1) == 1;
+    uint8_t op0 = (bytes >> 19) & 0x3;
+    uint8_t op1 = (bytes >> 16) & 0x7;
+    uint8_t crn = (bytes >> 12) & 0xF;
+    uint8_t crm = (bytes >> 8) & 0xF;
+    uint8_t op2 = (bytes >> 5) & 0x7;
+    uint8_t rt = bytes & 0x1F;
+    
+    out->category = INST_CATEGORY_SYSTEM;
+    
+    if (op0 >= 2) {
+        out->mnemonic = is_read ? ARM64_MNEMONIC_MRS : ARM64_MNEMONIC_MSR;
+        if (is_read) {
+            arm64_add_reg(out, rt, ARM64_REG_X, ARM64_WRITE);
+            arm64_add_value(out, ARM64_OPND_SYSREG, (bytes >> 5) & 0xFFFF);
+        } else {
+            arm64_add_value(out, ARM64_OPND_SYSREG, (bytes >> 5) & 0xFFFF);
+            arm64_add_reg(out, rt, ARM64_REG_X, ARM64_READ);
         }
-        
-        else if (((bytes >> 21) & 0x7FF) == 0x1C0 || ((bytes >> 21) & 0x7FF) == 0x1C1 ||
-                 ((bytes >> 21) & 0x7FF) == 0x3C0 || ((bytes >> 21) & 0x7FF) == 0x3C1) {
-            bool is_load = ((bytes >> 22) & 0x1) == 1;
-            bool is_64bit = (size >= 0x2);
-            uint8_t rt = bytes & 0x1F;
-            uint8_t rn = (bytes >> 5) & 0x1F;
-            int16_t imm9 = (bytes >> 12) & 0x1FF;
-            if (imm9 & 0x100) imm9 |= 0xFE00;
-            
-            strcpy(inst->mnemonic, is_load ? "LDUR" : "STUR");
-            snprintf(inst->operands, sizeof(inst->operands), "%s, [%s, #%d]",
-                     arm64_register_name(rt, is_64bit),
-                     arm64_register_name(rn, true),
-                     imm9);
-            inst->category = INST_CATEGORY_LOAD_STORE;
-            inst->is_valid = true;
+        return;
+    }
+    
+    if (op0 == 1) {
+        out->mnemonic = is_read ? ARM64_MNEMONIC_SYSL : ARM64_MNEMONIC_SYS;
+        if (is_read) {
+            arm64_add_reg(out, rt, ARM64_REG_X, ARM64_WRITE);
+            arm64_add_value(out, ARM64_OPND_SYS_OP, (bytes >> 5) & 0x3FFF);
+        } else {
+            arm64_add_value(out, ARM64_OPND_SYS_OP, (bytes >> 5) & 0x3FFF);
+            if (rt != 31) arm64_add_reg(out, rt, ARM64_REG_X, ARM64_READ);
         }
-        
-        else if ((bytes >> 24) == 0x18 || (bytes >> 24) == 0x58 ||
-                 (bytes >> 24) == 0x98 || (bytes >> 24) == 0xD8) {
-            uint8_t rt = bytes & 0x1F;
-            int32_t imm19 = (bytes >> 5) & 0x7FFFF;
-            if (imm19 & 0x40000) imm19 |= 0xFFF80000;
-            int64_t offset = (int64_t)imm19 * 4;
-            uint64_t target = address + offset;
-            
-            strcpy(inst->mnemonic, "LDR");
-            snprintf(inst->operands, sizeof(inst->operands), "%s, 0x%llx",
-                     arm64_register_name(rt, true), target);
-            inst->category = INST_CATEGORY_LOAD_STORE;
-            inst->is_valid = true;
-        }
-    }
-    
-    else if ((op0 & 0xE) == 0xA) {
-        if (((bytes >> 21) & 0xFF) >= 0x0 && ((bytes >> 21) & 0xFF) <= 0x77) {
-            uint8_t opc = (bytes >> 29) & 0x3;
-            bool is_64bit = ((bytes >> 31) & 0x1) == 1;
-            uint8_t rd = bytes & 0x1F;
-            uint8_t rn = (bytes >> 5) & 0x1F;
-            uint8_t rm = (bytes >> 16) & 0x1F;
-            bool N = ((bytes >> 21) & 0x1) == 1;
-            
-            if (opc == 0) strcpy(inst->mnemonic, N ? "BIC" : "AND");
-            else if (opc == 1) strcpy(inst->mnemonic, N ? "ORN" : "ORR");
-            else if (opc == 2) strcpy(inst->mnemonic, N ? "EON" : "EOR");
-            else strcpy(inst->mnemonic, N ? "BICS" : "ANDS");
-            
-            if (!N && opc == 1 && rn == 31) {
-                strcpy(inst->mnemonic, "MOV");
-                snprintf(inst->operands, sizeof(inst->operands), "%s, %s",
-                         arm64_register_name(rd, is_64bit),
-                         arm64_register_name(rm, is_64bit));
-            } else {
-                snprintf(inst->operands, sizeof(inst->operands), "%s, %s, %s",
-                         arm64_register_name(rd, is_64bit),
-                         arm64_register_name(rn, is_64bit),
-                         arm64_register_name(rm, is_64bit));
-            }
-            inst->category = INST_CATEGORY_DATA_PROCESSING;
-            inst->is_valid = true;
+        return;
+    }
+    
+    if (is_read || rt != 31) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    if (crn == 0x2) {
+        arm64_decode_hint((uint8_t)((crm << 3) | op2), out);
+    } else if (crn == 0x3 && op1 == 3 && op2 >= 2 && op2 != 3) {
+        // CLREX, DSB, DMB, ISB, SB
+        out->mnemonic = ARM64_MNEMONIC_CLREX + op2 - 2 - (op2 > 3 ? 1 : 0);
+        if ((op2 == 4 || op2 == 5) || ((op2 == 2 || op2 == 6) && crm != 0xF)) {
+            arm64_add_value(out, (op2 == 4 || op2 == 5) ? ARM64_OPND_BARRIER : ARM64_OPND_IMM, crm);
         }
-        
-        else if (((bytes >> 21) & 0xFF) >= 0x1B && ((bytes >> 21) & 0xFF) <= 0x1F) {
-            bool is_64bit = ((bytes >> 31) & 0x1) == 1;
-            uint8_t rd = bytes & 0x1F;
-            uint8_t rn = (bytes >> 5) & 0x1F;
-            uint8_t rm = (bytes >> 16) & 0x1F;
-            uint8_t ra = (bytes >> 10) & 0x1F;
-            uint8_t op = (bytes >> 21) & 0x7;
-            
-            if (op == 0x0) strcpy(inst->mnemonic, "MADD");
-            else if (op == 0x1) strcpy(inst->mnemonic, "MSUB");
-            else if (op == 0x2) strcpy(inst->mnemonic, "SMULL");
-            else if (op == 0x3) strcpy(inst->mnemonic, "SMULH");
-            else if (op == 0x2) strcpy(inst->mnemonic, "UDIV");
-            else if (op == 0x3) strcpy(inst->mnemonic, "SDIV");
-            else strcpy(inst->mnemonic, "MUL");
-            
-            if (ra == 31 && op == 0x0) {
-                strcpy(inst->mnemonic, "MUL");
-                snprintf(inst->operands, sizeof(inst->operands), "%s, %s, %s",
-                         arm64_register_name(rd, is_64bit),
-                         arm64_register_name(rn, is_64bit),
-                         arm64_register_name(rm, is_64bit));
+    } else if (crn == 0x4) {
+        out->mnemonic = ARM64_MNEMONIC_MSR;
+        arm64_add_value(out, ARM64_OPND_PSTATE, (op1 << 3) | op2);
+        arm64_add_imm(out, crm);
+    } else {
+        arm64_decode_unallocated(bytes, out);
+    }
+}
+
+static void arm64_decode_branch_reg(uint32_t bytes, ARM64DecodedWord *out) {
+    uint8_t opc = (bytes >> 21) & 0xF;
+    uint8_t op2 = (bytes >> 16) & 0x1F;
+    uint8_t op3 = (bytes >> 10) & 0x3F;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t op4 = bytes & 0x1F;
+    
+    // Plain forms have op3 = 0 and op4 = 0; the authenticating ones set op3
+    // to 2 (A key) or 3 (B key) and carry the modifier in op4
+    bool plain = op3 == 0 && op4 == 0;
+    bool pac = (op3 == 2 || op3 == 3);
+    uint8_t key = op3 & 0x1;
+    
+    if (op2 != 0x1F) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    switch (opc) {
+        case 0x0:
+        case 0x1:
+            if (plain) {
+                out->mnemonic = ARM64_MNEMONIC_BR + opc;
+            } else if (pac && op4 == 0x1F) {
+                out->mnemonic = ((opc == 0) ? ARM64_MNEMONIC_BRAAZ : ARM64_MNEMONIC_BLRAAZ) + key;
+            } else {
+                break;
+            }
+            arm64_add_reg(out, rn, ARM64_REG_X, ARM64_READ);
+            arm64_set_indirect_branch(out, (opc == 1) ? BRANCH_CALL : BRANCH_UNCONDITIONAL);
+            return;
+        case 0x2:
+            if (plain) {
+                out->mnemonic = ARM64_MNEMONIC_RET;
+                if (rn != 30) arm64_add_reg(out, rn, ARM64_REG_X, ARM64_READ);
+                else out->regs_read = (1U << 30);
+            } else if (pac && rn == 0x1F && op4 == 0x1F) {
+                out->mnemonic = ARM64_MNEMONIC_RETAA + key;
+                out->regs_read = (1U << 30) | (1U << 31);
+            } else {
+                break;
+            }
+            arm64_set_indirect_branch(out, BRANCH_RETURN);
+            return;
+        case 0x4:
+        case 0x5:
+            if (rn != 0x1F || op4 != 0) break;
+            if (opc == 0x5 && plain) {
+                out->mnemonic = ARM64_MNEMONIC_DRPS;
+            } else if (opc == 0x4 && plain) {
+                out->mnemonic = ARM64_MNEMONIC_ERET;
+            } else {
+                break;
+            }
+            arm64_set_indirect_branch(out, BRANCH_RETURN);
+            return;
+        case 0x8:
+        case 0x9:
+            if (!pac) break;
+            out->mnemonic = ((opc == 0x8) ? ARM64_MNEMONIC_BRAA : ARM64_MNEMONIC_BLRAA) + key;
+            arm64_add_reg(out, rn, ARM64_REG_X, ARM64_READ);
+            arm64_add_reg(out, op4, ARM64_REG_SP, ARM64_READ);
+            arm64_set_indirect_branch(out, (opc == 0x9) ? BRANCH_CALL : BRANCH_UNCONDITIONAL);
+            return;
+        default:
+            break;
+    }
+    
+    // ERETAA and ERETAB have the modifier field set to all ones
+    if (opc == 0x4 && pac && rn == 0x1F && op4 == 0x1F) {
+        out->mnemonic = ARM64_MNEMONIC_ERETAA + key;
+        arm64_set_indirect_branch(out, BRANCH_RETURN);
+        return;
+    }
+    
+    arm64_decode_unallocated(bytes, out);
+}
+
+static void arm64_decode_load_store_exclusive(uint32_t bytes, ARM64DecodedWord *out) {
+    uint8_t size = (bytes >> 30) & 0x3;
+    uint8_t o2 = (bytes >> 23) & 0x1;
+    uint8_t is_load = (bytes >> 22) & 0x1;
+    uint8_t o1 = (bytes >> 21) & 0x1;
+    uint8_t rs = (bytes >> 16) & 0x1F;
+    uint8_t o0 = (bytes >> 15) & 0x1;
+    uint8_t rt2 = (bytes >> 10) & 0x1F;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t rt = bytes & 0x1F;
+    uint8_t reg_class = (size == 3) ? ARM64_REG_X : ARM64_REG_W;
+    uint8_t access = is_load ? ARM64_WRITE : ARM64_READ;
+    
+    out->category = INST_CATEGORY_LOAD_STORE;
+    
+    if (o1 == 0) {
+        // STXR, STLXR, LDXR, LDAXR, then the ordered STLLR, STLR, LDLAR, LDAR
+        uint16_t first = o2 ? ARM64_MNEMONIC_STLLR : ARM64_MNEMONIC_STXR;
+        out->mnemonic = first + ((is_load << 1) | o0) * 3 + arm64_size_variant(size);
+        if (!o2 && !is_load) arm64_add_reg(out, rs, ARM64_REG_W, ARM64_WRITE);
+        arm64_add_reg(out, rt, reg_class, access);
+        // The status register of the stores is not transferred
+        arm64_add_mem(out, rn, ARM64_MEM_OFFSET, 0, 1 << size)->access = is_load ? ARM64_READ : ARM64_WRITE;
+        return;
+    }
+    
+    if (o2 == 0 && size >= 2) {
+        out->mnemonic = ARM64_MNEMONIC_STXP + ((is_load << 1) | o0);
+        if (!is_load) arm64_add_reg(out, rs, ARM64_REG_W, ARM64_WRITE);
+        arm64_add_reg(out, rt, reg_class, access);
+        arm64_add_reg(out, rt2, reg_class, access);
+        arm64_add_mem(out, rn, ARM64_MEM_OFFSET, 0, 2 << size)->access = is_load ? ARM64_READ : ARM64_WRITE;
+        return;
+    }
+    
+    if (rt2 != 0x1F) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    // Compare and swap; the ordering suffix is A for acquire, L for release
+    uint8_t order = (is_load ? 1 : 0) + (o0 ? 2 : 0);
+    
+    if (o2 == 0) {
+        // CASP works on consecutive even/odd pairs, shown by their first register
+        if ((rs & 0x1) || (rt & 0x1)) {
+            arm64_decode_unallocated(bytes, out);
+            return;
+        }
+        
+        uint8_t pair_class = (size & 0x1) ? ARM64_REG_X : ARM64_REG_W;
+        out->mnemonic = ARM64_MNEMONIC_CASP + order;
+        arm64_add_reg(out, rs, pair_class, ARM64_READ | ARM64_WRITE);
+        arm64_note_access(out, (rs + 1) & 0x1F, pair_class, ARM64_READ | ARM64_WRITE);
+        arm64_add_reg(out, rt, pair_class, ARM64_READ);
+        arm64_note_access(out, (rt + 1) & 0x1F, pair_class, ARM64_READ);
+        arm64_add_mem(out, rn, ARM64_MEM_OFFSET, 0, (size & 0x1) ? 16 : 8);
+        return;
+    }
+    
+    out->mnemonic = ARM64_MNEMONIC_CAS + arm64_size_variant(size) * 4 + order;
+    arm64_add_reg(out, rs, reg_class, ARM64_READ | ARM64_WRITE);
+    arm64_add_reg(out, rt, reg_class, ARM64_READ);
+    arm64_add_mem(out, rn, ARM64_MEM_OFFSET, 0, 1 << size);
+}
+
+static void arm64_decode_load_literal(uint32_t bytes, ARM64DecodedWord *out) {
+    uint8_t opc = (bytes >> 30) & 0x3;
+    bool is_simd = ((bytes >> 26) & 0x1) == 1;
+    uint8_t rt = bytes & 0x1F;
+    int64_t delta = arm64_sign_extend((bytes >> 5) & 0x7FFFF, 19) * 4;
+    
+    if (is_simd && opc == 3) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    out->category = INST_CATEGORY_LOAD_STORE;
+    
+    if (is_simd) {
+        out->mnemonic = ARM64_MNEMONIC_LDR;
+        arm64_add_reg(out, rt, ARM64_REG_S + opc, ARM64_WRITE);
+        arm64_add_mem(out, 0, ARM64_MEM_LITERAL, delta, 4 << opc);
+    } else if (opc == 3) {
+        out->mnemonic = ARM64_MNEMONIC_PRFM;
+        arm64_add_value(out, ARM64_OPND_PREFETCH, rt);
+        arm64_add_mem(out, 0, ARM64_MEM_LITERAL, delta, 0);
+    } else {
+        out->mnemonic = (opc == 2) ? ARM64_MNEMONIC_LDRSW : ARM64_MNEMONIC_LDR;
+        arm64_add_reg(out, rt, (opc == 0) ? ARM64_REG_W : ARM64_REG_X, ARM64_WRITE);
+        arm64_add_mem(out, 0, ARM64_MEM_LITERAL, delta, (opc == 1) ? 8 : 4);
+    }
+}
+
+static void arm64_decode_load_store_pair(uint32_t bytes, ARM64DecodedWord *out) {
+    static const uint8_t pair_addressing[4] = {
+        ARM64_MEM_OFFSET, ARM64_MEM_POST_INDEX, ARM64_MEM_OFFSET, ARM64_MEM_PRE_INDEX
+    };
+    
+    uint8_t opc = (bytes >> 30) & 0x3;
+    bool is_simd = ((bytes >> 26) & 0x1) == 1;
+    uint8_t idx = (bytes >> 23) & 0x3;
+    bool is_load = ((bytes >> 22) & 0x1) == 1;
+    uint8_t rt = bytes & 0x1F;
+    uint8_t rt2 = (bytes >> 10) & 0x1F;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    int64_t imm7 = arm64_sign_extend((bytes >> 15) & 0x7F, 7);
+    
+    uint8_t reg_class;
+    uint8_t scale;
+    if (is_simd && opc != 3) {
+        reg_class = ARM64_REG_S + opc;
+        scale = 2 + opc;
+    } else if (!is_simd && (opc == 0 || opc == 2)) {
+        reg_class = (opc == 2) ? ARM64_REG_X : ARM64_REG_W;
+        scale = (opc == 2) ? 3 : 2;
+    } else if (!is_simd && opc == 1 && is_load && idx != 0) {
+        reg_class = ARM64_REG_X;
+        scale = 2;
+    } else {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    int64_t offset = imm7 * (1 << scale);
+    
+    if (!is_simd && opc == 1) {
+        out->mnemonic = ARM64_MNEMONIC_LDPSW;
+    } else {
+        out->mnemonic = ((idx == 0) ? ARM64_MNEMONIC_STNP : ARM64_MNEMONIC_STP) + (is_load ? 1 : 0);
+    }
+    out->category = INST_CATEGORY_LOAD_STORE;
+    
+    uint8_t access = is_load ? ARM64_WRITE : ARM64_READ;
+    arm64_add_reg(out, rt, reg_class, access);
+    arm64_add_reg(out, rt2, reg_class, access);
+    arm64_add_mem(out, rn, pair_addressing[idx], offset, 1 << scale);
+    
+    if (is_simd) return;
+    
+    // Frame record save/restore: X29 and X30 both appear among the operands
+    // (the base is always an X register, the pair only in 64-bit form)
+    bool is_64bit = opc == 2;
+    bool has_fp = rn == 29 || (is_64bit && (rt == 29 || rt2 == 29));
+    bool has_lr = rn == 30 || (is_64bit && (rt == 30 || rt2 == 30));
+    if (has_fp && has_lr) {
+        if (is_load) {
+            out->flags |= INST_FLAG_FUNCTION_END;
+        } else if (offset < 0) {
+            out->flags |= INST_FLAG_FUNCTION_START;
+        }
+    }
+}
+
+// LDADD, LDCLR, LDEOR, LDSET, LDSMAX, LDSMIN, LDUMAX, LDUMIN, SWP and LDAPR
+static void arm64_decode_atomic(uint32_t bytes, ARM64DecodedWord *out) {
+    uint8_t size = (bytes >> 30) & 0x3;
+    bool acquire = ((bytes >> 23) & 0x1) == 1;
+    bool release = ((bytes >> 22) & 0x1) == 1;
+    uint8_t rs = (bytes >> 16) & 0x1F;
+    bool o3 = ((bytes >> 15) & 0x1) == 1;
+    uint8_t opc = (bytes >> 12) & 0x7;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t rt = bytes & 0x1F;
+    uint8_t reg_class = (size == 3) ? ARM64_REG_X : ARM64_REG_W;
+    
+    if ((bytes >> 26) & 0x1) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    out->category = INST_CATEGORY_LOAD_STORE;
+    
+    if (o3 && opc == 4 && acquire && !release && rs == 0x1F) {
+        out->mnemonic = ARM64_MNEMONIC_LDAPR + arm64_size_variant(size);
+        arm64_add_reg(out, rt, reg_class, ARM64_WRITE);
+        arm64_add_mem(out, rn, ARM64_MEM_OFFSET, 0, 1 << size);
+        return;
+    }
+    
+    if (o3 && opc != 0) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    uint16_t first = o3 ? ARM64_MNEMONIC_SWP : (ARM64_MNEMONIC_LDADD + opc * 12);
+    out->mnemonic = first + arm64_size_variant(size) * 4 + (acquire ? 1 : 0) + (release ? 2 : 0);
+    arm64_add_reg(out, rs, reg_class, ARM64_READ);
+    arm64_add_reg(out, rt, reg_class, ARM64_WRITE);
+    arm64_add_mem(out, rn, ARM64_MEM_OFFSET, 0, 1 << size);
+}
+
+// LDRAA, LDRAB: authenticated loads with a scaled 10-bit offset
+static void arm64_decode_load_pac(uint32_t bytes, ARM64DecodedWord *out) {
+    if (((bytes >> 30) & 0x3) != 3 || ((bytes >> 26) & 0x1)) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    uint32_t imm10 = (((bytes >> 22) & 0x1) << 9) | ((bytes >> 12) & 0x1FF);
+    bool writeback = ((bytes >> 11) & 0x1) == 1;
+    
+    out->mnemonic = ARM64_MNEMONIC_LDRAA + ((bytes >> 23) & 0x1);
+    out->category = INST_CATEGORY_LOAD_STORE;
+    arm64_add_reg(out, bytes & 0x1F, ARM64_REG_X, ARM64_WRITE);
+    arm64_add_mem(out, (bytes >> 5) & 0x1F, writeback ? ARM64_MEM_PRE_INDEX : ARM64_MEM_OFFSET,
+                  arm64_sign_extend(imm10, 10) * 8, 8);
+}
+
+// Position within the STRB..PRFM run (and the STURB, STTRB and STLURB runs
+// laid out the same way) by size and opc; -1 is unallocated
+static const int8_t arm64_load_store_slots[4][4] = {
+    { 0, 1, 2, 2 },
+    { 3, 4, 5, 5 },
+    { 6, 7, 8, -1 },
+    { 6, 7, 9, -1 },
+};
+
+static void arm64_decode_load_store_reg(uint32_t bytes, ARM64DecodedWord *out) {
+    uint8_t size = (bytes >> 30) & 0x3;
+    bool is_simd = ((bytes >> 26) & 0x1) == 1;
+    bool is_unsigned_offset = ((bytes >> 24) & 0x1) == 1;
+    uint8_t opc = (bytes >> 22) & 0x3;
+    bool is_register = !is_unsigned_offset && ((bytes >> 21) & 0x1);
+    uint8_t mode = (bytes >> 10) & 0x3;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t rt = bytes & 0x1F;
+    
+    if (is_register && mode == 0) {
+        arm64_decode_atomic(bytes, out);
+        return;
+    }
+    if (is_register && (mode & 0x1)) {
+        arm64_decode_load_pac(bytes, out);
+        return;
+    }
+    
+    uint8_t reg_class;
+    uint8_t scale;
+    int8_t slot;
+    if (is_simd) {
+        if (opc >= 2 && size != 0) {
+            arm64_decode_unallocated(bytes, out);
+            return;
+        }
+        scale = (opc >= 2) ? 4 : size;
+        reg_class = ARM64_REG_B + scale;
+        slot = (opc & 0x1) ? 7 : 6;
+    } else {
+        slot = arm64_load_store_slots[size][opc];
+        scale = size;
+        reg_class = (opc == 2 || (opc < 2 && size == 3)) ? ARM64_REG_X : ARM64_REG_W;
+    }
+    
+    uint16_t family = ARM64_MNEMONIC_STRB;
+    uint8_t addressing = ARM64_MEM_OFFSET;
+    int64_t offset = 0;
+    
+    if (is_unsigned_offset) {
+        offset = (int64_t)((bytes >> 10) & 0xFFF) << scale;
+    } else if (!is_register) {
+        offset = arm64_sign_extend((bytes >> 12) & 0x1FF, 9);
+        switch (mode) {
+            case 0: family = ARM64_MNEMONIC_STURB; break;
+            case 1: addressing = ARM64_MEM_POST_INDEX; break;
+            case 2: family = is_simd ? 0 : ARM64_MNEMONIC_STTRB; break;
+            default: addressing = ARM64_MEM_PRE_INDEX; break;
+        }
+        // No prefetch with write-back or unprivileged, no unprivileged SIMD
+        if ((slot == 9 && mode != 0) || family == 0) slot = -1;
+    }
+    
+    if (slot < 0) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    out->mnemonic = family + slot;
+    out->category = INST_CATEGORY_LOAD_STORE;
+    
+    if (slot == 9) {
+        arm64_add_value(out, ARM64_OPND_PREFETCH, rt);
+    } else {
+        arm64_add_reg(out, rt, reg_class, (is_simd ? (opc & 0x1) : opc != 0) ? ARM64_WRITE : ARM64_READ);
+    }
+    
+    if (!is_register) {
+        arm64_add_mem(out, rn, addressing, offset, 1 << scale);
+        return;
+    }
+    
+    // Register offset: option 010 and 110 take a W index (UXTW, SXTW), 011
+    // and 111 an X index (LSL, SXTX)
+    uint8_t option = (bytes >> 13) & 0x7;
+    bool shifted = ((bytes >> 12) & 0x1) == 1;
+    uint8_t rm = (bytes >> 16) & 0x1F;
+    
+    if ((option & 0x2) == 0) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    ARM64DecodedOperand *mem = arm64_add_mem(out, rn, ARM64_MEM_REG_OFFSET, 0, 1 << scale);
+    mem->index = rm;
+    mem->reg_class = (option & 0x1) ? ARM64_REG_X : ARM64_REG_W;
+    mem->shift = (option == 3) ? ARM64_SHIFT_LSL : (ARM64_EXTEND_UXTB + option);
+    mem->shift_amount = shifted ? scale : 0;
+    if (option == 3 && !shifted) mem->shift = ARM64_SHIFT_NONE;
+    arm64_note_access(out, rm, mem->reg_class, ARM64_READ);
+}
+
+// STLUR and LDAPUR (RCPC2): release stores and acquire loads with an
+// unscaled 9-bit offset
+static void arm64_decode_load_store_rcpc(uint32_t bytes, ARM64DecodedWord *out) {
+    uint8_t size = (bytes >> 30) & 0x3;
+    uint8_t opc = (bytes >> 22) & 0x3;
+    int8_t slot = arm64_load_store_slots[size][opc];
+    
+    if (((bytes >> 10) & 0x3) != 0 || slot < 0 || slot == 9) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    out->mnemonic = ARM64_MNEMONIC_STLURB + slot;
+    out->category = INST_CATEGORY_LOAD_STORE;
+    arm64_add_reg(out, bytes & 0x1F, (opc == 2 || (opc < 2 && size == 3)) ? ARM64_REG_X : ARM64_REG_W,
+                  (opc != 0) ? ARM64_WRITE : ARM64_READ);
+    arm64_add_mem(out, (bytes >> 5) & 0x1F, ARM64_MEM_OFFSET, arm64_sign_extend((bytes >> 12) & 0x1FF, 9), 1 << size);
+}
+
+static void arm64_decode_logical_reg(uint32_t bytes, ARM64DecodedWord *out) {
+    bool sf = ((bytes >> 31) & 0x1) == 1;
+    uint8_t opc = (bytes >> 29) & 0x3;
+    uint8_t shift = ARM64_SHIFT_LSL + ((bytes >> 22) & 0x3);
+    bool n = ((bytes >> 21) & 0x1) == 1;
+    uint8_t rm = (bytes >> 16) & 0x1F;
+    uint8_t amount = (bytes >> 10) & 0x3F;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t rd = bytes & 0x1F;
+    uint8_t reg_class = ARM64_GPR(sf);
+    
+    if (!sf && amount >= 32) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    out->category = INST_CATEGORY_DATA_PROCESSING;
+    
+    if (opc == 1 && !n && rn == 31 && amount == 0 && shift == ARM64_SHIFT_LSL) {
+        out->mnemonic = ARM64_MNEMONIC_MOV;
+        arm64_add_reg(out, rd, reg_class, ARM64_WRITE);
+        arm64_add_reg(out, rm, reg_class, ARM64_READ);
+        return;
+    }
+    
+    if (opc == 1 && n && rn == 31) {
+        out->mnemonic = ARM64_MNEMONIC_MVN;
+        arm64_add_reg(out, rd, reg_class, ARM64_WRITE);
+    } else if (opc == 3 && !n && rd == 31) {
+        out->mnemonic = ARM64_MNEMONIC_TST;
+        arm64_add_reg(out, rn, reg_class, ARM64_READ);
+    } else {
+        out->mnemonic = ARM64_MNEMONIC_AND + (n ? 4 : 0) + opc;
+        arm64_add_reg(out, rd, reg_class, ARM64_WRITE);
+        arm64_add_reg(out, rn, reg_class, ARM64_READ);
+    }
+    arm64_add_shifted_reg(out, rm, reg_class, shift, amount);
+}
+
+// Shifted register (bit 21 clear) and extended register forms
+static void arm64_decode_add_sub_reg(uint32_t bytes, ARM64DecodedWord *out) {
+    bool sf = ((bytes >> 31) & 0x1) == 1;
+    bool is_sub = ((bytes >> 30) & 0x1) == 1;
+    bool set_flags = ((bytes >> 29) & 0x1) == 1;
+    bool extended = ((bytes >> 21) & 0x1) == 1;
+    uint8_t rm = (bytes >> 16) & 0x1F;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t rd = bytes & 0x1F;
+    uint8_t reg_class = ARM64_GPR(sf);
+    
+    out->category = INST_CATEGORY_DATA_PROCESSING;
+    
+    if (!extended) {
+        uint8_t shift = (bytes >> 22) & 0x3;
+        uint8_t amount = (bytes >> 10) & 0x3F;
+        
+        if (shift == 3 || (!sf && amount >= 32)) {
+            arm64_decode_unallocated(bytes, out);
+            return;
+        }
+        
+        if (set_flags && rd == 31) {
+            out->mnemonic = is_sub ? ARM64_MNEMONIC_CMP : ARM64_MNEMONIC_CMN;
+            arm64_add_reg(out, rn, reg_class, ARM64_READ);
+        } else if (is_sub && rn == 31) {
+            out->mnemonic = ARM64_MNEMONIC_NEG + (set_flags ? 1 : 0);
+            arm64_add_reg(out, rd, reg_class, ARM64_WRITE);
+        } else {
+            out->mnemonic = ARM64_MNEMONIC_ADD + (is_sub ? 2 : 0) + (set_flags ? 1 : 0);
+            arm64_add_reg(out, rd, reg_class, ARM64_WRITE);
+            arm64_add_reg(out, rn, reg_class, ARM64_READ);
+        }
+        arm64_add_shifted_reg(out, rm, reg_class, ARM64_SHIFT_LSL + shift, amount);
+        return;
+    }
+    
+    uint8_t option = (bytes >> 13) & 0x7;
+    uint8_t amount = (bytes >> 10) & 0x7;
+    
+    if (((bytes >> 22) & 0x3) != 0 || amount > 4) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    // With SP as an operand, LSL stands for the extend matching the width
+    uint8_t extend = ARM64_EXTEND_UXTB + option;
+    bool uses_sp = rn == 31 || (rd == 31 && !set_flags);
+    if (uses_sp && option == (sf ? 3 : 2)) {
+        extend = ARM64_SHIFT_LSL;
+    }
+    
+    if (set_flags && rd == 31) {
+        out->mnemonic = is_sub ? ARM64_MNEMONIC_CMP : ARM64_MNEMONIC_CMN;
+    } else {
+        out->mnemonic = ARM64_MNEMONIC_ADD + (is_sub ? 2 : 0) + (set_flags ? 1 : 0);
+        arm64_add_reg(out, rd, set_flags ? reg_class : ARM64_GPR_SP(sf), ARM64_WRITE);
+    }
+    arm64_add_reg(out, rn, ARM64_GPR_SP(sf), ARM64_READ);
+    arm64_add_shifted_reg(out, rm, (sf && (option & 0x3) == 3) ? ARM64_REG_X : ARM64_REG_W, extend, amount);
+}
+
+static void arm64_decode_add_sub_carry(uint32_t bytes, ARM64DecodedWord *out) {
+    bool sf = ((bytes >> 31) & 0x1) == 1;
+    bool is_sub = ((bytes >> 30) & 0x1) == 1;
+    bool set_flags = ((bytes >> 29) & 0x1) == 1;
+    uint8_t rm = (bytes >> 16) & 0x1F;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t rd = bytes & 0x1F;
+    
+    if (((bytes >> 10) & 0x3F) != 0) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    out->category = INST_CATEGORY_DATA_PROCESSING;
+    
+    if (is_sub && rn == 31) {
+        out->mnemonic = ARM64_MNEMONIC_NGC + (set_flags ? 1 : 0);
+        arm64_add_reg(out, rd, ARM64_GPR(sf), ARM64_WRITE);
+    } else {
+        out->mnemonic = ARM64_MNEMONIC_ADC + (is_sub ? 2 : 0) + (set_flags ? 1 : 0);
+        arm64_add_reg(out, rd, ARM64_GPR(sf), ARM64_WRITE);
+        arm64_add_reg(out, rn, ARM64_GPR(sf), ARM64_READ);
+    }
+    arm64_add_reg(out, rm, ARM64_GPR(sf), ARM64_READ);
+}
+
+static void arm64_decode_cond_compare(uint32_t bytes, ARM64DecodedWord *out) {
+    bool sf = ((bytes >> 31) & 0x1) == 1;
+    bool is_immediate = ((bytes >> 11) & 0x1) == 1;
+    uint8_t field = (bytes >> 16) & 0x1F;
+    uint8_t cond = (bytes >> 12) & 0xF;
+    
+    if (((bytes >> 29) & 0x1) == 0 || ((bytes >> 10) & 0x1) || ((bytes >> 4) & 0x1)) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    out->mnemonic = ARM64_MNEMONIC_CCMN + ((bytes >> 30) & 0x1);
+    out->category = INST_CATEGORY_DATA_PROCESSING;
+    out->condition = cond;
+    arm64_add_reg(out, (bytes >> 5) & 0x1F, ARM64_GPR(sf), ARM64_READ);
+    if (is_immediate) {
+        arm64_add_imm(out, field);
+    } else {
+        arm64_add_reg(out, field, ARM64_GPR(sf), ARM64_READ);
+    }
+    arm64_add_imm(out, bytes & 0xF);
+    arm64_add_value(out, ARM64_OPND_COND, cond);
+}
+
+static void arm64_decode_cond_select(uint32_t bytes, ARM64DecodedWord *out) {
+    bool sf = ((bytes >> 31) & 0x1) == 1;
+    uint8_t op2 = (bytes >> 10) & 0x3;
+    uint8_t rm = (bytes >> 16) & 0x1F;
+    uint8_t cond = (bytes >> 12) & 0xF;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t rd = bytes & 0x1F;
+    uint8_t reg_class = ARM64_GPR(sf);
+    
+    if (((bytes >> 29) & 0x1) || op2 > 1) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    // CSEL, CSINC, CSINV, CSNEG; with both sources equal the last three read
+    // as CINC/CSET, CINV/CSETM and CNEG of the inverted condition
+    uint8_t variant = (((bytes >> 30) & 0x1) << 1) | op2;
+    bool aliased = variant != 0 && rn == rm && (cond & 0xE) != 0xE;
+    
+    out->category = INST_CATEGORY_DATA_PROCESSING;
+    arm64_add_reg(out, rd, reg_class, ARM64_WRITE);
+    
+    if (aliased && rn == 31 && variant != 3) {
+        out->mnemonic = (variant == 1) ? ARM64_MNEMONIC_CSET : ARM64_MNEMONIC_CSETM;
+        cond ^= 1;
+    } else if (aliased) {
+        out->mnemonic = (variant == 1) ? ARM64_MNEMONIC_CINC :
+                        ((variant == 2) ? ARM64_MNEMONIC_CINV : ARM64_MNEMONIC_CNEG);
+        cond ^= 1;
+        arm64_add_reg(out, rn, reg_class, ARM64_READ);
+    } else {
+        out->mnemonic = ARM64_MNEMONIC_CSEL + variant;
+        arm64_add_reg(out, rn, reg_class, ARM64_READ);
+        arm64_add_reg(out, rm, reg_class, ARM64_READ);
+    }
+    
+    out->condition = cond;
+    arm64_add_value(out, ARM64_OPND_COND, cond);
+}
+
+static void arm64_decode_dp_1_2_src(uint32_t bytes, ARM64DecodedWord *out) {
+    static const uint16_t variable_shifts[4] = {
+        ARM64_MNEMONIC_LSL, ARM64_MNEMONIC_LSR, ARM64_MNEMONIC_ASR, ARM64_MNEMONIC_ROR
+    };
+    
+    bool sf = ((bytes >> 31) & 0x1) == 1;
+    bool one_source = ((bytes >> 30) & 0x1) == 1;
+    uint8_t opcode = (bytes >> 10) & 0x3F;
+    uint8_t rm = (bytes >> 16) & 0x1F;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t rd = bytes & 0x1F;
+    uint8_t reg_class = ARM64_GPR(sf);
+    
+    if ((bytes >> 29) & 0x1) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    out->category = INST_CATEGORY_DATA_PROCESSING;
+    
+    if (!one_source) {
+        uint8_t rd_class = reg_class;
+        uint8_t rm_class = reg_class;
+        
+        if (opcode == 0x2 || opcode == 0x3) {
+            out->mnemonic = (opcode == 0x2) ? ARM64_MNEMONIC_UDIV : ARM64_MNEMONIC_SDIV;
+        } else if (opcode >= 0x8 && opcode <= 0xB) {
+            out->mnemonic = variable_shifts[opcode - 0x8];
+        } else if (opcode == 0xC && sf) {
+            out->mnemonic = ARM64_MNEMONIC_PACGA;
+            rm_class = ARM64_REG_SP;
+        } else if (opcode >= 0x10 && opcode <= 0x17 && ((opcode & 0x3) == 3) == sf) {
+            // CRC32B/H/W/X, then CRC32CB/H/W/X; the accumulator is always W
+            out->mnemonic = ARM64_MNEMONIC_CRC32B + (opcode - 0x10);
+            rd_class = ARM64_REG_W;
+            reg_class = ARM64_REG_W;
+        } else {
+            arm64_decode_unallocated(bytes, out);
+            return;
+        }
+        
+        arm64_add_reg(out, rd, rd_class, ARM64_WRITE);
+        arm64_add_reg(out, rn, reg_class, ARM64_READ);
+        arm64_add_reg(out, rm, rm_class, ARM64_READ);
+        return;
+    }
+    
+    if (rm == 0 && opcode <= 5 && (sf || opcode != 3)) {
+        // RBIT, REV16, REV (REV32 in 64-bit form), REV, CLZ, CLS
+        static const uint16_t bit_ops[6] = {
+            ARM64_MNEMONIC_RBIT, ARM64_MNEMONIC_REV16, ARM64_MNEMONIC_REV32,
+            ARM64_MNEMONIC_REV, ARM64_MNEMONIC_CLZ, ARM64_MNEMONIC_CLS
+        };
+        out->mnemonic = (opcode == 2 && !sf) ? ARM64_MNEMONIC_REV : bit_ops[opcode];
+        arm64_add_reg(out, rd, reg_class, ARM64_WRITE);
+        arm64_add_reg(out, rn, reg_class, ARM64_READ);
+        return;
+    }
+    
+    if (rm == 1 && sf) {
+        // Pointer authentication: keyed by a modifier in Xn|SP, by zero, or
+        // stripping the code
+        if (opcode < 8) {
+            out->mnemonic = ARM64_MNEMONIC_PACIA + opcode;
+            arm64_add_reg(out, rd, ARM64_REG_X, ARM64_READ | ARM64_WRITE);
+            arm64_add_reg(out, rn, ARM64_REG_SP, ARM64_READ);
+            return;
+        }
+        if (opcode < 18 && rn == 31) {
+            out->mnemonic = ARM64_MNEMONIC_PACIZA + (opcode - 8);
+            arm64_add_reg(out, rd, ARM64_REG_X, ARM64_READ | ARM64_WRITE);
+            return;
+        }
+    }
+    
+    arm64_decode_unallocated(bytes, out);
+}
+
+static void arm64_decode_dp_3src(uint32_t bytes, ARM64DecodedWord *out) {
+    bool sf = ((bytes >> 31) & 0x1) == 1;
+    uint8_t op31 = (bytes >> 21) & 0x7;
+    uint8_t o0 = (bytes >> 15) & 0x1;
+    uint8_t rm = (bytes >> 16) & 0x1F;
+    uint8_t ra = (bytes >> 10) & 0x1F;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t rd = bytes & 0x1F;
+    uint8_t reg_class = ARM64_GPR(sf);
+    uint8_t source_class = reg_class;
+    bool has_addend = ra != 31;
+    
+    if (((bytes >> 29) & 0x3) != 0 || (op31 != 0 && !sf)) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    switch (op31) {
+        case 0:
+            // MADD, MSUB, or MUL, MNEG without an addend
+            out->mnemonic = ARM64_MNEMONIC_MADD + (has_addend ? 0 : 2) + o0;
+            break;
+        case 1:
+        case 5:
+            // Widening: SMADDL, SMSUBL, SMULL, SMNEGL and the unsigned forms
+            out->mnemonic = ((op31 == 1) ? ARM64_MNEMONIC_SMADDL : ARM64_MNEMONIC_UMADDL) + (has_addend ? 0 : 2) + o0;
+            source_class = ARM64_REG_W;
+            break;
+        case 2:
+        case 6:
+            if (o0) {
+                arm64_decode_unallocated(bytes, out);
+                return;
+            }
+            out->mnemonic = (op31 == 2) ? ARM64_MNEMONIC_SMULH : ARM64_MNEMONIC_UMULH;
+            has_addend = false;
+            break;
+        default:
+            arm64_decode_unallocated(bytes, out);
+            return;
+    }
+    
+    out->category = INST_CATEGORY_DATA_PROCESSING;
+    arm64_add_reg(out, rd, reg_class, ARM64_WRITE);
+    arm64_add_reg(out, rn, source_class, ARM64_READ);
+    arm64_add_reg(out, rm, source_class, ARM64_READ);
+    if (has_addend) arm64_add_reg(out, ra, reg_class, ARM64_READ);
+}
+
+// Encodings left classified rather than decoded: half-precision arithmetic,
+// dot products, complex numbers, SHA-512, SHA-3 and SM3/SM4, and the reserved
+// gaps between them
+static void arm64_classify_simd(uint32_t bytes, ARM64DecodedWord *out) {
+    (void)bytes;
+    arm64_reset_word(out);
+    out->mnemonic = ARM64_MNEMONIC_SIMD;
+    out->category = INST_CATEGORY_SIMD;
+}
+
+static void arm64_decode_fp_conversion(uint32_t bytes, uint8_t fp_class, ARM64DecodedWord *out) {
+    bool sf = ((bytes >> 31) & 0x1) == 1;
+    uint8_t ftype = (bytes >> 22) & 0x3;
+    uint8_t rmode = (bytes >> 19) & 0x3;
+    uint8_t opcode = (bytes >> 16) & 0x7;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t rd = bytes & 0x1F;
+    
+    if (opcode < 2) {
+        // FCVT{N,P,M,Z}{S,U}: to an integer with the rounding of rmode
+        out->mnemonic = ARM64_MNEMONIC_FCVTNS + rmode * 2 + opcode;
+        arm64_add_reg(out, rd, ARM64_GPR(sf), ARM64_WRITE);
+        arm64_add_reg(out, rn, fp_class, ARM64_READ);
+        return;
+    }
+    
+    if (rmode != 0) {
+        // FJCVTZS: JavaScript conversion of a double, rounding toward zero
+        if (rmode == 3 && opcode == 6 && ftype == 1 && !sf) {
+            out->mnemonic = ARM64_MNEMONIC_FJCVTZS;
+            arm64_add_reg(out, rd, ARM64_REG_W, ARM64_WRITE);
+            arm64_add_reg(out, rn, ARM64_REG_D, ARM64_READ);
+        } else {
+            arm64_classify_simd(bytes, out);
+        }
+        return;
+    }
+    
+    if (opcode == 2 || opcode == 3) {
+        out->mnemonic = ARM64_MNEMONIC_SCVTF + opcode - 2;
+        arm64_add_reg(out, rd, fp_class, ARM64_WRITE);
+        arm64_add_reg(out, rn, ARM64_GPR(sf), ARM64_READ);
+    } else if (opcode == 4 || opcode == 5) {
+        out->mnemonic = ARM64_MNEMONIC_FCVTAS + opcode - 4;
+        arm64_add_reg(out, rd, ARM64_GPR(sf), ARM64_WRITE);
+        arm64_add_reg(out, rn, fp_class, ARM64_READ);
+    } else if (ftype == 3 || (sf ? ftype == 1 : ftype == 0)) {
+        // FMOV between a general and an FP register of the same width
+        out->mnemonic = ARM64_MNEMONIC_FMOV;
+        if (opcode == 6) {
+            arm64_add_reg(out, rd, ARM64_GPR(sf), ARM64_WRITE);
+            arm64_add_reg(out, rn, fp_class, ARM64_READ);
+        } else {
+            arm64_add_reg(out, rd, fp_class, ARM64_WRITE);
+            arm64_add_reg(out, rn, ARM64_GPR(sf), ARM64_READ);
+        }
+    } else {
+        arm64_classify_simd(bytes, out);
+    }
+}
+
+// SCVTF, UCVTF, FCVTZS and FCVTZU with fraction bits (64 - scale)
+static void arm64_decode_fp_fixed_point(uint32_t bytes, uint8_t fp_class, ARM64DecodedWord *out) {
+    bool sf = ((bytes >> 31) & 0x1) == 1;
+    uint8_t rmode = (bytes >> 19) & 0x3;
+    uint8_t opcode = (bytes >> 16) & 0x7;
+    uint8_t scale = (bytes >> 10) & 0x3F;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t rd = bytes & 0x1F;
+    
+    if (opcode > 3 || (rmode == 0) != (opcode >= 2) || (rmode != 0 && rmode != 3) || (!sf && scale < 32)) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    if (opcode >= 2) {
+        out->mnemonic = ARM64_MNEMONIC_SCVTF + opcode - 2;
+        arm64_add_reg(out, rd, fp_class, ARM64_WRITE);
+        arm64_add_reg(out, rn, ARM64_GPR(sf), ARM64_READ);
+    } else {
+        out->mnemonic = ARM64_MNEMONIC_FCVTZS + opcode;
+        arm64_add_reg(out, rd, ARM64_GPR(sf), ARM64_WRITE);
+        arm64_add_reg(out, rn, fp_class, ARM64_READ);
+    }
+    arm64_add_imm(out, 64 - scale);
+}
+
+static void arm64_decode_fp(uint32_t bytes, ARM64DecodedWord *out) {
+    // S, D and H registers by ftype
+    static const uint8_t ftype_classes[4] = { ARM64_REG_S, ARM64_REG_D, 0xFF, ARM64_REG_H };
+    
+    bool sf = ((bytes >> 31) & 0x1) == 1;
+    uint8_t fp_class = ftype_classes[(bytes >> 22) & 0x3];
+    uint8_t rm = (bytes >> 16) & 0x1F;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t rd = bytes & 0x1F;
+    
+    // Conversions to and from general registers are the only forms using sf
+    bool is_conversion = ((bytes >> 21) & 0x1) && ((bytes >> 10) & 0x3F) == 0 && !((bytes >> 24) & 0x1);
+    bool is_fixed_point = !((bytes >> 21) & 0x1) && !((bytes >> 24) & 0x1);
+    
+    if ((bytes & 0xFFFEFC00) == 0x9EAE0000) {
+        // FMOV between an X register and the upper half of a V register
+        out->mnemonic = ARM64_MNEMONIC_FMOV;
+        out->category = INST_CATEGORY_SIMD;
+        if ((bytes >> 16) & 0x1) {
+            arm64_add_element(out, rd, 3, 1, ARM64_WRITE);
+            arm64_add_reg(out, rn, ARM64_REG_X, ARM64_READ);
+        } else {
+            arm64_add_reg(out, rd, ARM64_REG_X, ARM64_WRITE);
+            arm64_add_element(out, rn, 3, 1, ARM64_READ);
+        }
+        return;
+    }
+    
+    if (((bytes >> 29) & 0x1) || fp_class == 0xFF || (sf && !is_conversion && !is_fixed_point)) {
+        arm64_classify_simd(bytes, out);
+        return;
+    }
+    
+    out->category = INST_CATEGORY_SIMD;
+    
+    if (is_fixed_point) {
+        arm64_decode_fp_fixed_point(bytes, fp_class, out);
+        return;
+    }
+    
+    if ((bytes >> 24) & 0x1) {
+        // FMADD, FMSUB, FNMADD, FNMSUB
+        out->mnemonic = ARM64_MNEMONIC_FMADD + (((bytes >> 21) & 0x1) << 1) + ((bytes >> 15) & 0x1);
+        arm64_add_reg(out, rd, fp_class, ARM64_WRITE);
+        arm64_add_reg(out, rn, fp_class, ARM64_READ);
+        arm64_add_reg(out, rm, fp_class, ARM64_READ);
+        arm64_add_reg(out, (bytes >> 10) & 0x1F, fp_class, ARM64_READ);
+        return;
+    }
+    
+    uint8_t cond = (bytes >> 12) & 0xF;
+    
+    switch ((bytes >> 10) & 0x3) {
+        case 1:
+            out->mnemonic = ARM64_MNEMONIC_FCCMP + ((bytes >> 4) & 0x1);
+            out->condition = cond;
+            arm64_add_reg(out, rn, fp_class, ARM64_READ);
+            arm64_add_reg(out, rm, fp_class, ARM64_READ);
+            arm64_add_imm(out, bytes & 0xF);
+            arm64_add_value(out, ARM64_OPND_COND, cond);
+            return;
+        case 2: {
+            uint8_t opcode = (bytes >> 12) & 0xF;
+            if (opcode > 8) break;
+            // FMUL, FDIV, FADD, FSUB, FMAX, FMIN, FMAXNM, FMINNM, FNMUL
+            out->mnemonic = ARM64_MNEMONIC_FMUL + opcode;
+            arm64_add_reg(out, rd, fp_class, ARM64_WRITE);
+            arm64_add_reg(out, rn, fp_class, ARM64_READ);
+            arm64_add_reg(out, rm, fp_class, ARM64_READ);
+            return;
+        }
+        case 3:
+            out->mnemonic = ARM64_MNEMONIC_FCSEL;
+            out->condition = cond;
+            arm64_add_reg(out, rd, fp_class, ARM64_WRITE);
+            arm64_add_reg(out, rn, fp_class, ARM64_READ);
+            arm64_add_reg(out, rm, fp_class, ARM64_READ);
+            arm64_add_value(out, ARM64_OPND_COND, cond);
+            return;
+        default:
+            break;
+    }
+    
+    if (((bytes >> 10) & 0x3) != 0) {
+        arm64_classify_simd(bytes, out);
+        return;
+    }
+    
+    if (is_conversion) {
+        arm64_decode_fp_conversion(bytes, fp_class, out);
+        return;
+    }
+    
+    if (((bytes >> 10) & 0x7) == 0x4 && rn == 0) {
+        double value = arm64_expand_fp_imm((bytes >> 13) & 0xFF);
+        int64_t value_bits;
+        memcpy(&value_bits, &value, sizeof(value_bits));
+        
+        out->mnemonic = ARM64_MNEMONIC_FMOV;
+        arm64_add_reg(out, rd, fp_class, ARM64_WRITE);
+        arm64_add_value(out, ARM64_OPND_FP_IMM, value_bits);
+        return;
+    }
+    
+    if (((bytes >> 10) & 0x3F) == 0x8 && (bytes & 0x7) == 0) {
+        // FCMP, FCMPE against a register or #0.0
+        out->mnemonic = ARM64_MNEMONIC_FCMP + ((bytes >> 4) & 0x1);
+        arm64_add_reg(out, rn, fp_class, ARM64_READ);
+        if ((bytes >> 3) & 0x1) {
+            arm64_add_value(out, ARM64_OPND_FP_IMM, 0);
+        } else {
+            arm64_add_reg(out, rm, fp_class, ARM64_READ);
+        }
+        return;
+    }
+    
+    if (((bytes >> 10) & 0x1F) == 0x10) {
+        uint8_t opcode = (bytes >> 15) & 0x3F;
+        uint8_t rd_class = fp_class;
+        
+        if (opcode <= 3) {
+            // FMOV, FABS, FNEG, FSQRT
+            out->mnemonic = ARM64_MNEMONIC_FMOV + opcode;
+        } else if (opcode == 4 || opcode == 5 || opcode == 7) {
+            out->mnemonic = ARM64_MNEMONIC_FCVT;
+            rd_class = ftype_classes[opcode & 0x3];
+        } else if (opcode >= 8 && opcode <= 15 && opcode != 13) {
+            // FRINTN, P, M, Z, A, then X and I
+            out->mnemonic = ARM64_MNEMONIC_FRINTN + opcode - 8 - (opcode > 13 ? 1 : 0);
+        } else {
+            arm64_classify_simd(bytes, out);
+            return;
+        }
+        
+        if (rd_class == fp_class && out->mnemonic == ARM64_MNEMONIC_FCVT) {
+            arm64_classify_simd(bytes, out);
+            return;
+        }
+        arm64_add_reg(out, rd, rd_class, ARM64_WRITE);
+        arm64_add_reg(out, rn, fp_class, ARM64_READ);
+        return;
+    }
+    
+    arm64_classify_simd(bytes, out);
+}
+
+#pragma mark - ARM64 Advanced SIMD Decoders
+
+// How the operands of an Advanced SIMD operation relate to its size field
+enum {
+    // The destination is also read (MLA, BSL, the accumulating shifts)
+    ARM64_SIMD_ACCUMULATE = 1 << 0,
+    
+    // Operands with twice the element size: the destination of the long
+    // forms, the first source of the wide ones, both sources of the narrow
+    // ones. Unless pairwise, a widened vector is a full 128 bits and the
+    // upper-half form is the "2" mnemonic after the base one.
+    ARM64_SIMD_WIDE_RD = 1 << 1,
+    ARM64_SIMD_WIDE_RN = 1 << 2,
+    ARM64_SIMD_WIDE_RM = 1 << 3,
+    ARM64_SIMD_PAIRWISE = 1 << 4,
+    
+    // Compares against #0 or #0.0
+    ARM64_SIMD_ZERO = 1 << 5,
+    ARM64_SIMD_FLOAT_ZERO = 1 << 6,
+    
+    // Shifts by immediate: left (the amount counts up from the element size),
+    // and the fixed-point conversions, whose amount is the fraction bits
+    ARM64_SIMD_LEFT = 1 << 7,
+    ARM64_SIMD_FIXED_POINT = 1 << 8,
+    
+    // Indexed element: an FP operation, S or D by size
+    ARM64_SIMD_FLOAT = 1 << 9,
+};
+
+#define ARM64_SIMD_LONG ARM64_SIMD_WIDE_RD
+#define ARM64_SIMD_WIDE (ARM64_SIMD_WIDE_RD | ARM64_SIMD_WIDE_RN)
+#define ARM64_SIMD_NARROW (ARM64_SIMD_WIDE_RN | ARM64_SIMD_WIDE_RM)
+#define ARM64_SIMD_WIDENED (ARM64_SIMD_WIDE_RD | ARM64_SIMD_WIDE_RN | ARM64_SIMD_WIDE_RM)
+
+// An entry of the decode tables below. The sizes are masks of the size
+// field values allowed in the vector and the scalar form, none for a form
+// that does not exist; ARM64_MNEMONIC_SIMD marks encodings that are only
+// classified (half precision, dot products, complex arithmetic).
+typedef struct {
+    uint16_t mnemonic;
+    uint8_t vector_sizes;
+    uint8_t scalar_sizes;
+    uint16_t form;
+} ARM64SimdOp;
+
+#define B 0x1
+#define H 0x2
+#define S 0x4
+#define D 0x8
+#define BHS (B | H | S)
+#define HS (H | S)
+#define SD (S | D)
+#define ALL (B | H | S | D)
+#define ACC ARM64_SIMD_ACCUMULATE
+#define CLASSIFY { ARM64_MNEMONIC_SIMD, ALL, ALL, 0 }
+
+// Three registers of the same type by U and opcode; opcode 3 is the bitwise
+// group and 0x18 on the FP operations
+static const ARM64SimdOp arm64_simd_three_same[2][0x18] = {
+    {
+        [0x00] = { ARM64_MNEMONIC_SHADD, BHS, 0, 0 },
+        [0x01] = { ARM64_MNEMONIC_SQADD, ALL, ALL, 0 },
+        [0x02] = { ARM64_MNEMONIC_SRHADD, BHS, 0, 0 },
+        [0x04] = { ARM64_MNEMONIC_SHSUB, BHS, 0, 0 },
+        [0x05] = { ARM64_MNEMONIC_SQSUB, ALL, ALL, 0 },
+        [0x06] = { ARM64_MNEMONIC_CMGT, ALL, D, 0 },
+        [0x07] = { ARM64_MNEMONIC_CMGE, ALL, D, 0 },
+        [0x08] = { ARM64_MNEMONIC_SSHL, ALL, D, 0 },
+        [0x09] = { ARM64_MNEMONIC_SQSHL, ALL, ALL, 0 },
+        [0x0A] = { ARM64_MNEMONIC_SRSHL, ALL, D, 0 },
+        [0x0B] = { ARM64_MNEMONIC_SQRSHL, ALL, ALL, 0 },
+        [0x0C] = { ARM64_MNEMONIC_SMAX, BHS, 0, 0 },
+        [0x0D] = { ARM64_MNEMONIC_SMIN, BHS, 0, 0 },
+        [0x0E] = { ARM64_MNEMONIC_SABD, BHS, 0, 0 },
+        [0x0F] = { ARM64_MNEMONIC_SABA, BHS, 0, ACC },
+        [0x10] = { ARM64_MNEMONIC_ADD_V, ALL, D, 0 },
+        [0x11] = { ARM64_MNEMONIC_CMTST, ALL, D, 0 },
+        [0x12] = { ARM64_MNEMONIC_MLA, BHS, 0, ACC },
+        [0x13] = { ARM64_MNEMONIC_MUL_V, BHS, 0, 0 },
+        [0x14] = { ARM64_MNEMONIC_SMAXP, BHS, 0, 0 },
+        [0x15] = { ARM64_MNEMONIC_SMINP, BHS, 0, 0 },
+        [0x16] = { ARM64_MNEMONIC_SQDMULH, HS, HS, 0 },
+        [0x17] = { ARM64_MNEMONIC_ADDP, ALL, 0, 0 },
+    },
+    {
+        [0x00] = { ARM64_MNEMONIC_UHADD, BHS, 0, 0 },
+        [0x01] = { ARM64_MNEMONIC_UQADD, ALL, ALL, 0 },
+        [0x02] = { ARM64_MNEMONIC_URHADD, BHS, 0, 0 },
+        [0x04] = { ARM64_MNEMONIC_UHSUB, BHS, 0, 0 },
+        [0x05] = { ARM64_MNEMONIC_UQSUB, ALL, ALL, 0 },
+        [0x06] = { ARM64_MNEMONIC_CMHI, ALL, D, 0 },
+        [0x07] = { ARM64_MNEMONIC_CMHS, ALL, D, 0 },
+        [0x08] = { ARM64_MNEMONIC_USHL, ALL, D, 0 },
+        [0x09] = { ARM64_MNEMONIC_UQSHL, ALL, ALL, 0 },
+        [0x0A] = { ARM64_MNEMONIC_URSHL, ALL, D, 0 },
+        [0x0B] = { ARM64_MNEMONIC_UQRSHL, ALL, ALL, 0 },
+        [0x0C] = { ARM64_MNEMONIC_UMAX, BHS, 0, 0 },
+        [0x0D] = { ARM64_MNEMONIC_UMIN, BHS, 0, 0 },
+        [0x0E] = { ARM64_MNEMONIC_UABD, BHS, 0, 0 },
+        [0x0F] = { ARM64_MNEMONIC_UABA, BHS, 0, ACC },
+        [0x10] = { ARM64_MNEMONIC_SUB_V, ALL, D, 0 },
+        [0x11] = { ARM64_MNEMONIC_CMEQ, ALL, D, 0 },
+        [0x12] = { ARM64_MNEMONIC_MLS, BHS, 0, ACC },
+        [0x13] = { ARM64_MNEMONIC_PMUL, B, 0, 0 },
+        [0x14] = { ARM64_MNEMONIC_UMAXP, BHS, 0, 0 },
+        [0x15] = { ARM64_MNEMONIC_UMINP, BHS, 0, 0 },
+        [0x16] = { ARM64_MNEMONIC_SQRDMULH, HS, HS, 0 },
+    },
+};
+
+// FP operations on three registers by U, a (size bit 1) and opcode - 0x18
+static const ARM64SimdOp arm64_simd_fp_three_same[2][2][8] = {
+    {
+        {
+            { ARM64_MNEMONIC_FMAXNM, SD, 0, 0 },
+            { ARM64_MNEMONIC_FMLA, SD, 0, ACC },
+            { ARM64_MNEMONIC_FADD, SD, 0, 0 },
+            { ARM64_MNEMONIC_FMULX, SD, SD, 0 },
+            { ARM64_MNEMONIC_FCMEQ, SD, SD, 0 },
+            { ARM64_MNEMONIC_SIMD, S, 0, 0 },
+            { ARM64_MNEMONIC_FMAX, SD, 0, 0 },
+            { ARM64_MNEMONIC_FRECPS, SD, SD, 0 },
+        },
+        {
+            [0] = { ARM64_MNEMONIC_FMINNM, SD, 0, 0 },
+            [1] = { ARM64_MNEMONIC_FMLS, SD, 0, ACC },
+            [2] = { ARM64_MNEMONIC_FSUB, SD, 0, 0 },
+            [5] = { ARM64_MNEMONIC_SIMD, S, 0, 0 },
+            [6] = { ARM64_MNEMONIC_FMIN, SD, 0, 0 },
+            [7] = { ARM64_MNEMONIC_FRSQRTS, SD, SD, 0 },
+        },
+    },
+    {
+        {
+            [0] = { ARM64_MNEMONIC_FMAXNMP, SD, 0, 0 },
+            [1] = { ARM64_MNEMONIC_SIMD, S, 0, 0 },
+            [2] = { ARM64_MNEMONIC_FADDP, SD, 0, 0 },
+            [3] = { ARM64_MNEMONIC_FMUL, SD, 0, 0 },
+            [4] = { ARM64_MNEMONIC_FCMGE, SD, SD, 0 },
+            [5] = { ARM64_MNEMONIC_FACGE, SD, SD, 0 },
+            [6] = { ARM64_MNEMONIC_FMAXP, SD, 0, 0 },
+            [7] = { ARM64_MNEMONIC_FDIV, SD, 0, 0 },
+        },
+        {
+            [0] = { ARM64_MNEMONIC_FMINNMP, SD, 0, 0 },
+            [1] = { ARM64_MNEMONIC_SIMD, S, 0, 0 },
+            [2] = { ARM64_MNEMONIC_FABD, SD, SD, 0 },
+            [4] = { ARM64_MNEMONIC_FCMGT, SD, SD, 0 },
+            [5] = { ARM64_MNEMONIC_FACGT, SD, SD, 0 },
+            [6] = { ARM64_MNEMONIC_FMINP, SD, 0, 0 },
+        },
+    },
+};
+
+// Three registers of different types by opcode and U
+static const ARM64SimdOp arm64_simd_three_different[15][2] = {
+    { { ARM64_MNEMONIC_SADDL, BHS, 0, ARM64_SIMD_LONG }, { ARM64_MNEMONIC_UADDL, BHS, 0, ARM64_SIMD_LONG } },
+    { { ARM64_MNEMONIC_SADDW, BHS, 0, ARM64_SIMD_WIDE }, { ARM64_MNEMONIC_UADDW, BHS, 0, ARM64_SIMD_WIDE } },
+    { { ARM64_MNEMONIC_SSUBL, BHS, 0, ARM64_SIMD_LONG }, { ARM64_MNEMONIC_USUBL, BHS, 0, ARM64_SIMD_LONG } },
+    { { ARM64_MNEMONIC_SSUBW, BHS, 0, ARM64_SIMD_WIDE }, { ARM64_MNEMONIC_USUBW, BHS, 0, ARM64_SIMD_WIDE } },
+    { { ARM64_MNEMONIC_ADDHN, BHS, 0, ARM64_SIMD_NARROW }, { ARM64_MNEMONIC_RADDHN, BHS, 0, ARM64_SIMD_NARROW } },
+    { { ARM64_MNEMONIC_SABAL, BHS, 0, ARM64_SIMD_LONG | ACC }, { ARM64_MNEMONIC_UABAL, BHS, 0, ARM64_SIMD_LONG | ACC } },
+    { { ARM64_MNEMONIC_SUBHN, BHS, 0, ARM64_SIMD_NARROW }, { ARM64_MNEMONIC_RSUBHN, BHS, 0, ARM64_SIMD_NARROW } },
+    { { ARM64_MNEMONIC_SABDL, BHS, 0, ARM64_SIMD_LONG }, { ARM64_MNEMONIC_UABDL, BHS, 0, ARM64_SIMD_LONG } },
+    { { ARM64_MNEMONIC_SMLAL, BHS, 0, ARM64_SIMD_LONG | ACC }, { ARM64_MNEMONIC_UMLAL, BHS, 0, ARM64_SIMD_LONG | ACC } },
+    { { ARM64_MNEMONIC_SQDMLAL, HS, HS, ARM64_SIMD_LONG | ACC } },
+    { { ARM64_MNEMONIC_SMLSL, BHS, 0, ARM64_SIMD_LONG | ACC }, { ARM64_MNEMONIC_UMLSL, BHS, 0, ARM64_SIMD_LONG | ACC } },
+    { { ARM64_MNEMONIC_SQDMLSL, HS, HS, ARM64_SIMD_LONG | ACC } },
+    { { ARM64_MNEMONIC_SMULL_V, BHS, 0, ARM64_SIMD_LONG }, { ARM64_MNEMONIC_UMULL_V, BHS, 0, ARM64_SIMD_LONG } },
+    { { ARM64_MNEMONIC_SQDMULL, HS, HS, ARM64_SIMD_LONG } },
+    { { ARM64_MNEMONIC_PMULL, B | D, 0, ARM64_SIMD_LONG } },
+};
+
+// Two-register integer operations by U and opcode, up to 0x14; NOT and RBIT
+// (U = 1, opcode 5) share an opcode and are told apart by size
+static const ARM64SimdOp arm64_simd_misc[2][0x15] = {
+    {
+        [0x00] = { ARM64_MNEMONIC_REV64, BHS, 0, 0 },
+        [0x01] = { ARM64_MNEMONIC_REV16_V, B, 0, 0 },
+        [0x02] = { ARM64_MNEMONIC_SADDLP, BHS, 0, ARM64_SIMD_LONG | ARM64_SIMD_PAIRWISE },
+        [0x03] = { ARM64_MNEMONIC_SUQADD, ALL, ALL, ACC },
+        [0x04] = { ARM64_MNEMONIC_CLS_V, BHS, 0, 0 },
+        [0x05] = { ARM64_MNEMONIC_CNT, B, 0, 0 },
+        [0x06] = { ARM64_MNEMONIC_SADALP, BHS, 0, ARM64_SIMD_LONG | ARM64_SIMD_PAIRWISE | ACC },
+        [0x07] = { ARM64_MNEMONIC_SQABS, ALL, ALL, 0 },
+        [0x08] = { ARM64_MNEMONIC_CMGT, ALL, D, ARM64_SIMD_ZERO },
+        [0x09] = { ARM64_MNEMONIC_CMEQ, ALL, D, ARM64_SIMD_ZERO },
+        [0x0A] = { ARM64_MNEMONIC_CMLT, ALL, D, ARM64_SIMD_ZERO },
+        [0x0B] = { ARM64_MNEMONIC_ABS, ALL, D, 0 },
+        [0x12] = { ARM64_MNEMONIC_XTN, BHS, 0, ARM64_SIMD_NARROW },
+        [0x14] = { ARM64_MNEMONIC_SQXTN, BHS, BHS, ARM64_SIMD_NARROW },
+    },
+    {
+        [0x00] = { ARM64_MNEMONIC_REV32_V, B | H, 0, 0 },
+        [0x02] = { ARM64_MNEMONIC_UADDLP, BHS, 0, ARM64_SIMD_LONG | ARM64_SIMD_PAIRWISE },
+        [0x03] = { ARM64_MNEMONIC_USQADD, ALL, ALL, ACC },
+        [0x04] = { ARM64_MNEMONIC_CLZ_V, BHS, 0, 0 },
+        [0x06] = { ARM64_MNEMONIC_UADALP, BHS, 0, ARM64_SIMD_LONG | ARM64_SIMD_PAIRWISE | ACC },
+        [0x07] = { ARM64_MNEMONIC_SQNEG, ALL, ALL, 0 },
+        [0x08] = { ARM64_MNEMONIC_CMGE, ALL, D, ARM64_SIMD_ZERO },
+        [0x09] = { ARM64_MNEMONIC_CMLE, ALL, D, ARM64_SIMD_ZERO },
+        [0x0B] = { ARM64_MNEMONIC_NEG_V, ALL, D, 0 },
+        [0x12] = { ARM64_MNEMONIC_SQXTUN, BHS, BHS, ARM64_SIMD_NARROW },
+        [0x13] = { ARM64_MNEMONIC_SHLL, BHS, 0, ARM64_SIMD_LONG },
+        [0x14] = { ARM64_MNEMONIC_UQXTN, BHS, BHS, ARM64_SIMD_NARROW },
+    },
+};
+
+// Two-register FP operations by U, a (size bit 1) and opcode - 0x0C; FCVTN,
+// FCVTL and FCVTXN (0x16, 0x17) change the element size and are decoded apart
+static const ARM64SimdOp arm64_simd_fp_misc[2][2][0x14] = {
+    {
+        {
+            [0x0C] = { ARM64_MNEMONIC_FRINTN, SD, 0, 0 },
+            [0x0D] = { ARM64_MNEMONIC_FRINTM, SD, 0, 0 },
+            [0x0E] = { ARM64_MNEMONIC_FCVTNS, SD, SD, 0 },
+            [0x0F] = { ARM64_MNEMONIC_FCVTMS, SD, SD, 0 },
+            [0x10] = { ARM64_MNEMONIC_FCVTAS, SD, SD, 0 },
+            [0x11] = { ARM64_MNEMONIC_SCVTF, SD, SD, 0 },
+            [0x12] = { ARM64_MNEMONIC_SIMD, SD, 0, 0 },
+            [0x13] = { ARM64_MNEMONIC_SIMD, SD, 0, 0 },
+        },
+        {
+            [0x00] = { ARM64_MNEMONIC_FCMGT, SD, SD, ARM64_SIMD_FLOAT_ZERO },
+            [0x01] = { ARM64_MNEMONIC_FCMEQ, SD, SD, ARM64_SIMD_FLOAT_ZERO },
+            [0x02] = { ARM64_MNEMONIC_FCMLT, SD, SD, ARM64_SIMD_FLOAT_ZERO },
+            [0x03] = { ARM64_MNEMONIC_FABS, SD, 0, 0 },
+            [0x0C] = { ARM64_MNEMONIC_FRINTP, SD, 0, 0 },
+            [0x0D] = { ARM64_MNEMONIC_FRINTZ, SD, 0, 0 },
+            [0x0E] = { ARM64_MNEMONIC_FCVTPS, SD, SD, 0 },
+            [0x0F] = { ARM64_MNEMONIC_FCVTZS, SD, SD, 0 },
+            [0x10] = { ARM64_MNEMONIC_URECPE, S, 0, 0 },
+            [0x11] = { ARM64_MNEMONIC_FRECPE, SD, SD, 0 },
+            [0x13] = { ARM64_MNEMONIC_FRECPX, 0, SD, 0 },
+        },
+    },
+    {
+        {
+            [0x0C] = { ARM64_MNEMONIC_FRINTA, SD, 0, 0 },
+            [0x0D] = { ARM64_MNEMONIC_FRINTX, SD, 0, 0 },
+            [0x0E] = { ARM64_MNEMONIC_FCVTNU, SD, SD, 0 },
+            [0x0F] = { ARM64_MNEMONIC_FCVTMU, SD, SD, 0 },
+            [0x10] = { ARM64_MNEMONIC_FCVTAU, SD, SD, 0 },
+            [0x11] = { ARM64_MNEMONIC_UCVTF, SD, SD, 0 },
+            [0x12] = { ARM64_MNEMONIC_SIMD, SD, 0, 0 },
+            [0x13] = { ARM64_MNEMONIC_SIMD, SD, 0, 0 },
+        },
+        {
+            [0x00] = { ARM64_MNEMONIC_FCMGE, SD, SD, ARM64_SIMD_FLOAT_ZERO },
+            [0x01] = { ARM64_MNEMONIC_FCMLE, SD, SD, ARM64_SIMD_FLOAT_ZERO },
+            [0x03] = { ARM64_MNEMONIC_FNEG, SD, 0, 0 },
+            [0x0D] = { ARM64_MNEMONIC_FRINTI, SD, 0, 0 },
+            [0x0E] = { ARM64_MNEMONIC_FCVTPU, SD, SD, 0 },
+            [0x0F] = { ARM64_MNEMONIC_FCVTZU, SD, SD, 0 },
+            [0x10] = { ARM64_MNEMONIC_URSQRTE, S, 0, 0 },
+            [0x11] = { ARM64_MNEMONIC_FRSQRTE, SD, SD, 0 },
+            [0x13] = { ARM64_MNEMONIC_FSQRT, SD, 0, 0 },
+        },
+    },
+};
+
+// Shifts by immediate by U and opcode; the size is that of the destination
+// for the narrowing shifts and of the source for the others
+static const ARM64SimdOp arm64_simd_shift[2][0x20] = {
+    {
+        [0x00] = { ARM64_MNEMONIC_SSHR, ALL, D, 0 },
+        [0x02] = { ARM64_MNEMONIC_SSRA, ALL, D, ACC },
+        [0x04] = { ARM64_MNEMONIC_SRSHR, ALL, D, 0 },
+        [0x06] = { ARM64_MNEMONIC_SRSRA, ALL, D, ACC },
+        [0x0A] = { ARM64_MNEMONIC_SHL, ALL, D, ARM64_SIMD_LEFT },
+        [0x0E] = { ARM64_MNEMONIC_SQSHL, ALL, ALL, ARM64_SIMD_LEFT },
+        [0x10] = { ARM64_MNEMONIC_SHRN, BHS, 0, ARM64_SIMD_NARROW },
+        [0x11] = { ARM64_MNEMONIC_RSHRN, BHS, 0, ARM64_SIMD_NARROW },
+        [0x12] = { ARM64_MNEMONIC_SQSHRN, BHS, BHS, ARM64_SIMD_NARROW },
+        [0x13] = { ARM64_MNEMONIC_SQRSHRN, BHS, BHS, ARM64_SIMD_NARROW },
+        [0x14] = { ARM64_MNEMONIC_SSHLL, BHS, 0, ARM64_SIMD_LONG | ARM64_SIMD_LEFT },
+        [0x1C] = { ARM64_MNEMONIC_SCVTF, SD, SD, ARM64_SIMD_FIXED_POINT },
+        [0x1F] = { ARM64_MNEMONIC_FCVTZS, SD, SD, ARM64_SIMD_FIXED_POINT },
+    },
+    {
+        [0x00] = { ARM64_MNEMONIC_USHR, ALL, D, 0 },
+        [0x02] = { ARM64_MNEMONIC_USRA, ALL, D, ACC },
+        [0x04] = { ARM64_MNEMONIC_URSHR, ALL, D, 0 },
+        [0x06] = { ARM64_MNEMONIC_URSRA, ALL, D, ACC },
+        [0x08] = { ARM64_MNEMONIC_SRI, ALL, D, ACC },
+        [0x0A] = { ARM64_MNEMONIC_SLI, ALL, D, ARM64_SIMD_LEFT | ACC },
+        [0x0C] = { ARM64_MNEMONIC_SQSHLU, ALL, ALL, ARM64_SIMD_LEFT },
+        [0x0E] = { ARM64_MNEMONIC_UQSHL, ALL, ALL, ARM64_SIMD_LEFT },
+        [0x10] = { ARM64_MNEMONIC_SQSHRUN, BHS, BHS, ARM64_SIMD_NARROW },
+        [0x11] = { ARM64_MNEMONIC_SQRSHRUN, BHS, BHS, ARM64_SIMD_NARROW },
+        [0x12] = { ARM64_MNEMONIC_UQSHRN, BHS, BHS, ARM64_SIMD_NARROW },
+        [0x13] = { ARM64_MNEMONIC_UQRSHRN, BHS, BHS, ARM64_SIMD_NARROW },
+        [0x14] = { ARM64_MNEMONIC_USHLL, BHS, 0, ARM64_SIMD_LONG | ARM64_SIMD_LEFT },
+        [0x1C] = { ARM64_MNEMONIC_UCVTF, SD, SD, ARM64_SIMD_FIXED_POINT },
+        [0x1F] = { ARM64_MNEMONIC_FCVTZU, SD, SD, ARM64_SIMD_FIXED_POINT },
+    },
+};
+
+// By-element operations by U and opcode
+static const ARM64SimdOp arm64_simd_indexed[2][16] = {
+    {
+        [0x0] = CLASSIFY,
+        [0x1] = { ARM64_MNEMONIC_FMLA, SD, SD, ARM64_SIMD_FLOAT | ACC },
+        [0x2] = { ARM64_MNEMONIC_SMLAL, HS, 0, ARM64_SIMD_LONG | ACC },
+        [0x3] = { ARM64_MNEMONIC_SQDMLAL, HS, HS, ARM64_SIMD_LONG | ACC },
+        [0x4] = CLASSIFY,
+        [0x5] = { ARM64_MNEMONIC_FMLS, SD, SD, ARM64_SIMD_FLOAT | ACC },
+        [0x6] = { ARM64_MNEMONIC_SMLSL, HS, 0, ARM64_SIMD_LONG | ACC },
+        [0x7] = { ARM64_MNEMONIC_SQDMLSL, HS, HS, ARM64_SIMD_LONG | ACC },
+        [0x8] = { ARM64_MNEMONIC_MUL_V, HS, 0, 0 },
+        [0x9] = { ARM64_MNEMONIC_FMUL, SD, SD, ARM64_SIMD_FLOAT },
+        [0xA] = { ARM64_MNEMONIC_SMULL_V, HS, 0, ARM64_SIMD_LONG },
+        [0xB] = { ARM64_MNEMONIC_SQDMULL, HS, HS, ARM64_SIMD_LONG },
+        [0xC] = { ARM64_MNEMONIC_SQDMULH, HS, HS, 0 },
+        [0xD] = { ARM64_MNEMONIC_SQRDMULH, HS, HS, 0 },
+        [0xE] = CLASSIFY,
+        [0xF] = CLASSIFY,
+    },
+    {
+        [0x0] = { ARM64_MNEMONIC_MLA, HS, 0, ACC },
+        [0x1] = CLASSIFY,
+        [0x2] = { ARM64_MNEMONIC_UMLAL, HS, 0, ARM64_SIMD_LONG | ACC },
+        [0x3] = CLASSIFY,
+        [0x4] = { ARM64_MNEMONIC_MLS, HS, 0, ACC },
+        [0x5] = CLASSIFY,
+        [0x6] = { ARM64_MNEMONIC_UMLSL, HS, 0, ARM64_SIMD_LONG | ACC },
+        [0x7] = CLASSIFY,
+        [0x9] = { ARM64_MNEMONIC_FMULX, SD, SD, ARM64_SIMD_FLOAT },
+        [0xA] = { ARM64_MNEMONIC_UMULL_V, HS, 0, ARM64_SIMD_LONG },
+        [0xD] = CLASSIFY,
+        [0xE] = CLASSIFY,
+        [0xF] = CLASSIFY,
+    },
+};
+
+#undef B
+#undef H
+#undef S
+#undef D
+#undef BHS
+#undef HS
+#undef SD
+#undef ALL
+#undef ACC
+#undef CLASSIFY
+
+// The scalar forms name a register by element size (B to Q), the vector
+// forms by arrangement; size 4 is the 128-bit product of PMULL
+static void arm64_add_simd_reg(ARM64DecodedWord *out, uint8_t reg, bool scalar, uint8_t size, bool q, uint8_t access) {
+    if (scalar) {
+        arm64_add_reg(out, reg, ARM64_REG_B + size, access);
+    } else {
+        arm64_add_vector(out, reg, (size > 3) ? ARM64_VEC_1Q : ARM64_VEC(size, q), access);
+    }
+}
+
+static bool arm64_simd_size_ok(const ARM64SimdOp *op, bool scalar, uint8_t size, bool q) {
+    uint8_t sizes = scalar ? op->scalar_sizes : op->vector_sizes;
+    if (!((sizes >> size) & 0x1)) return false;
+    
+    // One doubleword element is only a vector as the source of PMULL
+    return scalar || size != 3 || q || (op->form & ARM64_SIMD_WIDE_RD);
+}
+
+static uint16_t arm64_simd_mnemonic(const ARM64SimdOp *op, bool scalar, bool q) {
+    bool has_upper_form = !scalar && (op->form & ARM64_SIMD_WIDENED) && !(op->form & ARM64_SIMD_PAIRWISE);
+    return op->mnemonic + ((has_upper_form && q) ? 1 : 0);
+}
+
+static void arm64_add_simd_operand(ARM64DecodedWord *out, uint8_t reg, const ARM64SimdOp *op, uint16_t wide_flag,
+                                   bool scalar, uint8_t size, bool q, uint8_t access) {
+    if (op->form & wide_flag) {
+        size++;
+        if (!(op->form & ARM64_SIMD_PAIRWISE)) q = true;
+    }
+    arm64_add_simd_reg(out, reg, scalar, size, q, access);
+}
+
+// Rd, Rn and optionally Rm of an entry of the three-register and
+// two-register tables
+static void arm64_decode_simd_op(uint32_t bytes, const ARM64SimdOp *op, bool scalar, uint8_t size, bool has_rm, ARM64DecodedWord *out) {
+    bool q = ((bytes >> 30) & 0x1) == 1;
+    
+    if (op->mnemonic == ARM64_MNEMONIC_SIMD) {
+        arm64_classify_simd(bytes, out);
+        return;
+    }
+    if (!arm64_simd_size_ok(op, scalar, size, q)) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    out->mnemonic = arm64_simd_mnemonic(op, scalar, q);
+    out->category = INST_CATEGORY_SIMD;
+    arm64_add_simd_operand(out, bytes & 0x1F, op, ARM64_SIMD_WIDE_RD, scalar, size, q,
+                           (op->form & ARM64_SIMD_ACCUMULATE) ? (ARM64_READ | ARM64_WRITE) : ARM64_WRITE);
+    arm64_add_simd_operand(out, (bytes >> 5) & 0x1F, op, ARM64_SIMD_WIDE_RN, scalar, size, q, ARM64_READ);
+    if (has_rm) {
+        arm64_add_simd_operand(out, (bytes >> 16) & 0x1F, op, ARM64_SIMD_WIDE_RM, scalar, size, q, ARM64_READ);
+    }
+    
+    if (op->form & ARM64_SIMD_ZERO) {
+        arm64_add_imm(out, 0);
+    } else if (op->form & ARM64_SIMD_FLOAT_ZERO) {
+        arm64_add_value(out, ARM64_OPND_FP_IMM, 0);
+    }
+}
+
+static void arm64_decode_simd_three_same(uint32_t bytes, bool scalar, ARM64DecodedWord *out) {
+    bool q = ((bytes >> 30) & 0x1) == 1;
+    uint8_t u = (bytes >> 29) & 0x1;
+    uint8_t size = (bytes >> 22) & 0x3;
+    uint8_t opcode = (bytes >> 11) & 0x1F;
+    uint8_t rm = (bytes >> 16) & 0x1F;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t rd = bytes & 0x1F;
+    
+    if (opcode >= 0x18) {
+        arm64_decode_simd_op(bytes, &arm64_simd_fp_three_same[u][size >> 1][opcode - 0x18], scalar, 2 + (size & 0x1), true, out);
+        return;
+    }
+    if (opcode != 3) {
+        arm64_decode_simd_op(bytes, &arm64_simd_three_same[u][opcode], scalar, size, true, out);
+        return;
+    }
+    
+    // AND, BIC, ORR, ORN, then EOR, BSL, BIT, BIF by size; ORR of a register
+    // with itself is MOV
+    if (scalar) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    out->category = INST_CATEGORY_SIMD;
+    out->mnemonic = ARM64_MNEMONIC_AND_V + u * 4 + size;
+    if (out->mnemonic == ARM64_MNEMONIC_ORR_V && rn == rm) {
+        out->mnemonic = ARM64_MNEMONIC_MOV_V;
+        arm64_add_vector(out, rd, ARM64_VEC(0, q), ARM64_WRITE);
+        arm64_add_vector(out, rn, ARM64_VEC(0, q), ARM64_READ);
+        return;
+    }
+    arm64_add_vector(out, rd, ARM64_VEC(0, q), (u && size) ? (ARM64_READ | ARM64_WRITE) : ARM64_WRITE);
+    arm64_add_vector(out, rn, ARM64_VEC(0, q), ARM64_READ);
+    arm64_add_vector(out, rm, ARM64_VEC(0, q), ARM64_READ);
+}
+
+static void arm64_decode_simd_three_different(uint32_t bytes, bool scalar, ARM64DecodedWord *out) {
+    uint8_t opcode = (bytes >> 12) & 0xF;
+    
+    if (opcode >= 15) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    arm64_decode_simd_op(bytes, &arm64_simd_three_different[opcode][(bytes >> 29) & 0x1], scalar, (bytes >> 22) & 0x3, true, out);
+}
+
+static void arm64_decode_simd_fp_misc(uint32_t bytes, bool scalar, ARM64DecodedWord *out) {
+    bool q = ((bytes >> 30) & 0x1) == 1;
+    uint8_t u = (bytes >> 29) & 0x1;
+    uint8_t a = (bytes >> 23) & 0x1;
+    uint8_t sz = (bytes >> 22) & 0x1;
+    uint8_t opcode = (bytes >> 12) & 0x1F;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t rd = bytes & 0x1F;
+    
+    if (opcode != 0x16 && opcode != 0x17) {
+        arm64_decode_simd_op(bytes, &arm64_simd_fp_misc[u][a][opcode - 0x0C], scalar, 2 + sz, false, out);
+        return;
+    }
+    
+    // FCVTN and FCVTXN to half the element size, FCVTL from it; FCVTXN is
+    // double to single only and the one with a scalar form
+    bool is_long = opcode == 0x17;
+    if (a || (u && (is_long || !sz)) || (scalar && !u)) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    out->category = INST_CATEGORY_SIMD;
+    if (scalar) {
+        out->mnemonic = ARM64_MNEMONIC_FCVTXN;
+        arm64_add_reg(out, rd, ARM64_REG_S, ARM64_WRITE);
+        arm64_add_reg(out, rn, ARM64_REG_D, ARM64_READ);
+        return;
+    }
+    
+    out->mnemonic = (is_long ? ARM64_MNEMONIC_FCVTL : (u ? ARM64_MNEMONIC_FCVTXN : ARM64_MNEMONIC_FCVTN)) + q;
+    arm64_add_vector(out, rd, is_long ? ARM64_VEC(2 + sz, 1) : ARM64_VEC(1 + sz, q), ARM64_WRITE);
+    arm64_add_vector(out, rn, is_long ? ARM64_VEC(1 + sz, q) : ARM64_VEC(2 + sz, 1), ARM64_READ);
+}
+
+static void arm64_decode_simd_misc(uint32_t bytes, bool scalar, ARM64DecodedWord *out) {
+    bool q = ((bytes >> 30) & 0x1) == 1;
+    uint8_t u = (bytes >> 29) & 0x1;
+    uint8_t size = (bytes >> 22) & 0x3;
+    uint8_t opcode = (bytes >> 12) & 0x1F;
+    
+    if ((opcode >= 0x0C && opcode <= 0x0F) || opcode >= 0x16) {
+        arm64_decode_simd_fp_misc(bytes, scalar, out);
+        return;
+    }
+    
+    if (u && opcode == 5) {
+        // NOT (shown as MVN) and RBIT, bytes only
+        if (scalar || size > 1) {
+            arm64_decode_unallocated(bytes, out);
+            return;
+        }
+        out->mnemonic = size ? ARM64_MNEMONIC_RBIT_V : ARM64_MNEMONIC_MVN_V;
+        out->category = INST_CATEGORY_SIMD;
+        arm64_add_vector(out, bytes & 0x1F, ARM64_VEC(0, q), ARM64_WRITE);
+        arm64_add_vector(out, (bytes >> 5) & 0x1F, ARM64_VEC(0, q), ARM64_READ);
+        return;
+    }
+    
+    if (opcode > 0x14) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    arm64_decode_simd_op(bytes, &arm64_simd_misc[u][opcode], scalar, size, false, out);
+    
+    // SHLL shifts by the element size
+    if (out->mnemonic == ARM64_MNEMONIC_SHLL + q) {
+        arm64_add_imm(out, 8 << size);
+    }
+}
+
+static void arm64_decode_simd_across_lanes(uint32_t bytes, ARM64DecodedWord *out) {
+    bool q = ((bytes >> 30) & 0x1) == 1;
+    uint8_t u = (bytes >> 29) & 0x1;
+    uint8_t size = (bytes >> 22) & 0x3;
+    uint8_t opcode = (bytes >> 12) & 0x1F;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t rd = bytes & 0x1F;
+    
+    out->category = INST_CATEGORY_SIMD;
+    
+    if (opcode == 0x0C || opcode == 0x0F) {
+        // FMAXNMV, FMINNMV, FMAXV, FMINV: four single-precision lanes; the
+        // U = 0 forms are half precision
+        if (!u) {
+            arm64_classify_simd(bytes, out);
+            return;
+        }
+        if ((size & 0x1) || !q) {
+            arm64_decode_unallocated(bytes, out);
+            return;
+        }
+        out->mnemonic = ((opcode == 0x0C) ? ARM64_MNEMONIC_FMAXNMV : ARM64_MNEMONIC_FMAXV) + (size >> 1);
+        arm64_add_reg(out, rd, ARM64_REG_S, ARM64_WRITE);
+        arm64_add_vector(out, rn, ARM64_VEC_4S, ARM64_READ);
+        return;
+    }
+    
+    switch (opcode) {
+        case 0x03: out->mnemonic = ARM64_MNEMONIC_SADDLV + u; break;
+        case 0x0A: out->mnemonic = ARM64_MNEMONIC_SMAXV + u; break;
+        case 0x1A: out->mnemonic = ARM64_MNEMONIC_SMINV + u; break;
+        case 0x1B: out->mnemonic = u ? ARM64_MNEMONIC_WORD : ARM64_MNEMONIC_ADDV; break;
+        default: out->mnemonic = ARM64_MNEMONIC_WORD; break;
+    }
+    if (out->mnemonic == ARM64_MNEMONIC_WORD || size == 3 || (size == 2 && !q)) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    // SADDLV and UADDLV widen the sum
+    arm64_add_reg(out, rd, ARM64_REG_B + size + (opcode == 0x03), ARM64_WRITE);
+    arm64_add_vector(out, rn, ARM64_VEC(size, q), ARM64_READ);
+}
+
+// ADDP, FADDP, FMAXP and friends reducing a pair of elements to a scalar
+static void arm64_decode_simd_scalar_pairwise(uint32_t bytes, ARM64DecodedWord *out) {
+    uint8_t u = (bytes >> 29) & 0x1;
+    uint8_t size = (bytes >> 22) & 0x3;
+    uint8_t sz = size & 0x1;
+    uint8_t a = size >> 1;
+    uint8_t opcode = (bytes >> 12) & 0x1F;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t rd = bytes & 0x1F;
+    
+    out->category = INST_CATEGORY_SIMD;
+    
+    if (!u) {
+        if (opcode == 0x1B && size == 3) {
+            out->mnemonic = ARM64_MNEMONIC_ADDP;
+            arm64_add_reg(out, rd, ARM64_REG_D, ARM64_WRITE);
+            arm64_add_vector(out, rn, ARM64_VEC_2D, ARM64_READ);
+        } else if (opcode == 0x0C || opcode == 0x0D || opcode == 0x0F) {
+            arm64_classify_simd(bytes, out);
+        } else {
+            arm64_decode_unallocated(bytes, out);
+        }
+        return;
+    }
+    
+    switch (opcode) {
+        case 0x0C: out->mnemonic = ARM64_MNEMONIC_FMAXNMP + a; break;
+        case 0x0D: out->mnemonic = a ? ARM64_MNEMONIC_WORD : ARM64_MNEMONIC_FADDP; break;
+        case 0x0F: out->mnemonic = ARM64_MNEMONIC_FMAXP + a; break;
+        default: out->mnemonic = ARM64_MNEMONIC_WORD; break;
+    }
+    if (out->mnemonic == ARM64_MNEMONIC_WORD) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    arm64_add_reg(out, rd, ARM64_REG_S + sz, ARM64_WRITE);
+    arm64_add_vector(out, rn, ARM64_VEC(2 + sz, sz), ARM64_READ);
+}
+
+// DUP, INS, SMOV and UMOV; imm5 holds the element size (its lowest set bit)
+// and the lane above it. INS, the scalar DUP and the word and doubleword UMOV
+// are shown as MOV.
+static void arm64_decode_simd_copy(uint32_t bytes, bool scalar, ARM64DecodedWord *out) {
+    bool q = ((bytes >> 30) & 0x1) == 1;
+    bool op = ((bytes >> 29) & 0x1) == 1;
+    uint8_t imm5 = (bytes >> 16) & 0x1F;
+    uint8_t imm4 = (bytes >> 11) & 0xF;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t rd = bytes & 0x1F;
+    
+    if ((imm5 & 0xF) == 0) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    uint8_t size = (uint8_t)__builtin_ctz(imm5);
+    uint8_t lane = imm5 >> (size + 1);
+    uint8_t gpr_class = (size == 3) ? ARM64_REG_X : ARM64_REG_W;
+    bool valid;
+    
+    out->category = INST_CATEGORY_SIMD;
+    
+    if (scalar) {
+        out->mnemonic = ARM64_MNEMONIC_MOV_V;
+        arm64_add_reg(out, rd, ARM64_REG_B + size, ARM64_WRITE);
+        arm64_add_element(out, rn, size, lane, ARM64_READ);
+        return;
+    }
+    
+    if (op) {
+        // INS (element)
+        if (!q) {
+            arm64_decode_unallocated(bytes, out);
+            return;
+        }
+        out->mnemonic = ARM64_MNEMONIC_MOV_V;
+        arm64_add_element(out, rd, size, lane, ARM64_WRITE);
+        arm64_add_element(out, rn, size, imm4 >> size, ARM64_READ);
+        return;
+    }
+    
+    switch (imm4) {
+        case 0:
+        case 1:
+            valid = size != 3 || q;
+            out->mnemonic = ARM64_MNEMONIC_DUP;
+            break;
+        case 3:
+            valid = q;
+            out->mnemonic = ARM64_MNEMONIC_MOV_V;
+            break;
+        case 5:
+            valid = size < (q ? 3 : 2);
+            out->mnemonic = ARM64_MNEMONIC_SMOV;
+            gpr_class = q ? ARM64_REG_X : ARM64_REG_W;
+            break;
+        case 7:
+            valid = q ? size == 3 : size < 3;
+            out->mnemonic = (size >= 2) ? ARM64_MNEMONIC_MOV_V : ARM64_MNEMONIC_UMOV;
+            break;
+        default:
+            valid = false;
+            break;
+    }
+    if (!valid) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    switch (imm4) {
+        case 0:
+            arm64_add_vector(out, rd, ARM64_VEC(size, q), ARM64_WRITE);
+            arm64_add_element(out, rn, size, lane, ARM64_READ);
+            break;
+        case 1:
+            arm64_add_vector(out, rd, ARM64_VEC(size, q), ARM64_WRITE);
+            arm64_add_reg(out, rn, gpr_class, ARM64_READ);
+            break;
+        case 3:
+            arm64_add_element(out, rd, size, lane, ARM64_WRITE);
+            arm64_add_reg(out, rn, gpr_class, ARM64_READ);
+            break;
+        default:
+            arm64_add_reg(out, rd, gpr_class, ARM64_WRITE);
+            arm64_add_element(out, rn, size, lane, ARM64_READ);
+            break;
+    }
+}
+
+// MOVI, MVNI, ORR and BIC with an 8-bit immediate, shifted or expanded by
+// cmode, and FMOV (vector, immediate)
+static void arm64_decode_simd_modified_imm(uint32_t bytes, ARM64DecodedWord *out) {
+    bool q = ((bytes >> 30) & 0x1) == 1;
+    bool op = ((bytes >> 29) & 0x1) == 1;
+    uint8_t cmode = (bytes >> 12) & 0xF;
+    uint8_t imm8 = (uint8_t)((((bytes >> 16) & 0x7) << 5) | ((bytes >> 5) & 0x1F));
+    uint8_t rd = bytes & 0x1F;
+    
+    // o2 selects the half-precision FMOV
+    if ((bytes >> 11) & 0x1) {
+        arm64_classify_simd(bytes, out);
+        return;
+    }
+    
+    out->category = INST_CATEGORY_SIMD;
+    
+    if (cmode == 0xF) {
+        if (op && !q) {
+            arm64_decode_unallocated(bytes, out);
+            return;
+        }
+        double value = arm64_expand_fp_imm(imm8);
+        int64_t value_bits;
+        memcpy(&value_bits, &value, sizeof(value_bits));
+        
+        out->mnemonic = ARM64_MNEMONIC_FMOV;
+        arm64_add_vector(out, rd, op ? ARM64_VEC_2D : ARM64_VEC(2, q), ARM64_WRITE);
+        arm64_add_value(out, ARM64_OPND_FP_IMM, value_bits);
+        return;
+    }
+    
+    if (cmode == 0xE) {
+        out->mnemonic = ARM64_MNEMONIC_MOVI;
+        if (!op) {
+            arm64_add_vector(out, rd, ARM64_VEC(0, q), ARM64_WRITE);
+            arm64_add_imm(out, imm8);
+            return;
+        }
+        
+        // Each bit of imm8 sets a whole byte
+        uint64_t mask = 0;
+        for (int i = 0; i < 8; i++) {
+            if ((imm8 >> i) & 0x1) mask |= 0xFFULL << (i * 8);
+        }
+        if (q) {
+            arm64_add_vector(out, rd, ARM64_VEC_2D, ARM64_WRITE);
+        } else {
+            arm64_add_reg(out, rd, ARM64_REG_D, ARM64_WRITE);
+        }
+        arm64_add_value(out, ARM64_OPND_BITMASK, (int64_t)mask);
+        return;
+    }
+    
+    // 32-bit elements shifted by 0-24 (cmode 0xxx), 16-bit ones by 0 or 8
+    // (10xx), or 32-bit ones shifting in ones (110x); the odd cmodes below
+    // 12 are ORR and BIC
+    bool is_halfword = (cmode & 0xC) == 0x8;
+    bool is_msl = (cmode & 0xE) == 0xC;
+    uint8_t arrangement = is_halfword ? ARM64_VEC(1, q) : ARM64_VEC(2, q);
+    
+    if (!is_msl && (cmode & 0x1)) {
+        out->mnemonic = op ? ARM64_MNEMONIC_BIC_V : ARM64_MNEMONIC_ORR_V;
+        arm64_add_vector(out, rd, arrangement, ARM64_READ | ARM64_WRITE);
+    } else {
+        out->mnemonic = op ? ARM64_MNEMONIC_MVNI : ARM64_MNEMONIC_MOVI;
+        arm64_add_vector(out, rd, arrangement, ARM64_WRITE);
+    }
+    
+    ARM64DecodedOperand *imm = arm64_add_imm(out, imm8);
+    uint8_t amount = is_msl ? ((cmode & 0x1) ? 16 : 8) : (((cmode >> 1) & (is_halfword ? 0x1 : 0x3)) * 8);
+    if (is_msl || amount != 0) {
+        imm->shift = is_msl ? ARM64_SHIFT_MSL : ARM64_SHIFT_LSL;
+        imm->shift_amount = amount;
+    }
+}
+
+static void arm64_decode_simd_shift_imm(uint32_t bytes, bool scalar, ARM64DecodedWord *out) {
+    bool q = ((bytes >> 30) & 0x1) == 1;
+    uint8_t u = (bytes >> 29) & 0x1;
+    uint8_t immh = (bytes >> 19) & 0xF;
+    uint8_t immhb = (bytes >> 16) & 0x7F;
+    uint8_t opcode = (bytes >> 11) & 0x1F;
+    const ARM64SimdOp *op = &arm64_simd_shift[u][opcode];
+    
+    // The highest set bit of immh is the element size
+    uint8_t size = (uint8_t)(31 - __builtin_clz(immh));
+    uint32_t esize = 8U << size;
+    
+    if ((op->form & ARM64_SIMD_FIXED_POINT) && size == 1) {
+        arm64_classify_simd(bytes, out);
+        return;
+    }
+    if (!arm64_simd_size_ok(op, scalar, size, q)) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    uint32_t amount = (op->form & ARM64_SIMD_LEFT) ? immhb - esize : 2 * esize - immhb;
+    bool is_extend = (op->mnemonic == ARM64_MNEMONIC_SSHLL || op->mnemonic == ARM64_MNEMONIC_USHLL) && amount == 0;
+    
+    // SSHLL and USHLL by zero are SXTL and UXTL
+    out->mnemonic = arm64_simd_mnemonic(op, scalar, q) + (is_extend ? 4 : 0);
+    out->category = INST_CATEGORY_SIMD;
+    arm64_add_simd_operand(out, bytes & 0x1F, op, ARM64_SIMD_WIDE_RD, scalar, size, q,
+                           (op->form & ARM64_SIMD_ACCUMULATE) ? (ARM64_READ | ARM64_WRITE) : ARM64_WRITE);
+    arm64_add_simd_operand(out, (bytes >> 5) & 0x1F, op, ARM64_SIMD_WIDE_RN, scalar, size, q, ARM64_READ);
+    if (!is_extend) arm64_add_imm(out, amount);
+}
+
+static void arm64_decode_simd_indexed(uint32_t bytes, bool scalar, ARM64DecodedWord *out) {
+    bool q = ((bytes >> 30) & 0x1) == 1;
+    uint8_t size = (bytes >> 22) & 0x3;
+    uint8_t l = (bytes >> 21) & 0x1;
+    uint8_t m = (bytes >> 20) & 0x1;
+    uint8_t h = (bytes >> 11) & 0x1;
+    uint8_t rm = (bytes >> 16) & 0xF;
+    const ARM64SimdOp *op = &arm64_simd_indexed[(bytes >> 29) & 0x1][(bytes >> 12) & 0xF];
+    
+    if (op->mnemonic == ARM64_MNEMONIC_SIMD || ((op->form & ARM64_SIMD_FLOAT) && size == 0)) {
+        arm64_classify_simd(bytes, out);
+        return;
+    }
+    if (!arm64_simd_size_ok(op, scalar, size, q) || (size == 3 && l)) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    // Halfwords index with H:L:M and reach V0-V15 only; words with H:L and
+    // doublewords with H, both with M as the top bit of Rm
+    uint8_t index;
+    if (size == 1) {
+        index = (uint8_t)((h << 2) | (l << 1) | m);
+    } else {
+        index = (size == 2) ? (uint8_t)((h << 1) | l) : h;
+        rm |= m << 4;
+    }
+    
+    out->mnemonic = arm64_simd_mnemonic(op, scalar, q);
+    out->category = INST_CATEGORY_SIMD;
+    arm64_add_simd_operand(out, bytes & 0x1F, op, ARM64_SIMD_WIDE_RD, scalar, size, q,
+                           (op->form & ARM64_SIMD_ACCUMULATE) ? (ARM64_READ | ARM64_WRITE) : ARM64_WRITE);
+    arm64_add_simd_operand(out, (bytes >> 5) & 0x1F, op, ARM64_SIMD_WIDE_RN, scalar, size, q, ARM64_READ);
+    arm64_add_element(out, rm, size, index, ARM64_READ);
+}
+
+// UZP1, TRN1, ZIP1, UZP2, TRN2, ZIP2, then EXT and the table lookups
+static void arm64_decode_simd_permute(uint32_t bytes, ARM64DecodedWord *out) {
+    bool q = ((bytes >> 30) & 0x1) == 1;
+    uint8_t size = (bytes >> 22) & 0x3;
+    uint8_t opcode = (bytes >> 12) & 0x7;
+    
+    if ((opcode & 0x3) == 0 || (size == 3 && !q)) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    out->mnemonic = ARM64_MNEMONIC_UZP1 + (opcode & 0x3) - 1 + ((opcode & 0x4) ? 3 : 0);
+    out->category = INST_CATEGORY_SIMD;
+    arm64_add_vector(out, bytes & 0x1F, ARM64_VEC(size, q), ARM64_WRITE);
+    arm64_add_vector(out, (bytes >> 5) & 0x1F, ARM64_VEC(size, q), ARM64_READ);
+    arm64_add_vector(out, (bytes >> 16) & 0x1F, ARM64_VEC(size, q), ARM64_READ);
+}
+
+static void arm64_decode_simd_extract(uint32_t bytes, ARM64DecodedWord *out) {
+    bool q = ((bytes >> 30) & 0x1) == 1;
+    uint8_t imm4 = (bytes >> 11) & 0xF;
+    
+    if (!q && (imm4 & 0x8)) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    out->mnemonic = ARM64_MNEMONIC_EXT;
+    out->category = INST_CATEGORY_SIMD;
+    arm64_add_vector(out, bytes & 0x1F, ARM64_VEC(0, q), ARM64_WRITE);
+    arm64_add_vector(out, (bytes >> 5) & 0x1F, ARM64_VEC(0, q), ARM64_READ);
+    arm64_add_vector(out, (bytes >> 16) & 0x1F, ARM64_VEC(0, q), ARM64_READ);
+    arm64_add_imm(out, imm4);
+}
+
+// TBL and TBX over a table of one to four consecutive registers; TBX keeps
+// the destination bytes whose index is out of range
+static void arm64_decode_simd_table(uint32_t bytes, ARM64DecodedWord *out) {
+    bool q = ((bytes >> 30) & 0x1) == 1;
+    bool is_tbx = ((bytes >> 12) & 0x1) == 1;
+    
+    out->mnemonic = is_tbx ? ARM64_MNEMONIC_TBX : ARM64_MNEMONIC_TBL;
+    out->category = INST_CATEGORY_SIMD;
+    arm64_add_vector(out, bytes & 0x1F, ARM64_VEC(0, q), is_tbx ? (ARM64_READ | ARM64_WRITE) : ARM64_WRITE);
+    arm64_add_reg_list(out, (bytes >> 5) & 0x1F, ((bytes >> 13) & 0x3) + 1, ARM64_VEC_16B, ARM64_READ);
+    arm64_add_vector(out, (bytes >> 16) & 0x1F, ARM64_VEC(0, q), ARM64_READ);
+}
+
+// AESE, AESD, AESMC, AESIMC and the SHA-1 and SHA-256 instructions
+static void arm64_decode_simd_crypto(uint32_t bytes, ARM64DecodedWord *out) {
+    uint8_t rm = (bytes >> 16) & 0x1F;
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t rd = bytes & 0x1F;
+    
+    out->category = INST_CATEGORY_SIMD;
+    
+    if ((bytes & 0xFFFE0C00) == 0x4E280800) {
+        uint8_t opcode = (bytes >> 12) & 0x1F;
+        if (opcode < 4 || opcode > 7) {
+            arm64_decode_unallocated(bytes, out);
+            return;
+        }
+        out->mnemonic = ARM64_MNEMONIC_AESE + opcode - 4;
+        arm64_add_vector(out, rd, ARM64_VEC_16B, (opcode < 6) ? (ARM64_READ | ARM64_WRITE) : ARM64_WRITE);
+        arm64_add_vector(out, rn, ARM64_VEC_16B, ARM64_READ);
+        return;
+    }
+    
+    if ((bytes & 0xFFFE0C00) == 0x5E280800) {
+        // SHA1H, SHA1SU1, SHA256SU0
+        uint8_t opcode = (bytes >> 12) & 0x1F;
+        if (opcode > 2) {
+            arm64_decode_unallocated(bytes, out);
+            return;
+        }
+        out->mnemonic = ARM64_MNEMONIC_SHA1H + opcode;
+        if (opcode == 0) {
+            arm64_add_reg(out, rd, ARM64_REG_S, ARM64_WRITE);
+            arm64_add_reg(out, rn, ARM64_REG_S, ARM64_READ);
+        } else {
+            arm64_add_vector(out, rd, ARM64_VEC_4S, ARM64_READ | ARM64_WRITE);
+            arm64_add_vector(out, rn, ARM64_VEC_4S, ARM64_READ);
+        }
+        return;
+    }
+    
+    // SHA1C, SHA1P, SHA1M, SHA1SU0, SHA256H, SHA256H2, SHA256SU1
+    uint8_t opcode = (bytes >> 12) & 0x7;
+    if ((bytes & 0xFFE08C00) != 0x5E000000 || opcode == 7) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    out->mnemonic = ARM64_MNEMONIC_SHA1C + opcode;
+    if (opcode == 3 || opcode == 6) {
+        arm64_add_vector(out, rd, ARM64_VEC_4S, ARM64_READ | ARM64_WRITE);
+        arm64_add_vector(out, rn, ARM64_VEC_4S, ARM64_READ);
+    } else {
+        arm64_add_reg(out, rd, ARM64_REG_Q, ARM64_READ | ARM64_WRITE);
+        arm64_add_reg(out, rn, (opcode < 3) ? ARM64_REG_S : ARM64_REG_Q, ARM64_READ);
+    }
+    arm64_add_vector(out, rm, ARM64_VEC_4S, ARM64_READ);
+}
+
+// [Xn|SP], or post-indexed by the bytes transferred (Rm = 31) or by Xm
+static void arm64_add_structure_address(ARM64DecodedWord *out, uint32_t bytes, uint32_t transferred, uint8_t access_size) {
+    uint8_t rn = (bytes >> 5) & 0x1F;
+    uint8_t rm = (bytes >> 16) & 0x1F;
+    
+    if (!((bytes >> 23) & 0x1)) {
+        arm64_add_mem(out, rn, ARM64_MEM_OFFSET, 0, access_size);
+    } else if (rm == 31) {
+        arm64_add_mem(out, rn, ARM64_MEM_POST_INDEX, transferred, access_size);
+    } else {
+        ARM64DecodedOperand *mem = arm64_add_mem(out, rn, ARM64_MEM_POST_INDEX_REG, 0, access_size);
+        mem->index = rm;
+        mem->reg_class = ARM64_REG_X;
+        arm64_note_access(out, rm, ARM64_REG_X, ARM64_READ);
+    }
+}
+
+// LD1-LD4 and ST1-ST4 of multiple structures or of one lane, and LD1R-LD4R
+static void arm64_decode_simd_load_store(uint32_t bytes, ARM64DecodedWord *out) {
+    // Registers and structure elements by the opcode of the multiple
+    // structure forms; no registers is unallocated
+    static const uint8_t multiple_registers[16] = { 4, 0, 4, 0, 3, 0, 3, 1, 2, 0, 2 };
+    static const uint8_t multiple_elements[16] = { 4, 0, 1, 0, 3, 0, 1, 1, 2, 0, 1 };
+    
+    bool q = ((bytes >> 30) & 0x1) == 1;
+    bool is_load = ((bytes >> 22) & 0x1) == 1;
+    bool is_post = ((bytes >> 23) & 0x1) == 1;
+    uint8_t size = (bytes >> 10) & 0x3;
+    uint8_t rt = bytes & 0x1F;
+    uint8_t access = is_load ? ARM64_WRITE : ARM64_READ;
+    
+    if (!is_post && ((bytes >> 16) & 0x1F) != 0) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    out->category = INST_CATEGORY_LOAD_STORE;
+    
+    if (!((bytes >> 24) & 0x1)) {
+        uint8_t opcode = (bytes >> 12) & 0xF;
+        uint8_t count = multiple_registers[opcode];
+        uint8_t elements = multiple_elements[opcode];
+        
+        if (((bytes >> 21) & 0x1) || count == 0 || (elements > 1 && size == 3 && !q)) {
+            arm64_decode_unallocated(bytes, out);
+            return;
+        }
+        
+        out->mnemonic = (is_load ? ARM64_MNEMONIC_LD1 : ARM64_MNEMONIC_ST1) + elements - 1;
+        arm64_add_reg_list(out, rt, count, ARM64_VEC(size, q), access);
+        arm64_add_structure_address(out, bytes, count * (q ? 16 : 8), q ? 16 : 8);
+        return;
+    }
+    
+    uint8_t opcode = (bytes >> 13) & 0x7;
+    uint8_t s = (bytes >> 12) & 0x1;
+    uint8_t elements = (uint8_t)((((opcode & 0x1) << 1) | ((bytes >> 21) & 0x1)) + 1);
+    uint8_t scale = opcode >> 1;
+    uint8_t index;
+    
+    if (scale == 3) {
+        // Load and replicate to all lanes
+        if (!is_load || s) {
+            arm64_decode_unallocated(bytes, out);
+            return;
+        }
+        out->mnemonic = ARM64_MNEMONIC_LD1R + elements - 1;
+        arm64_add_reg_list(out, rt, elements, ARM64_VEC(size, q), access);
+        arm64_add_structure_address(out, bytes, elements << size, 1 << size);
+        return;
+    }
+    
+    // The lane is Q:S:size, less the low bits that the element size uses
+    switch (scale) {
+        case 0:
+            index = (uint8_t)((q << 3) | (s << 2) | size);
+            break;
+        case 1:
+            index = (uint8_t)((q << 2) | (s << 1) | (size >> 1));
+            if (size & 0x1) scale = 0xFF;
+            break;
+        default:
+            if (size == 0) {
+                index = (uint8_t)((q << 1) | s);
+            } else {
+                index = q;
+                scale = (size == 1 && !s) ? 3 : 0xFF;
+            }
+            break;
+    }
+    if (scale == 0xFF) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    out->mnemonic = (is_load ? ARM64_MNEMONIC_LD1 : ARM64_MNEMONIC_ST1) + elements - 1;
+    arm64_add_reg_list(out, rt, elements, ARM64_VEC_B + scale, access)->lane = index;
+    arm64_add_structure_address(out, bytes, elements << scale, 1 << scale);
+}
+
+// Advanced SIMD data processing (op0 = x111 outside the scalar FP group) and
+// the structure loads and stores. Bit 28 separates the scalar forms from the
+// vector ones; within each, bit 24, bit 21 and bits 11:10 pick the group.
+static void arm64_decode_simd(uint32_t bytes, ARM64DecodedWord *out) {
+    bool scalar = ((bytes >> 28) & 0x1) == 1;
+    
+    if (((bytes >> 25) & 0x7) == 0x6) {
+        arm64_decode_simd_load_store(bytes, out);
+        return;
+    }
+    if (bytes >> 31) {
+        arm64_classify_simd(bytes, out);
+        return;
+    }
+    if (scalar && !((bytes >> 30) & 0x1)) {
+        arm64_decode_unallocated(bytes, out);
+        return;
+    }
+    
+    if ((bytes >> 24) & 0x1) {
+        if (!((bytes >> 10) & 0x1)) {
+            arm64_decode_simd_indexed(bytes, scalar, out);
+        } else if ((bytes >> 23) & 0x1) {
+            arm64_decode_unallocated(bytes, out);
+        } else if (((bytes >> 19) & 0xF) != 0) {
+            arm64_decode_simd_shift_imm(bytes, scalar, out);
+        } else if (!scalar) {
+            arm64_decode_simd_modified_imm(bytes, out);
+        } else {
+            arm64_decode_unallocated(bytes, out);
+        }
+        return;
+    }
+    
+    if ((bytes >> 21) & 0x1) {
+        if ((bytes >> 10) & 0x1) {
+            arm64_decode_simd_three_same(bytes, scalar, out);
+        } else if (((bytes >> 10) & 0x3) == 0) {
+            arm64_decode_simd_three_different(bytes, scalar, out);
+        } else {
+            switch ((bytes >> 17) & 0xF) {
+                case 0x0:
+                    arm64_decode_simd_misc(bytes, scalar, out);
+                    break;
+                case 0x4:
+                    arm64_decode_simd_crypto(bytes, out);
+                    break;
+                case 0x8:
+                    if (scalar) {
+                        arm64_decode_simd_scalar_pairwise(bytes, out);
+                    } else {
+                        arm64_decode_simd_across_lanes(bytes, out);
+                    }
+                    break;
+                default:
+                    arm64_classify_simd(bytes, out);
+                    break;
+            }
+        }
+        return;
+    }
+    
+    if (scalar) {
+        if ((bytes & 0xFFE0FC00) == 0x5E000400) {
+            arm64_decode_simd_copy(bytes, true, out);
+        } else if ((bytes & 0xFFE08C00) == 0x5E000000) {
+            arm64_decode_simd_crypto(bytes, out);
+        } else {
+            arm64_classify_simd(bytes, out);
+        }
+    } else if ((bytes & 0x9FE08400) == 0x0E000400) {
+        arm64_decode_simd_copy(bytes, false, out);
+    } else if ((bytes & 0xBF208C00) == 0x0E000800) {
+        arm64_decode_simd_permute(bytes, out);
+    } else if ((bytes & 0xBFE08C00) == 0x0E000000) {
+        arm64_decode_simd_table(bytes, out);
+    } else if ((bytes & 0xBFE08400) == 0x2E000000) {
+        arm64_decode_simd_extract(bytes, out);
+    } else {
+        arm64_classify_simd(bytes, out);
+    }
+}
+
+#pragma mark - ARM64 Decode Entry Points
+
+typedef void (*ARM64LeafDecoder)(uint32_t bytes, ARM64DecodedWord *out);
+
+static const ARM64LeafDecoder arm64_leaf_decoders[ARM64_CLASS_COUNT] = {
+    [ARM64_CLASS_UNALLOCATED] = arm64_decode_unallocated,
+    [ARM64_CLASS_PC_REL] = arm64_decode_pc_rel,
+    [ARM64_CLASS_ADD_SUB_IMM] = arm64_decode_add_sub_imm,
+    [ARM64_CLASS_LOGICAL_IMM] = arm64_decode_logical_imm,
+    [ARM64_CLASS_MOVE_WIDE] = arm64_decode_move_wide,
+    [ARM64_CLASS_BITFIELD] = arm64_decode_bitfield,
+    [ARM64_CLASS_EXTRACT] = arm64_decode_extract,
+    [ARM64_CLASS_BRANCH_IMM] = arm64_decode_branch_imm,
+    [ARM64_CLASS_BRANCH_COND] = arm64_decode_branch_cond,
+    [ARM64_CLASS_COMPARE_BRANCH] = arm64_decode_compare_branch,
+    [ARM64_CLASS_TEST_BRANCH] = arm64_decode_test_branch,
+    [ARM64_CLASS_EXCEPTION] = arm64_decode_exception,
+    [ARM64_CLASS_SYSTEM] = arm64_decode_system,
+    [ARM64_CLASS_BRANCH_REG] = arm64_decode_branch_reg,
+    [ARM64_CLASS_LOAD_STORE_EXCLUSIVE] = arm64_decode_load_store_exclusive,
+    [ARM64_CLASS_LOAD_LITERAL] = arm64_decode_load_literal,
+    [ARM64_CLASS_LOAD_STORE_PAIR] = arm64_decode_load_store_pair,
+    [ARM64_CLASS_LOAD_STORE_REG] = arm64_decode_load_store_reg,
+    [ARM64_CLASS_LOAD_STORE_RCPC] = arm64_decode_load_store_rcpc,
+    [ARM64_CLASS_LOGICAL_REG] = arm64_decode_logical_reg,
+    [ARM64_CLASS_ADD_SUB_REG] = arm64_decode_add_sub_reg,
+    [ARM64_CLASS_ADD_SUB_CARRY] = arm64_decode_add_sub_carry,
+    [ARM64_CLASS_COND_COMPARE] = arm64_decode_cond_compare,
+    [ARM64_CLASS_COND_SELECT] = arm64_decode_cond_select,
+    [ARM64_CLASS_DP_1_2_SRC] = arm64_decode_dp_1_2_src,
+    [ARM64_CLASS_DP_3SRC] = arm64_decode_dp_3src,
+    [ARM64_CLASS_FP] = arm64_decode_fp,
+    [ARM64_CLASS_SIMD] = arm64_decode_simd,
+};
+
+// Requires arm64_decode_table_init(); bulk decoders call it once up front
+static void arm64_decode_classified(uint32_t bytes, ARM64DecodedWord *out) {
+    arm64_reset_word(out);
+    arm64_leaf_decoders[arm64_class_table[bytes >> ARM64_CLASS_KEY_SHIFT]](bytes, out);
+}
+
+void arm64_decode_word(uint32_t bytes, ARM64DecodedWord *out) {
+    if (!out) return;
+    arm64_decode_table_init();
+    arm64_decode_classified(bytes, out);
+}
+
+const char* arm64_mnemonic_name(uint16_t mnemonic) {
+    return (mnemonic < ARM64_MNEMONIC_COUNT) ? arm64_mnemonics[mnemonic] : "???";
+}
+
+#pragma mark - ARM64 Rendering
+
+typedef struct {
+    char *buffer;
+    size_t size;
+    size_t length;
+} ARM64TextBuffer;
+
+static void arm64_append(ARM64TextBuffer *text, const char *format, ...) {
+    if (text->length + 1 >= text->size) return;
+    
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(text->buffer + text->length, text->size - text->length, format, args);
+    va_end(args);
+    
+    if (written > 0) {
+        text->length += (size_t)written;
+        if (text->length >= text->size) text->length = text->size - 1;
+    }
+}
+
+// Registers and punctuation make up most of the text, so they skip vsnprintf
+static void arm64_append_string(ARM64TextBuffer *text, const char *string, size_t length) {
+    if (text->length + length >= text->size) {
+        length = text->size - text->length - 1;
+    }
+    memcpy(text->buffer + text->length, string, length);
+    text->length += length;
+    text->buffer[text->length] = '\0';
+}
+
+static void arm64_append_register(ARM64TextBuffer *text, uint8_t reg, uint8_t reg_class) {
+    static const char register_prefixes[] = { 'W', 'X', 'W', 'X', 'B', 'H', 'S', 'D', 'Q', 'V' };
+    
+    if (reg == 31 && reg_class <= ARM64_REG_SP) {
+        static const char *const special_names[] = { "WZR", "XZR", "WSP", "SP" };
+        arm64_append_string(text, special_names[reg_class], strlen(special_names[reg_class]));
+    } else if (reg_class <= ARM64_REG_V && reg < 32) {
+        char name[3] = { register_prefixes[reg_class], (char)('0' + reg / 10), (char)('0' + reg % 10) };
+        if (reg < 10) {
+            name[1] = name[2];
+            arm64_append_string(text, name, 2);
+        } else {
+            arm64_append_string(text, name, 3);
+        }
+    } else {
+        arm64_append_string(text, "???", 3);
+    }
+}
+
+// ".16B" for a whole vector, ".S" and then the lane for an element
+static void arm64_append_arrangement(ARM64TextBuffer *text, uint8_t arrangement) {
+    static const char *const arrangement_names[] = {
+        "", ".8B", ".16B", ".4H", ".8H", ".2S", ".4S", ".1D", ".2D", ".1Q", ".B", ".H", ".S", ".D"
+    };
+    
+    if (arrangement == ARM64_VEC_NONE || arrangement > ARM64_VEC_D) return;
+    arm64_append_string(text, arrangement_names[arrangement], strlen(arrangement_names[arrangement]));
+}
+
+static void arm64_append_lane(ARM64TextBuffer *text, uint8_t arrangement, uint8_t lane) {
+    if (arrangement >= ARM64_VEC_B) arm64_append(text, "[%u]", lane);
+}
+
+static void arm64_append_shift(ARM64TextBuffer *text, uint8_t shift, uint8_t amount) {
+    static const char *const shift_names[] = {
+        "", "LSL", "LSR", "ASR", "ROR", "UXTB", "UXTH", "UXTW", "UXTX", "SXTB", "SXTH", "SXTW", "SXTX", "MSL"
+    };
+    
+    if (shift == ARM64_SHIFT_NONE || shift > ARM64_SHIFT_MSL) return;
+    if (shift >= ARM64_EXTEND_UXTB && shift <= ARM64_EXTEND_SXTX && amount == 0) {
+        arm64_append(text, ", %s", shift_names[shift]);
+    } else {
+        arm64_append(text, ", %s #%u", shift_names[shift], amount);
+    }
+}
+
+static void arm64_append_sysreg(ARM64TextBuffer *text, uint16_t encoding) {
+    // By op0:op1:CRn:CRm:op2, the bits 20:5 of MRS and MSR
+    static const struct { uint16_t encoding; const char *name; } sysreg_names[] = {
+        { 0xDA10, "NZCV" }, { 0xDA11, "DAIF" }, { 0xDA20, "FPCR" }, { 0xDA21, "FPSR" },
+        { 0xDE82, "TPIDR_EL0" }, { 0xDE83, "TPIDRRO_EL0" }, { 0xDF00, "CNTFRQ_EL0" },
+        { 0xDF01, "CNTPCT_EL0" }, { 0xDF02, "CNTVCT_EL0" }, { 0xD801, "CTR_EL0" },
+        { 0xD807, "DCZID_EL0" }, { 0xC000, "MIDR_EL1" }, { 0xC005, "MPIDR_EL1" },
+        { 0xC684, "TPIDR_EL1" }, { 0xC208, "SP_EL0" }, { 0xC212, "CurrentEL" }, { 0xC210, "SPSel" },
+    };
+    
+    for (size_t i = 0; i < sizeof(sysreg_names) / sizeof(sysreg_names[0]); i++) {
+        if (sysreg_names[i].encoding == encoding) {
+            arm64_append(text, "%s", sysreg_names[i].name);
+            return;
+        }
+    }
+    
+    arm64_append(text, "S%u_%u_C%u_C%u_%u", (encoding >> 14) & 0x3, (encoding >> 11) & 0x7,
+                 (encoding >> 7) & 0xF, (encoding >> 3) & 0xF, encoding & 0x7);
+}
+
+static void arm64_append_pstate(ARM64TextBuffer *text, uint8_t field) {
+    switch (field) {
+        case 0x05: arm64_append(text, "SPSel"); break;
+        case 0x1E: arm64_append(text, "DAIFSet"); break;
+        case 0x1F: arm64_append(text, "DAIFClr"); break;
+        case 0x03: arm64_append(text, "UAO"); break;
+        case 0x04: arm64_append(text, "PAN"); break;
+        case 0x19: arm64_append(text, "SSBS"); break;
+        case 0x1A: arm64_append(text, "DIT"); break;
+        case 0x1C: arm64_append(text, "TCO"); break;
+        default: arm64_append(text, "#0x%X", field); break;
+    }
+}
+
+static void arm64_append_barrier(ARM64TextBuffer *text, uint8_t option) {
+    static const char *const barrier_names[16] = {
+        NULL, "OSHLD", "OSHST", "OSH", NULL, "NSHLD", "NSHST", "NSH",
+        NULL, "ISHLD", "ISHST", "ISH", NULL, "LD", "ST", "SY"
+    };
+    
+    if (option < 16 && barrier_names[option]) {
+        arm64_append(text, "%s", barrier_names[option]);
+    } else {
+        arm64_append(text, "#%u", option);
+    }
+}
+
+static void arm64_append_prefetch(ARM64TextBuffer *text, uint8_t operation) {
+    // Rt = type:target:policy, e.g. PLDL1KEEP
+    static const char *const types[] = { "PLD", "PLI", "PST" };
+    uint8_t type = (operation >> 3) & 0x3;
+    uint8_t target = (operation >> 1) & 0x3;
+    
+    if (type < 3 && target < 3) {
+        arm64_append(text, "%sL%u%s", types[type], target + 1, (operation & 0x1) ? "STRM" : "KEEP");
+    } else {
+        arm64_append(text, "#0x%X", operation);
+    }
+}
+
+static void arm64_append_imm(ARM64TextBuffer *text, int64_t value) {
+    if (value > -10 && value < 10) {
+        arm64_append(text, "#%lld", (long long)value);
+    } else if (value < 0) {
+        arm64_append(text, "#-0x%llX", (unsigned long long)-(uint64_t)value);
+    } else {
+        arm64_append(text, "#0x%llX", (unsigned long long)value);
+    }
+}
+
+static void arm64_append_mem(ARM64TextBuffer *text, const ARM64DecodedOperand *operand, uint64_t address) {
+    if (operand->addressing == ARM64_MEM_LITERAL) {
+        arm64_append(text, "0x%llx", (unsigned long long)(address + (uint64_t)operand->imm));
+        return;
+    }
+    
+    arm64_append_string(text, "[", 1);
+    arm64_append_register(text, operand->reg, ARM64_REG_SP);
+    
+    switch (operand->addressing) {
+        case ARM64_MEM_PRE_INDEX:
+            arm64_append(text, ", #%lld]!", (long long)operand->imm);
+            break;
+        case ARM64_MEM_POST_INDEX:
+            arm64_append(text, "], #%lld", (long long)operand->imm);
+            break;
+        case ARM64_MEM_REG_OFFSET:
+            arm64_append_string(text, ", ", 2);
+            arm64_append_register(text, operand->index, operand->reg_class);
+            arm64_append_shift(text, operand->shift, operand->shift_amount);
+            arm64_append_string(text, "]", 1);
+            break;
+        case ARM64_MEM_POST_INDEX_REG:
+            arm64_append_string(text, "], ", 3);
+            arm64_append_register(text, operand->index, ARM64_REG_X);
+            break;
+        default:
+            if (operand->imm != 0) arm64_append(text, ", #%lld", (long long)operand->imm);
+            arm64_append_string(text, "]", 1);
+            break;
+    }
+}
+
+bool arm64_operand_address(const ARM64DecodedOperand *operand, uint64_t address, uint64_t *out_address) {
+    if (!operand || !out_address) return false;
+    
+    switch (operand->kind) {
+        case ARM64_OPND_LABEL:
+            *out_address = address + (uint64_t)operand->imm;
+            return true;
+        case ARM64_OPND_PAGE:
+            *out_address = (address & ~0xFFFULL) + (uint64_t)operand->imm;
+            return true;
+        case ARM64_OPND_MEM:
+            if (operand->addressing != ARM64_MEM_LITERAL) return false;
+            *out_address = address + (uint64_t)operand->imm;
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void arm64_append_operand(ARM64TextBuffer *text, const ARM64DecodedOperand *operand, uint64_t address) {
+    uint64_t target = 0;
+    
+    switch (operand->kind) {
+        case ARM64_OPND_REG:
+            arm64_append_register(text, operand->reg, operand->reg_class);
+            arm64_append_arrangement(text, operand->arrangement);
+            arm64_append_lane(text, operand->arrangement, operand->lane);
+            arm64_append_shift(text, operand->shift, operand->shift_amount);
+            break;
+        case ARM64_OPND_REG_LIST:
+            arm64_append_string(text, "{", 1);
+            for (uint8_t i = 0; i < operand->count; i++) {
+                if (i > 0) arm64_append_string(text, ", ", 2);
+                arm64_append_register(text, (operand->reg + i) % 32, ARM64_REG_V);
+                arm64_append_arrangement(text, operand->arrangement);
+            }
+            arm64_append_string(text, "}", 1);
+            arm64_append_lane(text, operand->arrangement, operand->lane);
+            break;
+        case ARM64_OPND_IMM:
+            arm64_append_imm(text, operand->imm);
+            arm64_append_shift(text, operand->shift, operand->shift_amount);
+            break;
+        case ARM64_OPND_BITMASK:
+            arm64_append(text, "#0x%llX", (unsigned long long)operand->imm);
+            break;
+        case ARM64_OPND_FP_IMM: {
+            double value;
+            memcpy(&value, &operand->imm, sizeof(value));
+            arm64_append(text, "#%g", value);
+            break;
+        }
+        case ARM64_OPND_MEM:
+            arm64_append_mem(text, operand, address);
+            break;
+        case ARM64_OPND_LABEL:
+        case ARM64_OPND_PAGE:
+            arm64_operand_address(operand, address, &target);
+            arm64_append(text, "0x%llx", (unsigned long long)target);
+            break;
+        case ARM64_OPND_COND:
+            arm64_append(text, "%s", arm64_condition_string((uint8_t)operand->imm));
+            break;
+        case ARM64_OPND_SYSREG:
+            arm64_append_sysreg(text, (uint16_t)operand->imm);
+            break;
+        case ARM64_OPND_PSTATE:
+            arm64_append_pstate(text, (uint8_t)operand->imm);
+            break;
+        case ARM64_OPND_BARRIER:
+            arm64_append_barrier(text, (uint8_t)operand->imm);
+            break;
+        case ARM64_OPND_PREFETCH:
+            arm64_append_prefetch(text, (uint8_t)operand->imm);
+            break;
+        case ARM64_OPND_SYS_OP:
+            arm64_append(text, "#%u, C%u, C%u, #%u", (unsigned)((operand->imm >> 11) & 0x7),
+                         (unsigned)((operand->imm >> 7) & 0xF), (unsigned)((operand->imm >> 3) & 0xF),
+                         (unsigned)(operand->imm & 0x7));
+            break;
+        default:
+            break;
+    }
+}
+
+size_t arm64_format_operand(const ARM64DecodedOperand *operand, uint64_t address, char *buffer, size_t buffer_size) {
+    if (!operand || !buffer || buffer_size == 0) return 0;
+    
+    ARM64TextBuffer text = { buffer, buffer_size, 0 };
+    buffer[0] = '\0';
+    arm64_append_operand(&text, operand, address);
+    return text.length;
+}
+
+size_t arm64_format_operands(const ARM64DecodedWord *decoded, uint64_t address, char *buffer, size_t buffer_size) {
+    if (!decoded || !buffer || buffer_size == 0) return 0;
+    
+    ARM64TextBuffer text = { buffer, buffer_size, 0 };
+    buffer[0] = '\0';
+    for (uint8_t i = 0; i < decoded->operand_count; i++) {
+        if (i > 0) arm64_append_string(&text, ", ", 2);
+        arm64_append_operand(&text, &decoded->operands[i], address);
+    }
+    return text.length;
+}
+
+static void arm64_render(const ARM64DecodedWord *decoded, uint32_t bytes, uint64_t address, DisassembledInstruction *inst) {
+    memset(inst, 0, sizeof(DisassembledInstruction));
+    inst->address = address;
+    inst->raw_bytes = bytes;
+    inst->length = 4;
+    
+    inst->category = (InstructionCategory)decoded->category;
+    inst->branch_type = (BranchType)decoded->branch_type;
+    inst->regs_read = decoded->regs_read;
+    inst->regs_written = decoded->regs_written;
+    inst->is_valid = (decoded->flags & INST_FLAG_VALID) != 0;
+    inst->is_function_start = (decoded->flags & INST_FLAG_FUNCTION_START) != 0;
+    inst->is_function_end = (decoded->flags & INST_FLAG_FUNCTION_END) != 0;
+    inst->updates_pc = (decoded->flags & INST_FLAG_UPDATES_PC) != 0;
+    inst->has_branch = (decoded->flags & INST_FLAG_HAS_BRANCH) != 0;
+    
+    if (decoded->flags & INST_FLAG_HAS_BRANCH_TARGET) {
+        inst->has_branch_target = true;
+        inst->branch_offset = decoded->branch_delta;
+        inst->branch_target = address + (int64_t)decoded->branch_delta;
+    }
+    
+    strcpy(inst->mnemonic, arm64_mnemonic_name(decoded->mnemonic));
+    
+    if (decoded->mnemonic == ARM64_MNEMONIC_WORD) {
+        snprintf(inst->operands, sizeof(inst->operands), "0x%08X", bytes);
+    } else {
+        arm64_format_operands(decoded, address, inst->operands, sizeof(inst->operands));
+    }
+    
+    snprintf(inst->full_disasm, sizeof(inst->full_disasm), "0x%llx: %s %s",
+             inst->address, inst->mnemonic, inst->operands);
+}
+
+bool disasm_arm64(uint32_t bytes, uint64_t address, DisassembledInstruction *inst) {
+    ARM64DecodedWord decoded;
+    arm64_decode_word(bytes, &decoded);
+    arm64_render(&decoded, bytes, address, inst);
+    return inst->is_valid;
+}
+
+#pragma mark - x86_64 Decode Tables
+
+// Indexed by X86Mnemonic
+static const char *const x86_mnemonics[X86_MNEMONIC_COUNT] = {
+    "ADD", "OR", "ADC", "SBB",
+    "AND", "SUB", "XOR", "CMP",
+    "ROL", "ROR", "RCL", "RCR",
+    "SHL", "SHR", "SAL", "SAR",
+    "TEST", "NOT", "NEG",
+    "MUL", "IMUL", "DIV", "IDIV",
+    "INC", "DEC", "CALL", "CALLF",
+    "JMP", "JMPF", "PUSH", "POP",
+    "JO", "JNO", "JB", "JAE",
+    "JE", "JNE", "JBE", "JA",
+    "JS", "JNS", "JP", "JNP",
+    "JL", "JGE", "JLE", "JG",
+    "CMOVO", "CMOVNO", "CMOVB", "CMOVAE",
+    "CMOVE", "CMOVNE", "CMOVBE", "CMOVA",
+    "CMOVS", "CMOVNS", "CMOVP", "CMOVNP",
+    "CMOVL", "CMOVGE", "CMOVLE", "CMOVG",
+    "SETO", "SETNO", "SETB", "SETAE",
+    "SETE", "SETNE", "SETBE", "SETA",
+    "SETS", "SETNS", "SETP", "SETNP",
+    "SETL", "SETGE", "SETLE", "SETG",
+    "MOVSB", "MOVSW", "MOVSD", "MOVSQ",
+    "CMPSB", "CMPSW", "CMPSD", "CMPSQ",
+    "STOSB", "STOSW", "STOSD", "STOSQ",
+    "LODSB", "LODSW", "LODSD", "LODSQ",
+    "SCASB", "SCASW", "SCASD", "SCASQ",
+    "INSB", "INSW", "INSD",
+    "OUTSB", "OUTSW", "OUTSD",
+    "MOV", "MOVSX", "MOVZX", "MOVSXD",
+    "LEA", "XCHG", "NOP", "PAUSE",
+    "CBW", "CWDE", "CDQE",
+    "CWD", "CDQ", "CQO",
+    "PUSHF", "POPF", "SAHF", "LAHF",
+    "XLAT", "ENTER", "LEAVE",
+    "RET", "RETF", "IRET",
+    "LOOPNE", "LOOPE", "LOOP", "JRCXZ",
+    "CMC", "CLC", "STC", "CLI",
+    "STI", "CLD", "STD",
+    "BT", "BTS", "BTR", "BTC",
+    "BSF", "BSR", "TZCNT", "LZCNT",
+    "POPCNT", "BSWAP", "SHLD", "SHRD",
+    "CMPXCHG", "XADD", "MOVNTI",
+    "PREFETCH", "PREFETCHW", "ENDBR64",
+    "INT3", "INT", "INT1", "HLT",
+    "IN", "OUT", "WAIT",
+    "SYSCALL", "SYSRET", "CPUID", "RDTSC",
+    "UD2", "UD1", "UD0",
+    "MOVUPS", "MOVUPD", "MOVSS", "MOVSD",
+    "SQRTPS", "SQRTPD", "SQRTSS", "SQRTSD",
+    "ADDPS", "ADDPD", "ADDSS", "ADDSD",
+    "MULPS", "MULPD", "MULSS", "MULSD",
+    "CVTPS2PD", "CVTPD2PS", "CVTSS2SD", "CVTSD2SS",
+    "SUBPS", "SUBPD", "SUBSS", "SUBSD",
+    "MINPS", "MINPD", "MINSS", "MINSD",
+    "DIVPS", "DIVPD", "DIVSS", "DIVSD",
+    "MAXPS", "MAXPD", "MAXSS", "MAXSD",
+    "MOVAPS", "MOVAPD", "UCOMISS", "UCOMISD",
+    "COMISS", "COMISD", "ANDPS", "ANDPD",
+    "ANDNPS", "ANDNPD", "ORPS", "ORPD",
+    "XORPS", "XORPD",
+    "CVTSI2SS", "CVTSI2SD", "CVTTSS2SI", "CVTTSD2SI",
+    "CVTSS2SI", "CVTSD2SI",
+    "MOVD", "MOVQ", "MOVDQA", "MOVDQU",
+    "PXOR",
+    "FPU",
+    "SIMD",
+    ".op",
+    ".byte"
+};
+
+// Marks the reserved slots of a group
+#define X86_INVALID X86_MNEMONIC_COUNT
+
+// Operand layouts, named as in the Intel opcode maps: E is the ModRM r/m
+// operand, G the ModRM reg field, I an immediate, Z a register in the low
+// three opcode bits, A the accumulator, X an XMM register in the reg field
+// and XE an XMM register or memory in r/m
+typedef enum {
+    X86_FORM_NONE,
+    X86_FORM_E,
+    X86_FORM_E_G,
+    X86_FORM_G_E,
+    X86_FORM_E_I,
+    X86_FORM_E_1,
+    X86_FORM_E_CL,
+    X86_FORM_G_E_I,
+    X86_FORM_E_G_I,
+    X86_FORM_E_G_CL,
+    
+    // MOVZX/MOVSX from a byte or a word, MOVSXD from a doubleword
+    X86_FORM_G_EB,
+    X86_FORM_G_EW,
+    X86_FORM_G_ED,
+    
+    X86_FORM_A_I,
+    X86_FORM_I_A,
+    X86_FORM_A_DX,
+    X86_FORM_DX_A,
+    X86_FORM_Z,
+    X86_FORM_Z_I,
+    X86_FORM_Z_A,
+    X86_FORM_I,
+    X86_FORM_I_I,
+    X86_FORM_REL,
+    X86_FORM_A_MOFFS,
+    X86_FORM_MOFFS_A,
+    X86_FORM_E_SEG,
+    X86_FORM_SEG_E,
+    X86_FORM_X_XE,
+    X86_FORM_XE_X,
+    
+    // XMM and a general purpose register or memory (CVTSI2SS, MOVD)
+    X86_FORM_X_E,
+    X86_FORM_E_X,
+    X86_FORM_G_XE
+} X86Form;
+
+// Attribute bits of an opcode. The immediate kind sits in the top bits.
+enum {
+    X86_ATTR_MODRM = 1 << 0,
+    
+    // ModRM whose mod field is ignored: r/m is always a register (MOV to and
+    // from control and debug registers)
+    X86_ATTR_MODRM_REG = 1 << 1,
+    
+    // 8-bit operand size
+    X86_ATTR_BYTE = 1 << 2,
+    
+    // 64-bit operand size without REX.W (stack and near branch instructions)
+    X86_ATTR_DEFAULT64 = 1 << 3,
+    
+    // The immediate is a branch displacement
+    X86_ATTR_REL = 1 << 4,
+    
+    X86_ATTR_INVALID = 1 << 5,
+    
+    // Named SSE instruction for every mandatory prefix, or only for none
+    // and 66; the mnemonic is the first of the run
+    X86_ATTR_SSE4 = 1 << 6,
+    X86_ATTR_SSE2 = 1 << 7
+};
+
+#define X86_ATTR_IMM_SHIFT 12
+
+enum {
+    X86_IMM_NONE,
+    X86_IMM_B,
+    X86_IMM_W,
+    
+    // 4 bytes whatever the prefixes (near branch displacements)
+    X86_IMM_D,
+    
+    // 2 bytes with a 66 prefix, else 4
+    X86_IMM_Z,
+    
+    // 2, 4 or 8 bytes by operand size (MOV r, imm)
+    X86_IMM_V,
+    
+    // ENTER: a word and a byte
+    X86_IMM_W_B,
+    
+    // Absolute address of MOV A0-A3: 8 bytes, 4 with a 67 prefix
+    X86_IMM_MOFFS,
+    
+    // F6/F7: TEST /0 and /1 carry an immediate of the operand size, the
+    // rest of the group none
+    X86_IMM_GROUP3
+};
+
+#define X86_IMM(kind) ((uint16_t)((kind) << X86_ATTR_IMM_SHIFT))
+
+typedef struct {
+    uint16_t attrs;
+    
+    // X86Mnemonic, or the first of a run (X86_ATTR_SSE4/SSE2, string and
+    // CBW/CWD families); unused when group is set
+    uint16_t mnemonic;
+    
+    uint8_t form;
+    
+    // Row of x86_groups selected by the ModRM reg field, 0 for none
+    uint8_t group;
+} X86Opcode;
+
+enum {
+    X86_GROUP_NONE,
+    X86_GROUP_ALU,
+    X86_GROUP_SHIFT,
+    X86_GROUP_UNARY,
+    X86_GROUP_INC_DEC,
+    X86_GROUP_INDIRECT,
+    X86_GROUP_POP,
+    X86_GROUP_MOV,
+    X86_GROUP_BIT_TEST,
+    X86_GROUP_PREFETCH,
+    X86_GROUP_COUNT
+};
+
+static const uint16_t x86_groups[X86_GROUP_COUNT][8] = {
+    [X86_GROUP_ALU] = {
+        X86_MNEMONIC_ADD, X86_MNEMONIC_OR, X86_MNEMONIC_ADC, X86_MNEMONIC_SBB,
+        X86_MNEMONIC_AND, X86_MNEMONIC_SUB, X86_MNEMONIC_XOR, X86_MNEMONIC_CMP
+    },
+    [X86_GROUP_SHIFT] = {
+        X86_MNEMONIC_ROL, X86_MNEMONIC_ROR, X86_MNEMONIC_RCL, X86_MNEMONIC_RCR,
+        X86_MNEMONIC_SHL, X86_MNEMONIC_SHR, X86_MNEMONIC_SAL, X86_MNEMONIC_SAR
+    },
+    [X86_GROUP_UNARY] = {
+        X86_MNEMONIC_TEST, X86_MNEMONIC_TEST, X86_MNEMONIC_NOT, X86_MNEMONIC_NEG,
+        X86_MNEMONIC_MUL, X86_MNEMONIC_IMUL, X86_MNEMONIC_DIV, X86_MNEMONIC_IDIV
+    },
+    [X86_GROUP_INC_DEC] = {
+        X86_MNEMONIC_INC, X86_MNEMONIC_DEC, X86_INVALID, X86_INVALID,
+        X86_INVALID, X86_INVALID, X86_INVALID, X86_INVALID
+    },
+    [X86_GROUP_INDIRECT] = {
+        X86_MNEMONIC_INC, X86_MNEMONIC_DEC, X86_MNEMONIC_CALL, X86_MNEMONIC_CALLF,
+        X86_MNEMONIC_JMP, X86_MNEMONIC_JMPF, X86_MNEMONIC_PUSH, X86_INVALID
+    },
+    [X86_GROUP_POP] = {
+        X86_MNEMONIC_POP, X86_INVALID, X86_INVALID, X86_INVALID,
+        X86_INVALID, X86_INVALID, X86_INVALID, X86_INVALID
+    },
+    
+    // /7 is XABORT (C6 F8) and XBEGIN (C7 F8)
+    [X86_GROUP_MOV] = {
+        X86_MNEMONIC_MOV, X86_INVALID, X86_INVALID, X86_INVALID,
+        X86_INVALID, X86_INVALID, X86_INVALID, X86_MNEMONIC_OPCODE
+    },
+    [X86_GROUP_BIT_TEST] = {
+        X86_INVALID, X86_INVALID, X86_INVALID, X86_INVALID,
+        X86_MNEMONIC_BT, X86_MNEMONIC_BTS, X86_MNEMONIC_BTR, X86_MNEMONIC_BTC
+    },
+    
+    // 0F 18: /4-/7 are reserved hints, executed as NOP
+    [X86_GROUP_PREFETCH] = {
+        X86_MNEMONIC_PREFETCH, X86_MNEMONIC_PREFETCH, X86_MNEMONIC_PREFETCH, X86_MNEMONIC_PREFETCH,
+        X86_MNEMONIC_NOP, X86_MNEMONIC_NOP, X86_MNEMONIC_NOP, X86_MNEMONIC_NOP
+    }
+};
+
+typedef struct {
+    uint8_t map;
+    uint8_t first;
+    uint8_t last;
+    uint16_t attrs;
+    uint16_t mnemonic;
+    
+    // Added to mnemonic per opcode of the range (Jcc, SETcc...)
+    uint8_t step;
+    
+    uint8_t form;
+    uint8_t group;
+} X86OpcodeRange;
+
+#define X86_MAP_ONE_BYTE 0
+#define X86_MAP_0F 1
+#define X86_MAP_0F38 2
+#define X86_MAP_0F3A 3
+#define X86_MAP_COUNT 4
+
+#define M X86_ATTR_MODRM
+#define B X86_ATTR_BYTE
+#define D64 X86_ATTR_DEFAULT64
+
+// Opcode maps of 64-bit mode, applied in order over a table where every
+// opcode starts out invalid; later ranges override earlier ones. Only the
+// map and the ModRM reg field are needed to pick an entry; mandatory
+// prefixes and REX are looked at by the decoder afterwards.
+static const X86OpcodeRange x86_opcode_ranges[] = {
+    // ALU rows 00-3F are generated by x86_build_opcode_table()
+    { 0, 0x50, 0x57, D64, X86_MNEMONIC_PUSH, 0, X86_FORM_Z, 0 },
+    { 0, 0x58, 0x5F, D64, X86_MNEMONIC_POP, 0, X86_FORM_Z, 0 },
+    { 0, 0x63, 0x63, M, X86_MNEMONIC_MOVSXD, 0, X86_FORM_G_ED, 0 },
+    { 0, 0x68, 0x68, D64 | X86_IMM(X86_IMM_Z), X86_MNEMONIC_PUSH, 0, X86_FORM_I, 0 },
+    { 0, 0x69, 0x69, M | X86_IMM(X86_IMM_Z), X86_MNEMONIC_IMUL, 0, X86_FORM_G_E_I, 0 },
+    { 0, 0x6A, 0x6A, D64 | X86_IMM(X86_IMM_B), X86_MNEMONIC_PUSH, 0, X86_FORM_I, 0 },
+    { 0, 0x6B, 0x6B, M | X86_IMM(X86_IMM_B), X86_MNEMONIC_IMUL, 0, X86_FORM_G_E_I, 0 },
+    { 0, 0x6C, 0x6C, B, X86_MNEMONIC_INSB, 0, X86_FORM_NONE, 0 },
+    { 0, 0x6D, 0x6D, 0, X86_MNEMONIC_INSB, 0, X86_FORM_NONE, 0 },
+    { 0, 0x6E, 0x6E, B, X86_MNEMONIC_OUTSB, 0, X86_FORM_NONE, 0 },
+    { 0, 0x6F, 0x6F, 0, X86_MNEMONIC_OUTSB, 0, X86_FORM_NONE, 0 },
+    { 0, 0x70, 0x7F, D64 | X86_ATTR_REL | X86_IMM(X86_IMM_B), X86_MNEMONIC_JO, 1, X86_FORM_REL, 0 },
+    { 0, 0x80, 0x80, M | B | X86_IMM(X86_IMM_B), 0, 0, X86_FORM_E_I, X86_GROUP_ALU },
+    { 0, 0x81, 0x81, M | X86_IMM(X86_IMM_Z), 0, 0, X86_FORM_E_I, X86_GROUP_ALU },
+    { 0, 0x83, 0x83, M | X86_IMM(X86_IMM_B), 0, 0, X86_FORM_E_I, X86_GROUP_ALU },
+    { 0, 0x84, 0x84, M | B, X86_MNEMONIC_TEST, 0, X86_FORM_E_G, 0 },
+    { 0, 0x85, 0x85, M, X86_MNEMONIC_TEST, 0, X86_FORM_E_G, 0 },
+    { 0, 0x86, 0x86, M | B, X86_MNEMONIC_XCHG, 0, X86_FORM_E_G, 0 },
+    { 0, 0x87, 0x87, M, X86_MNEMONIC_XCHG, 0, X86_FORM_E_G, 0 },
+    { 0, 0x88, 0x88, M | B, X86_MNEMONIC_MOV, 0, X86_FORM_E_G, 0 },
+    { 0, 0x89, 0x89, M, X86_MNEMONIC_MOV, 0, X86_FORM_E_G, 0 },
+    { 0, 0x8A, 0x8A, M | B, X86_MNEMONIC_MOV, 0, X86_FORM_G_E, 0 },
+    { 0, 0x8B, 0x8B, M, X86_MNEMONIC_MOV, 0, X86_FORM_G_E, 0 },
+    { 0, 0x8C, 0x8C, M, X86_MNEMONIC_MOV, 0, X86_FORM_E_SEG, 0 },
+    { 0, 0x8D, 0x8D, M, X86_MNEMONIC_LEA, 0, X86_FORM_G_E, 0 },
+    { 0, 0x8E, 0x8E, M, X86_MNEMONIC_MOV, 0, X86_FORM_SEG_E, 0 },
+    { 0, 0x8F, 0x8F, M | D64, 0, 0, X86_FORM_E, X86_GROUP_POP },
+    { 0, 0x90, 0x90, 0, X86_MNEMONIC_NOP, 0, X86_FORM_NONE, 0 },
+    { 0, 0x91, 0x97, 0, X86_MNEMONIC_XCHG, 0, X86_FORM_Z_A, 0 },
+    { 0, 0x98, 0x98, 0, X86_MNEMONIC_CBW, 0, X86_FORM_NONE, 0 },
+    { 0, 0x99, 0x99, 0, X86_MNEMONIC_CWD, 0, X86_FORM_NONE, 0 },
+    { 0, 0x9B, 0x9B, 0, X86_MNEMONIC_WAIT, 0, X86_FORM_NONE, 0 },
+    { 0, 0x9C, 0x9C, D64, X86_MNEMONIC_PUSHF, 0, X86_FORM_NONE, 0 },
+    { 0, 0x9D, 0x9D, D64, X86_MNEMONIC_POPF, 0, X86_FORM_NONE, 0 },
+    { 0, 0x9E, 0x9E, 0, X86_MNEMONIC_SAHF, 0, X86_FORM_NONE, 0 },
+    { 0, 0x9F, 0x9F, 0, X86_MNEMONIC_LAHF, 0, X86_FORM_NONE, 0 },
+    { 0, 0xA0, 0xA0, B | X86_IMM(X86_IMM_MOFFS), X86_MNEMONIC_MOV, 0, X86_FORM_A_MOFFS, 0 },
+    { 0, 0xA1, 0xA1, X86_IMM(X86_IMM_MOFFS), X86_MNEMONIC_MOV, 0, X86_FORM_A_MOFFS, 0 },
+    { 0, 0xA2, 0xA2, B | X86_IMM(X86_IMM_MOFFS), X86_MNEMONIC_MOV, 0, X86_FORM_MOFFS_A, 0 },
+    { 0, 0xA3, 0xA3, X86_IMM(X86_IMM_MOFFS), X86_MNEMONIC_MOV, 0, X86_FORM_MOFFS_A, 0 },
+    { 0, 0xA4, 0xA4, B, X86_MNEMONIC_MOVSB, 0, X86_FORM_NONE, 0 },
+    { 0, 0xA5, 0xA5, 0, X86_MNEMONIC_MOVSB, 0, X86_FORM_NONE, 0 },
+    { 0, 0xA6, 0xA6, B, X86_MNEMONIC_CMPSB, 0, X86_FORM_NONE, 0 },
+    { 0, 0xA7, 0xA7, 0, X86_MNEMONIC_CMPSB, 0, X86_FORM_NONE, 0 },
+    { 0, 0xA8, 0xA8, B | X86_IMM(X86_IMM_B), X86_MNEMONIC_TEST, 0, X86_FORM_A_I, 0 },
+    { 0, 0xA9, 0xA9, X86_IMM(X86_IMM_Z), X86_MNEMONIC_TEST, 0, X86_FORM_A_I, 0 },
+    { 0, 0xAA, 0xAA, B, X86_MNEMONIC_STOSB, 0, X86_FORM_NONE, 0 },
+    { 0, 0xAB, 0xAB, 0, X86_MNEMONIC_STOSB, 0, X86_FORM_NONE, 0 },
+    { 0, 0xAC, 0xAC, B, X86_MNEMONIC_LODSB, 0, X86_FORM_NONE, 0 },
+    { 0, 0xAD, 0xAD, 0, X86_MNEMONIC_LODSB, 0, X86_FORM_NONE, 0 },
+    { 0, 0xAE, 0xAE, B, X86_MNEMONIC_SCASB, 0, X86_FORM_NONE, 0 },
+    { 0, 0xAF, 0xAF, 0, X86_MNEMONIC_SCASB, 0, X86_FORM_NONE, 0 },
+    { 0, 0xB0, 0xB7, B | X86_IMM(X86_IMM_B), X86_MNEMONIC_MOV, 0, X86_FORM_Z_I, 0 },
+    { 0, 0xB8, 0xBF, X86_IMM(X86_IMM_V), X86_MNEMONIC_MOV, 0, X86_FORM_Z_I, 0 },
+    { 0, 0xC0, 0xC0, M | B | X86_IMM(X86_IMM_B), 0, 0, X86_FORM_E_I, X86_GROUP_SHIFT },
+    { 0, 0xC1, 0xC1, M | X86_IMM(X86_IMM_B), 0, 0, X86_FORM_E_I, X86_GROUP_SHIFT },
+    { 0, 0xC2, 0xC2, D64 | X86_IMM(X86_IMM_W), X86_MNEMONIC_RET, 0, X86_FORM_I, 0 },
+    { 0, 0xC3, 0xC3, D64, X86_MNEMONIC_RET, 0, X86_FORM_NONE, 0 },
+    { 0, 0xC6, 0xC6, M | B | X86_IMM(X86_IMM_B), 0, 0, X86_FORM_E_I, X86_GROUP_MOV },
+    { 0, 0xC7, 0xC7, M | X86_IMM(X86_IMM_Z), 0, 0, X86_FORM_E_I, X86_GROUP_MOV },
+    { 0, 0xC8, 0xC8, D64 | X86_IMM(X86_IMM_W_B), X86_MNEMONIC_ENTER, 0, X86_FORM_I_I, 0 },
+    { 0, 0xC9, 0xC9, D64, X86_MNEMONIC_LEAVE, 0, X86_FORM_NONE, 0 },
+    { 0, 0xCA, 0xCA, X86_IMM(X86_IMM_W), X86_MNEMONIC_RETF, 0, X86_FORM_I, 0 },
+    { 0, 0xCB, 0xCB, 0, X86_MNEMONIC_RETF, 0, X86_FORM_NONE, 0 },
+    { 0, 0xCC, 0xCC, 0, X86_MNEMONIC_INT3, 0, X86_FORM_NONE, 0 },
+    { 0, 0xCD, 0xCD, X86_IMM(X86_IMM_B), X86_MNEMONIC_INT, 0, X86_FORM_I, 0 },
+    { 0, 0xCF, 0xCF, 0, X86_MNEMONIC_IRET, 0, X86_FORM_NONE, 0 },
+    { 0, 0xD0, 0xD0, M | B, 0, 0, X86_FORM_E_1, X86_GROUP_SHIFT },
+    { 0, 0xD1, 0xD1, M, 0, 0, X86_FORM_E_1, X86_GROUP_SHIFT },
+    { 0, 0xD2, 0xD2, M | B, 0, 0, X86_FORM_E_CL, X86_GROUP_SHIFT },
+    { 0, 0xD3, 0xD3, M, 0, 0, X86_FORM_E_CL, X86_GROUP_SHIFT },
+    { 0, 0xD7, 0xD7, 0, X86_MNEMONIC_XLAT, 0, X86_FORM_NONE, 0 },
+    { 0, 0xD8, 0xDF, M, X86_MNEMONIC_FPU, 0, X86_FORM_NONE, 0 },
+    { 0, 0xE0, 0xE2, D64 | X86_ATTR_REL | X86_IMM(X86_IMM_B), X86_MNEMONIC_LOOPNE, 1, X86_FORM_REL, 0 },
+    { 0, 0xE3, 0xE3, D64 | X86_ATTR_REL | X86_IMM(X86_IMM_B), X86_MNEMONIC_JRCXZ, 0, X86_FORM_REL, 0 },
+    { 0, 0xE4, 0xE4, B | X86_IMM(X86_IMM_B), X86_MNEMONIC_IN, 0, X86_FORM_A_I, 0 },
+    { 0, 0xE5, 0xE5, X86_IMM(X86_IMM_B), X86_MNEMONIC_IN, 0, X86_FORM_A_I, 0 },
+    { 0, 0xE6, 0xE6, B | X86_IMM(X86_IMM_B), X86_MNEMONIC_OUT, 0, X86_FORM_I_A, 0 },
+    { 0, 0xE7, 0xE7, X86_IMM(X86_IMM_B), X86_MNEMONIC_OUT, 0, X86_FORM_I_A, 0 },
+    { 0, 0xE8, 0xE8, D64 | X86_ATTR_REL | X86_IMM(X86_IMM_D), X86_MNEMONIC_CALL, 0, X86_FORM_REL, 0 },
+    { 0, 0xE9, 0xE9, D64 | X86_ATTR_REL | X86_IMM(X86_IMM_D), X86_MNEMONIC_JMP, 0, X86_FORM_REL, 0 },
+    { 0, 0xEB, 0xEB, D64 | X86_ATTR_REL | X86_IMM(X86_IMM_B), X86_MNEMONIC_JMP, 0, X86_FORM_REL, 0 },
+    { 0, 0xEC, 0xEC, B, X86_MNEMONIC_IN, 0, X86_FORM_A_DX, 0 },
+    { 0, 0xED, 0xED, 0, X86_MNEMONIC_IN, 0, X86_FORM_A_DX, 0 },
+    { 0, 0xEE, 0xEE, B, X86_MNEMONIC_OUT, 0, X86_FORM_DX_A, 0 },
+    { 0, 0xEF, 0xEF, 0, X86_MNEMONIC_OUT, 0, X86_FORM_DX_A, 0 },
+    { 0, 0xF1, 0xF1, 0, X86_MNEMONIC_INT1, 0, X86_FORM_NONE, 0 },
+    { 0, 0xF4, 0xF4, 0, X86_MNEMONIC_HLT, 0, X86_FORM_NONE, 0 },
+    { 0, 0xF5, 0xF5, 0, X86_MNEMONIC_CMC, 0, X86_FORM_NONE, 0 },
+    { 0, 0xF6, 0xF6, M | B | X86_IMM(X86_IMM_GROUP3), 0, 0, X86_FORM_E, X86_GROUP_UNARY },
+    { 0, 0xF7, 0xF7, M | X86_IMM(X86_IMM_GROUP3), 0, 0, X86_FORM_E, X86_GROUP_UNARY },
+    { 0, 0xF8, 0xFD, 0, X86_MNEMONIC_CLC, 1, X86_FORM_NONE, 0 },
+    { 0, 0xFE, 0xFE, M | B, 0, 0, X86_FORM_E, X86_GROUP_INC_DEC },
+    { 0, 0xFF, 0xFF, M, 0, 0, X86_FORM_E, X86_GROUP_INDIRECT },
+    
+    // Two-byte map (0F xx). Most of 0F 10-7F and 0F C2-FF is SSE/MMX, named
+    // only for the common scalar and move instructions.
+    { 1, 0x00, 0x03, M, X86_MNEMONIC_OPCODE, 0, X86_FORM_NONE, 0 },
+    { 1, 0x05, 0x05, 0, X86_MNEMONIC_SYSCALL, 0, X86_FORM_NONE, 0 },
+    { 1, 0x06, 0x06, 0, X86_MNEMONIC_OPCODE, 0, X86_FORM_NONE, 0 },
+    { 1, 0x07, 0x07, 0, X86_MNEMONIC_SYSRET, 0, X86_FORM_NONE, 0 },
+    { 1, 0x08, 0x09, 0, X86_MNEMONIC_OPCODE, 0, X86_FORM_NONE, 0 },
+    { 1, 0x0B, 0x0B, 0, X86_MNEMONIC_UD2, 0, X86_FORM_NONE, 0 },
+    { 1, 0x0D, 0x0D, M, X86_MNEMONIC_PREFETCHW, 0, X86_FORM_E, 0 },
+    { 1, 0x0E, 0x0E, 0, X86_MNEMONIC_SIMD, 0, X86_FORM_NONE, 0 },
+    { 1, 0x0F, 0x0F, M | X86_IMM(X86_IMM_B), X86_MNEMONIC_SIMD, 0, X86_FORM_NONE, 0 },
+    { 1, 0x10, 0x17, M, X86_MNEMONIC_SIMD, 0, X86_FORM_NONE, 0 },
+    { 1, 0x10, 0x10, M | X86_ATTR_SSE4, X86_MNEMONIC_MOVUPS, 0, X86_FORM_X_XE, 0 },
+    { 1, 0x11, 0x11, M | X86_ATTR_SSE4, X86_MNEMONIC_MOVUPS, 0, X86_FORM_XE_X, 0 },
+    { 1, 0x18, 0x18, M, 0, 0, X86_FORM_E, X86_GROUP_PREFETCH },
+    { 1, 0x19, 0x1F, M, X86_MNEMONIC_NOP, 0, X86_FORM_E, 0 },
+    { 1, 0x20, 0x23, M | X86_ATTR_MODRM_REG, X86_MNEMONIC_OPCODE, 0, X86_FORM_NONE, 0 },
+    { 1, 0x28, 0x2F, M, X86_MNEMONIC_SIMD, 0, X86_FORM_NONE, 0 },
+    { 1, 0x28, 0x28, M | X86_ATTR_SSE2, X86_MNEMONIC_MOVAPS, 0, X86_FORM_X_XE, 0 },
+    { 1, 0x29, 0x29, M | X86_ATTR_SSE2, X86_MNEMONIC_MOVAPS, 0, X86_FORM_XE_X, 0 },
+    { 1, 0x2E, 0x2E, M | X86_ATTR_SSE2, X86_MNEMONIC_UCOMISS, 0, X86_FORM_X_XE, 0 },
+    { 1, 0x2F, 0x2F, M | X86_ATTR_SSE2, X86_MNEMONIC_COMISS, 0, X86_FORM_X_XE, 0 },
+    { 1, 0x30, 0x35, 0, X86_MNEMONIC_OPCODE, 0, X86_FORM_NONE, 0 },
+    { 1, 0x31, 0x31, 0, X86_MNEMONIC_RDTSC, 0, X86_FORM_NONE, 0 },
+    { 1, 0x37, 0x37, 0, X86_MNEMONIC_OPCODE, 0, X86_FORM_NONE, 0 },
+    { 1, 0x40, 0x4F, M, X86_MNEMONIC_CMOVO, 1, X86_FORM_G_E, 0 },
+    { 1, 0x50, 0x7F, M, X86_MNEMONIC_SIMD, 0, X86_FORM_NONE, 0 },
+    { 1, 0x51, 0x51, M | X86_ATTR_SSE4, X86_MNEMONIC_SQRTPS, 0, X86_FORM_X_XE, 0 },
+    { 1, 0x54, 0x57, M | X86_ATTR_SSE2, X86_MNEMONIC_ANDPS, 2, X86_FORM_X_XE, 0 },
+    { 1, 0x58, 0x5A, M | X86_ATTR_SSE4, X86_MNEMONIC_ADDPS, 4, X86_FORM_X_XE, 0 },
+    { 1, 0x5C, 0x5F, M | X86_ATTR_SSE4, X86_MNEMONIC_SUBPS, 4, X86_FORM_X_XE, 0 },
+    { 1, 0x70, 0x73, M | X86_IMM(X86_IMM_B), X86_MNEMONIC_SIMD, 0, X86_FORM_NONE, 0 },
+    { 1, 0x77, 0x77, 0, X86_MNEMONIC_SIMD, 0, X86_FORM_NONE, 0 },
+    { 1, 0x78, 0x79, M, X86_MNEMONIC_OPCODE, 0, X86_FORM_NONE, 0 },
+    { 1, 0x7A, 0x7B, X86_ATTR_INVALID, 0, 0, X86_FORM_NONE, 0 },
+    { 1, 0x80, 0x8F, D64 | X86_ATTR_REL | X86_IMM(X86_IMM_D), X86_MNEMONIC_JO, 1, X86_FORM_REL, 0 },
+    { 1, 0x90, 0x9F, M | B, X86_MNEMONIC_SETO, 1, X86_FORM_E, 0 },
+    { 1, 0xA0, 0xA0, D64, X86_MNEMONIC_OPCODE, 0, X86_FORM_NONE, 0 },
+    { 1, 0xA1, 0xA1, D64, X86_MNEMONIC_OPCODE, 0, X86_FORM_NONE, 0 },
+    { 1, 0xA2, 0xA2, 0, X86_MNEMONIC_CPUID, 0, X86_FORM_NONE, 0 },
+    { 1, 0xA3, 0xA3, M, X86_MNEMONIC_BT, 0, X86_FORM_E_G, 0 },
+    { 1, 0xA4, 0xA4, M | X86_IMM(X86_IMM_B), X86_MNEMONIC_SHLD, 0, X86_FORM_E_G_I, 0 },
+    { 1, 0xA5, 0xA5, M, X86_MNEMONIC_SHLD, 0, X86_FORM_E_G_CL, 0 },
+    { 1, 0xA8, 0xA9, D64, X86_MNEMONIC_OPCODE, 0, X86_FORM_NONE, 0 },
+    { 1, 0xAA, 0xAA, 0, X86_MNEMONIC_OPCODE, 0, X86_FORM_NONE, 0 },
+    { 1, 0xAB, 0xAB, M, X86_MNEMONIC_BTS, 0, X86_FORM_E_G, 0 },
+    { 1, 0xAC, 0xAC, M | X86_IMM(X86_IMM_B), X86_MNEMONIC_SHRD, 0, X86_FORM_E_G_I, 0 },
+    { 1, 0xAD, 0xAD, M, X86_MNEMONIC_SHRD, 0, X86_FORM_E_G_CL, 0 },
+    { 1, 0xAE, 0xAE, M, X86_MNEMONIC_OPCODE, 0, X86_FORM_NONE, 0 },
+    { 1, 0xAF, 0xAF, M, X86_MNEMONIC_IMUL, 0, X86_FORM_G_E, 0 },
+    { 1, 0xB0, 0xB0, M | B, X86_MNEMONIC_CMPXCHG, 0, X86_FORM_E_G, 0 },
+    { 1, 0xB1, 0xB1, M, X86_MNEMONIC_CMPXCHG, 0, X86_FORM_E_G, 0 },
+    { 1, 0xB2, 0xB2, M, X86_MNEMONIC_OPCODE, 0, X86_FORM_NONE, 0 },
+    { 1, 0xB3, 0xB3, M, X86_MNEMONIC_BTR, 0, X86_FORM_E_G, 0 },
+    { 1, 0xB4, 0xB5, M, X86_MNEMONIC_OPCODE, 0, X86_FORM_NONE, 0 },
+    { 1, 0xB6, 0xB6, M, X86_MNEMONIC_MOVZX, 0, X86_FORM_G_EB, 0 },
+    { 1, 0xB7, 0xB7, M, X86_MNEMONIC_MOVZX, 0, X86_FORM_G_EW, 0 },
+    { 1, 0xB8, 0xB8, M, X86_MNEMONIC_POPCNT, 0, X86_FORM_G_E, 0 },
+    { 1, 0xB9, 0xB9, M, X86_MNEMONIC_UD1, 0, X86_FORM_G_E, 0 },
+    { 1, 0xBA, 0xBA, M | X86_IMM(X86_IMM_B), 0, 0, X86_FORM_E_I, X86_GROUP_BIT_TEST },
+    { 1, 0xBB, 0xBB, M, X86_MNEMONIC_BTC, 0, X86_FORM_E_G, 0 },
+    { 1, 0xBC, 0xBC, M, X86_MNEMONIC_BSF, 0, X86_FORM_G_E, 0 },
+    { 1, 0xBD, 0xBD, M, X86_MNEMONIC_BSR, 0, X86_FORM_G_E, 0 },
+    { 1, 0xBE, 0xBE, M, X86_MNEMONIC_MOVSX, 0, X86_FORM_G_EB, 0 },
+    { 1, 0xBF, 0xBF, M, X86_MNEMONIC_MOVSX, 0, X86_FORM_G_EW, 0 },
+    { 1, 0xC0, 0xC0, M | B, X86_MNEMONIC_XADD, 0, X86_FORM_E_G, 0 },
+    { 1, 0xC1, 0xC1, M, X86_MNEMONIC_XADD, 0, X86_FORM_E_G, 0 },
+    { 1, 0xC2, 0xC2, M | X86_IMM(X86_IMM_B), X86_MNEMONIC_SIMD, 0, X86_FORM_NONE, 0 },
+    { 1, 0xC3, 0xC3, M, X86_MNEMONIC_MOVNTI, 0, X86_FORM_E_G, 0 },
+    { 1, 0xC4, 0xC6, M | X86_IMM(X86_IMM_B), X86_MNEMONIC_SIMD, 0, X86_FORM_NONE, 0 },
+    { 1, 0xC7, 0xC7, M, X86_MNEMONIC_OPCODE, 0, X86_FORM_NONE, 0 },
+    { 1, 0xC8, 0xCF, 0, X86_MNEMONIC_BSWAP, 0, X86_FORM_Z, 0 },
+    { 1, 0xD0, 0xFE, M, X86_MNEMONIC_SIMD, 0, X86_FORM_NONE, 0 },
+    { 1, 0xFF, 0xFF, M, X86_MNEMONIC_UD0, 0, X86_FORM_G_E, 0 },
+    
+    // Three-byte maps: SSSE3 and later, all with ModRM, 0F 3A with an imm8
+    { 2, 0x00, 0xFF, M, X86_MNEMONIC_SIMD, 0, X86_FORM_NONE, 0 },
+    { 3, 0x00, 0xFF, M | X86_IMM(X86_IMM_B), X86_MNEMONIC_SIMD, 0, X86_FORM_NONE, 0 },
+};
+
+#undef M
+#undef B
+#undef D64
+
+// Prefix bytes, by what they change
+enum {
+    X86_PFX_OPERAND_SIZE = 1 << 0,      // 66
+    X86_PFX_ADDRESS_SIZE = 1 << 1,      // 67
+    X86_PFX_REPNE = 1 << 2,             // F2
+    X86_PFX_REP = 1 << 3,               // F3
+    X86_PFX_LOCK = 1 << 4,              // F0
+    X86_PFX_SEGMENT = 1 << 5            // 26 2E 36 3E 64 65
+};
+
+// Extra bytes after a ModRM byte with 64-bit addressing: the displacement
+// size in the low bits, X86_MODRM_SIB when a SIB byte follows
+#define X86_MODRM_SIB 0x8
+
+static X86Opcode x86_opcodes[X86_MAP_COUNT][256];
+static uint8_t x86_prefixes[256];
+static uint8_t x86_modrm_extra[256];
+static pthread_once_t x86_tables_once = PTHREAD_ONCE_INIT;
+
+static void x86_build_opcode_table(void) {
+    for (uint32_t map = 0; map < X86_MAP_COUNT; map++) {
+        for (uint32_t op = 0; op < 256; op++) {
+            x86_opcodes[map][op].attrs = X86_ATTR_INVALID;
+        }
+    }
+    
+    // ALU rows: Eb,Gb  Ev,Gv  Gb,Eb  Gv,Ev  AL,Ib  rAX,Iz
+    for (uint32_t row = 0; row < 8; row++) {
+        static const uint16_t attrs[6] = {
+            X86_ATTR_MODRM | X86_ATTR_BYTE, X86_ATTR_MODRM,
+            X86_ATTR_MODRM | X86_ATTR_BYTE, X86_ATTR_MODRM,
+            X86_ATTR_BYTE | X86_IMM(X86_IMM_B), X86_IMM(X86_IMM_Z)
+        };
+        static const uint8_t forms[6] = {
+            X86_FORM_E_G, X86_FORM_E_G, X86_FORM_G_E, X86_FORM_G_E, X86_FORM_A_I, X86_FORM_A_I
+        };
+        for (uint32_t column = 0; column < 6; column++) {
+            X86Opcode *entry = &x86_opcodes[0][row * 8 + column];
+            entry->attrs = attrs[column];
+            entry->mnemonic = x86_groups[X86_GROUP_ALU][row];
+            entry->form = forms[column];
+        }
+    }
+    
+    size_t range_count = sizeof(x86_opcode_ranges) / sizeof(x86_opcode_ranges[0]);
+    for (size_t r = 0; r < range_count; r++) {
+        const X86OpcodeRange *range = &x86_opcode_ranges[r];
+        for (uint32_t op = range->first; op <= range->last; op++) {
+            X86Opcode *entry = &x86_opcodes[range->map][op];
+            entry->attrs = range->attrs;
+            entry->mnemonic = (uint16_t)(range->mnemonic + (op - range->first) * range->step);
+            entry->form = range->form;
+            entry->group = range->group;
+        }
+    }
+    
+    // The escapes are consumed before the table is consulted
+    x86_opcodes[0][0x0F].attrs = 0;
+    
+    static const uint8_t segment_prefixes[] = { 0x26, 0x2E, 0x36, 0x3E, 0x64, 0x65 };
+    for (size_t i = 0; i < sizeof(segment_prefixes); i++) {
+        x86_prefixes[segment_prefixes[i]] = X86_PFX_SEGMENT;
+    }
+    x86_prefixes[0x66] = X86_PFX_OPERAND_SIZE;
+    x86_prefixes[0x67] = X86_PFX_ADDRESS_SIZE;
+    x86_prefixes[0xF0] = X86_PFX_LOCK;
+    x86_prefixes[0xF2] = X86_PFX_REPNE;
+    x86_prefixes[0xF3] = X86_PFX_REP;
+    
+    for (uint32_t modrm = 0; modrm < 256; modrm++) {
+        uint8_t mod = modrm >> 6;
+        uint8_t rm = modrm & 0x7;
+        uint8_t extra = 0;
+        
+        if (mod != 3) {
+            if (rm == 4) extra |= X86_MODRM_SIB;
+            if (mod == 1) extra |= 1;
+            if (mod == 2 || (mod == 0 && rm == 5)) extra |= 4;
+        }
+        x86_modrm_extra[modrm] = extra;
+    }
+}
+
+static void x86_decode_table_init(void) {
+    pthread_once(&x86_tables_once, x86_build_opcode_table);
+}
+
+const char* x86_64_mnemonic_name(uint16_t mnemonic) {
+    return (mnemonic < X86_MNEMONIC_COUNT) ? x86_mnemonics[mnemonic] : "???";
+}
+
+#pragma mark - x86_64 Length Decoding
+
+// Where the parts of one instruction are, as found by x86_scan()
+typedef struct {
+    uint8_t length;
+    uint8_t map;
+    uint8_t opcode;
+    uint8_t rex;
+    
+    // X86_PFX_* bits, and the last of F2/F3 (0 for none), which wins as a
+    // mandatory prefix
+    uint8_t prefixes;
+    uint8_t last_rep;
+    
+    // FS or GS override: 1 + the segment register, else 0
+    uint8_t segment;
+    
+    // VEX, EVEX or XOP: decoded for length only
+    bool vex;
+    
+    bool has_modrm;
+    uint8_t modrm;
+    uint8_t sib;
+    uint8_t disp_offset;
+    uint8_t disp_size;
+    uint8_t imm_offset;
+    uint8_t imm_size;
+    
+    const X86Opcode *entry;
+} X86Scan;
+
+#define X86_REX_W 0x8
+#define X86_REX_R 0x4
+#define X86_REX_X 0x2
+#define X86_REX_B 0x1
+
+static uint8_t x86_immediate_size(uint8_t kind, const X86Scan *scan, uint16_t attrs) {
+    bool wide = (scan->rex & X86_REX_W) != 0;
+    bool narrow = (scan->prefixes & X86_PFX_OPERAND_SIZE) != 0;
+    
+    switch (kind) {
+        case X86_IMM_B: return 1;
+        case X86_IMM_W: return 2;
+        case X86_IMM_D: return 4;
+        case X86_IMM_Z: return (narrow && !wide) ? 2 : 4;
+        case X86_IMM_V: return wide ? 8 : (narrow ? 2 : 4);
+        case X86_IMM_W_B: return 3;
+        case X86_IMM_MOFFS: return (scan->prefixes & X86_PFX_ADDRESS_SIZE) ? 4 : 8;
+        case X86_IMM_GROUP3:
+            if (((scan->modrm >> 3) & 0x7) > 1) return 0;
+            return (attrs & X86_ATTR_BYTE) ? 1 : ((narrow && !wide) ? 2 : 4);
+        default: return 0;
+    }
+}
+
+// VEX (C4, C5), EVEX (62) and XOP (8F with a map of 8 or more) encodings.
+// They all have a ModRM byte but VZEROUPPER/VZEROALL; the immediate follows
+// from the map and, in map 0F, the few opcodes that take one.
+static bool x86_scan_vex(const uint8_t *bytes, size_t limit, size_t pos, uint8_t lead, X86Scan *scan) {
+    size_t payload = (lead == 0xC5) ? 1 : (lead == 0x62 ? 3 : 2);
+    if (pos + payload >= limit) return false;
+    
+    uint8_t map;
+    if (lead == 0xC5) {
+        map = 1;
+    } else if (lead == 0x62) {
+        map = bytes[pos] & 0x7;
+        if (map == 0 || map == 4 || map == 7) return false;
+    } else {
+        map = bytes[pos] & 0x1F;
+        if (lead == 0xC4 ? (map == 0 || map > 3) : (map < 8 || map > 10)) return false;
+    }
+    pos += payload;
+    
+    uint8_t opcode = bytes[pos++];
+    bool has_modrm = !(map == 1 && opcode == 0x77);
+    
+    uint8_t imm_size = 0;
+    if (map == 3 || map == 8) {
+        imm_size = 1;
+    } else if (map == 10) {
+        imm_size = 4;
+    } else if (map == 1 && ((opcode >= 0x70 && opcode <= 0x73) || (opcode >= 0xC4 && opcode <= 0xC6) || opcode == 0xC2)) {
+        imm_size = 1;
+    }
+    
+    if (has_modrm) {
+        if (pos >= limit) return false;
+        uint8_t modrm = bytes[pos++];
+        uint8_t extra = x86_modrm_extra[modrm];
+        
+        if (extra & X86_MODRM_SIB) {
+            if (pos >= limit) return false;
+            if ((modrm >> 6) == 0 && (bytes[pos] & 0x7) == 5) extra |= 4;
+            pos++;
+        }
+        pos += extra & 0x7;
+    }
+    pos += imm_size;
+    
+    if (pos > limit) return false;
+    scan->vex = true;
+    scan->length = (uint8_t)pos;
+    return true;
+}
+
+// Finds the prefixes, opcode, ModRM, SIB, displacement and immediate of the
+// instruction at bytes from the tables alone. False when the bytes do not
+// form a valid instruction within limit bytes.
+static bool x86_scan(const uint8_t *bytes, size_t available, X86Scan *scan) {
+    size_t limit = available < X86_MAX_INSTRUCTION_LENGTH ? available : X86_MAX_INSTRUCTION_LENGTH;
+    size_t pos = 0;
+    
+    scan->rex = 0;
+    scan->prefixes = 0;
+    scan->last_rep = 0;
+    scan->segment = 0;
+    scan->vex = false;
+    scan->has_modrm = false;
+    scan->modrm = 0;
+    scan->sib = 0;
+    scan->disp_size = 0;
+    scan->imm_size = 0;
+    
+    // Legacy prefixes in any order; a REX prefix only counts right before
+    // the opcode
+    while (pos < limit) {
+        uint8_t byte = bytes[pos];
+        uint8_t kind = x86_prefixes[byte];
+        
+        if (kind == 0) {
+            if ((byte & 0xF0) != 0x40) break;
+            scan->rex = byte;
+        } else {
+            scan->rex = 0;
+            scan->prefixes |= kind;
+            if (kind & (X86_PFX_REP | X86_PFX_REPNE)) scan->last_rep = byte;
+            if (byte == 0x64 || byte == 0x65) scan->segment = (uint8_t)(1 + byte - 0x60);
+        }
+        pos++;
+    }
+    if (pos >= limit) return false;
+    
+    uint8_t opcode = bytes[pos++];
+    uint8_t map = X86_MAP_ONE_BYTE;
+    
+    if (opcode == 0x0F) {
+        if (pos >= limit) return false;
+        opcode = bytes[pos++];
+        map = X86_MAP_0F;
+        
+        if (opcode == 0x38 || opcode == 0x3A) {
+            if (pos >= limit) return false;
+            map = (opcode == 0x38) ? X86_MAP_0F38 : X86_MAP_0F3A;
+            opcode = bytes[pos++];
+        }
+    } else if (opcode == 0xC4 || opcode == 0xC5 || opcode == 0x62 ||
+               (opcode == 0x8F && pos < limit && (bytes[pos] & 0x1F) >= 8)) {
+        return x86_scan_vex(bytes, limit, pos, opcode, scan);
+    }
+    
+    const X86Opcode *entry = &x86_opcodes[map][opcode];
+    uint16_t attrs = entry->attrs;
+    if (attrs & X86_ATTR_INVALID) return false;
+    
+    scan->map = map;
+    scan->opcode = opcode;
+    scan->entry = entry;
+    
+    if (attrs & X86_ATTR_MODRM) {
+        if (pos >= limit) return false;
+        uint8_t modrm = bytes[pos++];
+        scan->has_modrm = true;
+        
+        if (attrs & X86_ATTR_MODRM_REG) modrm |= 0xC0;
+        scan->modrm = modrm;
+        
+        if (entry->group && x86_groups[entry->group][(modrm >> 3) & 0x7] == X86_INVALID) return false;
+        
+        uint8_t extra = x86_modrm_extra[modrm];
+        if (extra & X86_MODRM_SIB) {
+            if (pos >= limit) return false;
+            scan->sib = bytes[pos++];
+            if ((modrm >> 6) == 0 && (scan->sib & 0x7) == 5) extra |= 4;
+        }
+        scan->disp_offset = (uint8_t)pos;
+        scan->disp_size = extra & 0x7;
+        pos += scan->disp_size;
+    }
+    
+    scan->imm_offset = (uint8_t)pos;
+    scan->imm_size = x86_immediate_size((uint8_t)(attrs >> X86_ATTR_IMM_SHIFT), scan, attrs);
+    pos += scan->imm_size;
+    
+    if (pos > limit) return false;
+    scan->length = (uint8_t)pos;
+    return true;
+}
+
+uint8_t x86_64_instruction_length(const uint8_t *bytes, size_t available) {
+    if (!bytes || available == 0) return 0;
+    x86_decode_table_init();
+    
+    X86Scan scan;
+    return x86_scan(bytes, available, &scan) ? scan.length : 1;
+}
+
+#pragma mark - x86_64 Operand Builders
+
+static int64_t x86_read_signed(const uint8_t *bytes, uint8_t size) {
+    switch (size) {
+        case 1: return (int8_t)bytes[0];
+        case 2: { int16_t value; memcpy(&value, bytes, sizeof(value)); return value; }
+        case 4: { int32_t value; memcpy(&value, bytes, sizeof(value)); return value; }
+        case 8: { int64_t value; memcpy(&value, bytes, sizeof(value)); return value; }
+        default: return 0;
+    }
+}
+
+static void x86_note_access(X86DecodedInstruction *out, uint8_t reg, uint8_t reg_class, uint8_t access) {
+    if (reg_class == X86_REG_GPR8_HIGH) {
+        reg -= 4;
+    } else if (reg_class != X86_REG_GPR || reg >= 16) {
+        return;
+    }
+    
+    uint32_t bit = 1U << reg;
+    if (access & X86_READ) out->regs_read |= bit;
+    if (access & X86_WRITE) out->regs_written |= bit;
+}
+
+static X86DecodedOperand* x86_push_operand(X86DecodedInstruction *out, uint8_t kind, uint8_t size) {
+    X86DecodedOperand *operand = &out->operands[out->operand_count++];
+    memset(operand, 0, sizeof(X86DecodedOperand));
+    operand->kind = kind;
+    operand->size = size;
+    return operand;
+}
+
+static void x86_add_reg(X86DecodedInstruction *out, uint8_t reg, uint8_t reg_class, uint8_t size, uint8_t access) {
+    X86DecodedOperand *operand = x86_push_operand(out, X86_OPND_REG, size);
+    operand->reg = reg;
+    operand->reg_class = reg_class;
+    operand->access = access;
+    x86_note_access(out, reg, reg_class, access);
+}
+
+// General purpose register of the given size; without a REX prefix, byte
+// registers 4-7 are AH, CH, DH and BH
+static void x86_add_gpr(X86DecodedInstruction *out, const X86Scan *scan, uint8_t reg, uint8_t size, uint8_t access) {
+    if (size == 1 && scan->rex == 0 && reg >= 4 && reg < 8) {
+        x86_add_reg(out, reg, X86_REG_GPR8_HIGH, 1, access);
+    } else {
+        x86_add_reg(out, reg, X86_REG_GPR, size, access);
+    }
+}
+
+// Immediates of 8 to 32-bit operations are kept as unsigned values of that
+// size; those of 64-bit operations stay sign-extended
+static void x86_add_imm(X86DecodedInstruction *out, int64_t value, uint8_t size) {
+    X86DecodedOperand *operand = x86_push_operand(out, X86_OPND_IMM, size);
+    operand->imm = (size < 8) ? (int64_t)((uint64_t)value & ((1ULL << (size * 8)) - 1)) : value;
+    operand->access = X86_READ;
+}
+
+static uint8_t x86_reg_field(const X86Scan *scan) {
+    return (uint8_t)(((scan->modrm >> 3) & 0x7) | ((scan->rex & X86_REX_R) ? 8 : 0));
+}
+
+// The ModRM r/m operand: a register of reg_class when mod is 3, otherwise
+// memory of the given size
+static void x86_add_rm(X86DecodedInstruction *out, const X86Scan *scan, const uint8_t *bytes,
+                       uint8_t size, uint8_t reg_class, uint8_t access) {
+    uint8_t mod = scan->modrm >> 6;
+    uint8_t rm = scan->modrm & 0x7;
+    
+    if (mod == 3) {
+        uint8_t reg = (uint8_t)(rm | ((scan->rex & X86_REX_B) ? 8 : 0));
+        if (reg_class == X86_REG_GPR) {
+            x86_add_gpr(out, scan, reg, size, access);
+        } else {
+            x86_add_reg(out, reg_class == X86_REG_MMX ? rm : reg, reg_class, size, access);
+        }
+        return;
+    }
+    
+    X86DecodedOperand *operand = x86_push_operand(out, X86_OPND_MEM, size);
+    operand->access = access;
+    operand->segment = scan->segment;
+    operand->reg = X86_REG_NONE;
+    operand->index = X86_REG_NONE;
+    operand->scale = 1;
+    operand->imm = x86_read_signed(bytes + scan->disp_offset, scan->disp_size);
+    
+    if (rm == 4) {
+        uint8_t base = scan->sib & 0x7;
+        uint8_t index = (uint8_t)(((scan->sib >> 3) & 0x7) | ((scan->rex & X86_REX_X) ? 8 : 0));
+        
+        if (!(mod == 0 && base == 5)) operand->reg = (uint8_t)(base | ((scan->rex & X86_REX_B) ? 8 : 0));
+        if (index != 4) {
+            operand->index = index;
+            operand->scale = (uint8_t)(1 << (scan->sib >> 6));
+        }
+    } else if (mod == 0 && rm == 5) {
+        operand->reg = X86_REG_RIP;
+        operand->imm += scan->length;
+    } else {
+        operand->reg = (uint8_t)(rm | ((scan->rex & X86_REX_B) ? 8 : 0));
+    }
+    
+    if (operand->reg < 16) x86_note_access(out, operand->reg, X86_REG_GPR, X86_READ);
+    if (operand->index != X86_REG_NONE) x86_note_access(out, operand->index, X86_REG_GPR, X86_READ);
+}
+
+static void x86_set_branch(X86DecodedInstruction *out, BranchType type) {
+    out->category = INST_CATEGORY_BRANCH;
+    out->branch_type = (uint8_t)type;
+    out->flags |= INST_FLAG_UPDATES_PC | INST_FLAG_HAS_BRANCH;
+    if (type == BRANCH_RETURN) out->flags |= INST_FLAG_FUNCTION_END;
+}
+
+// Access to the first operand; every other explicit operand is only read
+static uint8_t x86_destination_access(uint16_t mnemonic) {
+    if (mnemonic >= X86_MNEMONIC_SETO && mnemonic <= X86_MNEMONIC_SETG) return X86_WRITE;
+    if (mnemonic >= X86_MNEMONIC_MOVUPS && mnemonic <= X86_MNEMONIC_SQRTSD) return X86_WRITE;
+    if (mnemonic >= X86_MNEMONIC_CVTPS2PD && mnemonic <= X86_MNEMONIC_CVTSD2SS) return X86_WRITE;
+    if (mnemonic >= X86_MNEMONIC_CVTSI2SS && mnemonic <= X86_MNEMONIC_MOVDQU) return X86_WRITE;
+    
+    switch (mnemonic) {
+        case X86_MNEMONIC_MOV:
+        case X86_MNEMONIC_MOVSX:
+        case X86_MNEMONIC_MOVZX:
+        case X86_MNEMONIC_MOVSXD:
+        case X86_MNEMONIC_MOVNTI:
+        case X86_MNEMONIC_MOVAPS:
+        case X86_MNEMONIC_MOVAPD:
+        case X86_MNEMONIC_LEA:
+        case X86_MNEMONIC_POP:
+        case X86_MNEMONIC_BSF:
+        case X86_MNEMONIC_BSR:
+        case X86_MNEMONIC_TZCNT:
+        case X86_MNEMONIC_LZCNT:
+        case X86_MNEMONIC_POPCNT:
+        case X86_MNEMONIC_IN:
+            return X86_WRITE;
+        case X86_MNEMONIC_CMP:
+        case X86_MNEMONIC_TEST:
+        case X86_MNEMONIC_BT:
+        case X86_MNEMONIC_PUSH:
+        case X86_MNEMONIC_MUL:
+        case X86_MNEMONIC_IMUL:
+        case X86_MNEMONIC_DIV:
+        case X86_MNEMONIC_IDIV:
+        case X86_MNEMONIC_CALL:
+        case X86_MNEMONIC_CALLF:
+        case X86_MNEMONIC_JMP:
+        case X86_MNEMONIC_JMPF:
+        case X86_MNEMONIC_OUT:
+        case X86_MNEMONIC_UCOMISS:
+        case X86_MNEMONIC_UCOMISD:
+        case X86_MNEMONIC_COMISS:
+        case X86_MNEMONIC_COMISD:
+        case X86_MNEMONIC_UD0:
+        case X86_MNEMONIC_UD1:
+            return X86_READ;
+        case X86_MNEMONIC_NOP:
+        case X86_MNEMONIC_PREFETCH:
+        case X86_MNEMONIC_PREFETCHW:
+            return 0;
+        default:
+            return X86_READ | X86_WRITE;
+    }
+}
+
+// Registers used without being named: the stack pointer, the accumulator
+// and RDX of multiplies and divides, the string registers...
+static void x86_note_implicit(X86DecodedInstruction *out, bool rep) {
+    enum { RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7, R11 = 11 };
+    uint16_t mnemonic = out->mnemonic;
+    
+    switch (mnemonic) {
+        case X86_MNEMONIC_PUSH:
+        case X86_MNEMONIC_POP:
+        case X86_MNEMONIC_PUSHF:
+        case X86_MNEMONIC_POPF:
+        case X86_MNEMONIC_CALL:
+        case X86_MNEMONIC_CALLF:
+        case X86_MNEMONIC_RET:
+        case X86_MNEMONIC_RETF:
+        case X86_MNEMONIC_IRET:
+            out->regs_read |= 1U << RSP;
+            out->regs_written |= 1U << RSP;
+            break;
+        case X86_MNEMONIC_ENTER:
+        case X86_MNEMONIC_LEAVE:
+            out->regs_read |= (1U << RSP) | (1U << RBP);
+            out->regs_written |= (1U << RSP) | (1U << RBP);
+            break;
+        case X86_MNEMONIC_MUL:
+        case X86_MNEMONIC_IMUL:
+        case X86_MNEMONIC_DIV:
+        case X86_MNEMONIC_IDIV:
+            if (out->operand_count != 1) break;
+            out->regs_read |= 1U << RAX;
+            if (mnemonic == X86_MNEMONIC_DIV || mnemonic == X86_MNEMONIC_IDIV) out->regs_read |= 1U << RDX;
+            out->regs_written |= (1U << RAX) | (1U << RDX);
+            break;
+        case X86_MNEMONIC_CBW:
+        case X86_MNEMONIC_CWDE:
+        case X86_MNEMONIC_CDQE:
+            out->regs_read |= 1U << RAX;
+            out->regs_written |= 1U << RAX;
+            break;
+        case X86_MNEMONIC_CWD:
+        case X86_MNEMONIC_CDQ:
+        case X86_MNEMONIC_CQO:
+            out->regs_read |= 1U << RAX;
+            out->regs_written |= 1U << RDX;
+            break;
+        case X86_MNEMONIC_CMPXCHG:
+            out->regs_read |= 1U << RAX;
+            out->regs_written |= 1U << RAX;
+            break;
+        case X86_MNEMONIC_XLAT:
+            out->regs_read |= (1U << RAX) | (1U << RBX);
+            out->regs_written |= 1U << RAX;
+            break;
+        case X86_MNEMONIC_LOOPNE:
+        case X86_MNEMONIC_LOOPE:
+        case X86_MNEMONIC_LOOP:
+            out->regs_written |= 1U << RCX;
+            // Fall through
+        case X86_MNEMONIC_JRCXZ:
+            out->regs_read |= 1U << RCX;
+            break;
+        case X86_MNEMONIC_SYSCALL:
+            out->regs_read |= 1U << RAX;
+            out->regs_written |= (1U << RAX) | (1U << RCX) | (1U << R11);
+            break;
+        case X86_MNEMONIC_CPUID:
+            out->regs_read |= (1U << RAX) | (1U << RCX);
+            out->regs_written |= (1U << RAX) | (1U << RBX) | (1U << RCX) | (1U << RDX);
+            break;
+        case X86_MNEMONIC_RDTSC:
+            out->regs_written |= (1U << RAX) | (1U << RDX);
+            break;
+        default:
+            break;
+    }
+    
+    if (mnemonic >= X86_MNEMONIC_MOVSB && mnemonic <= X86_MNEMONIC_OUTSD) {
+        bool source = mnemonic < X86_MNEMONIC_STOSB || (mnemonic >= X86_MNEMONIC_LODSB && mnemonic <= X86_MNEMONIC_LODSQ) ||
+                      mnemonic >= X86_MNEMONIC_OUTSB;
+        bool destination = !(mnemonic >= X86_MNEMONIC_LODSB && mnemonic <= X86_MNEMONIC_LODSQ) && mnemonic < X86_MNEMONIC_OUTSB;
+        
+        if (source) {
+            out->regs_read |= 1U << RSI;
+            out->regs_written |= 1U << RSI;
+        }
+        if (destination) {
+            out->regs_read |= 1U << RDI;
+            out->regs_written |= 1U << RDI;
+        }
+        if ((mnemonic >= X86_MNEMONIC_STOSB && mnemonic <= X86_MNEMONIC_STOSQ) ||
+            (mnemonic >= X86_MNEMONIC_SCASB && mnemonic <= X86_MNEMONIC_SCASQ)) {
+            out->regs_read |= 1U << RAX;
+        }
+        if (mnemonic >= X86_MNEMONIC_LODSB && mnemonic <= X86_MNEMONIC_LODSQ) out->regs_written |= 1U << RAX;
+        if (mnemonic >= X86_MNEMONIC_INSB) out->regs_read |= 1U << RDX;
+        if (rep) {
+            out->regs_read |= 1U << RCX;
+            out->regs_written |= 1U << RCX;
+        }
+    }
+}
+
+static uint8_t x86_category(const X86DecodedInstruction *out) {
+    uint16_t mnemonic = out->mnemonic;
+    
+    if (mnemonic >= X86_MNEMONIC_MOVUPS && mnemonic <= X86_MNEMONIC_SIMD) return INST_CATEGORY_SIMD;
+    if (mnemonic >= X86_MNEMONIC_MOVSB && mnemonic <= X86_MNEMONIC_OUTSD) {
+        return mnemonic >= X86_MNEMONIC_INSB ? INST_CATEGORY_SYSTEM : INST_CATEGORY_LOAD_STORE;
+    }
+    
+    switch (mnemonic) {
+        case X86_MNEMONIC_MOV:
+        case X86_MNEMONIC_MOVSX:
+        case X86_MNEMONIC_MOVZX:
+        case X86_MNEMONIC_MOVSXD:
+        case X86_MNEMONIC_MOVNTI:
+        case X86_MNEMONIC_XCHG:
+            for (uint8_t i = 0; i < out->operand_count; i++) {
+                if (out->operands[i].kind == X86_OPND_MEM) return INST_CATEGORY_LOAD_STORE;
+            }
+            return INST_CATEGORY_DATA_PROCESSING;
+        case X86_MNEMONIC_PUSH:
+        case X86_MNEMONIC_POP:
+        case X86_MNEMONIC_PUSHF:
+        case X86_MNEMONIC_POPF:
+        case X86_MNEMONIC_PREFETCH:
+        case X86_MNEMONIC_PREFETCHW:
+            return INST_CATEGORY_LOAD_STORE;
+        case X86_MNEMONIC_NOP:
+        case X86_MNEMONIC_PAUSE:
+        case X86_MNEMONIC_ENDBR64:
+        case X86_MNEMONIC_INT3:
+        case X86_MNEMONIC_INT:
+        case X86_MNEMONIC_INT1:
+        case X86_MNEMONIC_HLT:
+        case X86_MNEMONIC_IN:
+        case X86_MNEMONIC_OUT:
+        case X86_MNEMONIC_WAIT:
+        case X86_MNEMONIC_CLI:
+        case X86_MNEMONIC_STI:
+        case X86_MNEMONIC_SYSCALL:
+        case X86_MNEMONIC_SYSRET:
+        case X86_MNEMONIC_CPUID:
+        case X86_MNEMONIC_RDTSC:
+        case X86_MNEMONIC_UD2:
+        case X86_MNEMONIC_UD1:
+        case X86_MNEMONIC_UD0:
+        case X86_MNEMONIC_OPCODE:
+            return INST_CATEGORY_SYSTEM;
+        case X86_MNEMONIC_BYTE:
+            return INST_CATEGORY_UNKNOWN;
+        default:
+            return INST_CATEGORY_DATA_PROCESSING;
+    }
+}
+
+#pragma mark - x86_64 Instruction Decoding
+
+static void x86_reset(X86DecodedInstruction *out) {
+    out->mnemonic = X86_MNEMONIC_BYTE;
+    out->length = 1;
+    out->category = INST_CATEGORY_UNKNOWN;
+    out->branch_type = BRANCH_NONE;
+    out->flags = INST_FLAG_VALID;
+    out->prefix = X86_PREFIX_NONE;
+    out->operand_count = 0;
+    out->branch_delta = 0;
+    out->regs_read = 0;
+    out->regs_written = 0;
+}
+
+// Picks the name of the 0F opcodes whose meaning depends on a mandatory
+// prefix; X86_MNEMONIC_SIMD (no operands) for the unnamed combinations
+static uint16_t x86_refine_0f(const X86Scan *scan, uint8_t variant, uint8_t *form) {
+    const X86Opcode *entry = scan->entry;
+    bool wide = (scan->rex & X86_REX_W) != 0;
+    
+    if (entry->attrs & X86_ATTR_SSE4) return (uint16_t)(entry->mnemonic + variant);
+    if (entry->attrs & X86_ATTR_SSE2) {
+        if (variant < 2) return (uint16_t)(entry->mnemonic + variant);
+        *form = X86_FORM_NONE;
+        return X86_MNEMONIC_SIMD;
+    }
+    
+    switch (scan->opcode) {
+        case 0x1E:
+            return (scan->last_rep == 0xF3 && scan->modrm == 0xFA) ? X86_MNEMONIC_ENDBR64 : entry->mnemonic;
+        case 0x2A:
+            if (variant < 2) break;
+            *form = X86_FORM_X_E;
+            return variant == 2 ? X86_MNEMONIC_CVTSI2SS : X86_MNEMONIC_CVTSI2SD;
+        case 0x2C:
+        case 0x2D:
+            if (variant < 2) break;
+            *form = X86_FORM_G_XE;
+            if (scan->opcode == 0x2C) return variant == 2 ? X86_MNEMONIC_CVTTSS2SI : X86_MNEMONIC_CVTTSD2SI;
+            return variant == 2 ? X86_MNEMONIC_CVTSS2SI : X86_MNEMONIC_CVTSD2SI;
+        case 0x6E:
+            if (variant != 1) break;
+            *form = X86_FORM_X_E;
+            return wide ? X86_MNEMONIC_MOVQ : X86_MNEMONIC_MOVD;
+        case 0x7E:
+            if (variant == 1) {
+                *form = X86_FORM_E_X;
+                return wide ? X86_MNEMONIC_MOVQ : X86_MNEMONIC_MOVD;
+            }
+            if (variant != 2) break;
+            *form = X86_FORM_X_XE;
+            return X86_MNEMONIC_MOVQ;
+        case 0x6F:
+        case 0x7F:
+            if (variant != 1 && variant != 2) break;
+            *form = (scan->opcode == 0x6F) ? X86_FORM_X_XE : X86_FORM_XE_X;
+            return variant == 1 ? X86_MNEMONIC_MOVDQA : X86_MNEMONIC_MOVDQU;
+        case 0xD6:
+            if (variant != 1) break;
+            *form = X86_FORM_XE_X;
+            return X86_MNEMONIC_MOVQ;
+        case 0xEF:
+            if (variant != 1) break;
+            *form = X86_FORM_X_XE;
+            return X86_MNEMONIC_PXOR;
+        case 0xB8:
+            if (variant == 2) return X86_MNEMONIC_POPCNT;
+            *form = X86_FORM_NONE;
+            return X86_MNEMONIC_OPCODE;
+        case 0xBC:
+            return variant == 2 ? X86_MNEMONIC_TZCNT : X86_MNEMONIC_BSF;
+        case 0xBD:
+            return variant == 2 ? X86_MNEMONIC_LZCNT : X86_MNEMONIC_BSR;
+        default:
+            return entry->mnemonic;
+    }
+    
+    *form = X86_FORM_NONE;
+    return X86_MNEMONIC_SIMD;
+}
+
+// Bytes of memory read by an SSE operand: a full register, or the scalar
+static uint8_t x86_sse_memory_size(uint16_t mnemonic) {
+    switch (mnemonic) {
+        case X86_MNEMONIC_MOVSS: case X86_MNEMONIC_SQRTSS: case X86_MNEMONIC_ADDSS: case X86_MNEMONIC_MULSS:
+        case X86_MNEMONIC_CVTSS2SD: case X86_MNEMONIC_SUBSS: case X86_MNEMONIC_MINSS: case X86_MNEMONIC_DIVSS:
+        case X86_MNEMONIC_MAXSS: case X86_MNEMONIC_UCOMISS: case X86_MNEMONIC_COMISS: case X86_MNEMONIC_CVTTSS2SI:
+        case X86_MNEMONIC_CVTSS2SI: case X86_MNEMONIC_MOVD:
+            return 4;
+        case X86_MNEMONIC_MOVSD_XMM: case X86_MNEMONIC_SQRTSD: case X86_MNEMONIC_ADDSD: case X86_MNEMONIC_MULSD:
+        case X86_MNEMONIC_CVTSD2SS: case X86_MNEMONIC_SUBSD: case X86_MNEMONIC_MINSD: case X86_MNEMONIC_DIVSD:
+        case X86_MNEMONIC_MAXSD: case X86_MNEMONIC_UCOMISD: case X86_MNEMONIC_COMISD: case X86_MNEMONIC_CVTTSD2SI:
+        case X86_MNEMONIC_CVTSD2SI: case X86_MNEMONIC_MOVQ: case X86_MNEMONIC_CVTPS2PD:
+            return 8;
+        default:
+            return 16;
+    }
+}
+
+static void x86_build_operands(X86DecodedInstruction *out, const X86Scan *scan, const uint8_t *bytes,
+                               uint8_t form, uint8_t size) {
+    uint8_t access = x86_destination_access(out->mnemonic);
+    uint8_t imm_size = scan->imm_size;
+    int64_t imm = x86_read_signed(bytes + scan->imm_offset, imm_size < 8 ? (imm_size == 3 ? 2 : imm_size) : 8);
+    uint8_t low_reg = (uint8_t)((scan->opcode & 0x7) | ((scan->rex & X86_REX_B) ? 8 : 0));
+    uint8_t xmm_size = x86_sse_memory_size(out->mnemonic);
+    uint8_t gpr_size = (scan->rex & X86_REX_W) ? 8 : 4;
+    
+    switch (form) {
+        case X86_FORM_E:
+            x86_add_rm(out, scan, bytes, out->mnemonic == X86_MNEMONIC_PREFETCH || out->mnemonic == X86_MNEMONIC_PREFETCHW ? 1 : size,
+                       X86_REG_GPR, access);
+            break;
+        case X86_FORM_E_G:
+            if (out->mnemonic == X86_MNEMONIC_XCHG || out->mnemonic == X86_MNEMONIC_XADD) {
+                x86_add_rm(out, scan, bytes, size, X86_REG_GPR, X86_READ | X86_WRITE);
+                x86_add_gpr(out, scan, x86_reg_field(scan), size, X86_READ | X86_WRITE);
+            } else {
+                x86_add_rm(out, scan, bytes, size, X86_REG_GPR, access);
+                x86_add_gpr(out, scan, x86_reg_field(scan), size, X86_READ);
+            }
+            break;
+        case X86_FORM_G_E:
+            // IMUL r, r/m also reads its destination; UD0/UD1 read both
+            if (out->mnemonic == X86_MNEMONIC_IMUL) access = X86_READ | X86_WRITE;
+            x86_add_gpr(out, scan, x86_reg_field(scan), size, access);
+            x86_add_rm(out, scan, bytes, out->mnemonic == X86_MNEMONIC_LEA ? 0 : size, X86_REG_GPR,
+                       out->mnemonic == X86_MNEMONIC_LEA ? 0 : X86_READ);
+            break;
+        case X86_FORM_E_I:
+            x86_add_rm(out, scan, bytes, size, X86_REG_GPR, access);
+            // Shift and bit-test counts are plain bytes; only group 1 (83) sign-extends its imm8
+            x86_add_imm(out, imm, (imm_size == 1 && scan->opcode != 0x83) ? 1 : size);
+            break;
+        case X86_FORM_E_1:
+            x86_add_rm(out, scan, bytes, size, X86_REG_GPR, access);
+            x86_add_imm(out, 1, 1);
+            break;
+        case X86_FORM_E_CL:
+            x86_add_rm(out, scan, bytes, size, X86_REG_GPR, access);
+            x86_add_reg(out, 1, X86_REG_GPR, 1, X86_READ);
+            break;
+        case X86_FORM_G_E_I:
+            x86_add_gpr(out, scan, x86_reg_field(scan), size, X86_WRITE);
+            x86_add_rm(out, scan, bytes, size, X86_REG_GPR, X86_READ);
+            x86_add_imm(out, imm, size);
+            break;
+        case X86_FORM_E_G_I:
+        case X86_FORM_E_G_CL:
+            x86_add_rm(out, scan, bytes, size, X86_REG_GPR, access);
+            x86_add_gpr(out, scan, x86_reg_field(scan), size, X86_READ);
+            if (form == X86_FORM_E_G_I) {
+                x86_add_imm(out, imm, 1);
             } else {
-                snprintf(inst->operands, sizeof(inst->operands), "%s, %s, %s, %s",
-                         arm64_register_name(rd, is_64bit),
-                         arm64_register_name(rn, is_64bit),
-                         arm64_register_name(rm, is_64bit),
-                         arm64_register_name(ra, is_64bit));
+                x86_add_reg(out, 1, X86_REG_GPR, 1, X86_READ);
+            }
+            break;
+        case X86_FORM_G_EB:
+        case X86_FORM_G_EW:
+        case X86_FORM_G_ED:
+            x86_add_gpr(out, scan, x86_reg_field(scan), size, access);
+            x86_add_rm(out, scan, bytes, form == X86_FORM_G_EB ? 1 : (form == X86_FORM_G_EW ? 2 : 4), X86_REG_GPR, X86_READ);
+            break;
+        case X86_FORM_A_I:
+            x86_add_reg(out, 0, X86_REG_GPR, size, access);
+            x86_add_imm(out, imm, out->mnemonic == X86_MNEMONIC_IN ? 1 : size);
+            break;
+        case X86_FORM_I_A:
+            x86_add_imm(out, imm, 1);
+            x86_add_reg(out, 0, X86_REG_GPR, size, X86_READ);
+            break;
+        case X86_FORM_A_DX:
+            x86_add_reg(out, 0, X86_REG_GPR, size, X86_WRITE);
+            x86_add_reg(out, 2, X86_REG_GPR, 2, X86_READ);
+            break;
+        case X86_FORM_DX_A:
+            x86_add_reg(out, 2, X86_REG_GPR, 2, X86_READ);
+            x86_add_reg(out, 0, X86_REG_GPR, size, X86_READ);
+            break;
+        case X86_FORM_Z:
+            x86_add_gpr(out, scan, low_reg, size, access);
+            break;
+        case X86_FORM_Z_I:
+            x86_add_gpr(out, scan, low_reg, size, X86_WRITE);
+            x86_add_imm(out, imm, size);
+            break;
+        case X86_FORM_Z_A:
+            x86_add_reg(out, low_reg, X86_REG_GPR, size, X86_READ | X86_WRITE);
+            x86_add_reg(out, 0, X86_REG_GPR, size, X86_READ | X86_WRITE);
+            break;
+        case X86_FORM_I:
+            // PUSH imm is sign-extended to the stack slot; RET and INT take it as is
+            x86_add_imm(out, imm, out->mnemonic == X86_MNEMONIC_PUSH ? size : imm_size);
+            break;
+        case X86_FORM_I_I:
+            x86_add_imm(out, imm, 2);
+            x86_add_imm(out, bytes[scan->imm_offset + 2], 1);
+            break;
+        case X86_FORM_REL: {
+            int64_t delta = imm + scan->length;
+            out->branch_delta = (int32_t)delta;
+            out->flags |= INST_FLAG_HAS_BRANCH_TARGET;
+            X86DecodedOperand *operand = x86_push_operand(out, X86_OPND_LABEL, 8);
+            operand->imm = delta;
+            break;
+        }
+        case X86_FORM_A_MOFFS:
+        case X86_FORM_MOFFS_A: {
+            if (form == X86_FORM_A_MOFFS) x86_add_reg(out, 0, X86_REG_GPR, size, X86_WRITE);
+            X86DecodedOperand *operand = x86_push_operand(out, X86_OPND_MEM, size);
+            operand->reg = X86_REG_NONE;
+            operand->index = X86_REG_NONE;
+            operand->scale = 1;
+            operand->segment = scan->segment;
+            operand->imm = imm;
+            operand->access = (form == X86_FORM_A_MOFFS) ? X86_READ : X86_WRITE;
+            if (form == X86_FORM_MOFFS_A) x86_add_reg(out, 0, X86_REG_GPR, size, X86_READ);
+            break;
+        }
+        case X86_FORM_E_SEG:
+            x86_add_rm(out, scan, bytes, 2, X86_REG_GPR, X86_WRITE);
+            x86_add_reg(out, (scan->modrm >> 3) & 0x7, X86_REG_SEGMENT, 2, X86_READ);
+            break;
+        case X86_FORM_SEG_E:
+            x86_add_reg(out, (scan->modrm >> 3) & 0x7, X86_REG_SEGMENT, 2, X86_WRITE);
+            x86_add_rm(out, scan, bytes, 2, X86_REG_GPR, X86_READ);
+            break;
+        case X86_FORM_X_XE:
+            x86_add_reg(out, x86_reg_field(scan), X86_REG_XMM, 16, access);
+            x86_add_rm(out, scan, bytes, xmm_size, X86_REG_XMM, X86_READ);
+            break;
+        case X86_FORM_XE_X:
+            x86_add_rm(out, scan, bytes, xmm_size, X86_REG_XMM, X86_WRITE);
+            x86_add_reg(out, x86_reg_field(scan), X86_REG_XMM, 16, X86_READ);
+            break;
+        case X86_FORM_X_E:
+            x86_add_reg(out, x86_reg_field(scan), X86_REG_XMM, 16, access);
+            x86_add_rm(out, scan, bytes, gpr_size, X86_REG_GPR, X86_READ);
+            break;
+        case X86_FORM_E_X:
+            x86_add_rm(out, scan, bytes, gpr_size, X86_REG_GPR, X86_WRITE);
+            x86_add_reg(out, x86_reg_field(scan), X86_REG_XMM, 16, X86_READ);
+            break;
+        case X86_FORM_G_XE:
+            x86_add_reg(out, x86_reg_field(scan), X86_REG_GPR, gpr_size, X86_WRITE);
+            x86_add_rm(out, scan, bytes, xmm_size, X86_REG_XMM, X86_READ);
+            break;
+        default:
+            break;
+    }
+}
+
+uint8_t x86_64_decode(const uint8_t *bytes, size_t available, X86DecodedInstruction *out) {
+    if (!out) return 0;
+    x86_reset(out);
+    if (!bytes || available == 0) return 0;
+    x86_decode_table_init();
+    
+    X86Scan scan;
+    if (!x86_scan(bytes, available, &scan)) return 1;
+    
+    out->length = scan.length;
+    if (scan.vex) {
+        out->mnemonic = X86_MNEMONIC_SIMD;
+        out->category = INST_CATEGORY_SIMD;
+        return out->length;
+    }
+    
+    const X86Opcode *entry = scan.entry;
+    uint16_t attrs = entry->attrs;
+    uint8_t form = entry->form;
+    uint16_t mnemonic = entry->group ? x86_groups[entry->group][(scan.modrm >> 3) & 0x7] : entry->mnemonic;
+    bool wide = (scan.rex & X86_REX_W) != 0;
+    bool narrow = (scan.prefixes & X86_PFX_OPERAND_SIZE) != 0;
+    
+    uint8_t size;
+    if (attrs & X86_ATTR_BYTE) {
+        size = 1;
+    } else if (wide) {
+        size = 8;
+    } else if (narrow) {
+        size = 2;
+    } else {
+        size = (attrs & X86_ATTR_DEFAULT64) ? 8 : 4;
+    }
+    
+    // The 0F groups (18 prefetch hints, BA bit tests) are named by ModRM alone
+    if (scan.map == X86_MAP_0F && !entry->group) {
+        uint8_t variant = scan.last_rep == 0xF3 ? 2 : (scan.last_rep == 0xF2 ? 3 : (narrow ? 1 : 0));
+        mnemonic = x86_refine_0f(&scan, variant, &form);
+    } else if (scan.map == X86_MAP_ONE_BYTE) {
+        switch (scan.opcode) {
+            case 0x90:
+                if (scan.rex & X86_REX_B) {
+                    mnemonic = X86_MNEMONIC_XCHG;
+                    form = X86_FORM_Z_A;
+                } else if (scan.last_rep == 0xF3) {
+                    mnemonic = X86_MNEMONIC_PAUSE;
+                }
+                break;
+            case 0x98:
+            case 0x99:
+                mnemonic = (uint16_t)(mnemonic + (size == 2 ? 0 : (size == 4 ? 1 : 2)));
+                break;
+            case 0xFF:
+                // Near branches through memory are always 64-bit, far ones
+                // take a selector and an offset
+                if (mnemonic == X86_MNEMONIC_CALL || mnemonic == X86_MNEMONIC_JMP) {
+                    size = 8;
+                } else if (mnemonic == X86_MNEMONIC_PUSH) {
+                    size = narrow ? 2 : 8;
+                } else if (mnemonic == X86_MNEMONIC_CALLF || mnemonic == X86_MNEMONIC_JMPF) {
+                    size = wide ? 10 : 6;
+                }
+                break;
+            case 0xC6:
+            case 0xC7:
+                if (mnemonic == X86_MNEMONIC_OPCODE) form = X86_FORM_NONE;
+                break;
+            default:
+                if (mnemonic >= X86_MNEMONIC_MOVSB && mnemonic <= X86_MNEMONIC_OUTSD) {
+                    uint8_t step = (size == 1) ? 0 : (size == 2 ? 1 : (size == 4 ? 2 : 3));
+                    if (mnemonic >= X86_MNEMONIC_INSB && step > 2) step = 2;
+                    mnemonic = (uint16_t)(mnemonic + step);
+                }
+                break;
+        }
+    }
+    
+    out->mnemonic = mnemonic;
+    x86_build_operands(out, &scan, bytes, form, size);
+    
+    // Displayed prefixes: LOCK on anything, REP only on string instructions
+    bool is_string = mnemonic >= X86_MNEMONIC_MOVSB && mnemonic <= X86_MNEMONIC_OUTSD;
+    if (scan.prefixes & X86_PFX_LOCK) {
+        out->prefix = X86_PREFIX_LOCK;
+    } else if (is_string && scan.last_rep) {
+        bool compares = (mnemonic >= X86_MNEMONIC_CMPSB && mnemonic <= X86_MNEMONIC_CMPSQ) ||
+                        (mnemonic >= X86_MNEMONIC_SCASB && mnemonic <= X86_MNEMONIC_SCASQ);
+        if (scan.last_rep == 0xF2) {
+            out->prefix = X86_PREFIX_REPNE;
+        } else {
+            out->prefix = compares ? X86_PREFIX_REPE : X86_PREFIX_REP;
+        }
+    }
+    
+    if ((mnemonic >= X86_MNEMONIC_JO && mnemonic <= X86_MNEMONIC_JG) ||
+        (mnemonic >= X86_MNEMONIC_LOOPNE && mnemonic <= X86_MNEMONIC_JRCXZ)) {
+        x86_set_branch(out, BRANCH_CONDITIONAL);
+    } else if (mnemonic == X86_MNEMONIC_JMP || mnemonic == X86_MNEMONIC_JMPF) {
+        x86_set_branch(out, BRANCH_UNCONDITIONAL);
+    } else if (mnemonic == X86_MNEMONIC_CALL || mnemonic == X86_MNEMONIC_CALLF) {
+        x86_set_branch(out, BRANCH_CALL);
+    } else if (mnemonic == X86_MNEMONIC_RET || mnemonic == X86_MNEMONIC_RETF || mnemonic == X86_MNEMONIC_IRET) {
+        x86_set_branch(out, BRANCH_RETURN);
+    } else {
+        out->category = x86_category(out);
+    }
+    
+    x86_note_implicit(out, out->prefix >= X86_PREFIX_REP);
+    return out->length;
+}
+
+#pragma mark - x86_64 Rendering
+
+static const char *const x86_gpr_names[4][16] = {
+    { "al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+      "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b" },
+    { "ax", "cx", "dx", "bx", "sp", "bp", "si", "di",
+      "r8w", "r9w", "r10w", "r11w", "r12w", "r13w", "r14w", "r15w" },
+    { "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+      "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d" },
+    { "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+      "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15" }
+};
+
+static const char *const x86_prefix_names[X86_PREFIX_COUNT] = { "", "LOCK ", "REP ", "REPE ", "REPNE " };
+
+static void x86_append_register(ARM64TextBuffer *text, uint8_t reg, uint8_t reg_class, uint8_t size) {
+    static const char *const high_byte_names[] = { "ah", "ch", "dh", "bh" };
+    static const char *const segment_names[] = { "es", "cs", "ss", "ds", "fs", "gs", "?", "?" };
+    const char *name = "?";
+    
+    switch (reg_class) {
+        case X86_REG_GPR:
+            if (reg == X86_REG_RIP) {
+                name = "rip";
+            } else if (reg < 16) {
+                name = x86_gpr_names[size >= 8 ? 3 : (size >= 4 ? 2 : (size == 2 ? 1 : 0))][reg];
             }
-            inst->category = INST_CATEGORY_DATA_PROCESSING;
-            inst->is_valid = true;
+            break;
+        case X86_REG_GPR8_HIGH:
+            if (reg >= 4 && reg < 8) name = high_byte_names[reg - 4];
+            break;
+        case X86_REG_SEGMENT:
+            name = segment_names[reg & 0x7];
+            break;
+        case X86_REG_XMM:
+            arm64_append(text, "xmm%u", reg);
+            return;
+        case X86_REG_MMX:
+            arm64_append(text, "mm%u", reg);
+            return;
+        default:
+            break;
+    }
+    arm64_append_string(text, name, strlen(name));
+}
+
+static void x86_append_hex(ARM64TextBuffer *text, int64_t value) {
+    if (value < 0 && value > -0x100000000LL) {
+        arm64_append(text, "-0x%llx", (unsigned long long)-value);
+    } else {
+        arm64_append(text, "0x%llx", (unsigned long long)value);
+    }
+}
+
+static void x86_append_mem(ARM64TextBuffer *text, const X86DecodedInstruction *decoded, const X86DecodedOperand *operand) {
+    static const char *const size_names[17] = {
+        [1] = "byte ptr ", [2] = "word ptr ", [4] = "dword ptr ", [6] = "fword ptr ",
+        [8] = "qword ptr ", [10] = "tbyte ptr ", [16] = "xmmword ptr "
+    };
+    static const char *const segment_prefixes[] = { "", "es:", "cs:", "ss:", "ds:", "fs:", "gs:" };
+    
+    if (operand->size <= 16 && size_names[operand->size]) {
+        arm64_append_string(text, size_names[operand->size], strlen(size_names[operand->size]));
+    }
+    if (operand->segment && operand->segment < sizeof(segment_prefixes) / sizeof(segment_prefixes[0])) {
+        arm64_append_string(text, segment_prefixes[operand->segment], 3);
+    }
+    
+    int64_t displacement = operand->imm;
+    arm64_append_string(text, "[", 1);
+    
+    if (operand->reg == X86_REG_RIP) {
+        arm64_append_string(text, "rip", 3);
+        displacement -= decoded->length;
+    } else if (operand->reg != X86_REG_NONE) {
+        x86_append_register(text, operand->reg, X86_REG_GPR, 8);
+    }
+    
+    if (operand->index != X86_REG_NONE) {
+        if (operand->reg != X86_REG_NONE) arm64_append_string(text, "+", 1);
+        x86_append_register(text, operand->index, X86_REG_GPR, 8);
+        arm64_append(text, "*%u", operand->scale);
+    }
+    
+    if (operand->reg == X86_REG_NONE && operand->index == X86_REG_NONE) {
+        arm64_append(text, "0x%llx", (unsigned long long)displacement);
+    } else if (displacement > 0) {
+        arm64_append(text, "+0x%llx", (unsigned long long)displacement);
+    } else if (displacement < 0) {
+        arm64_append(text, "-0x%llx", (unsigned long long)-displacement);
+    }
+    
+    arm64_append_string(text, "]", 1);
+}
+
+static void x86_append_operand(ARM64TextBuffer *text, const X86DecodedInstruction *decoded,
+                               const X86DecodedOperand *operand, uint64_t address) {
+    switch (operand->kind) {
+        case X86_OPND_REG:
+            x86_append_register(text, operand->reg, operand->reg_class, operand->size);
+            break;
+        case X86_OPND_IMM:
+            x86_append_hex(text, operand->imm);
+            break;
+        case X86_OPND_MEM:
+            x86_append_mem(text, decoded, operand);
+            break;
+        case X86_OPND_LABEL:
+            arm64_append(text, "0x%llx", (unsigned long long)(address + (uint64_t)operand->imm));
+            break;
+        default:
+            break;
+    }
+}
+
+size_t x86_64_format_mnemonic(const X86DecodedInstruction *decoded, char *buffer, size_t buffer_size) {
+    if (!decoded || !buffer || buffer_size == 0) return 0;
+    
+    const char *prefix = x86_prefix_names[decoded->prefix < X86_PREFIX_COUNT ? decoded->prefix : 0];
+    int written = snprintf(buffer, buffer_size, "%s%s", prefix, x86_64_mnemonic_name(decoded->mnemonic));
+    if (written < 0) return 0;
+    return (size_t)written < buffer_size ? (size_t)written : buffer_size - 1;
+}
+
+size_t x86_64_format_operands(const X86DecodedInstruction *decoded, uint64_t address, char *buffer, size_t buffer_size) {
+    if (!decoded || !buffer || buffer_size == 0) return 0;
+    
+    ARM64TextBuffer text = { buffer, buffer_size, 0 };
+    buffer[0] = '\0';
+    for (uint8_t i = 0; i < decoded->operand_count; i++) {
+        if (i > 0) arm64_append_string(&text, ", ", 2);
+        x86_append_operand(&text, decoded, &decoded->operands[i], address);
+    }
+    return text.length;
+}
+
+// Instructions without decoded operands (.byte, SIMD, x87 and the unnamed
+// ones) show their bytes instead. RIP-relative addresses go in the comment.
+static void x86_render(const X86DecodedInstruction *decoded, const uint8_t *bytes, uint64_t address, DisassembledInstruction *inst) {
+    memset(inst, 0, sizeof(DisassembledInstruction));
+    inst->address = address;
+    inst->length = decoded->length;
+    
+    inst->category = (InstructionCategory)decoded->category;
+    inst->branch_type = (BranchType)decoded->branch_type;
+    inst->regs_read = decoded->regs_read;
+    inst->regs_written = decoded->regs_written;
+    inst->is_valid = (decoded->flags & INST_FLAG_VALID) != 0;
+    inst->is_function_start = (decoded->flags & INST_FLAG_FUNCTION_START) != 0;
+    inst->is_function_end = (decoded->flags & INST_FLAG_FUNCTION_END) != 0;
+    inst->updates_pc = (decoded->flags & INST_FLAG_UPDATES_PC) != 0;
+    inst->has_branch = (decoded->flags & INST_FLAG_HAS_BRANCH) != 0;
+    
+    if (decoded->flags & INST_FLAG_HAS_BRANCH_TARGET) {
+        inst->has_branch_target = true;
+        inst->branch_offset = decoded->branch_delta;
+        inst->branch_target = address + (int64_t)decoded->branch_delta;
+    }
+    
+    x86_64_format_mnemonic(decoded, inst->mnemonic, sizeof(inst->mnemonic));
+    
+    if (decoded->operand_count == 0 && decoded->mnemonic >= X86_MNEMONIC_FPU) {
+        ARM64TextBuffer text = { inst->operands, sizeof(inst->operands), 0 };
+        for (uint8_t i = 0; i < decoded->length; i++) {
+            arm64_append(&text, i ? " 0x%02X" : "0x%02X", bytes[i]);
+        }
+    } else {
+        x86_64_format_operands(decoded, address, inst->operands, sizeof(inst->operands));
+    }
+    
+    for (uint8_t i = 0; i < decoded->operand_count; i++) {
+        const X86DecodedOperand *operand = &decoded->operands[i];
+        if (operand->kind == X86_OPND_MEM && operand->reg == X86_REG_RIP) {
+            snprintf(inst->comment, sizeof(inst->comment), "0x%llx", address + (uint64_t)operand->imm);
+            break;
+        }
+    }
+    
+    snprintf(inst->full_disasm, sizeof(inst->full_disasm), "0x%llx: %s %s",
+             inst->address, inst->mnemonic, inst->operands);
+}
+
+static bool disasm_x86_64_available(const uint8_t *bytes, size_t available, uint64_t address, DisassembledInstruction *inst) {
+    X86DecodedInstruction decoded;
+    x86_64_decode(bytes, available, &decoded);
+    x86_render(&decoded, bytes, address, inst);
+    return inst->is_valid;
+}
+
+bool disasm_x86_64(const uint8_t *bytes, uint64_t address, DisassembledInstruction *inst) {
+    return disasm_x86_64_available(bytes, X86_MAX_INSTRUCTION_LENGTH, address, inst);
+}
+
+#pragma mark - High-Level Disassembly
+
+bool disasm_instruction(DisassemblyContext *ctx, DisassembledInstruction *inst) {
+    if (!ctx || !ctx->code_data || ctx->current_offset >= ctx->code_size) return false;
+    
+    uint64_t addr = ctx->code_base_addr + ctx->current_offset;
+    
+    if (ctx->arch == ARCH_ARM64) {
+        if (ctx->current_offset + 4 > ctx->code_size) return false;
+        uint32_t bytes = *(uint32_t*)(ctx->code_data + ctx->current_offset);
+        
+        if (ctx->macho_ctx && ctx->macho_ctx->header.is_swapped) {
+            bytes = swap_uint32(bytes);
+        }
+        
+        ctx->current_offset += 4;
+        return disasm_arm64(bytes, addr, inst);
+    } else if (ctx->arch == ARCH_X86_64) {
+        bool result = disasm_x86_64_available(ctx->code_data + ctx->current_offset,
+                                              (size_t)(ctx->code_size - ctx->current_offset), addr, inst);
+        ctx->current_offset += inst->length;
+        return result;
+    }
+    
+    return false;
+}
+
+static bool store_append_arm64(DisassemblyContext *ctx, uint64_t start_offset, uint64_t end_offset);
+static bool store_append_x86_64(DisassemblyContext *ctx, uint64_t start_offset, uint64_t end_offset, uint64_t limit_offset);
+static void store_mark_stubs(DisassemblyContext *ctx);
+
+static uint32_t code_range_count(const DisassemblyContext *ctx) {
+    return ctx->section_count ? ctx->section_count : 1;
+}
+
+// Range i of the code, clipped to [start_offset, end_offset): a loaded section,
+// or all of code_data for a context set up by hand. out_limit is the unclipped
+// end, which an x86_64 instruction started in the range may run up to. False
+// when nothing is left.
+static bool code_range(const DisassemblyContext *ctx, uint32_t i, uint64_t start_offset, uint64_t end_offset,
+                       uint64_t *out_start, uint64_t *out_end, uint64_t *out_limit) {
+    uint64_t start = ctx->section_count ? ctx->sections[i].offset : 0;
+    uint64_t limit = ctx->section_count ? start + ctx->sections[i].size : ctx->code_size;
+    if (limit > ctx->code_size) limit = ctx->code_size;
+    
+    uint64_t end = limit;
+    if (start < start_offset) start = start_offset;
+    if (end > end_offset) end = end_offset;
+    
+    *out_start = start;
+    *out_end = end;
+    *out_limit = limit;
+    return start < end;
+}
+
+// Both decoders write straight into the columns: no text is rendered, and
+// undecodable words or bytes are kept as .word/.byte rows
+static uint32_t sweep_ranges(DisassemblyContext *ctx, uint64_t start_offset, uint64_t end_offset) {
+    disasm_store_clear(ctx);
+    if (ctx->arch != ARCH_ARM64 && ctx->arch != ARCH_X86_64) return 0;
+    
+    for (uint32_t r = 0; r < code_range_count(ctx); r++) {
+        uint64_t range_start, range_end, range_limit;
+        if (!code_range(ctx, r, start_offset, end_offset, &range_start, &range_end, &range_limit)) continue;
+        
+        bool ok = (ctx->arch == ARCH_ARM64) ? store_append_arm64(ctx, range_start, range_end)
+                                            : store_append_x86_64(ctx, range_start, range_end, range_limit);
+        if (!ok) {
+            disasm_store_clear(ctx);
+            return 0;
+        }
+    }
+    
+    store_mark_stubs(ctx);
+    return ctx->instruction_count;
+}
+
+uint32_t disasm_range(DisassemblyContext *ctx, uint64_t start_addr, uint64_t end_addr) {
+    if (!ctx || start_addr >= end_addr) return 0;
+    
+    uint64_t start_offset = start_addr - ctx->code_base_addr;
+    uint64_t end_offset = end_addr - ctx->code_base_addr;
+    
+    if (start_offset >= ctx->code_size) return 0;
+    if (end_offset > ctx->code_size) end_offset = ctx->code_size;
+    
+    return sweep_ranges(ctx, start_offset, end_offset);
+}
+
+uint32_t disasm_all(DisassemblyContext *ctx) {
+    if (!ctx || !ctx->code_data) return 0;
+    
+    // Fixed-width code is split across threads past the threshold
+    if (ctx->arch == ARCH_ARM64) {
+        return disasm_all_parallel(ctx, ctx->code_size >= DISASM_PARALLEL_THRESHOLD ? 0 : 1);
+    }
+    
+    return sweep_ranges(ctx, 0, ctx->code_size);
+}
+
+uint32_t disasm_detect_functions(DisassemblyContext *ctx) {
+    if (!ctx || !ctx->store.flags) return 0;
+    
+    uint32_t func_count = 0;
+    for (uint32_t i = 0; i < ctx->instruction_count; i++) {
+        if (ctx->store.flags[i] & INST_FLAG_FUNCTION_START) {
+            func_count++;
         }
     }
     
-    else if (((bytes >> 24) & 0xFF) == 0xF1 || ((bytes >> 24) & 0xFF) == 0x71 ||
-             ((bytes >> 24) & 0xFF) == 0xEB || ((bytes >> 24) & 0xFF) == 0x6B) {
-        bool is_64bit = ((bytes >> 31) & 0x1) == 1;
-        uint8_t rn = (bytes >> 5) & 0x1F;
-        
-        if (((bytes >> 24) & 0xFF) == 0xF1 || ((bytes >> 24) & 0xFF) == 0x71) {
-            bool is_sub = ((bytes >> 30) & 0x1) == 1;
-            uint16_t imm12 = (bytes >> 10) & 0xFFF;
-            
-            strcpy(inst->mnemonic, is_sub ? "CMP" : "CMN");
-            snprintf(inst->operands, sizeof(inst->operands), "%s, #%u",
-                     arm64_register_name(rn, is_64bit), imm12);
-            inst->category = INST_CATEGORY_DATA_PROCESSING;
-            inst->is_valid = true;
-        }
-        
-        else if (((bytes >> 24) & 0xFF) == 0xEB || ((bytes >> 24) & 0xFF) == 0x6B) {
-            bool is_sub = ((bytes >> 30) & 0x1) == 1;
-            uint8_t rm = (bytes >> 16) & 0x1F;
-            
-            strcpy(inst->mnemonic, is_sub ? "CMP" : "CMN");
-            snprintf(inst->operands, sizeof(inst->operands), "%s, %s",
-                     arm64_register_name(rn, is_64bit),
-                     arm64_register_name(rm, is_64bit));
-            inst->category = INST_CATEGORY_DATA_PROCESSING;
-            inst->is_valid = true;
+    return func_count;
+}
+
+uint32_t disasm_index_at_or_after(const DisassemblyContext *ctx, uint64_t address) {
+    if (!ctx || ctx->instruction_count == 0 || address <= ctx->code_base_addr) return 0;
+    
+    const InstructionStore *store = &ctx->store;
+    uint64_t offset = address - ctx->code_base_addr;
+    
+    // Contiguous fixed-width rows: the row follows from the offset
+    if (!store->offsets) {
+        if (offset <= store->first_offset) return 0;
+        uint64_t index = (offset - store->first_offset + 3) / 4;
+        return index < ctx->instruction_count ? (uint32_t)index : ctx->instruction_count;
+    }
+    
+    // Otherwise the offsets column is sorted, as rows are only appended in order
+    if (offset > UINT32_MAX) return ctx->instruction_count;
+    
+    uint32_t low = 0;
+    uint32_t high = ctx->instruction_count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (store->offsets[mid] < offset) {
+            low = mid + 1;
+        } else {
+            high = mid;
         }
     }
     
-    else if (((bytes >> 21) & 0x7FF) >= 0x69A && ((bytes >> 21) & 0x7FF) <= 0x69F) {
-        bool is_64bit = ((bytes >> 31) & 0x1) == 1;
-        uint8_t rd = bytes & 0x1F;
-        uint8_t rn = (bytes >> 5) & 0x1F;
-        uint8_t rm = (bytes >> 16) & 0x1F;
-        uint8_t shift_type = (bytes >> 22) & 0x3;
-        
-        if (shift_type == 0x0) strcpy(inst->mnemonic, "LSL");
-        else if (shift_type == 0x1) strcpy(inst->mnemonic, "LSR");
-        else if (shift_type == 0x2) strcpy(inst->mnemonic, "ASR");
-        else strcpy(inst->mnemonic, "ROR");
-        
-        snprintf(inst->operands, sizeof(inst->operands), "%s, %s, %s",
-                 arm64_register_name(rd, is_64bit),
-                 arm64_register_name(rn, is_64bit),
-                 arm64_register_name(rm, is_64bit));
-        inst->category = INST_CATEGORY_DATA_PROCESSING;
-        inst->is_valid = true;
-    }
-    
-    else if (((bytes >> 21) & 0x7FF) >= 0x3A2 && ((bytes >> 21) & 0x7FF) <= 0x3A3) {
-        bool is_64bit = ((bytes >> 31) & 0x1) == 1;
-        uint8_t rn = (bytes >> 5) & 0x1F;
-        uint8_t rm = (bytes >> 16) & 0x1F;
-        uint8_t nzcv = bytes & 0xF;
-        uint8_t cond = (bytes >> 12) & 0xF;
-        
-        strcpy(inst->mnemonic, "CCMP");
-        snprintf(inst->operands, sizeof(inst->operands), "%s, %s, #%u, %s",
-                 arm64_register_name(rn, is_64bit),
-                 arm64_register_name(rm, is_64bit),
-                 nzcv,
-                 arm64_condition_string(cond));
-        inst->category = INST_CATEGORY_DATA_PROCESSING;
-        inst->is_valid = true;
-    }
-    
-    else if (bytes == 0xD503201F) {
-        strcpy(inst->mnemonic, "NOP");
-        inst->operands[0] = '\0';
-        inst->category = INST_CATEGORY_SYSTEM;
-        inst->is_valid = true;
-    }
-    else if ((bytes >> 12) == 0xD503301) {
-        uint8_t crm = (bytes >> 8) & 0xF;
-        uint8_t op2 = (bytes >> 5) & 0x7;
-        
-        if (crm == 0x0 && op2 == 0x1) strcpy(inst->mnemonic, "YIELD");
-        else if (crm == 0x0 && op2 == 0x2) strcpy(inst->mnemonic, "WFE");
-        else if (crm == 0x0 && op2 == 0x3) strcpy(inst->mnemonic, "WFI");
-        else if (crm == 0x0 && op2 == 0x4) strcpy(inst->mnemonic, "SEV");
-        else if (crm == 0x0 && op2 == 0x5) strcpy(inst->mnemonic, "SEVL");
-        else strcpy(inst->mnemonic, "HINT");
-        
-        inst->operands[0] = '\0';
-        inst->category = INST_CATEGORY_SYSTEM;
-        inst->is_valid = true;
+    return low;
+}
+
+int32_t disasm_find_by_address(const DisassemblyContext *ctx, uint64_t address) {
+    if (!ctx || ctx->instruction_count == 0) return -1;
+    
+    uint32_t index = disasm_index_at_or_after(ctx, address);
+    if (index < ctx->instruction_count && disasm_address_at(ctx, index) == address) {
+        return (int32_t)index;
     }
     
-    else if ((bytes >> 12) == 0xD503309) {
-        uint8_t crm = (bytes >> 8) & 0xF;
-        uint8_t op2 = (bytes >> 5) & 0x7;
-        
-        if (op2 == 0x4) strcpy(inst->mnemonic, "DSB");
-        else if (op2 == 0x5) strcpy(inst->mnemonic, "DMB");
-        else if (op2 == 0x6) strcpy(inst->mnemonic, "ISB");
-        else strcpy(inst->mnemonic, "BARRIER");
-        
-        snprintf(inst->operands, sizeof(inst->operands), "#%u", crm);
-        inst->category = INST_CATEGORY_SYSTEM;
-        inst->is_valid = true;
+    return -1;
+}
+
+#pragma mark - Instruction Store
+
+static uint32_t mnemonic_hash(const char *mnemonic) {
+    uint32_t hash = 2166136261u;
+    for (const char *p = mnemonic; *p; p++) {
+        hash = (hash ^ (uint8_t)*p) * 16777619u;
     }
+    return hash;
+}
+
+static bool mnemonic_table_grow(MnemonicTable *table) {
+    uint32_t slot_count = table->slot_count ? table->slot_count * 2 : 256;
+    uint16_t *slots = (uint16_t*)malloc(slot_count * sizeof(uint16_t));
+    if (!slots) return false;
+    memset(slots, 0xFF, slot_count * sizeof(uint16_t));
     
-    if (!inst->is_valid) {
-        uint8_t op0 = (bytes >> 25) & 0xF;
-        
-        if ((op0 & 0xB) == 0x8 || (op0 & 0xB) == 0x9) {
-            bool is_load = ((bytes >> 22) & 0x1) == 1;
-            uint8_t rt = bytes & 0x1F;
-            uint8_t rn = (bytes >> 5) & 0x1F;
-            uint8_t size = (bytes >> 30) & 0x3;
-            bool is_64bit = (size >= 0x2);
-            
-            strcpy(inst->mnemonic, is_load ? "LDR" : "STR");
-            snprintf(inst->operands, sizeof(inst->operands), "%s, [%s, ...]",
-                     arm64_register_name(rt, is_64bit),
-                     arm64_register_name(rn, true));
-            inst->category = INST_CATEGORY_LOAD_STORE;
-            inst->is_valid = true;
-        }
-        
-        else if (op0 == 0xB) {
-            uint8_t rd = bytes & 0x1F;
-            uint8_t rn = (bytes >> 5) & 0x1F;
-            uint8_t rm = (bytes >> 16) & 0x1F;
-            bool is_64bit = ((bytes >> 31) & 0x1) == 1;
-            
-            strcpy(inst->mnemonic, "DP3SRC");
-            snprintf(inst->operands, sizeof(inst->operands), "%s, %s, %s, ...",
-                     arm64_register_name(rd, is_64bit),
-                     arm64_register_name(rn, is_64bit),
-                     arm64_register_name(rm, is_64bit));
-            inst->category = INST_CATEGORY_DATA_PROCESSING;
-            inst->is_valid = true;
-        }
-        
-        else if ((op0 & 0x7) == 0x7 || (op0 & 0xE) == 0xE) {
-            strcpy(inst->mnemonic, "SIMD");
-            snprintf(inst->operands, sizeof(inst->operands), "...");
-            inst->category = INST_CATEGORY_SIMD;
-            inst->is_valid = true;
-        }
-        
-        else if ((op0 & 0xE) == 0xA) {
-            uint8_t rd = bytes & 0x1F;
-            uint8_t rn = (bytes >> 5) & 0x1F;
-            bool is_64bit = ((bytes >> 31) & 0x1) == 1;
-            
-            strcpy(inst->mnemonic, "DPREG");
-            snprintf(inst->operands, sizeof(inst->operands), "%s, %s, ...",
-                     arm64_register_name(rd, is_64bit),
-                     arm64_register_name(rn, is_64bit));
-            inst->category = INST_CATEGORY_DATA_PROCESSING;
-            inst->is_valid = true;
-        }
-        
-        else if (op0 == 0xD) {
-            strcpy(inst->mnemonic, "SYS");
-            snprintf(inst->operands, sizeof(inst->operands), "...");
-            inst->category = INST_CATEGORY_SYSTEM;
-            inst->is_valid = true;
-        }
+    for (uint32_t id = 0; id < table->count; id++) {
+        uint32_t slot = mnemonic_hash(table->names[id]) & (slot_count - 1);
+        while (slots[slot] != UINT16_MAX) slot = (slot + 1) & (slot_count - 1);
+        slots[slot] = (uint16_t)id;
     }
     
-    if (!inst->is_valid) {
-        strcpy(inst->mnemonic, ".word");
-        snprintf(inst->operands, sizeof(inst->operands), "0x%08X", bytes);
-        inst->category = INST_CATEGORY_UNKNOWN;
-        inst->is_valid = true;
+    free(table->slots);
+    table->slots = slots;
+    table->slot_count = slot_count;
+    return true;
+}
+
+// Ids are handed out in first-seen order. Decoders produce a small fixed
+// vocabulary, so they stay well below UINT16_MAX.
+static bool mnemonic_table_intern(MnemonicTable *table, const char *mnemonic, uint16_t *out_id) {
+    if ((table->count + 1) * 2 > table->slot_count && !mnemonic_table_grow(table)) {
+        return false;
     }
     
-    snprintf(inst->full_disasm, sizeof(inst->full_disasm), "0x%llx: %s %s",
-             inst->address, inst->mnemonic, inst->operands);
+    uint32_t mask = table->slot_count - 1;
+    uint32_t slot = mnemonic_hash(mnemonic) & mask;
+    while (table->slots[slot] != UINT16_MAX) {
+        uint16_t id = table->slots[slot];
+        if (strcmp(table->names[id], mnemonic) == 0) {
+            *out_id = id;
+            return true;
+        }
+        slot = (slot + 1) & mask;
+    }
     
-    inst->is_function_start = arm64_is_prologue(inst);
-    inst->is_function_end = arm64_is_epilogue(inst);
+    if (table->count >= UINT16_MAX) return false;
     
-    return inst->is_valid;
+    if (table->count >= table->capacity) {
+        uint32_t capacity = table->capacity ? table->capacity * 2 : 64;
+        char (*grown)[32] = realloc(table->names, capacity * sizeof(*grown));
+        if (!grown) return false;
+        table->names = grown;
+        table->capacity = capacity;
+    }
+    
+    uint16_t id = (uint16_t)table->count++;
+    snprintf(table->names[id], sizeof(table->names[id]), "%s", mnemonic);
+    table->slots[slot] = id;
+    *out_id = id;
+    return true;
 }
 
-#pragma mark - x86_64 Disassembly
-
-typedef struct {
-    uint8_t mod;
-    uint8_t reg;
-    uint8_t rm;
-} ModRM;
+static void mnemonic_table_free(MnemonicTable *table) {
+    free(table->names);
+    free(table->slots);
+    memset(table, 0, sizeof(MnemonicTable));
+}
 
-static ModRM decode_modrm(uint8_t byte) {
-    ModRM modrm;
-    modrm.mod = (byte >> 6) & 0x3;
-    modrm.reg = (byte >> 3) & 0x7;
-    modrm.rm = byte & 0x7;
-    return modrm;
+static bool grow_column(void **column, uint32_t capacity, size_t item_size) {
+    void *grown = realloc(*column, capacity * item_size);
+    if (!grown) return false;
+    *column = grown;
+    return true;
 }
 
-typedef struct {
-    uint8_t scale;
-    uint8_t index;
-    uint8_t base;
-} SIB;
+static void store_set_row(InstructionStore *store, uint32_t i, const DisassembledInstruction *inst, uint16_t opcode) {
+    int64_t delta = (int64_t)(inst->branch_target - inst->address);
+    bool has_target = inst->has_branch_target && delta >= INT32_MIN && delta <= INT32_MAX;
+    
+    store->raw_words[i] = inst->raw_bytes;
+    store->opcodes[i] = opcode;
+    store->categories[i] = (uint8_t)inst->category;
+    store->branch_types[i] = (uint8_t)inst->branch_type;
+    store->branch_deltas[i] = has_target ? (int32_t)delta : 0;
+    store->regs_read[i] = inst->regs_read;
+    store->regs_written[i] = inst->regs_written;
+    store->flags[i] = (inst->is_valid ? INST_FLAG_VALID : 0) |
+                      (has_target ? INST_FLAG_HAS_BRANCH_TARGET : 0) |
+                      (inst->is_function_start ? INST_FLAG_FUNCTION_START : 0) |
+                      (inst->is_function_end ? INST_FLAG_FUNCTION_END : 0) |
+                      (inst->updates_pc ? INST_FLAG_UPDATES_PC : 0) |
+                      (inst->has_branch ? INST_FLAG_HAS_BRANCH : 0);
+}
 
-static SIB decode_sib(uint8_t byte) {
-    SIB sib;
-    sib.scale = (byte >> 6) & 0x3;
-    sib.index = (byte >> 3) & 0x7;
-    sib.base = byte & 0x7;
-    return sib;
+static void store_set_decoded(InstructionStore *store, uint32_t i, uint32_t bytes, const ARM64DecodedWord *decoded, uint16_t opcode) {
+    store->raw_words[i] = bytes;
+    store->opcodes[i] = opcode;
+    store->categories[i] = decoded->category;
+    store->branch_types[i] = decoded->branch_type;
+    store->branch_deltas[i] = (decoded->flags & INST_FLAG_HAS_BRANCH_TARGET) ? decoded->branch_delta : 0;
+    store->regs_read[i] = decoded->regs_read;
+    store->regs_written[i] = decoded->regs_written;
+    store->flags[i] = decoded->flags;
 }
 
-static uint32_t calculate_x86_64_length(const uint8_t *bytes, uint32_t max_len, bool has_rex, uint8_t opcode, ModRM *modrm_out) {
-    if (max_len < 2) return 1;
+bool disasm_store_reserve(DisassemblyContext *ctx, uint32_t capacity) {
+    if (!ctx) return false;
     
-    uint32_t len = 1;
-    if (has_rex) len++;
+    InstructionStore *store = &ctx->store;
+    if (capacity <= store->capacity) return true;
     
-    bool has_modrm = false;
+    bool ok = grow_column((void**)&store->raw_words, capacity, sizeof(uint32_t)) &&
+              grow_column((void**)&store->opcodes, capacity, sizeof(uint16_t)) &&
+              grow_column((void**)&store->categories, capacity, sizeof(uint8_t)) &&
+              grow_column((void**)&store->branch_types, capacity, sizeof(uint8_t)) &&
+              grow_column((void**)&store->flags, capacity, sizeof(uint8_t)) &&
+              grow_column((void**)&store->branch_deltas, capacity, sizeof(int32_t)) &&
+              grow_column((void**)&store->regs_read, capacity, sizeof(uint32_t)) &&
+              grow_column((void**)&store->regs_written, capacity, sizeof(uint32_t));
     
-    if ((opcode >= 0x00 && opcode <= 0x3F) || 
-        (opcode >= 0x80 && opcode <= 0x8F) ||
-        (opcode >= 0xC0 && opcode <= 0xC7 && opcode != 0xC3) ||
-        (opcode >= 0xD0 && opcode <= 0xD3) ||
-        (opcode >= 0xF6 && opcode <= 0xF7) ||
-        (opcode >= 0xFE && opcode <= 0xFF)) {
-        has_modrm = true;
+    if (ok && (store->offsets || ctx->arch != ARCH_ARM64)) {
+        ok = grow_column((void**)&store->offsets, capacity, sizeof(uint32_t));
     }
     
-    if (!has_modrm) return len;
-    if (len >= max_len) return len;
+    if (ok) store->capacity = capacity;
+    return ok;
+}
+
+// Fixed-width rows that stop being contiguous fall back to explicit offsets
+static bool store_use_offsets(InstructionStore *store) {
+    store->offsets = (uint32_t*)malloc((store->capacity ? store->capacity : 1) * sizeof(uint32_t));
+    if (!store->offsets) return false;
     
-    ModRM modrm = decode_modrm(bytes[len]);
-    if (modrm_out) *modrm_out = modrm;
-    len++;
+    for (uint32_t k = 0; k < store->count; k++) {
+        store->offsets[k] = (uint32_t)(store->first_offset + (uint64_t)k * 4);
+    }
+    return true;
+}
+
+bool disasm_store_append(DisassemblyContext *ctx, const DisassembledInstruction *inst) {
+    if (!ctx || !inst) return false;
     
-    bool has_sib = (modrm.mod != 3 && modrm.rm == 4);
-    if (has_sib) {
-        if (len >= max_len) return len;
-        len++;
+    InstructionStore *store = &ctx->store;
+    if (store->count >= store->capacity) {
+        uint32_t capacity = store->capacity ? store->capacity * 2 : 1024;
+        if (!disasm_store_reserve(ctx, capacity)) return false;
     }
     
-    if (modrm.mod == 1) {
-        len += 1;
-    } else if (modrm.mod == 2) {
-        len += 4;
-    } else if (modrm.mod == 0 && modrm.rm == 5) {
-        len += 4;
+    uint64_t offset = inst->address - ctx->code_base_addr;
+    uint32_t i = store->count;
+    
+    if (i == 0) store->first_offset = offset;
+    
+    if (!store->offsets && offset != store->first_offset + (uint64_t)i * 4 && !store_use_offsets(store)) {
+        return false;
     }
+    if (store->offsets) store->offsets[i] = (uint32_t)offset;
+    
+    uint16_t opcode = 0;
+    if (!mnemonic_table_intern(&store->mnemonics, inst->mnemonic, &opcode)) return false;
+    
+    store_set_row(store, i, inst, opcode);
     
-    return len;
+    store->end_offset = offset + inst->length;
+    store->count++;
+    ctx->instruction_count = store->count;
+    
+    return true;
 }
 
-bool disasm_x86_64(const uint8_t *bytes, uint64_t address, DisassembledInstruction *inst) {
-    memset(inst, 0, sizeof(DisassembledInstruction));
-    inst->address = address;
-    inst->is_valid = false;
-    inst->length = 1;
+// Decodes the words of [start_offset, end_offset) straight into the columns
+// after the existing rows, like the parallel sweep, so no text is rendered
+// and .word rows are kept
+static bool store_append_arm64(DisassemblyContext *ctx, uint64_t start_offset, uint64_t end_offset) {
+    InstructionStore *store = &ctx->store;
+    uint32_t first = store->count;
+    uint32_t row_count = (uint32_t)((end_offset - start_offset) / 4);
     
-    uint32_t pos = 0;
-    bool has_rex = false;
-    uint8_t rex = 0;
+    if (row_count == 0) return true;
+    if (!disasm_store_reserve(ctx, first + row_count)) return false;
+    arm64_decode_table_init();
     
-    if (bytes[pos] >= 0x40 && bytes[pos] <= 0x4F) {
-        has_rex = true;
-        rex = bytes[pos];
-        pos++;
+    if (first == 0) {
+        store->first_offset = start_offset;
+    } else if (!store->offsets && start_offset != store->end_offset && !store_use_offsets(store)) {
+        return false;
     }
     
-    uint8_t opcode = bytes[pos];
-    pos++;
-    
-    ModRM modrm;
-    bool has_modrm = false;
-    
-    if (opcode == 0xC3) {
-        strcpy(inst->mnemonic, "RET");
-        inst->has_branch = true;
-        inst->branch_type = BRANCH_RETURN;
-        inst->category = INST_CATEGORY_BRANCH;
-        inst->is_valid = true;
-        inst->is_function_end = true;
-        inst->length = pos;
-    }
-    else if (opcode == 0xCB) {
-        strcpy(inst->mnemonic, "RETF");
-        inst->has_branch = true;
-        inst->branch_type = BRANCH_RETURN;
-        inst->category = INST_CATEGORY_BRANCH;
-        inst->is_valid = true;
-        inst->is_function_end = true;
-        inst->length = pos;
-    }
-    else if (opcode == 0xC2) {
-        strcpy(inst->mnemonic, "RET");
-        if (pos + 2 <= 15) {
-            uint16_t imm = *(uint16_t*)&bytes[pos];
-            snprintf(inst->operands, sizeof(inst->operands), "0x%x", imm);
-            inst->length = pos + 2;
-        }
-        inst->has_branch = true;
-        inst->branch_type = BRANCH_RETURN;
-        inst->category = INST_CATEGORY_BRANCH;
-        inst->is_valid = true;
-        inst->is_function_end = true;
-    }
-    else if (opcode == 0x90) {
-        strcpy(inst->mnemonic, "NOP");
-        inst->category = INST_CATEGORY_DATA_PROCESSING;
-        inst->is_valid = true;
-        inst->length = pos;
-    }
-    else if (opcode == 0xCC) {
-        strcpy(inst->mnemonic, "INT3");
-        inst->category = INST_CATEGORY_SYSTEM;
-        inst->is_valid = true;
-        inst->length = pos;
-    }
-    else if (opcode == 0xF4) {
-        strcpy(inst->mnemonic, "HLT");
-        inst->category = INST_CATEGORY_SYSTEM;
-        inst->is_valid = true;
-        inst->length = pos;
-    }
-    else if (opcode == 0xC9) {
-        strcpy(inst->mnemonic, "LEAVE");
-        inst->category = INST_CATEGORY_DATA_PROCESSING;
-        inst->is_valid = true;
-        inst->length = pos;
-    }
-    else if (opcode == 0x9C) {
-        strcpy(inst->mnemonic, has_rex ? "PUSHFQ" : "PUSHF");
-        inst->category = INST_CATEGORY_DATA_PROCESSING;
-        inst->is_valid = true;
-        inst->length = pos;
-    }
-    else if (opcode == 0x9D) {
-        strcpy(inst->mnemonic, has_rex ? "POPFQ" : "POPF");
-        inst->category = INST_CATEGORY_DATA_PROCESSING;
-        inst->is_valid = true;
-        inst->length = pos;
-    }
-    else if (opcode == 0x99) {
-        strcpy(inst->mnemonic, has_rex ? "CQO" : "CDQ");
-        inst->category = INST_CATEGORY_DATA_PROCESSING;
-        inst->is_valid = true;
-        inst->length = pos;
-    }
-    else if (opcode == 0xF5) {
-        strcpy(inst->mnemonic, "CMC");
-        inst->category = INST_CATEGORY_DATA_PROCESSING;
-        inst->is_valid = true;
-        inst->length = pos;
-    }
-    else if (opcode == 0xF8) {
-        strcpy(inst->mnemonic, "CLC");
-        inst->category = INST_CATEGORY_DATA_PROCESSING;
-        inst->is_valid = true;
-        inst->length = pos;
-    }
-    else if (opcode == 0xF9) {
-        strcpy(inst->mnemonic, "STC");
-        inst->category = INST_CATEGORY_DATA_PROCESSING;
-        inst->is_valid = true;
-        inst->length = pos;
-    }
-
-    else if (opcode >= 0x50 && opcode <= 0x57) {
-        strcpy(inst->mnemonic, "PUSH");
-        const char *regs64[] = {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi"};
-        const char *regs64_rex[] = {"r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"};
-        
-        uint8_t reg_idx = opcode - 0x50;
-        if (has_rex && (rex & 0x01)) {
-            snprintf(inst->operands, sizeof(inst->operands), "%s", regs64_rex[reg_idx]);
-        } else {
-            snprintf(inst->operands, sizeof(inst->operands), "%s", regs64[reg_idx]);
-        }
-        inst->category = INST_CATEGORY_DATA_PROCESSING;
-        inst->is_valid = true;
-        inst->length = pos;
-        inst->regs_read = (1U << reg_idx);
-    }
-
-    else if (opcode >= 0x58 && opcode <= 0x5F) {
-        strcpy(inst->mnemonic, "POP");
-        const char *regs64[] = {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi"};
-        const char *regs64_rex[] = {"r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"};
+    bool swapped = ctx->macho_ctx && ctx->macho_ctx->header.is_swapped;
+    uint16_t ids[ARM64_MNEMONIC_COUNT];
+    memset(ids, 0xFF, sizeof(ids));
+    ARM64DecodedWord decoded;
+    
+    for (uint32_t i = 0; i < row_count; i++) {
+        uint32_t bytes;
+        memcpy(&bytes, ctx->code_data + start_offset + (uint64_t)i * 4, sizeof(bytes));
+        if (swapped) bytes = swap_uint32(bytes);
         
-        uint8_t reg_idx = opcode - 0x58;
-        if (has_rex && (rex & 0x01)) {
-            snprintf(inst->operands, sizeof(inst->operands), "%s", regs64_rex[reg_idx]);
-        } else {
-            snprintf(inst->operands, sizeof(inst->operands), "%s", regs64[reg_idx]);
-        }
-        inst->category = INST_CATEGORY_DATA_PROCESSING;
-        inst->is_valid = true;
-        inst->length = pos;
-        inst->regs_written = (1U << reg_idx);
-    }
-    
-    else if (opcode == 0xE9) {
-        strcpy(inst->mnemonic, "JMP");
-        if (pos + 4 <= 15) {
-            int32_t offset = *(int32_t*)&bytes[pos];
-            inst->branch_target = address + pos + 4 + offset;
-            inst->has_branch_target = true;
-            inst->has_branch = true;
-            snprintf(inst->operands, sizeof(inst->operands), "0x%llx", inst->branch_target);
-            inst->branch_type = BRANCH_UNCONDITIONAL;
-            inst->category = INST_CATEGORY_BRANCH;
-            inst->is_valid = true;
-            inst->length = pos + 4;
-            inst->updates_pc = true;
-        }
-    }
-
-    else if (opcode == 0xEB) {
-        strcpy(inst->mnemonic, "JMP");
-        if (pos < 15) {
-            int8_t offset = (int8_t)bytes[pos];
-            inst->branch_target = address + pos + 1 + offset;
-            inst->has_branch_target = true;
-            inst->has_branch = true;
-            snprintf(inst->operands, sizeof(inst->operands), "0x%llx", inst->branch_target);
-            inst->branch_type = BRANCH_UNCONDITIONAL;
-            inst->category = INST_CATEGORY_BRANCH;
-            inst->is_valid = true;
-            inst->length = pos + 1;
-            inst->updates_pc = true;
-        }
-    }
-
-    else if (opcode == 0xE8) {
-        strcpy(inst->mnemonic, "CALL");
-        if (pos + 4 <= 15) {
-            int32_t offset = *(int32_t*)&bytes[pos];
-            inst->branch_target = address + pos + 4 + offset;
-            inst->has_branch_target = true;
-            inst->has_branch = true;
-            snprintf(inst->operands, sizeof(inst->operands), "0x%llx", inst->branch_target);
-            inst->branch_type = BRANCH_CALL;
-            inst->category = INST_CATEGORY_BRANCH;
-            inst->is_valid = true;
-            inst->length = pos + 4;
-            inst->updates_pc = true;
-        }
-    }
-
-    else if (opcode >= 0x70 && opcode <= 0x7F) {
-        const char *cond[] = {
-            "JO", "JNO", "JB", "JAE", "JE", "JNE", "JBE", "JA",
-            "JS", "JNS", "JP", "JNP", "JL", "JGE", "JLE", "JG"
-        };
-        strcpy(inst->mnemonic, cond[opcode - 0x70]);
+        arm64_decode_classified(bytes, &decoded);
         
-        if (pos < 15) {
-            int8_t offset = (int8_t)bytes[pos];
-            inst->branch_target = address + pos + 1 + offset;
-            inst->branch_offset = offset;
-            inst->has_branch_target = true;
-            inst->has_branch = true;
-            inst->branch_type = BRANCH_CONDITIONAL;
-            
-            snprintf(inst->operands, sizeof(inst->operands), "0x%llx", inst->branch_target);
-            inst->category = INST_CATEGORY_BRANCH;
-            inst->is_valid = true;
-            inst->length = pos + 1;
-            inst->updates_pc = true;
+        uint16_t *id = &ids[decoded.mnemonic];
+        if (*id == UINT16_MAX &&
+            !mnemonic_table_intern(&store->mnemonics, arm64_mnemonics[decoded.mnemonic], id)) {
+            return false;
         }
+        store_set_decoded(store, first + i, bytes, &decoded, *id);
+        if (store->offsets) store->offsets[first + i] = (uint32_t)(start_offset + (uint64_t)i * 4);
     }
+    
+    store->count = first + row_count;
+    store->end_offset = start_offset + (uint64_t)row_count * 4;
+    ctx->instruction_count = store->count;
+    ctx->current_offset = store->end_offset;
+    
+    return true;
+}
 
-    else if (opcode == 0x0F && inst->length < 15) {
-        uint8_t opcode2 = bytes[1];
-        inst->length = 2;
-        
-        if (opcode2 >= 0x80 && opcode2 <= 0x8F) {
-            const char *cond[] = {
-                "JO", "JNO", "JB", "JNB", "JZ", "JNZ", "JBE", "JNBE",
-                "JS", "JNS", "JP", "JNP", "JL", "JNL", "JLE", "JNLE"
-            };
-            strcpy(inst->mnemonic, cond[opcode2 - 0x80]);
-            int32_t offset = *(int32_t*)&bytes[2];
-            inst->branch_target = address + 6 + offset;
-            inst->has_branch_target = true;
-            inst->has_branch = true;
-            snprintf(inst->operands, sizeof(inst->operands), "0x%llx", inst->branch_target);
-            inst->branch_type = BRANCH_CONDITIONAL;
-            inst->category = INST_CATEGORY_BRANCH;
-            inst->is_valid = true;
-            inst->length = 6;
-        }
-
-        else if (opcode2 >= 0x90 && opcode2 <= 0x9F) {
-            const char *cond[] = {
-                "SETO", "SETNO", "SETB", "SETNB", "SETZ", "SETNZ", "SETBE", "SETNBE",
-                "SETS", "SETNS", "SETP", "SETNP", "SETL", "SETNL", "SETLE", "SETNLE"
-            };
-            strcpy(inst->mnemonic, cond[opcode2 - 0x90]);
-            strcpy(inst->operands, "r/m8");
-            inst->length = 3;
-            
-            inst->category = INST_CATEGORY_DATA_PROCESSING;
-            inst->is_valid = true;
-        }
+static void store_set_x86_64(InstructionStore *store, uint32_t i, const X86DecodedInstruction *decoded, uint16_t opcode) {
+    // The bytes are read from the code again when a row is rendered
+    store->raw_words[i] = 0;
+    store->opcodes[i] = opcode;
+    store->categories[i] = decoded->category;
+    store->branch_types[i] = decoded->branch_type;
+    store->branch_deltas[i] = (decoded->flags & INST_FLAG_HAS_BRANCH_TARGET) ? decoded->branch_delta : 0;
+    store->regs_read[i] = decoded->regs_read;
+    store->regs_written[i] = decoded->regs_written;
+    store->flags[i] = decoded->flags;
+}
 
-        else if (opcode2 == 0x0B) {
-            strcpy(inst->mnemonic, "UD2");
-            inst->category = INST_CATEGORY_SYSTEM;
-            inst->is_valid = true;
-            inst->length = 2;
+// Same for x86_64: instructions start in [start_offset, end_offset) but may
+// end anywhere up to limit_offset. Bytes that start no valid instruction
+// become one-byte rows, so the sweep never stops early or desynchronizes
+// past the next valid instruction.
+static bool store_append_x86_64(DisassemblyContext *ctx, uint64_t start_offset, uint64_t end_offset, uint64_t limit_offset) {
+    InstructionStore *store = &ctx->store;
+    uint32_t first = store->count;
+    
+    // Compiled x86_64 code averages close to 4 bytes per instruction
+    uint64_t estimated = first + (end_offset - start_offset) / 4 + 1;
+    if (estimated > UINT32_MAX) return false;
+    if (!disasm_store_reserve(ctx, (uint32_t)estimated)) return false;
+    
+    if (first == 0) store->first_offset = start_offset;
+    
+    uint16_t ids[X86_MNEMONIC_COUNT][X86_PREFIX_COUNT];
+    memset(ids, 0xFF, sizeof(ids));
+    X86DecodedInstruction decoded;
+    
+    uint32_t i = first;
+    uint64_t offset = start_offset;
+    while (offset < end_offset) {
+        if (i >= store->capacity) {
+            if (store->capacity >= UINT32_MAX / 2 || !disasm_store_reserve(ctx, store->capacity * 2)) return false;
         }
-        else {
-            snprintf(inst->mnemonic, sizeof(inst->mnemonic), ".byte");
-            snprintf(inst->operands, sizeof(inst->operands), "0x0F 0x%02X", opcode2);
-            inst->is_valid = true;
-            inst->length = 2;
+        
+        uint8_t length = x86_64_decode(ctx->code_data + offset, (size_t)(limit_offset - offset), &decoded);
+        
+        uint16_t *id = &ids[decoded.mnemonic][decoded.prefix];
+        if (*id == UINT16_MAX) {
+            char name[32];
+            x86_64_format_mnemonic(&decoded, name, sizeof(name));
+            if (!mnemonic_table_intern(&store->mnemonics, name, id)) return false;
         }
+        
+        store_set_x86_64(store, i, &decoded, *id);
+        store->offsets[i] = (uint32_t)offset;
+        offset += length;
+        i++;
     }
+    
+    store->count = i;
+    store->end_offset = offset;
+    ctx->instruction_count = store->count;
+    ctx->current_offset = offset;
+    
+    return true;
+}
 
-    else if (opcode >= 0xB8 && opcode <= 0xBF) {
-        strcpy(inst->mnemonic, "MOV");
-        const char *regs[] = {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi"};
-        uint32_t imm = *(uint32_t*)&bytes[1];
-        snprintf(inst->operands, sizeof(inst->operands), "%s, 0x%08X", regs[opcode - 0xB8], imm);
-        inst->category = INST_CATEGORY_DATA_PROCESSING;
-        inst->is_valid = true;
-        inst->length = 5;
-    }
-
-    else if (opcode == 0xCD) {
-        strcpy(inst->mnemonic, "INT");
-        snprintf(inst->operands, sizeof(inst->operands), "0x%02X", bytes[1]);
-        inst->category = INST_CATEGORY_SYSTEM;
-        inst->is_valid = true;
-        inst->length = 2;
-    }
-
-    else if (opcode == 0xC9) {
-        strcpy(inst->mnemonic, "LEAVE");
-        inst->category = INST_CATEGORY_DATA_PROCESSING;
-        inst->is_valid = true;
-        inst->length = 1;
+// Each stub is a function of its own, named by disasm_stub_name()
+static void store_mark_stubs(DisassemblyContext *ctx) {
+    for (uint32_t i = 0; i < ctx->stub_count; i++) {
+        int32_t row = disasm_find_by_address(ctx, ctx->stubs[i].address);
+        if (row >= 0) ctx->store.flags[row] |= INST_FLAG_FUNCTION_START;
     }
+}
 
-    else {
-        strcpy(inst->mnemonic, ".byte");
-        snprintf(inst->operands, sizeof(inst->operands), "0x%02X", opcode);
-        inst->is_valid = true;
-        inst->length = 1;
-    }
+void disasm_store_clear(DisassemblyContext *ctx) {
+    if (!ctx) return;
     
-    snprintf(inst->full_disasm, sizeof(inst->full_disasm), "0x%llx: %s %s",
-             inst->address, inst->mnemonic,
-             inst->operands[0] ? inst->operands : "");
+    InstructionStore *store = &ctx->store;
+    free(store->offsets);
+    free(store->raw_words);
+    free(store->opcodes);
+    free(store->categories);
+    free(store->branch_types);
+    free(store->flags);
+    free(store->branch_deltas);
+    free(store->regs_read);
+    free(store->regs_written);
+    mnemonic_table_free(&store->mnemonics);
     
-    return inst->is_valid;
+    memset(store, 0, sizeof(InstructionStore));
+    ctx->instruction_count = 0;
 }
 
-#pragma mark - High-Level Disassembly
+#pragma mark - Parallel Disassembly
 
-bool disasm_instruction(DisassemblyContext *ctx, DisassembledInstruction *inst) {
-    if (!ctx || !ctx->code_data || ctx->current_offset >= ctx->code_size) return false;
+typedef struct {
+    DisassemblyContext *ctx;
     
-    uint64_t addr = ctx->code_base_addr + ctx->current_offset;
+    // Words from start_offset land in rows first_row onwards
+    uint64_t start_offset;
+    uint32_t first_row;
+    uint32_t row_count;
+    uint32_t chunk_rows;
+    uint32_t chunk_count;
     
-    if (ctx->arch == ARCH_ARM64) {
-        if (ctx->current_offset + 4 > ctx->code_size) return false;
-        uint32_t bytes = *(uint32_t*)(ctx->code_data + ctx->current_offset);
+    // Each chunk interns into its own table; the tables are merged in chunk
+    // order afterwards, which reproduces the serial first-seen id order
+    MnemonicTable *chunk_tables;
+    uint16_t **chunk_remaps;
+    
+    atomic_uint next_chunk;
+    atomic_bool failed;
+} ParallelSweep;
+
+static void* sweep_decode_worker(void *arg) {
+    ParallelSweep *sweep = (ParallelSweep*)arg;
+    DisassemblyContext *ctx = sweep->ctx;
+    bool swapped = ctx->macho_ctx && ctx->macho_ctx->header.is_swapped;
+    ARM64DecodedWord decoded;
+    
+    for (;;) {
+        uint32_t chunk = atomic_fetch_add(&sweep->next_chunk, 1);
+        if (chunk >= sweep->chunk_count) break;
         
-        if (ctx->macho_ctx && ctx->macho_ctx->header.is_swapped) {
-            bytes = swap_uint32(bytes);
+        MnemonicTable *table = &sweep->chunk_tables[chunk];
+        uint32_t first = chunk * sweep->chunk_rows;
+        uint32_t last = first + sweep->chunk_rows;
+        if (last > sweep->row_count) last = sweep->row_count;
+        
+        // Decoder mnemonic id -> chunk id, interned on first use
+        uint16_t local_ids[ARM64_MNEMONIC_COUNT];
+        memset(local_ids, 0xFF, sizeof(local_ids));
+        
+        for (uint32_t i = first; i < last; i++) {
+            uint32_t bytes;
+            memcpy(&bytes, ctx->code_data + sweep->start_offset + (uint64_t)i * 4, sizeof(bytes));
+            if (swapped) bytes = swap_uint32(bytes);
+            
+            arm64_decode_classified(bytes, &decoded);
+            
+            uint16_t *local_id = &local_ids[decoded.mnemonic];
+            if (*local_id == UINT16_MAX &&
+                !mnemonic_table_intern(table, arm64_mnemonics[decoded.mnemonic], local_id)) {
+                atomic_store(&sweep->failed, true);
+                return NULL;
+            }
+            store_set_decoded(&ctx->store, sweep->first_row + i, bytes, &decoded, *local_id);
         }
+    }
+    
+    return NULL;
+}
+
+static void* sweep_remap_worker(void *arg) {
+    ParallelSweep *sweep = (ParallelSweep*)arg;
+    uint16_t *opcodes = sweep->ctx->store.opcodes + sweep->first_row;
+    
+    for (;;) {
+        uint32_t chunk = atomic_fetch_add(&sweep->next_chunk, 1);
+        if (chunk >= sweep->chunk_count) break;
         
-        ctx->current_offset += 4;
-        return disasm_arm64(bytes, addr, inst);
-    } else if (ctx->arch == ARCH_X86_64) {
-        bool result = disasm_x86_64(ctx->code_data + ctx->current_offset, addr, inst);
-        ctx->current_offset += inst->length;
-        return result;
+        const uint16_t *remap = sweep->chunk_remaps[chunk];
+        uint32_t first = chunk * sweep->chunk_rows;
+        uint32_t last = first + sweep->chunk_rows;
+        if (last > sweep->row_count) last = sweep->row_count;
+        
+        for (uint32_t i = first; i < last; i++) {
+            opcodes[i] = remap[opcodes[i]];
+        }
     }
     
-    return false;
+    return NULL;
 }
 
-uint32_t disasm_range(DisassemblyContext *ctx, uint64_t start_addr, uint64_t end_addr) {
-    if (!ctx || start_addr >= end_addr) return 0;
+// The caller's thread works too, so thread_count includes it
+static void sweep_run(ParallelSweep *sweep, void *(*worker)(void*), uint32_t thread_count) {
+    atomic_store(&sweep->next_chunk, 0);
     
-    uint64_t start_offset = start_addr - ctx->code_base_addr;
-    uint64_t end_offset = end_addr - ctx->code_base_addr;
+    pthread_t threads[DISASM_MAX_THREADS];
+    uint32_t started = 0;
+    for (uint32_t i = 1; i < thread_count; i++) {
+        if (pthread_create(&threads[started], NULL, worker, sweep) == 0) {
+            started++;
+        }
+    }
     
-    if (start_offset >= ctx->code_size) return 0;
-    if (end_offset > ctx->code_size) end_offset = ctx->code_size;
+    worker(sweep);
     
-    uint64_t range_size = end_offset - start_offset;
-    uint32_t estimated = (uint32_t)(range_size / 4);
-    if (estimated == 0) estimated = 1;
+    for (uint32_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+// Decodes row_count words from start_offset into rows first_row onwards, which
+// must be reserved already
+static bool sweep_range(DisassemblyContext *ctx, uint64_t start_offset, uint32_t first_row, uint32_t row_count,
+                        uint32_t thread_count) {
+    ParallelSweep sweep;
+    memset(&sweep, 0, sizeof(sweep));
+    sweep.ctx = ctx;
+    sweep.start_offset = start_offset;
+    sweep.first_row = first_row;
+    sweep.row_count = row_count;
+    sweep.chunk_rows = DISASM_PARALLEL_CHUNK;
+    sweep.chunk_count = (row_count + sweep.chunk_rows - 1) / sweep.chunk_rows;
+    sweep.chunk_tables = (MnemonicTable*)calloc(sweep.chunk_count, sizeof(MnemonicTable));
+    sweep.chunk_remaps = (uint16_t**)calloc(sweep.chunk_count, sizeof(uint16_t*));
+    atomic_init(&sweep.next_chunk, 0);
+    atomic_init(&sweep.failed, false);
     
-    ctx->instructions = (DisassembledInstruction*)malloc(estimated * sizeof(DisassembledInstruction));
-    if (!ctx->instructions) return 0;
+    if (thread_count > sweep.chunk_count) thread_count = sweep.chunk_count;
     
-    ctx->instruction_capacity = estimated;
-    ctx->instruction_count = 0;
-    ctx->current_offset = start_offset;
-    
-    while (ctx->current_offset < end_offset) {
-        if (ctx->instruction_count >= ctx->instruction_capacity) {
-            ctx->instruction_capacity *= 2;
-            DisassembledInstruction *new_ptr = (DisassembledInstruction*)realloc(
-                ctx->instructions,
-                ctx->instruction_capacity * sizeof(DisassembledInstruction)
-            );
-            if (!new_ptr) {
-                return ctx->instruction_count;
-            }
-            ctx->instructions = new_ptr;
-        }
-        
-        if (!disasm_instruction(ctx, &ctx->instructions[ctx->instruction_count])) {
+    bool ok = sweep.chunk_tables && sweep.chunk_remaps;
+    if (ok) {
+        sweep_run(&sweep, sweep_decode_worker, thread_count);
+        ok = !atomic_load(&sweep.failed);
+    }
+    
+    // Merging is serial but only touches the few distinct mnemonics per chunk
+    for (uint32_t c = 0; ok && c < sweep.chunk_count; c++) {
+        MnemonicTable *table = &sweep.chunk_tables[c];
+        sweep.chunk_remaps[c] = (uint16_t*)malloc((table->count ? table->count : 1) * sizeof(uint16_t));
+        if (!sweep.chunk_remaps[c]) {
+            ok = false;
             break;
         }
-        ctx->instruction_count++;
+        for (uint32_t id = 0; id < table->count; id++) {
+            if (!mnemonic_table_intern(&ctx->store.mnemonics, table->names[id], &sweep.chunk_remaps[c][id])) {
+                ok = false;
+                break;
+            }
+        }
     }
     
-    return ctx->instruction_count;
+    if (ok) sweep_run(&sweep, sweep_remap_worker, thread_count);
+    
+    for (uint32_t c = 0; c < sweep.chunk_count; c++) {
+        if (sweep.chunk_tables) mnemonic_table_free(&sweep.chunk_tables[c]);
+        if (sweep.chunk_remaps) free(sweep.chunk_remaps[c]);
+    }
+    free(sweep.chunk_tables);
+    free(sweep.chunk_remaps);
+    
+    return ok;
 }
 
-uint32_t disasm_all(DisassemblyContext *ctx) {
+uint32_t disasm_all_parallel(DisassemblyContext *ctx, uint32_t thread_count) {
     if (!ctx || !ctx->code_data) return 0;
     
-    ctx->current_offset = 0;
-    uint32_t estimated = ctx->code_size / 4;
+    // Variable-length code has no known boundaries to split at
+    if (ctx->arch != ARCH_ARM64) return disasm_all(ctx);
     
-    ctx->instructions = (DisassembledInstruction*)malloc(estimated * sizeof(DisassembledInstruction));
-    if (!ctx->instructions) return 0;
+    uint64_t total_rows = 0;
+    for (uint32_t r = 0; r < code_range_count(ctx); r++) {
+        uint64_t range_start, range_end, range_limit;
+        if (code_range(ctx, r, 0, ctx->code_size, &range_start, &range_end, &range_limit)) {
+            total_rows += (range_end - range_start) / 4;
+        }
+    }
     
-    ctx->instruction_capacity = estimated;
-    ctx->instruction_count = 0;
+    disasm_store_clear(ctx);
+    if (total_rows == 0 || total_rows > UINT32_MAX) return 0;
+    
+    if (thread_count == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = (uint32_t)(cpus > 0 ? cpus : 1);
+    }
+    if (thread_count > DISASM_MAX_THREADS) thread_count = DISASM_MAX_THREADS;
+    
+    if (!disasm_store_reserve(ctx, (uint32_t)total_rows)) return 0;
+    arm64_decode_table_init();
     
-    while (ctx->current_offset < ctx->code_size) {
-        if (ctx->instruction_count >= ctx->instruction_capacity) {
-            ctx->instruction_capacity *= 2;
-            ctx->instructions = (DisassembledInstruction*)realloc(ctx->instructions,
-                                                                   ctx->instruction_capacity * sizeof(DisassembledInstruction));
-            if (!ctx->instructions) return 0;
+    // Sections are swept one after the other, each across all threads
+    InstructionStore *store = &ctx->store;
+    bool ok = true;
+    for (uint32_t r = 0; ok && r < code_range_count(ctx); r++) {
+        uint64_t range_start, range_end, range_limit;
+        if (!code_range(ctx, r, 0, ctx->code_size, &range_start, &range_end, &range_limit)) continue;
+        
+        uint32_t rows = (uint32_t)((range_end - range_start) / 4);
+        if (rows == 0) continue;
+        
+        if (store->count == 0) {
+            store->first_offset = range_start;
+        } else if (!store->offsets && range_start != store->end_offset) {
+            ok = store_use_offsets(store);
         }
         
-        if (!disasm_instruction(ctx, &ctx->instructions[ctx->instruction_count])) {
-            break;
+        ok = ok && sweep_range(ctx, range_start, store->count, rows, thread_count);
+        
+        for (uint32_t i = 0; ok && store->offsets && i < rows; i++) {
+            store->offsets[store->count + i] = (uint32_t)(range_start + (uint64_t)i * 4);
         }
-        ctx->instruction_count++;
+        
+        store->count += rows;
+        store->end_offset = range_start + (uint64_t)rows * 4;
     }
     
-    return ctx->instruction_count;
+    if (!ok) {
+        disasm_store_clear(ctx);
+        return 0;
+    }
+    
+    ctx->instruction_count = store->count;
+    ctx->current_offset = store->end_offset;
+    store_mark_stubs(ctx);
+    
+    return store->count;
 }
 
-uint32_t disasm_detect_functions(DisassemblyContext *ctx) {
-    if (!ctx || !ctx->instructions) return 0;
+#pragma mark - Instruction Access
+
+static uint64_t store_offset_at(const InstructionStore *store, uint32_t index) {
+    return store->offsets ? store->offsets[index] : store->first_offset + (uint64_t)index * 4;
+}
+
+uint64_t disasm_address_at(const DisassemblyContext *ctx, uint32_t index) {
+    if (!ctx || index >= ctx->instruction_count) return 0;
+    return ctx->code_base_addr + store_offset_at(&ctx->store, index);
+}
+
+uint8_t disasm_length_at(const DisassemblyContext *ctx, uint32_t index) {
+    if (!ctx || index >= ctx->instruction_count) return 0;
+    if (!ctx->store.offsets) return 4;
     
-    uint32_t func_count = 0;
-    for (uint32_t i = 0; i < ctx->instruction_count; i++) {
-        if (ctx->instructions[i].is_function_start) {
-            func_count++;
-        }
-    }
+    uint64_t next = (index + 1 < ctx->instruction_count) ? ctx->store.offsets[index + 1] : ctx->store.end_offset;
+    return (uint8_t)(next - ctx->store.offsets[index]);
+}
+
+BranchType disasm_branch_type_at(const DisassemblyContext *ctx, uint32_t index) {
+    if (!ctx || index >= ctx->instruction_count) return BRANCH_NONE;
+    return (BranchType)ctx->store.branch_types[index];
+}
+
+bool disasm_branch_target_at(const DisassemblyContext *ctx, uint32_t index, uint64_t *target) {
+    if (!ctx || index >= ctx->instruction_count) return false;
+    if (!(ctx->store.flags[index] & INST_FLAG_HAS_BRANCH_TARGET)) return false;
     
-    return func_count;
+    if (target) *target = disasm_address_at(ctx, index) + (int64_t)ctx->store.branch_deltas[index];
+    return true;
+}
+
+const char* disasm_mnemonic_at(const DisassemblyContext *ctx, uint32_t index) {
+    if (!ctx || index >= ctx->instruction_count) return NULL;
+    return ctx->store.mnemonics.names[ctx->store.opcodes[index]];
 }
 
-int32_t disasm_find_by_address(DisassemblyContext *ctx, uint64_t address) {
-    if (!ctx || !ctx->instructions) return -1;
+bool disasm_get(const DisassemblyContext *ctx, uint32_t index, DisassembledInstruction *inst) {
+    if (!ctx || !inst || index >= ctx->instruction_count) return false;
     
-    for (uint32_t i = 0; i < ctx->instruction_count; i++) {
-        if (ctx->instructions[i].address == address) {
-            return (int32_t)i;
-        }
+    const InstructionStore *store = &ctx->store;
+    uint64_t offset = store_offset_at(store, index);
+    uint64_t address = ctx->code_base_addr + offset;
+    uint8_t flags = store->flags[index];
+    
+    if (ctx->arch == ARCH_ARM64) {
+        disasm_arm64(store->raw_words[index], address, inst);
+    } else if (ctx->arch == ARCH_X86_64 && ctx->code_data && offset < ctx->code_size) {
+        disasm_x86_64_available(ctx->code_data + offset, (size_t)(ctx->code_size - offset), address, inst);
+    } else {
+        // No bytes to decode: everything but the operand text is in the columns
+        memset(inst, 0, sizeof(DisassembledInstruction));
+        inst->address = address;
+        inst->raw_bytes = store->raw_words[index];
+        inst->length = disasm_length_at(ctx, index);
+        snprintf(inst->mnemonic, sizeof(inst->mnemonic), "%s", disasm_mnemonic_at(ctx, index));
+        snprintf(inst->full_disasm, sizeof(inst->full_disasm), "0x%llx: %s ", address, inst->mnemonic);
+        inst->category = (InstructionCategory)store->categories[index];
+        inst->branch_type = (BranchType)store->branch_types[index];
+        inst->has_branch_target = (flags & INST_FLAG_HAS_BRANCH_TARGET) != 0;
+        inst->branch_offset = store->branch_deltas[index];
+        inst->branch_target = inst->has_branch_target ? address + (int64_t)store->branch_deltas[index] : 0;
+        inst->regs_read = store->regs_read[index];
+        inst->regs_written = store->regs_written[index];
+        inst->is_valid = (flags & INST_FLAG_VALID) != 0;
+        inst->updates_pc = (flags & INST_FLAG_UPDATES_PC) != 0;
+        inst->has_branch = (flags & INST_FLAG_HAS_BRANCH) != 0;
     }
     
-    return -1;
+    // Calls and jumps into a stub are named after the import behind it
+    if (inst->has_branch_target && inst->comment[0] == '\0') {
+        const char *stub_name = disasm_stub_name(ctx, inst->branch_target);
+        if (stub_name) snprintf(inst->comment, sizeof(inst->comment), "%s", stub_name);
+    }
+    
+    // Function boundaries can be refined after decoding, so the column wins
+    inst->is_function_start = (flags & INST_FLAG_FUNCTION_START) != 0;
+    inst->is_function_end = (flags & INST_FLAG_FUNCTION_END) != 0;
+    
+    return true;
 }
 
 void disasm_format_instruction(const DisassembledInstruction *inst, char *buffer, size_t buffer_size) {
@@ -1130,3 +5948,153 @@ void disasm_format_instruction(const DisassembledInstruction *inst, char *buffer
     }
 }
 
+
+#pragma mark - ARM64 References
+
+typedef struct {
+    ARM64Reference *items;
+    uint32_t count;
+    uint32_t capacity;
+} ReferenceList;
+
+// Addresses held by X0-X30; values[reg] is valid while its bit of known is set
+typedef struct {
+    uint64_t values[32];
+    uint32_t known;
+} ReferenceRegisters;
+
+static bool reference_list_push(ReferenceList *list, uint32_t index, uint64_t from, uint64_t to, uint8_t kind) {
+    if (list->count == list->capacity) {
+        uint32_t capacity = list->capacity ? list->capacity * 2 : 1024;
+        ARM64Reference *items = realloc(list->items, (size_t)capacity * sizeof(ARM64Reference));
+        if (!items) return false;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    
+    list->items[list->count++] = (ARM64Reference){ .from_address = from, .to_address = to, .index = index, .kind = kind };
+    return true;
+}
+
+// Register 31 is SP as a base and the zero register elsewhere; neither is tracked
+static bool reference_register_value(const ReferenceRegisters *regs, uint8_t reg, uint64_t *out_value) {
+    if (reg >= 31 || !(regs->known & (1U << reg))) return false;
+    *out_value = regs->values[reg];
+    return true;
+}
+
+static uint8_t reference_kind_of_branch(BranchType type) {
+    switch (type) {
+        case BRANCH_CALL: return ARM64_REF_CALL;
+        case BRANCH_CONDITIONAL: return ARM64_REF_CONDITIONAL_JUMP;
+        default: return ARM64_REF_JUMP;
+    }
+}
+
+static bool reference_collect_word(ReferenceList *list, ReferenceRegisters *regs, uint32_t index, uint64_t address, const ARM64DecodedWord *decoded) {
+    const ARM64DecodedOperand *operands = decoded->operands;
+    uint64_t value = 0;
+    bool has_value = false;
+    bool ok = true;
+    
+    switch (decoded->mnemonic) {
+        case ARM64_MNEMONIC_ADR:
+        case ARM64_MNEMONIC_ADRP:
+            has_value = arm64_operand_address(&operands[1], address, &value);
+            ok = reference_list_push(list, index, address, value, ARM64_REF_ADDRESS_LOAD);
+            break;
+        case ARM64_MNEMONIC_ADD:
+            // The low 12 bits of an ADRP page, 64-bit forms only
+            if (decoded->operand_count == 3 && operands[1].reg_class == ARM64_REG_SP &&
+                operands[2].kind == ARM64_OPND_IMM && reference_register_value(regs, operands[1].reg, &value)) {
+                value += (uint64_t)operands[2].imm;
+                has_value = true;
+                ok = reference_list_push(list, index, address, value, ARM64_REF_ADDRESS_LOAD);
+            }
+            break;
+        case ARM64_MNEMONIC_MOV:
+            if (decoded->operand_count == 2 && operands[1].kind == ARM64_OPND_REG &&
+                (operands[1].reg_class == ARM64_REG_X || operands[1].reg_class == ARM64_REG_SP)) {
+                has_value = reference_register_value(regs, operands[1].reg, &value);
+            }
+            break;
+        default:
+            for (uint8_t i = 0; i < decoded->operand_count; i++) {
+                const ARM64DecodedOperand *operand = &operands[i];
+                uint64_t target;
+                
+                if (operand->kind != ARM64_OPND_MEM || !operand->access) continue;
+                if (operand->addressing == ARM64_MEM_LITERAL) {
+                    target = address + (uint64_t)operand->imm;
+                } else if (operand->addressing != ARM64_MEM_REG_OFFSET &&
+                           reference_register_value(regs, operand->reg, &target)) {
+                    if (operand->addressing != ARM64_MEM_POST_INDEX) target += (uint64_t)operand->imm;
+                } else {
+                    break;
+                }
+                
+                uint8_t kind = (operand->access & ARM64_WRITE) ? ARM64_REF_DATA_WRITE : ARM64_REF_DATA_READ;
+                ok = reference_list_push(list, index, address, target, kind);
+                break;
+            }
+            break;
+    }
+    
+    regs->known &= ~decoded->regs_written;
+    if (has_value && operands[0].reg < 31) {
+        regs->values[operands[0].reg] = value;
+        regs->known |= 1U << operands[0].reg;
+    }
+    return ok;
+}
+
+ARM64Reference* disasm_collect_references(const DisassemblyContext *ctx, uint32_t *out_count) {
+    if (out_count) *out_count = 0;
+    if (!ctx || !out_count || ctx->arch != ARCH_ARM64) return NULL;
+    
+    const InstructionStore *store = &ctx->store;
+    ReferenceList list = { 0 };
+    ReferenceRegisters regs;
+    regs.known = 0;
+    ARM64DecodedWord decoded;
+    
+    for (uint32_t i = 0; i < ctx->instruction_count; i++) {
+        uint64_t address = ctx->code_base_addr + store_offset_at(store, i);
+        uint8_t flags = store->flags[i];
+        BranchType branch_type = (BranchType)store->branch_types[i];
+        bool ok = true;
+        
+        if (flags & INST_FLAG_FUNCTION_START) regs.known = 0;
+        
+        // Only the rows that can form an address are decoded again
+        if (flags & INST_FLAG_HAS_BRANCH_TARGET) {
+            uint64_t target = address + (int64_t)store->branch_deltas[i];
+            ok = reference_list_push(&list, i, address, target, reference_kind_of_branch(branch_type));
+        } else if (store->categories[i] == INST_CATEGORY_DATA_PROCESSING || store->categories[i] == INST_CATEGORY_LOAD_STORE) {
+            arm64_decode_word(store->raw_words[i], &decoded);
+            ok = reference_collect_word(&list, &regs, i, address, &decoded);
+        } else {
+            regs.known &= ~store->regs_written[i];
+        }
+        
+        if (!ok) {
+            free(list.items);
+            return NULL;
+        }
+        
+        // Calls clobber X0-X18 and LR; nothing falls through B, BR or RET
+        if (branch_type == BRANCH_CALL) {
+            regs.known &= ~0x4007FFFFU;
+        } else if (branch_type == BRANCH_UNCONDITIONAL || branch_type == BRANCH_RETURN) {
+            regs.known = 0;
+        }
+    }
+    
+    if (list.count == 0) {
+        free(list.items);
+        return NULL;
+    }
+    
+    *out_count = list.count;
+    return list.items;
+}
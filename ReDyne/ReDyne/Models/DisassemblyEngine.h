@@ -64,40 +64,760 @@ typedef struct {
     
 } DisassembledInstruction;
 
+#pragma mark - Compact Instruction Store
+
+// Bits of the InstructionStore flags column
+enum {
+    INST_FLAG_VALID = 1 << 0,
+    INST_FLAG_HAS_BRANCH_TARGET = 1 << 1,
+    INST_FLAG_FUNCTION_START = 1 << 2,
+    INST_FLAG_FUNCTION_END = 1 << 3,
+    INST_FLAG_UPDATES_PC = 1 << 4,
+    INST_FLAG_HAS_BRANCH = 1 << 5
+};
+
+// Bytes per decoded instruction, offsets column included (it only exists for
+// variable-length code)
+#define INSTRUCTION_STORE_ROW_SIZE 25
+
+#define DISASM_PARALLEL_THRESHOLD (256 * 1024)
+#define DISASM_PARALLEL_CHUNK 16384
+#define DISASM_MAX_THREADS 64
+
+// Opcode id -> mnemonic, with an open-addressed lookup by name
+typedef struct {
+    char (*names)[32];
+    uint32_t count;
+    uint32_t capacity;
+    uint16_t *slots;
+    uint32_t slot_count;
+} MnemonicTable;
+
+// Decoded instructions as parallel columns. Text is not stored: mnemonics are
+// interned once per store and everything else is re-decoded from the raw bytes
+// by disasm_get() for the rows that are actually displayed or exported.
+typedef struct {
+    uint32_t count;
+    uint32_t capacity;
+    
+    // Rows of fixed-width code are contiguous from first_offset, so their
+    // addresses are implied; offsets is only allocated for x86_64 (or a gap)
+    uint64_t first_offset;
+    uint64_t end_offset;
+    uint32_t *offsets;
+    
+    uint32_t *raw_words;
+    uint16_t *opcodes;
+    uint8_t *categories;
+    uint8_t *branch_types;
+    uint8_t *flags;
+    int32_t *branch_deltas;
+    uint32_t *regs_read;
+    uint32_t *regs_written;
+    
+    MnemonicTable mnemonics;
+} InstructionStore;
+
+#pragma mark - ARM64 Structured Decoding
+
+#define ARM64_MAX_OPERANDS 4
+
+// Mnemonics produced by arm64_decode_word(). Preferred aliases (MOV, CMP,
+// LSL, CSET...) have their own ids; size and ordering variants of the
+// exclusive and atomic loads and stores are laid out in fixed-size runs.
+// Advanced SIMD forms sharing a name with a general purpose instruction get
+// their own id (suffix _V), and each widening or narrowing operation is
+// followed by its second-half ("2") form.
+typedef enum {
+    ARM64_MNEMONIC_B, ARM64_MNEMONIC_BL,
+    ARM64_MNEMONIC_B_EQ, ARM64_MNEMONIC_B_NE, ARM64_MNEMONIC_B_CS, ARM64_MNEMONIC_B_CC,
+    ARM64_MNEMONIC_B_MI, ARM64_MNEMONIC_B_PL, ARM64_MNEMONIC_B_VS, ARM64_MNEMONIC_B_VC,
+    ARM64_MNEMONIC_B_HI, ARM64_MNEMONIC_B_LS, ARM64_MNEMONIC_B_GE, ARM64_MNEMONIC_B_LT,
+    ARM64_MNEMONIC_B_GT, ARM64_MNEMONIC_B_LE, ARM64_MNEMONIC_B_AL, ARM64_MNEMONIC_B_NV,
+    ARM64_MNEMONIC_CBZ, ARM64_MNEMONIC_CBNZ, ARM64_MNEMONIC_TBZ, ARM64_MNEMONIC_TBNZ,
+    ARM64_MNEMONIC_BR, ARM64_MNEMONIC_BLR, ARM64_MNEMONIC_RET,
+    ARM64_MNEMONIC_BRAAZ, ARM64_MNEMONIC_BRABZ, ARM64_MNEMONIC_BLRAAZ, ARM64_MNEMONIC_BLRABZ,
+    ARM64_MNEMONIC_RETAA, ARM64_MNEMONIC_RETAB, ARM64_MNEMONIC_BRAA, ARM64_MNEMONIC_BRAB,
+    ARM64_MNEMONIC_BLRAA, ARM64_MNEMONIC_BLRAB, ARM64_MNEMONIC_ERET, ARM64_MNEMONIC_ERETAA,
+    ARM64_MNEMONIC_ERETAB, ARM64_MNEMONIC_DRPS,
+    ARM64_MNEMONIC_SVC, ARM64_MNEMONIC_HVC, ARM64_MNEMONIC_SMC, ARM64_MNEMONIC_BRK,
+    ARM64_MNEMONIC_HLT, ARM64_MNEMONIC_UDF,
+    ARM64_MNEMONIC_NOP, ARM64_MNEMONIC_YIELD, ARM64_MNEMONIC_WFE, ARM64_MNEMONIC_WFI,
+    ARM64_MNEMONIC_SEV, ARM64_MNEMONIC_SEVL,
+    ARM64_MNEMONIC_XPACLRI, ARM64_MNEMONIC_PACIA1716, ARM64_MNEMONIC_PACIB1716,
+    ARM64_MNEMONIC_AUTIA1716, ARM64_MNEMONIC_AUTIB1716, ARM64_MNEMONIC_ESB, ARM64_MNEMONIC_PSB,
+    ARM64_MNEMONIC_TSB, ARM64_MNEMONIC_CSDB, ARM64_MNEMONIC_PACIAZ, ARM64_MNEMONIC_PACIASP,
+    ARM64_MNEMONIC_PACIBZ, ARM64_MNEMONIC_PACIBSP, ARM64_MNEMONIC_AUTIAZ, ARM64_MNEMONIC_AUTIASP,
+    ARM64_MNEMONIC_AUTIBZ, ARM64_MNEMONIC_AUTIBSP, ARM64_MNEMONIC_BTI, ARM64_MNEMONIC_HINT,
+    ARM64_MNEMONIC_CLREX, ARM64_MNEMONIC_DSB, ARM64_MNEMONIC_DMB, ARM64_MNEMONIC_ISB,
+    ARM64_MNEMONIC_SB, ARM64_MNEMONIC_MSR, ARM64_MNEMONIC_MRS, ARM64_MNEMONIC_SYS,
+    ARM64_MNEMONIC_SYSL,
+    ARM64_MNEMONIC_ADR, ARM64_MNEMONIC_ADRP,
+    ARM64_MNEMONIC_ADD, ARM64_MNEMONIC_ADDS, ARM64_MNEMONIC_SUB, ARM64_MNEMONIC_SUBS,
+    ARM64_MNEMONIC_CMN, ARM64_MNEMONIC_CMP, ARM64_MNEMONIC_MOV, ARM64_MNEMONIC_NEG,
+    ARM64_MNEMONIC_NEGS, ARM64_MNEMONIC_MVN, ARM64_MNEMONIC_TST,
+    ARM64_MNEMONIC_AND, ARM64_MNEMONIC_ORR, ARM64_MNEMONIC_EOR, ARM64_MNEMONIC_ANDS,
+    ARM64_MNEMONIC_BIC, ARM64_MNEMONIC_ORN, ARM64_MNEMONIC_EON, ARM64_MNEMONIC_BICS,
+    ARM64_MNEMONIC_MOVN, ARM64_MNEMONIC_MOVZ, ARM64_MNEMONIC_MOVK,
+    ARM64_MNEMONIC_SBFM, ARM64_MNEMONIC_BFM, ARM64_MNEMONIC_UBFM, ARM64_MNEMONIC_ASR,
+    ARM64_MNEMONIC_LSL, ARM64_MNEMONIC_LSR, ARM64_MNEMONIC_ROR, ARM64_MNEMONIC_SXTB,
+    ARM64_MNEMONIC_SXTH, ARM64_MNEMONIC_SXTW, ARM64_MNEMONIC_UXTB, ARM64_MNEMONIC_UXTH,
+    ARM64_MNEMONIC_SBFX, ARM64_MNEMONIC_UBFX, ARM64_MNEMONIC_SBFIZ, ARM64_MNEMONIC_UBFIZ,
+    ARM64_MNEMONIC_BFI, ARM64_MNEMONIC_BFXIL, ARM64_MNEMONIC_EXTR,
+    ARM64_MNEMONIC_ADC, ARM64_MNEMONIC_ADCS, ARM64_MNEMONIC_SBC, ARM64_MNEMONIC_SBCS,
+    ARM64_MNEMONIC_NGC, ARM64_MNEMONIC_NGCS,
+    ARM64_MNEMONIC_CCMN, ARM64_MNEMONIC_CCMP,
+    ARM64_MNEMONIC_CSEL, ARM64_MNEMONIC_CSINC, ARM64_MNEMONIC_CSINV, ARM64_MNEMONIC_CSNEG,
+    ARM64_MNEMONIC_CSET, ARM64_MNEMONIC_CSETM, ARM64_MNEMONIC_CINC, ARM64_MNEMONIC_CINV,
+    ARM64_MNEMONIC_CNEG,
+    ARM64_MNEMONIC_UDIV, ARM64_MNEMONIC_SDIV, ARM64_MNEMONIC_CRC32B, ARM64_MNEMONIC_CRC32H,
+    ARM64_MNEMONIC_CRC32W, ARM64_MNEMONIC_CRC32X, ARM64_MNEMONIC_CRC32CB, ARM64_MNEMONIC_CRC32CH,
+    ARM64_MNEMONIC_CRC32CW, ARM64_MNEMONIC_CRC32CX, ARM64_MNEMONIC_PACGA,
+    ARM64_MNEMONIC_RBIT, ARM64_MNEMONIC_REV16, ARM64_MNEMONIC_REV32, ARM64_MNEMONIC_REV,
+    ARM64_MNEMONIC_CLZ, ARM64_MNEMONIC_CLS,
+    ARM64_MNEMONIC_PACIA, ARM64_MNEMONIC_PACIB, ARM64_MNEMONIC_PACDA, ARM64_MNEMONIC_PACDB,
+    ARM64_MNEMONIC_AUTIA, ARM64_MNEMONIC_AUTIB, ARM64_MNEMONIC_AUTDA, ARM64_MNEMONIC_AUTDB,
+    ARM64_MNEMONIC_PACIZA, ARM64_MNEMONIC_PACIZB, ARM64_MNEMONIC_PACDZA, ARM64_MNEMONIC_PACDZB,
+    ARM64_MNEMONIC_AUTIZA, ARM64_MNEMONIC_AUTIZB, ARM64_MNEMONIC_AUTDZA, ARM64_MNEMONIC_AUTDZB,
+    ARM64_MNEMONIC_XPACI, ARM64_MNEMONIC_XPACD,
+    ARM64_MNEMONIC_MADD, ARM64_MNEMONIC_MSUB, ARM64_MNEMONIC_MUL, ARM64_MNEMONIC_MNEG,
+    ARM64_MNEMONIC_SMADDL, ARM64_MNEMONIC_SMSUBL, ARM64_MNEMONIC_SMULL, ARM64_MNEMONIC_SMNEGL,
+    ARM64_MNEMONIC_SMULH, ARM64_MNEMONIC_UMADDL, ARM64_MNEMONIC_UMSUBL, ARM64_MNEMONIC_UMULL,
+    ARM64_MNEMONIC_UMNEGL, ARM64_MNEMONIC_UMULH,
+    ARM64_MNEMONIC_STRB, ARM64_MNEMONIC_LDRB, ARM64_MNEMONIC_LDRSB, ARM64_MNEMONIC_STRH,
+    ARM64_MNEMONIC_LDRH, ARM64_MNEMONIC_LDRSH, ARM64_MNEMONIC_STR, ARM64_MNEMONIC_LDR,
+    ARM64_MNEMONIC_LDRSW, ARM64_MNEMONIC_PRFM,
+    ARM64_MNEMONIC_STURB, ARM64_MNEMONIC_LDURB, ARM64_MNEMONIC_LDURSB, ARM64_MNEMONIC_STURH,
+    ARM64_MNEMONIC_LDURH, ARM64_MNEMONIC_LDURSH, ARM64_MNEMONIC_STUR, ARM64_MNEMONIC_LDUR,
+    ARM64_MNEMONIC_LDURSW, ARM64_MNEMONIC_PRFUM,
+    ARM64_MNEMONIC_STTRB, ARM64_MNEMONIC_LDTRB, ARM64_MNEMONIC_LDTRSB, ARM64_MNEMONIC_STTRH,
+    ARM64_MNEMONIC_LDTRH, ARM64_MNEMONIC_LDTRSH, ARM64_MNEMONIC_STTR, ARM64_MNEMONIC_LDTR,
+    ARM64_MNEMONIC_LDTRSW,
+    ARM64_MNEMONIC_LDRAA, ARM64_MNEMONIC_LDRAB,
+    ARM64_MNEMONIC_STP, ARM64_MNEMONIC_LDP, ARM64_MNEMONIC_LDPSW, ARM64_MNEMONIC_STNP,
+    ARM64_MNEMONIC_LDNP,
+    ARM64_MNEMONIC_STXR, ARM64_MNEMONIC_STXRB, ARM64_MNEMONIC_STXRH, ARM64_MNEMONIC_STLXR,
+    ARM64_MNEMONIC_STLXRB, ARM64_MNEMONIC_STLXRH, ARM64_MNEMONIC_LDXR, ARM64_MNEMONIC_LDXRB,
+    ARM64_MNEMONIC_LDXRH, ARM64_MNEMONIC_LDAXR, ARM64_MNEMONIC_LDAXRB, ARM64_MNEMONIC_LDAXRH,
+    ARM64_MNEMONIC_STLLR, ARM64_MNEMONIC_STLLRB, ARM64_MNEMONIC_STLLRH, ARM64_MNEMONIC_STLR,
+    ARM64_MNEMONIC_STLRB, ARM64_MNEMONIC_STLRH, ARM64_MNEMONIC_LDLAR, ARM64_MNEMONIC_LDLARB,
+    ARM64_MNEMONIC_LDLARH, ARM64_MNEMONIC_LDAR, ARM64_MNEMONIC_LDARB, ARM64_MNEMONIC_LDARH,
+    ARM64_MNEMONIC_STXP, ARM64_MNEMONIC_STLXP, ARM64_MNEMONIC_LDXP, ARM64_MNEMONIC_LDAXP,
+    ARM64_MNEMONIC_LDAPR, ARM64_MNEMONIC_LDAPRB, ARM64_MNEMONIC_LDAPRH,
+    ARM64_MNEMONIC_STLURB, ARM64_MNEMONIC_LDAPURB, ARM64_MNEMONIC_LDAPURSB, ARM64_MNEMONIC_STLURH,
+    ARM64_MNEMONIC_LDAPURH, ARM64_MNEMONIC_LDAPURSH, ARM64_MNEMONIC_STLUR, ARM64_MNEMONIC_LDAPUR,
+    ARM64_MNEMONIC_LDAPURSW,
+    ARM64_MNEMONIC_CAS, ARM64_MNEMONIC_CASA, ARM64_MNEMONIC_CASL, ARM64_MNEMONIC_CASAL,
+    ARM64_MNEMONIC_CASB, ARM64_MNEMONIC_CASAB, ARM64_MNEMONIC_CASLB, ARM64_MNEMONIC_CASALB,
+    ARM64_MNEMONIC_CASH, ARM64_MNEMONIC_CASAH, ARM64_MNEMONIC_CASLH, ARM64_MNEMONIC_CASALH,
+    ARM64_MNEMONIC_CASP, ARM64_MNEMONIC_CASPA, ARM64_MNEMONIC_CASPL, ARM64_MNEMONIC_CASPAL,
+    ARM64_MNEMONIC_LDADD, ARM64_MNEMONIC_LDADDA, ARM64_MNEMONIC_LDADDL, ARM64_MNEMONIC_LDADDAL,
+    ARM64_MNEMONIC_LDADDB, ARM64_MNEMONIC_LDADDAB, ARM64_MNEMONIC_LDADDLB, ARM64_MNEMONIC_LDADDALB,
+    ARM64_MNEMONIC_LDADDH, ARM64_MNEMONIC_LDADDAH, ARM64_MNEMONIC_LDADDLH, ARM64_MNEMONIC_LDADDALH,
+    ARM64_MNEMONIC_LDCLR, ARM64_MNEMONIC_LDCLRA, ARM64_MNEMONIC_LDCLRL, ARM64_MNEMONIC_LDCLRAL,
+    ARM64_MNEMONIC_LDCLRB, ARM64_MNEMONIC_LDCLRAB, ARM64_MNEMONIC_LDCLRLB, ARM64_MNEMONIC_LDCLRALB,
+    ARM64_MNEMONIC_LDCLRH, ARM64_MNEMONIC_LDCLRAH, ARM64_MNEMONIC_LDCLRLH, ARM64_MNEMONIC_LDCLRALH,
+    ARM64_MNEMONIC_LDEOR, ARM64_MNEMONIC_LDEORA, ARM64_MNEMONIC_LDEORL, ARM64_MNEMONIC_LDEORAL,
+    ARM64_MNEMONIC_LDEORB, ARM64_MNEMONIC_LDEORAB, ARM64_MNEMONIC_LDEORLB, ARM64_MNEMONIC_LDEORALB,
+    ARM64_MNEMONIC_LDEORH, ARM64_MNEMONIC_LDEORAH, ARM64_MNEMONIC_LDEORLH, ARM64_MNEMONIC_LDEORALH,
+    ARM64_MNEMONIC_LDSET, ARM64_MNEMONIC_LDSETA, ARM64_MNEMONIC_LDSETL, ARM64_MNEMONIC_LDSETAL,
+    ARM64_MNEMONIC_LDSETB, ARM64_MNEMONIC_LDSETAB, ARM64_MNEMONIC_LDSETLB, ARM64_MNEMONIC_LDSETALB,
+    ARM64_MNEMONIC_LDSETH, ARM64_MNEMONIC_LDSETAH, ARM64_MNEMONIC_LDSETLH, ARM64_MNEMONIC_LDSETALH,
+    ARM64_MNEMONIC_LDSMAX, ARM64_MNEMONIC_LDSMAXA, ARM64_MNEMONIC_LDSMAXL, ARM64_MNEMONIC_LDSMAXAL,
+    ARM64_MNEMONIC_LDSMAXB, ARM64_MNEMONIC_LDSMAXAB, ARM64_MNEMONIC_LDSMAXLB,
+    ARM64_MNEMONIC_LDSMAXALB, ARM64_MNEMONIC_LDSMAXH, ARM64_MNEMONIC_LDSMAXAH,
+    ARM64_MNEMONIC_LDSMAXLH, ARM64_MNEMONIC_LDSMAXALH,
+    ARM64_MNEMONIC_LDSMIN, ARM64_MNEMONIC_LDSMINA, ARM64_MNEMONIC_LDSMINL, ARM64_MNEMONIC_LDSMINAL,
+    ARM64_MNEMONIC_LDSMINB, ARM64_MNEMONIC_LDSMINAB, ARM64_MNEMONIC_LDSMINLB,
+    ARM64_MNEMONIC_LDSMINALB, ARM64_MNEMONIC_LDSMINH, ARM64_MNEMONIC_LDSMINAH,
+    ARM64_MNEMONIC_LDSMINLH, ARM64_MNEMONIC_LDSMINALH,
+    ARM64_MNEMONIC_LDUMAX, ARM64_MNEMONIC_LDUMAXA, ARM64_MNEMONIC_LDUMAXL, ARM64_MNEMONIC_LDUMAXAL,
+    ARM64_MNEMONIC_LDUMAXB, ARM64_MNEMONIC_LDUMAXAB, ARM64_MNEMONIC_LDUMAXLB,
+    ARM64_MNEMONIC_LDUMAXALB, ARM64_MNEMONIC_LDUMAXH, ARM64_MNEMONIC_LDUMAXAH,
+    ARM64_MNEMONIC_LDUMAXLH, ARM64_MNEMONIC_LDUMAXALH,
+    ARM64_MNEMONIC_LDUMIN, ARM64_MNEMONIC_LDUMINA, ARM64_MNEMONIC_LDUMINL, ARM64_MNEMONIC_LDUMINAL,
+    ARM64_MNEMONIC_LDUMINB, ARM64_MNEMONIC_LDUMINAB, ARM64_MNEMONIC_LDUMINLB,
+    ARM64_MNEMONIC_LDUMINALB, ARM64_MNEMONIC_LDUMINH, ARM64_MNEMONIC_LDUMINAH,
+    ARM64_MNEMONIC_LDUMINLH, ARM64_MNEMONIC_LDUMINALH,
+    ARM64_MNEMONIC_SWP, ARM64_MNEMONIC_SWPA, ARM64_MNEMONIC_SWPL, ARM64_MNEMONIC_SWPAL,
+    ARM64_MNEMONIC_SWPB, ARM64_MNEMONIC_SWPAB, ARM64_MNEMONIC_SWPLB, ARM64_MNEMONIC_SWPALB,
+    ARM64_MNEMONIC_SWPH, ARM64_MNEMONIC_SWPAH, ARM64_MNEMONIC_SWPLH, ARM64_MNEMONIC_SWPALH,
+    ARM64_MNEMONIC_FMOV, ARM64_MNEMONIC_FABS, ARM64_MNEMONIC_FNEG, ARM64_MNEMONIC_FSQRT,
+    ARM64_MNEMONIC_FCVT, ARM64_MNEMONIC_FRINTN, ARM64_MNEMONIC_FRINTP, ARM64_MNEMONIC_FRINTM,
+    ARM64_MNEMONIC_FRINTZ, ARM64_MNEMONIC_FRINTA, ARM64_MNEMONIC_FRINTX, ARM64_MNEMONIC_FRINTI,
+    ARM64_MNEMONIC_FMUL, ARM64_MNEMONIC_FDIV, ARM64_MNEMONIC_FADD, ARM64_MNEMONIC_FSUB,
+    ARM64_MNEMONIC_FMAX, ARM64_MNEMONIC_FMIN, ARM64_MNEMONIC_FMAXNM, ARM64_MNEMONIC_FMINNM,
+    ARM64_MNEMONIC_FNMUL,
+    ARM64_MNEMONIC_FMADD, ARM64_MNEMONIC_FMSUB, ARM64_MNEMONIC_FNMADD, ARM64_MNEMONIC_FNMSUB,
+    ARM64_MNEMONIC_FCMP, ARM64_MNEMONIC_FCMPE, ARM64_MNEMONIC_FCCMP, ARM64_MNEMONIC_FCCMPE,
+    ARM64_MNEMONIC_FCSEL,
+    ARM64_MNEMONIC_FCVTNS, ARM64_MNEMONIC_FCVTNU, ARM64_MNEMONIC_FCVTPS, ARM64_MNEMONIC_FCVTPU,
+    ARM64_MNEMONIC_FCVTMS, ARM64_MNEMONIC_FCVTMU, ARM64_MNEMONIC_FCVTZS, ARM64_MNEMONIC_FCVTZU,
+    ARM64_MNEMONIC_SCVTF, ARM64_MNEMONIC_UCVTF, ARM64_MNEMONIC_FCVTAS, ARM64_MNEMONIC_FCVTAU,
+    ARM64_MNEMONIC_FJCVTZS,
+    
+    // Advanced SIMD
+    ARM64_MNEMONIC_SHADD, ARM64_MNEMONIC_SQADD, ARM64_MNEMONIC_SRHADD, ARM64_MNEMONIC_SHSUB,
+    ARM64_MNEMONIC_SQSUB, ARM64_MNEMONIC_CMGT, ARM64_MNEMONIC_CMGE, ARM64_MNEMONIC_SSHL,
+    ARM64_MNEMONIC_SQSHL, ARM64_MNEMONIC_SRSHL, ARM64_MNEMONIC_SQRSHL, ARM64_MNEMONIC_SMAX,
+    ARM64_MNEMONIC_SMIN, ARM64_MNEMONIC_SABD, ARM64_MNEMONIC_SABA, ARM64_MNEMONIC_ADD_V,
+    ARM64_MNEMONIC_CMTST, ARM64_MNEMONIC_MLA, ARM64_MNEMONIC_MUL_V, ARM64_MNEMONIC_SMAXP,
+    ARM64_MNEMONIC_SMINP, ARM64_MNEMONIC_SQDMULH, ARM64_MNEMONIC_ADDP,
+    ARM64_MNEMONIC_UHADD, ARM64_MNEMONIC_UQADD, ARM64_MNEMONIC_URHADD, ARM64_MNEMONIC_UHSUB,
+    ARM64_MNEMONIC_UQSUB, ARM64_MNEMONIC_CMHI, ARM64_MNEMONIC_CMHS, ARM64_MNEMONIC_USHL,
+    ARM64_MNEMONIC_UQSHL, ARM64_MNEMONIC_URSHL, ARM64_MNEMONIC_UQRSHL, ARM64_MNEMONIC_UMAX,
+    ARM64_MNEMONIC_UMIN, ARM64_MNEMONIC_UABD, ARM64_MNEMONIC_UABA, ARM64_MNEMONIC_SUB_V,
+    ARM64_MNEMONIC_CMEQ, ARM64_MNEMONIC_MLS, ARM64_MNEMONIC_PMUL, ARM64_MNEMONIC_UMAXP,
+    ARM64_MNEMONIC_UMINP, ARM64_MNEMONIC_SQRDMULH,
+    ARM64_MNEMONIC_AND_V, ARM64_MNEMONIC_BIC_V, ARM64_MNEMONIC_ORR_V, ARM64_MNEMONIC_ORN_V,
+    ARM64_MNEMONIC_EOR_V, ARM64_MNEMONIC_BSL, ARM64_MNEMONIC_BIT, ARM64_MNEMONIC_BIF,
+    ARM64_MNEMONIC_MOV_V, ARM64_MNEMONIC_MVN_V,
+    ARM64_MNEMONIC_REV64, ARM64_MNEMONIC_REV16_V, ARM64_MNEMONIC_REV32_V, ARM64_MNEMONIC_SADDLP,
+    ARM64_MNEMONIC_UADDLP, ARM64_MNEMONIC_SADALP, ARM64_MNEMONIC_UADALP, ARM64_MNEMONIC_SUQADD,
+    ARM64_MNEMONIC_USQADD, ARM64_MNEMONIC_CLS_V, ARM64_MNEMONIC_CLZ_V, ARM64_MNEMONIC_CNT,
+    ARM64_MNEMONIC_RBIT_V, ARM64_MNEMONIC_SQABS, ARM64_MNEMONIC_SQNEG, ARM64_MNEMONIC_ABS,
+    ARM64_MNEMONIC_NEG_V, ARM64_MNEMONIC_CMLT, ARM64_MNEMONIC_CMLE,
+    ARM64_MNEMONIC_XTN, ARM64_MNEMONIC_XTN2, ARM64_MNEMONIC_SQXTN, ARM64_MNEMONIC_SQXTN2,
+    ARM64_MNEMONIC_SQXTUN, ARM64_MNEMONIC_SQXTUN2, ARM64_MNEMONIC_UQXTN, ARM64_MNEMONIC_UQXTN2,
+    ARM64_MNEMONIC_SHLL, ARM64_MNEMONIC_SHLL2, ARM64_MNEMONIC_FCVTN, ARM64_MNEMONIC_FCVTN2,
+    ARM64_MNEMONIC_FCVTL, ARM64_MNEMONIC_FCVTL2, ARM64_MNEMONIC_FCVTXN, ARM64_MNEMONIC_FCVTXN2,
+    ARM64_MNEMONIC_FMLA, ARM64_MNEMONIC_FMLS, ARM64_MNEMONIC_FMULX, ARM64_MNEMONIC_FABD,
+    ARM64_MNEMONIC_FADDP, ARM64_MNEMONIC_FMAXP, ARM64_MNEMONIC_FMINP, ARM64_MNEMONIC_FMAXNMP,
+    ARM64_MNEMONIC_FMINNMP, ARM64_MNEMONIC_FCMEQ, ARM64_MNEMONIC_FCMGE, ARM64_MNEMONIC_FCMGT,
+    ARM64_MNEMONIC_FCMLE, ARM64_MNEMONIC_FCMLT, ARM64_MNEMONIC_FACGE, ARM64_MNEMONIC_FACGT,
+    ARM64_MNEMONIC_FRECPS, ARM64_MNEMONIC_FRSQRTS, ARM64_MNEMONIC_FRECPE, ARM64_MNEMONIC_FRSQRTE,
+    ARM64_MNEMONIC_FRECPX, ARM64_MNEMONIC_URECPE, ARM64_MNEMONIC_URSQRTE,
+    ARM64_MNEMONIC_SADDLV, ARM64_MNEMONIC_UADDLV, ARM64_MNEMONIC_SMAXV, ARM64_MNEMONIC_UMAXV,
+    ARM64_MNEMONIC_SMINV, ARM64_MNEMONIC_UMINV, ARM64_MNEMONIC_ADDV, ARM64_MNEMONIC_FMAXV,
+    ARM64_MNEMONIC_FMINV, ARM64_MNEMONIC_FMAXNMV, ARM64_MNEMONIC_FMINNMV,
+    ARM64_MNEMONIC_DUP, ARM64_MNEMONIC_SMOV, ARM64_MNEMONIC_UMOV, ARM64_MNEMONIC_MOVI,
+    ARM64_MNEMONIC_MVNI,
+    ARM64_MNEMONIC_SSHR, ARM64_MNEMONIC_USHR, ARM64_MNEMONIC_SSRA, ARM64_MNEMONIC_USRA,
+    ARM64_MNEMONIC_SRSHR, ARM64_MNEMONIC_URSHR, ARM64_MNEMONIC_SRSRA, ARM64_MNEMONIC_URSRA,
+    ARM64_MNEMONIC_SHL, ARM64_MNEMONIC_SLI, ARM64_MNEMONIC_SRI, ARM64_MNEMONIC_SQSHLU,
+    ARM64_MNEMONIC_SHRN, ARM64_MNEMONIC_SHRN2, ARM64_MNEMONIC_RSHRN, ARM64_MNEMONIC_RSHRN2,
+    ARM64_MNEMONIC_SQSHRN, ARM64_MNEMONIC_SQSHRN2, ARM64_MNEMONIC_SQRSHRN, ARM64_MNEMONIC_SQRSHRN2,
+    ARM64_MNEMONIC_SQSHRUN, ARM64_MNEMONIC_SQSHRUN2, ARM64_MNEMONIC_SQRSHRUN,
+    ARM64_MNEMONIC_SQRSHRUN2, ARM64_MNEMONIC_UQSHRN, ARM64_MNEMONIC_UQSHRN2,
+    ARM64_MNEMONIC_UQRSHRN, ARM64_MNEMONIC_UQRSHRN2, ARM64_MNEMONIC_SSHLL, ARM64_MNEMONIC_SSHLL2,
+    ARM64_MNEMONIC_USHLL, ARM64_MNEMONIC_USHLL2, ARM64_MNEMONIC_SXTL, ARM64_MNEMONIC_SXTL2,
+    ARM64_MNEMONIC_UXTL, ARM64_MNEMONIC_UXTL2,
+    ARM64_MNEMONIC_SADDL, ARM64_MNEMONIC_SADDL2, ARM64_MNEMONIC_UADDL, ARM64_MNEMONIC_UADDL2,
+    ARM64_MNEMONIC_SADDW, ARM64_MNEMONIC_SADDW2, ARM64_MNEMONIC_UADDW, ARM64_MNEMONIC_UADDW2,
+    ARM64_MNEMONIC_SSUBL, ARM64_MNEMONIC_SSUBL2, ARM64_MNEMONIC_USUBL, ARM64_MNEMONIC_USUBL2,
+    ARM64_MNEMONIC_SSUBW, ARM64_MNEMONIC_SSUBW2, ARM64_MNEMONIC_USUBW, ARM64_MNEMONIC_USUBW2,
+    ARM64_MNEMONIC_ADDHN, ARM64_MNEMONIC_ADDHN2, ARM64_MNEMONIC_RADDHN, ARM64_MNEMONIC_RADDHN2,
+    ARM64_MNEMONIC_SUBHN, ARM64_MNEMONIC_SUBHN2, ARM64_MNEMONIC_RSUBHN, ARM64_MNEMONIC_RSUBHN2,
+    ARM64_MNEMONIC_SABAL, ARM64_MNEMONIC_SABAL2, ARM64_MNEMONIC_UABAL, ARM64_MNEMONIC_UABAL2,
+    ARM64_MNEMONIC_SABDL, ARM64_MNEMONIC_SABDL2, ARM64_MNEMONIC_UABDL, ARM64_MNEMONIC_UABDL2,
+    ARM64_MNEMONIC_SMLAL, ARM64_MNEMONIC_SMLAL2, ARM64_MNEMONIC_UMLAL, ARM64_MNEMONIC_UMLAL2,
+    ARM64_MNEMONIC_SMLSL, ARM64_MNEMONIC_SMLSL2, ARM64_MNEMONIC_UMLSL, ARM64_MNEMONIC_UMLSL2,
+    ARM64_MNEMONIC_SMULL_V, ARM64_MNEMONIC_SMULL2, ARM64_MNEMONIC_UMULL_V, ARM64_MNEMONIC_UMULL2,
+    ARM64_MNEMONIC_SQDMLAL, ARM64_MNEMONIC_SQDMLAL2, ARM64_MNEMONIC_SQDMLSL,
+    ARM64_MNEMONIC_SQDMLSL2, ARM64_MNEMONIC_SQDMULL, ARM64_MNEMONIC_SQDMULL2, ARM64_MNEMONIC_PMULL,
+    ARM64_MNEMONIC_PMULL2,
+    ARM64_MNEMONIC_UZP1, ARM64_MNEMONIC_TRN1, ARM64_MNEMONIC_ZIP1, ARM64_MNEMONIC_UZP2,
+    ARM64_MNEMONIC_TRN2, ARM64_MNEMONIC_ZIP2, ARM64_MNEMONIC_EXT, ARM64_MNEMONIC_TBL,
+    ARM64_MNEMONIC_TBX,
+    ARM64_MNEMONIC_LD1, ARM64_MNEMONIC_LD2, ARM64_MNEMONIC_LD3, ARM64_MNEMONIC_LD4,
+    ARM64_MNEMONIC_ST1, ARM64_MNEMONIC_ST2, ARM64_MNEMONIC_ST3, ARM64_MNEMONIC_ST4,
+    ARM64_MNEMONIC_LD1R, ARM64_MNEMONIC_LD2R, ARM64_MNEMONIC_LD3R, ARM64_MNEMONIC_LD4R,
+    ARM64_MNEMONIC_AESE, ARM64_MNEMONIC_AESD, ARM64_MNEMONIC_AESMC, ARM64_MNEMONIC_AESIMC,
+    ARM64_MNEMONIC_SHA1C, ARM64_MNEMONIC_SHA1P, ARM64_MNEMONIC_SHA1M, ARM64_MNEMONIC_SHA1SU0,
+    ARM64_MNEMONIC_SHA256H, ARM64_MNEMONIC_SHA256H2, ARM64_MNEMONIC_SHA256SU1,
+    ARM64_MNEMONIC_SHA1H, ARM64_MNEMONIC_SHA1SU1, ARM64_MNEMONIC_SHA256SU0,
+    ARM64_MNEMONIC_SIMD,
+    ARM64_MNEMONIC_WORD,
+    ARM64_MNEMONIC_COUNT
+} ARM64Mnemonic;
+
+// Kinds of ARM64DecodedOperand
+enum {
+    ARM64_OPND_NONE,
+    ARM64_OPND_REG,
+    ARM64_OPND_IMM,
+    
+    // imm holds the bits of a logical or 64-bit vector immediate, which are
+    // shown unsigned
+    ARM64_OPND_BITMASK,
+    
+    // imm holds the bits of a double
+    ARM64_OPND_FP_IMM,
+    
+    // Base register in reg, see ARM64_MEM_* for the rest
+    ARM64_OPND_MEM,
+    
+    // imm is the displacement from the instruction (branches, ADR)
+    ARM64_OPND_LABEL,
+    
+    // imm is the displacement from the instruction's 4KB page (ADRP)
+    ARM64_OPND_PAGE,
+    
+    // Condition code 0-15 in imm
+    ARM64_OPND_COND,
+    
+    // MRS/MSR register, op0:op1:CRn:CRm:op2 in imm
+    ARM64_OPND_SYSREG,
+    
+    // MSR (immediate) PSTATE field, op1:op2 in imm
+    ARM64_OPND_PSTATE,
+    
+    // DMB/DSB option (CRm) in imm
+    ARM64_OPND_BARRIER,
+    
+    // SYS/SYSL operation, op1:CRn:CRm:op2 in imm
+    ARM64_OPND_SYS_OP,
+    
+    // PRFM/PRFUM operation (the Rt field) in imm
+    ARM64_OPND_PREFETCH,
+    
+    // count consecutive V registers from reg, wrapping after V31, of one
+    // arrangement (and lane)
+    ARM64_OPND_REG_LIST
+};
+
+// Register classes. Register 31 is the zero register in W and X and the
+// stack pointer in WSP and SP.
+enum {
+    ARM64_REG_W,
+    ARM64_REG_X,
+    ARM64_REG_WSP,
+    ARM64_REG_SP,
+    ARM64_REG_B,
+    ARM64_REG_H,
+    ARM64_REG_S,
+    ARM64_REG_D,
+    ARM64_REG_Q,
+    
+    // Advanced SIMD register, see arrangement and lane
+    ARM64_REG_V
+};
+
+// Arrangements of V registers: whole vectors by element size and count, then
+// the single elements, which also have a lane
+enum {
+    ARM64_VEC_NONE,
+    ARM64_VEC_8B,
+    ARM64_VEC_16B,
+    ARM64_VEC_4H,
+    ARM64_VEC_8H,
+    ARM64_VEC_2S,
+    ARM64_VEC_4S,
+    ARM64_VEC_1D,
+    ARM64_VEC_2D,
+    ARM64_VEC_1Q,
+    ARM64_VEC_B,
+    ARM64_VEC_H,
+    ARM64_VEC_S,
+    ARM64_VEC_D
+};
+
+// Addressing modes of ARM64_OPND_MEM; imm is the offset
+enum {
+    ARM64_MEM_OFFSET,
+    ARM64_MEM_PRE_INDEX,
+    ARM64_MEM_POST_INDEX,
+    
+    // Index register in index, of class reg_class, extended or shifted
+    ARM64_MEM_REG_OFFSET,
+    
+    // Literal pool; imm is the displacement from the instruction
+    ARM64_MEM_LITERAL,
+    
+    // Post-indexed by the X register in index (structure loads and stores)
+    ARM64_MEM_POST_INDEX_REG
+};
+
+// Access bits of ARM64DecodedOperand
+enum {
+    ARM64_READ = 1 << 0,
+    ARM64_WRITE = 1 << 1
+};
+
+// Shift or extend of a register operand, a memory index or an immediate
+enum {
+    ARM64_SHIFT_NONE,
+    ARM64_SHIFT_LSL,
+    ARM64_SHIFT_LSR,
+    ARM64_SHIFT_ASR,
+    ARM64_SHIFT_ROR,
+    ARM64_EXTEND_UXTB,
+    ARM64_EXTEND_UXTH,
+    ARM64_EXTEND_UXTW,
+    ARM64_EXTEND_UXTX,
+    ARM64_EXTEND_SXTB,
+    ARM64_EXTEND_SXTH,
+    ARM64_EXTEND_SXTW,
+    ARM64_EXTEND_SXTX,
+    
+    // Shift left inserting ones (MOVI, MVNI)
+    ARM64_SHIFT_MSL
+};
+
 typedef struct {
-    MachOContext *macho_ctx;
+    uint8_t kind;
+    uint8_t reg_class;
+    
+    // REG: the register; MEM: the base register (X or SP)
+    uint8_t reg;
+    
+    // MEM: the index register of ARM64_MEM_REG_OFFSET and POST_INDEX_REG
+    uint8_t index;
+    
+    uint8_t addressing;
+    uint8_t shift;
+    uint8_t shift_amount;
+    
+    // MEM: bytes transferred per register
+    uint8_t access_size;
+    
+    // ARM64_READ/ARM64_WRITE: of the register for REG, of memory for MEM
+    uint8_t access;
+    
+    // V registers: ARM64_VEC_*, and the lane of a single element
+    uint8_t arrangement;
+    uint8_t lane;
+    
+    // REG_LIST: the number of registers
+    uint8_t count;
+    
+    int64_t imm;
+} ARM64DecodedOperand;
+
+// Result of arm64_decode_word(). Nothing is formatted here: the text form is
+// produced from these fields only when a row is rendered by disasm_arm64().
+typedef struct {
+    // ARM64Mnemonic
+    uint16_t mnemonic;
+    
+    uint8_t category;
+    uint8_t branch_type;
+    
+    // INST_FLAG_* bits, as they are stored
+    uint8_t flags;
+    
+    // Of B.cond and the conditional select/compare family (after alias
+    // inversion, as displayed); 14 (AL) for everything else
+    uint8_t condition;
+    
+    // Slots past operand_count are left as they were
+    uint8_t operand_count;
+    ARM64DecodedOperand operands[ARM64_MAX_OPERANDS];
+    
+    // Displacement of a direct branch (INST_FLAG_HAS_BRANCH_TARGET)
+    int32_t branch_delta;
+    
+    // General purpose registers, bit 31 being SP; the zero register and the
+    // FP/SIMD registers are not tracked
+    uint32_t regs_read;
+    uint32_t regs_written;
+} ARM64DecodedWord;
+
+#pragma mark - x86_64 Structured Decoding
+
+#define X86_MAX_INSTRUCTION_LENGTH 15
+#define X86_MAX_OPERANDS 4
+
+// Mnemonics produced by x86_64_decode(). Families decoded from one opcode
+// are laid out in encoding order: the ALU and shift groups by the ModRM
+// reg field, Jcc/CMOVcc/SETcc by condition code, string instructions
+// by operand size and the named SSE instructions by mandatory prefix (none,
+// 66, F3, F2).
+typedef enum {
+    X86_MNEMONIC_ADD, X86_MNEMONIC_OR, X86_MNEMONIC_ADC, X86_MNEMONIC_SBB,
+    X86_MNEMONIC_AND, X86_MNEMONIC_SUB, X86_MNEMONIC_XOR, X86_MNEMONIC_CMP,
+    X86_MNEMONIC_ROL, X86_MNEMONIC_ROR, X86_MNEMONIC_RCL, X86_MNEMONIC_RCR,
+    X86_MNEMONIC_SHL, X86_MNEMONIC_SHR, X86_MNEMONIC_SAL, X86_MNEMONIC_SAR,
+    X86_MNEMONIC_TEST, X86_MNEMONIC_NOT, X86_MNEMONIC_NEG,
+    X86_MNEMONIC_MUL, X86_MNEMONIC_IMUL, X86_MNEMONIC_DIV, X86_MNEMONIC_IDIV,
+    X86_MNEMONIC_INC, X86_MNEMONIC_DEC, X86_MNEMONIC_CALL, X86_MNEMONIC_CALLF,
+    X86_MNEMONIC_JMP, X86_MNEMONIC_JMPF, X86_MNEMONIC_PUSH, X86_MNEMONIC_POP,
+    X86_MNEMONIC_JO, X86_MNEMONIC_JNO, X86_MNEMONIC_JB, X86_MNEMONIC_JAE,
+    X86_MNEMONIC_JE, X86_MNEMONIC_JNE, X86_MNEMONIC_JBE, X86_MNEMONIC_JA,
+    X86_MNEMONIC_JS, X86_MNEMONIC_JNS, X86_MNEMONIC_JP, X86_MNEMONIC_JNP,
+    X86_MNEMONIC_JL, X86_MNEMONIC_JGE, X86_MNEMONIC_JLE, X86_MNEMONIC_JG,
+    X86_MNEMONIC_CMOVO, X86_MNEMONIC_CMOVNO, X86_MNEMONIC_CMOVB, X86_MNEMONIC_CMOVAE,
+    X86_MNEMONIC_CMOVE, X86_MNEMONIC_CMOVNE, X86_MNEMONIC_CMOVBE, X86_MNEMONIC_CMOVA,
+    X86_MNEMONIC_CMOVS, X86_MNEMONIC_CMOVNS, X86_MNEMONIC_CMOVP, X86_MNEMONIC_CMOVNP,
+    X86_MNEMONIC_CMOVL, X86_MNEMONIC_CMOVGE, X86_MNEMONIC_CMOVLE, X86_MNEMONIC_CMOVG,
+    X86_MNEMONIC_SETO, X86_MNEMONIC_SETNO, X86_MNEMONIC_SETB, X86_MNEMONIC_SETAE,
+    X86_MNEMONIC_SETE, X86_MNEMONIC_SETNE, X86_MNEMONIC_SETBE, X86_MNEMONIC_SETA,
+    X86_MNEMONIC_SETS, X86_MNEMONIC_SETNS, X86_MNEMONIC_SETP, X86_MNEMONIC_SETNP,
+    X86_MNEMONIC_SETL, X86_MNEMONIC_SETGE, X86_MNEMONIC_SETLE, X86_MNEMONIC_SETG,
+    X86_MNEMONIC_MOVSB, X86_MNEMONIC_MOVSW, X86_MNEMONIC_MOVSD, X86_MNEMONIC_MOVSQ,
+    X86_MNEMONIC_CMPSB, X86_MNEMONIC_CMPSW, X86_MNEMONIC_CMPSD, X86_MNEMONIC_CMPSQ,
+    X86_MNEMONIC_STOSB, X86_MNEMONIC_STOSW, X86_MNEMONIC_STOSD, X86_MNEMONIC_STOSQ,
+    X86_MNEMONIC_LODSB, X86_MNEMONIC_LODSW, X86_MNEMONIC_LODSD, X86_MNEMONIC_LODSQ,
+    X86_MNEMONIC_SCASB, X86_MNEMONIC_SCASW, X86_MNEMONIC_SCASD, X86_MNEMONIC_SCASQ,
+    X86_MNEMONIC_INSB, X86_MNEMONIC_INSW, X86_MNEMONIC_INSD,
+    X86_MNEMONIC_OUTSB, X86_MNEMONIC_OUTSW, X86_MNEMONIC_OUTSD,
+    X86_MNEMONIC_MOV, X86_MNEMONIC_MOVSX, X86_MNEMONIC_MOVZX, X86_MNEMONIC_MOVSXD,
+    X86_MNEMONIC_LEA, X86_MNEMONIC_XCHG, X86_MNEMONIC_NOP, X86_MNEMONIC_PAUSE,
+    X86_MNEMONIC_CBW, X86_MNEMONIC_CWDE, X86_MNEMONIC_CDQE,
+    X86_MNEMONIC_CWD, X86_MNEMONIC_CDQ, X86_MNEMONIC_CQO,
+    X86_MNEMONIC_PUSHF, X86_MNEMONIC_POPF, X86_MNEMONIC_SAHF, X86_MNEMONIC_LAHF,
+    X86_MNEMONIC_XLAT, X86_MNEMONIC_ENTER, X86_MNEMONIC_LEAVE,
+    X86_MNEMONIC_RET, X86_MNEMONIC_RETF, X86_MNEMONIC_IRET,
+    X86_MNEMONIC_LOOPNE, X86_MNEMONIC_LOOPE, X86_MNEMONIC_LOOP, X86_MNEMONIC_JRCXZ,
+    X86_MNEMONIC_CMC, X86_MNEMONIC_CLC, X86_MNEMONIC_STC, X86_MNEMONIC_CLI,
+    X86_MNEMONIC_STI, X86_MNEMONIC_CLD, X86_MNEMONIC_STD,
+    X86_MNEMONIC_BT, X86_MNEMONIC_BTS, X86_MNEMONIC_BTR, X86_MNEMONIC_BTC,
+    X86_MNEMONIC_BSF, X86_MNEMONIC_BSR, X86_MNEMONIC_TZCNT, X86_MNEMONIC_LZCNT,
+    X86_MNEMONIC_POPCNT, X86_MNEMONIC_BSWAP, X86_MNEMONIC_SHLD, X86_MNEMONIC_SHRD,
+    X86_MNEMONIC_CMPXCHG, X86_MNEMONIC_XADD, X86_MNEMONIC_MOVNTI,
+    X86_MNEMONIC_PREFETCH, X86_MNEMONIC_PREFETCHW, X86_MNEMONIC_ENDBR64,
+    X86_MNEMONIC_INT3, X86_MNEMONIC_INT, X86_MNEMONIC_INT1, X86_MNEMONIC_HLT,
+    X86_MNEMONIC_IN, X86_MNEMONIC_OUT, X86_MNEMONIC_WAIT,
+    X86_MNEMONIC_SYSCALL, X86_MNEMONIC_SYSRET, X86_MNEMONIC_CPUID, X86_MNEMONIC_RDTSC,
+    X86_MNEMONIC_UD2, X86_MNEMONIC_UD1, X86_MNEMONIC_UD0,
+    X86_MNEMONIC_MOVUPS, X86_MNEMONIC_MOVUPD, X86_MNEMONIC_MOVSS, X86_MNEMONIC_MOVSD_XMM,
+    X86_MNEMONIC_SQRTPS, X86_MNEMONIC_SQRTPD, X86_MNEMONIC_SQRTSS, X86_MNEMONIC_SQRTSD,
+    X86_MNEMONIC_ADDPS, X86_MNEMONIC_ADDPD, X86_MNEMONIC_ADDSS, X86_MNEMONIC_ADDSD,
+    X86_MNEMONIC_MULPS, X86_MNEMONIC_MULPD, X86_MNEMONIC_MULSS, X86_MNEMONIC_MULSD,
+    X86_MNEMONIC_CVTPS2PD, X86_MNEMONIC_CVTPD2PS, X86_MNEMONIC_CVTSS2SD, X86_MNEMONIC_CVTSD2SS,
+    X86_MNEMONIC_SUBPS, X86_MNEMONIC_SUBPD, X86_MNEMONIC_SUBSS, X86_MNEMONIC_SUBSD,
+    X86_MNEMONIC_MINPS, X86_MNEMONIC_MINPD, X86_MNEMONIC_MINSS, X86_MNEMONIC_MINSD,
+    X86_MNEMONIC_DIVPS, X86_MNEMONIC_DIVPD, X86_MNEMONIC_DIVSS, X86_MNEMONIC_DIVSD,
+    X86_MNEMONIC_MAXPS, X86_MNEMONIC_MAXPD, X86_MNEMONIC_MAXSS, X86_MNEMONIC_MAXSD,
+    X86_MNEMONIC_MOVAPS, X86_MNEMONIC_MOVAPD, X86_MNEMONIC_UCOMISS, X86_MNEMONIC_UCOMISD,
+    X86_MNEMONIC_COMISS, X86_MNEMONIC_COMISD, X86_MNEMONIC_ANDPS, X86_MNEMONIC_ANDPD,
+    X86_MNEMONIC_ANDNPS, X86_MNEMONIC_ANDNPD, X86_MNEMONIC_ORPS, X86_MNEMONIC_ORPD,
+    X86_MNEMONIC_XORPS, X86_MNEMONIC_XORPD,
+    X86_MNEMONIC_CVTSI2SS, X86_MNEMONIC_CVTSI2SD, X86_MNEMONIC_CVTTSS2SI, X86_MNEMONIC_CVTTSD2SI,
+    X86_MNEMONIC_CVTSS2SI, X86_MNEMONIC_CVTSD2SI,
+    X86_MNEMONIC_MOVD, X86_MNEMONIC_MOVQ, X86_MNEMONIC_MOVDQA, X86_MNEMONIC_MOVDQU,
+    X86_MNEMONIC_PXOR,
+    
+    // x87 instructions (D8-DF)
+    X86_MNEMONIC_FPU,
+    
+    // Other SSE/MMX, SSSE3+ (0F 38, 0F 3A) and VEX, EVEX or XOP encodings:
+    // length and branch behaviour are exact, the name is not
+    X86_MNEMONIC_SIMD,
+    
+    // Valid but unnamed, mostly system instructions (0F 00, 0F 01, LAR...)
+    X86_MNEMONIC_OPCODE,
+    
+    // Byte that does not start a valid instruction; one byte long
+    X86_MNEMONIC_BYTE,
+    X86_MNEMONIC_COUNT
+} X86Mnemonic;
+
+// Kinds of X86DecodedOperand
+enum {
+    X86_OPND_NONE,
+    X86_OPND_REG,
+    X86_OPND_IMM,
+    
+    // [segment: base + index * scale + imm]; base may be X86_REG_RIP
+    X86_OPND_MEM,
+    
+    // imm is the displacement from the instruction (direct branches)
+    X86_OPND_LABEL
+};
+
+// Register classes
+enum {
+    X86_REG_GPR,
+    
+    // AH, CH, DH, BH: byte registers 4-7 without a REX prefix
+    X86_REG_GPR8_HIGH,
+    X86_REG_SEGMENT,
+    X86_REG_XMM,
+    X86_REG_MMX
+};
+
+// Special base and index values of X86_OPND_MEM
+#define X86_REG_RIP 16
+#define X86_REG_NONE 0xFF
+
+// Access bits of X86DecodedOperand
+enum {
+    X86_READ = 1 << 0,
+    X86_WRITE = 1 << 1
+};
+
+// Prefixes that change what an instruction does, as displayed
+enum {
+    X86_PREFIX_NONE,
+    X86_PREFIX_LOCK,
+    X86_PREFIX_REP,
+    X86_PREFIX_REPE,
+    X86_PREFIX_REPNE,
+    X86_PREFIX_COUNT
+};
+
+typedef struct {
+    uint8_t kind;
+    uint8_t reg_class;
+    
+    // REG: the register; MEM: the base register, X86_REG_RIP or X86_REG_NONE
+    uint8_t reg;
+    
+    // MEM: the index register or X86_REG_NONE, and its scale (1, 2, 4, 8)
+    uint8_t index;
+    uint8_t scale;
+    
+    // MEM: 0, or 1 + the segment register of an FS or GS override
+    uint8_t segment;
+    
+    // Bytes of the register, of the immediate or of memory accessed
+    uint8_t size;
+    
+    // X86_READ/X86_WRITE: of the register for REG, of memory for MEM
+    uint8_t access;
+    
+    // IMM: the value, zero-extended from size, sign-extended for 8-byte
+    // operations; MEM: the displacement, from the start of the instruction for
+    // X86_REG_RIP (like LABEL); LABEL: see X86_OPND_LABEL
+    int64_t imm;
+} X86DecodedOperand;
+
+// Result of x86_64_decode(). As for ARM64DecodedWord, nothing is formatted
+// here; disasm_x86_64() renders these fields on demand.
+typedef struct {
+    // X86Mnemonic
+    uint16_t mnemonic;
+    
+    // 1-15 bytes
+    uint8_t length;
+    
+    uint8_t category;
+    uint8_t branch_type;
+    
+    // INST_FLAG_* bits, as they are stored
+    uint8_t flags;
+    
+    // X86_PREFIX_*
+    uint8_t prefix;
+    
+    // Slots past operand_count are left as they were
+    uint8_t operand_count;
+    X86DecodedOperand operands[X86_MAX_OPERANDS];
+    
+    // Displacement of a direct branch (INST_FLAG_HAS_BRANCH_TARGET) from the
+    // start of the instruction
+    int32_t branch_delta;
+    
+    // General purpose registers, bit n being register n (RAX = 0 ... R15 =
+    // 15), whatever the operand size
+    uint32_t regs_read;
+    uint32_t regs_written;
+} X86DecodedInstruction;
+
+#pragma mark - Code Sections
+
+// A loaded section; offset is relative to code_data
+typedef struct {
+    char name[17];
+    uint64_t address;
+    uint64_t offset;
+    uint64_t size;
+} DisassemblySection;
+
+// A symbol stub and the imported symbol it jumps to. name aliases the string
+// table of the mapping and stays valid until macho_close().
+typedef struct {
+    uint64_t address;
+    uint32_t size;
+    const char *name;
+} DisassemblyStub;
+
+typedef struct {
+    const MachOContext *macho_ctx;
     Architecture arch;
     
-    uint8_t *code_data;
+    const uint8_t *code_data;
     uint64_t code_size;
     uint64_t code_base_addr;
     uint64_t current_offset;
     
-    DisassembledInstruction *instructions;
+    // Sections covered by code_data, by address. Sweeps decode these and skip
+    // the bytes between them; a context with none decodes all of code_data.
+    DisassemblySection *sections;
+    uint32_t section_count;
+    
+    // By address, from disasm_load_executable()
+    DisassemblyStub *stubs;
+    uint32_t stub_count;
+    
+    InstructionStore store;
     uint32_t instruction_count;
-    uint32_t instruction_capacity;
     
 } DisassemblyContext;
 
 #pragma mark - Function Declarations
 
-DisassemblyContext* disasm_create(MachOContext *macho_ctx);
+DisassemblyContext* disasm_create(const MachOContext *macho_ctx);
 
 bool disasm_load_section(DisassemblyContext *ctx, const char *section_name);
 
+// Loads every section holding instructions (__text, __stubs, __auth_stubs,
+// __stub_helper...) of the segment of __text as one view: code_data spans
+// them, and rows and addresses run across all of them. Symbol stubs are
+// resolved to their imported symbols through the indirect symbol table in the
+// same pass. Returns false when there is no code section.
+bool disasm_load_executable(DisassemblyContext *ctx);
+
+// Loaded section holding address, or NULL
+const DisassemblySection* disasm_section_for_address(const DisassemblyContext *ctx, uint64_t address);
+
+// Imported symbol reached through the stub holding address, or NULL
+const char* disasm_stub_name(const DisassemblyContext *ctx, uint64_t address);
+
 bool disasm_instruction(DisassemblyContext *ctx, DisassembledInstruction *inst);
 
 uint32_t disasm_range(DisassemblyContext *ctx, uint64_t start_addr, uint64_t end_addr);
 
 uint32_t disasm_all(DisassemblyContext *ctx);
 
+// disasm_all() split across thread_count threads (0 uses every online core).
+// Only fixed-width ARM64 code is split; the result is identical to the serial
+// sweep, opcode ids included. Loaded sections are swept one after the other.
+// disasm_all() uses it for all ARM64 code, on one thread below
+// DISASM_PARALLEL_THRESHOLD.
+uint32_t disasm_all_parallel(DisassemblyContext *ctx, uint32_t thread_count);
+
 bool disasm_arm64(uint32_t bytes, uint64_t address, DisassembledInstruction *inst);
 
+// Reads up to X86_MAX_INSTRUCTION_LENGTH bytes; near the end of a buffer,
+// decode with x86_64_decode() and the bytes actually available instead
 bool disasm_x86_64(const uint8_t *bytes, uint64_t address, DisassembledInstruction *inst);
 
 uint32_t disasm_detect_functions(DisassemblyContext *ctx);
 
-int32_t disasm_find_by_address(DisassemblyContext *ctx, uint64_t address);
+// Address to row lookups: O(1) for contiguous fixed-width rows, a binary
+// search over the offsets column otherwise.
+// Row of the instruction starting at address, or -1
+int32_t disasm_find_by_address(const DisassemblyContext *ctx, uint64_t address);
+// First row at or after address (instruction_count if there is none)
+uint32_t disasm_index_at_or_after(const DisassemblyContext *ctx, uint64_t address);
+
+#pragma mark - Instruction Access
+
+// Renders row index in full (text included) by decoding its bytes again, then
+// applies the stored metadata, which may have been refined after decoding.
+// Branches into a stub get the imported symbol's name as their comment.
+bool disasm_get(const DisassemblyContext *ctx, uint32_t index, DisassembledInstruction *inst);
+
+uint64_t disasm_address_at(const DisassemblyContext *ctx, uint32_t index);
+
+uint8_t disasm_length_at(const DisassemblyContext *ctx, uint32_t index);
+
+BranchType disasm_branch_type_at(const DisassemblyContext *ctx, uint32_t index);
+
+// Returns false when the row has no direct branch target
+bool disasm_branch_target_at(const DisassemblyContext *ctx, uint32_t index, uint64_t *target);
+
+const char* disasm_mnemonic_at(const DisassemblyContext *ctx, uint32_t index);
+
+// Appends the compact form of inst. Callers decoding in bulk should reserve
+// first; disasm_all() and disasm_range() do.
+bool disasm_store_reserve(DisassemblyContext *ctx, uint32_t capacity);
+
+bool disasm_store_append(DisassemblyContext *ctx, const DisassembledInstruction *inst);
+
+void disasm_store_clear(DisassemblyContext *ctx);
 
 const char* disasm_category_string(InstructionCategory category);
 
@@ -113,9 +833,70 @@ const char* arm64_register_name(uint8_t reg, bool is_64bit);
 
 const char* arm64_condition_string(uint8_t cond);
 
-bool arm64_is_prologue(const DisassembledInstruction *inst);
+// Table-driven decode of one instruction word. Safe to call from any thread.
+void arm64_decode_word(uint32_t bytes, ARM64DecodedWord *out);
+
+const char* arm64_mnemonic_name(uint16_t mnemonic);
+
+// Address referenced by a LABEL, PAGE or literal MEM operand of the
+// instruction at address; false for any other operand
+bool arm64_operand_address(const ARM64DecodedOperand *operand, uint64_t address, uint64_t *out_address);
+
+// Text of one operand and of the whole operand list, as disasm_arm64() shows
+// them. Both write into buffer and are safe to call from any thread.
+size_t arm64_format_operand(const ARM64DecodedOperand *operand, uint64_t address, char *buffer, size_t buffer_size);
+
+size_t arm64_format_operands(const ARM64DecodedWord *decoded, uint64_t address, char *buffer, size_t buffer_size);
+
+#pragma mark - x86_64 Specific Helpers
+
+// Table-driven decode of the instruction at bytes, reading at most available
+// bytes (and never more than 15). Bytes that do not start a valid instruction,
+// or one cut short by the end of the buffer, decode as a one-byte
+// X86_MNEMONIC_BYTE, so a sweep always makes progress. Returns the length.
+// Safe to call from any thread.
+uint8_t x86_64_decode(const uint8_t *bytes, size_t available, X86DecodedInstruction *out);
+
+// Length only, from the opcode tables alone: no operands are built. Same
+// result as x86_64_decode()'s length.
+uint8_t x86_64_instruction_length(const uint8_t *bytes, size_t available);
+
+const char* x86_64_mnemonic_name(uint16_t mnemonic);
+
+// Mnemonic with its displayed prefix ("REP STOSQ", "LOCK CMPXCHG"), then the
+// operands in Intel syntax, as disasm_x86_64() shows them
+size_t x86_64_format_mnemonic(const X86DecodedInstruction *decoded, char *buffer, size_t buffer_size);
+
+size_t x86_64_format_operands(const X86DecodedInstruction *decoded, uint64_t address, char *buffer, size_t buffer_size);
+
+#pragma mark - ARM64 References
+
+typedef enum {
+    ARM64_REF_CALL,
+    ARM64_REF_JUMP,
+    ARM64_REF_CONDITIONAL_JUMP,
+    ARM64_REF_DATA_READ,
+    ARM64_REF_DATA_WRITE,
+    ARM64_REF_ADDRESS_LOAD
+} ARM64ReferenceKind;
+
+typedef struct {
+    uint64_t from_address;
+    uint64_t to_address;
+    
+    // Row of the referencing instruction
+    uint32_t index;
+    
+    // ARM64ReferenceKind
+    uint8_t kind;
+} ARM64Reference;
 
-bool arm64_is_epilogue(const DisassembledInstruction *inst);
+// References made by the ARM64 rows of the store: direct branches from the
+// stored columns, and the addresses formed by ADR, ADRP, literal loads and
+// ADRP followed by ADD, LDR or STR. Register values are followed through the
+// typed operands within a function, never through the rendered text.
+// Returns a malloc'd array of *out_count entries, NULL when there are none.
+ARM64Reference* disasm_collect_references(const DisassemblyContext *ctx, uint32_t *out_count);
 
 #endif
 
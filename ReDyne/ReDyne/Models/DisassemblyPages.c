@@ -0,0 +1,431 @@
+#include "DisassemblyPages.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+typedef struct PageSlot {
+    // First so a DisassemblyPage handed out converts back to its slot
+    DisassemblyPage page;
+    
+    uint32_t pins;
+    bool ready;
+    
+    // Dropped from the cache while pinned because the page before it moved
+    // its start; freed on the last release
+    bool stale;
+    
+    // Decoded pages, most recently used first
+    struct PageSlot *lru_prev;
+    struct PageSlot *lru_next;
+} PageSlot;
+
+struct DisassemblyPageCache {
+    // The code as disasm_load_executable() loads it, without rows. Its
+    // sections and stubs are lent to every page.
+    DisassemblyContext *section;
+    uint32_t page_count;
+    uint32_t max_pages;
+    
+    // By page index; NULL until the page is first requested and again once
+    // it is evicted. A slot that is not ready is being decoded.
+    PageSlot **slots;
+    uint32_t resident;
+    PageSlot *lru_head;
+    PageSlot *lru_tail;
+    
+    // x86_64 only: offset of the first instruction of each page, learnt from
+    // the end of the latest decode of the page before it (0 while unknown)
+    uint64_t *sync_offsets;
+    
+    pthread_mutex_t lock;
+    pthread_cond_t page_decoded;
+    
+    pthread_t prefetch_thread;
+    bool has_prefetch_thread;
+    bool stopping;
+    pthread_cond_t prefetch_wake;
+    uint32_t prefetch_next;
+    uint32_t prefetch_end;
+};
+
+#pragma mark - Lifecycle
+
+DisassemblyPageCache* disasm_pages_create(const MachOContext *macho_ctx, uint32_t max_pages) {
+    DisassemblyContext *section = disasm_create(macho_ctx);
+    if (!section) return NULL;
+    
+    if (section->arch == ARCH_UNKNOWN || !disasm_load_executable(section)) {
+        disasm_free(section);
+        return NULL;
+    }
+    
+    DisassemblyPageCache *cache = (DisassemblyPageCache*)calloc(1, sizeof(DisassemblyPageCache));
+    if (!cache) {
+        disasm_free(section);
+        return NULL;
+    }
+    
+    cache->section = section;
+    cache->page_count = (uint32_t)((section->code_size + DISASM_PAGE_SIZE - 1) / DISASM_PAGE_SIZE);
+    cache->max_pages = max_pages ? max_pages : DISASM_PAGE_CACHE_DEFAULT;
+    cache->slots = (PageSlot**)calloc(cache->page_count ? cache->page_count : 1, sizeof(PageSlot*));
+    
+    if (section->arch != ARCH_ARM64) {
+        cache->sync_offsets = (uint64_t*)calloc(cache->page_count ? cache->page_count : 1, sizeof(uint64_t));
+    }
+    
+    if (!cache->slots || (section->arch != ARCH_ARM64 && !cache->sync_offsets)) {
+        free(cache->slots);
+        free(cache->sync_offsets);
+        free(cache);
+        disasm_free(section);
+        return NULL;
+    }
+    
+    pthread_mutex_init(&cache->lock, NULL);
+    pthread_cond_init(&cache->page_decoded, NULL);
+    pthread_cond_init(&cache->prefetch_wake, NULL);
+    
+    return cache;
+}
+
+// The sections and stubs belong to the cache, so they are detached first
+static void page_context_free(DisassemblyContext *disasm) {
+    disasm->sections = NULL;
+    disasm->section_count = 0;
+    disasm->stubs = NULL;
+    disasm->stub_count = 0;
+    disasm_free(disasm);
+}
+
+static void page_slot_free(PageSlot *slot) {
+    page_context_free((DisassemblyContext*)slot->page.disasm);
+    free(slot);
+}
+
+void disasm_pages_free(DisassemblyPageCache *cache) {
+    if (!cache) return;
+    
+    pthread_mutex_lock(&cache->lock);
+    cache->stopping = true;
+    pthread_cond_signal(&cache->prefetch_wake);
+    pthread_mutex_unlock(&cache->lock);
+    
+    if (cache->has_prefetch_thread) {
+        pthread_join(cache->prefetch_thread, NULL);
+    }
+    
+    for (uint32_t i = 0; i < cache->page_count; i++) {
+        if (cache->slots[i]) page_slot_free(cache->slots[i]);
+    }
+    
+    pthread_cond_destroy(&cache->prefetch_wake);
+    pthread_cond_destroy(&cache->page_decoded);
+    pthread_mutex_destroy(&cache->lock);
+    
+    free(cache->slots);
+    free(cache->sync_offsets);
+    disasm_free(cache->section);
+    free(cache);
+}
+
+const DisassemblyContext* disasm_pages_section(const DisassemblyPageCache *cache) {
+    return cache ? cache->section : NULL;
+}
+
+uint32_t disasm_pages_count(const DisassemblyPageCache *cache) {
+    return cache ? cache->page_count : 0;
+}
+
+uint32_t disasm_pages_index_of(const DisassemblyPageCache *cache, uint64_t address) {
+    if (!cache || address < cache->section->code_base_addr) return disasm_pages_count(cache);
+    
+    uint64_t offset = address - cache->section->code_base_addr;
+    if (offset >= cache->section->code_size) return cache->page_count;
+    
+    return (uint32_t)(offset / DISASM_PAGE_SIZE);
+}
+
+#pragma mark - LRU List
+
+// All list operations are made with the lock held
+
+static void lru_unlink(DisassemblyPageCache *cache, PageSlot *slot) {
+    if (slot->lru_prev) slot->lru_prev->lru_next = slot->lru_next;
+    else cache->lru_head = slot->lru_next;
+    
+    if (slot->lru_next) slot->lru_next->lru_prev = slot->lru_prev;
+    else cache->lru_tail = slot->lru_prev;
+    
+    slot->lru_prev = NULL;
+    slot->lru_next = NULL;
+}
+
+static void lru_push_front(DisassemblyPageCache *cache, PageSlot *slot) {
+    slot->lru_prev = NULL;
+    slot->lru_next = cache->lru_head;
+    
+    if (cache->lru_head) cache->lru_head->lru_prev = slot;
+    else cache->lru_tail = slot;
+    
+    cache->lru_head = slot;
+}
+
+// Drops a decoded page so the next access decodes it again. A pinned page
+// keeps its rows for the callers holding it and is freed on release.
+static void lru_drop(DisassemblyPageCache *cache, PageSlot *slot) {
+    lru_unlink(cache, slot);
+    cache->slots[slot->page.index] = NULL;
+    cache->resident--;
+    
+    if (slot->pins == 0) {
+        page_slot_free(slot);
+    } else {
+        slot->stale = true;
+    }
+}
+
+// Pinned pages are skipped, so the cache can stay over max_pages while more
+// pages than that are in use
+static void lru_evict(DisassemblyPageCache *cache) {
+    PageSlot *slot = cache->lru_tail;
+    
+    while (cache->resident > cache->max_pages && slot) {
+        PageSlot *prev = slot->lru_prev;
+        
+        if (slot->pins == 0) lru_drop(cache, slot);
+        
+        slot = prev;
+    }
+}
+
+#pragma mark - Page Decoding
+
+static DisassemblyContext* page_decode(DisassemblyPageCache *cache, uint32_t index, uint64_t start_offset) {
+    const DisassemblyContext *section = cache->section;
+    
+    DisassemblyContext *disasm = disasm_create(section->macho_ctx);
+    if (!disasm) return NULL;
+    
+    disasm->code_data = section->code_data;
+    disasm->code_size = section->code_size;
+    disasm->code_base_addr = section->code_base_addr;
+    
+    // Borrowed, so the sweep skips the gaps between sections and branches
+    // into a stub are named after its import
+    disasm->sections = section->sections;
+    disasm->section_count = section->section_count;
+    disasm->stubs = section->stubs;
+    disasm->stub_count = section->stub_count;
+    
+    uint64_t end_offset = (uint64_t)(index + 1) * DISASM_PAGE_SIZE;
+    if (end_offset > section->code_size) end_offset = section->code_size;
+    
+    // An x86_64 page may be empty when the instruction before it covers it
+    if (start_offset < end_offset) {
+        disasm_range(disasm, section->code_base_addr + start_offset, section->code_base_addr + end_offset);
+    }
+    
+    return disasm;
+}
+
+// Where the first instruction of a page starts as far as is known now
+static uint64_t page_start_offset(const DisassemblyPageCache *cache, uint32_t index) {
+    uint64_t start_offset = (uint64_t)index * DISASM_PAGE_SIZE;
+    if (cache->sync_offsets && cache->sync_offsets[index] > start_offset) {
+        start_offset = cache->sync_offsets[index];
+    }
+    return start_offset;
+}
+
+// Records where the page after a freshly decoded x86_64 page starts. That page
+// is decoded again when it was decoded, or is being decoded, from another
+// start, which in turn corrects the page after it.
+static void page_sync_next(DisassemblyPageCache *cache, const PageSlot *slot) {
+    uint32_t next = slot->page.index + 1;
+    if (!cache->sync_offsets || next >= cache->page_count) return;
+    
+    uint64_t next_offset = slot->page.end_address - cache->section->code_base_addr;
+    if (next_offset < (uint64_t)next * DISASM_PAGE_SIZE) return;
+    
+    cache->sync_offsets[next] = next_offset;
+    
+    PageSlot *stale = cache->slots[next];
+    if (stale && stale->ready && stale->page.start_address != cache->section->code_base_addr + next_offset) {
+        lru_drop(cache, stale);
+    }
+}
+
+// Returns the slot of a decoded page, pinned if pin is set. Callers racing for
+// the same page wait for the one decoding it; decoding runs unlocked.
+static PageSlot* page_load(DisassemblyPageCache *cache, uint32_t index, bool pin) {
+    pthread_mutex_lock(&cache->lock);
+    
+    PageSlot *slot;
+    while ((slot = cache->slots[index]) && !slot->ready) {
+        pthread_cond_wait(&cache->page_decoded, &cache->lock);
+    }
+    
+    if (slot) {
+        if (pin) {
+            slot->pins++;
+            lru_unlink(cache, slot);
+            lru_push_front(cache, slot);
+        }
+        pthread_mutex_unlock(&cache->lock);
+        return slot;
+    }
+    
+    slot = (PageSlot*)calloc(1, sizeof(PageSlot));
+    if (!slot) {
+        pthread_mutex_unlock(&cache->lock);
+        return NULL;
+    }
+    cache->slots[index] = slot;
+    
+    // The page before may finish decoding meanwhile and move this page's
+    // start, in which case the rows are thrown away and decoded again
+    uint64_t start_offset;
+    DisassemblyContext *disasm;
+    for (;;) {
+        start_offset = page_start_offset(cache, index);
+        pthread_mutex_unlock(&cache->lock);
+        
+        disasm = page_decode(cache, index, start_offset);
+        
+        pthread_mutex_lock(&cache->lock);
+        if (!disasm || page_start_offset(cache, index) == start_offset) break;
+        page_context_free(disasm);
+    }
+    
+    if (!disasm) {
+        cache->slots[index] = NULL;
+        free(slot);
+        slot = NULL;
+    } else {
+        slot->page.index = index;
+        slot->page.start_address = disasm->code_base_addr + start_offset;
+        slot->page.end_address = disasm->code_base_addr +
+                                 (disasm->instruction_count ? disasm->store.end_offset : start_offset);
+        slot->page.disasm = disasm;
+        slot->pins = pin ? 1 : 0;
+        slot->ready = true;
+        
+        lru_push_front(cache, slot);
+        cache->resident++;
+        
+        // The next page starts where this one's last instruction ends
+        page_sync_next(cache, slot);
+        lru_evict(cache);
+    }
+    
+    pthread_cond_broadcast(&cache->page_decoded);
+    pthread_mutex_unlock(&cache->lock);
+    
+    return slot;
+}
+
+#pragma mark - Page Access
+
+const DisassemblyPage* disasm_pages_acquire(DisassemblyPageCache *cache, uint32_t page_index) {
+    if (!cache || page_index >= cache->page_count) return NULL;
+    
+    PageSlot *slot = page_load(cache, page_index, true);
+    return slot ? &slot->page : NULL;
+}
+
+void disasm_pages_release(DisassemblyPageCache *cache, const DisassemblyPage *page) {
+    if (!cache || !page) return;
+    
+    PageSlot *slot = (PageSlot*)page;
+    
+    pthread_mutex_lock(&cache->lock);
+    if (slot->pins > 0) slot->pins--;
+    if (slot->stale && slot->pins == 0) {
+        page_slot_free(slot);
+    } else {
+        lru_evict(cache);
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+bool disasm_pages_get(DisassemblyPageCache *cache, uint64_t address, DisassembledInstruction *inst) {
+    if (!cache || !inst) return false;
+    
+    const DisassemblyPage *page = disasm_pages_acquire(cache, disasm_pages_index_of(cache, address));
+    if (!page) return false;
+    
+    int32_t row = disasm_find_by_address(page->disasm, address);
+    bool found = row >= 0 && disasm_get(page->disasm, (uint32_t)row, inst);
+    
+    disasm_pages_release(cache, page);
+    return found;
+}
+
+uint32_t disasm_pages_resident(DisassemblyPageCache *cache) {
+    if (!cache) return 0;
+    
+    pthread_mutex_lock(&cache->lock);
+    uint32_t resident = cache->resident;
+    pthread_mutex_unlock(&cache->lock);
+    
+    return resident;
+}
+
+bool disasm_pages_is_resident(DisassemblyPageCache *cache, uint32_t page_index) {
+    if (!cache || page_index >= cache->page_count) return false;
+    
+    pthread_mutex_lock(&cache->lock);
+    PageSlot *slot = cache->slots[page_index];
+    bool resident = slot && slot->ready;
+    pthread_mutex_unlock(&cache->lock);
+    
+    return resident;
+}
+
+#pragma mark - Prefetching
+
+static void* prefetch_worker(void *arg) {
+    DisassemblyPageCache *cache = (DisassemblyPageCache*)arg;
+    
+    pthread_mutex_lock(&cache->lock);
+    while (!cache->stopping) {
+        if (cache->prefetch_next >= cache->prefetch_end) {
+            pthread_cond_wait(&cache->prefetch_wake, &cache->lock);
+            continue;
+        }
+        
+        uint32_t index = cache->prefetch_next++;
+        bool cached = cache->slots[index] != NULL;
+        pthread_mutex_unlock(&cache->lock);
+        
+        if (!cached) page_load(cache, index, false);
+        
+        pthread_mutex_lock(&cache->lock);
+    }
+    pthread_mutex_unlock(&cache->lock);
+    
+    return NULL;
+}
+
+void disasm_pages_prefetch(DisassemblyPageCache *cache, uint32_t first_page, uint32_t count) {
+    if (!cache || first_page >= cache->page_count) return;
+    
+    uint32_t limit = cache->max_pages / 2;
+    if (count > limit) count = limit;
+    if (count > cache->page_count - first_page) count = cache->page_count - first_page;
+    if (count == 0) return;
+    
+    pthread_mutex_lock(&cache->lock);
+    
+    cache->prefetch_next = first_page;
+    cache->prefetch_end = first_page + count;
+    
+    // Started on first use, so caches that never prefetch have no thread
+    if (!cache->has_prefetch_thread && !cache->stopping) {
+        cache->has_prefetch_thread = pthread_create(&cache->prefetch_thread, NULL, prefetch_worker, cache) == 0;
+    }
+    
+    pthread_cond_signal(&cache->prefetch_wake);
+    pthread_mutex_unlock(&cache->lock);
+}
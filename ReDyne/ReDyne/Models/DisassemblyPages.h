@@ -0,0 +1,81 @@
+#ifndef DisassemblyPages_h
+#define DisassemblyPages_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "MachOHeader.h"
+#include "DisassemblyEngine.h"
+
+#pragma mark - Constants
+
+// Bytes of code per page, 4096 ARM64 instructions
+#define DISASM_PAGE_SIZE 0x4000
+
+// Decoded pages kept by default, about 5 MB of rows
+#define DISASM_PAGE_CACHE_DEFAULT 64
+
+#pragma mark - Structures
+
+// The rows of one page in their own DisassemblyContext over the shared
+// mapping, so disasm_get(), disasm_find_by_address() and the other row
+// accessors work on it directly. The context shares the cache's sections and
+// stubs, so calls into a stub are named as in a full disassembly.
+typedef struct {
+    uint32_t index;
+    uint64_t start_address;
+    uint64_t end_address;
+    const DisassemblyContext *disasm;
+} DisassemblyPage;
+
+// Disassembles the code sections lazily, decoding each DISASM_PAGE_SIZE page
+// on first access instead of all of them up front. At most max_pages pages
+// stay decoded; the least recently used one that is not pinned is dropped to
+// make room. Safe to use from multiple threads.
+typedef struct DisassemblyPageCache DisassemblyPageCache;
+
+#pragma mark - Function Declarations
+
+// Loads the code as disasm_load_executable() does (__text, the stub sections
+// and any other code section of its segment, with the stubs resolved) but
+// decodes nothing. Pages run over the whole span, gaps between sections
+// included. A max_pages of 0 selects DISASM_PAGE_CACHE_DEFAULT. Returns NULL
+// when there is no code or the architecture is unknown.
+DisassemblyPageCache* disasm_pages_create(const MachOContext *macho_ctx, uint32_t max_pages);
+
+// Stops the prefetch thread. No page may still be pinned.
+void disasm_pages_free(DisassemblyPageCache *cache);
+
+// The loaded code, without rows: code_base_addr and code_size give the range
+// the pages cover
+const DisassemblyContext* disasm_pages_section(const DisassemblyPageCache *cache);
+
+uint32_t disasm_pages_count(const DisassemblyPageCache *cache);
+
+// Page holding address, or disasm_pages_count() when it is outside the section
+uint32_t disasm_pages_index_of(const DisassemblyPageCache *cache, uint64_t address);
+
+// Returns the page, decoding it first if needed, pinned until
+// disasm_pages_release(). NULL when out of range or out of memory.
+// x86_64 pages start where the previous page's last instruction ends once that
+// page has been decoded; a page reached first starts at its nominal address and
+// is decoded again when the page before it turns out to end elsewhere. A page
+// still pinned then keeps its old rows until it is released.
+const DisassemblyPage* disasm_pages_acquire(DisassemblyPageCache *cache, uint32_t page_index);
+
+void disasm_pages_release(DisassemblyPageCache *cache, const DisassemblyPage *page);
+
+// Renders the instruction starting at address, decoding its page if needed
+bool disasm_pages_get(DisassemblyPageCache *cache, uint64_t address, DisassembledInstruction *inst);
+
+// Decodes pages [first_page, first_page + count) on a background thread,
+// replacing any earlier request that is still pending. At most half of the
+// cache is prefetched at once so the pages in use are not pushed out.
+void disasm_pages_prefetch(DisassemblyPageCache *cache, uint32_t first_page, uint32_t count);
+
+// Pages currently decoded
+uint32_t disasm_pages_resident(DisassemblyPageCache *cache);
+
+// Whether page_index is decoded now; a page still being decoded is not
+bool disasm_pages_is_resident(DisassemblyPageCache *cache, uint32_t page_index);
+
+#endif
@@ -1,4 +1,5 @@
 #include "DyldInfo.h"
+#include "ChainedFixups.h"
 #include <stdlib.h>
 #include <string.h>
 #include <mach-o/loader.h>
@@ -47,7 +48,7 @@ static int64_t read_sleb128(const uint8_t **ptr, const uint8_t *end) {
 
 // MARK: - Library Parsing
 
-LibraryList* dyld_parse_libraries(MachOContext *ctx) {
+LibraryList* dyld_parse_libraries(const MachOContext *ctx) {
     if (!ctx) return NULL;
     
     printf("  Parsing linked libraries...\n");
@@ -61,25 +62,15 @@ LibraryList* dyld_parse_libraries(MachOContext *ctx) {
     list->compatibility_versions = (uint32_t*)calloc(MAX_LIBRARIES, sizeof(uint32_t));
     list->library_count = 0;
     
-    uint32_t header_size = ctx->header.is_64bit ? sizeof(struct mach_header_64) : sizeof(struct mach_header);
-    fseek(ctx->file, header_size, SEEK_SET);
-    
-    for (uint32_t i = 0; i < ctx->header.ncmds; i++) {
-        uint32_t cmd, cmdsize;
-        long cmd_start = ftell(ctx->file);
-        
-        fread(&cmd, sizeof(uint32_t), 1, ctx->file);
-        fread(&cmdsize, sizeof(uint32_t), 1, ctx->file);
-        
-        if (ctx->header.is_swapped) {
-            cmd = __builtin_bswap32(cmd);
-            cmdsize = __builtin_bswap32(cmdsize);
-        }
+    for (uint32_t i = 0; i < ctx->load_command_count; i++) {
+        uint32_t cmd = ctx->load_commands[i].cmd;
+        uint32_t cmdsize = ctx->load_commands[i].cmdsize;
         
         if (cmd == LC_LOAD_DYLIB || cmd == LC_LOAD_WEAK_DYLIB || cmd == LC_REEXPORT_DYLIB) {
+            if (cmdsize < sizeof(struct dylib_command)) continue;
+            
             struct dylib_command dylib_cmd;
-            fseek(ctx->file, cmd_start, SEEK_SET);
-            fread(&dylib_cmd, sizeof(struct dylib_command), 1, ctx->file);
+            memcpy(&dylib_cmd, ctx->load_commands[i].data, sizeof(struct dylib_command));
             
             if (ctx->header.is_swapped) {
                 dylib_cmd.dylib.name.offset = __builtin_bswap32(dylib_cmd.dylib.name.offset);
@@ -88,9 +79,13 @@ LibraryList* dyld_parse_libraries(MachOContext *ctx) {
                 dylib_cmd.dylib.compatibility_version = __builtin_bswap32(dylib_cmd.dylib.compatibility_version);
             }
             
-            fseek(ctx->file, cmd_start + dylib_cmd.dylib.name.offset, SEEK_SET);
             list->library_names[list->library_count] = (char*)calloc(256, 1);
-            fgets(list->library_names[list->library_count], 255, ctx->file);
+            if (dylib_cmd.dylib.name.offset < cmdsize) {
+                const char *name = (const char*)ctx->load_commands[i].data + dylib_cmd.dylib.name.offset;
+                size_t name_len = strnlen(name, cmdsize - dylib_cmd.dylib.name.offset);
+                if (name_len > 255) name_len = 255;
+                memcpy(list->library_names[list->library_count], name, name_len);
+            }
             
             list->timestamps[list->library_count] = dylib_cmd.dylib.timestamp;
             list->current_versions[list->library_count] = dylib_cmd.dylib.current_version;
@@ -99,8 +94,6 @@ LibraryList* dyld_parse_libraries(MachOContext *ctx) {
             list->library_count++;
             if (list->library_count >= MAX_LIBRARIES) break;
         }
-        
-        fseek(ctx->file, cmd_start + cmdsize, SEEK_SET);
     }
     
     printf("   Found %d linked libraries\n", list->library_count);
@@ -109,7 +102,38 @@ LibraryList* dyld_parse_libraries(MachOContext *ctx) {
 
 // MARK: - Import (Binding) Parsing
 
-ImportList* dyld_parse_imports(MachOContext *ctx) {
+static void parse_chained_imports(const MachOContext *ctx, ImportList *list) {
+    const ChainedFixupsInfo *info = ctx->chained_fixups;
+    ChainedFixupsInfo *owned = NULL;
+    if (!info) {
+        owned = chained_fixups_parse(ctx);
+        info = owned;
+    }
+    if (!info) {
+        printf("   Chained fixups could not be decoded\n");
+        return;
+    }
+    
+    for (uint32_t i = 0; i < info->fixup_count && list->import_count < MAX_IMPORTS; i++) {
+        const ChainedFixup *fixup = &info->fixups[i];
+        if (fixup->kind != CHAINED_FIXUP_BIND || fixup->ordinal >= info->import_count) continue;
+        
+        const ChainedImport *chained = &info->imports[fixup->ordinal];
+        ImportInfo *imp = &list->imports[list->import_count];
+        strncpy(imp->name, chained->name, 255);
+        snprintf(imp->library_name, 255, "dylib[%d]", chained->library_ordinal);
+        imp->library_ordinal = chained->library_ordinal;
+        imp->address = fixup->address;
+        imp->bind_type = 1;
+        imp->is_weak = chained->is_weak;
+        imp->addend = fixup->addend + chained->addend;
+        list->import_count++;
+    }
+    
+    chained_fixups_free(owned);
+}
+
+ImportList* dyld_parse_imports(const MachOContext *ctx) {
     if (!ctx) return NULL;
     
     printf("Parsing imports (binding info)...\n");
@@ -120,6 +144,12 @@ ImportList* dyld_parse_imports(MachOContext *ctx) {
     list->imports = (ImportInfo*)calloc(MAX_IMPORTS, sizeof(ImportInfo));
     list->import_count = 0;
     
+    if ((!ctx->has_dyld_info || ctx->bind_size == 0) && ctx->has_chained_fixups) {
+        parse_chained_imports(ctx, list);
+        printf("   Found %d imports (chained fixups)\n", list->import_count);
+        return list;
+    }
+    
     if (!ctx->has_dyld_info || ctx->bind_size == 0) {
         printf("   No binding info found\n");
         return list;
@@ -128,9 +158,11 @@ ImportList* dyld_parse_imports(MachOContext *ctx) {
     uint32_t bind_offset = ctx->bind_off;
     uint32_t bind_size = ctx->bind_size;
     
-    uint8_t *bind_data = (uint8_t*)malloc(bind_size);
-    fseek(ctx->file, bind_offset, SEEK_SET);
-    fread(bind_data, 1, bind_size, ctx->file);
+    const uint8_t *bind_data = macho_data_at(ctx, bind_offset, bind_size);
+    if (!bind_data) {
+        printf("   Binding info out of bounds\n");
+        return list;
+    }
     
     const uint8_t *ptr = bind_data;
     const uint8_t *end = bind_data + bind_size;
@@ -199,7 +231,6 @@ ImportList* dyld_parse_imports(MachOContext *ctx) {
         }
     }
     
-    free(bind_data);
     printf("   Found %d imports\n", list->import_count);
     return list;
 }
@@ -309,7 +340,7 @@ static void traverse_export_trie(TrieContext *tctx, const uint8_t *p, const char
     }
 }
 
-ExportList* dyld_parse_exports(MachOContext *ctx) {
+ExportList* dyld_parse_exports(const MachOContext *ctx) {
     if (!ctx) return NULL;
     
     printf("   Parsing exports...\n");
@@ -320,16 +351,18 @@ ExportList* dyld_parse_exports(MachOContext *ctx) {
     list->exports = (ExportInfo*)calloc(MAX_EXPORTS, sizeof(ExportInfo));
     list->export_count = 0;
     
-    if (!ctx->has_dyld_info || ctx->export_size == 0) {
+    if (ctx->export_size == 0) {
         printf("   No export info found\n");
         return list;
     }
     
     uint32_t export_offset = ctx->export_off;
     uint32_t export_size = ctx->export_size;
-    uint8_t *export_data = (uint8_t*)malloc(export_size);
-    fseek(ctx->file, export_offset, SEEK_SET);
-    fread(export_data, 1, export_size, ctx->file);
+    const uint8_t *export_data = macho_data_at(ctx, export_offset, export_size);
+    if (!export_data) {
+        printf("   Export info out of bounds\n");
+        return list;
+    }
     
     TrieContext tctx = {
         .data = export_data,
@@ -345,7 +378,6 @@ ExportList* dyld_parse_exports(MachOContext *ctx) {
     list->export_count = tctx.export_count;
     printf("   Parsed %u exports from trie\n", list->export_count);
     
-    free(export_data);
     return list;
 }
 
@@ -53,11 +53,11 @@ typedef struct {
 
 // MARK: - Public API
 
-ImportList* dyld_parse_imports(MachOContext *ctx);
+ImportList* dyld_parse_imports(const MachOContext *ctx);
 
-ExportList* dyld_parse_exports(MachOContext *ctx);
+ExportList* dyld_parse_exports(const MachOContext *ctx);
 
-LibraryList* dyld_parse_libraries(MachOContext *ctx);
+LibraryList* dyld_parse_libraries(const MachOContext *ctx);
 
 void dyld_free_imports(ImportList *list);
 
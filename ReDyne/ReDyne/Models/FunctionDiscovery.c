@@ -0,0 +1,581 @@
+#include "FunctionDiscovery.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+// A function being discovered. limit is the next known start (or the end of
+// its section): descent never decodes at or past it.
+typedef struct {
+    DiscoveredFunction function;
+    uint64_t limit;
+    bool dirty;
+    
+    // Direct call targets seen by the last descent
+    uint64_t *calls;
+    uint32_t call_count;
+    uint32_t call_capacity;
+} DiscoveryEntry;
+
+typedef struct {
+    uint64_t address;
+    uint8_t source;
+    const char *name;
+} DiscoverySeed;
+
+typedef struct {
+    const DisassemblyContext *ctx;
+    DiscoveryEntry *entries;
+    const uint32_t *pending;
+    uint32_t pending_count;
+    
+    atomic_uint next_entry;
+    atomic_bool failed;
+} DiscoveryRound;
+
+// Scratch space of one thread, reused across the functions it descends
+typedef struct {
+    DiscoveryRound *round;
+    uint8_t *visited;
+    uint64_t visited_size;
+    uint64_t *worklist;
+    uint32_t worklist_count;
+    uint32_t worklist_capacity;
+} DiscoveryWorker;
+
+#pragma mark - Code Bounds
+
+// End of the loaded section holding address, or 0 when address is not code
+static uint64_t code_end_for_address(const DisassemblyContext *ctx, uint64_t address) {
+    if (ctx->section_count == 0) {
+        if (address < ctx->code_base_addr || address - ctx->code_base_addr >= ctx->code_size) return 0;
+        return ctx->code_base_addr + ctx->code_size;
+    }
+    
+    const DisassemblySection *section = disasm_section_for_address(ctx, address);
+    return section ? section->address + section->size : 0;
+}
+
+static bool is_code_address(const DisassemblyContext *ctx, uint64_t address) {
+    if (ctx->arch == ARCH_ARM64 && (address & 3) != 0) return false;
+    return code_end_for_address(ctx, address) != 0;
+}
+
+#pragma mark - Descent
+
+static bool worklist_push(DiscoveryWorker *worker, uint64_t address) {
+    if (worker->worklist_count >= worker->worklist_capacity) {
+        uint32_t capacity = worker->worklist_capacity ? worker->worklist_capacity * 2 : 64;
+        uint64_t *worklist = (uint64_t*)realloc(worker->worklist, capacity * sizeof(uint64_t));
+        if (!worklist) return false;
+        worker->worklist = worklist;
+        worker->worklist_capacity = capacity;
+    }
+    
+    worker->worklist[worker->worklist_count++] = address;
+    return true;
+}
+
+static bool entry_add_call(DiscoveryEntry *entry, uint64_t target) {
+    if (entry->call_count >= entry->call_capacity) {
+        uint32_t capacity = entry->call_capacity ? entry->call_capacity * 2 : 8;
+        uint64_t *calls = (uint64_t*)realloc(entry->calls, capacity * sizeof(uint64_t));
+        if (!calls) return false;
+        entry->calls = calls;
+        entry->call_capacity = capacity;
+    }
+    
+    entry->calls[entry->call_count++] = target;
+    return true;
+}
+
+// Marks an instruction (by its bit in the range) visited; false if it already was
+static bool visit(DiscoveryWorker *worker, uint64_t bit) {
+    uint8_t mask = (uint8_t)(1U << (bit & 7));
+    if (worker->visited[bit >> 3] & mask) return false;
+    worker->visited[bit >> 3] |= mask;
+    return true;
+}
+
+// Follows one basic block from address. Conditional and in-range direct jump
+// targets are queued; a jump out of the range is a tail call and ends the
+// block like a return, an indirect jump or a trap.
+static bool descend_block_arm64(DiscoveryWorker *worker, DiscoveryEntry *entry, uint64_t address) {
+    const DisassemblyContext *ctx = worker->round->ctx;
+    DiscoveredFunction *function = &entry->function;
+    bool swapped = ctx->macho_ctx && ctx->macho_ctx->header.is_swapped;
+    ARM64DecodedWord decoded;
+    
+    // A word cut short by the limit is not read
+    for (; address + 4 <= entry->limit; address += 4) {
+        if (!visit(worker, (address - function->start_address) / 4)) return true;
+        
+        uint32_t bytes;
+        memcpy(&bytes, ctx->code_data + (address - ctx->code_base_addr), sizeof(bytes));
+        if (swapped) bytes = swap_uint32(bytes);
+        
+        arm64_decode_word(bytes, &decoded);
+        
+        // Data in the instruction stream is not part of the function
+        if (decoded.mnemonic == ARM64_MNEMONIC_WORD) return true;
+        
+        function->instruction_count++;
+        if (address + 4 > function->end_address) function->end_address = address + 4;
+        
+        if (decoded.mnemonic == ARM64_MNEMONIC_UDF || decoded.mnemonic == ARM64_MNEMONIC_BRK ||
+            decoded.mnemonic == ARM64_MNEMONIC_HLT) {
+            return true;
+        }
+        
+        BranchType type = (BranchType)decoded.branch_type;
+        if (type == BRANCH_NONE) continue;
+        
+        bool direct = (decoded.flags & INST_FLAG_HAS_BRANCH_TARGET) != 0;
+        uint64_t target = address + (uint64_t)(int64_t)decoded.branch_delta;
+        bool in_range = direct && target >= function->start_address && target < entry->limit;
+        
+        switch (type) {
+            case BRANCH_CALL:
+                if (direct && !entry_add_call(entry, target)) return false;
+                break;
+            case BRANCH_CONDITIONAL:
+                if (in_range && !worklist_push(worker, target)) return false;
+                break;
+            case BRANCH_UNCONDITIONAL:
+                return !in_range || worklist_push(worker, target);
+            default:
+                return true;
+        }
+    }
+    
+    return true;
+}
+
+static bool descend_block_x86_64(DiscoveryWorker *worker, DiscoveryEntry *entry, uint64_t address) {
+    const DisassemblyContext *ctx = worker->round->ctx;
+    DiscoveredFunction *function = &entry->function;
+    X86DecodedInstruction decoded;
+    
+    while (address < entry->limit) {
+        if (!visit(worker, address - function->start_address)) return true;
+        
+        // Decoding is bounded by the code, so an instruction cut short by its
+        // end reads as .byte and ends the block
+        uint64_t offset = address - ctx->code_base_addr;
+        uint8_t length = x86_64_decode(ctx->code_data + offset, (size_t)(ctx->code_size - offset), &decoded);
+        if (decoded.mnemonic == X86_MNEMONIC_BYTE || address + length > entry->limit) return true;
+        
+        function->instruction_count++;
+        if (address + length > function->end_address) function->end_address = address + length;
+        
+        if (decoded.mnemonic == X86_MNEMONIC_INT3 || decoded.mnemonic == X86_MNEMONIC_HLT ||
+            decoded.mnemonic == X86_MNEMONIC_UD2) {
+            return true;
+        }
+        
+        bool direct = (decoded.flags & INST_FLAG_HAS_BRANCH_TARGET) != 0;
+        uint64_t target = address + (uint64_t)(int64_t)decoded.branch_delta;
+        bool in_range = direct && target >= function->start_address && target < entry->limit;
+        
+        switch ((BranchType)decoded.branch_type) {
+            case BRANCH_CALL:
+                if (direct && !entry_add_call(entry, target)) return false;
+                break;
+            case BRANCH_CONDITIONAL:
+                if (in_range && !worklist_push(worker, target)) return false;
+                break;
+            case BRANCH_UNCONDITIONAL:
+                return !in_range || worklist_push(worker, target);
+            case BRANCH_RETURN:
+                return true;
+            default:
+                break;
+        }
+        
+        address += length;
+    }
+    
+    return true;
+}
+
+static bool descend_function(DiscoveryWorker *worker, DiscoveryEntry *entry) {
+    const DisassemblyContext *ctx = worker->round->ctx;
+    DiscoveredFunction *function = &entry->function;
+    
+    function->end_address = function->start_address;
+    function->instruction_count = 0;
+    entry->call_count = 0;
+    
+    // One bit per word of ARM64 code, per byte of x86_64 code
+    uint64_t span = entry->limit - function->start_address;
+    uint64_t bits = (ctx->arch == ARCH_ARM64) ? span / 4 : span;
+    uint64_t visited_size = (bits + 7) / 8;
+    if (visited_size > worker->visited_size) {
+        uint8_t *visited = (uint8_t*)realloc(worker->visited, visited_size);
+        if (!visited) return false;
+        worker->visited = visited;
+        worker->visited_size = visited_size;
+    }
+    memset(worker->visited, 0, visited_size);
+    
+    worker->worklist_count = 0;
+    if (!worklist_push(worker, function->start_address)) return false;
+    
+    while (worker->worklist_count > 0) {
+        uint64_t address = worker->worklist[--worker->worklist_count];
+        bool ok = (ctx->arch == ARCH_ARM64) ? descend_block_arm64(worker, entry, address)
+                                            : descend_block_x86_64(worker, entry, address);
+        if (!ok) return false;
+    }
+    
+    return true;
+}
+
+static void* discovery_worker(void *arg) {
+    DiscoveryWorker *worker = (DiscoveryWorker*)arg;
+    DiscoveryRound *round = worker->round;
+    
+    for (;;) {
+        uint32_t next = atomic_fetch_add(&round->next_entry, 1);
+        if (next >= round->pending_count || atomic_load(&round->failed)) break;
+        
+        if (!descend_function(worker, &round->entries[round->pending[next]])) {
+            atomic_store(&round->failed, true);
+            break;
+        }
+    }
+    
+    return NULL;
+}
+
+// Descends every pending entry. The caller's thread works too, so
+// thread_count includes it.
+static bool discovery_run(DiscoveryRound *round, uint32_t thread_count) {
+    DiscoveryWorker workers[DISASM_MAX_THREADS];
+    pthread_t threads[DISASM_MAX_THREADS];
+    bool started[DISASM_MAX_THREADS] = { false };
+    
+    if (thread_count > round->pending_count) thread_count = round->pending_count;
+    if (thread_count == 0) thread_count = 1;
+    
+    memset(workers, 0, thread_count * sizeof(DiscoveryWorker));
+    atomic_store(&round->next_entry, 0);
+    atomic_store(&round->failed, false);
+    
+    for (uint32_t i = 0; i < thread_count; i++) {
+        workers[i].round = round;
+    }
+    for (uint32_t i = 1; i < thread_count; i++) {
+        started[i] = (pthread_create(&threads[i], NULL, discovery_worker, &workers[i]) == 0);
+    }
+    
+    discovery_worker(&workers[0]);
+    
+    for (uint32_t i = 0; i < thread_count; i++) {
+        if (started[i]) pthread_join(threads[i], NULL);
+        free(workers[i].visited);
+        free(workers[i].worklist);
+    }
+    
+    return !atomic_load(&round->failed);
+}
+
+#pragma mark - Seeds
+
+static int compare_seeds(const void *a, const void *b) {
+    const DiscoverySeed *sa = (const DiscoverySeed*)a;
+    const DiscoverySeed *sb = (const DiscoverySeed*)b;
+    if (sa->address != sb->address) return (sa->address < sb->address) ? -1 : 1;
+    if (sa->source != sb->source) return (sa->source < sb->source) ? -1 : 1;
+    return 0;
+}
+
+static int compare_addresses(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x < y) ? -1 : (x > y);
+}
+
+// Sorts seeds and folds duplicates into the most trusted one, keeping the
+// first name found for the address
+static uint32_t seeds_normalize(DiscoverySeed *seeds, uint32_t count) {
+    if (count == 0) return 0;
+    
+    qsort(seeds, count, sizeof(DiscoverySeed), compare_seeds);
+    
+    uint32_t kept = 1;
+    for (uint32_t i = 1; i < count; i++) {
+        DiscoverySeed *last = &seeds[kept - 1];
+        if (seeds[i].address == last->address) {
+            if (!last->name) last->name = seeds[i].name;
+            continue;
+        }
+        seeds[kept++] = seeds[i];
+    }
+    
+    return kept;
+}
+
+static DiscoverySeed* collect_initial_seeds(const DisassemblyContext *ctx, const SymbolTableContext *symbols,
+                                            uint32_t *out_count) {
+    uint32_t start_count = 0;
+    uint64_t *starts = macho_function_starts(ctx->macho_ctx, &start_count);
+    uint32_t symbol_count = symbols ? symbols->symbol_count : 0;
+    
+    uint64_t capacity = (uint64_t)start_count + symbol_count + ctx->stub_count;
+    DiscoverySeed *seeds = (DiscoverySeed*)malloc((capacity ? capacity : 1) * sizeof(DiscoverySeed));
+    if (!seeds) {
+        free(starts);
+        return NULL;
+    }
+    
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < start_count; i++) {
+        if (!is_code_address(ctx, starts[i])) continue;
+        seeds[count++] = (DiscoverySeed){ starts[i], FUNCTION_SOURCE_START, NULL };
+    }
+    free(starts);
+    
+    for (uint32_t i = 0; i < symbol_count; i++) {
+        const SymbolInfo *symbol = &symbols->symbols[i];
+        if (!symbol->is_defined || symbol->is_debug || symbol->type != SYMBOL_TYPE_SECTION) continue;
+        if (!is_code_address(ctx, symbol->address)) continue;
+        
+        const char *name = (symbol->name && symbol->name[0]) ? symbol->name : NULL;
+        seeds[count++] = (DiscoverySeed){ symbol->address, FUNCTION_SOURCE_SYMBOL, name };
+    }
+    
+    for (uint32_t i = 0; i < ctx->stub_count; i++) {
+        const DisassemblyStub *stub = &ctx->stubs[i];
+        if (!is_code_address(ctx, stub->address)) continue;
+        seeds[count++] = (DiscoverySeed){ stub->address, FUNCTION_SOURCE_STUB, stub->name };
+    }
+    
+    *out_count = seeds_normalize(seeds, count);
+    return seeds;
+}
+
+static bool entries_contain(const DiscoveryEntry *entries, uint32_t count, uint64_t address) {
+    uint32_t low = 0;
+    uint32_t high = count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (entries[mid].function.start_address < address) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low < count && entries[low].function.start_address == address;
+}
+
+// Merges new seeds (sorted, none of them a start yet) into the entries and
+// recomputes every limit. An entry whose limit moved below code it had reached
+// is marked for another descent.
+static DiscoveryEntry* entries_merge(DiscoveryEntry *entries, uint32_t count, const DiscoverySeed *seeds,
+                                     uint32_t seed_count, const DisassemblyContext *ctx) {
+    DiscoveryEntry *merged = (DiscoveryEntry*)calloc(count + seed_count, sizeof(DiscoveryEntry));
+    if (!merged) return NULL;
+    
+    uint32_t e = 0, s = 0, n = 0;
+    while (e < count || s < seed_count) {
+        if (s >= seed_count || (e < count && entries[e].function.start_address < seeds[s].address)) {
+            merged[n++] = entries[e++];
+            continue;
+        }
+        
+        DiscoveryEntry *entry = &merged[n++];
+        entry->function.start_address = seeds[s].address;
+        entry->function.end_address = seeds[s].address;
+        entry->function.source = seeds[s].source;
+        entry->function.name = seeds[s].name;
+        entry->limit = UINT64_MAX;
+        entry->dirty = true;
+        s++;
+    }
+    
+    for (uint32_t i = 0; i < n; i++) {
+        DiscoveryEntry *entry = &merged[i];
+        uint64_t limit = code_end_for_address(ctx, entry->function.start_address);
+        if (i + 1 < n && merged[i + 1].function.start_address < limit) {
+            limit = merged[i + 1].function.start_address;
+        }
+        
+        if (limit < entry->limit && entry->function.end_address > limit) entry->dirty = true;
+        entry->limit = limit;
+    }
+    
+    free(entries);
+    return merged;
+}
+
+// Call targets of the entries just descended that are not starts yet
+static DiscoverySeed* collect_call_seeds(const DiscoveryRound *round, uint32_t entry_count, uint32_t *out_count) {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < round->pending_count; i++) {
+        total += round->entries[round->pending[i]].call_count;
+    }
+    
+    *out_count = 0;
+    uint64_t *targets = (uint64_t*)malloc((total ? total : 1) * sizeof(uint64_t));
+    if (!targets) return NULL;
+    
+    uint64_t count = 0;
+    for (uint32_t i = 0; i < round->pending_count; i++) {
+        const DiscoveryEntry *entry = &round->entries[round->pending[i]];
+        if (entry->call_count == 0) continue;
+        memcpy(targets + count, entry->calls, entry->call_count * sizeof(uint64_t));
+        count += entry->call_count;
+    }
+    qsort(targets, count, sizeof(uint64_t), compare_addresses);
+    
+    DiscoverySeed *seeds = (DiscoverySeed*)malloc((count ? count : 1) * sizeof(DiscoverySeed));
+    if (!seeds) {
+        free(targets);
+        return NULL;
+    }
+    
+    uint32_t kept = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        if (i > 0 && targets[i] == targets[i - 1]) continue;
+        if (!is_code_address(round->ctx, targets[i])) continue;
+        if (entries_contain(round->entries, entry_count, targets[i])) continue;
+        seeds[kept++] = (DiscoverySeed){ targets[i], FUNCTION_SOURCE_CALL, NULL };
+    }
+    free(targets);
+    
+    *out_count = kept;
+    return seeds;
+}
+
+#pragma mark - Discovery
+
+FunctionList* function_discover(const DisassemblyContext *ctx, const SymbolTableContext *symbols,
+                                uint32_t thread_count) {
+    if (!ctx || !ctx->code_data || ctx->code_size == 0) return NULL;
+    if (ctx->arch != ARCH_ARM64 && ctx->arch != ARCH_X86_64) return NULL;
+    
+    if (thread_count == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = (uint32_t)(cpus > 0 ? cpus : 1);
+    }
+    if (thread_count > DISASM_MAX_THREADS) thread_count = DISASM_MAX_THREADS;
+    
+    uint32_t seed_count = 0;
+    DiscoverySeed *seeds = collect_initial_seeds(ctx, symbols, &seed_count);
+    if (!seeds) return NULL;
+    
+    // Without any start, the code is one function from its first byte
+    if (seed_count == 0) {
+        uint64_t first = ctx->section_count ? ctx->sections[0].address : ctx->code_base_addr;
+        seeds[seed_count++] = (DiscoverySeed){ first, FUNCTION_SOURCE_START, NULL };
+    }
+    
+    DiscoveryEntry *entries = NULL;
+    uint32_t entry_count = 0;
+    uint32_t *pending = NULL;
+    bool ok = true;
+    
+    // Each round descends the new and the shrunk functions, then adds the
+    // call targets they found as new functions
+    while (ok && seed_count > 0) {
+        DiscoveryEntry *merged = entries_merge(entries, entry_count, seeds, seed_count, ctx);
+        free(seeds);
+        seeds = NULL;
+        if (!merged) {
+            ok = false;
+            break;
+        }
+        entries = merged;
+        entry_count += seed_count;
+        
+        free(pending);
+        pending = (uint32_t*)malloc(entry_count * sizeof(uint32_t));
+        if (!pending) {
+            ok = false;
+            break;
+        }
+        
+        uint32_t pending_count = 0;
+        for (uint32_t i = 0; i < entry_count; i++) {
+            if (entries[i].dirty) pending[pending_count++] = i;
+        }
+        
+        DiscoveryRound round;
+        round.ctx = ctx;
+        round.entries = entries;
+        round.pending = pending;
+        round.pending_count = pending_count;
+        atomic_init(&round.next_entry, 0);
+        atomic_init(&round.failed, false);
+        
+        ok = discovery_run(&round, thread_count);
+        if (ok) {
+            seeds = collect_call_seeds(&round, entry_count, &seed_count);
+            ok = (seeds != NULL);
+        }
+        
+        for (uint32_t i = 0; i < pending_count; i++) {
+            DiscoveryEntry *entry = &entries[pending[i]];
+            free(entry->calls);
+            entry->calls = NULL;
+            entry->call_count = 0;
+            entry->call_capacity = 0;
+            entry->dirty = false;
+        }
+    }
+    
+    free(seeds);
+    free(pending);
+    
+    FunctionList *list = ok ? (FunctionList*)calloc(1, sizeof(FunctionList)) : NULL;
+    if (list && entry_count > 0) {
+        list->functions = (DiscoveredFunction*)malloc(entry_count * sizeof(DiscoveredFunction));
+        if (!list->functions) {
+            free(list);
+            list = NULL;
+        }
+    }
+    
+    // Starts that lead to no instruction (data, or an alignment gap) only
+    // served as bounds
+    for (uint32_t i = 0; list && i < entry_count; i++) {
+        if (entries[i].function.instruction_count == 0) continue;
+        list->functions[list->count++] = entries[i].function;
+    }
+    
+    for (uint32_t i = 0; i < entry_count; i++) {
+        free(entries[i].calls);
+    }
+    free(entries);
+    
+    return list;
+}
+
+const DiscoveredFunction* function_list_find(const FunctionList *list, uint64_t address) {
+    if (!list || list->count == 0) return NULL;
+    
+    // Last function starting at or before address
+    uint32_t low = 0;
+    uint32_t high = list->count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (list->functions[mid].start_address <= address) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low == 0) return NULL;
+    
+    const DiscoveredFunction *function = &list->functions[low - 1];
+    return address < function->end_address ? function : NULL;
+}
+
+void function_list_free(FunctionList *list) {
+    if (!list) return;
+    
+    free(list->functions);
+    free(list);
+}
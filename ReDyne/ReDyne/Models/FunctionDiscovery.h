@@ -0,0 +1,61 @@
+#ifndef FunctionDiscovery_h
+#define FunctionDiscovery_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "DisassemblyEngine.h"
+#include "SymbolTable.h"
+
+#pragma mark - Structures
+
+// Where a function start was first learned from, most trusted first
+typedef enum {
+    FUNCTION_SOURCE_START,      // LC_FUNCTION_STARTS
+    FUNCTION_SOURCE_SYMBOL,     // Defined symbol in a code section
+    FUNCTION_SOURCE_STUB,       // Symbol stub
+    FUNCTION_SOURCE_CALL        // Target of a direct call
+} FunctionSource;
+
+typedef struct {
+    uint64_t start_address;
+    
+    // One past the last byte of the furthest reachable instruction
+    uint64_t end_address;
+    
+    // Reachable instructions; code skipped over inside the range (alignment
+    // padding, jump tables) is not counted
+    uint32_t instruction_count;
+    
+    uint8_t source;     // FunctionSource
+    
+    // Symbol or imported symbol name, NULL for unnamed functions. Aliases the
+    // symbol table and the mapping, like DisassemblyStub.name.
+    const char *name;
+} DiscoveredFunction;
+
+// Functions by start address; their ranges never overlap
+typedef struct {
+    DiscoveredFunction *functions;
+    uint32_t count;
+} FunctionList;
+
+#pragma mark - Function Declarations
+
+// Recursive descent over the code sections of ctx (disasm_load_executable();
+// no rows are needed). Seeds are the LC_FUNCTION_STARTS entries, the defined
+// symbols inside code sections and the symbol stubs; each function is decoded
+// from its start along every direct branch, up to the next known start, so
+// only reachable code is decoded. Direct call targets found on the way become
+// new functions and the affected neighbours are decoded again, until no new
+// start turns up. Functions of a round are decoded on thread_count threads
+// (0 uses every online core). symbols may be NULL. Returns NULL when ctx has
+// no code or on allocation failure.
+FunctionList* function_discover(const DisassemblyContext *ctx, const SymbolTableContext *symbols,
+                                uint32_t thread_count);
+
+// Function whose range holds address, or NULL
+const DiscoveredFunction* function_list_find(const FunctionList *list, uint64_t address);
+
+void function_list_free(FunctionList *list);
+
+#endif
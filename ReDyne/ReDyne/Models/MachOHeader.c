@@ -1,7 +1,12 @@
 #include "MachOHeader.h"
+#include "ChainedFixups.h"
 #include <stdlib.h>
 #include <string.h>
 #include <mach/machine.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #pragma mark - Byte Swapping Utilities
 
@@ -46,14 +51,13 @@ const char* macho_magic_string(uint32_t magic) {
 
 #pragma mark - String Helpers
 
+// The ABI bits are part of the type: CPU_TYPE_X86_64 is CPU_TYPE_X86 with
+// CPU_ARCH_ABI64 set, so the full value is matched
 const char* macho_cpu_type_string(uint32_t cputype) {
-    uint32_t base_type = cputype & 0x00FFFFFF;
-    
-    switch (base_type) {
+    switch (cputype) {
         case CPU_TYPE_ARM: return "ARM";
-        case CPU_TYPE_ARM64:
-            if (cputype == 0x0200000C) return "ARM64_32";
-            return "ARM64";
+        case CPU_TYPE_ARM64: return "ARM64";
+        case 0x0200000C: return "ARM64_32";
         case CPU_TYPE_X86: return "i386";
         case CPU_TYPE_X86_64: return "x86_64";
         case CPU_TYPE_POWERPC: return "PowerPC";
@@ -122,8 +126,55 @@ const char* macho_filetype_string(uint32_t filetype) {
     }
 }
 
+#pragma mark - File Mapping
+
+// Resolves an absolute file range, ignoring the selected slice. The slice
+// mapping is tried first, then the header page of a universal binary.
+static const uint8_t* macho_file_bytes(const MachOContext *ctx, uint64_t offset, uint64_t size) {
+    if (!ctx) return NULL;
+    
+    if (ctx->map_base && offset >= ctx->map_offset) {
+        uint64_t relative = offset - ctx->map_offset;
+        if (relative <= ctx->map_size && size <= ctx->map_size - relative) return ctx->map_base + relative;
+    }
+    
+    if (ctx->head_base && offset <= ctx->head_size && size <= ctx->head_size - offset) {
+        return ctx->head_base + offset;
+    }
+    return NULL;
+}
+
+// Maps the file range [offset, offset + size), widened down to a page boundary,
+// and makes it the context's slice mapping in place of the previous one
+static bool macho_map_range(MachOContext *ctx, uint64_t offset, uint64_t size) {
+    uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t start = offset & ~(page - 1);
+    uint64_t length = offset + size - start;
+    if (ctx->fd < 0 || length == 0 || length > SIZE_MAX) return false;
+    
+    // Only the address range is reserved here; pages are read in as they are
+    // touched and, being clean, can be dropped again under memory pressure
+    void *map = mmap(NULL, (size_t)length, PROT_READ, MAP_PRIVATE, ctx->fd, (off_t)start);
+    if (map == MAP_FAILED) return false;
+    
+    // Analyses jump between load commands, symbol tables and code, so
+    // read-ahead of a large slice mostly brings in pages nobody looks at
+    if (length > MACHO_LARGE_FILE_THRESHOLD) {
+        madvise(map, (size_t)length, MADV_RANDOM);
+    }
+    
+    if (ctx->map_base) munmap((void*)ctx->map_base, ctx->map_size);
+    ctx->map_base = (const uint8_t*)map;
+    ctx->map_offset = start;
+    ctx->map_size = (size_t)length;
+    return true;
+}
+
 #pragma mark - Context Management
 
+static void build_address_index(MachOContext *ctx);
+static void address_index_free(MachOAddressIndex *index);
+
 MachOContext* macho_open(const char *filepath, char *error_msg) {
     MachOContext *ctx = (MachOContext*)calloc(1, sizeof(MachOContext));
     if (!ctx) {
@@ -131,54 +182,79 @@ MachOContext* macho_open(const char *filepath, char *error_msg) {
         return NULL;
     }
     
-    ctx->file = fopen(filepath, "rb");
-    if (!ctx->file) {
+    ctx->fd = open(filepath, O_RDONLY);
+    if (ctx->fd == -1) {
         if (error_msg) strcpy(error_msg, "Failed to open file - file may not exist or you don't have permission");
         free(ctx);
         return NULL;
     }
     
-    fseek(ctx->file, 0, SEEK_END);
-    ctx->file_size = ftell(ctx->file);
-    fseek(ctx->file, 0, SEEK_SET);
+    struct stat st;
+    if (fstat(ctx->fd, &st) == -1) {
+        if (error_msg) strcpy(error_msg, "Failed to get file stats");
+        macho_close(ctx);
+        return NULL;
+    }
+    ctx->file_size = (long)st.st_size;
     
     if (ctx->file_size <= 0) {
         if (error_msg) strcpy(error_msg, "File is empty");
-        fclose(ctx->file);
-        free(ctx);
+        macho_close(ctx);
         return NULL;
     }
     
     if (ctx->file_size < 4) {
         if (error_msg) strcpy(error_msg, "File too small to be a valid Mach-O binary");
-        fclose(ctx->file);
-        free(ctx);
-        return NULL;
-    }
-    
-    if (ctx->file_size > MAX_FILE_SIZE) {
-        if (error_msg) sprintf(error_msg, "File too large: %ld bytes (max: %d MB)", ctx->file_size, MAX_FILE_SIZE / (1024 * 1024));
-        fclose(ctx->file);
-        free(ctx);
+        macho_close(ctx);
         return NULL;
     }
     
-    uint32_t magic;
-    if (fread(&magic, sizeof(uint32_t), 1, ctx->file) != 1) {
-        if (error_msg) strcpy(error_msg, "Failed to read magic number from file");
-        fclose(ctx->file);
-        free(ctx);
+    uint32_t magic = 0;
+    if (pread(ctx->fd, &magic, sizeof(magic), 0) != (ssize_t)sizeof(magic)) {
+        if (error_msg) strcpy(error_msg, "Failed to read file header");
+        macho_close(ctx);
         return NULL;
     }
-    fseek(ctx->file, 0, SEEK_SET);
     
     if (!macho_is_valid_magic(magic)) {
         if (error_msg) {
             sprintf(error_msg, "Invalid magic number: 0x%08X (%s)\nExpected Mach-O or Universal Binary format", 
                     magic, macho_magic_string(magic));
         }
-        fclose(ctx->file);
-        free(ctx);
+        macho_close(ctx);
+        return NULL;
+    }
+    
+    ctx->slice_offset = 0;
+    ctx->slice_size = (uint64_t)ctx->file_size;
+    
+    bool is_fat = (magic == FAT_MAGIC || magic == FAT_CIGAM || magic == 0xcafebabf || magic == 0xbfbafeca);
+    if (is_fat) {
+        // The fat header and its (at most 20) fat_arch entries fit in the first
+        // page; slices are mapped one at a time by macho_parse_header_at()
+        size_t head_size = (size_t)sysconf(_SC_PAGESIZE);
+        if ((uint64_t)head_size > (uint64_t)ctx->file_size) head_size = (size_t)ctx->file_size;
+        
+        void *head = mmap(NULL, head_size, PROT_READ, MAP_PRIVATE, ctx->fd, 0);
+        if (head == MAP_FAILED) {
+            if (error_msg) strcpy(error_msg, "Failed to map file into memory");
+            macho_close(ctx);
+            return NULL;
+        }
+        ctx->head_base = (const uint8_t*)head;
+        ctx->head_size = head_size;
+        return ctx;
+    }
+    
+    if ((uint64_t)ctx->file_size > SIZE_MAX) {
+        if (error_msg) strcpy(error_msg, "File too large to map into memory");
+        macho_close(ctx);
+        return NULL;
+    }
+    
+    if (!macho_map_range(ctx, 0, (uint64_t)ctx->file_size)) {
+        if (error_msg) strcpy(error_msg, "Failed to map file into memory");
+        macho_close(ctx);
         return NULL;
     }
     
@@ -188,131 +264,227 @@ MachOContext* macho_open(const char *filepath, char *error_msg) {
 void macho_close(MachOContext *ctx) {
     if (!ctx) return;
     
-    if (ctx->file) fclose(ctx->file);
-    if (ctx->load_commands) {
-        for (uint32_t i = 0; i < ctx->load_command_count; i++) {
-            if (ctx->load_commands[i].data) free(ctx->load_commands[i].data);
-        }
-        free(ctx->load_commands);
-    }
+    if (ctx->map_base) munmap((void*)ctx->map_base, ctx->map_size);
+    if (ctx->head_base) munmap((void*)ctx->head_base, ctx->head_size);
+    if (ctx->fd >= 0) close(ctx->fd);
+    if (ctx->load_commands) free(ctx->load_commands);
     if (ctx->segments) free(ctx->segments);
     if (ctx->sections) free(ctx->sections);
+    if (ctx->chained_fixups) chained_fixups_free(ctx->chained_fixups);
+    if (ctx->address_index) address_index_free(ctx->address_index);
     
     free(ctx);
 }
 
+#pragma mark - Mapped Data Access
+
+MachOSpan macho_span(const MachOContext *ctx, uint64_t offset, uint64_t size) {
+    MachOSpan span = { NULL, 0 };
+    if (!ctx) return span;
+    if (offset > ctx->slice_size || size > ctx->slice_size - offset) return span;
+    
+    span.data = macho_file_bytes(ctx, ctx->slice_offset + offset, size);
+    span.size = span.data ? size : 0;
+    return span;
+}
+
+MachOSpan macho_section_span(const MachOContext *ctx, const SectionInfo *sect) {
+    if (!sect) return (MachOSpan){ NULL, 0 };
+    return macho_span(ctx, sect->offset, sect->size);
+}
+
+MachOSpan macho_segment_span(const MachOContext *ctx, const SegmentInfo *seg) {
+    if (!seg) return (MachOSpan){ NULL, 0 };
+    return macho_span(ctx, seg->fileoff, seg->filesize);
+}
+
+const void* macho_data_at(const MachOContext *ctx, uint64_t offset, uint64_t size) {
+    return macho_span(ctx, offset, size).data;
+}
+
+bool macho_read(const MachOContext *ctx, uint64_t offset, void *out, size_t size) {
+    if (!out) return false;
+    
+    const void *src = macho_data_at(ctx, offset, size);
+    if (!src) {
+        memset(out, 0, size);
+        return false;
+    }
+    
+    memcpy(out, src, size);
+    return true;
+}
+
+uint32_t macho_read_uint32(const MachOContext *ctx, uint64_t offset) {
+    uint32_t value = 0;
+    if (!macho_read(ctx, offset, &value, sizeof(value))) return 0;
+    return ctx->header.is_swapped ? swap_uint32(value) : value;
+}
+
+uint64_t macho_read_uint64(const MachOContext *ctx, uint64_t offset) {
+    uint64_t value = 0;
+    if (!macho_read(ctx, offset, &value, sizeof(value))) return 0;
+    return ctx->header.is_swapped ? swap_uint64(value) : value;
+}
+
+const char* macho_string_at(const MachOContext *ctx, uint64_t offset, size_t *out_len) {
+    if (out_len) *out_len = 0;
+    if (!ctx || offset >= ctx->slice_size) return NULL;
+    
+    uint64_t remaining = ctx->slice_size - offset;
+    const char *str = (const char*)macho_file_bytes(ctx, ctx->slice_offset + offset, remaining);
+    if (!str) return NULL;
+    
+    const char *nul = memchr(str, 0, (size_t)remaining);
+    if (!nul) return NULL;
+    
+    if (out_len) *out_len = (size_t)(nul - str);
+    return str;
+}
+
 #pragma mark - Fat Binary Handling
 
 bool macho_is_fat_binary(MachOContext *ctx) {
+    const uint8_t *head = ctx ? macho_file_bytes(ctx, 0, sizeof(uint32_t)) : NULL;
+    if (!head) return false;
+    
     uint32_t magic;
-    fseek(ctx->file, 0, SEEK_SET);
-    if (fread(&magic, sizeof(uint32_t), 1, ctx->file) != 1) return false;
+    memcpy(&magic, head, sizeof(uint32_t));
     return (magic == FAT_MAGIC || magic == FAT_CIGAM || 
             magic == 0xcafebabf || magic == 0xbfbafeca);
 }
 
-uint64_t macho_select_architecture(MachOContext *ctx) {
-    if (!macho_is_fat_binary(ctx)) return 0;
+uint32_t macho_enumerate_slices(MachOContext *ctx, FatSliceInfo **out_slices) {
+    if (!ctx || !out_slices) return 0;
+    *out_slices = NULL;
     
-    fseek(ctx->file, 0, SEEK_SET);
-    uint32_t magic;
-    if (fread(&magic, sizeof(uint32_t), 1, ctx->file) != 1) return 0;
-    fseek(ctx->file, 0, SEEK_SET);
+    if (!macho_is_fat_binary(ctx)) {
+        FatSliceInfo *slice = (FatSliceInfo*)calloc(1, sizeof(FatSliceInfo));
+        if (!slice) return 0;
+        
+        uint32_t header[3] = {0};
+        const uint8_t *head = macho_file_bytes(ctx, 0, sizeof(header));
+        if (head) memcpy(header, head, sizeof(header));
+        bool swap = (header[0] == MH_CIGAM_64 || header[0] == MH_CIGAM);
+        
+        slice->cputype = swap ? swap_uint32(header[1]) : header[1];
+        slice->cpusubtype = swap ? swap_uint32(header[2]) : header[2];
+        slice->offset = 0;
+        slice->size = (uint64_t)ctx->file_size;
+        *out_slices = slice;
+        return 1;
+    }
     
     struct fat_header fheader;
-    if (fread(&fheader, sizeof(struct fat_header), 1, ctx->file) != 1) return 0;
+    const uint8_t *head = macho_file_bytes(ctx, 0, sizeof(struct fat_header));
+    if (!head) return 0;
+    memcpy(&fheader, head, sizeof(struct fat_header));
     
     bool swap = (fheader.magic == FAT_CIGAM || fheader.magic == 0xbfbafeca);
     bool is_64 = (fheader.magic == 0xcafebabf || fheader.magic == 0xbfbafeca);
     uint32_t nfat_arch = swap ? swap_uint32(fheader.nfat_arch) : fheader.nfat_arch;
     
-    if (nfat_arch > 20) return 0;
+    if (nfat_arch == 0 || nfat_arch > 20) return 0;
+    
+    struct fat_arch_64 {
+        uint32_t cputype;
+        uint32_t cpusubtype;
+        uint64_t offset;
+        uint64_t size;
+        uint32_t align;
+        uint32_t reserved;
+    };
     
-    uint64_t offset = 0;
-    uint64_t arm64_offset = 0, arm64e_offset = 0, x86_64_offset = 0, arm_offset = 0, i386_offset = 0;
+    size_t entry_size = is_64 ? sizeof(struct fat_arch_64) : sizeof(struct fat_arch);
+    const uint8_t *arch_table = macho_file_bytes(ctx, sizeof(struct fat_header), (uint64_t)nfat_arch * entry_size);
+    if (!arch_table) return 0;
     
-    if (is_64) {
-        struct fat_arch_64 {
-            uint32_t cputype;
-            uint32_t cpusubtype;
-            uint64_t offset;
-            uint64_t size;
-            uint32_t align;
-            uint32_t reserved;
-        } *archs_64 = malloc(sizeof(struct fat_arch_64) * nfat_arch);
+    FatSliceInfo *slices = (FatSliceInfo*)calloc(nfat_arch, sizeof(FatSliceInfo));
+    if (!slices) return 0;
+    
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < nfat_arch; i++) {
+        FatSliceInfo *slice = &slices[count];
         
-        if (!archs_64) return 0;
-        if (fread(archs_64, sizeof(struct fat_arch_64), nfat_arch, ctx->file) != nfat_arch) {
-            free(archs_64);
-            return 0;
+        if (is_64) {
+            struct fat_arch_64 arch;
+            memcpy(&arch, arch_table + i * entry_size, sizeof(arch));
+            slice->cputype = swap ? swap_uint32(arch.cputype) : (uint32_t)arch.cputype;
+            slice->cpusubtype = swap ? swap_uint32(arch.cpusubtype) : (uint32_t)arch.cpusubtype;
+            slice->offset = swap ? swap_uint64(arch.offset) : arch.offset;
+            slice->size = swap ? swap_uint64(arch.size) : arch.size;
+            slice->align = swap ? swap_uint32(arch.align) : arch.align;
+        } else {
+            struct fat_arch arch;
+            memcpy(&arch, arch_table + i * entry_size, sizeof(arch));
+            slice->cputype = swap ? swap_uint32(arch.cputype) : (uint32_t)arch.cputype;
+            slice->cpusubtype = swap ? swap_uint32(arch.cpusubtype) : (uint32_t)arch.cpusubtype;
+            slice->offset = swap ? swap_uint32(arch.offset) : arch.offset;
+            slice->size = swap ? swap_uint32(arch.size) : arch.size;
+            slice->align = swap ? swap_uint32(arch.align) : arch.align;
         }
         
-        for (uint32_t i = 0; i < nfat_arch; i++) {
-            uint32_t cputype = swap ? swap_uint32(archs_64[i].cputype) : archs_64[i].cputype;
-            uint32_t cpusubtype = swap ? swap_uint32(archs_64[i].cpusubtype) : archs_64[i].cpusubtype;
-            uint64_t arch_offset = swap ? swap_uint64(archs_64[i].offset) : archs_64[i].offset;
-            
-            cpusubtype &= ~CPU_SUBTYPE_MASK;
-            
-            if (cputype == CPU_TYPE_ARM64) {
-                if (cpusubtype == 2) {
-                    arm64e_offset = arch_offset;
-                } else if (arm64_offset == 0) {
-                    arm64_offset = arch_offset;
-                }
-            } else if (cputype == CPU_TYPE_X86_64 && x86_64_offset == 0) {
-                x86_64_offset = arch_offset;
-            } else if (cputype == CPU_TYPE_ARM && arm_offset == 0) {
-                arm_offset = arch_offset;
-            } else if (cputype == CPU_TYPE_X86 && i386_offset == 0) {
-                i386_offset = arch_offset;
-            }
+        // Skip entries pointing outside the file rather than failing the whole table
+        if (slice->offset >= (uint64_t)ctx->file_size) continue;
+        if (slice->size == 0 || slice->size > (uint64_t)ctx->file_size - slice->offset) {
+            slice->size = (uint64_t)ctx->file_size - slice->offset;
         }
-        free(archs_64);
-    } else {
-        struct fat_arch *archs = malloc(sizeof(struct fat_arch) * nfat_arch);
-        if (!archs) return 0;
+        count++;
+    }
+    
+    if (count == 0) {
+        free(slices);
+        return 0;
+    }
+    
+    *out_slices = slices;
+    return count;
+}
+
+int32_t macho_preferred_slice(const FatSliceInfo *slices, uint32_t count) {
+    if (!slices || count == 0) return -1;
+    
+    int32_t arm64_index = -1, arm64e_index = -1, x86_64_index = -1, arm_index = -1, i386_index = -1;
+    
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t cputype = slices[i].cputype;
+        uint32_t cpusubtype = slices[i].cpusubtype & ~CPU_SUBTYPE_MASK;
         
-        if (fread(archs, sizeof(struct fat_arch), nfat_arch, ctx->file) != nfat_arch) {
-            free(archs);
-            return 0;
-        }
+        // Slices at offset 0 would alias the fat header itself; never prefer them
+        if (slices[i].offset == 0) continue;
         
-        for (uint32_t i = 0; i < nfat_arch; i++) {
-            uint32_t cputype = swap ? swap_uint32(archs[i].cputype) : archs[i].cputype;
-            uint32_t cpusubtype = swap ? swap_uint32(archs[i].cpusubtype) : archs[i].cpusubtype;
-            uint32_t arch_offset = swap ? swap_uint32(archs[i].offset) : archs[i].offset;
-            
-            cpusubtype &= ~CPU_SUBTYPE_MASK;
-            
-            if (cputype == CPU_TYPE_ARM64) {
-                if (cpusubtype == 2) {
-                    arm64e_offset = arch_offset;
-                } else if (arm64_offset == 0) {
-                    arm64_offset = arch_offset;
-                }
-            } else if (cputype == CPU_TYPE_X86_64 && x86_64_offset == 0) {
-                x86_64_offset = arch_offset;
-            } else if (cputype == CPU_TYPE_ARM && arm_offset == 0) {
-                arm_offset = arch_offset;
-            } else if (cputype == CPU_TYPE_X86 && i386_offset == 0) {
-                i386_offset = arch_offset;
+        if (cputype == CPU_TYPE_ARM64) {
+            if (cpusubtype == 2) {
+                arm64e_index = (int32_t)i;
+            } else if (arm64_index < 0) {
+                arm64_index = (int32_t)i;
             }
+        } else if (cputype == CPU_TYPE_X86_64 && x86_64_index < 0) {
+            x86_64_index = (int32_t)i;
+        } else if (cputype == CPU_TYPE_ARM && arm_index < 0) {
+            arm_index = (int32_t)i;
+        } else if (cputype == CPU_TYPE_X86 && i386_index < 0) {
+            i386_index = (int32_t)i;
         }
-        free(archs);
     }
     
-    if (arm64e_offset > 0) {
-        offset = arm64e_offset;
-    } else if (arm64_offset > 0) {
-        offset = arm64_offset;
-    } else if (x86_64_offset > 0) {
-        offset = x86_64_offset;
-    } else if (arm_offset > 0) {
-        offset = arm_offset;
-    } else if (i386_offset > 0) {
-        offset = i386_offset;
-    }
+    if (arm64e_index >= 0) return arm64e_index;
+    if (arm64_index >= 0) return arm64_index;
+    if (x86_64_index >= 0) return x86_64_index;
+    if (arm_index >= 0) return arm_index;
+    return i386_index;
+}
+
+uint64_t macho_select_architecture(MachOContext *ctx) {
+    if (!macho_is_fat_binary(ctx)) return 0;
+    
+    FatSliceInfo *slices = NULL;
+    uint32_t count = macho_enumerate_slices(ctx, &slices);
+    if (count == 0) return 0;
+    
+    int32_t index = macho_preferred_slice(slices, count);
+    uint64_t offset = index >= 0 ? slices[index].offset : 0;
+    free(slices);
     
     return offset;
 }
@@ -320,13 +492,30 @@ uint64_t macho_select_architecture(MachOContext *ctx) {
 #pragma mark - Header Parsing
 
 bool macho_parse_header(MachOContext *ctx) {
-    if (!ctx || !ctx->file) return false;
+    if (!ctx) return false;
+    
+    if (!macho_is_fat_binary(ctx)) return macho_parse_header_at(ctx, 0, (uint64_t)ctx->file_size);
     
-    uint64_t arch_offset = macho_select_architecture(ctx);
-    fseek(ctx->file, arch_offset, SEEK_SET);
+    // Bind to the preferred slice's own extent, so only its pages are mapped
+    FatSliceInfo *slices = NULL;
+    uint32_t count = macho_enumerate_slices(ctx, &slices);
+    int32_t index = macho_preferred_slice(slices, count);
+    
+    bool ok = index >= 0 && macho_parse_header_at(ctx, slices[index].offset, slices[index].size);
+    free(slices);
+    return ok;
+}
+
+bool macho_parse_header_at(MachOContext *ctx, uint64_t slice_offset, uint64_t slice_size) {
+    if (!ctx) return false;
+    if (slice_offset >= (uint64_t)ctx->file_size || slice_size > (uint64_t)ctx->file_size - slice_offset) return false;
     
-    if (fread(&ctx->header.magic, sizeof(uint32_t), 1, ctx->file) != 1) return false;
-    fseek(ctx->file, arch_offset, SEEK_SET);
+    if (!macho_file_bytes(ctx, slice_offset, slice_size) && !macho_map_range(ctx, slice_offset, slice_size)) return false;
+    
+    ctx->slice_offset = slice_offset;
+    ctx->slice_size = slice_size;
+    
+    if (!macho_read(ctx, 0, &ctx->header.magic, sizeof(uint32_t))) return false;
     
     if (!macho_is_valid_magic(ctx->header.magic)) return false;
     
@@ -335,7 +524,7 @@ bool macho_parse_header(MachOContext *ctx) {
     
     if (ctx->header.is_64bit) {
         struct mach_header_64 header;
-        if (fread(&header, sizeof(struct mach_header_64), 1, ctx->file) != 1) return false;
+        if (!macho_read(ctx, 0, &header, sizeof(struct mach_header_64))) return false;
         
         if (ctx->header.is_swapped) {
             ctx->header.cputype = swap_uint32(header.cputype);
@@ -356,7 +545,7 @@ bool macho_parse_header(MachOContext *ctx) {
         }
     } else {
         struct mach_header header;
-        if (fread(&header, sizeof(struct mach_header), 1, ctx->file) != 1) return false;
+        if (!macho_read(ctx, 0, &header, sizeof(struct mach_header))) return false;
         
         if (ctx->header.is_swapped) {
             ctx->header.cputype = swap_uint32(header.cputype);
@@ -382,34 +571,35 @@ bool macho_parse_header(MachOContext *ctx) {
 #pragma mark - Load Command Parsing
 
 bool macho_parse_load_commands(MachOContext *ctx) {
-    if (!ctx || !ctx->file || ctx->header.ncmds == 0) return false;
+    if (!ctx || ctx->header.ncmds == 0) return false;
     
     ctx->load_command_count = ctx->header.ncmds;
     ctx->load_commands = calloc(ctx->load_command_count, sizeof(LoadCommandInfo));
     if (!ctx->load_commands) return false;
     
+    uint64_t cmd_offset = ctx->header.is_64bit ? sizeof(struct mach_header_64) : sizeof(struct mach_header);
+    
     for (uint32_t i = 0; i < ctx->header.ncmds; i++) {
         struct load_command lc;
-        long cmd_offset = ftell(ctx->file);
-        
-        if (fread(&lc, sizeof(struct load_command), 1, ctx->file) != 1) return false;
+        if (!macho_read(ctx, cmd_offset, &lc, sizeof(struct load_command))) return false;
         
         if (ctx->header.is_swapped) {
             lc.cmd = swap_uint32(lc.cmd);
             lc.cmdsize = swap_uint32(lc.cmdsize);
         }
         
+        if (lc.cmdsize < sizeof(struct load_command)) return false;
+        
+        const void *cmd_data = macho_data_at(ctx, cmd_offset, lc.cmdsize);
+        if (!cmd_data) return false;
+        
         ctx->load_commands[i].cmd = lc.cmd;
         ctx->load_commands[i].cmdsize = lc.cmdsize;
-        ctx->load_commands[i].data = malloc(lc.cmdsize);
-        if (!ctx->load_commands[i].data) return false;
-        
-        fseek(ctx->file, cmd_offset, SEEK_SET);
-        if (fread(ctx->load_commands[i].data, lc.cmdsize, 1, ctx->file) != 1) return false;
+        ctx->load_commands[i].data = cmd_data;
         
         switch (lc.cmd) {
             case LC_SYMTAB: {
-                struct symtab_command *symtab = (struct symtab_command*)ctx->load_commands[i].data;
+                const struct symtab_command *symtab = (const struct symtab_command*)cmd_data;
                 ctx->symtab_offset = ctx->header.is_swapped ? swap_uint32(symtab->symoff) : symtab->symoff;
                 ctx->nsyms = ctx->header.is_swapped ? swap_uint32(symtab->nsyms) : symtab->nsyms;
                 ctx->stroff = ctx->header.is_swapped ? swap_uint32(symtab->stroff) : symtab->stroff;
@@ -417,13 +607,12 @@ bool macho_parse_load_commands(MachOContext *ctx) {
                 break;
             }
             case LC_DYSYMTAB: {
-                struct dysymtab_command *dysym = (struct dysymtab_command*)ctx->load_commands[i].data;
-                ctx->dysymtab_offset = ftell(ctx->file);
+                ctx->dysymtab_offset = (uint32_t)cmd_offset;
                 break;
             }
             case LC_DYLD_INFO:
             case LC_DYLD_INFO_ONLY: {
-                struct dyld_info_command *dyld = (struct dyld_info_command*)ctx->load_commands[i].data;
+                const struct dyld_info_command *dyld = (const struct dyld_info_command*)cmd_data;
                 ctx->has_dyld_info = true;
                 ctx->rebase_off = ctx->header.is_swapped ? swap_uint32(dyld->rebase_off) : dyld->rebase_off;
                 ctx->rebase_size = ctx->header.is_swapped ? swap_uint32(dyld->rebase_size) : dyld->rebase_size;
@@ -433,9 +622,29 @@ bool macho_parse_load_commands(MachOContext *ctx) {
                 ctx->export_size = ctx->header.is_swapped ? swap_uint32(dyld->export_size) : dyld->export_size;
                 break;
             }
+            case LC_DYLD_CHAINED_FIXUPS: {
+                const struct linkedit_data_command *fixups = (const struct linkedit_data_command*)cmd_data;
+                ctx->has_chained_fixups = true;
+                ctx->chained_fixups_off = ctx->header.is_swapped ? swap_uint32(fixups->dataoff) : fixups->dataoff;
+                ctx->chained_fixups_size = ctx->header.is_swapped ? swap_uint32(fixups->datasize) : fixups->datasize;
+                break;
+            }
+            case LC_FUNCTION_STARTS: {
+                const struct linkedit_data_command *starts = (const struct linkedit_data_command*)cmd_data;
+                ctx->has_function_starts = true;
+                ctx->function_starts_off = ctx->header.is_swapped ? swap_uint32(starts->dataoff) : starts->dataoff;
+                ctx->function_starts_size = ctx->header.is_swapped ? swap_uint32(starts->datasize) : starts->datasize;
+                break;
+            }
+            case LC_DYLD_EXPORTS_TRIE: {
+                const struct linkedit_data_command *trie = (const struct linkedit_data_command*)cmd_data;
+                ctx->export_off = ctx->header.is_swapped ? swap_uint32(trie->dataoff) : trie->dataoff;
+                ctx->export_size = ctx->header.is_swapped ? swap_uint32(trie->datasize) : trie->datasize;
+                break;
+            }
             case LC_ENCRYPTION_INFO:
             case LC_ENCRYPTION_INFO_64: {
-                struct encryption_info_command *enc = (struct encryption_info_command*)ctx->load_commands[i].data;
+                const struct encryption_info_command *enc = (const struct encryption_info_command*)cmd_data;
                 ctx->cryptid = ctx->header.is_swapped ? swap_uint32(enc->cryptid) : enc->cryptid;
                 ctx->is_encrypted = (ctx->cryptid != 0);
                 ctx->cryptoff = ctx->header.is_swapped ? swap_uint32(enc->cryptoff) : enc->cryptoff;
@@ -443,12 +652,14 @@ bool macho_parse_load_commands(MachOContext *ctx) {
                 break;
             }
             case LC_UUID: {
-                struct uuid_command *uuid = (struct uuid_command*)ctx->load_commands[i].data;
+                const struct uuid_command *uuid = (const struct uuid_command*)cmd_data;
                 memcpy(ctx->uuid, uuid->uuid, 16);
                 ctx->has_uuid = true;
                 break;
             }
         }
+        
+        cmd_offset += lc.cmdsize;
     }
     
     return true;
@@ -474,7 +685,8 @@ uint32_t macho_extract_segments(MachOContext *ctx) {
     ctx->segment_count = 0;
     for (uint32_t i = 0; i < ctx->load_command_count; i++) {
         if (ctx->load_commands[i].cmd == LC_SEGMENT_64) {
-            struct segment_command_64 *seg = (struct segment_command_64*)ctx->load_commands[i].data;
+            if (ctx->load_commands[i].cmdsize < sizeof(struct segment_command_64)) continue;
+            const struct segment_command_64 *seg = (const struct segment_command_64*)ctx->load_commands[i].data;
             SegmentInfo *info = &ctx->segments[ctx->segment_count++];
             
             strncpy(info->segname, seg->segname, 16);
@@ -487,7 +699,8 @@ uint32_t macho_extract_segments(MachOContext *ctx) {
             info->nsects = ctx->header.is_swapped ? swap_uint32(seg->nsects) : seg->nsects;
             info->flags = ctx->header.is_swapped ? swap_uint32(seg->flags) : seg->flags;
         } else if (ctx->load_commands[i].cmd == LC_SEGMENT) {
-            struct segment_command *seg = (struct segment_command*)ctx->load_commands[i].data;
+            if (ctx->load_commands[i].cmdsize < sizeof(struct segment_command)) continue;
+            const struct segment_command *seg = (const struct segment_command*)ctx->load_commands[i].data;
             SegmentInfo *info = &ctx->segments[ctx->segment_count++];
             
             strncpy(info->segname, seg->segname, 16);
@@ -513,7 +726,10 @@ uint32_t macho_extract_sections(MachOContext *ctx) {
         sect_count += ctx->segments[i].nsects;
     }
     
-    if (sect_count == 0) return 0;
+    if (sect_count == 0) {
+        build_address_index(ctx);
+        return 0;
+    }
     
     ctx->sections = calloc(sect_count, sizeof(SectionInfo));
     if (!ctx->sections) return 0;
@@ -522,9 +738,14 @@ uint32_t macho_extract_sections(MachOContext *ctx) {
     
     for (uint32_t i = 0; i < ctx->load_command_count; i++) {
         if (ctx->load_commands[i].cmd == LC_SEGMENT_64) {
-            struct segment_command_64 *seg = (struct segment_command_64*)ctx->load_commands[i].data;
+            const struct segment_command_64 *seg = (const struct segment_command_64*)ctx->load_commands[i].data;
             uint32_t nsects = ctx->header.is_swapped ? swap_uint32(seg->nsects) : seg->nsects;
-            struct section_64 *sections = (struct section_64*)((char*)seg + sizeof(struct segment_command_64));
+            uint32_t cmdsize = ctx->load_commands[i].cmdsize;
+            uint32_t max_nsects = cmdsize > sizeof(struct segment_command_64)
+                ? (uint32_t)((cmdsize - sizeof(struct segment_command_64)) / sizeof(struct section_64)) : 0;
+            if (nsects > max_nsects) nsects = max_nsects;
+            if (nsects > sect_count - ctx->section_count) nsects = sect_count - ctx->section_count;
+            const struct section_64 *sections = (const struct section_64*)((const char*)seg + sizeof(struct segment_command_64));
             
             for (uint32_t j = 0; j < nsects; j++) {
                 SectionInfo *info = &ctx->sections[ctx->section_count++];
@@ -535,10 +756,269 @@ uint32_t macho_extract_sections(MachOContext *ctx) {
                 info->offset = ctx->header.is_swapped ? swap_uint32(sections[j].offset) : sections[j].offset;
                 info->align = ctx->header.is_swapped ? swap_uint32(sections[j].align) : sections[j].align;
                 info->flags = ctx->header.is_swapped ? swap_uint32(sections[j].flags) : sections[j].flags;
+                info->reserved1 = ctx->header.is_swapped ? swap_uint32(sections[j].reserved1) : sections[j].reserved1;
+                info->reserved2 = ctx->header.is_swapped ? swap_uint32(sections[j].reserved2) : sections[j].reserved2;
             }
         }
     }
     
+    build_address_index(ctx);
     return ctx->section_count;
 }
 
+#pragma mark - Address Index
+
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+    uint32_t index;
+} MachOInterval;
+
+struct MachOAddressIndex {
+    MachOInterval *segments;
+    uint32_t segment_count;
+    MachOInterval *sections;
+    uint32_t section_count;
+    
+    // Open-addressed (segname, sectname) -> section index, -1 marks an empty slot
+    int32_t *section_slots;
+    uint32_t slot_mask;
+};
+
+static void address_index_free(MachOAddressIndex *index) {
+    if (!index) return;
+    free(index->segments);
+    free(index->sections);
+    free(index->section_slots);
+    free(index);
+}
+
+static uint32_t hash_section_name(const char *segname, const char *sectname) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < 16 && segname[i]; i++) {
+        hash = (hash ^ (uint8_t)segname[i]) * 16777619u;
+    }
+    hash = (hash ^ 0xFF) * 16777619u;
+    for (size_t i = 0; i < 16 && sectname[i]; i++) {
+        hash = (hash ^ (uint8_t)sectname[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static int compare_intervals(const void *a, const void *b) {
+    uint64_t sa = ((const MachOInterval*)a)->start;
+    uint64_t sb = ((const MachOInterval*)b)->start;
+    return (sa > sb) - (sa < sb);
+}
+
+static void build_address_index(MachOContext *ctx) {
+    if (ctx->address_index) {
+        address_index_free(ctx->address_index);
+        ctx->address_index = NULL;
+    }
+    
+    MachOAddressIndex *index = calloc(1, sizeof(MachOAddressIndex));
+    if (!index) return;
+    
+    index->segments = calloc(ctx->segment_count ? ctx->segment_count : 1, sizeof(MachOInterval));
+    index->sections = calloc(ctx->section_count ? ctx->section_count : 1, sizeof(MachOInterval));
+    
+    uint32_t slot_count = 16;
+    while (slot_count < ctx->section_count * 2) slot_count <<= 1;
+    index->section_slots = malloc(slot_count * sizeof(int32_t));
+    
+    if (!index->segments || !index->sections || !index->section_slots) {
+        address_index_free(index);
+        return;
+    }
+    
+    // Only the file-backed part of a segment translates to an offset
+    for (uint32_t i = 0; i < ctx->segment_count; i++) {
+        const SegmentInfo *seg = &ctx->segments[i];
+        uint64_t backed = seg->filesize < seg->vmsize ? seg->filesize : seg->vmsize;
+        if (backed == 0) continue;
+        
+        MachOInterval *iv = &index->segments[index->segment_count++];
+        iv->start = seg->vmaddr;
+        iv->end = seg->vmaddr + backed;
+        iv->index = i;
+    }
+    qsort(index->segments, index->segment_count, sizeof(MachOInterval), compare_intervals);
+    
+    for (uint32_t i = 0; i < ctx->section_count; i++) {
+        const SectionInfo *sect = &ctx->sections[i];
+        if (sect->size == 0) continue;
+        
+        MachOInterval *iv = &index->sections[index->section_count++];
+        iv->start = sect->addr;
+        iv->end = sect->addr + sect->size;
+        iv->index = i;
+    }
+    qsort(index->sections, index->section_count, sizeof(MachOInterval), compare_intervals);
+    
+    memset(index->section_slots, 0xFF, slot_count * sizeof(int32_t));
+    index->slot_mask = slot_count - 1;
+    for (uint32_t i = 0; i < ctx->section_count; i++) {
+        const SectionInfo *sect = &ctx->sections[i];
+        uint32_t slot = hash_section_name(sect->segname, sect->sectname) & index->slot_mask;
+        
+        // Keep the first occurrence so lookups agree with a load-order scan
+        bool duplicate = false;
+        while (index->section_slots[slot] >= 0) {
+            const SectionInfo *other = &ctx->sections[index->section_slots[slot]];
+            if (strncmp(other->segname, sect->segname, 16) == 0 &&
+                strncmp(other->sectname, sect->sectname, 16) == 0) {
+                duplicate = true;
+                break;
+            }
+            slot = (slot + 1) & index->slot_mask;
+        }
+        if (!duplicate) index->section_slots[slot] = (int32_t)i;
+    }
+    
+    ctx->address_index = index;
+}
+
+static const MachOInterval* find_interval(const MachOInterval *intervals, uint32_t count, uint64_t addr) {
+    uint32_t lo = 0;
+    uint32_t hi = count;
+    
+    // Last interval whose start is <= addr
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (intervals[mid].start <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    
+    if (lo == 0) return NULL;
+    const MachOInterval *iv = &intervals[lo - 1];
+    return addr < iv->end ? iv : NULL;
+}
+
+const SegmentInfo* macho_segment_for_address(const MachOContext *ctx, uint64_t vmaddr) {
+    if (!ctx || !ctx->segments) return NULL;
+    
+    const MachOAddressIndex *index = ctx->address_index;
+    if (index) {
+        const MachOInterval *iv = find_interval(index->segments, index->segment_count, vmaddr);
+        return iv ? &ctx->segments[iv->index] : NULL;
+    }
+    
+    for (uint32_t i = 0; i < ctx->segment_count; i++) {
+        const SegmentInfo *seg = &ctx->segments[i];
+        uint64_t backed = seg->filesize < seg->vmsize ? seg->filesize : seg->vmsize;
+        if (vmaddr >= seg->vmaddr && vmaddr - seg->vmaddr < backed) return seg;
+    }
+    
+    return NULL;
+}
+
+uint64_t macho_vm_to_offset(const MachOContext *ctx, uint64_t vmaddr) {
+    const SegmentInfo *seg = macho_segment_for_address(ctx, vmaddr);
+    if (!seg) return 0;
+    return seg->fileoff + (vmaddr - seg->vmaddr);
+}
+
+const SectionInfo* macho_section_for_address(const MachOContext *ctx, uint64_t vmaddr) {
+    if (!ctx || !ctx->sections) return NULL;
+    
+    const MachOAddressIndex *index = ctx->address_index;
+    if (index) {
+        const MachOInterval *iv = find_interval(index->sections, index->section_count, vmaddr);
+        return iv ? &ctx->sections[iv->index] : NULL;
+    }
+    
+    for (uint32_t i = 0; i < ctx->section_count; i++) {
+        const SectionInfo *sect = &ctx->sections[i];
+        if (vmaddr >= sect->addr && vmaddr - sect->addr < sect->size) return sect;
+    }
+    
+    return NULL;
+}
+
+const SectionInfo* macho_find_section(const MachOContext *ctx, const char *segname, const char *sectname) {
+    if (!ctx || !ctx->sections || !sectname) return NULL;
+    
+    const MachOAddressIndex *index = ctx->address_index;
+    if (segname && index) {
+        uint32_t slot = hash_section_name(segname, sectname) & index->slot_mask;
+        while (index->section_slots[slot] >= 0) {
+            const SectionInfo *sect = &ctx->sections[index->section_slots[slot]];
+            if (strncmp(sect->segname, segname, 16) == 0 && strncmp(sect->sectname, sectname, 16) == 0) {
+                return sect;
+            }
+            slot = (slot + 1) & index->slot_mask;
+        }
+        return NULL;
+    }
+    
+    for (uint32_t i = 0; i < ctx->section_count; i++) {
+        const SectionInfo *sect = &ctx->sections[i];
+        if (segname && strncmp(sect->segname, segname, 16) != 0) continue;
+        if (strncmp(sect->sectname, sectname, 16) == 0) return sect;
+    }
+    
+    return NULL;
+}
+
+#pragma mark - Function Starts
+
+uint64_t* macho_function_starts(const MachOContext *ctx, uint32_t *out_count) {
+    if (out_count) *out_count = 0;
+    if (!ctx || !out_count || !ctx->has_function_starts || ctx->function_starts_size == 0) return NULL;
+    
+    // Deltas are relative to the segment holding the Mach-O header
+    uint64_t address = 0;
+    bool has_text = false;
+    for (uint32_t i = 0; i < ctx->segment_count; i++) {
+        if (strncmp(ctx->segments[i].segname, "__TEXT", 16) == 0) {
+            address = ctx->segments[i].vmaddr;
+            has_text = true;
+            break;
+        }
+    }
+    if (!has_text) return NULL;
+    
+    MachOSpan span = macho_span(ctx, ctx->function_starts_off, ctx->function_starts_size);
+    if (!span.data) return NULL;
+    
+    const uint8_t *ptr = span.data;
+    const uint8_t *end = span.data + span.size;
+    
+    // Every start takes at least one byte
+    uint64_t *starts = (uint64_t*)malloc(span.size * sizeof(uint64_t));
+    if (!starts) return NULL;
+    
+    uint32_t count = 0;
+    while (ptr < end) {
+        uint64_t delta = 0;
+        uint32_t shift = 0;
+        uint8_t byte;
+        do {
+            if (ptr >= end || shift > 63) {
+                byte = 0;
+                delta = 0;
+                break;
+            }
+            byte = *ptr++;
+            delta |= (uint64_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        
+        if (delta == 0) break;
+        address += delta;
+        starts[count++] = address;
+    }
+    
+    if (count == 0) {
+        free(starts);
+        return NULL;
+    }
+    
+    *out_count = count;
+    return starts;
+}
+
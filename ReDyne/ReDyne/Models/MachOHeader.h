@@ -10,7 +10,7 @@
 
 #pragma mark - Constants
 
-#define MAX_FILE_SIZE (200 * 1024 * 1024)
+#define MACHO_LARGE_FILE_THRESHOLD (256ULL * 1024 * 1024)
 #define PREFERRED_ARCH_ARM64E CPU_TYPE_ARM64
 #define PREFERRED_ARCH_ARM64 CPU_TYPE_ARM64
 #define PREFERRED_ARCH_X86_64 CPU_TYPE_X86_64
@@ -52,17 +52,44 @@ typedef struct {
     uint32_t reloff;
     uint32_t nreloc;
     uint32_t flags;
+    
+    // Symbol stubs: first indirect symbol table index and stub size
+    uint32_t reserved1;
+    uint32_t reserved2;
 } SectionInfo;
 
 typedef struct {
     uint32_t cmd;
     uint32_t cmdsize;
-    void *data;
+    const void *data;
 } LoadCommandInfo;
 
 typedef struct {
-    FILE *file;
+    const uint8_t *data;
+    uint64_t size;
+} MachOSpan;
+
+typedef struct {
+    uint32_t cputype;
+    uint32_t cpusubtype;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t align;
+} FatSliceInfo;
+
+typedef struct ChainedFixupsInfo ChainedFixupsInfo;
+typedef struct MachOAddressIndex MachOAddressIndex;
+
+typedef struct {
+    int fd;
+    const uint8_t *map_base;
+    uint64_t map_offset;
+    size_t map_size;
+    const uint8_t *head_base;
+    size_t head_size;
     long file_size;
+    uint64_t slice_offset;
+    uint64_t slice_size;
     MachOHeaderInfo header;
     
     uint32_t load_command_count;
@@ -71,6 +98,7 @@ typedef struct {
     SegmentInfo *segments;
     uint32_t section_count;
     SectionInfo *sections;
+    MachOAddressIndex *address_index;
     uint32_t symtab_offset;
     uint32_t nsyms;
     uint32_t stroff;
@@ -84,6 +112,13 @@ typedef struct {
     uint32_t lazy_bind_off, lazy_bind_size;
     uint32_t export_off, export_size;
     
+    bool has_chained_fixups;
+    uint32_t chained_fixups_off, chained_fixups_size;
+    ChainedFixupsInfo *chained_fixups;
+    
+    bool has_function_starts;
+    uint32_t function_starts_off, function_starts_size;
+    
     bool is_encrypted;
     uint32_t cryptoff;
     uint32_t cryptsize;
@@ -112,6 +147,67 @@ bool macho_is_fat_binary(MachOContext *ctx);
 
 uint64_t macho_select_architecture(MachOContext *ctx);
 
+// Lists every architecture in the file (a thin binary yields one slice covering
+// the whole file). The caller frees *out_slices.
+uint32_t macho_enumerate_slices(MachOContext *ctx, FatSliceInfo **out_slices);
+
+// Index of the slice macho_parse_header() would pick (arm64e > arm64 > x86_64 >
+// arm > i386), or -1 if none is usable.
+int32_t macho_preferred_slice(const FatSliceInfo *slices, uint32_t count);
+
+// Like macho_parse_header(), but binds the context to an explicit slice instead
+// of the preferred architecture. For a universal binary this maps the slice's
+// pages and replaces any earlier slice mapping, so it has to happen before the
+// load commands are parsed.
+bool macho_parse_header_at(MachOContext *ctx, uint64_t slice_offset, uint64_t slice_size);
+
+#pragma mark - Address Translation
+
+// Backed by sorted interval tables and a (segname, sectname) hash built at the
+// end of macho_extract_sections(); both fall back to linear scans without it.
+
+// Slice-relative file offset of a VM address, or 0 if no segment maps it to
+// file bytes (zero-fill tails included).
+uint64_t macho_vm_to_offset(const MachOContext *ctx, uint64_t vmaddr);
+
+const SegmentInfo* macho_segment_for_address(const MachOContext *ctx, uint64_t vmaddr);
+
+const SectionInfo* macho_section_for_address(const MachOContext *ctx, uint64_t vmaddr);
+
+// A NULL segname matches the first section called sectname in load order.
+const SectionInfo* macho_find_section(const MachOContext *ctx, const char *segname, const char *sectname);
+
+#pragma mark - Function Starts
+
+// Addresses listed by LC_FUNCTION_STARTS, ascending: ULEB128 deltas from the
+// __TEXT vmaddr up to the first zero delta. Returns a malloc'd array of
+// *out_count entries, NULL when the command is missing or empty.
+uint64_t* macho_function_starts(const MachOContext *ctx, uint32_t *out_count);
+
+#pragma mark - Mapped Data Access
+
+// All offsets are relative to the selected slice; returned pointers alias the
+// read-only file mapping and stay valid until macho_close(). A thin file is
+// mapped whole. A universal binary maps only its header page at open and then
+// the selected slice, so each context of a multi-GB fat file reserves address
+// space for one architecture. Mappings above MACHO_LARGE_FILE_THRESHOLD are
+// made for random access, without read-ahead.
+MachOSpan macho_span(const MachOContext *ctx, uint64_t offset, uint64_t size);
+
+MachOSpan macho_section_span(const MachOContext *ctx, const SectionInfo *sect);
+
+MachOSpan macho_segment_span(const MachOContext *ctx, const SegmentInfo *seg);
+
+const void* macho_data_at(const MachOContext *ctx, uint64_t offset, uint64_t size);
+
+bool macho_read(const MachOContext *ctx, uint64_t offset, void *out, size_t size);
+
+uint32_t macho_read_uint32(const MachOContext *ctx, uint64_t offset);
+
+uint64_t macho_read_uint64(const MachOContext *ctx, uint64_t offset);
+
+const char* macho_string_at(const MachOContext *ctx, uint64_t offset, size_t *out_len);
+
 bool macho_is_valid_magic(uint32_t magic);
 
 const char* macho_magic_string(uint32_t magic);
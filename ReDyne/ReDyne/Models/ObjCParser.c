@@ -1,76 +1,40 @@
 #include "ObjCParser.h"
+#include "ChainedFixups.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
 // MARK: - Helper Functions
 
-static bool is_valid_address(MachOContext *ctx, uint64_t addr) {
+static bool is_valid_address(const MachOContext *ctx, uint64_t addr) {
     return addr != 0 && addr != 0xFFFFFFFFFFFFFFFF;
 }
 
-static uint64_t read_ptr_at_offset(MachOContext *ctx, uint64_t file_offset) {
-    if (!ctx || !ctx->file) return 0;
-    
-    uint64_t value = 0;
-    fseek(ctx->file, file_offset, SEEK_SET);
-    fread(&value, sizeof(uint64_t), 1, ctx->file);
-    
-    return ctx->header.is_swapped ? __builtin_bswap64(value) : value;
-}
-
-static uint32_t read_uint32_at_offset(MachOContext *ctx, uint64_t file_offset) {
-    if (!ctx || !ctx->file) return 0;
-    
-    uint32_t value = 0;
-    fseek(ctx->file, file_offset, SEEK_SET);
-    fread(&value, sizeof(uint32_t), 1, ctx->file);
-    
-    return ctx->header.is_swapped ? __builtin_bswap32(value) : value;
+static uint64_t read_ptr_at_offset(const MachOContext *ctx, uint64_t file_offset) {
+    if (!ctx) return 0;
+    return macho_read_pointer(ctx, file_offset);
 }
 
-static void read_string_at_offset(MachOContext *ctx, uint64_t file_offset, char *buffer, size_t max_len) {
-    if (!ctx || !ctx->file || !buffer) return;
-    
-    memset(buffer, 0, max_len);
-    fseek(ctx->file, file_offset, SEEK_SET);
-    
-    size_t i = 0;
-    while (i < max_len - 1) {
-        char c = fgetc(ctx->file);
-        if (c == 0 || c == EOF) break;
-        buffer[i++] = c;
-    }
-    buffer[i] = '\0';
+static uint32_t read_uint32_at_offset(const MachOContext *ctx, uint64_t file_offset) {
+    if (!ctx) return 0;
+    return macho_read_uint32(ctx, file_offset);
 }
 
-static uint64_t vm_addr_to_file_offset(MachOContext *ctx, uint64_t vm_addr) {
-    if (!ctx) return 0;
+static void read_string_at_offset(const MachOContext *ctx, uint64_t file_offset, char *buffer, size_t max_len) {
+    if (!ctx || !buffer || max_len == 0) return;
     
-    for (int i = 0; i < ctx->segment_count; i++) {
-        SegmentInfo *seg = &ctx->segments[i];
-        if (vm_addr >= seg->vmaddr && vm_addr < seg->vmaddr + seg->vmsize) {
-            uint64_t offset_in_segment = vm_addr - seg->vmaddr;
-            return seg->fileoff + offset_in_segment;
-        }
-    }
+    buffer[0] = '\0';
     
-    return 0;
-}
-
-// MARK: - Section Finding
-
-static SectionInfo* find_section(MachOContext *ctx, const char *segname, const char *sectname) {
-    if (!ctx) return NULL;
+    MachOSpan span = macho_span(ctx, file_offset, 0);
+    if (!span.data || file_offset >= ctx->slice_size) return;
     
-    for (int i = 0; i < ctx->section_count; i++) {
-        SectionInfo *sect = &ctx->sections[i];
-        if (strcmp(sect->segname, segname) == 0 && strcmp(sect->sectname, sectname) == 0) {
-            return sect;
-        }
-    }
+    size_t available = (size_t)(ctx->slice_size - file_offset);
+    size_t limit = available < max_len - 1 ? available : max_len - 1;
+    const char *str = (const char*)span.data;
+    size_t len = strnlen(str, limit);
     
-    return NULL;
+    memcpy(buffer, str, len);
+    buffer[len] = '\0';
 }
 
 // MARK: - Protocol Parsing
@@ -88,14 +52,14 @@ typedef struct {
     uint32_t flags;
 } objc_protocol_64_t;
 
-static uint32_t parse_protocol_list(MachOContext *ctx, uint64_t protocol_list_addr, char ***protocols_out) {
+static uint32_t parse_protocol_list(const MachOContext *ctx, uint64_t protocol_list_addr, char ***protocols_out) {
     *protocols_out = NULL;
     
     if (!is_valid_address(ctx, protocol_list_addr)) {
         return 0;
     }
     
-    uint64_t file_offset = vm_addr_to_file_offset(ctx, protocol_list_addr);
+    uint64_t file_offset = macho_vm_to_offset(ctx, protocol_list_addr);
     if (file_offset == 0) {
         return 0;
     }
@@ -119,21 +83,20 @@ static uint32_t parse_protocol_list(MachOContext *ctx, uint64_t protocol_list_ad
             continue;
         }
         
-        uint64_t protocol_offset = vm_addr_to_file_offset(ctx, protocol_ptr);
+        uint64_t protocol_offset = macho_vm_to_offset(ctx, protocol_ptr);
         if (protocol_offset == 0) {
             continue;
         }
         
         objc_protocol_64_t protocol;
-        fseek(ctx->file, protocol_offset, SEEK_SET);
-        fread(&protocol, sizeof(objc_protocol_64_t), 1, ctx->file);
+        macho_read_resolved(ctx, protocol_offset, &protocol, sizeof(objc_protocol_64_t));
         
         if (ctx->header.is_swapped) {
             protocol.name_ptr = __builtin_bswap64(protocol.name_ptr);
         }
         
         if (is_valid_address(ctx, protocol.name_ptr)) {
-            uint64_t name_offset = vm_addr_to_file_offset(ctx, protocol.name_ptr);
+            uint64_t name_offset = macho_vm_to_offset(ctx, protocol.name_ptr);
             if (name_offset > 0) {
                 char name_buffer[256] = {0};
                 read_string_at_offset(ctx, name_offset, name_buffer, sizeof(name_buffer));
@@ -148,13 +111,13 @@ static uint32_t parse_protocol_list(MachOContext *ctx, uint64_t protocol_list_ad
 
 // MARK: - Method Parsing
 
-static int parse_method_list(MachOContext *ctx, uint64_t method_list_vm_addr, ObjCMethodInfo **methods_out, bool is_class_method) {
+static int parse_method_list(const MachOContext *ctx, uint64_t method_list_vm_addr, ObjCMethodInfo **methods_out, bool is_class_method) {
     if (!is_valid_address(ctx, method_list_vm_addr)) {
         *methods_out = NULL;
         return 0;
     }
     
-    uint64_t file_offset = vm_addr_to_file_offset(ctx, method_list_vm_addr);
+    uint64_t file_offset = macho_vm_to_offset(ctx, method_list_vm_addr);
     if (file_offset == 0) {
         *methods_out = NULL;
         return 0;
@@ -177,8 +140,7 @@ static int parse_method_list(MachOContext *ctx, uint64_t method_list_vm_addr, Ob
     uint64_t method_offset = file_offset + 8;
     for (uint32_t i = 0; i < count; i++) {
         objc_method_64_t method;
-        fseek(ctx->file, method_offset, SEEK_SET);
-        fread(&method, sizeof(objc_method_64_t), 1, ctx->file);
+        macho_read_resolved(ctx, method_offset, &method, sizeof(objc_method_64_t));
         
         if (ctx->header.is_swapped) {
             method.name_ptr = __builtin_bswap64(method.name_ptr);
@@ -187,14 +149,14 @@ static int parse_method_list(MachOContext *ctx, uint64_t method_list_vm_addr, Ob
         }
         
         if (is_valid_address(ctx, method.name_ptr)) {
-            uint64_t name_offset = vm_addr_to_file_offset(ctx, method.name_ptr);
+            uint64_t name_offset = macho_vm_to_offset(ctx, method.name_ptr);
             if (name_offset > 0) {
                 read_string_at_offset(ctx, name_offset, methods[i].name, sizeof(methods[i].name));
             }
         }
         
         if (is_valid_address(ctx, method.types_ptr)) {
-            uint64_t types_offset = vm_addr_to_file_offset(ctx, method.types_ptr);
+            uint64_t types_offset = macho_vm_to_offset(ctx, method.types_ptr);
             if (types_offset > 0) {
                 read_string_at_offset(ctx, types_offset, methods[i].types, sizeof(methods[i].types));
             }
@@ -212,13 +174,13 @@ static int parse_method_list(MachOContext *ctx, uint64_t method_list_vm_addr, Ob
 
 // MARK: - Property Parsing
 
-static int parse_property_list(MachOContext *ctx, uint64_t property_list_vm_addr, ObjCPropertyInfo **properties_out) {
+static int parse_property_list(const MachOContext *ctx, uint64_t property_list_vm_addr, ObjCPropertyInfo **properties_out) {
     if (!is_valid_address(ctx, property_list_vm_addr)) {
         *properties_out = NULL;
         return 0;
     }
     
-    uint64_t file_offset = vm_addr_to_file_offset(ctx, property_list_vm_addr);
+    uint64_t file_offset = macho_vm_to_offset(ctx, property_list_vm_addr);
     if (file_offset == 0) {
         *properties_out = NULL;
         return 0;
@@ -241,8 +203,7 @@ static int parse_property_list(MachOContext *ctx, uint64_t property_list_vm_addr
     uint64_t property_offset = file_offset + 8;
     for (uint32_t i = 0; i < count; i++) {
         objc_property_64_t property;
-        fseek(ctx->file, property_offset, SEEK_SET);
-        fread(&property, sizeof(objc_property_64_t), 1, ctx->file);
+        macho_read_resolved(ctx, property_offset, &property, sizeof(objc_property_64_t));
         
         if (ctx->header.is_swapped) {
             property.name_ptr = __builtin_bswap64(property.name_ptr);
@@ -250,14 +211,14 @@ static int parse_property_list(MachOContext *ctx, uint64_t property_list_vm_addr
         }
         
         if (is_valid_address(ctx, property.name_ptr)) {
-            uint64_t name_offset = vm_addr_to_file_offset(ctx, property.name_ptr);
+            uint64_t name_offset = macho_vm_to_offset(ctx, property.name_ptr);
             if (name_offset > 0) {
                 read_string_at_offset(ctx, name_offset, properties[i].name, sizeof(properties[i].name));
             }
         }
         
         if (is_valid_address(ctx, property.attributes_ptr)) {
-            uint64_t attr_offset = vm_addr_to_file_offset(ctx, property.attributes_ptr);
+            uint64_t attr_offset = macho_vm_to_offset(ctx, property.attributes_ptr);
             if (attr_offset > 0) {
                 read_string_at_offset(ctx, attr_offset, properties[i].attributes, sizeof(properties[i].attributes));
             }
@@ -272,13 +233,13 @@ static int parse_property_list(MachOContext *ctx, uint64_t property_list_vm_addr
 
 // MARK: - Ivar Parsing
 
-static int parse_ivar_list(MachOContext *ctx, uint64_t ivar_list_vm_addr, ObjCIvarInfo **ivars_out) {
+static int parse_ivar_list(const MachOContext *ctx, uint64_t ivar_list_vm_addr, ObjCIvarInfo **ivars_out) {
     if (!is_valid_address(ctx, ivar_list_vm_addr)) {
         *ivars_out = NULL;
         return 0;
     }
     
-    uint64_t file_offset = vm_addr_to_file_offset(ctx, ivar_list_vm_addr);
+    uint64_t file_offset = macho_vm_to_offset(ctx, ivar_list_vm_addr);
     if (file_offset == 0) {
         *ivars_out = NULL;
         return 0;
@@ -301,8 +262,7 @@ static int parse_ivar_list(MachOContext *ctx, uint64_t ivar_list_vm_addr, ObjCIv
     uint64_t ivar_offset = file_offset + 8;
     for (uint32_t i = 0; i < count; i++) {
         objc_ivar_64_t ivar;
-        fseek(ctx->file, ivar_offset, SEEK_SET);
-        fread(&ivar, sizeof(objc_ivar_64_t), 1, ctx->file);
+        macho_read_resolved(ctx, ivar_offset, &ivar, sizeof(objc_ivar_64_t));
         
         if (ctx->header.is_swapped) {
             ivar.offset_ptr = __builtin_bswap64(ivar.offset_ptr);
@@ -313,21 +273,21 @@ static int parse_ivar_list(MachOContext *ctx, uint64_t ivar_list_vm_addr, ObjCIv
         }
         
         if (is_valid_address(ctx, ivar.offset_ptr)) {
-            uint64_t offset_file = vm_addr_to_file_offset(ctx, ivar.offset_ptr);
+            uint64_t offset_file = macho_vm_to_offset(ctx, ivar.offset_ptr);
             if (offset_file > 0) {
                 ivars[i].offset = read_uint32_at_offset(ctx, offset_file);
             }
         }
         
         if (is_valid_address(ctx, ivar.name_ptr)) {
-            uint64_t name_offset = vm_addr_to_file_offset(ctx, ivar.name_ptr);
+            uint64_t name_offset = macho_vm_to_offset(ctx, ivar.name_ptr);
             if (name_offset > 0) {
                 read_string_at_offset(ctx, name_offset, ivars[i].name, sizeof(ivars[i].name));
             }
         }
         
         if (is_valid_address(ctx, ivar.type_ptr)) {
-            uint64_t type_offset = vm_addr_to_file_offset(ctx, ivar.type_ptr);
+            uint64_t type_offset = macho_vm_to_offset(ctx, ivar.type_ptr);
             if (type_offset > 0) {
                 read_string_at_offset(ctx, type_offset, ivars[i].type, sizeof(ivars[i].type));
             }
@@ -342,15 +302,14 @@ static int parse_ivar_list(MachOContext *ctx, uint64_t ivar_list_vm_addr, ObjCIv
 
 // MARK: - Category Parsing
 
-static bool parse_category(MachOContext *ctx, uint64_t cat_vm_addr, ObjCCategoryInfo *cat_info) {
+static bool parse_category(const MachOContext *ctx, uint64_t cat_vm_addr, ObjCCategoryInfo *cat_info) {
     if (!is_valid_address(ctx, cat_vm_addr)) return false;
     
-    uint64_t cat_file_offset = vm_addr_to_file_offset(ctx, cat_vm_addr);
+    uint64_t cat_file_offset = macho_vm_to_offset(ctx, cat_vm_addr);
     if (cat_file_offset == 0) return false;
     
     objc_category_64_t cat_struct;
-    fseek(ctx->file, cat_file_offset, SEEK_SET);
-    fread(&cat_struct, sizeof(objc_category_64_t), 1, ctx->file);
+    macho_read_resolved(ctx, cat_file_offset, &cat_struct, sizeof(objc_category_64_t));
     
     if (ctx->header.is_swapped) {
         cat_struct.name_ptr = __builtin_bswap64(cat_struct.name_ptr);
@@ -364,18 +323,17 @@ static bool parse_category(MachOContext *ctx, uint64_t cat_vm_addr, ObjCCategory
     memset(cat_info, 0, sizeof(ObjCCategoryInfo));
     
     if (is_valid_address(ctx, cat_struct.name_ptr)) {
-        uint64_t name_offset = vm_addr_to_file_offset(ctx, cat_struct.name_ptr);
+        uint64_t name_offset = macho_vm_to_offset(ctx, cat_struct.name_ptr);
         if (name_offset > 0) {
             read_string_at_offset(ctx, name_offset, cat_info->name, sizeof(cat_info->name));
         }
     }
     
     if (is_valid_address(ctx, cat_struct.class_ptr)) {
-        uint64_t class_file_offset = vm_addr_to_file_offset(ctx, cat_struct.class_ptr);
+        uint64_t class_file_offset = macho_vm_to_offset(ctx, cat_struct.class_ptr);
         if (class_file_offset > 0) {
             objc_class_64_t class_struct;
-            fseek(ctx->file, class_file_offset, SEEK_SET);
-            fread(&class_struct, sizeof(objc_class_64_t), 1, ctx->file);
+            macho_read_resolved(ctx, class_file_offset, &class_struct, sizeof(objc_class_64_t));
             
             if (ctx->header.is_swapped) {
                 class_struct.data_ptr = __builtin_bswap64(class_struct.data_ptr);
@@ -383,18 +341,17 @@ static bool parse_category(MachOContext *ctx, uint64_t cat_vm_addr, ObjCCategory
             
             uint64_t ro_vm_addr = class_struct.data_ptr & ~0x7ULL;
             if (is_valid_address(ctx, ro_vm_addr)) {
-                uint64_t ro_file_offset = vm_addr_to_file_offset(ctx, ro_vm_addr);
+                uint64_t ro_file_offset = macho_vm_to_offset(ctx, ro_vm_addr);
                 if (ro_file_offset > 0) {
                     objc_class_ro_64_t ro;
-                    fseek(ctx->file, ro_file_offset, SEEK_SET);
-                    fread(&ro, sizeof(objc_class_ro_64_t), 1, ctx->file);
+                    macho_read_resolved(ctx, ro_file_offset, &ro, sizeof(objc_class_ro_64_t));
                     
                     if (ctx->header.is_swapped) {
                         ro.name_ptr = __builtin_bswap64(ro.name_ptr);
                     }
                     
                     if (is_valid_address(ctx, ro.name_ptr)) {
-                        uint64_t class_name_offset = vm_addr_to_file_offset(ctx, ro.name_ptr);
+                        uint64_t class_name_offset = macho_vm_to_offset(ctx, ro.name_ptr);
                         if (class_name_offset > 0) {
                             read_string_at_offset(ctx, class_name_offset, cat_info->class_name, sizeof(cat_info->class_name));
                         }
@@ -441,15 +398,14 @@ static bool parse_category(MachOContext *ctx, uint64_t cat_vm_addr, ObjCCategory
 
 // MARK: - Class Parsing
 
-static bool parse_class(MachOContext *ctx, uint64_t class_vm_addr, ObjCClassInfo *class_info) {
+static bool parse_class(const MachOContext *ctx, uint64_t class_vm_addr, ObjCClassInfo *class_info) {
     if (!is_valid_address(ctx, class_vm_addr)) return false;
     
-    uint64_t class_file_offset = vm_addr_to_file_offset(ctx, class_vm_addr);
+    uint64_t class_file_offset = macho_vm_to_offset(ctx, class_vm_addr);
     if (class_file_offset == 0) return false;
     
     objc_class_64_t class_struct;
-    fseek(ctx->file, class_file_offset, SEEK_SET);
-    fread(&class_struct, sizeof(objc_class_64_t), 1, ctx->file);
+    macho_read_resolved(ctx, class_file_offset, &class_struct, sizeof(objc_class_64_t));
     
     if (ctx->header.is_swapped) {
         class_struct.isa = __builtin_bswap64(class_struct.isa);
@@ -462,12 +418,11 @@ static bool parse_class(MachOContext *ctx, uint64_t class_vm_addr, ObjCClassInfo
     if (!is_valid_address(ctx, class_struct.data_ptr)) return false;
     
     uint64_t ro_vm_addr = class_struct.data_ptr & ~0x7ULL;
-    uint64_t ro_file_offset = vm_addr_to_file_offset(ctx, ro_vm_addr);
+    uint64_t ro_file_offset = macho_vm_to_offset(ctx, ro_vm_addr);
     if (ro_file_offset == 0) return false;
     
     objc_class_ro_64_t ro;
-    fseek(ctx->file, ro_file_offset, SEEK_SET);
-    fread(&ro, sizeof(objc_class_ro_64_t), 1, ctx->file);
+    macho_read_resolved(ctx, ro_file_offset, &ro, sizeof(objc_class_ro_64_t));
     
     if (ctx->header.is_swapped) {
         ro.flags = __builtin_bswap32(ro.flags);
@@ -478,7 +433,7 @@ static bool parse_class(MachOContext *ctx, uint64_t class_vm_addr, ObjCClassInfo
     }
     
     if (is_valid_address(ctx, ro.name_ptr)) {
-        uint64_t name_offset = vm_addr_to_file_offset(ctx, ro.name_ptr);
+        uint64_t name_offset = macho_vm_to_offset(ctx, ro.name_ptr);
         if (name_offset > 0) {
             read_string_at_offset(ctx, name_offset, class_info->name, sizeof(class_info->name));
         }
@@ -487,29 +442,27 @@ static bool parse_class(MachOContext *ctx, uint64_t class_vm_addr, ObjCClassInfo
     class_info->is_swift = (strncmp(class_info->name, "_Tt", 3) == 0) || (strchr(class_info->name, '.') != NULL);
     
     if (is_valid_address(ctx, class_struct.superclass)) {
-        uint64_t super_file_offset = vm_addr_to_file_offset(ctx, class_struct.superclass);
+        uint64_t super_file_offset = macho_vm_to_offset(ctx, class_struct.superclass);
         if (super_file_offset > 0) {
             objc_class_64_t super_class;
-            fseek(ctx->file, super_file_offset, SEEK_SET);
-            fread(&super_class, sizeof(objc_class_64_t), 1, ctx->file);
+            macho_read_resolved(ctx, super_file_offset, &super_class, sizeof(objc_class_64_t));
             
             if (ctx->header.is_swapped) {
                 super_class.data_ptr = __builtin_bswap64(super_class.data_ptr);
             }
             
             uint64_t super_ro_addr = super_class.data_ptr & ~0x7ULL;
-            uint64_t super_ro_offset = vm_addr_to_file_offset(ctx, super_ro_addr);
+            uint64_t super_ro_offset = macho_vm_to_offset(ctx, super_ro_addr);
             if (super_ro_offset > 0) {
                 objc_class_ro_64_t super_ro;
-                fseek(ctx->file, super_ro_offset, SEEK_SET);
-                fread(&super_ro, sizeof(objc_class_ro_64_t), 1, ctx->file);
+                macho_read_resolved(ctx, super_ro_offset, &super_ro, sizeof(objc_class_ro_64_t));
                 
                 if (ctx->header.is_swapped) {
                     super_ro.name_ptr = __builtin_bswap64(super_ro.name_ptr);
                 }
                 
                 if (is_valid_address(ctx, super_ro.name_ptr)) {
-                    uint64_t super_name_offset = vm_addr_to_file_offset(ctx, super_ro.name_ptr);
+                    uint64_t super_name_offset = macho_vm_to_offset(ctx, super_ro.name_ptr);
                     if (super_name_offset > 0) {
                         read_string_at_offset(ctx, super_name_offset, class_info->superclass_name, sizeof(class_info->superclass_name));
                     }
@@ -524,22 +477,20 @@ static bool parse_class(MachOContext *ctx, uint64_t class_vm_addr, ObjCClassInfo
     class_info->protocol_count = parse_protocol_list(ctx, ro.baseProtocols_ptr, &class_info->protocols);
     
     if (is_valid_address(ctx, class_struct.isa)) {
-        uint64_t metaclass_file_offset = vm_addr_to_file_offset(ctx, class_struct.isa);
+        uint64_t metaclass_file_offset = macho_vm_to_offset(ctx, class_struct.isa);
         if (metaclass_file_offset > 0) {
             objc_class_64_t metaclass;
-            fseek(ctx->file, metaclass_file_offset, SEEK_SET);
-            fread(&metaclass, sizeof(objc_class_64_t), 1, ctx->file);
+            macho_read_resolved(ctx, metaclass_file_offset, &metaclass, sizeof(objc_class_64_t));
             
             if (ctx->header.is_swapped) {
                 metaclass.data_ptr = __builtin_bswap64(metaclass.data_ptr);
             }
             
             uint64_t meta_ro_addr = metaclass.data_ptr & ~0x7ULL;
-            uint64_t meta_ro_offset = vm_addr_to_file_offset(ctx, meta_ro_addr);
+            uint64_t meta_ro_offset = macho_vm_to_offset(ctx, meta_ro_addr);
             if (meta_ro_offset > 0) {
                 objc_class_ro_64_t meta_ro;
-                fseek(ctx->file, meta_ro_offset, SEEK_SET);
-                fread(&meta_ro, sizeof(objc_class_ro_64_t), 1, ctx->file);
+                macho_read_resolved(ctx, meta_ro_offset, &meta_ro, sizeof(objc_class_ro_64_t));
                 
                 if (ctx->header.is_swapped) {
                     meta_ro.baseMethods_ptr = __builtin_bswap64(meta_ro.baseMethods_ptr);
@@ -555,15 +506,15 @@ static bool parse_class(MachOContext *ctx, uint64_t class_vm_addr, ObjCClassInfo
 
 // MARK: - Public Functions
 
-bool objc_has_runtime_data(MachOContext *ctx) {
-    return find_section(ctx, "__DATA", "__objc_classlist") != NULL ||
-           find_section(ctx, "__DATA_CONST", "__objc_classlist") != NULL;
+bool objc_has_runtime_data(const MachOContext *ctx) {
+    return macho_find_section(ctx, "__DATA", "__objc_classlist") != NULL ||
+           macho_find_section(ctx, "__DATA_CONST", "__objc_classlist") != NULL;
 }
 
-int objc_get_class_count(MachOContext *ctx) {
-    SectionInfo *classlist = find_section(ctx, "__DATA", "__objc_classlist");
+int objc_get_class_count(const MachOContext *ctx) {
+    const SectionInfo *classlist = macho_find_section(ctx, "__DATA", "__objc_classlist");
     if (!classlist) {
-        classlist = find_section(ctx, "__DATA_CONST", "__objc_classlist");
+        classlist = macho_find_section(ctx, "__DATA_CONST", "__objc_classlist");
     }
     
     if (!classlist) return 0;
@@ -571,16 +522,16 @@ int objc_get_class_count(MachOContext *ctx) {
     return (int)(classlist->size / sizeof(uint64_t));
 }
 
-ObjCRuntimeInfo* objc_parse_runtime(MachOContext *ctx) {
+ObjCRuntimeInfo* objc_parse_runtime(const MachOContext *ctx) {
     if (!ctx || !objc_has_runtime_data(ctx)) {
         return NULL;
     }
     
     printf("Parsing Objective-C runtime...\n");
     
-    SectionInfo *classlist = find_section(ctx, "__DATA", "__objc_classlist");
+    const SectionInfo *classlist = macho_find_section(ctx, "__DATA", "__objc_classlist");
     if (!classlist) {
-        classlist = find_section(ctx, "__DATA_CONST", "__objc_classlist");
+        classlist = macho_find_section(ctx, "__DATA_CONST", "__objc_classlist");
     }
     
     if (!classlist) {
@@ -618,9 +569,9 @@ ObjCRuntimeInfo* objc_parse_runtime(MachOContext *ctx) {
     
     runtime->class_count = parsed_count;
     
-    SectionInfo *cat_sect = find_section(ctx, "__DATA_CONST", "__objc_catlist");
+    const SectionInfo *cat_sect = macho_find_section(ctx, "__DATA_CONST", "__objc_catlist");
     if (!cat_sect) {
-        cat_sect = find_section(ctx, "__DATA", "__objc_catlist");
+        cat_sect = macho_find_section(ctx, "__DATA", "__objc_catlist");
     }
     
     runtime->category_count = 0;
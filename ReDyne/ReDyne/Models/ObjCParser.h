@@ -156,13 +156,13 @@ typedef struct ObjCRuntimeInfo {
 
 // MARK: - Public Functions
 
-ObjCRuntimeInfo* objc_parse_runtime(MachOContext *ctx);
+ObjCRuntimeInfo* objc_parse_runtime(const MachOContext *ctx);
 
 void objc_free_runtime_info(ObjCRuntimeInfo *info);
 
-bool objc_has_runtime_data(MachOContext *ctx);
+bool objc_has_runtime_data(const MachOContext *ctx);
 
-int objc_get_class_count(MachOContext *ctx);
+int objc_get_class_count(const MachOContext *ctx);
 
 #ifdef __cplusplus
 }
@@ -170,9 +170,191 @@ static Expression* create_binary_expr(Operator op, Expression *left, Expression
     return expr;
 }
 
+// MARK: - Typed ARM64 Operands
+
+// Decodes inst->raw_bytes; false when only the text of the instruction is
+// known (no bytes, data, or an Advanced SIMD encoding that is only
+// classified), which takes the text path instead
+static bool decode_instruction(const PseudocodeInstruction *inst, ARM64DecodedWord *decoded) {
+    if (inst->raw_bytes == 0) return false;
+    
+    arm64_decode_word(inst->raw_bytes, decoded);
+    return decoded->mnemonic != ARM64_MNEMONIC_WORD && decoded->mnemonic != ARM64_MNEMONIC_SIMD;
+}
+
+static void format_register_name(const ARM64DecodedOperand *operand, char *buffer, size_t size) {
+    ARM64DecodedOperand reg = {
+        .kind = ARM64_OPND_REG, .reg = operand->reg, .reg_class = operand->reg_class,
+        .arrangement = operand->arrangement, .lane = operand->lane
+    };
+    arm64_format_operand(&reg, 0, buffer, size);
+}
+
+static Expression* create_operand_expr(const ARM64DecodedOperand *operand, uint64_t address) {
+    char name[32];
+    uint64_t target = 0;
+    
+    switch (operand->kind) {
+        case ARM64_OPND_REG: {
+            format_register_name(operand, name, sizeof(name));
+            Expression *reg = create_variable_expr(name);
+            
+            if (operand->shift == ARM64_SHIFT_LSL && operand->shift_amount) {
+                return create_binary_expr(OP_SHL, reg, create_constant_expr(operand->shift_amount));
+            }
+            if ((operand->shift == ARM64_SHIFT_LSR || operand->shift == ARM64_SHIFT_ASR) && operand->shift_amount) {
+                return create_binary_expr(OP_SHR, reg, create_constant_expr(operand->shift_amount));
+            }
+            return reg;
+        }
+        case ARM64_OPND_IMM:
+        case ARM64_OPND_BITMASK:
+            return create_constant_expr((uint64_t)operand->imm);
+        case ARM64_OPND_LABEL:
+        case ARM64_OPND_PAGE:
+            arm64_operand_address(operand, address, &target);
+            return create_constant_expr(target);
+        default:
+            arm64_format_operand(operand, address, name, sizeof(name));
+            return create_variable_expr(name);
+    }
+}
+
+static Expression* create_memory_expr(const ARM64DecodedOperand *operand, uint64_t address) {
+    Expression *memExpr = calloc(1, sizeof(Expression));
+    memExpr->type = EXPR_MEMORY_ACCESS;
+    memExpr->memAccess.size = operand->access_size ? operand->access_size : 8;
+    
+    if (operand->addressing == ARM64_MEM_LITERAL) {
+        memExpr->memAccess.base = create_constant_expr(address + (uint64_t)operand->imm);
+        return memExpr;
+    }
+    
+    ARM64DecodedOperand base = { .kind = ARM64_OPND_REG, .reg = operand->reg, .reg_class = ARM64_REG_SP };
+    memExpr->memAccess.base = create_operand_expr(&base, address);
+    
+    if (operand->addressing == ARM64_MEM_REG_OFFSET) {
+        ARM64DecodedOperand index = {
+            .kind = ARM64_OPND_REG, .reg = operand->index, .reg_class = operand->reg_class,
+            .shift = operand->shift, .shift_amount = operand->shift_amount
+        };
+        memExpr->memAccess.offset = create_operand_expr(&index, address);
+    } else if (operand->addressing != ARM64_MEM_POST_INDEX && operand->imm < 0) {
+        // Frame slots below FP read better subtracted than wrapped
+        memExpr->memAccess.base = create_binary_expr(OP_SUB, memExpr->memAccess.base,
+                                                     create_constant_expr((uint64_t)-operand->imm));
+    } else if (operand->addressing != ARM64_MEM_POST_INDEX && operand->imm != 0) {
+        memExpr->memAccess.offset = create_constant_expr((uint64_t)operand->imm);
+    }
+    
+    return memExpr;
+}
+
+static const ARM64DecodedOperand* find_memory_operand(const ARM64DecodedWord *decoded) {
+    for (uint8_t i = 0; i < decoded->operand_count; i++) {
+        if (decoded->operands[i].kind == ARM64_OPND_MEM && decoded->operands[i].access) {
+            return &decoded->operands[i];
+        }
+    }
+    return NULL;
+}
+
+static Expression* create_call_expr(const char *name) {
+    Expression *callExpr = calloc(1, sizeof(Expression));
+    callExpr->type = EXPR_FUNCTION_CALL;
+    snprintf(callExpr->call.name, sizeof(callExpr->call.name), "%s", name);
+    callExpr->call.argCount = 0;
+    callExpr->call.args = NULL;
+    return callExpr;
+}
+
+// Same shapes as the text path of pseudocode_build_expression(), read from
+// the operands of the decoded word
+static Expression* build_typed_expression(const PseudocodeInstruction *inst, const ARM64DecodedWord *decoded) {
+    const ARM64DecodedOperand *operands = decoded->operands;
+    char name[64];
+    Operator op;
+    
+    switch (decoded->mnemonic) {
+        case ARM64_MNEMONIC_ADD:
+        case ARM64_MNEMONIC_ADDS:
+            op = OP_ADD;
+            break;
+        case ARM64_MNEMONIC_SUB:
+        case ARM64_MNEMONIC_SUBS:
+            op = OP_SUB;
+            break;
+        case ARM64_MNEMONIC_MUL:
+            op = OP_MUL;
+            break;
+        case ARM64_MNEMONIC_UDIV:
+        case ARM64_MNEMONIC_SDIV:
+            op = OP_DIV;
+            break;
+        case ARM64_MNEMONIC_AND:
+        case ARM64_MNEMONIC_ANDS:
+            op = OP_AND;
+            break;
+        case ARM64_MNEMONIC_ORR:
+            op = OP_OR;
+            break;
+        case ARM64_MNEMONIC_EOR:
+            op = OP_XOR;
+            break;
+        case ARM64_MNEMONIC_LSL:
+            op = OP_SHL;
+            break;
+        case ARM64_MNEMONIC_LSR:
+        case ARM64_MNEMONIC_ASR:
+            op = OP_SHR;
+            break;
+        case ARM64_MNEMONIC_ADR:
+        case ARM64_MNEMONIC_ADRP:
+        case ARM64_MNEMONIC_MOV:
+        case ARM64_MNEMONIC_MOVZ:
+        case ARM64_MNEMONIC_MOVN:
+        case ARM64_MNEMONIC_MOVK:
+            if (decoded->operand_count >= 2) return create_operand_expr(&operands[1], inst->address);
+            op = OP_ADD;
+            break;
+        case ARM64_MNEMONIC_BL:
+            snprintf(name, sizeof(name), "FUN_%08llx", (unsigned long long)(inst->address + (int64_t)decoded->branch_delta));
+            return create_call_expr(name);
+        case ARM64_MNEMONIC_BLR:
+        case ARM64_MNEMONIC_BLRAA:
+        case ARM64_MNEMONIC_BLRAB:
+        case ARM64_MNEMONIC_BLRAAZ:
+        case ARM64_MNEMONIC_BLRABZ:
+            format_register_name(&operands[0], name, sizeof(name));
+            return create_call_expr(name);
+        default: {
+            const ARM64DecodedOperand *memory = find_memory_operand(decoded);
+            if (decoded->category == INST_CATEGORY_LOAD_STORE && memory) {
+                return create_memory_expr(memory, inst->address);
+            }
+            
+            snprintf(name, sizeof(name), "__%s", inst->mnemonic[0] ? inst->mnemonic : arm64_mnemonic_name(decoded->mnemonic));
+            return create_call_expr(name);
+        }
+    }
+    
+    if (decoded->operand_count < 3) {
+        snprintf(name, sizeof(name), "__%s", inst->mnemonic[0] ? inst->mnemonic : arm64_mnemonic_name(decoded->mnemonic));
+        return create_call_expr(name);
+    }
+    
+    return create_binary_expr(op, create_operand_expr(&operands[1], inst->address),
+                              create_operand_expr(&operands[2], inst->address));
+}
+
 Expression* pseudocode_build_expression(PseudocodeContext *ctx, const PseudocodeInstruction *inst) {
     if (!ctx || !inst) return NULL;
     
+    ARM64DecodedWord decoded;
+    if (decode_instruction(inst, &decoded)) {
+        return build_typed_expression(inst, &decoded);
+    }
+    
     const char *mnemonic = inst->mnemonic;
     
     if (strncmp(mnemonic, "add", 3) == 0 || strncmp(mnemonic, "ADD", 3) == 0) {
@@ -366,20 +548,20 @@ PseudoTypeInfo* pseudocode_infer_type(PseudocodeContext *ctx, const Expression *
                 strcpy(type->name, "uint64_t");
             }
             break;
-            
+        
         case EXPR_VARIABLE:
             type->type = TYPE_UINT64;
             type->size = 8;
             strcpy(type->name, "uint64_t");
             break;
-            
+        
         case EXPR_MEMORY_ACCESS:
             type->type = TYPE_POINTER;
             type->pointerLevel = 1;
             type->size = 8;
             strcpy(type->name, "void*");
             break;
-            
+        
         case EXPR_BINARY_OP:
             {
                 PseudoTypeInfo *leftType = pseudocode_infer_type(ctx, expr->binaryOp.left);
@@ -397,7 +579,7 @@ PseudoTypeInfo* pseudocode_infer_type(PseudocodeContext *ctx, const Expression *
                 free(rightType);
             }
             break;
-            
+        
         default:
             type->type = TYPE_UNKNOWN;
             strcpy(type->name, "unknown");
@@ -450,11 +632,11 @@ char* pseudocode_format_expression(const Expression *expr) {
                 snprintf(result, 1024, "0x%llx", expr->constant.value);
             }
             break;
-            
+        
         case EXPR_VARIABLE:
             snprintf(result, 1024, "%s", expr->variable.name);
             break;
-            
+        
         case EXPR_BINARY_OP: {
             char *left = pseudocode_format_expression(expr->binaryOp.left);
             char *right = pseudocode_format_expression(expr->binaryOp.right);
@@ -464,7 +646,7 @@ char* pseudocode_format_expression(const Expression *expr) {
             free(right);
             break;
         }
-            
+        
         case EXPR_UNARY_OP: {
             char *operand = pseudocode_format_expression(expr->unaryOp.operand);
             snprintf(result, 1024, "%s%s", 
@@ -472,7 +654,7 @@ char* pseudocode_format_expression(const Expression *expr) {
             free(operand);
             break;
         }
-            
+        
         case EXPR_MEMORY_ACCESS: {
             char *base = pseudocode_format_expression(expr->memAccess.base);
             if (expr->memAccess.offset) {
@@ -485,11 +667,11 @@ char* pseudocode_format_expression(const Expression *expr) {
             free(base);
             break;
         }
-            
+        
         case EXPR_FUNCTION_CALL:
             snprintf(result, 1024, "%s(...)", expr->call.name);
             break;
-            
+        
         default:
             snprintf(result, 1024, "<expr>");
             break;
@@ -513,6 +695,92 @@ char* pseudocode_format_type(const PseudoTypeInfo *type) {
 
 // MARK: - Simple Statement Generation
 
+// B.cond by condition code, CBZ/CBNZ against zero, TBZ/TBNZ on the tested bit
+static Expression* create_condition_expr(const ARM64DecodedWord *decoded, uint64_t address) {
+    static const char *const condition_names[16] = {
+        "(flags == 0)", "(flags != 0)", "(unsigned_greater_equal)", "(unsigned_less)",
+        "(negative)", "(positive_or_zero)", "(overflow)", "(no_overflow)",
+        "(unsigned_greater)", "(unsigned_less_equal)", "(signed_greater_equal)", "(signed_less)",
+        "(signed_greater)", "(signed_less_equal)", "true", "true"
+    };
+    const ARM64DecodedOperand *operands = decoded->operands;
+    
+    switch (decoded->mnemonic) {
+        case ARM64_MNEMONIC_CBZ:
+        case ARM64_MNEMONIC_CBNZ:
+            return create_binary_expr(decoded->mnemonic == ARM64_MNEMONIC_CBZ ? OP_EQ : OP_NE,
+                                      create_operand_expr(&operands[0], address), create_constant_expr(0));
+        case ARM64_MNEMONIC_TBZ:
+        case ARM64_MNEMONIC_TBNZ: {
+            Expression *bit = create_binary_expr(OP_AND, create_operand_expr(&operands[0], address),
+                                                 create_constant_expr(1ULL << (operands[1].imm & 0x3F)));
+            return create_binary_expr(decoded->mnemonic == ARM64_MNEMONIC_TBZ ? OP_EQ : OP_NE,
+                                      bit, create_constant_expr(0));
+        }
+        default:
+            return create_variable_expr(condition_names[decoded->condition & 0xF]);
+    }
+}
+
+static Statement* build_typed_statement(const PseudocodeInstruction *inst, const ARM64DecodedWord *decoded) {
+    Statement *stmt = calloc(1, sizeof(Statement));
+    stmt->address = inst->address;
+    
+    if (decoded->branch_type == BRANCH_RETURN) {
+        stmt->type = STMT_RETURN;
+        stmt->returnStmt.value = create_variable_expr("x0");
+        return stmt;
+    }
+    
+    if (decoded->branch_type == BRANCH_CONDITIONAL || decoded->branch_type == BRANCH_UNCONDITIONAL) {
+        // Indirect branches have no target and fall through, as in the text path
+        uint64_t target = inst->address + 4;
+        if (decoded->flags & INST_FLAG_HAS_BRANCH_TARGET) {
+            target = inst->address + (int64_t)decoded->branch_delta;
+        }
+        
+        Statement *jump = stmt;
+        if (decoded->branch_type == BRANCH_CONDITIONAL) {
+            jump = calloc(1, sizeof(Statement));
+            jump->address = inst->address;
+            
+            stmt->type = STMT_IF;
+            stmt->ifStmt.condition = create_condition_expr(decoded, inst->address);
+            stmt->ifStmt.thenBlock = calloc(1, sizeof(Statement*));
+            stmt->ifStmt.thenBlock[0] = jump;
+            stmt->ifStmt.thenCount = 1;
+        }
+        
+        jump->type = STMT_GOTO;
+        snprintf(jump->gotoLabel.label, sizeof(jump->gotoLabel.label), "LAB_%08llx", (unsigned long long)target);
+        return stmt;
+    }
+    
+    Expression *expr = build_typed_expression(inst, decoded);
+    const ARM64DecodedOperand *dest = &decoded->operands[0];
+    const ARM64DecodedOperand *memory = find_memory_operand(decoded);
+    
+    if (expr->type == EXPR_MEMORY_ACCESS && memory && memory->access == ARM64_WRITE) {
+        // A store assigns to memory: *(base + offset) = Rt
+        char *target = pseudocode_format_expression(expr);
+        stmt->type = STMT_ASSIGNMENT;
+        snprintf(stmt->assignment.varName, sizeof(stmt->assignment.varName), "%s", target);
+        stmt->assignment.value = create_operand_expr(dest, inst->address);
+        free(target);
+        pseudocode_free_expression(expr);
+    } else if (decoded->branch_type != BRANCH_CALL && decoded->operand_count > 0 &&
+               dest->kind == ARM64_OPND_REG && (dest->access & ARM64_WRITE)) {
+        stmt->type = STMT_ASSIGNMENT;
+        format_register_name(dest, stmt->assignment.varName, sizeof(stmt->assignment.varName));
+        stmt->assignment.value = expr;
+    } else {
+        stmt->type = STMT_CALL;
+        stmt->callStmt.call = expr;
+    }
+    
+    return stmt;
+}
+
 Statement** pseudocode_reconstruct_control_flow(
     PseudocodeContext *ctx,
     const PseudocodeInstruction *instructions,
@@ -530,14 +798,19 @@ Statement** pseudocode_reconstruct_control_flow(
     for (int i = 0; i < count; i++) {
         const PseudocodeInstruction *inst = &instructions[i];
         Statement *stmt = NULL;
+        ARM64DecodedWord decoded;
         
-        if (strcmp(inst->mnemonic, "ret") == 0 || strcmp(inst->mnemonic, "RET") == 0) {
+        if (decode_instruction(inst, &decoded)) {
+            stmt = build_typed_statement(inst, &decoded);
+        }
+        
+        else if (strcmp(inst->mnemonic, "ret") == 0 || strcmp(inst->mnemonic, "RET") == 0) {
             stmt = calloc(1, sizeof(Statement));
             stmt->type = STMT_RETURN;
             stmt->address = inst->address;
             stmt->returnStmt.value = create_variable_expr("x0");
         }
-
+        
         else if (strncmp(inst->mnemonic, "b", 1) == 0 && strcmp(inst->mnemonic, "bl") != 0 && strcmp(inst->mnemonic, "blr") != 0) {
             stmt = calloc(1, sizeof(Statement));
             
@@ -600,12 +873,11 @@ Statement** pseudocode_reconstruct_control_flow(
                 }
             }
             
-            if (targetAddr != 0) {
+            // The label shares storage with the condition of an if
+            if (stmt->type == STMT_GOTO) {
+                uint64_t label = targetAddr != 0 ? targetAddr : inst->address + 4;
                 snprintf(stmt->gotoLabel.label, sizeof(stmt->gotoLabel.label), 
-                        "LAB_%08llx", (unsigned long long)targetAddr);
-            } else {
-                snprintf(stmt->gotoLabel.label, sizeof(stmt->gotoLabel.label), 
-                        "LAB_%08llx", (unsigned long long)(inst->address + 4));
+                        "LAB_%08llx", (unsigned long long)label);
             }
         }
         
@@ -844,11 +1116,11 @@ static int format_expression_inline(const Expression *expr, char *buffer) {
         case EXPR_CONSTANT:
             buffer += sprintf(buffer, "0x%llx", (unsigned long long)expr->constant.value);
             break;
-            
+        
         case EXPR_VARIABLE:
             buffer += sprintf(buffer, "%s", expr->variable.name);
             break;
-            
+        
         case EXPR_BINARY_OP: {
             const char *op_str = "";
             switch (expr->binaryOp.op) {
@@ -879,7 +1151,7 @@ static int format_expression_inline(const Expression *expr, char *buffer) {
             buffer += sprintf(buffer, ")");
             break;
         }
-            
+        
         case EXPR_UNARY_OP: {
             const char *op_str = "";
             switch (expr->unaryOp.op) {
@@ -892,7 +1164,7 @@ static int format_expression_inline(const Expression *expr, char *buffer) {
             buffer += format_expression_inline(expr->unaryOp.operand, buffer);
             break;
         }
-            
+        
         case EXPR_MEMORY_ACCESS:
             buffer += sprintf(buffer, "*");
             if (expr->memAccess.base) {
@@ -904,7 +1176,7 @@ static int format_expression_inline(const Expression *expr, char *buffer) {
                 buffer += sprintf(buffer, "]");
             }
             break;
-            
+        
         case EXPR_FUNCTION_CALL:
             buffer += sprintf(buffer, "%s(", expr->call.name);
             for (int i = 0; i < expr->call.argCount; i++) {
@@ -913,7 +1185,7 @@ static int format_expression_inline(const Expression *expr, char *buffer) {
             }
             buffer += sprintf(buffer, ")");
             break;
-            
+        
         case EXPR_CAST:
             buffer += sprintf(buffer, "(");
             if (expr->cast.targetType) {
@@ -924,7 +1196,7 @@ static int format_expression_inline(const Expression *expr, char *buffer) {
             buffer += sprintf(buffer, ")");
             buffer += format_expression_inline(expr->cast.expr, buffer);
             break;
-            
+        
         default:
             buffer += sprintf(buffer, "<expr>");
             break;
@@ -1071,7 +1343,7 @@ int pseudocode_generator_generate(PseudocodeGenerator *gen) {
                 }
                 ptr += sprintf(ptr, ";\n");
                 break;
-                
+            
             case STMT_ASSIGNMENT:
                 ptr += sprintf(ptr, "    ");
                 if (stmt->assignment.varName[0] != '\0') {
@@ -1087,7 +1359,7 @@ int pseudocode_generator_generate(PseudocodeGenerator *gen) {
                 }
                 ptr += sprintf(ptr, ";\n");
                 break;
-                
+            
             case STMT_IF:
                 ptr += sprintf(ptr, "    if (");
                 if (stmt->ifStmt.condition) {
@@ -1099,7 +1371,7 @@ int pseudocode_generator_generate(PseudocodeGenerator *gen) {
                 ptr += sprintf(ptr, "        // true branch\n");
                 ptr += sprintf(ptr, "    }\n");
                 break;
-                
+            
             case STMT_WHILE:
                 ptr += sprintf(ptr, "    while (");
                 if (stmt->whileStmt.condition) {
@@ -1111,7 +1383,7 @@ int pseudocode_generator_generate(PseudocodeGenerator *gen) {
                 ptr += sprintf(ptr, "        // loop body\n");
                 ptr += sprintf(ptr, "    }\n");
                 break;
-                
+            
             case STMT_CALL:
                 ptr += sprintf(ptr, "    ");
                 if (stmt->callStmt.call) {
@@ -1121,15 +1393,15 @@ int pseudocode_generator_generate(PseudocodeGenerator *gen) {
                 }
                 ptr += sprintf(ptr, ";\n");
                 break;
-                
+            
             case STMT_GOTO:
                 ptr += sprintf(ptr, "    goto %s;\n", stmt->gotoLabel.label);
                 break;
-                
+            
             case STMT_LABEL:
                 ptr += sprintf(ptr, "%s:\n", stmt->gotoLabel.label);
                 break;
-                
+            
             default:
                 ptr += sprintf(ptr, "    /* statement type %d */\n", stmt->type);
                 break;
@@ -1158,31 +1430,31 @@ int pseudocode_generator_generate(PseudocodeGenerator *gen) {
                     basic_blocks++;
                 }
                 break;
-                
+            
             case STMT_WHILE:
             case STMT_FOR:
                 gen->output.loop_count++;
                 basic_blocks += 2;
                 break;
-                
+            
             case STMT_GOTO:
                 basic_blocks++;
                 break;
-                
+            
             case STMT_LABEL:
                 basic_blocks++;
                 break;
-                
+            
             case STMT_RETURN:
                 basic_blocks++;
                 break;
-                
+            
             case STMT_SWITCH:
                 if (stmt->switchStmt.caseCount > 0) {
                     basic_blocks += stmt->switchStmt.caseCount + 1;
                 }
                 break;
-                
+            
             default:
                 break;
         }
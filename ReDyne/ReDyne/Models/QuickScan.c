@@ -0,0 +1,246 @@
+#include "QuickScan.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+
+#pragma mark - Helpers
+
+static bool read_fully(int fd, void *buffer, size_t size, uint64_t offset, size_t *out_read) {
+    size_t total = 0;
+    while (total < size) {
+        ssize_t n = pread(fd, (uint8_t*)buffer + total, size - total, (off_t)(offset + total));
+        if (n < 0) return false;
+        if (n == 0) break;
+        total += (size_t)n;
+    }
+    if (out_read) *out_read = total;
+    return true;
+}
+
+static inline uint32_t load_u32(const uint8_t *p, bool swap) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return swap ? swap_uint32(v) : v;
+}
+
+static inline uint64_t load_u64(const uint8_t *p, bool swap) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return swap ? swap_uint64(v) : v;
+}
+
+static void parse_fat_table(const uint8_t *page, size_t length, MachOQuickInfo *info) {
+    uint32_t magic = load_u32(page, false);
+    bool swap = (magic == FAT_CIGAM || magic == 0xbfbafeca);
+    bool is_64 = (magic == 0xcafebabf || magic == 0xbfbafeca);
+    uint32_t nfat_arch = load_u32(page + 4, swap);
+    
+    size_t entry_size = is_64 ? 32 : sizeof(struct fat_arch);
+    size_t offset = sizeof(struct fat_header);
+    
+    for (uint32_t i = 0; i < nfat_arch && info->slice_count < QUICK_SCAN_MAX_SLICES; i++, offset += entry_size) {
+        if (offset + entry_size > length) break;
+        
+        const uint8_t *entry = page + offset;
+        FatSliceInfo slice;
+        slice.cputype = load_u32(entry, swap);
+        slice.cpusubtype = load_u32(entry + 4, swap);
+        if (is_64) {
+            slice.offset = load_u64(entry + 8, swap);
+            slice.size = load_u64(entry + 16, swap);
+            slice.align = load_u32(entry + 24, swap);
+        } else {
+            slice.offset = load_u32(entry + 8, swap);
+            slice.size = load_u32(entry + 12, swap);
+            slice.align = load_u32(entry + 16, swap);
+        }
+        
+        if (slice.offset >= info->file_size) continue;
+        if (slice.size == 0 || slice.size > info->file_size - slice.offset) {
+            slice.size = info->file_size - slice.offset;
+        }
+        info->slices[info->slice_count++] = slice;
+    }
+}
+
+static void scan_load_commands(const uint8_t *cmds, size_t length, uint32_t ncmds, bool swap, MachOQuickInfo *info) {
+    size_t offset = 0;
+    
+    for (uint32_t i = 0; i < ncmds; i++) {
+        if (offset + sizeof(struct load_command) > length) break;
+        
+        uint32_t cmd = load_u32(cmds + offset, swap);
+        uint32_t cmdsize = load_u32(cmds + offset + 4, swap);
+        if (cmdsize < sizeof(struct load_command) || cmdsize > length - offset) break;
+        
+        if (cmd == LC_UUID && cmdsize >= sizeof(struct uuid_command)) {
+            memcpy(info->uuid, cmds + offset + offsetof(struct uuid_command, uuid), 16);
+            info->has_uuid = true;
+        } else if ((cmd == LC_ENCRYPTION_INFO || cmd == LC_ENCRYPTION_INFO_64) &&
+                   cmdsize >= sizeof(struct encryption_info_command)) {
+            uint32_t cryptid = load_u32(cmds + offset + offsetof(struct encryption_info_command, cryptid), swap);
+            info->is_encrypted = (cryptid != 0);
+        }
+        
+        offset += cmdsize;
+    }
+}
+
+static bool scan_thin_header(int fd, uint64_t slice_offset, uint64_t slice_size,
+                             const uint8_t *page, size_t length, MachOQuickInfo *info) {
+    if (length < sizeof(struct mach_header)) return false;
+    
+    uint32_t magic = load_u32(page, false);
+    if (magic != MH_MAGIC_64 && magic != MH_CIGAM_64 && magic != MH_MAGIC && magic != MH_CIGAM) return false;
+    
+    bool swap = (magic == MH_CIGAM_64 || magic == MH_CIGAM);
+    info->is_64bit = (magic == MH_MAGIC_64 || magic == MH_CIGAM_64);
+    info->cputype = load_u32(page + 4, swap);
+    info->cpusubtype = load_u32(page + 8, swap);
+    info->filetype = load_u32(page + 12, swap);
+    info->ncmds = load_u32(page + 16, swap);
+    uint32_t sizeofcmds = load_u32(page + 20, swap);
+    
+    size_t header_size = info->is_64bit ? sizeof(struct mach_header_64) : sizeof(struct mach_header);
+    if (length < header_size || slice_size < header_size) return false;
+    
+    if (sizeofcmds > QUICK_SCAN_MAX_COMMANDS_SIZE) sizeofcmds = QUICK_SCAN_MAX_COMMANDS_SIZE;
+    if (header_size + sizeofcmds > slice_size) sizeofcmds = (uint32_t)(slice_size - header_size);
+    
+    if (header_size + sizeofcmds <= length) {
+        scan_load_commands(page + header_size, sizeofcmds, info->ncmds, swap, info);
+        return true;
+    }
+    
+    // Load commands spill past the first page; fetch just those bytes
+    uint8_t *cmds = (uint8_t*)malloc(sizeofcmds);
+    if (!cmds) return true;
+    
+    size_t got = 0;
+    if (read_fully(fd, cmds, sizeofcmds, slice_offset + header_size, &got)) {
+        scan_load_commands(cmds, got, info->ncmds, swap, info);
+    }
+    free(cmds);
+    
+    return true;
+}
+
+#pragma mark - Single File
+
+bool macho_quick_scan(const char *filepath, MachOQuickInfo *info) {
+    if (!info) return false;
+    memset(info, 0, sizeof(MachOQuickInfo));
+    if (!filepath) return false;
+    
+    int fd = open(filepath, O_RDONLY);
+    if (fd == -1) return false;
+    
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size < 4) {
+        close(fd);
+        return false;
+    }
+    info->file_size = (uint64_t)st.st_size;
+    
+    uint8_t page[QUICK_SCAN_PAGE_SIZE];
+    size_t length = 0;
+    if (!read_fully(fd, page, sizeof(page), 0, &length) || length < sizeof(uint32_t)) {
+        close(fd);
+        return false;
+    }
+    
+    info->magic = load_u32(page, false);
+    if (!macho_is_valid_magic(info->magic)) {
+        close(fd);
+        return false;
+    }
+    
+    info->is_fat = (info->magic == FAT_MAGIC || info->magic == FAT_CIGAM ||
+                    info->magic == 0xcafebabf || info->magic == 0xbfbafeca);
+    
+    if (!info->is_fat) {
+        info->is_valid = scan_thin_header(fd, 0, info->file_size, page, length, info);
+        if (info->is_valid) {
+            info->slice_count = 1;
+            info->slices[0].cputype = info->cputype;
+            info->slices[0].cpusubtype = info->cpusubtype;
+            info->slices[0].offset = 0;
+            info->slices[0].size = info->file_size;
+        }
+        close(fd);
+        return info->is_valid;
+    }
+    
+    parse_fat_table(page, length, info);
+    
+    int32_t index = macho_preferred_slice(info->slices, info->slice_count);
+    if (index >= 0) {
+        const FatSliceInfo *slice = &info->slices[index];
+        uint8_t slice_page[QUICK_SCAN_PAGE_SIZE];
+        size_t slice_length = 0;
+        
+        if (read_fully(fd, slice_page, sizeof(slice_page), slice->offset, &slice_length)) {
+            if (slice_length > slice->size) slice_length = (size_t)slice->size;
+            info->is_valid = scan_thin_header(fd, slice->offset, slice->size, slice_page, slice_length, info);
+        }
+    }
+    
+    close(fd);
+    return info->is_valid;
+}
+
+#pragma mark - Batch Scanning
+
+typedef struct {
+    const char *const *paths;
+    MachOQuickInfo *results;
+    uint32_t count;
+    atomic_uint next;
+} QuickScanBatch;
+
+static void* quick_scan_worker(void *arg) {
+    QuickScanBatch *batch = (QuickScanBatch*)arg;
+    
+    for (;;) {
+        uint32_t i = atomic_fetch_add(&batch->next, 1);
+        if (i >= batch->count) break;
+        macho_quick_scan(batch->paths[i], &batch->results[i]);
+    }
+    
+    return NULL;
+}
+
+void macho_quick_scan_batch(const char *const *paths, uint32_t count, MachOQuickInfo *results) {
+    if (!paths || !results || count == 0) return;
+    
+    QuickScanBatch batch;
+    batch.paths = paths;
+    batch.results = results;
+    batch.count = count;
+    atomic_init(&batch.next, 0);
+    
+    // The work is dominated by open/pread latency, so run more threads than cores
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t worker_count = (uint32_t)(cpus > 0 ? cpus * 2 : 4);
+    if (worker_count > count) worker_count = count;
+    if (worker_count > 32) worker_count = 32;
+    
+    pthread_t workers[32];
+    uint32_t started = 0;
+    for (uint32_t i = 1; i < worker_count; i++) {
+        if (pthread_create(&workers[started], NULL, quick_scan_worker, &batch) == 0) {
+            started++;
+        }
+    }
+    
+    quick_scan_worker(&batch);
+    
+    for (uint32_t i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+}
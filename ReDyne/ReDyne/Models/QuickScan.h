@@ -0,0 +1,43 @@
+#ifndef QuickScan_h
+#define QuickScan_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "MachOHeader.h"
+
+#pragma mark - Constants
+
+#define QUICK_SCAN_PAGE_SIZE 4096
+#define QUICK_SCAN_MAX_SLICES 16
+#define QUICK_SCAN_MAX_COMMANDS_SIZE (64 * 1024)
+
+#pragma mark - Structures
+
+// Header-level facts about one file, gathered from its first page (plus the
+// load commands of the preferred slice) without building a MachOContext.
+typedef struct {
+    bool is_valid;
+    bool is_fat;
+    bool is_64bit;
+    bool is_encrypted;
+    bool has_uuid;
+    uint32_t magic;
+    uint32_t cputype;
+    uint32_t cpusubtype;
+    uint32_t filetype;
+    uint32_t ncmds;
+    uint8_t uuid[16];
+    uint64_t file_size;
+    uint32_t slice_count;
+    FatSliceInfo slices[QUICK_SCAN_MAX_SLICES];
+} MachOQuickInfo;
+
+#pragma mark - Function Declarations
+
+// Scans a single file with pread(); no stdio and no mapping.
+bool macho_quick_scan(const char *filepath, MachOQuickInfo *info);
+
+// Scans count files on a pool of worker threads; results[i] describes paths[i].
+void macho_quick_scan_batch(const char *const *paths, uint32_t count, MachOQuickInfo *results);
+
+#endif
@@ -1,11 +1,12 @@
 #include "RelocationInfo.h"
+#include "ChainedFixups.h"
 #include <stdlib.h>
 #include <string.h>
 #include <mach-o/loader.h>
 
 #pragma mark - Context Management
 
-RelocationContext* reloc_create(MachOContext *macho_ctx) {
+RelocationContext* reloc_create(const MachOContext *macho_ctx) {
     if (!macho_ctx) return NULL;
     
     RelocationContext *ctx = (RelocationContext*)calloc(1, sizeof(RelocationContext));
@@ -59,15 +60,9 @@ bool reloc_parse_rebase(RelocationContext *ctx) {
     if (!ctx || !ctx->macho_ctx || !ctx->macho_ctx->has_dyld_info) return false;
     if (ctx->macho_ctx->rebase_size == 0) return true;
     
-    uint8_t *rebase_data = (uint8_t*)malloc(ctx->macho_ctx->rebase_size);
+    const uint8_t *rebase_data = macho_data_at(ctx->macho_ctx, ctx->macho_ctx->rebase_off, ctx->macho_ctx->rebase_size);
     if (!rebase_data) return false;
     
-    fseek(ctx->macho_ctx->file, ctx->macho_ctx->rebase_off, SEEK_SET);
-    if (fread(rebase_data, 1, ctx->macho_ctx->rebase_size, ctx->macho_ctx->file) != ctx->macho_ctx->rebase_size) {
-        free(rebase_data);
-        return false;
-    }
-    
     uint32_t estimated_count = 10000;
     ctx->rebases = (RebaseEntry*)calloc(estimated_count, sizeof(RebaseEntry));
     ctx->rebase_count = 0;
@@ -185,7 +180,6 @@ bool reloc_parse_rebase(RelocationContext *ctx) {
     }
     
 done_rebase:
-    free(rebase_data);
     return true;
 }
 
@@ -199,16 +193,15 @@ bool reloc_parse_bind(RelocationContext *ctx) {
     ctx->binds = (BindEntry*)calloc(estimated_count, sizeof(BindEntry));
     ctx->bind_count = 0;
     
-    fseek(ctx->macho_ctx->file, ctx->macho_ctx->bind_off, SEEK_SET);
-    uint8_t *bind_data = malloc(ctx->macho_ctx->bind_size);
-    fread(bind_data, 1, ctx->macho_ctx->bind_size, ctx->macho_ctx->file);
+    const uint8_t *bind_data = macho_data_at(ctx->macho_ctx, ctx->macho_ctx->bind_off, ctx->macho_ctx->bind_size);
+    if (!bind_data) return false;
     
     BindType type = REDYNE_BIND_TYPE_POINTER;
     int32_t library_ordinal = 0;
     int64_t addend = 0;
     uint32_t segment_index = 0;
     uint64_t segment_offset = 0;
-    char *symbol_name = NULL;
+    const char *symbol_name = NULL;
     uint8_t symbol_flags = 0;
     uint64_t count = 0;
     uint64_t skip = 0;
@@ -243,7 +236,7 @@ bool reloc_parse_bind(RelocationContext *ctx) {
                 
             case 0x40:
                 symbol_flags = immediate;
-                symbol_name = (char*)&bind_data[i];
+                symbol_name = (const char*)&bind_data[i];
                 i += strlen(symbol_name) + 1;
                 break;
                 
@@ -371,7 +364,6 @@ bool reloc_parse_bind(RelocationContext *ctx) {
     }
     
 done_bind:
-    free(bind_data);
     return true;
 }
 
@@ -383,16 +375,15 @@ bool reloc_parse_lazy_bind(RelocationContext *ctx) {
     ctx->lazy_binds = (BindEntry*)calloc(estimated_count, sizeof(BindEntry));
     ctx->lazy_bind_count = 0;
     
-    fseek(ctx->macho_ctx->file, ctx->macho_ctx->lazy_bind_off, SEEK_SET);
-    uint8_t *lazy_data = malloc(ctx->macho_ctx->lazy_bind_size);
-    fread(lazy_data, 1, ctx->macho_ctx->lazy_bind_size, ctx->macho_ctx->file);
+    const uint8_t *lazy_data = macho_data_at(ctx->macho_ctx, ctx->macho_ctx->lazy_bind_off, ctx->macho_ctx->lazy_bind_size);
+    if (!lazy_data) return false;
     
     BindType type = REDYNE_BIND_TYPE_POINTER;
     int32_t library_ordinal = 0;
     int64_t addend = 0;
     uint32_t segment_index = 0;
     uint64_t segment_offset = 0;
-    char *symbol_name = NULL;
+    const char *symbol_name = NULL;
     uint8_t symbol_flags = 0;
     
     uint32_t i = 0;
@@ -417,7 +408,7 @@ bool reloc_parse_lazy_bind(RelocationContext *ctx) {
                 
             case 0x40:
                 symbol_flags = immediate;
-                symbol_name = (char*)&lazy_data[i];
+                symbol_name = (const char*)&lazy_data[i];
                 i += strlen(symbol_name) + 1;
                 break;
                 
@@ -448,7 +439,6 @@ bool reloc_parse_lazy_bind(RelocationContext *ctx) {
         }
     }
     
-    free(lazy_data);
     return true;
 }
 
@@ -460,16 +450,15 @@ bool reloc_parse_weak_bind(RelocationContext *ctx) {
     ctx->weak_binds = (BindEntry*)calloc(estimated_count, sizeof(BindEntry));
     ctx->weak_bind_count = 0;
     
-    fseek(ctx->macho_ctx->file, ctx->macho_ctx->weak_bind_off, SEEK_SET);
-    uint8_t *weak_data = malloc(ctx->macho_ctx->weak_bind_size);
-    fread(weak_data, 1, ctx->macho_ctx->weak_bind_size, ctx->macho_ctx->file);
+    const uint8_t *weak_data = macho_data_at(ctx->macho_ctx, ctx->macho_ctx->weak_bind_off, ctx->macho_ctx->weak_bind_size);
+    if (!weak_data) return false;
     
     BindType type = REDYNE_BIND_TYPE_POINTER;
     int32_t library_ordinal = 0;
     int64_t addend = 0;
     uint32_t segment_index = 0;
     uint64_t segment_offset = 0;
-    char *symbol_name = NULL;
+    const char *symbol_name = NULL;
     uint8_t symbol_flags = 0;
     uint64_t count = 0;
     uint64_t skip = 0;
@@ -495,7 +484,7 @@ bool reloc_parse_weak_bind(RelocationContext *ctx) {
                 
             case 0x40:
                 symbol_flags = immediate;
-                symbol_name = (char*)&weak_data[i];
+                symbol_name = (const char*)&weak_data[i];
                 i += strlen(symbol_name) + 1;
                 break;
                 
@@ -607,7 +596,6 @@ bool reloc_parse_weak_bind(RelocationContext *ctx) {
     }
     
 done_weak:
-    free(weak_data);
     return true;
 }
 
@@ -676,27 +664,76 @@ static void walk_export_trie(const uint8_t *start, const uint8_t *p, const uint8
 }
 
 bool reloc_parse_exports(RelocationContext *ctx) {
-    if (!ctx || !ctx->macho_ctx || !ctx->macho_ctx->has_dyld_info) return false;
+    if (!ctx || !ctx->macho_ctx) return false;
+    if (!ctx->macho_ctx->has_dyld_info && ctx->macho_ctx->export_size == 0) return false;
     if (ctx->macho_ctx->export_size == 0) return true;
     
     uint32_t estimated_count = 5000;
     ctx->exports = (ExportEntry*)calloc(estimated_count, sizeof(ExportEntry));
     ctx->export_count = 0;
     
-    fseek(ctx->macho_ctx->file, ctx->macho_ctx->export_off, SEEK_SET);
-    uint8_t *export_data = malloc(ctx->macho_ctx->export_size);
+    const uint8_t *export_data = macho_data_at(ctx->macho_ctx, ctx->macho_ctx->export_off, ctx->macho_ctx->export_size);
     if (!export_data) return false;
     
-    if (fread(export_data, 1, ctx->macho_ctx->export_size, ctx->macho_ctx->file) != ctx->macho_ctx->export_size) {
-        free(export_data);
-        return false;
-    }
-    
     char symbol_buffer[256] = {0};
     walk_export_trie(export_data, export_data, export_data + ctx->macho_ctx->export_size,
                     symbol_buffer, 0, ctx->exports, &ctx->export_count, estimated_count);
     
-    free(export_data);
+    return true;
+}
+
+#pragma mark - Chained Fixups
+
+bool reloc_parse_chained_fixups(RelocationContext *ctx) {
+    if (!ctx || !ctx->macho_ctx || !ctx->macho_ctx->has_chained_fixups) return false;
+    if (ctx->rebases || ctx->binds) return true;
+    
+    const ChainedFixupsInfo *info = ctx->macho_ctx->chained_fixups;
+    ChainedFixupsInfo *owned = NULL;
+    if (!info) {
+        owned = chained_fixups_parse(ctx->macho_ctx);
+        info = owned;
+    }
+    if (!info) return false;
+    
+    uint32_t rebase_count = 0;
+    for (uint32_t i = 0; i < info->fixup_count; i++) {
+        if (info->fixups[i].kind == CHAINED_FIXUP_REBASE) rebase_count++;
+    }
+    uint32_t bind_count = info->fixup_count - rebase_count;
+    
+    ctx->rebases = (RebaseEntry*)calloc(rebase_count ? rebase_count : 1, sizeof(RebaseEntry));
+    ctx->binds = (BindEntry*)calloc(bind_count ? bind_count : 1, sizeof(BindEntry));
+    if (!ctx->rebases || !ctx->binds) {
+        chained_fixups_free(owned);
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < info->fixup_count; i++) {
+        const ChainedFixup *fixup = &info->fixups[i];
+        
+        if (fixup->kind == CHAINED_FIXUP_REBASE) {
+            RebaseEntry *entry = &ctx->rebases[ctx->rebase_count++];
+            entry->address = fixup->address;
+            entry->type = REDYNE_REBASE_TYPE_POINTER;
+            continue;
+        }
+        
+        BindEntry *entry = &ctx->binds[ctx->bind_count++];
+        entry->address = fixup->address;
+        entry->type = REDYNE_BIND_TYPE_POINTER;
+        entry->addend = fixup->addend;
+        
+        if (fixup->ordinal < info->import_count) {
+            const ChainedImport *imp = &info->imports[fixup->ordinal];
+            entry->library_ordinal = imp->library_ordinal;
+            entry->addend += imp->addend;
+            entry->symbol_name = strdup(imp->name);
+            entry->is_weak = imp->is_weak;
+        }
+    }
+    
+    chained_fixups_free(owned);
     return true;
 }
 
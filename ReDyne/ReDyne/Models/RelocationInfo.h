@@ -51,7 +51,7 @@ typedef struct {
 } ExportEntry;
 
 typedef struct {
-    MachOContext *macho_ctx;
+    const MachOContext *macho_ctx;
     
     RebaseEntry *rebases;
     uint32_t rebase_count;
@@ -74,7 +74,7 @@ typedef struct {
 
 #pragma mark - Function Declarations
 
-RelocationContext* reloc_create(MachOContext *macho_ctx);
+RelocationContext* reloc_create(const MachOContext *macho_ctx);
 
 bool reloc_parse_rebase(RelocationContext *ctx);
 
@@ -86,6 +86,10 @@ bool reloc_parse_weak_bind(RelocationContext *ctx);
 
 bool reloc_parse_exports(RelocationContext *ctx);
 
+// Fills rebases and binds from LC_DYLD_CHAINED_FIXUPS for binaries that have no
+// LC_DYLD_INFO opcodes. Uses the context's resolved map when one is attached.
+bool reloc_parse_chained_fixups(RelocationContext *ctx);
+
 uint64_t reloc_apply_slide(RelocationContext *ctx, uint64_t address);
 
 BindEntry* reloc_find_bind(RelocationContext *ctx, uint64_t address);
@@ -95,18 +95,9 @@ uint32_t string_extract_from_data(StringContext *ctx, const uint8_t *data, size_
     return found;
 }
 
-uint32_t string_extract_cstrings(StringContext *ctx, FILE *file, uint64_t offset,
+uint32_t string_extract_cstrings(StringContext *ctx, const uint8_t *data, uint64_t offset,
                                   uint64_t size, uint64_t vmaddr) {
-    if (!ctx || !file || size == 0) return 0;
-    
-    uint8_t *data = malloc(size);
-    if (!data) return 0;
-    
-    fseek(file, offset, SEEK_SET);
-    if (fread(data, 1, size, file) != size) {
-        free(data);
-        return 0;
-    }
+    if (!ctx || !data || size == 0) return 0;
     
     uint32_t found = 0;
     uint64_t pos = 0;
@@ -132,7 +123,6 @@ uint32_t string_extract_cstrings(StringContext *ctx, FILE *file, uint64_t offset
         pos += len + 1;
     }
     
-    free(data);
     return found;
 }
 
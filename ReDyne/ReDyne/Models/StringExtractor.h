@@ -31,7 +31,7 @@ uint32_t string_extract_from_data(StringContext *ctx, const uint8_t *data, size_
                                    uint64_t base_address, const char *section_name, 
                                    uint32_t min_length);
 
-uint32_t string_extract_cstrings(StringContext *ctx, FILE *file, uint64_t offset, 
+uint32_t string_extract_cstrings(StringContext *ctx, const uint8_t *data, uint64_t offset, 
                                   uint64_t size, uint64_t vmaddr);
 
 void string_context_sort(StringContext *ctx);
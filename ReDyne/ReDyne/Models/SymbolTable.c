@@ -29,7 +29,7 @@ const char* symbol_scope_string(SymbolScope scope) {
 
 #pragma mark - Context Management
 
-SymbolTableContext* symbol_table_create(MachOContext *macho_ctx) {
+SymbolTableContext* symbol_table_create(const MachOContext *macho_ctx) {
     if (!macho_ctx || macho_ctx->nsyms == 0) return NULL;
     
     SymbolTableContext *ctx = (SymbolTableContext*)calloc(1, sizeof(SymbolTableContext));
@@ -50,14 +50,7 @@ SymbolTableContext* symbol_table_create(MachOContext *macho_ctx) {
 void symbol_table_free(SymbolTableContext *ctx) {
     if (!ctx) return;
     
-    if (ctx->symbols) {
-        for (uint32_t i = 0; i < ctx->symbol_count; i++) {
-            if (ctx->symbols[i].name) free(ctx->symbols[i].name);
-        }
-        free(ctx->symbols);
-    }
-    
-    if (ctx->string_table) free(ctx->string_table);
+    if (ctx->symbols) free(ctx->symbols);
     if (ctx->defined_indices) free(ctx->defined_indices);
     if (ctx->undefined_indices) free(ctx->undefined_indices);
     if (ctx->external_indices) free(ctx->external_indices);
@@ -69,47 +62,45 @@ void symbol_table_free(SymbolTableContext *ctx) {
 #pragma mark - String Table Loading
 
 bool symbol_table_load_strings(SymbolTableContext *ctx) {
-    if (!ctx || !ctx->macho_ctx || !ctx->macho_ctx->file) return false;
+    if (!ctx || !ctx->macho_ctx) return false;
     
-    MachOContext *mctx = ctx->macho_ctx;
+    const MachOContext *mctx = ctx->macho_ctx;
     if (mctx->strsize == 0) return false;
     
-    ctx->string_table_size = mctx->strsize;
-    ctx->string_table = (char*)malloc(ctx->string_table_size);
-    if (!ctx->string_table) return false;
-    
-    fseek(mctx->file, mctx->stroff, SEEK_SET);
-    size_t read = fread(ctx->string_table, 1, ctx->string_table_size, mctx->file);
+    MachOSpan span = macho_span(mctx, mctx->stroff, mctx->strsize);
+    if (!span.data) return false;
     
-    if (read != ctx->string_table_size) {
-        free(ctx->string_table);
-        ctx->string_table = NULL;
-        return false;
-    }
+    ctx->string_table = (const char*)span.data;
+    ctx->string_table_size = mctx->strsize;
     
     return true;
 }
 
 const char* symbol_table_get_string(SymbolTableContext *ctx, uint32_t strx) {
     if (!ctx || !ctx->string_table || strx >= ctx->string_table_size) return NULL;
-    return ctx->string_table + strx;
+    
+    const char *str = ctx->string_table + strx;
+    if (!memchr(str, 0, ctx->string_table_size - strx)) return NULL;
+    return str;
 }
 
 #pragma mark - Symbol Parsing
 
 bool symbol_table_parse(SymbolTableContext *ctx) {
-    if (!ctx || !ctx->macho_ctx || !ctx->macho_ctx->file) return false;
+    if (!ctx || !ctx->macho_ctx) return false;
     
     if (!symbol_table_load_strings(ctx)) return false;
     
-    MachOContext *mctx = ctx->macho_ctx;
+    const MachOContext *mctx = ctx->macho_ctx;
     
-    fseek(mctx->file, mctx->symtab_offset, SEEK_SET);
+    size_t entry_size = mctx->header.is_64bit ? sizeof(struct nlist_64) : sizeof(struct nlist);
+    MachOSpan symtab = macho_span(mctx, mctx->symtab_offset, (uint64_t)ctx->symbol_count * entry_size);
+    if (!symtab.data) return false;
     
     if (mctx->header.is_64bit) {
         for (uint32_t i = 0; i < ctx->symbol_count; i++) {
             struct nlist_64 nlist;
-            if (fread(&nlist, sizeof(struct nlist_64), 1, mctx->file) != 1) return false;
+            memcpy(&nlist, symtab.data + (size_t)i * entry_size, sizeof(struct nlist_64));
             
             if (mctx->header.is_swapped) {
                 nlist.n_un.n_strx = swap_uint32(nlist.n_un.n_strx);
@@ -120,11 +111,7 @@ bool symbol_table_parse(SymbolTableContext *ctx) {
             SymbolInfo *sym = &ctx->symbols[i];
             
             const char *name = symbol_table_get_string(ctx, nlist.n_un.n_strx);
-            if (name) {
-                sym->name = strdup(name);
-            } else {
-                sym->name = strdup("");
-            }
+            sym->name = name ? name : "";
             
             sym->n_type = nlist.n_type;
             sym->desc = nlist.n_desc;
@@ -164,7 +151,7 @@ bool symbol_table_parse(SymbolTableContext *ctx) {
     } else {
         for (uint32_t i = 0; i < ctx->symbol_count; i++) {
             struct nlist nlist;
-            if (fread(&nlist, sizeof(struct nlist), 1, mctx->file) != 1) return false;
+            memcpy(&nlist, symtab.data + (size_t)i * entry_size, sizeof(struct nlist));
             
             if (mctx->header.is_swapped) {
                 nlist.n_un.n_strx = swap_uint32(nlist.n_un.n_strx);
@@ -174,7 +161,7 @@ bool symbol_table_parse(SymbolTableContext *ctx) {
             
             SymbolInfo *sym = &ctx->symbols[i];
             const char *name = symbol_table_get_string(ctx, nlist.n_un.n_strx);
-            sym->name = name ? strdup(name) : strdup("");
+            sym->name = name ? name : "";
             
             sym->n_type = nlist.n_type;
             sym->desc = nlist.n_desc;
@@ -340,88 +327,52 @@ void symbol_table_sort_by_name(SymbolTableContext *ctx) {
 #pragma mark - Dynamic Symbol Table Parsing
 
 bool symbol_table_parse_dysymtab(SymbolTableContext *ctx) {
-    if (!ctx || !ctx->macho_ctx) return false;
+    if (!ctx || !ctx->macho_ctx || !ctx->macho_ctx->load_commands) return false;
     
-    FILE *file = ctx->macho_ctx->file;
-    bool is_64bit = ctx->macho_ctx->header.is_64bit;
-    bool is_swapped = ctx->macho_ctx->header.is_swapped;
+    const MachOContext *mctx = ctx->macho_ctx;
+    bool is_swapped = mctx->header.is_swapped;
     
-    uint32_t header_size = is_64bit ? sizeof(struct mach_header_64) : sizeof(struct mach_header);
-    fseek(file, header_size, SEEK_SET);
-    
-    for (uint32_t i = 0; i < ctx->macho_ctx->header.ncmds; i++) {
-        uint32_t cmd, cmdsize;
-        long cmd_start = ftell(file);
+    for (uint32_t i = 0; i < mctx->load_command_count; i++) {
+        if (mctx->load_commands[i].cmd != LC_DYSYMTAB) continue;
+        if (mctx->load_commands[i].cmdsize < sizeof(struct dysymtab_command)) return false;
         
-        fread(&cmd, sizeof(uint32_t), 1, file);
-        fread(&cmdsize, sizeof(uint32_t), 1, file);
+        struct dysymtab_command dysymtab;
+        memcpy(&dysymtab, mctx->load_commands[i].data, sizeof(dysymtab));
         
         if (is_swapped) {
-            cmd = __builtin_bswap32(cmd);
-            cmdsize = __builtin_bswap32(cmdsize);
+            dysymtab.ilocalsym = __builtin_bswap32(dysymtab.ilocalsym);
+            dysymtab.nlocalsym = __builtin_bswap32(dysymtab.nlocalsym);
+            dysymtab.iextdefsym = __builtin_bswap32(dysymtab.iextdefsym);
+            dysymtab.nextdefsym = __builtin_bswap32(dysymtab.nextdefsym);
+            dysymtab.iundefsym = __builtin_bswap32(dysymtab.iundefsym);
+            dysymtab.nundefsym = __builtin_bswap32(dysymtab.nundefsym);
+            dysymtab.indirectsymoff = __builtin_bswap32(dysymtab.indirectsymoff);
+            dysymtab.nindirectsyms = __builtin_bswap32(dysymtab.nindirectsyms);
         }
         
-        if (cmd == LC_DYSYMTAB) {
-            struct {
-                uint32_t ilocalsym;
-                uint32_t nlocalsym;
-                uint32_t iextdefsym;
-                uint32_t nextdefsym;
-                uint32_t iundefsym;
-                uint32_t nundefsym;
-                uint32_t tocoff;
-                uint32_t ntoc;
-                uint32_t modtaboff;
-                uint32_t nmodtab;
-                uint32_t extrefsymoff;
-                uint32_t nextrefsyms;
-                uint32_t indirectsymoff;
-                uint32_t nindirectsyms;
-                uint32_t extreloff;
-                uint32_t nextrel;
-                uint32_t locreloff;
-                uint32_t nlocrel;
-            } dysymtab;
-            
-            fread(&dysymtab, sizeof(dysymtab), 1, file);
-            
-            if (is_swapped) {
-                dysymtab.ilocalsym = __builtin_bswap32(dysymtab.ilocalsym);
-                dysymtab.nlocalsym = __builtin_bswap32(dysymtab.nlocalsym);
-                dysymtab.iextdefsym = __builtin_bswap32(dysymtab.iextdefsym);
-                dysymtab.nextdefsym = __builtin_bswap32(dysymtab.nextdefsym);
-                dysymtab.iundefsym = __builtin_bswap32(dysymtab.iundefsym);
-                dysymtab.nundefsym = __builtin_bswap32(dysymtab.nundefsym);
-                dysymtab.indirectsymoff = __builtin_bswap32(dysymtab.indirectsymoff);
-                dysymtab.nindirectsyms = __builtin_bswap32(dysymtab.nindirectsyms);
+        if (ctx->symbols && ctx->symbol_count > 0) {
+            for (uint32_t j = dysymtab.ilocalsym; 
+                 j < dysymtab.ilocalsym + dysymtab.nlocalsym && j < ctx->symbol_count; 
+                 j++) {
+                ctx->symbols[j].scope = 0x00;
             }
             
-            if (ctx->symbols && ctx->symbol_count > 0) {
-                for (uint32_t j = dysymtab.ilocalsym; 
-                     j < dysymtab.ilocalsym + dysymtab.nlocalsym && j < ctx->symbol_count; 
-                     j++) {
-                    ctx->symbols[j].scope = 0x00;
-                }
-                
-                for (uint32_t j = dysymtab.iextdefsym; 
-                     j < dysymtab.iextdefsym + dysymtab.nextdefsym && j < ctx->symbol_count; 
-                     j++) {
-                    ctx->symbols[j].scope = 0x01;
-                    ctx->symbols[j].is_external = true;
-                }
-                
-                for (uint32_t j = dysymtab.iundefsym; 
-                     j < dysymtab.iundefsym + dysymtab.nundefsym && j < ctx->symbol_count; 
-                     j++) {
-                    ctx->symbols[j].is_defined = false;
-                    ctx->symbols[j].is_external = true;
-                }
+            for (uint32_t j = dysymtab.iextdefsym; 
+                 j < dysymtab.iextdefsym + dysymtab.nextdefsym && j < ctx->symbol_count; 
+                 j++) {
+                ctx->symbols[j].scope = 0x01;
+                ctx->symbols[j].is_external = true;
             }
             
-            return true;
+            for (uint32_t j = dysymtab.iundefsym; 
+                 j < dysymtab.iundefsym + dysymtab.nundefsym && j < ctx->symbol_count; 
+                 j++) {
+                ctx->symbols[j].is_defined = false;
+                ctx->symbols[j].is_external = true;
+            }
         }
         
-        fseek(file, cmd_start + cmdsize, SEEK_SET);
+        return true;
     }
     
     return false;
@@ -26,7 +26,7 @@ typedef enum {
 #pragma mark - Symbol Information Structure
 
 typedef struct {
-    char *name;
+    const char *name;
     uint64_t address;
     uint64_t size;
     SymbolType type;
@@ -42,11 +42,11 @@ typedef struct {
 } SymbolInfo;
 
 typedef struct {
-    MachOContext *macho_ctx;
+    const MachOContext *macho_ctx;
     SymbolInfo *symbols;
     uint32_t symbol_count;
     
-    char *string_table;
+    const char *string_table;
     uint32_t string_table_size;
     uint32_t *defined_indices;
     uint32_t defined_count;
@@ -61,7 +61,7 @@ typedef struct {
 
 #pragma mark - Function Declarations
 
-SymbolTableContext* symbol_table_create(MachOContext *macho_ctx);
+SymbolTableContext* symbol_table_create(const MachOContext *macho_ctx);
 
 bool symbol_table_parse(SymbolTableContext *ctx);
 
@@ -11,11 +11,18 @@
 #import "MachOHeader.h"
 #import "SymbolTable.h"
 #import "DisassemblyEngine.h"
+#import "DisassemblyPages.h"
+#import "BranchScan.h"
+#import "FunctionDiscovery.h"
 #import "ControlFlowGraph.h"
 #import "RelocationInfo.h"
 #import "ObjCParser.h"
 #import "DyldInfo.h"
+#import "ChainedFixups.h"
 #import "CodeSignature.h"
+#import "AnalysisSession.h"
+#import "AnalysisCache.h"
+#import "QuickScan.h"
 #import "EnhancedFilePicker.h"
 #import "PseudocodeGenerator.h"
 #import "ARM64InstructionDecoder.h"
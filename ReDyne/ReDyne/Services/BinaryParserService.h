@@ -1,5 +1,6 @@
 #import <Foundation/Foundation.h>
 #import "DecompiledOutput.h"
+#import "AnalysisSession.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -11,10 +12,34 @@ typedef void (^ParserProgressBlock)(NSString *status, float progress);
                                   progressBlock:(nullable ParserProgressBlock)progressBlock
                                           error:(NSError **)error;
 
+/// session_open() reporting failures as NSErrors: a file that cannot be opened, an invalid
+/// Mach-O header and unreadable load commands each keep their own code. A NULL slice selects
+/// the preferred architecture. The caller releases the session.
++ (nullable AnalysisSession *)openSessionAtPath:(NSString *)filePath
+                                          slice:(nullable const FatSliceInfo *)slice
+                                  progressBlock:(nullable ParserProgressBlock)progressBlock
+                                          error:(NSError **)error;
+
+/// Builds the output from a shared session; symbol and string stages are memoized on it.
++ (nullable DecompiledOutput *)parseSession:(AnalysisSession *)session
+                              progressBlock:(nullable ParserProgressBlock)progressBlock
+                                      error:(NSError **)error;
+
+/// Parses every architecture of a universal binary concurrently, one session per slice.
+/// Results follow fat_arch order and carry each slice's output or its error; a thin
+/// binary yields a single result. Fails only when the file cannot be opened at all.
++ (nullable NSArray<SliceOutput *> *)parseAllSlicesAtPath:(NSString *)filePath
+                                                    error:(NSError **)error;
+
 + (BOOL)isValidMachOAtPath:(NSString *)filePath;
 
 + (nullable NSDictionary *)quickInfoForFileAtPath:(NSString *)filePath;
 
+/// Header-only scan of many files at once on a worker pool. Each entry is the
+/// quickInfoForFileAtPath: dictionary (plus "uuid" and "slices"), or NSNull for
+/// files that are not Mach-O.
++ (NSArray *)quickInfoForFilesAtPaths:(NSArray<NSString *> *)filePaths;
+
 + (nullable NSArray<SymbolModel *> *)extractSymbolsFromPath:(NSString *)filePath
                                                       error:(NSError **)error;
 
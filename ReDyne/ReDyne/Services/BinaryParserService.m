@@ -2,6 +2,9 @@
 #import "MachOHeader.h"
 #import "SymbolTable.h"
 #import "StringExtractor.h"
+#import "AnalysisSession.h"
+#import "QuickScan.h"
+#import "DisassemblerService.h"
 
 static NSString * const ReDyneBinaryParserErrorDomain = @"com.jian.ReDyne.BinaryParser";
 
@@ -20,13 +23,36 @@ typedef NS_ENUM(NSInteger, ReDyneBinaryParserError) {
 + (DecompiledOutput *)parseBinaryAtPath:(NSString *)filePath
                          progressBlock:(ParserProgressBlock)progressBlock
                                  error:(NSError **)error {
+    return [self parseBinaryAtPath:filePath slice:NULL progressBlock:progressBlock error:error];
+}
+
++ (DecompiledOutput *)parseBinaryAtPath:(NSString *)filePath
+                                 slice:(const FatSliceInfo *)slice
+                         progressBlock:(ParserProgressBlock)progressBlock
+                                 error:(NSError **)error {
     
-    NSDate *startTime = [NSDate date];
+    AnalysisSession *session = [self openSessionAtPath:filePath slice:slice progressBlock:progressBlock error:error];
+    if (!session) return nil;
+    
+    // The paged code view keeps the session alive after this returns
+    DecompiledOutput *output = [self parseSession:session progressBlock:progressBlock error:error];
+    output.pagedDisassembly = [[PagedDisassembly alloc] initWithSession:session];
+    session_release(session);
+    
+    return output;
+}
+
++ (AnalysisSession *)openSessionAtPath:(NSString *)filePath
+                                 slice:(const FatSliceInfo *)slice
+                         progressBlock:(ParserProgressBlock)progressBlock
+                                 error:(NSError **)error {
     
     if (progressBlock) {
         progressBlock(@"Opening file...", 0.0);
     }
     
+    // The stages of session_open() run one by one here, so each failure keeps
+    // its own error code
     char error_msg[256] = {0};
     MachOContext *macho_ctx = macho_open([filePath UTF8String], error_msg);
     if (!macho_ctx) {
@@ -35,21 +61,23 @@ typedef NS_ENUM(NSInteger, ReDyneBinaryParserError) {
                                          code:ReDyneBinaryParserErrorInvalidFile
                                      userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithUTF8String:error_msg]}];
         }
-        return nil;
+        return NULL;
     }
     
     if (progressBlock) {
         progressBlock(@"Parsing header...", 0.1);
     }
     
-    if (!macho_parse_header(macho_ctx)) {
+    bool header_ok = slice ? macho_parse_header_at(macho_ctx, slice->offset, slice->size)
+                           : macho_parse_header(macho_ctx);
+    if (!header_ok) {
         macho_close(macho_ctx);
         if (error) {
             *error = [NSError errorWithDomain:ReDyneBinaryParserErrorDomain
                                          code:ReDyneBinaryParserErrorInvalidMachO
                                      userInfo:@{NSLocalizedDescriptionKey: @"Invalid Mach-O header"}];
         }
-        return nil;
+        return NULL;
     }
     
     if (progressBlock) {
@@ -63,11 +91,27 @@ typedef NS_ENUM(NSInteger, ReDyneBinaryParserError) {
                                          code:ReDyneBinaryParserErrorParsingFailed
                                      userInfo:@{NSLocalizedDescriptionKey: @"Failed to parse load commands"}];
         }
-        return nil;
+        return NULL;
+    }
+    
+    AnalysisSession *session = session_create([filePath UTF8String], macho_ctx);
+    if (!session && error) {
+        *error = [NSError errorWithDomain:ReDyneBinaryParserErrorDomain
+                                     code:ReDyneBinaryParserErrorParsingFailed
+                                 userInfo:@{NSLocalizedDescriptionKey: @"Memory allocation failed"}];
     }
     
+    return session;
+}
+
++ (DecompiledOutput *)parseSession:(AnalysisSession *)session
+                     progressBlock:(ParserProgressBlock)progressBlock
+                             error:(NSError **)error {
+    
+    NSDate *startTime = [NSDate date];
+    MachOContext *macho_ctx = session_macho_context(session);
+    
     if (macho_ctx->is_encrypted) {
-        macho_close(macho_ctx);
         if (error) {
             *error = [NSError errorWithDomain:ReDyneBinaryParserErrorDomain
                                          code:ReDyneBinaryParserErrorEncrypted
@@ -80,8 +124,7 @@ typedef NS_ENUM(NSInteger, ReDyneBinaryParserError) {
         progressBlock(@"Extracting segments...", 0.3);
     }
     
-    macho_extract_segments(macho_ctx);
-    macho_extract_sections(macho_ctx);
+    NSString *filePath = [NSString stringWithUTF8String:session_file_path(session)];
     
     DecompiledOutput *output = [[DecompiledOutput alloc] init];
     output.filePath = filePath;
@@ -107,12 +150,8 @@ typedef NS_ENUM(NSInteger, ReDyneBinaryParserError) {
         progressBlock(@"Parsing symbol table...", 0.5);
     }
     
-    SymbolTableContext *sym_ctx = symbol_table_create(macho_ctx);
+    SymbolTableContext *sym_ctx = session_symbols(session);
     if (sym_ctx) {
-        symbol_table_parse(sym_ctx);
-        symbol_table_categorize(sym_ctx);
-        symbol_table_extract_functions(sym_ctx);
-        
         NSMutableArray *symbols = [NSMutableArray array];
         for (uint32_t i = 0; i < sym_ctx->symbol_count; i++) {
             SymbolModel *sym = [self createSymbolModelFromInfo:&sym_ctx->symbols[i]];
@@ -124,39 +163,14 @@ typedef NS_ENUM(NSInteger, ReDyneBinaryParserError) {
         output.definedSymbols = sym_ctx->defined_count;
         output.undefinedSymbols = sym_ctx->undefined_count;
         output.totalFunctions = sym_ctx->function_count;
-        
-        symbol_table_free(sym_ctx);
     }
     
     if (progressBlock) {
         progressBlock(@"Extracting strings...", 0.7);
     }
     
-    StringContext *str_ctx = string_context_create(1024);
+    StringContext *str_ctx = session_strings(session);
     if (str_ctx) {
-        for (uint32_t i = 0; i < macho_ctx->section_count; i++) {
-            SectionInfo *sect = &macho_ctx->sections[i];
-            if (strcmp(sect->sectname, "__cstring") == 0) {
-                string_extract_cstrings(str_ctx, macho_ctx->file, sect->offset, sect->size, sect->addr);
-            }
-        }
-        
-        for (uint32_t i = 0; i < macho_ctx->segment_count; i++) {
-            SegmentInfo *seg = &macho_ctx->segments[i];
-            if ((seg->initprot & 0x01) && seg->filesize > 0) {
-                uint8_t *data = malloc(seg->filesize);
-                if (data) {
-                    fseek(macho_ctx->file, seg->fileoff, SEEK_SET);
-                    if (fread(data, 1, seg->filesize, macho_ctx->file) == seg->filesize) {
-                        string_extract_from_data(str_ctx, data, seg->filesize, seg->vmaddr, seg->segname, 4);
-                    }
-                    free(data);
-                }
-            }
-        }
-        
-        string_context_sort(str_ctx);
-        
         NSMutableArray *strings = [NSMutableArray array];
         for (uint32_t i = 0; i < str_ctx->count; i++) {
             StringModel *str = [self createStringModelFromInfo:&str_ctx->strings[i]];
@@ -164,8 +178,6 @@ typedef NS_ENUM(NSInteger, ReDyneBinaryParserError) {
         }
         output.strings = strings;
         output.totalStrings = str_ctx->count;
-        
-        string_context_free(str_ctx);
     }
     
     if (progressBlock) {
@@ -174,40 +186,103 @@ typedef NS_ENUM(NSInteger, ReDyneBinaryParserError) {
     
     output.processingTime = [[NSDate date] timeIntervalSinceDate:startTime];
     
-    macho_close(macho_ctx);
-    
     return output;
 }
 
-+ (BOOL)isValidMachOAtPath:(NSString *)filePath {
-    MachOContext *ctx = macho_open([filePath UTF8String], NULL);
-    if (!ctx) return NO;
++ (NSArray<SliceOutput *> *)parseAllSlicesAtPath:(NSString *)filePath error:(NSError **)error {
+    char error_msg[256] = {0};
+    MachOContext *probe = macho_open([filePath UTF8String], error_msg);
+    if (!probe) {
+        if (error) {
+            *error = [NSError errorWithDomain:ReDyneBinaryParserErrorDomain
+                                         code:ReDyneBinaryParserErrorInvalidFile
+                                     userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithUTF8String:error_msg]}];
+        }
+        return nil;
+    }
+    
+    FatSliceInfo *slices = NULL;
+    uint32_t slice_count = macho_enumerate_slices(probe, &slices);
+    macho_close(probe);
     
-    BOOL valid = macho_parse_header(ctx);
-    macho_close(ctx);
+    if (slice_count == 0) {
+        if (error) {
+            *error = [NSError errorWithDomain:ReDyneBinaryParserErrorDomain
+                                         code:ReDyneBinaryParserErrorInvalidMachO
+                                     userInfo:@{NSLocalizedDescriptionKey: @"No architectures found in binary"}];
+        }
+        return nil;
+    }
+    
+    NSMutableArray<SliceOutput *> *results = [NSMutableArray arrayWithCapacity:slice_count];
+    for (uint32_t i = 0; i < slice_count; i++) {
+        SliceOutput *result = [[SliceOutput alloc] init];
+        result.cpuType = [NSString stringWithUTF8String:macho_cpu_type_string(slices[i].cputype)];
+        result.cpuSubtype = [NSString stringWithUTF8String:macho_cpu_subtype_string(slices[i].cputype, slices[i].cpusubtype)];
+        result.sliceOffset = slices[i].offset;
+        [results addObject:result];
+    }
     
-    return valid;
+    // Each slice gets its own session, so the workers share nothing but the page
+    // cache. Every worker writes only its own result object.
+    dispatch_queue_t queue = dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+    dispatch_apply(slice_count, queue, ^(size_t i) {
+        NSError *sliceError = nil;
+        DecompiledOutput *output = [self parseBinaryAtPath:filePath slice:&slices[i] progressBlock:nil error:&sliceError];
+        results[i].output = output;
+        results[i].error = output ? nil : (sliceError ?: [NSError errorWithDomain:ReDyneBinaryParserErrorDomain
+                                                                            code:ReDyneBinaryParserErrorParsingFailed
+                                                                        userInfo:@{NSLocalizedDescriptionKey: @"Failed to parse architecture"}]);
+    });
+    free(slices);
+    
+    return results;
+}
+
++ (BOOL)isValidMachOAtPath:(NSString *)filePath {
+    MachOQuickInfo info;
+    return macho_quick_scan([filePath UTF8String], &info);
 }
 
 + (NSDictionary *)quickInfoForFileAtPath:(NSString *)filePath {
-    MachOContext *ctx = macho_open([filePath UTF8String], NULL);
-    if (!ctx) return nil;
+    MachOQuickInfo info;
+    if (!macho_quick_scan([filePath UTF8String], &info)) return nil;
     
-    if (!macho_parse_header(ctx)) {
-        macho_close(ctx);
-        return nil;
+    return [self dictionaryFromQuickInfo:&info];
+}
+
++ (NSArray *)quickInfoForFilesAtPaths:(NSArray<NSString *> *)filePaths {
+    NSUInteger count = filePaths.count;
+    if (count == 0) return @[];
+    
+    // fileSystemRepresentation buffers are autoreleased, so they outlive the scan
+    const char **paths = calloc(count, sizeof(const char *));
+    MachOQuickInfo *results = calloc(count, sizeof(MachOQuickInfo));
+    if (!paths || !results) {
+        free(paths);
+        free(results);
+        return @[];
+    }
+    
+    for (NSUInteger i = 0; i < count; i++) {
+        paths[i] = [filePaths[i] fileSystemRepresentation];
+    }
+    
+    macho_quick_scan_batch(paths, (uint32_t)count, results);
+    
+    NSMutableArray *infos = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++) {
+        if (results[i].is_valid) {
+            [infos addObject:[self dictionaryFromQuickInfo:&results[i]]];
+        } else {
+            [infos addObject:[NSNull null]];
+        }
     }
     
-    NSDictionary *info = @{
-        @"cpuType": [NSString stringWithUTF8String:macho_cpu_type_string(ctx->header.cputype)],
-        @"fileType": [NSString stringWithUTF8String:macho_filetype_string(ctx->header.filetype)],
-        @"is64Bit": @(ctx->header.is_64bit),
-        @"fileSize": @(ctx->file_size),
-        @"isEncrypted": @(ctx->is_encrypted)
-    };
+    free(paths);
+    free(results);
     
-    macho_close(ctx);
-    return info;
+    return infos;
 }
 
 + (NSArray<SymbolModel *> *)extractSymbolsFromPath:(NSString *)filePath error:(NSError **)error {
@@ -269,6 +344,8 @@ typedef NS_ENUM(NSInteger, ReDyneBinaryParserError) {
     model.flags = ctx->header.flags;
     model.is64Bit = ctx->header.is_64bit;
     model.isEncrypted = ctx->is_encrypted;
+    model.sliceOffset = ctx->slice_offset;
+    model.sliceSize = ctx->slice_size;
     
     if (ctx->has_uuid) {
         NSMutableString *uuidStr = [NSMutableString string];
@@ -344,5 +421,35 @@ typedef NS_ENUM(NSInteger, ReDyneBinaryParserError) {
     return model;
 }
 
++ (NSDictionary *)dictionaryFromQuickInfo:(const MachOQuickInfo *)info {
+    NSMutableArray *slices = [NSMutableArray arrayWithCapacity:info->slice_count];
+    for (uint32_t i = 0; i < info->slice_count; i++) {
+        const FatSliceInfo *slice = &info->slices[i];
+        [slices addObject:@{
+            @"cpuType": [NSString stringWithUTF8String:macho_cpu_type_string(slice->cputype)],
+            @"cpuSubtype": [NSString stringWithUTF8String:macho_cpu_subtype_string(slice->cputype, slice->cpusubtype)],
+            @"offset": @(slice->offset),
+            @"size": @(slice->size)
+        }];
+    }
+    
+    NSMutableDictionary *dict = [@{
+        @"cpuType": [NSString stringWithUTF8String:macho_cpu_type_string(info->cputype)],
+        @"fileType": [NSString stringWithUTF8String:macho_filetype_string(info->filetype)],
+        @"is64Bit": @(info->is_64bit),
+        @"fileSize": @(info->file_size),
+        @"isEncrypted": @(info->is_encrypted),
+        @"isFat": @(info->is_fat),
+        @"slices": slices
+    } mutableCopy];
+    
+    if (info->has_uuid) {
+        NSUUID *uuid = [[NSUUID alloc] initWithUUIDBytes:info->uuid];
+        dict[@"uuid"] = uuid.UUIDString;
+    }
+    
+    return dict;
+}
+
 @end
 
@@ -64,9 +64,7 @@ import Foundation
         for inst in instructions {
             currentBlock.append(inst)
             
-            let isBlockEnd = inst.category.contains("Branch") ||
-                           inst.mnemonic.uppercased().contains("RET") ||
-                           blockStarts.contains(inst.address + 4)
+            let isBlockEnd = inst.hasBranch || blockStarts.contains(inst.address + 4)
             
             if isBlockEnd && !currentBlock.isEmpty {
                 let startAddr = currentBlock.first!.address
@@ -83,10 +81,10 @@ import Foundation
                 if nodeID == 0 {
                     node.nodeType = .entry
                 }
-                if currentBlock.last?.mnemonic.uppercased().contains("RET") == true {
+                if currentBlock.last?.branchType == "Return" {
                     node.nodeType = .exit
                 }
-                if currentBlock.last?.mnemonic.uppercased().hasPrefix("B.") == true {
+                if currentBlock.last?.branchType == "Conditional" {
                     node.nodeType = .conditional
                 }
                 
@@ -108,18 +106,20 @@ import Foundation
                 
                 guard let lastInst = lastInst else { continue }
                 
-                let mnemonic = lastInst.mnemonic.uppercased()
+                // Branch kinds come from the decoder: CBZ/TBZ are conditional,
+                // BR without a target is an indirect jump
+                let branchType = lastInst.branchType ?? "None"
                 
-                if mnemonic == "RET" {
+                if branchType == "Return" {
                     continue
                 }
-                else if mnemonic == "B" {
+                else if branchType == "Unconditional" {
                     if lastInst.hasBranchTarget, let targetID = addressToNodeID[lastInst.branchTarget] {
                         let edge = CFGEdge(from: i, to: targetID, edgeType: .normal)
                         edges.append(edge)
                     }
                 }
-                else if mnemonic.hasPrefix("B.") {
+                else if branchType == "Conditional" {
                     if lastInst.hasBranchTarget, let targetID = addressToNodeID[lastInst.branchTarget] {
                         let branchEdge = CFGEdge(from: i, to: targetID, edgeType: .trueBranch)
                         edges.append(branchEdge)
@@ -129,15 +129,12 @@ import Foundation
                         edges.append(fallThroughEdge)
                     }
                 }
-                else if mnemonic == "BL" || mnemonic == "BLR" {
+                else if branchType == "Call" {
                     if i + 1 < nodes.count {
                         let callEdge = CFGEdge(from: i, to: i + 1, edgeType: .normal)
                         edges.append(callEdge)
                     }
                 }
-                else if mnemonic.contains("BR") && !mnemonic.contains("BRK") {
-                    continue
-                }
                 else {
                     if i + 1 < nodes.count {
                         let edge = CFGEdge(from: i, to: i + 1, edgeType: .normal)
@@ -1,5 +1,7 @@
 #import <Foundation/Foundation.h>
 #import "DecompiledOutput.h"
+#import "AnalysisSession.h"
+#import "DisassemblyPages.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -16,14 +18,50 @@ typedef void (^DisassemblyProgressBlock)(NSString *status, float progress);
                                                       endAddress:(uint64_t)endAddress
                                                            error:(NSError **)error;
 
+/// Disassembles __text through the session; the decoded instructions are memoized on it.
++ (nullable NSArray<InstructionModel *> *)disassembleSession:(AnalysisSession *)session
+                                               progressBlock:(nullable DisassemblyProgressBlock)progressBlock
+                                                       error:(NSError **)error;
+
++ (nullable NSArray<InstructionModel *> *)disassembleSession:(AnalysisSession *)session
+                                                startAddress:(uint64_t)startAddress
+                                                  endAddress:(uint64_t)endAddress
+                                                       error:(NSError **)error;
+
 + (NSArray<FunctionModel *> *)extractFunctionsFromInstructions:(NSArray<InstructionModel *> *)instructions
                                                         symbols:(NSArray<SymbolModel *> *)symbols;
 
+/// Functions found by recursive descent (session_functions()), each holding the slice of
+/// instructions inside its range. Falls back to extractFunctionsFromInstructions:symbols:
+/// when discovery finds nothing.
++ (NSArray<FunctionModel *> *)functionsForSession:(AnalysisSession *)session
+                                     instructions:(NSArray<InstructionModel *> *)instructions
+                                          symbols:(NSArray<SymbolModel *> *)symbols;
+
 + (nullable NSString *)generatePseudocodeForFunction:(FunctionModel *)function;
 
 + (nullable NSString *)buildCFGForFunction:(FunctionModel *)function;
 
 @end
 
+/// The code sections, stubs included, decoded a page at a time (DisassemblyPages.h) for views
+/// that only show part of them. Holds a reference to the session for as long as it lives.
+@interface PagedDisassembly : NSObject
+
+/// Nil when the binary has no code section.
+- (nullable instancetype)initWithSession:(AnalysisSession *)session;
+
+@property (nonatomic, readonly) NSInteger pageCount;
+
+/// Rows of the page, decoding it first if needed.
+- (NSInteger)rowCountOfPage:(NSInteger)page;
+
+- (nullable InstructionModel *)instructionAtRow:(NSInteger)row ofPage:(NSInteger)page;
+
+/// Decodes the pages in the background ahead of their first access.
+- (void)prefetchPagesFrom:(NSInteger)page count:(NSInteger)count;
+
+@end
+
 NS_ASSUME_NONNULL_END
 
@@ -2,6 +2,7 @@
 #import "MachOHeader.h"
 #import "DisassemblyEngine.h"
 #import "ControlFlowGraph.h"
+#import "AnalysisSession.h"
 
 static NSString * const ReDyneDisassemblerErrorDomain = @"com.jian.ReDyne.Disassembler";
 
@@ -11,6 +12,10 @@ typedef NS_ENUM(NSInteger, ReDyneDisassemblerError) {
     ReDyneDisassemblerErrorDisassemblyFailed = 2003
 };
 
+@interface DisassemblerService ()
++ (InstructionModel *)createInstructionModelFromDisasm:(DisassembledInstruction *)disasm;
+@end
+
 @implementation DisassemblerService
 
 #pragma mark - Public Methods
@@ -23,37 +28,45 @@ typedef NS_ENUM(NSInteger, ReDyneDisassemblerError) {
         progressBlock(@"Opening binary...", 0.0);
     }
     
-    MachOContext *macho_ctx = macho_open([filePath UTF8String], NULL);
-    if (!macho_ctx || !macho_parse_header(macho_ctx) || !macho_parse_load_commands(macho_ctx)) {
-        if (macho_ctx) macho_close(macho_ctx);
-        if (error) {
-            *error = [NSError errorWithDomain:ReDyneDisassemblerErrorDomain
-                                         code:ReDyneDisassemblerErrorInvalidFile
-                                     userInfo:@{NSLocalizedDescriptionKey: @"Invalid Mach-O file"}];
-        }
-        return nil;
-    }
+    AnalysisSession *session = [self openSessionAtPath:filePath error:error];
+    if (!session) return nil;
+    
+    NSArray<InstructionModel *> *instructions = [self disassembleSession:session progressBlock:progressBlock error:error];
+    session_release(session);
+    
+    return instructions;
+}
+
++ (NSArray<InstructionModel *> *)disassembleFileAtPath:(NSString *)filePath
+                                           startAddress:(uint64_t)startAddress
+                                             endAddress:(uint64_t)endAddress
+                                                  error:(NSError **)error {
+    
+    AnalysisSession *session = [self openSessionAtPath:filePath error:error];
+    if (!session) return nil;
+    
+    NSArray<InstructionModel *> *instructions = [self disassembleSession:session
+                                                            startAddress:startAddress
+                                                              endAddress:endAddress
+                                                                   error:error];
+    session_release(session);
+    
+    return instructions;
+}
+
++ (NSArray<InstructionModel *> *)disassembleSession:(AnalysisSession *)session
+                                      progressBlock:(DisassemblyProgressBlock)progressBlock
+                                              error:(NSError **)error {
     
-    macho_extract_segments(macho_ctx);
-    macho_extract_sections(macho_ctx);
+    MachOContext *macho_ctx = session_macho_context(session);
     
     if (progressBlock) {
-        progressBlock(@"Loading code section...", 0.2);
+        progressBlock(@"Disassembling instructions...", 0.4);
     }
     
-    DisassemblyContext *disasm_ctx = disasm_create(macho_ctx);
+    DisassemblyContext *disasm_ctx = session_disassembly(session);
     if (!disasm_ctx) {
-        macho_close(macho_ctx);
-        if (error) {
-            *error = [NSError errorWithDomain:ReDyneDisassemblerErrorDomain
-                                         code:ReDyneDisassemblerErrorDisassemblyFailed
-                                     userInfo:@{NSLocalizedDescriptionKey: @"Failed to create disassembly context"}];
-        }
-        return nil;
-    }
-    
-    if (!disasm_load_section(disasm_ctx, "__text")) {
-        NSLog(@"No __text section found. Available sections:");
+        NSLog(@"No code section found. Available sections:");
         for (uint32_t i = 0; i < macho_ctx->section_count; i++) {
             NSLog(@"   • %s (segment: %s, size: %llu bytes)",
                   macho_ctx->sections[i].sectname,
@@ -61,28 +74,20 @@ typedef NS_ENUM(NSInteger, ReDyneDisassemblerError) {
                   macho_ctx->sections[i].size);
         }
         
-        disasm_free(disasm_ctx);
-        macho_close(macho_ctx);
         if (error) {
             *error = [NSError errorWithDomain:ReDyneDisassemblerErrorDomain
                                          code:ReDyneDisassemblerErrorNoCodeSection
-                                     userInfo:@{NSLocalizedDescriptionKey: @"No __text section found"}];
+                                     userInfo:@{NSLocalizedDescriptionKey: @"No code section found"}];
         }
         return nil;
     }
     
-    if (progressBlock) {
-        progressBlock(@"Disassembling instructions...", 0.4);
-    }
-    
-    uint32_t count = disasm_all(disasm_ctx);
-    NSLog(@"Disassembled %u instructions from __text section (size: %llu bytes)",
-          count, disasm_ctx->code_size);
+    uint32_t count = disasm_ctx->instruction_count;
+    NSLog(@"Disassembled %u instructions from %u code sections, %u stubs (size: %llu bytes)",
+          count, disasm_ctx->section_count, disasm_ctx->stub_count, disasm_ctx->code_size);
     
     if (count == 0) {
-        NSLog(@"Warning: No instructions disassembled (empty or data-only __text)");
-        disasm_free(disasm_ctx);
-        macho_close(macho_ctx);
+        NSLog(@"Warning: No instructions disassembled (empty or data-only code sections)");
         return @[];
     }
     
@@ -90,9 +95,12 @@ typedef NS_ENUM(NSInteger, ReDyneDisassemblerError) {
         progressBlock(@"Building instruction models...", 0.8);
     }
     
+    // Rows are kept compact by the engine; each one is rendered into a scratch instruction
     NSMutableArray<InstructionModel *> *instructions = [NSMutableArray arrayWithCapacity:count];
+    DisassembledInstruction inst;
     for (uint32_t i = 0; i < count; i++) {
-        InstructionModel *model = [self createInstructionModelFromDisasm:&disasm_ctx->instructions[i]];
+        if (!disasm_get(disasm_ctx, i, &inst)) break;
+        InstructionModel *model = [self createInstructionModelFromDisasm:&inst];
         [instructions addObject:model];
     }
     
@@ -100,39 +108,22 @@ typedef NS_ENUM(NSInteger, ReDyneDisassemblerError) {
         progressBlock(@"Complete!", 1.0);
     }
     
-    disasm_free(disasm_ctx);
-    macho_close(macho_ctx);
-    
     return instructions;
 }
 
-+ (NSArray<InstructionModel *> *)disassembleFileAtPath:(NSString *)filePath
-                                           startAddress:(uint64_t)startAddress
-                                             endAddress:(uint64_t)endAddress
-                                                  error:(NSError **)error {
-    
-    MachOContext *macho_ctx = macho_open([filePath UTF8String], NULL);
-    if (!macho_ctx || !macho_parse_header(macho_ctx) || !macho_parse_load_commands(macho_ctx)) {
-        if (macho_ctx) macho_close(macho_ctx);
-        if (error) {
-            *error = [NSError errorWithDomain:ReDyneDisassemblerErrorDomain
-                                         code:ReDyneDisassemblerErrorInvalidFile
-                                     userInfo:@{NSLocalizedDescriptionKey: @"Invalid Mach-O file"}];
-        }
-        return nil;
-    }
-    
-    macho_extract_segments(macho_ctx);
-    macho_extract_sections(macho_ctx);
-    
-    DisassemblyContext *disasm_ctx = disasm_create(macho_ctx);
-    if (!disasm_ctx || !disasm_load_section(disasm_ctx, "__text")) {
++ (NSArray<InstructionModel *> *)disassembleSession:(AnalysisSession *)session
+                                       startAddress:(uint64_t)startAddress
+                                         endAddress:(uint64_t)endAddress
+                                              error:(NSError **)error {
+    
+    // Ranges are cheap and caller-specific, so they get a private context over the shared mapping
+    DisassemblyContext *disasm_ctx = disasm_create(session_macho_context(session));
+    if (!disasm_ctx || !disasm_load_executable(disasm_ctx)) {
         if (disasm_ctx) disasm_free(disasm_ctx);
-        macho_close(macho_ctx);
         if (error) {
             *error = [NSError errorWithDomain:ReDyneDisassemblerErrorDomain
                                          code:ReDyneDisassemblerErrorNoCodeSection
-                                     userInfo:@{NSLocalizedDescriptionKey: @"No __text section found"}];
+                                     userInfo:@{NSLocalizedDescriptionKey: @"No code section found"}];
         }
         return nil;
     }
@@ -142,20 +133,20 @@ typedef NS_ENUM(NSInteger, ReDyneDisassemblerError) {
     if (count == 0) {
         NSLog(@"Warning: No instructions in range 0x%llx-0x%llx", startAddress, endAddress);
         disasm_free(disasm_ctx);
-        macho_close(macho_ctx);
         return @[];
     }
     
     NSLog(@"Disassembled %u instructions in range 0x%llx-0x%llx", count, startAddress, endAddress);
     
     NSMutableArray<InstructionModel *> *instructions = [NSMutableArray arrayWithCapacity:count];
+    DisassembledInstruction inst;
     for (uint32_t i = 0; i < count; i++) {
-        InstructionModel *model = [self createInstructionModelFromDisasm:&disasm_ctx->instructions[i]];
+        if (!disasm_get(disasm_ctx, i, &inst)) break;
+        InstructionModel *model = [self createInstructionModelFromDisasm:&inst];
         [instructions addObject:model];
     }
     
     disasm_free(disasm_ctx);
-    macho_close(macho_ctx);
     
     return instructions;
 }
@@ -217,6 +208,53 @@ typedef NS_ENUM(NSInteger, ReDyneDisassemblerError) {
     return functions;
 }
 
++ (NSArray<FunctionModel *> *)functionsForSession:(AnalysisSession *)session
+                                     instructions:(NSArray<InstructionModel *> *)instructions
+                                          symbols:(NSArray<SymbolModel *> *)symbols {
+    
+    FunctionList *list = session_functions(session);
+    if (!list || list->count == 0) {
+        return [self extractFunctionsFromInstructions:instructions symbols:symbols];
+    }
+    
+    NSLog(@"Discovered %u functions by recursive descent", list->count);
+    
+    NSMutableArray<FunctionModel *> *functions = [NSMutableArray arrayWithCapacity:list->count];
+    NSUInteger count = instructions.count;
+    
+    for (uint32_t i = 0; i < list->count; i++) {
+        const DiscoveredFunction *discovered = &list->functions[i];
+        
+        // Instructions are in address order, so each range is one contiguous slice
+        NSUInteger low = 0;
+        NSUInteger high = count;
+        while (low < high) {
+            NSUInteger mid = low + (high - low) / 2;
+            if (instructions[mid].address < discovered->start_address) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        
+        NSUInteger end = low;
+        while (end < count && instructions[end].address < discovered->end_address) {
+            end++;
+        }
+        
+        FunctionModel *function = [[FunctionModel alloc] init];
+        function.startAddress = discovered->start_address;
+        function.endAddress = discovered->end_address;
+        function.name = discovered->name ? @(discovered->name)
+                                         : [NSString stringWithFormat:@"sub_%llx", discovered->start_address];
+        function.instructions = [instructions subarrayWithRange:NSMakeRange(low, end - low)];
+        function.instructionCount = (uint32_t)function.instructions.count;
+        [functions addObject:function];
+    }
+    
+    return functions;
+}
+
 + (NSString *)generatePseudocodeForFunction:(FunctionModel *)function {
     if (!function || !function.instructions) return nil;
     
@@ -257,7 +295,7 @@ typedef NS_ENUM(NSInteger, ReDyneDisassemblerError) {
              [self extractFirstOperand:inst.operands],
              [self extractSecondOperand:inst.operands]];
         }
-
+        
         else if ([mnem hasPrefix:@"AND"]) {
             [pseudo appendFormat:@"%@%@ &= %@;\n", indentStr,
              [self extractFirstOperand:inst.operands],
@@ -283,7 +321,7 @@ typedef NS_ENUM(NSInteger, ReDyneDisassemblerError) {
              [self extractFirstOperand:inst.operands],
              [self extractSecondOperand:inst.operands]];
         }
-
+        
         else if ([mnem hasPrefix:@"LDR"]) {
             [pseudo appendFormat:@"%@%@ = *(%@);\n", indentStr,
              [self extractFirstOperand:inst.operands],
@@ -304,7 +342,7 @@ typedef NS_ENUM(NSInteger, ReDyneDisassemblerError) {
              [self extractFirstOperand:inst.operands],
              [self extractSecondOperand:inst.operands]];
         }
-
+        
         else if ([mnem hasPrefix:@"STP"]) {
             [pseudo appendFormat:@"%@push(%@, %@);\n", indentStr,
              [self extractFirstOperand:inst.operands],
@@ -315,7 +353,7 @@ typedef NS_ENUM(NSInteger, ReDyneDisassemblerError) {
              [self extractFirstOperand:inst.operands],
              [self extractSecondOperand:inst.operands]];
         }
-
+        
         else if ([mnem hasPrefix:@"CMP"]) {
             [pseudo appendFormat:@"%@compare(%@, %@);\n", indentStr,
              [self extractFirstOperand:inst.operands],
@@ -326,7 +364,7 @@ typedef NS_ENUM(NSInteger, ReDyneDisassemblerError) {
              [self extractFirstOperand:inst.operands],
              [self extractSecondOperand:inst.operands]];
         }
-
+        
         else if ([mnem hasPrefix:@"B.EQ"] && inst.hasBranchTarget) {
             [pseudo appendFormat:@"%@if (equal) goto loc_%llx;\n", indentStr, inst.branchTarget];
         }
@@ -348,26 +386,26 @@ typedef NS_ENUM(NSInteger, ReDyneDisassemblerError) {
         else if ([mnem hasPrefix:@"B."] && inst.hasBranchTarget) {
             [pseudo appendFormat:@"%@if (condition) goto loc_%llx;\n", indentStr, inst.branchTarget];
         }
-
+        
         else if ([mnem isEqualToString:@"B"] && inst.hasBranchTarget) {
             [pseudo appendFormat:@"%@goto loc_%llx;\n", indentStr, inst.branchTarget];
         }
-
+        
         else if ([mnem isEqualToString:@"BL"] && inst.hasBranchTarget) {
             [pseudo appendFormat:@"%@call_0x%llx();\n", indentStr, inst.branchTarget];
         }
         else if ([mnem isEqualToString:@"BLR"]) {
             [pseudo appendFormat:@"%@call_indirect(%@);\n", indentStr, [self extractFirstOperand:inst.operands]];
         }
-
+        
         else if ([mnem isEqualToString:@"RET"]) {
             [pseudo appendFormat:@"%@return;\n", indentStr];
         }
-
+        
         else if ([mnem isEqualToString:@"NOP"]) {
             [pseudo appendFormat:@"%@/* nop */\n", indentStr];
         }
-
+        
         else if ([mnem hasPrefix:@"FADD"] || [mnem hasPrefix:@"FSUB"] || 
                  [mnem hasPrefix:@"FMUL"] || [mnem hasPrefix:@"FDIV"]) {
             NSString *op = @"?";
@@ -391,7 +429,7 @@ typedef NS_ENUM(NSInteger, ReDyneDisassemblerError) {
 }
 
 + (NSString *)buildCFGForFunction:(FunctionModel *)function {
-
+    
     NSMutableString *dot = [NSMutableString string];
     [dot appendString:@"digraph CFG {\n"];
     [dot appendFormat:@"  label=\"%@ CFG\";\n", function.name];
@@ -411,7 +449,7 @@ typedef NS_ENUM(NSInteger, ReDyneDisassemblerError) {
     for (NSInteger i = 0; i < instructions.count; i++) {
         InstructionModel *inst = instructions[i];
         
-        if ([inst.mnemonic hasPrefix:@"B"] && ![inst.mnemonic isEqualToString:@"BRK"]) {
+        if (inst.hasBranch) {
             if (i + 1 < instructions.count) {
                 [blockStarts addObject:@(i + 1)];
             }
@@ -465,11 +503,12 @@ typedef NS_ENUM(NSInteger, ReDyneDisassemblerError) {
         NSArray<InstructionModel *> *block = blocks[i];
         InstructionModel *lastInst = block.lastObject;
         
-        NSString *mnemonic = lastInst.mnemonic;
+        NSString *branchType = lastInst.branchType ?: @"None";
         
-        if ([mnemonic isEqualToString:@"RET"]) {
+        if ([branchType isEqualToString:@"Return"]) {
             
-        } else if ([mnemonic isEqualToString:@"B"] && lastInst.hasBranchTarget) {
+        } else if ([branchType isEqualToString:@"Unconditional"]) {
+            // BR has no known target and so no edge
             for (NSInteger j = 0; j < blocks.count; j++) {
                 InstructionModel *targetFirst = [blocks[j] firstObject];
                 if (targetFirst.address == lastInst.branchTarget) {
@@ -477,7 +516,7 @@ typedef NS_ENUM(NSInteger, ReDyneDisassemblerError) {
                     break;
                 }
             }
-        } else if ([mnemonic hasPrefix:@"B."] && lastInst.hasBranchTarget) {
+        } else if ([branchType isEqualToString:@"Conditional"] && lastInst.hasBranchTarget) {
             for (NSInteger j = 0; j < blocks.count; j++) {
                 InstructionModel *targetFirst = [blocks[j] firstObject];
                 if (targetFirst.address == lastInst.branchTarget) {
@@ -490,7 +529,7 @@ typedef NS_ENUM(NSInteger, ReDyneDisassemblerError) {
                 [dot appendFormat:@"  bb_%ld -> bb_%ld [label=\"false\", color=red];\n", (long)i, (long)(i + 1)];
             }
         } else {
-
+            
             if (i + 1 < blocks.count) {
                 [dot appendFormat:@"  bb_%ld -> bb_%ld;\n", (long)i, (long)(i + 1)];
             }
@@ -504,11 +543,22 @@ typedef NS_ENUM(NSInteger, ReDyneDisassemblerError) {
 
 #pragma mark - Private Helpers
 
++ (AnalysisSession *)openSessionAtPath:(NSString *)filePath error:(NSError **)error {
+    AnalysisSession *session = session_open([filePath UTF8String], NULL, NULL);
+    if (!session && error) {
+        *error = [NSError errorWithDomain:ReDyneDisassemblerErrorDomain
+                                     code:ReDyneDisassemblerErrorInvalidFile
+                                 userInfo:@{NSLocalizedDescriptionKey: @"Invalid Mach-O file"}];
+    }
+    return session;
+}
+
 + (InstructionModel *)createInstructionModelFromDisasm:(DisassembledInstruction *)disasm {
     InstructionModel *model = [[InstructionModel alloc] init];
     
     model.address = disasm->address;
     model.hexBytes = [NSString stringWithFormat:@"%08X", disasm->raw_bytes];
+    model.rawBytes = disasm->raw_bytes;
     model.mnemonic = [NSString stringWithUTF8String:disasm->mnemonic];
     model.operands = [NSString stringWithUTF8String:disasm->operands];
     model.fullDisassembly = [NSString stringWithUTF8String:disasm->full_disasm];
@@ -561,3 +611,63 @@ typedef NS_ENUM(NSInteger, ReDyneDisassemblerError) {
 
 @end
 
+@implementation PagedDisassembly {
+    AnalysisSession *_session;
+    DisassemblyPageCache *_pages;
+}
+
+- (instancetype)initWithSession:(AnalysisSession *)session {
+    self = [super init];
+    if (!self) return nil;
+    
+    // The pages decode straight from the session's mapping
+    _pages = disasm_pages_create(session_macho_context(session), 0);
+    if (!_pages) return nil;
+    _session = session_retain(session);
+    
+    return self;
+}
+
+- (void)dealloc {
+    disasm_pages_free(_pages);
+    if (_session) session_release(_session);
+}
+
+- (NSInteger)pageCount {
+    return disasm_pages_count(_pages);
+}
+
+- (NSInteger)rowCountOfPage:(NSInteger)page {
+    if (page < 0 || page >= self.pageCount) return 0;
+    
+    const DisassemblyPage *decoded = disasm_pages_acquire(_pages, (uint32_t)page);
+    if (!decoded) return 0;
+    
+    NSInteger count = decoded->disasm->instruction_count;
+    disasm_pages_release(_pages, decoded);
+    return count;
+}
+
+- (InstructionModel *)instructionAtRow:(NSInteger)row ofPage:(NSInteger)page {
+    if (page < 0 || page >= self.pageCount || row < 0) return nil;
+    
+    const DisassemblyPage *decoded = disasm_pages_acquire(_pages, (uint32_t)page);
+    if (!decoded) return nil;
+    
+    InstructionModel *model = nil;
+    DisassembledInstruction inst;
+    if (row < decoded->disasm->instruction_count && disasm_get(decoded->disasm, (uint32_t)row, &inst)) {
+        model = [DisassemblerService createInstructionModelFromDisasm:&inst];
+    }
+    
+    disasm_pages_release(_pages, decoded);
+    return model;
+}
+
+- (void)prefetchPagesFrom:(NSInteger)page count:(NSInteger)count {
+    if (page < 0 || count <= 0) return;
+    disasm_pages_prefetch(_pages, (uint32_t)page, (uint32_t)count);
+}
+
+@end
+
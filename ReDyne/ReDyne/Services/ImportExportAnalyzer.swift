@@ -13,6 +13,22 @@ import Foundation
         }
         defer { dyld_free_imports(importListPtr) }
         
+        guard let exportListPtr = dyld_parse_exports(ctx) else {
+            print("Failed to parse exports")
+            return nil
+        }
+        defer { dyld_free_exports(exportListPtr) }
+        
+        return analyze(importList: importListPtr, exportList: exportListPtr, machOContext: machOContext)
+    }
+    
+    // Builds the analysis from already parsed lists, e.g. ones memoized by an AnalysisSession.
+    // The lists stay owned by the caller.
+    @objc static func analyze(importList importListPtr: UnsafeMutablePointer<ImportList>,
+                              exportList exportListPtr: UnsafeMutablePointer<ExportList>,
+                              machOContext: OpaquePointer) -> ImportExportAnalysis? {
+        let ctx = UnsafeMutablePointer<MachOContext>(machOContext)
+        
         let importList = importListPtr.pointee
         var imports: [ImportedSymbol] = []
         
@@ -27,12 +43,6 @@ import Foundation
         
         print("Parsed \(imports.count) imports")
         
-        guard let exportListPtr = dyld_parse_exports(ctx) else {
-            print("Failed to parse exports")
-            return nil
-        }
-        defer { dyld_free_exports(exportListPtr) }
-        
         let exportList = exportListPtr.pointee
         var exports: [ExportedSymbol] = []
         
@@ -23,6 +23,20 @@ import Foundation
             objc_free_runtime_info(runtimeInfo)
         }
         
+        let result = analyze(runtimeInfo: runtimeInfo)
+        
+        let elapsed = CFAbsoluteTimeGetCurrent() - startTime
+        print("✅ ObjC analysis complete in \(String(format: "%.2f", elapsed))s")
+        print("   • \(result.totalClasses) classes (\(result.swiftClassCount) Swift, \(result.objcClassCount) ObjC)")
+        print("   • \(result.totalMethods) methods")
+        print("   • \(result.totalProperties) properties")
+        print("   • \(result.totalIvars) ivars")
+        
+        return result
+    }
+    
+    /// Converts runtime info that someone else owns, e.g. the memoized result of an AnalysisSession.
+    @objc static func analyze(runtimeInfo: UnsafeMutablePointer<ObjCRuntimeInfo>) -> ObjCAnalysisResult {
         let info = runtimeInfo.pointee
         
         var classes: [ObjCClass] = []
@@ -58,16 +72,7 @@ import Foundation
             }
         }
         
-        let result = ObjCAnalysisResult(classes: classes, categories: categories, protocols: protocols)
-        
-        let elapsed = CFAbsoluteTimeGetCurrent() - startTime
-        print("✅ ObjC analysis complete in \(String(format: "%.2f", elapsed))s")
-        print("   • \(result.totalClasses) classes (\(result.swiftClassCount) Swift, \(result.objcClassCount) ObjC)")
-        print("   • \(result.totalMethods) methods")
-        print("   • \(result.totalProperties) properties")
-        print("   • \(result.totalIvars) ivars")
-        
-        return result
+        return ObjCAnalysisResult(classes: classes, categories: categories, protocols: protocols)
     }
     
     // MARK: - Conversion Methods
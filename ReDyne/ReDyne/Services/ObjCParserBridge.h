@@ -1,4 +1,5 @@
 #import <Foundation/Foundation.h>
+#import "AnalysisSession.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -10,6 +11,12 @@ NS_ASSUME_NONNULL_BEGIN
 
 + (nullable id)parseCodeSignatureAtPath:(NSString *)filePath;
 
++ (nullable id)parseObjCRuntimeWithSession:(AnalysisSession *)session NS_SWIFT_NAME(parseObjCRuntime(session:));
+
++ (nullable id)parseImportsExportsWithSession:(AnalysisSession *)session NS_SWIFT_NAME(parseImportsExports(session:));
+
++ (nullable id)parseCodeSignatureWithSession:(AnalysisSession *)session NS_SWIFT_NAME(parseCodeSignature(session:));
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -2,62 +2,73 @@
 #import "MachOHeader.h"
 #import "ObjCParser.h"
 #import "DyldInfo.h"
+#import "AnalysisSession.h"
 #import "ReDyne-Swift.h"
 
 @implementation ObjCParserBridge
 
 + (nullable id)parseObjCRuntimeAtPath:(NSString *)filePath {
-    MachOContext *ctx = macho_open([filePath UTF8String], NULL);
-    if (!ctx) {
+    AnalysisSession *session = session_open([filePath UTF8String], NULL, NULL);
+    if (!session) {
         return nil;
     }
     
-    if (!macho_parse_header(ctx) || !macho_parse_load_commands(ctx)) {
-        macho_close(ctx);
-        return nil;
-    }
-    
-    id result = [ObjCAnalyzer analyzeWithMachOContext:ctx];
+    id result = [self parseObjCRuntimeWithSession:session];
     
-    macho_close(ctx);
+    session_release(session);
     
     return result;
 }
 
 + (nullable id)parseImportsExportsAtPath:(NSString *)filePath {
-    MachOContext *ctx = macho_open([filePath UTF8String], NULL);
-    if (!ctx) {
+    AnalysisSession *session = session_open([filePath UTF8String], NULL, NULL);
+    if (!session) {
         return nil;
     }
     
-    if (!macho_parse_header(ctx) || !macho_parse_load_commands(ctx)) {
-        macho_close(ctx);
+    id result = [self parseImportsExportsWithSession:session];
+    
+    session_release(session);
+    
+    return result;
+}
+
++ (nullable id)parseCodeSignatureAtPath:(NSString *)filePath {
+    AnalysisSession *session = session_open([filePath UTF8String], NULL, NULL);
+    if (!session) {
         return nil;
     }
     
-    id result = [ImportExportAnalyzer analyzeWithMachOContext:ctx];
+    id result = [self parseCodeSignatureWithSession:session];
     
-    macho_close(ctx);
+    session_release(session);
     
     return result;
 }
 
-+ (nullable id)parseCodeSignatureAtPath:(NSString *)filePath {
-    MachOContext *ctx = macho_open([filePath UTF8String], NULL);
-    if (!ctx) {
++ (nullable id)parseObjCRuntimeWithSession:(AnalysisSession *)session {
+    ObjCRuntimeInfo *runtime_info = session_objc_runtime(session);
+    if (!runtime_info) {
         return nil;
     }
     
-    if (!macho_parse_header(ctx) || !macho_parse_load_commands(ctx)) {
-        macho_close(ctx);
+    return [ObjCAnalyzer analyzeWithRuntimeInfo:runtime_info];
+}
+
++ (nullable id)parseImportsExportsWithSession:(AnalysisSession *)session {
+    ImportList *imports = session_imports(session);
+    ExportList *exports = session_exports(session);
+    if (!imports || !exports) {
         return nil;
     }
     
-    id result = [CodeSignatureAnalyzer analyzeWithMachOContext:ctx];
-    
-    macho_close(ctx);
-    
-    return result;
+    return [ImportExportAnalyzer analyzeWithImportList:imports
+                                            exportList:exports
+                                           machOContext:session_macho_context(session)];
+}
+
++ (nullable id)parseCodeSignatureWithSession:(AnalysisSession *)session {
+    return [CodeSignatureAnalyzer analyzeWithMachOContext:session_macho_context(session)];
 }
 
 @end
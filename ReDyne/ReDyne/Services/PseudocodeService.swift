@@ -49,6 +49,28 @@ public class PseudocodeService {
         from disassembly: String,
         startAddress: UInt64,
         functionName: String? = nil
+    ) -> Result<PseudocodeOutput, PseudocodeError> {
+        let lines = disassembly.components(separatedBy: .newlines)
+        var address = startAddress
+        var instructions: [PseudocodeInstruction] = []
+        
+        for line in lines where !line.isEmpty {
+            let trimmed = line.trimmingCharacters(in: .whitespaces)
+            if trimmed.isEmpty { continue }
+            
+            if let instruction = parseInstruction(trimmed, address: &address) {
+                instructions.append(instruction)
+            }
+        }
+        
+        return generatePseudocode(from: instructions, functionName: functionName)
+    }
+    
+    /// Instructions that carry their raw bytes are decoded by the generator
+    /// itself; the text is only used for those that do not.
+    private func generatePseudocode(
+        from instructions: [PseudocodeInstruction],
+        functionName: String?
     ) -> Result<PseudocodeOutput, PseudocodeError> {
         return queue.sync {
             let generator = pseudocode_generator_create()
@@ -63,16 +85,8 @@ public class PseudocodeService {
             var config = configuration.toCConfig
             pseudocode_generator_set_config(generator, &config)
             
-            let lines = disassembly.components(separatedBy: .newlines)
-            var address = startAddress
-            
-            for line in lines where !line.isEmpty {
-                let trimmed = line.trimmingCharacters(in: .whitespaces)
-                if trimmed.isEmpty { continue }
-                
-                if var instruction = parseInstruction(trimmed, address: &address) {
-                    pseudocode_generator_add_instruction(generator, &instruction)
-                }
+            for var instruction in instructions {
+                pseudocode_generator_add_instruction(generator, &instruction)
             }
             
             if let name = functionName {
@@ -136,22 +150,15 @@ public class PseudocodeService {
         // Extract function instructions (simplified: get 100 instructions from start)
         let startIdx = instructions.firstIndex(where: { $0.address == function.address }) ?? 0
         let endIdx = min(startIdx + 100, instructions.count)
-        let functionInstructions = Array(instructions[startIdx..<endIdx])
-        
-        var disassembly = ""
-        for inst in functionInstructions {
-            disassembly += String(format: "0x%llx: %@ %@ %@\n",
-                                inst.address,
-                                inst.hexBytes,
-                                inst.mnemonic,
-                                inst.operands)
+        let functionInstructions = instructions[startIdx..<endIdx].map { inst -> PseudocodeInstruction in
+            var instruction = PseudocodeInstruction()
+            instruction.address = inst.address
+            instruction.raw_bytes = inst.rawBytes
+            setText(of: &instruction, mnemonic: inst.mnemonic, operands: inst.operands)
+            return instruction
         }
         
-        return generatePseudocode(
-            from: disassembly,
-            startAddress: function.address,
-            functionName: symbolName
-        )
+        return generatePseudocode(from: functionInstructions, functionName: symbolName)
     }
     
     public func generatePseudocode(
@@ -159,9 +166,11 @@ public class PseudocodeService {
         startAddress: UInt64,
         architecture: Architecture = .arm64
     ) -> Result<PseudocodeOutput, PseudocodeError> {
-        var disassembly = ""
+        var instructions: [PseudocodeInstruction] = []
         var currentAddr = startAddress
         
+        // The words go to the generator as they are; only the mnemonic is
+        // named here, for the words it cannot decode
         for i in stride(from: 0, to: bytes.count, by: 4) {
             guard i + 4 <= bytes.count else { break }
             
@@ -170,35 +179,39 @@ public class PseudocodeService {
                 ptr.load(as: UInt32.self)
             }
             
-            var decoded = ARM64DecodedInstruction()
-            let success = arm64dec_decode_instruction(rawInstruction, currentAddr, &decoded)
+            var decoded = ARM64DecodedWord()
+            arm64_decode_word(rawInstruction, &decoded)
             
-            if success {
-                var buffer = [CChar](repeating: 0, count: 512)
-                let _ = arm64dec_format_instruction(&decoded, &buffer, 512)
-                let assembly = String(cString: buffer)
-                
-                disassembly += String(format: "0x%llx: %@\n", currentAddr, assembly)
-            } else {
-                disassembly += String(format: "0x%llx: .long 0x%08X\n", currentAddr, rawInstruction)
-            }
+            var instruction = PseudocodeInstruction()
+            instruction.address = currentAddr
+            instruction.raw_bytes = rawInstruction
+            setText(of: &instruction, mnemonic: String(cString: arm64_mnemonic_name(decoded.mnemonic)), operands: "")
+            instructions.append(instruction)
             
             currentAddr += 4
         }
         
-        if disassembly.isEmpty {
+        if instructions.isEmpty {
             return .failure(.invalidInput)
         }
         
         return generatePseudocode(
-            from: disassembly,
-            startAddress: startAddress,
+            from: instructions,
             functionName: "FUN_\(String(format: "%08llx", startAddress))"
         )
     }
     
     // MARK: - Helper Methods
     
+    private func setText(of instruction: inout PseudocodeInstruction, mnemonic: String, operands: String) {
+        _ = mnemonic.withCString { ptr in
+            strncpy(&instruction.mnemonic.0, ptr, 31)
+        }
+        _ = operands.withCString { ptr in
+            strncpy(&instruction.operands.0, ptr, 127)
+        }
+    }
+    
     private func parseInstruction(_ line: String, address: inout UInt64) -> PseudocodeInstruction? {
         var instruction = PseudocodeInstruction()
         instruction.address = address
@@ -7,7 +7,6 @@ enum Constants {
     // MARK: - File Constraints
     
     enum File {
-        static let maxFileSize: Int64 = 200 * 1024 * 1024
         static let allowedExtensions = ["dylib", "so", ""]
         static let tempDirectoryName = "ReDyneTempFiles"
     }
@@ -49,6 +48,7 @@ enum Constants {
         static let defaultContextLines = 5
         static let maxInstructionsDisplay = 10000
         static let instructionsPerPage = 100
+        static let prefetchPages = 4
     }
     
     // MARK: - Export Settings
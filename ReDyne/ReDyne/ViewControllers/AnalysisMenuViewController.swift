@@ -14,6 +14,7 @@ enum AnalysisType: String, CaseIterable {
     case memoryMap = "Memory Map"
     case pseudocode = "Pseudocode Generation"
     case binaryPatching = "Binary Patching"
+    case architectures = "Compare Architectures"
     
     var icon: String {
         switch self {
@@ -26,6 +27,7 @@ enum AnalysisType: String, CaseIterable {
         case .memoryMap: return "square.stack.3d.up"
         case .pseudocode: return "doc.text.magnifyingglass"
         case .binaryPatching: return "bandage"
+        case .architectures: return "cpu"
         }
     }
     
@@ -40,6 +42,7 @@ enum AnalysisType: String, CaseIterable {
         case .memoryMap: return "Visual segment and section layout"
         case .pseudocode: return "High-level code reconstruction"
         case .binaryPatching: return "Apply and manage binary patches"
+        case .architectures: return "Every slice of a universal binary, side by side"
         }
     }
 }
@@ -50,11 +53,13 @@ class AnalysisMenuViewController: UITableViewController {
 
     private let hasObjCData: Bool
     private let hasCodeSignature: Bool
+    private let isUniversal: Bool
     private let availableTypes: [AnalysisType]
 
-    init(hasObjCData: Bool = false, hasCodeSignature: Bool = false) {
+    init(hasObjCData: Bool = false, hasCodeSignature: Bool = false, isUniversal: Bool = false) {
         self.hasObjCData = hasObjCData
         self.hasCodeSignature = hasCodeSignature
+        self.isUniversal = isUniversal
 
         var types = [AnalysisType]()
         for type in AnalysisType.allCases {
@@ -63,6 +68,8 @@ class AnalysisMenuViewController: UITableViewController {
                 if hasObjCData { types.append(type) }
             case .signature:
                 if hasCodeSignature { types.append(type) }
+            case .architectures:
+                if isUniversal { types.append(type) }
             default:
                 types.append(type)
             }
@@ -140,9 +140,40 @@ class DecompileViewController: UIViewController {
             
             var output: DecompiledOutput?
             
+            // One parsed binary shared by every stage below instead of each reopening the file
+            // Opened through the parser service so a missing file or a bad header keeps its own error
+            let session: OpaquePointer
             do {
-                output = try BinaryParserService.parseBinary(
-                    atPath: self.fileURL.path,
+                session = try BinaryParserService.openSession(atPath: self.fileURL.path, slice: nil, progressBlock: nil)
+            } catch {
+                DispatchQueue.main.async {
+                    self.handleError(error)
+                }
+                return
+            }
+            defer { session_release(session) }
+            
+            // Reopening a binary we have already analyzed skips straight to the stored stage results
+            let cacheDirectory = FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask).first?
+                .appendingPathComponent("AnalysisCache").path
+            if let cacheDirectory = cacheDirectory {
+                self.updateStatus("Checking analysis cache...", progress: 0.02)
+                session_load_cache(session, cacheDirectory)
+            }
+            
+            // Symbols, strings, code, functions and ObjC metadata only read the shared mapping, so extract them side by side.
+            // An encrypted binary is rejected by parseSession below, so its ciphertext is not decoded first.
+            if session_macho_context(session)?.pointee.is_encrypted == false {
+                self.updateStatus("Analyzing binary...", progress: 0.05)
+                let stages: [SessionSlot] = [SESSION_SLOT_SYMBOLS, SESSION_SLOT_STRINGS, SESSION_SLOT_DISASSEMBLY,
+                                             SESSION_SLOT_FUNCTIONS, SESSION_SLOT_OBJC, SESSION_SLOT_IMPORTS,
+                                             SESSION_SLOT_EXPORTS]
+                session_prefetch(session, stages, UInt32(stages.count))
+            }
+            
+            do {
+                output = try BinaryParserService.parseSession(
+                    session,
                     progressBlock: { status, progress in
                         DispatchQueue.main.async {
                             self.statusLabel.text = status
@@ -164,11 +195,14 @@ class DecompileViewController: UIViewController {
                 return
             }
             
+            // The code view decodes the code sections a page at a time instead of showing the list below
+            output.pagedDisassembly = PagedDisassembly(session: session)
+            
             self.updateStatus("Disassembling code...", progress: 0.6)
             
             do {
-                let instructions = try DisassemblerService.disassembleFile(
-                    atPath: self.fileURL.path,
+                let instructions = try DisassemblerService.disassembleSession(
+                    session,
                     progressBlock: { status, progress in
                         DispatchQueue.main.async {
                             self.statusLabel.text = status
@@ -180,31 +214,32 @@ class DecompileViewController: UIViewController {
                 output.instructions = instructions
                 output.totalInstructions = UInt(instructions.count)
                 
-                let functions = DisassemblerService.extractFunctions(fromInstructions: instructions, symbols: output.symbols)
+                let functions = DisassemblerService.functions(forSession: session, instructions: instructions, symbols: output.symbols)
                 output.functions = functions
                 
                 self.updateStatus("Analyzing cross-references...", progress: 0.85)
-                let disassemblyText = instructions.map { $0.fullDisassembly }.joined(separator: "\n")
-                let symbols = (output.symbols as NSArray).map { $0 as! SymbolModel }
-                let symbolInfos = symbols.map { SymbolInfo(from: $0) }
-                let xrefResult = XrefAnalyzer.analyze(disassembly: disassemblyText, symbols: symbolInfos)
-                output.xrefAnalysis = xrefResult
-                output.totalXrefs = UInt(xrefResult.totalXrefs)
-                output.totalCalls = UInt(xrefResult.totalCalls)
-                
+                if let context = session_disassembly(session) {
+                    let symbols = (output.symbols as NSArray).map { $0 as! SymbolModel }
+                    let symbolInfos = symbols.map { SymbolInfo(from: $0) }
+                    let xrefResult = XrefAnalyzer.analyze(context: context, instructions: instructions, symbols: symbolInfos)
+                    output.xrefAnalysis = xrefResult
+                    output.totalXrefs = UInt(xrefResult.totalXrefs)
+                    output.totalCalls = UInt(xrefResult.totalCalls)
+                }
+            
             } catch {
                 ErrorHandler.log(error)
             }
             
             self.updateStatus("Analyzing Objective-C runtime...", progress: 0.90)
-            if let objcResult = ObjCParserBridge.parseObjCRuntime(atPath: self.fileURL.path) as? ObjCAnalysisResult {
+            if let objcResult = ObjCParserBridge.parseObjCRuntime(session: session) as? ObjCAnalysisResult {
                 output.objcAnalysis = objcResult
                 output.totalObjCClasses = UInt(objcResult.totalClasses)
                 output.totalObjCMethods = UInt(objcResult.totalMethods)
             }
             
             self.updateStatus("Analyzing imports and exports...", progress: 0.93)
-            if let importExportResult = ObjCParserBridge.parseImportsExports(atPath: self.fileURL.path) as? ImportExportAnalysis {
+            if let importExportResult = ObjCParserBridge.parseImportsExports(session: session) as? ImportExportAnalysis {
                 output.importExportAnalysis = importExportResult
                 output.totalImports = UInt(importExportResult.totalImports)
                 output.totalExports = UInt(importExportResult.totalExports)
@@ -212,7 +247,7 @@ class DecompileViewController: UIViewController {
             }
             
             self.updateStatus("Analyzing code signature...", progress: 0.94)
-            if let codeSignResult = ObjCParserBridge.parseCodeSignature(atPath: self.fileURL.path) as? CodeSigningAnalysis {
+            if let codeSignResult = ObjCParserBridge.parseCodeSignature(session: session) as? CodeSigningAnalysis {
                 output.codeSigningAnalysis = codeSignResult
             }
             
@@ -222,6 +257,11 @@ class DecompileViewController: UIViewController {
             output.cfgAnalysis = cfgResult
             
             self.updateStatus("Finalizing...", progress: 0.99)
+            // Also after a partial hit, so the stages recomputed this time are stored;
+            // a session loaded from a complete cache writes nothing
+            if let cacheDirectory = cacheDirectory {
+                session_save_cache(session, cacheDirectory)
+            }
             
             DispatchQueue.main.async {
                 self.showResults(output)
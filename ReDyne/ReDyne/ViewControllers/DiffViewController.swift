@@ -101,6 +101,35 @@ class DiffViewController: UIViewController {
     
     // MARK: - Content Updates
     
+    // Slices of one universal binary share a file name, so name the architecture too
+    private func heading(for output: DecompiledOutput) -> String {
+        guard leftOutput.fileName == rightOutput.fileName else { return output.fileName }
+        return "\(output.fileName) (\(output.header.cpuType))"
+    }
+    
+    // Slice outputs carry only the paged code view, so their first rows come from it
+    private func leadingInstructions(of output: DecompiledOutput, limit: Int) -> [InstructionModel] {
+        guard output.instructions.isEmpty, let pages = output.pagedDisassembly else {
+            return Array(output.instructions.prefix(limit))
+        }
+        
+        var rows: [InstructionModel] = []
+        var page = 0
+        while rows.count < limit && page < pages.pageCount {
+            let count = min(pages.rowCount(ofPage: page), limit - rows.count)
+            rows += (0..<count).compactMap { pages.instruction(atRow: $0, ofPage: page) }
+            page += 1
+        }
+        return rows
+    }
+    
+    private func instructionSummary(of output: DecompiledOutput) -> String {
+        if output.instructions.isEmpty, let pages = output.pagedDisassembly {
+            return "Code pages: \(pages.pageCount)"
+        }
+        return "Instructions: \(output.instructions.count)"
+    }
+    
     @objc private func modeChanged() {
         updateContent()
     }
@@ -122,14 +151,14 @@ class DiffViewController: UIViewController {
         let leftSymbols = leftOutput.symbols.sortedByName()
         let rightSymbols = rightOutput.symbols.sortedByName()
         
-        var leftText = "=== \(leftOutput.fileName) ===\n"
+        var leftText = "=== \(heading(for: leftOutput)) ===\n"
         leftText += "Symbols: \(leftSymbols.count)\n\n"
         
         for symbol in leftSymbols.prefix(100) {
             leftText += "\(Constants.formatAddress(symbol.address, padding: 12)) \(symbol.name)\n"
         }
         
-        var rightText = "=== \(rightOutput.fileName) ===\n"
+        var rightText = "=== \(heading(for: rightOutput)) ===\n"
         rightText += "Symbols: \(rightSymbols.count)\n\n"
         
         for symbol in rightSymbols.prefix(100) {
@@ -155,10 +184,10 @@ class DiffViewController: UIViewController {
     }
     
     private func showDisassemblyComparison() {
-        var leftText = "=== \(leftOutput.fileName) ===\n"
-        leftText += "Instructions: \(leftOutput.instructions.count)\n\n"
+        var leftText = "=== \(heading(for: leftOutput)) ===\n"
+        leftText += "\(instructionSummary(of: leftOutput))\n\n"
         
-        for inst in leftOutput.instructions.prefix(50) {
+        for inst in leadingInstructions(of: leftOutput, limit: 50) {
             leftText += inst.fullDisassembly + "\n"
         }
         
@@ -166,10 +195,10 @@ class DiffViewController: UIViewController {
             leftText += "\n... and \(leftOutput.instructions.count - 50) more instructions\n"
         }
         
-        var rightText = "=== \(rightOutput.fileName) ===\n"
-        rightText += "Instructions: \(rightOutput.instructions.count)\n\n"
+        var rightText = "=== \(heading(for: rightOutput)) ===\n"
+        rightText += "\(instructionSummary(of: rightOutput))\n\n"
         
-        for inst in rightOutput.instructions.prefix(50) {
+        for inst in leadingInstructions(of: rightOutput, limit: 50) {
             rightText += inst.fullDisassembly + "\n"
         }
         
@@ -190,7 +219,7 @@ class DiffViewController: UIViewController {
     }
     
     private func generateStatistics(for output: DecompiledOutput) -> String {
-        var stats = "=== \(output.fileName) ===\n\n"
+        var stats = "=== \(heading(for: output)) ===\n\n"
         
         stats += "File Information:\n"
         stats += "  Size: \(Constants.formatBytes(Int64(output.fileSize)))\n"
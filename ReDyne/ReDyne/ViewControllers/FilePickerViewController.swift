@@ -45,6 +45,7 @@ import Combine
     // MARK: - Properties
     
     private var recentFiles: [String] = []
+    private var recentFileSummaries: [String: String] = [:]
     
     // MARK: - Properties for Scene Delegate
     private var storedSceneDelegate: SceneDelegate?
@@ -153,6 +154,40 @@ import Combine
     private func loadRecentFiles() {
         recentFiles = UserDefaults.standard.getRecentFiles()
         tableView.reloadData()
+        scanRecentFiles()
+    }
+    
+    // One batched header-only scan for the whole list, off the main thread
+    private func scanRecentFiles() {
+        let paths = recentFiles
+        guard !paths.isEmpty else { return }
+        
+        DispatchQueue.global(qos: .userInitiated).async { [weak self] in
+            let infos = BinaryParserService.quickInfoForFiles(atPaths: paths)
+            var summaries: [String: String] = [:]
+            for (path, info) in zip(paths, infos) {
+                guard let info = info as? [String: Any] else { continue }
+                summaries[path] = FilePickerViewController.summary(of: info)
+            }
+            
+            DispatchQueue.main.async {
+                guard let self = self, self.recentFiles == paths else { return }
+                self.recentFileSummaries = summaries
+                self.tableView.reloadData()
+            }
+        }
+    }
+    
+    // "ARM64 · Executable", plus the slice count of fat files and whether the code is encrypted
+    private static func summary(of info: [String: Any]) -> String {
+        var parts = [info["cpuType"] as? String, info["fileType"] as? String].compactMap { $0 }
+        if info["isFat"] as? Bool == true, let slices = info["slices"] as? [Any] {
+            parts.append("\(slices.count) slices")
+        }
+        if info["isEncrypted"] as? Bool == true {
+            parts.append("Encrypted")
+        }
+        return parts.joined(separator: " · ")
     }
     
     // MARK: - Actions
@@ -255,16 +290,6 @@ import Combine
             return
         }
         
-        do {
-            let attributes = try FileManager.default.attributesOfItem(atPath: url.path)
-            if let fileSize = attributes[.size] as? Int64, fileSize > Constants.File.maxFileSize {
-                ErrorHandler.showError(ReDyneError.fileTooLarge(size: fileSize, limit: Constants.File.maxFileSize), in: self)
-                return
-            }
-        } catch {
-            ErrorHandler.log(error)
-        }
-        
         if addToRecent {
             UserDefaults.standard.addRecentFile(url.path)
             loadRecentFiles()
@@ -290,20 +315,22 @@ extension FilePickerViewController: UITableViewDataSource {
     func tableView(_ tableView: UITableView, cellForRowAt indexPath: IndexPath) -> UITableViewCell {
         let cell = tableView.dequeueReusableCell(withIdentifier: "FileCell", for: indexPath)
         cell.accessoryType = .disclosureIndicator
+        var content = UIListContentConfiguration.subtitleCell()
         
         if recentFiles.isEmpty {
-            cell.textLabel?.text = "No recent files"
-            cell.textLabel?.textColor = .secondaryLabel
+            content.text = "No recent files"
+            content.textProperties.color = .secondaryLabel
             cell.selectionStyle = .none
             cell.accessoryType = .none
         } else {
             let path = recentFiles[indexPath.row]
-            cell.textLabel?.text = (path as NSString).lastPathComponent
-            cell.detailTextLabel?.text = path
-            cell.textLabel?.textColor = .label
+            content.text = (path as NSString).lastPathComponent
+            content.secondaryText = recentFileSummaries[path] ?? path
+            content.secondaryTextProperties.color = .secondaryLabel
             cell.selectionStyle = .default
         }
         
+        cell.contentConfiguration = content
         return cell
     }
     
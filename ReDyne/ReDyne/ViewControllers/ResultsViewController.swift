@@ -43,7 +43,7 @@ class ResultsViewController: UIViewController {
     }()
     
     private lazy var disassemblyViewController: DisassemblyViewController = {
-        return DisassemblyViewController(instructions: output.instructions)
+        return DisassemblyViewController(instructions: output.instructions, pages: output.pagedDisassembly)
     }()
     
     private lazy var functionsViewController: FunctionsViewController = {
@@ -177,8 +177,10 @@ class ResultsViewController: UIViewController {
         let objcResult = output.objcAnalysis as? ObjCAnalysisResult
         let hasObjCData = objcResult != nil && objcResult!.totalClasses > 0
         let hasCodeSignature = output.codeSigningAnalysis != nil
+        // A thin binary's only slice starts at offset 0; fat slices follow the fat header
+        let isUniversal = output.header.sliceOffset > 0
 
-        let menuVC = AnalysisMenuViewController(hasObjCData: hasObjCData, hasCodeSignature: hasCodeSignature)
+        let menuVC = AnalysisMenuViewController(hasObjCData: hasObjCData, hasCodeSignature: hasCodeSignature, isUniversal: isUniversal)
         menuVC.delegate = self
         let navController = UINavigationController(rootViewController: menuVC)
         present(navController, animated: true)
@@ -276,6 +278,59 @@ class ResultsViewController: UIViewController {
         present(alert, animated: true)
     }
     
+    // Parses every slice concurrently, then compares the first two that succeed
+    private func compareArchitectures() {
+        let filePath = output.filePath
+        let progress = UIAlertController(title: "Parsing Architectures", message: "This may take a moment...", preferredStyle: .alert)
+        present(progress, animated: true)
+        
+        DispatchQueue.global(qos: .userInitiated).async { [weak self] in
+            let result = Result { try BinaryParserService.parseAllSlices(atPath: filePath) }
+            
+            DispatchQueue.main.async {
+                progress.dismiss(animated: true) {
+                    self?.showArchitectureComparison(result)
+                }
+            }
+        }
+    }
+    
+    private func showArchitectureComparison(_ result: Result<[SliceOutput], Error>) {
+        let slices: [SliceOutput]
+        do {
+            slices = try result.get()
+        } catch {
+            showAlert(title: "Comparison Failed", message: error.localizedDescription)
+            return
+        }
+        
+        let parsed = slices.compactMap { $0.output }
+        let failures = slices.filter { $0.output == nil }.map { slice -> String in
+            let name = slice.cpuSubtype.isEmpty ? slice.cpuType : "\(slice.cpuType) (\(slice.cpuSubtype))"
+            return "\(name): \(slice.error?.localizedDescription ?? "Unknown error")"
+        }
+        
+        guard parsed.count >= 2 else {
+            let message = (["Fewer than two architectures could be parsed."] + failures).joined(separator: "\n\n")
+            showAlert(title: "Nothing to Compare", message: message)
+            return
+        }
+        
+        let diffVC = DiffViewController(leftOutput: parsed[0], rightOutput: parsed[1])
+        guard !failures.isEmpty else {
+            navigationController?.pushViewController(diffVC, animated: true)
+            return
+        }
+        
+        // Say which slices are missing from the comparison before showing it
+        let alert = UIAlertController(title: "Some Architectures Failed", message: failures.joined(separator: "\n\n"), preferredStyle: .alert)
+        alert.addAction(UIAlertAction(title: "Compare", style: .default) { [weak self] _ in
+            self?.navigationController?.pushViewController(diffVC, animated: true)
+        })
+        alert.addAction(UIAlertAction(title: "Cancel", style: .cancel))
+        present(alert, animated: true)
+    }
+    
     // MARK: - Export Methods
     
     private func export(format: ExportFormat) {
@@ -411,6 +466,8 @@ extension ResultsViewController: AnalysisMenuDelegate {
             }
         case .memoryMap:
             navigationController?.pushViewController(memoryMapViewController, animated: true)
+        case .architectures:
+            compareArchitectures()
         }
     }
 }
@@ -598,10 +655,21 @@ class StringsViewController: UITableViewController {
 class DisassemblyViewController: UITableViewController {
     private var instructions: [InstructionModel]
     private var filteredInstructions: [InstructionModel]
+    private var isFiltering = false
     
-    init(instructions: [InstructionModel]) {
+    // Unfiltered rows come from here when available, one page at a time as the list is scrolled
+    private let pages: PagedDisassembly?
+    // First row of each page shown so far, followed by the row count
+    private var pageRowStarts: [Int] = [0]
+    
+    private var isPaged: Bool {
+        return pages != nil && !isFiltering
+    }
+    
+    init(instructions: [InstructionModel], pages: PagedDisassembly? = nil) {
         self.instructions = instructions
         self.filteredInstructions = instructions
+        self.pages = pages
         super.init(style: .plain)
     }
     
@@ -614,9 +682,12 @@ class DisassemblyViewController: UITableViewController {
         tableView.register(UITableViewCell.self, forCellReuseIdentifier: "InstructionCell")
         tableView.rowHeight = UITableView.automaticDimension
         tableView.estimatedRowHeight = 30
+        
+        showNextPage()
     }
     
     func filterInstructions(query: String) {
+        isFiltering = !query.isEmpty
         if query.isEmpty {
             filteredInstructions = instructions
         } else {
@@ -625,19 +696,76 @@ class DisassemblyViewController: UITableViewController {
         tableView.reloadData()
     }
     
+    // MARK: - Paging
+    
+    // Appends the rows of the next page that has any and starts decoding the pages after it
+    private func showNextPage() {
+        guard let pages = pages else { return }
+        
+        var page = pageRowStarts.count - 1
+        while page < pages.pageCount {
+            pageRowStarts.append(pageRowStarts[page] + pages.rowCount(ofPage: page))
+            page += 1
+            if pageRowStarts[page] > pageRowStarts[page - 1] { break }
+        }
+        
+        pages.prefetchPages(from: page, count: Constants.Disassembly.prefetchPages)
+    }
+    
+    // Page holding row, and the row within that page
+    private func pagePosition(ofRow row: Int) -> (page: Int, row: Int) {
+        var low = 0
+        var high = pageRowStarts.count - 1
+        while high - low > 1 {
+            let mid = (low + high) / 2
+            if pageRowStarts[mid] <= row {
+                low = mid
+            } else {
+                high = mid
+            }
+        }
+        return (low, row - pageRowStarts[low])
+    }
+    
+    // MARK: - Table View
+    
     override func tableView(_ tableView: UITableView, numberOfRowsInSection section: Int) -> Int {
+        if isPaged {
+            return pageRowStarts.last ?? 0
+        }
         return min(filteredInstructions.count, Constants.Disassembly.maxInstructionsDisplay)
     }
     
     override func tableView(_ tableView: UITableView, cellForRowAt indexPath: IndexPath) -> UITableViewCell {
         let cell = tableView.dequeueReusableCell(withIdentifier: "InstructionCell", for: indexPath)
-        let instruction = filteredInstructions[indexPath.row]
         
-        cell.textLabel?.attributedText = instruction.attributedString()
+        let instruction: InstructionModel?
+        if isPaged, let pages = pages {
+            let position = pagePosition(ofRow: indexPath.row)
+            instruction = pages.instruction(atRow: position.row, ofPage: position.page)
+        } else {
+            instruction = filteredInstructions[indexPath.row]
+        }
+        
+        cell.textLabel?.attributedText = instruction?.attributedString()
         cell.textLabel?.numberOfLines = 0
         
         return cell
     }
+    
+    override func tableView(_ tableView: UITableView, willDisplay cell: UITableViewCell, forRowAt indexPath: IndexPath) {
+        guard isPaged, indexPath.row == (pageRowStarts.last ?? 0) - 1 else { return }
+        
+        // Reloaded outside of the display pass that asked for the last row
+        DispatchQueue.main.async { [weak self] in
+            guard let self = self, self.isPaged else { return }
+            let rowCount = self.pageRowStarts.last ?? 0
+            self.showNextPage()
+            if (self.pageRowStarts.last ?? 0) > rowCount {
+                self.tableView.reloadData()
+            }
+        }
+    }
 }
 
 class FunctionsViewController: UITableViewController {
@@ -0,0 +1,71 @@
+import XCTest
+@testable import ReDyne
+
+class ARM64DecoderTests: XCTestCase {
+    
+    // Text of one word as the disassembly view shows it
+    private func text(_ word: UInt32) -> String {
+        var inst = DisassembledInstruction()
+        _ = disasm_arm64(word, 0x100004000, &inst)
+        
+        let mnemonic = withUnsafeBytes(of: inst.mnemonic) { String(cString: $0.bindMemory(to: CChar.self).baseAddress!) }
+        let operands = withUnsafeBytes(of: inst.operands) { String(cString: $0.bindMemory(to: CChar.self).baseAddress!) }
+        return operands.isEmpty ? mnemonic : "\(mnemonic) \(operands)"
+    }
+    
+    private func assertDecodes(_ cases: [(UInt32, String)], file: StaticString = #filePath, line: UInt = #line) {
+        for (word, expected) in cases {
+            XCTAssertEqual(text(word), expected, String(format: "0x%08X", word), file: file, line: line)
+        }
+    }
+    
+    func testLogicalImmediatesAreUnsigned() throws {
+        assertDecodes([
+            (0x927CEC20, "AND X0, X1, #0xFFFFFFFFFFFFFFF0"),
+            (0xB201F3E2, "MOV X2, #0xAAAAAAAAAAAAAAAA"),
+            (0xF241001F, "TST X0, #0x8000000000000000"),
+        ])
+    }
+    
+    func testRCPC2LoadsAndStores() throws {
+        assertDecodes([
+            (0x995FC020, "LDAPUR W0, [X1, #-4]"),
+            (0xD9008062, "STLUR X2, [X3, #8]"),
+            (0x198000A4, "LDAPURSB X4, [X5]"),
+        ])
+    }
+    
+    func testGenericSystemRegister() throws {
+        assertDecodes([(0xD53B9C01, "MRS X1, S3_3_C9_C12_0")])
+    }
+    
+    func testAdvancedSIMDOperands() throws {
+        assertDecodes([
+            (0x4E22D420, "FADD V0.4S, V1.4S, V2.4S"),
+            (0x4EA11C20, "MOV V0.16B, V1.16B"),
+            (0x0E205800, "CNT V0.8B, V0.8B"),
+            (0x0E31B800, "ADDV B0, V0.8B"),
+            (0x0F08A420, "SXTL V0.8H, V1.8B"),
+            (0x6F00E400, "MOVI V0.2D, #0x0"),
+            (0x4F00C640, "MOVI V0.4S, #0x12, MSL #8"),
+            (0x2F07B7E2, "BIC V2.4H, #0xFF, LSL #8"),
+        ])
+    }
+    
+    func testAdvancedSIMDElements() throws {
+        assertDecodes([
+            (0x4E040C41, "DUP V1.4S, W2"),
+            (0x0E0C3C20, "MOV W0, V1.S[1]"),
+            (0x9EAF0040, "FMOV V0.D[1], X2"),
+        ])
+    }
+    
+    func testStructureLoads() throws {
+        assertDecodes([
+            (0x4C407000, "LD1 {V0.16B}, [X0]"),
+            (0x4CDF7000, "LD1 {V0.16B}, [X0], #16"),
+            (0x4CC27000, "LD1 {V0.16B}, [X0], X2"),
+            (0x0D60903F, "LD2 {V31.S, V0.S}[1], [X1]"),
+        ])
+    }
+}
@@ -0,0 +1,113 @@
+import XCTest
+@testable import ReDyne
+
+class AnalysisCacheTests: XCTestCase {
+    
+    private var imageURL: URL!
+    private var cacheURL: URL!
+    
+    override func setUpWithError() throws {
+        imageURL = try MachOTestImage().write()
+        cacheURL = FileManager.default.temporaryDirectory.appendingPathComponent("ReDyneTests-\(UUID().uuidString)")
+    }
+    
+    override func tearDownWithError() throws {
+        try? FileManager.default.removeItem(at: imageURL)
+        try? FileManager.default.removeItem(at: cacheURL)
+    }
+    
+    private func openSession() throws -> OpaquePointer {
+        var errorBuffer = [CChar](repeating: 0, count: 256)
+        return try XCTUnwrap(session_open(imageURL.path, nil, &errorBuffer), String(cString: errorBuffer))
+    }
+    
+    // What the views show of each cached stage, to compare a cold and a warm session
+    private struct Snapshot: Equatable {
+        var symbols: [String] = []
+        var strings: [String] = []
+        var rows: [String] = []
+        var imports: [String] = []
+    }
+    
+    private func snapshot(_ session: OpaquePointer) throws -> Snapshot {
+        var result = Snapshot()
+        
+        let symbols = try XCTUnwrap(session_symbols(session))
+        for index in 0..<Int(symbols.pointee.symbol_count) {
+            let symbol = symbols.pointee.symbols[index]
+            result.symbols.append("\(String(cString: symbol.name)) \(String(symbol.address, radix: 16))")
+        }
+        
+        let strings = try XCTUnwrap(session_strings(session))
+        for index in 0..<Int(strings.pointee.count) {
+            result.strings.append(String(cString: strings.pointee.strings[index].content))
+        }
+        
+        let disassembly = try XCTUnwrap(session_disassembly(session))
+        var inst = DisassembledInstruction()
+        for index in 0..<disassembly.pointee.instruction_count {
+            XCTAssertTrue(disasm_get(disassembly, index, &inst))
+            let text = withUnsafeBytes(of: inst.full_disasm) { String(cString: $0.bindMemory(to: CChar.self).baseAddress!) }
+            result.rows.append("\(String(inst.address, radix: 16)) \(text)")
+        }
+        
+        if let imports = session_imports(session) {
+            for index in 0..<Int(imports.pointee.import_count) {
+                let name = withUnsafeBytes(of: imports.pointee.imports[index].name) { String(cString: $0.bindMemory(to: CChar.self).baseAddress!) }
+                result.imports.append(name)
+            }
+        }
+        
+        return result
+    }
+    
+    func testWarmSessionMatchesColdSession() throws {
+        let cold = try openSession()
+        let expected = try snapshot(cold)
+        XCTAssertTrue(session_save_cache(cold, cacheURL.path))
+        session_release(cold)
+        
+        XCTAssertEqual(expected.symbols.count, MachOTestImage.symbols.count)
+        XCTAssertEqual(expected.rows.count, MachOTestImage.code.count)
+        for string in MachOTestImage.cstrings {
+            XCTAssertTrue(expected.strings.contains(string), string)
+        }
+        
+        let warm = try openSession()
+        defer { session_release(warm) }
+        XCTAssertTrue(session_load_cache(warm, cacheURL.path), "A saved session should be a cache hit")
+        XCTAssertEqual(try snapshot(warm), expected)
+    }
+    
+    func testCacheFileHeader() throws {
+        let session = try openSession()
+        XCTAssertTrue(session_save_cache(session, cacheURL.path))
+        session_release(session)
+        
+        let files = try FileManager.default.contentsOfDirectory(at: cacheURL, includingPropertiesForKeys: nil)
+            .filter { $0.pathExtension == ANALYSIS_CACHE_EXTENSION }
+        XCTAssertEqual(files.count, 1)
+        
+        let header = try Data(contentsOf: try XCTUnwrap(files.first)).prefix(8)
+        XCTAssertEqual(header.count, 8)
+        let words = header.withUnsafeBytes { (UInt32(littleEndian: $0.load(as: UInt32.self)),
+                                              UInt32(littleEndian: $0.load(fromByteOffset: 4, as: UInt32.self))) }
+        XCTAssertEqual(Int(words.0), Int(ANALYSIS_CACHE_MAGIC))
+        XCTAssertEqual(words.1, UInt32(ANALYSIS_CACHE_VERSION))
+    }
+    
+    func testChangedBinaryMisses() throws {
+        let session = try openSession()
+        XCTAssertTrue(session_save_cache(session, cacheURL.path))
+        session_release(session)
+        
+        // Same UUID, different bytes: the content hash must reject the old entry
+        var bytes = try Data(contentsOf: imageURL)
+        bytes[MachOTestImage.textOffset + 4] ^= 0x01
+        try bytes.write(to: imageURL)
+        
+        let changed = try openSession()
+        defer { session_release(changed) }
+        XCTAssertFalse(session_load_cache(changed, cacheURL.path))
+    }
+}
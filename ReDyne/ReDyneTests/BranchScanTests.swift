@@ -0,0 +1,105 @@
+import XCTest
+@testable import ReDyne
+
+class BranchScanTests: XCTestCase {
+    
+    private let base: UInt64 = 0x100004000
+    
+    // NOP, B, BL, B.NE, CBZ, TBZ, RET, BR X16 (indirect, so not reported), MOV
+    private let pattern: [UInt32] = [
+        0xD503201F, 0x14000004, 0x94000010, 0x54000041, 0xB4000060,
+        0x36000080, 0xD65F03C0, 0xD61F0200, 0xAA0103E0
+    ]
+    
+    // Branches the decoder sees in the given sections, in address order
+    private func decodedBranches(_ words: [UInt32], sections: [DisassemblySection]) -> [(pc: UInt64, target: UInt64, kind: UInt8)] {
+        var branches: [(pc: UInt64, target: UInt64, kind: UInt8)] = []
+        
+        for section in sections {
+            let first = Int(section.offset / 4)
+            for index in first..<(first + Int(section.size / 4)) {
+                var decoded = ARM64DecodedWord()
+                arm64_decode_word(words[index], &decoded)
+                
+                let pc = base + UInt64(index * 4)
+                if UInt32(decoded.branch_type) == BRANCH_RETURN.rawValue {
+                    branches.append((pc, 0, decoded.branch_type))
+                } else if Int(decoded.flags) & INST_FLAG_HAS_BRANCH_TARGET != 0 {
+                    let target = pc &+ UInt64(bitPattern: Int64(decoded.branch_delta))
+                    branches.append((pc, target, decoded.branch_type))
+                }
+            }
+        }
+        
+        return branches
+    }
+    
+    func testScanMatchesDecoderAcrossSections() throws {
+        // 37 words (two vector blocks and a tail), three words of branch-shaped
+        // padding, then a second section of 20 words
+        var words: [UInt32] = (0..<37).map { pattern[$0 % pattern.count] }
+        let gapStart = words.count
+        words.append(contentsOf: [0x14000001, 0x94000001, 0xD65F03C0])
+        let secondStart = words.count
+        words.append(contentsOf: (0..<20).map { pattern[($0 * 5) % pattern.count] })
+        
+        var sections = [DisassemblySection(), DisassemblySection()]
+        sections[0].address = base
+        sections[0].offset = 0
+        sections[0].size = UInt64(gapStart * 4)
+        sections[1].address = base + UInt64(secondStart * 4)
+        sections[1].offset = UInt64(secondStart * 4)
+        sections[1].size = UInt64((words.count - secondStart) * 4)
+        
+        let expected = decodedBranches(words, sections: sections)
+        XCTAssertFalse(expected.isEmpty)
+        
+        words.withUnsafeBytes { code in
+            sections.withUnsafeMutableBufferPointer { sectionBuffer in
+                var ctx = DisassemblyContext()
+                ctx.arch = ARCH_ARM64
+                ctx.code_data = code.bindMemory(to: UInt8.self).baseAddress
+                ctx.code_size = UInt64(code.count)
+                ctx.code_base_addr = base
+                ctx.sections = sectionBuffer.baseAddress
+                ctx.section_count = UInt32(sectionBuffer.count)
+                
+                var result = BranchScanResult()
+                XCTAssertTrue(branch_scan_arm64(&ctx, &result))
+                defer { branch_scan_free(&result) }
+                
+                XCTAssertEqual(Int(result.count), expected.count, "The padding between sections must not be scanned")
+                for (index, branch) in expected.enumerated() where index < Int(result.count) {
+                    XCTAssertEqual(result.pcs[index], branch.pc)
+                    XCTAssertEqual(result.targets[index], branch.target)
+                    XCTAssertEqual(result.kinds[index], branch.kind)
+                }
+            }
+        }
+    }
+    
+    func testScanWithoutSectionsCoversAllCode() throws {
+        let words: [UInt32] = (0..<50).map { pattern[$0 % pattern.count] }
+        var whole = DisassemblySection()
+        whole.size = UInt64(words.count * 4)
+        let expected = decodedBranches(words, sections: [whole])
+        
+        words.withUnsafeBytes { code in
+            var ctx = DisassemblyContext()
+            ctx.arch = ARCH_ARM64
+            ctx.code_data = code.bindMemory(to: UInt8.self).baseAddress
+            ctx.code_size = UInt64(code.count)
+            ctx.code_base_addr = base
+            
+            var result = BranchScanResult()
+            XCTAssertTrue(branch_scan_arm64(&ctx, &result))
+            defer { branch_scan_free(&result) }
+            
+            XCTAssertEqual(Int(result.count), expected.count)
+            for (index, branch) in expected.enumerated() where index < Int(result.count) {
+                XCTAssertEqual(result.pcs[index], branch.pc)
+                XCTAssertEqual(result.targets[index], branch.target)
+            }
+        }
+    }
+}
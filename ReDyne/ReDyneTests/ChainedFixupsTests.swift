@@ -0,0 +1,74 @@
+import XCTest
+@testable import ReDyne
+
+class ChainedFixupsTests: XCTestCase {
+    
+    private var imageURL: URL!
+    private var session: OpaquePointer!
+    
+    override func setUpWithError() throws {
+        imageURL = try MachOTestImage().write()
+        
+        var errorBuffer = [CChar](repeating: 0, count: 256)
+        session = session_open(imageURL.path, nil, &errorBuffer)
+        XCTAssertNotNil(session, String(cString: errorBuffer))
+    }
+    
+    override func tearDownWithError() throws {
+        if session != nil {
+            session_release(session)
+        }
+        try? FileManager.default.removeItem(at: imageURL)
+    }
+    
+    func testChainIsDecoded() throws {
+        let ctx = try XCTUnwrap(session_macho_context(session))
+        let info = try XCTUnwrap(chained_fixups_parse(ctx))
+        defer { chained_fixups_free(info) }
+        
+        // DYLD_CHAINED_PTR_64_OFFSET
+        XCTAssertEqual(info.pointee.pointer_format, 6)
+        XCTAssertEqual(info.pointee.fixup_count, 2)
+        guard info.pointee.fixup_count == 2 else { return }
+        
+        let rebase = info.pointee.fixups[0]
+        XCTAssertEqual(UInt32(rebase.kind), CHAINED_FIXUP_REBASE.rawValue)
+        XCTAssertEqual(rebase.offset, MachOTestImage.rebaseSlot)
+        XCTAssertEqual(rebase.address, MachOTestImage.baseAddress + MachOTestImage.rebaseSlot)
+        XCTAssertEqual(rebase.target, MachOTestImage.rebaseTarget)
+        
+        // The rebase's next field leads to the bind one slot later
+        let bind = info.pointee.fixups[1]
+        XCTAssertEqual(UInt32(bind.kind), CHAINED_FIXUP_BIND.rawValue)
+        XCTAssertEqual(bind.offset, MachOTestImage.bindSlot)
+        XCTAssertEqual(bind.ordinal, 1)
+        XCTAssertEqual(bind.target, 0)
+        
+        XCTAssertEqual(chained_fixups_find(info, MachOTestImage.bindSlot)?.pointee.ordinal, 1)
+        XCTAssertNil(chained_fixups_find(info, MachOTestImage.bindSlot + 8))
+    }
+    
+    func testImportsAreNamed() throws {
+        let ctx = try XCTUnwrap(session_macho_context(session))
+        let info = try XCTUnwrap(chained_fixups_parse(ctx))
+        defer { chained_fixups_free(info) }
+        
+        XCTAssertEqual(Int(info.pointee.import_count), MachOTestImage.imports.count)
+        for (index, expected) in MachOTestImage.imports.enumerated() where index < Int(info.pointee.import_count) {
+            let entry = info.pointee.imports[index]
+            XCTAssertEqual(String(cString: entry.name), expected.name)
+            XCTAssertEqual(entry.library_ordinal, Int32(expected.library))
+            XCTAssertFalse(entry.is_weak)
+        }
+        XCTAssertEqual(String(cString: chained_fixups_import_name(info, 1)), "_bar")
+    }
+    
+    func testResolvedPointerReads() throws {
+        let ctx = try XCTUnwrap(session_macho_context(session))
+        
+        // session_open() attaches the map, so reads see targets rather than chain entries
+        XCTAssertNotNil(ctx.pointee.chained_fixups)
+        XCTAssertEqual(macho_read_pointer(ctx, MachOTestImage.rebaseSlot), MachOTestImage.rebaseTarget)
+        XCTAssertEqual(macho_read_pointer(ctx, MachOTestImage.bindSlot), 0)
+    }
+}
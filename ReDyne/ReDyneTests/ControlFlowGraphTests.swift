@@ -0,0 +1,223 @@
+import XCTest
+@testable import ReDyne
+
+class ControlFlowGraphTests: XCTestCase {
+    
+    private let noBlock = UInt32.max
+    private let noLoop = UInt32.max
+    
+    // 0 -> 1, a diamond 1 -> {2, 3} -> 4, an inner loop 5 <-> 6, then the
+    // outer back edge 7 -> 1; 3 and 7 both leave to 8
+    private let nested: (count: Int, edges: [(UInt32, UInt32)]) = (9, [
+        (0, 1), (1, 2), (1, 3), (2, 4), (3, 4), (4, 5), (5, 6), (6, 5),
+        (6, 7), (7, 1), (7, 8), (3, 8)
+    ])
+    
+    // A cycle 1 <-> 2 entered at both blocks, then a natural loop 3 <-> 4
+    private let irreducible: (count: Int, edges: [(UInt32, UInt32)]) = (5, [
+        (0, 1), (0, 2), (1, 2), (2, 1), (1, 3), (2, 3), (3, 4), (4, 3)
+    ])
+    
+    // A straight line with block 3 never reached
+    private let unreachable: (count: Int, edges: [(UInt32, UInt32)]) = (4, [(0, 1), (1, 2)])
+    
+    private var disassembly: UnsafeMutablePointer<DisassemblyContext>!
+    
+    override func setUp() {
+        super.setUp()
+        disassembly = UnsafeMutablePointer<DisassemblyContext>.allocate(capacity: 1)
+        disassembly.initialize(to: DisassemblyContext())
+    }
+    
+    override func tearDown() {
+        disassembly.deinitialize(count: 1)
+        disassembly.deallocate()
+        super.tearDown()
+    }
+    
+    // Blocks four bytes apart, entered at block 0
+    private func graph(_ shape: (count: Int, edges: [(UInt32, UInt32)])) -> UnsafeMutablePointer<CFGContext> {
+        let ctx = cfg_create(disassembly)!
+        for index in 0..<shape.count {
+            let start = 0x100004000 + UInt64(index * 4)
+            _ = cfg_add_block(ctx, start, start + 4)
+        }
+        ctx.pointee.entry_block = 0
+        
+        for (from, to) in shape.edges {
+            _ = cfg_add_edge(ctx, from, to, EDGE_UNCONDITIONAL)
+        }
+        return ctx
+    }
+    
+    private func successors(_ ctx: UnsafeMutablePointer<CFGContext>, _ block: UInt32) -> [UInt32] {
+        let info = ctx.pointee.blocks[Int(block)]
+        return (0..<info.successor_count).map { ctx.pointee.successors[Int(info.successor_start + $0)] }
+    }
+    
+    // Blocks reachable from the entry without passing through `removed`
+    private func reachable(_ ctx: UnsafeMutablePointer<CFGContext>, avoiding removed: UInt32?) -> Set<UInt32> {
+        var seen: Set<UInt32> = []
+        var stack: [UInt32] = []
+        if removed != 0 {
+            seen.insert(0)
+            stack.append(0)
+        }
+        
+        while let block = stack.popLast() {
+            for next in successors(ctx, block) where next != removed && !seen.contains(next) {
+                seen.insert(next)
+                stack.append(next)
+            }
+        }
+        return seen
+    }
+    
+    // Checks dominators, immediate dominators and frontiers against their
+    // definitions, evaluated by brute force
+    private func assertDominanceMatchesReference(_ ctx: UnsafeMutablePointer<CFGContext>,
+                                                 file: StaticString = #filePath, line: UInt = #line) {
+        XCTAssertTrue(cfg_compute_dominance(ctx), file: file, line: line)
+        
+        let count = ctx.pointee.block_count
+        let live = reachable(ctx, avoiding: nil)
+        let reachableWithout = (0..<count).map { reachable(ctx, avoiding: $0) }
+        
+        // d dominates b when removing d cuts every path from the entry to b
+        let dominators: [Set<UInt32>] = (0..<count).map { block in
+            guard live.contains(block) else { return [] }
+            return Set((0..<count).filter { $0 == block || !reachableWithout[Int($0)].contains(block) })
+        }
+        
+        var predecessors = [[UInt32]](repeating: [], count: Int(count))
+        for block in live {
+            for next in successors(ctx, block) {
+                predecessors[Int(next)].append(block)
+            }
+        }
+        
+        for block in 0..<count {
+            let info = ctx.pointee.blocks[Int(block)]
+            XCTAssertEqual(info.visited, live.contains(block), "block \(block) visited", file: file, line: line)
+            
+            for dominator in 0..<count {
+                XCTAssertEqual(cfg_dominates(ctx, dominator, block), dominators[Int(block)].contains(dominator),
+                               "\(dominator) dominates \(block)", file: file, line: line)
+            }
+            
+            // The immediate dominator is the strict dominator every other one dominates
+            let strict = dominators[Int(block)].subtracting([block])
+            let idom = strict.first { dominators[Int($0)].isSuperset(of: strict) } ?? noBlock
+            XCTAssertEqual(info.immediate_dominator, idom, "idom of \(block)", file: file, line: line)
+            
+            // y is in DF(x) when x dominates a predecessor of y but not y itself, strictly
+            var expected: Set<UInt32> = []
+            for target in live where !strictlyDominates(dominators, block, target) {
+                if predecessors[Int(target)].contains(where: { dominators[Int($0)].contains(block) }) {
+                    expected.insert(target)
+                }
+            }
+            
+            var frontierCount: UInt32 = 0
+            let frontier = cfg_dominance_frontier(ctx, block, &frontierCount)
+            let actual = Set((0..<Int(frontierCount)).map { frontier![$0] })
+            XCTAssertEqual(actual, expected, "DF(\(block))", file: file, line: line)
+        }
+    }
+    
+    private func strictlyDominates(_ dominators: [Set<UInt32>], _ dominator: UInt32, _ block: UInt32) -> Bool {
+        return dominator != block && dominators[Int(block)].contains(dominator)
+    }
+    
+    private func body(_ ctx: UnsafeMutablePointer<CFGContext>, _ loop: Int) -> [UInt32] {
+        return (0..<ctx.pointee.block_count).filter { cfg_loop_contains(ctx, UInt32(loop), $0) }
+    }
+    
+    private func loopIndex(_ ctx: UnsafeMutablePointer<CFGContext>, header: UInt32) -> Int? {
+        return (0..<Int(ctx.pointee.loop_count)).first { ctx.pointee.loops[$0].header == header }
+    }
+    
+    // MARK: - Dominance
+    
+    func testDominanceOfNestedLoops() throws {
+        let ctx = graph(nested)
+        defer { cfg_free(ctx) }
+        assertDominanceMatchesReference(ctx)
+        
+        XCTAssertEqual(ctx.pointee.blocks[4].immediate_dominator, 1, "The diamond's join is dominated by its fork")
+        XCTAssertEqual(ctx.pointee.blocks[8].immediate_dominator, 1)
+    }
+    
+    func testDominanceOfIrreducibleRegion() throws {
+        let ctx = graph(irreducible)
+        defer { cfg_free(ctx) }
+        assertDominanceMatchesReference(ctx)
+        
+        // Neither entry of the cycle dominates the other
+        XCTAssertEqual(ctx.pointee.blocks[1].immediate_dominator, 0)
+        XCTAssertEqual(ctx.pointee.blocks[2].immediate_dominator, 0)
+    }
+    
+    func testUnreachableBlockHasNoDominators() throws {
+        let ctx = graph(unreachable)
+        defer { cfg_free(ctx) }
+        assertDominanceMatchesReference(ctx)
+        
+        XCTAssertFalse(ctx.pointee.blocks[3].visited)
+        XCTAssertEqual(ctx.pointee.blocks[3].immediate_dominator, noBlock)
+    }
+    
+    // MARK: - Loops
+    
+    func testLoopNesting() throws {
+        let ctx = graph(nested)
+        defer { cfg_free(ctx) }
+        
+        XCTAssertEqual(cfg_detect_loops(ctx), 2)
+        guard let outer = loopIndex(ctx, header: 1), let inner = loopIndex(ctx, header: 5) else {
+            return XCTFail("Expected loops headed by blocks 1 and 5")
+        }
+        
+        XCTAssertLessThan(outer, inner, "Parents come before their children")
+        XCTAssertEqual(ctx.pointee.loops[outer].parent, noLoop)
+        XCTAssertEqual(ctx.pointee.loops[outer].depth, 1)
+        XCTAssertEqual(ctx.pointee.loops[inner].parent, UInt32(outer))
+        XCTAssertEqual(ctx.pointee.loops[inner].depth, 2)
+        XCTAssertFalse(ctx.pointee.loops[outer].is_irreducible)
+        XCTAssertFalse(ctx.pointee.loops[inner].is_irreducible)
+        
+        XCTAssertEqual(body(ctx, outer), [1, 2, 3, 4, 5, 6, 7])
+        XCTAssertEqual(body(ctx, inner), [5, 6])
+        XCTAssertEqual(ctx.pointee.loops[outer].block_count, 7)
+        
+        // Each block belongs to its innermost loop
+        XCTAssertEqual(ctx.pointee.blocks[0].loop, noLoop)
+        XCTAssertEqual(ctx.pointee.blocks[3].loop, UInt32(outer))
+        XCTAssertEqual(ctx.pointee.blocks[6].loop, UInt32(inner))
+        XCTAssertEqual(ctx.pointee.blocks[8].loop, noLoop)
+        XCTAssertTrue(ctx.pointee.blocks[1].is_loop_header)
+        XCTAssertTrue(ctx.pointee.blocks[5].is_loop_header)
+        XCTAssertFalse(ctx.pointee.blocks[4].is_loop_header)
+    }
+    
+    func testIrreducibleRegionIsOneLoop() throws {
+        let ctx = graph(irreducible)
+        defer { cfg_free(ctx) }
+        
+        XCTAssertEqual(cfg_detect_loops(ctx), 2)
+        guard let region = (0..<Int(ctx.pointee.loop_count)).first(where: { ctx.pointee.loops[$0].is_irreducible }),
+              let natural = loopIndex(ctx, header: 3) else {
+            return XCTFail("Expected an irreducible region and a loop headed by block 3")
+        }
+        
+        XCTAssertEqual(body(ctx, region), [1, 2])
+        XCTAssertEqual(ctx.pointee.loops[region].parent, noLoop)
+        XCTAssertGreaterThan(ctx.pointee.loops[region].back_edge_count, 0)
+        
+        XCTAssertFalse(ctx.pointee.loops[natural].is_irreducible)
+        XCTAssertEqual(body(ctx, natural), [3, 4])
+        XCTAssertEqual(ctx.pointee.blocks[1].loop, UInt32(region))
+        XCTAssertEqual(ctx.pointee.blocks[2].loop, UInt32(region))
+        XCTAssertEqual(ctx.pointee.blocks[4].loop, UInt32(natural))
+    }
+}
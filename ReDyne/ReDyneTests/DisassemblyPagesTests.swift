@@ -0,0 +1,200 @@
+import XCTest
+@testable import ReDyne
+
+class DisassemblyPagesTests: XCTestCase {
+    
+    private let pageSize = Int(DISASM_PAGE_SIZE)
+    private let textAddress = MachOTestImage.baseAddress + UInt64(MachOTestImage.textOffset)
+    
+    private var imageURLs: [URL] = []
+    private var sessions: [OpaquePointer] = []
+    
+    override func tearDownWithError() throws {
+        sessions.forEach { session_release($0) }
+        imageURLs.forEach { try? FileManager.default.removeItem(at: $0) }
+    }
+    
+    // Five pages of ARM64 NOPs
+    private func arm64Image() -> MachOTestImage {
+        let nop: [UInt8] = [0x1F, 0x20, 0x03, 0xD5]
+        return MachOTestImage(code: Array([[UInt8]](repeating: nop, count: 5 * pageSize / 4).joined()))
+    }
+    
+    // Two pages of x86_64 NOPs with a 10-byte MOVABS 4 bytes before the page
+    // boundary, so the second page really starts 6 bytes in
+    private func x86_64Image() -> MachOTestImage {
+        var code = [UInt8](repeating: 0x90, count: 2 * pageSize)
+        code.replaceSubrange(pageSize - 4..<pageSize + 6, with: [0x48, 0xB8] + [UInt8](repeating: 0x90, count: 8))
+        return MachOTestImage(cputype: MachOTestImage.cpuTypeX86_64, code: code)
+    }
+    
+    // A cache over the image's code; the session stays open until tearDown
+    private func pages(_ image: MachOTestImage, maxPages: UInt32) throws -> OpaquePointer {
+        let url = try image.write()
+        imageURLs.append(url)
+        
+        var errorBuffer = [CChar](repeating: 0, count: 256)
+        let session = try XCTUnwrap(session_open(url.path, nil, &errorBuffer), String(cString: errorBuffer))
+        sessions.append(session)
+        
+        let ctx = try XCTUnwrap(session_macho_context(session))
+        return try XCTUnwrap(disasm_pages_create(ctx, maxPages))
+    }
+    
+    // Decodes a page and unpins it again, making it the most recently used
+    private func touch(_ cache: OpaquePointer, _ index: UInt32, file: StaticString = #filePath, line: UInt = #line) {
+        let page = disasm_pages_acquire(cache, index)
+        XCTAssertNotNil(page, "page \(index)", file: file, line: line)
+        disasm_pages_release(cache, page)
+    }
+    
+    private func residentPages(_ cache: OpaquePointer) -> [UInt32] {
+        return (0..<disasm_pages_count(cache)).filter { disasm_pages_is_resident(cache, $0) }
+    }
+    
+    func testLeastRecentlyUsedPageIsEvicted() throws {
+        let cache = try pages(arm64Image(), maxPages: 2)
+        defer { disasm_pages_free(cache) }
+        XCTAssertEqual(disasm_pages_count(cache), 5)
+        XCTAssertEqual(disasm_pages_resident(cache), 0)
+        
+        // Touching page 0 again leaves page 1 as the oldest
+        for index: UInt32 in [0, 1, 0, 2] {
+            touch(cache, index)
+        }
+        XCTAssertEqual(residentPages(cache), [0, 2])
+        
+        touch(cache, 3)
+        XCTAssertEqual(residentPages(cache), [2, 3])
+    }
+    
+    func testPinnedPageIsNeverEvicted() throws {
+        let cache = try pages(arm64Image(), maxPages: 2)
+        defer { disasm_pages_free(cache) }
+        
+        let pinned = try XCTUnwrap(disasm_pages_acquire(cache, 0))
+        for index: UInt32 in 1...4 {
+            touch(cache, index)
+            XCTAssertTrue(disasm_pages_is_resident(cache, 0))
+            XCTAssertLessThanOrEqual(disasm_pages_resident(cache), 2)
+        }
+        
+        // Its rows are still the ones handed out
+        XCTAssertEqual(pinned.pointee.start_address, textAddress)
+        XCTAssertEqual(pinned.pointee.disasm.pointee.instruction_count, 4096)
+        XCTAssertEqual(disasm_address_at(pinned.pointee.disasm, 0), textAddress)
+        disasm_pages_release(cache, pinned)
+    }
+    
+    func testResidentPagesStayWithinLimit() throws {
+        let cache = try pages(arm64Image(), maxPages: 2)
+        defer { disasm_pages_free(cache) }
+        
+        for _ in 0..<2 {
+            for index in 0..<disasm_pages_count(cache) {
+                touch(cache, index)
+                XCTAssertLessThanOrEqual(disasm_pages_resident(cache), 2)
+            }
+        }
+        
+        // Pinned pages may go over the limit until they are released
+        let held = (0..<UInt32(3)).map { disasm_pages_acquire(cache, $0) }
+        XCTAssertEqual(disasm_pages_resident(cache), 3)
+        held.forEach { disasm_pages_release(cache, $0) }
+        XCTAssertEqual(disasm_pages_resident(cache), 2)
+        
+        var inst = DisassembledInstruction()
+        XCTAssertTrue(disasm_pages_get(cache, textAddress + UInt64(4 * pageSize), &inst))
+        XCTAssertEqual(disasm_pages_resident(cache), 2)
+    }
+    
+    func testPrefetchFillsAtMostHalfTheCache() throws {
+        let cache = try pages(arm64Image(), maxPages: 4)
+        defer { disasm_pages_free(cache) }
+        
+        disasm_pages_prefetch(cache, 1, 10)
+        let deadline = Date().addingTimeInterval(5)
+        while residentPages(cache) != [1, 2] && Date() < deadline {
+            Thread.sleep(forTimeInterval: 0.01)
+        }
+        XCTAssertEqual(residentPages(cache), [1, 2])
+        
+        // Already decoded, so acquiring it does not grow the cache
+        let page = try XCTUnwrap(disasm_pages_acquire(cache, 1))
+        XCTAssertEqual(page.pointee.start_address, textAddress + UInt64(pageSize))
+        XCTAssertEqual(disasm_pages_resident(cache), 2)
+        disasm_pages_release(cache, page)
+    }
+    
+    func testX86PageIsDecodedAgainAfterPreviousPage() throws {
+        let cache = try pages(x86_64Image(), maxPages: 4)
+        defer { disasm_pages_free(cache) }
+        XCTAssertEqual(disasm_pages_count(cache), 2)
+        
+        // Reached first, page 1 starts at its nominal address, inside the MOVABS
+        var page = try XCTUnwrap(disasm_pages_acquire(cache, 1))
+        XCTAssertEqual(page.pointee.start_address, textAddress + UInt64(pageSize))
+        disasm_pages_release(cache, page)
+        
+        // Page 0 ends past the boundary, which drops page 1
+        page = try XCTUnwrap(disasm_pages_acquire(cache, 0))
+        XCTAssertEqual(page.pointee.end_address, textAddress + UInt64(pageSize + 6))
+        disasm_pages_release(cache, page)
+        XCTAssertEqual(residentPages(cache), [0])
+        
+        page = try XCTUnwrap(disasm_pages_acquire(cache, 1))
+        XCTAssertEqual(page.pointee.start_address, textAddress + UInt64(pageSize + 6))
+        disasm_pages_release(cache, page)
+        
+        var inst = DisassembledInstruction()
+        XCTAssertFalse(disasm_pages_get(cache, textAddress + UInt64(pageSize), &inst))
+        XCTAssertTrue(disasm_pages_get(cache, textAddress + UInt64(pageSize + 6), &inst))
+    }
+    
+    func testPinnedX86PageKeepsRowsUntilReleased() throws {
+        let cache = try pages(x86_64Image(), maxPages: 4)
+        defer { disasm_pages_free(cache) }
+        
+        let stale = try XCTUnwrap(disasm_pages_acquire(cache, 1))
+        touch(cache, 0)
+        
+        // Still pinned, so the old rows stay valid and page 1 is not resident
+        XCTAssertEqual(stale.pointee.start_address, textAddress + UInt64(pageSize))
+        XCTAssertEqual(disasm_address_at(stale.pointee.disasm, 0), textAddress + UInt64(pageSize))
+        XCTAssertEqual(disasm_pages_resident(cache), 1)
+        disasm_pages_release(cache, stale)
+        
+        let page = try XCTUnwrap(disasm_pages_acquire(cache, 1))
+        XCTAssertEqual(page.pointee.start_address, textAddress + UInt64(pageSize + 6))
+        disasm_pages_release(cache, page)
+    }
+    
+    func testCallsIntoStubsAreNamed() throws {
+        // BL _puts; RET, and CALL _puts; RET, with the stub right after __text
+        let images = [
+            MachOTestImage(code: [0x02, 0x00, 0x00, 0x94, 0xC0, 0x03, 0x5F, 0xD6], stubs: ["_puts"]),
+            MachOTestImage(cputype: MachOTestImage.cpuTypeX86_64, code: [0xE8, 0x03, 0x00, 0x00, 0x00, 0xC3],
+                           stubs: ["_puts"])
+        ]
+        
+        for image in images {
+            let cache = try pages(image, maxPages: 2)
+            defer { disasm_pages_free(cache) }
+            
+            let page = try XCTUnwrap(disasm_pages_acquire(cache, 0))
+            defer { disasm_pages_release(cache, page) }
+            
+            var inst = DisassembledInstruction()
+            XCTAssertTrue(disasm_get(page.pointee.disasm, 0, &inst))
+            XCTAssertEqual(inst.branch_target, textAddress + 8)
+            let comment = withUnsafeBytes(of: inst.comment) { String(cString: $0.bindMemory(to: CChar.self).baseAddress!) }
+            XCTAssertEqual(comment, "_puts")
+            
+            // The stub itself is decoded as a function of its own
+            let stubRow = disasm_find_by_address(page.pointee.disasm, textAddress + 8)
+            XCTAssertGreaterThan(stubRow, 0)
+            XCTAssertTrue(disasm_get(page.pointee.disasm, UInt32(max(stubRow, 0)), &inst))
+            XCTAssertTrue(inst.is_function_start)
+        }
+    }
+}
@@ -0,0 +1,90 @@
+import XCTest
+@testable import ReDyne
+
+class FunctionDiscoveryTests: XCTestCase {
+    
+    private static let text = MachOTestImage.baseAddress + UInt64(MachOTestImage.textOffset)
+    
+    // main (a function start and a symbol): BL callee; BL _puts; RET; NOP
+    // +0x10 (a function start only): MOV X1, X0; RET; NOP; NOP
+    // +0x20 helper (a symbol only): MOV X0, #0; RET; NOP; NOP
+    // +0x30 (only ever called): ADD X0, X0, #1; RET
+    // +0x38 the _puts stub in __stubs
+    private static let code: [UInt32] = [
+        0x9400000C, 0x9400000D, 0xD65F03C0, 0xD503201F,
+        0xAA0003E1, 0xD65F03C0, 0xD503201F, 0xD503201F,
+        0xD2800000, 0xD65F03C0, 0xD503201F, 0xD503201F,
+        0x91000400, 0xD65F03C0
+    ]
+    
+    private var imageURL: URL!
+    private var session: OpaquePointer!
+    
+    override func setUpWithError() throws {
+        let text = FunctionDiscoveryTests.text
+        let image = MachOTestImage(
+            code: FunctionDiscoveryTests.code.flatMap { word in
+                (0..<4).map { UInt8(truncatingIfNeeded: word >> ($0 * 8)) }
+            },
+            symbols: [("_main", text), ("_helper", text + 0x20)],
+            functionStarts: [text, text + 0x10],
+            stubs: ["_puts"])
+        imageURL = try image.write()
+        
+        var errorBuffer = [CChar](repeating: 0, count: 256)
+        session = session_open(imageURL.path, nil, &errorBuffer)
+        XCTAssertNotNil(session, String(cString: errorBuffer))
+    }
+    
+    override func tearDownWithError() throws {
+        if session != nil {
+            session_release(session)
+        }
+        try? FileManager.default.removeItem(at: imageURL)
+    }
+    
+    private func functions() throws -> [DiscoveredFunction] {
+        let list = try XCTUnwrap(session_functions(session))
+        return Array(UnsafeBufferPointer(start: list.pointee.functions, count: Int(list.pointee.count)))
+    }
+    
+    func testEachStartKeepsItsSource() throws {
+        let text = FunctionDiscoveryTests.text
+        let expected: [(start: UInt64, end: UInt64, source: FunctionSource, name: String?)] = [
+            (text, text + 0x0C, FUNCTION_SOURCE_START, "_main"),
+            (text + 0x10, text + 0x18, FUNCTION_SOURCE_START, nil),
+            (text + 0x20, text + 0x28, FUNCTION_SOURCE_SYMBOL, "_helper"),
+            (text + 0x30, text + 0x38, FUNCTION_SOURCE_CALL, nil),
+            (text + 0x38, text + 0x44, FUNCTION_SOURCE_STUB, "_puts")
+        ]
+        
+        let found = try functions()
+        XCTAssertEqual(found.count, expected.count)
+        for (function, expected) in zip(found, expected) {
+            let start = String(format: "0x%llx", expected.start)
+            XCTAssertEqual(function.start_address, expected.start)
+            XCTAssertEqual(function.end_address, expected.end, start)
+            XCTAssertEqual(UInt32(function.source), expected.source.rawValue, start)
+            XCTAssertEqual(function.name.map { String(cString: $0) }, expected.name, start)
+        }
+    }
+    
+    func testRangesDoNotOverlap() throws {
+        let found = try functions()
+        XCTAssertFalse(found.isEmpty)
+        
+        for function in found {
+            XCTAssertLessThan(function.start_address, function.end_address)
+        }
+        for (previous, next) in zip(found, found.dropFirst()) {
+            XCTAssertLessThanOrEqual(previous.end_address, next.start_address)
+        }
+        
+        // The NOPs after each RET are never reached, so no function holds them
+        let list = try XCTUnwrap(session_functions(session))
+        XCTAssertEqual(function_list_find(list, FunctionDiscoveryTests.text + 0x34)?.pointee.start_address,
+                       FunctionDiscoveryTests.text + 0x30)
+        XCTAssertNil(function_list_find(list, FunctionDiscoveryTests.text + 0x0C))
+        XCTAssertNil(function_list_find(list, FunctionDiscoveryTests.text + 0x28))
+    }
+}
@@ -27,11 +27,118 @@ class MachOParserTests: XCTestCase {
         try? FileManager.default.removeItem(at: tempURL)
     }
     
+    func testOpenSessionKeepsErrorCodes() throws {
+        let directory = FileManager.default.temporaryDirectory
+        let missingURL = directory.appendingPathComponent("ReDyneTests-\(UUID().uuidString).missing")
+        let textURL = directory.appendingPathComponent("ReDyneTests-\(UUID().uuidString).txt")
+        try "Invalid content".write(to: textURL, atomically: true, encoding: .utf8)
+        // A valid magic with the rest of the header cut off
+        let truncatedURL = try MachOTestImage.write(Array(MachOTestImage().bytes.prefix(8)))
+        defer {
+            [textURL, truncatedURL].forEach { try? FileManager.default.removeItem(at: $0) }
+        }
+        
+        var errors: [NSError] = []
+        for url in [missingURL, textURL, truncatedURL] {
+            XCTAssertThrowsError(try BinaryParserService.openSession(atPath: url.path, slice: nil, progressBlock: nil)) {
+                errors.append($0 as NSError)
+            }
+        }
+        XCTAssertEqual(errors.map { $0.code }, [1001, 1001, 1002])
+        guard errors.count == 3 else { return }
+        
+        // Converted the way parser errors always were
+        guard case .invalidFile = ErrorHandler.convert(errors[0]) else { return XCTFail("missing file") }
+        guard case .invalidMachO = ErrorHandler.convert(errors[1]) else { return XCTFail("text file") }
+        guard case .invalidMachO = ErrorHandler.convert(errors[2]) else { return XCTFail("truncated header") }
+    }
+    
     func testFileSize() throws {
-        let size: Int64 = 250 * 1024 * 1024
-        let limit = Constants.File.maxFileSize
+        // Padded with a hole past the old 200 MB limit and the large-file threshold;
+        // the file system only stores the image itself
+        let url = try MachOTestImage().write()
+        defer { try? FileManager.default.removeItem(at: url) }
+        let size: UInt64 = 300 * 1024 * 1024
+        let handle = try FileHandle(forWritingTo: url)
+        try handle.truncate(atOffset: size)
+        try handle.close()
+        
+        var errorBuffer = [CChar](repeating: 0, count: 256)
+        let session = try XCTUnwrap(session_open(url.path, nil, &errorBuffer), String(cString: errorBuffer))
+        defer { session_release(session) }
+        XCTAssertEqual(session_macho_context(session)?.pointee.file_size, Int(size))
+        
+        let disassembly = try XCTUnwrap(session_disassembly(session))
+        XCTAssertEqual(disassembly.pointee.instruction_count, UInt32(MachOTestImage.code.count))
+    }
+    
+    func testCPUTypeNames() throws {
+        // The ABI64 bit tells x86_64 from i386 and arm64 from arm
+        XCTAssertEqual(String(cString: macho_cpu_type_string(0x01000007)), "x86_64")
+        XCTAssertEqual(String(cString: macho_cpu_type_string(0x0100000C)), "ARM64")
+        XCTAssertEqual(String(cString: macho_cpu_type_string(0x0200000C)), "ARM64_32")
+        XCTAssertEqual(String(cString: macho_cpu_type_string(7)), "i386")
+        XCTAssertEqual(String(cString: macho_cpu_type_string(12)), "ARM")
+    }
+    
+    func testFatSlices() throws {
+        // PUSH RBP; MOV RBP, RSP; POP RBP; RET
+        let images = [
+            MachOTestImage(),
+            MachOTestImage(cputype: MachOTestImage.cpuTypeX86_64, code: [0x55, 0x48, 0x89, 0xE5, 0x5D, 0xC3])
+        ]
+        let url = try MachOTestImage.write(MachOTestImage.fat(images))
+        defer { try? FileManager.default.removeItem(at: url) }
+        
+        var errorBuffer = [CChar](repeating: 0, count: 256)
+        let ctx = try XCTUnwrap(macho_open(url.path, &errorBuffer), String(cString: errorBuffer))
+        defer { macho_close(ctx) }
+        XCTAssertTrue(macho_is_fat_binary(ctx))
+        
+        var slicesPointer: UnsafeMutablePointer<FatSliceInfo>?
+        let count = macho_enumerate_slices(ctx, &slicesPointer)
+        defer { free(slicesPointer) }
+        let slices = Array(UnsafeBufferPointer(start: slicesPointer, count: Int(count)))
+        
+        // The second slice is pushed to the next 16 KB boundary after the first
+        XCTAssertEqual(slices.map { $0.cputype }, [MachOTestImage.cpuTypeARM64, MachOTestImage.cpuTypeX86_64])
+        XCTAssertEqual(slices.map { $0.offset }, [0x4000, 0x10000])
+        XCTAssertEqual(slices.map { $0.size }, images.map { UInt64($0.bytes.count) })
+        XCTAssertEqual(slices.map { $0.align }, [14, 14])
+        
+        // Each slice opens as its own architecture
+        for var slice in slices {
+            let session = try XCTUnwrap(session_open(url.path, &slice, &errorBuffer), String(cString: errorBuffer))
+            XCTAssertEqual(session_macho_context(session)?.pointee.header.cputype, slice.cputype)
+            session_release(session)
+        }
+    }
+    
+    func testQuickInfoBatchKeepsPathOrder() throws {
+        let image = MachOTestImage()
+        let fatURL = try MachOTestImage.write(MachOTestImage.fat([image, image]))
+        let thinURL = try image.write()
+        let textURL = FileManager.default.temporaryDirectory.appendingPathComponent("ReDyneTests-\(UUID().uuidString).txt")
+        try "Invalid content".write(to: textURL, atomically: true, encoding: .utf8)
+        defer {
+            [fatURL, thinURL, textURL].forEach { try? FileManager.default.removeItem(at: $0) }
+        }
+        
+        let infos = BinaryParserService.quickInfoForFiles(atPaths: [fatURL.path, textURL.path, thinURL.path])
+        XCTAssertEqual(infos.count, 3)
+        guard infos.count == 3 else { return }
+        
+        // The file that is not Mach-O keeps its place as NSNull
+        XCTAssertTrue(infos[1] is NSNull)
+        
+        let fat = try XCTUnwrap(infos[0] as? [String: Any])
+        XCTAssertEqual(fat["isFat"] as? Bool, true)
+        XCTAssertEqual((fat["slices"] as? [[String: Any]])?.count, 2)
         
-        XCTAssertGreaterThan(size, limit, "Test file size should exceed limit")
+        let thin = try XCTUnwrap(infos[2] as? [String: Any])
+        XCTAssertEqual(thin["isFat"] as? Bool, false)
+        XCTAssertEqual(thin["cpuType"] as? String, "ARM64")
+        XCTAssertEqual(thin["fileSize"] as? UInt64, UInt64(image.bytes.count))
     }
     
     func testErrorHandling() throws {
@@ -0,0 +1,309 @@
+import Foundation
+
+// A small arm64 executable built byte by byte, so the parsers can be tested
+// without fixture binaries. __text holds two functions, __cstring two strings
+// and __DATA one fixup chain: a rebase to __text followed by a bind to _bar.
+// Load commands: three segments, LC_SYMTAB, LC_DYLD_CHAINED_FIXUPS, LC_UUID.
+// Other code, for arm64 or x86_64, can replace the two functions; __TEXT then
+// grows to hold it and the later segments move up. Symbol stubs (with
+// LC_DYSYMTAB) and LC_FUNCTION_STARTS are added only when asked for, and
+// images can be combined into a universal binary with fat().
+struct MachOTestImage {
+    
+    static let baseAddress: UInt64 = 0x100000000
+    static let textOffset = 0x1000
+    static let cpuTypeARM64: UInt32 = 0x0100000C
+    static let cpuTypeX86_64: UInt32 = 0x01000007
+    
+    // SUB SP, SP, #0x10; STR X0, [SP, #16]; BL helper; RET; helper: MOV X1, X0; RET
+    static let code: [UInt32] = [0xD10043FF, 0xF9000BE0, 0x94000002, 0xD65F03C0, 0xAA0003E1, 0xD65F03C0]
+    static let cstrings = ["hello world", "cache test"]
+    static let symbols: [(name: String, address: UInt64)] = [("_main", 0x100001000), ("_helper", 0x100001010)]
+    static let imports: [(name: String, library: UInt32)] = [("_foo", 1), ("_bar", 2)]
+    
+    // The chain's two slots in __data of the default image, as slice-relative
+    // file offsets
+    static let rebaseSlot: UInt64 = 0x4010
+    static let bindSlot: UInt64 = 0x4018
+    static let rebaseTarget: UInt64 = 0x100001000
+    
+    let cputype: UInt32
+    let dataOffset: Int
+    let linkeditOffset: Int
+    
+    private(set) var bytes: [UInt8]
+    private var commandEnd = 32
+    private var commandCount: UInt32 = 0
+    
+    // code replaces the two default functions in __text. Each name in stubs
+    // gets a stub in __stubs, right after __text, bound to an undefined
+    // symbol of that name.
+    init(cputype: UInt32 = MachOTestImage.cpuTypeARM64, code: [UInt8]? = nil,
+         symbols: [(name: String, address: UInt64)] = MachOTestImage.symbols,
+         functionStarts: [UInt64] = [], stubs: [String] = []) {
+        let text = code ?? MachOTestImage.code.flatMap { word in
+            (0..<4).map { UInt8(truncatingIfNeeded: word >> ($0 * 8)) }
+        }
+        let stubSize = cputype == MachOTestImage.cpuTypeX86_64 ? 6 : 12
+        let stubsOffset = (MachOTestImage.textOffset + text.count + 3) & ~3
+        let textEnd = stubs.isEmpty ? MachOTestImage.textOffset + text.count : stubsOffset + stubs.count * stubSize
+        let cstringData = MachOTestImage.cstrings.flatMap { Array($0.utf8) + [0] }
+        let cstringOffset = max(0x2000, (textEnd + 15) & ~15)
+        
+        self.cputype = cputype
+        dataOffset = (cstringOffset + cstringData.count + 0x3FFF) & ~0x3FFF
+        linkeditOffset = dataOffset + 0x4000
+        bytes = [UInt8](repeating: 0, count: linkeditOffset + 0x1000)
+        
+        var textSections: [(name: String, offset: Int, size: Int, flags: UInt32, stubSize: UInt32)] = [
+            ("__text", MachOTestImage.textOffset, text.count, 0x80000400, 0)
+        ]
+        if !stubs.isEmpty {
+            textSections.append(("__stubs", stubsOffset, stubs.count * stubSize, 0x80000408, UInt32(stubSize)))
+        }
+        textSections.append(("__cstring", cstringOffset, cstringData.count, 0x2, 0))
+        segment("__TEXT", offset: 0, size: dataOffset, protection: 5, sections: textSections)
+        segment("__DATA", offset: dataOffset, size: 0x4000, protection: 3, sections: [
+            ("__data", dataOffset, 0x40, 0, 0)
+        ])
+        segment("__LINKEDIT", offset: linkeditOffset, size: 0x1000, protection: 1, sections: [])
+        
+        let fixupsSize = chainedFixups(at: linkeditOffset)
+        symbolTable(symbols, imports: stubs, at: linkeditOffset + 0x100, strings: linkeditOffset + 0x200)
+        if !stubs.isEmpty {
+            symbolStubs(at: stubsOffset, size: stubSize, firstSymbol: symbols.count, count: stubs.count,
+                        indirectSymbols: linkeditOffset + 0x380)
+        }
+        if !functionStarts.isEmpty {
+            self.functionStarts(functionStarts, at: linkeditOffset + 0x300)
+        }
+        
+        // LC_DYLD_CHAINED_FIXUPS
+        let fixups = command(0x80000034, size: 16)
+        put(UInt32(linkeditOffset), at: fixups + 8)
+        put(UInt32(fixupsSize), at: fixups + 12)
+        
+        // LC_UUID
+        let uuid = command(0x1B, size: 24)
+        for i in 0..<16 { bytes[uuid + 8 + i] = UInt8(i) }
+        
+        // mach_header_64 of an MH_EXECUTE; x86_64 needs CPU_SUBTYPE_X86_64_ALL
+        put(UInt32(0xFEEDFACF), at: 0)
+        put(cputype, at: 4)
+        put(UInt32(cputype == MachOTestImage.cpuTypeX86_64 ? 3 : 0), at: 8)
+        put(UInt32(2), at: 12)
+        put(commandCount, at: 16)
+        put(UInt32(commandEnd - 32), at: 20)
+        
+        bytes.replaceSubrange(MachOTestImage.textOffset..<MachOTestImage.textOffset + text.count, with: text)
+        bytes.replaceSubrange(cstringOffset..<cstringOffset + cstringData.count, with: cstringData)
+    }
+    
+    // Writes the image to a new temporary file, since binaries are opened by path
+    func write() throws -> URL {
+        return try MachOTestImage.write(bytes)
+    }
+    
+    static func write(_ bytes: [UInt8]) throws -> URL {
+        let url = FileManager.default.temporaryDirectory
+            .appendingPathComponent("ReDyneTests-\(UUID().uuidString)")
+            .appendingPathExtension("macho")
+        try Data(bytes).write(to: url)
+        return url
+    }
+    
+    // A universal binary holding the images in order, each slice starting on
+    // a 2^align boundary after the fat header
+    static func fat(_ images: [MachOTestImage], align: UInt32 = 14) -> [UInt8] {
+        let alignment = 1 << Int(align)
+        var offsets: [Int] = []
+        var end = alignment
+        for image in images {
+            offsets.append(end)
+            end = (end + image.bytes.count + alignment - 1) & ~(alignment - 1)
+        }
+        
+        var bytes = [UInt8](repeating: 0, count: (offsets.last ?? 0) + (images.last?.bytes.count ?? alignment))
+        
+        // fat_header and fat_arch are big-endian
+        func put(_ value: UInt32, at offset: Int) {
+            withUnsafeBytes(of: value.bigEndian) { raw in
+                bytes.replaceSubrange(offset..<offset + 4, with: raw)
+            }
+        }
+        put(0xCAFEBABE, at: 0)
+        put(UInt32(images.count), at: 4)
+        
+        for (index, image) in images.enumerated() {
+            let arch = 8 + index * 20
+            put(image.cputype, at: arch)
+            put(image.cputype == cpuTypeX86_64 ? 3 : 0, at: arch + 4)
+            put(UInt32(offsets[index]), at: arch + 8)
+            put(UInt32(image.bytes.count), at: arch + 12)
+            put(align, at: arch + 16)
+            bytes.replaceSubrange(offsets[index]..<offsets[index] + image.bytes.count, with: image.bytes)
+        }
+        return bytes
+    }
+    
+    // MARK: - Byte Writers
+    
+    private mutating func put<T: FixedWidthInteger>(_ value: T, at offset: Int) {
+        withUnsafeBytes(of: value.littleEndian) { raw in
+            bytes.replaceSubrange(offset..<offset + raw.count, with: raw)
+        }
+    }
+    
+    // Fixed-width name field, NUL padded
+    private mutating func put(_ name: String, at offset: Int) {
+        let utf8 = Array(name.utf8)
+        bytes.replaceSubrange(offset..<offset + utf8.count, with: utf8)
+    }
+    
+    // Appends a load command header; returns its offset for the body
+    private mutating func command(_ cmd: UInt32, size: Int) -> Int {
+        let start = commandEnd
+        put(cmd, at: start)
+        put(UInt32(size), at: start + 4)
+        commandEnd += size
+        commandCount += 1
+        return start
+    }
+    
+    // MARK: - Load Commands
+    
+    // LC_SEGMENT_64 whose VM layout mirrors the file from baseAddress
+    private mutating func segment(_ name: String, offset: Int, size: Int, protection: UInt32,
+                                  sections: [(name: String, offset: Int, size: Int, flags: UInt32, stubSize: UInt32)]) {
+        let start = command(0x19, size: 72 + 80 * sections.count)
+        put(name, at: start + 8)
+        put(MachOTestImage.baseAddress + UInt64(offset), at: start + 24)
+        put(UInt64(size), at: start + 32)
+        put(UInt64(offset), at: start + 40)
+        put(UInt64(size), at: start + 48)
+        put(protection, at: start + 56)
+        put(protection, at: start + 60)
+        put(UInt32(sections.count), at: start + 64)
+        
+        for (index, section) in sections.enumerated() {
+            let header = start + 72 + index * 80
+            put(section.name, at: header)
+            put(name, at: header + 16)
+            put(MachOTestImage.baseAddress + UInt64(section.offset), at: header + 32)
+            put(UInt64(section.size), at: header + 40)
+            put(UInt32(section.offset), at: header + 48)
+            put(UInt32(2), at: header + 52)
+            put(section.flags, at: header + 64)
+            put(section.stubSize, at: header + 72)
+        }
+    }
+    
+    // LC_SYMTAB with an nlist_64 per symbol, external and defined in section
+    // 1, followed by an undefined external one per import
+    private mutating func symbolTable(_ symbols: [(name: String, address: UInt64)], imports: [String],
+                                      at table: Int, strings: Int) {
+        let entries = symbols.map { ($0.name, $0.address, UInt8(0x0F), UInt8(1)) }
+            + imports.map { ($0, UInt64(0), UInt8(0x01), UInt8(0)) }
+        var names: [UInt8] = [0]
+        for (index, (name, address, type, section)) in entries.enumerated() {
+            let entry = table + index * 16
+            put(UInt32(names.count), at: entry)
+            bytes[entry + 4] = type
+            bytes[entry + 5] = section
+            put(address, at: entry + 8)
+            names += Array(name.utf8) + [0]
+        }
+        bytes.replaceSubrange(strings..<strings + names.count, with: names)
+        
+        let start = command(0x2, size: 24)
+        put(UInt32(table), at: start + 8)
+        put(UInt32(entries.count), at: start + 12)
+        put(UInt32(strings), at: start + 16)
+        put(UInt32(names.count), at: start + 20)
+    }
+    
+    // LC_DYSYMTAB whose indirect symbol table maps each stub, in order, to
+    // the symbols from firstSymbol on, and the stubs themselves: ADRP, LDR, BR
+    // on arm64 and JMP [rip] on x86_64
+    private mutating func symbolStubs(at offset: Int, size: Int, firstSymbol: Int, count: Int,
+                                      indirectSymbols: Int) {
+        for index in 0..<count {
+            put(UInt32(firstSymbol + index), at: indirectSymbols + index * 4)
+            
+            let stub = offset + index * size
+            if cputype == MachOTestImage.cpuTypeX86_64 {
+                bytes.replaceSubrange(stub..<stub + 6, with: [0xFF, 0x25, 0, 0, 0, 0])
+            } else {
+                put(UInt32(0x90000010), at: stub)
+                put(UInt32(0xF9400210), at: stub + 4)
+                put(UInt32(0xD61F0200), at: stub + 8)
+            }
+        }
+        
+        let start = command(0xB, size: 80)
+        put(UInt32(indirectSymbols), at: start + 56)
+        put(UInt32(count), at: start + 60)
+    }
+    
+    // LC_FUNCTION_STARTS: ULEB128 deltas from the __TEXT address, 0 ended
+    private mutating func functionStarts(_ starts: [UInt64], at offset: Int) {
+        var encoded: [UInt8] = []
+        var previous = MachOTestImage.baseAddress
+        for address in starts {
+            var delta = address - previous
+            repeat {
+                let byte = UInt8(delta & 0x7F)
+                delta >>= 7
+                encoded.append(delta == 0 ? byte : byte | 0x80)
+            } while delta != 0
+            previous = address
+        }
+        encoded.append(0)
+        bytes.replaceSubrange(offset..<offset + encoded.count, with: encoded)
+        
+        let start = command(0x26, size: 16)
+        put(UInt32(offset), at: start + 8)
+        put(UInt32((encoded.count + 7) & ~7), at: start + 12)
+    }
+    
+    // The dyld_chained_fixups_header blob and the chain it describes, in
+    // DYLD_CHAINED_PTR_64_OFFSET with DYLD_CHAINED_IMPORT entries. Returns
+    // the blob's size.
+    private mutating func chainedFixups(at blob: Int) -> Int {
+        // Rebase to __text, next slot 8 bytes on; then a bind to import 1
+        put(UInt64(0x1000) | (2 << 51), at: dataOffset + 0x10)
+        put(UInt64(1) << 63 | 1, at: dataOffset + 0x18)
+        
+        // dyld_chained_starts_in_image: only __DATA has starts
+        let startsInImage = 28
+        put(UInt32(3), at: blob + startsInImage)
+        put(UInt32(16), at: blob + startsInImage + 8)
+        
+        // dyld_chained_starts_in_segment with one page starting at 0x10
+        let startsInSegment = startsInImage + 16
+        put(UInt32(24), at: blob + startsInSegment)
+        put(UInt16(0x4000), at: blob + startsInSegment + 4)
+        put(UInt16(6), at: blob + startsInSegment + 6)
+        put(UInt64(dataOffset), at: blob + startsInSegment + 8)
+        put(UInt16(1), at: blob + startsInSegment + 20)
+        put(UInt16(0x10), at: blob + startsInSegment + 22)
+        
+        // dyld_chained_import entries naming offsets into the symbol pool
+        let importsOffset = startsInSegment + 24
+        let symbolsOffset = importsOffset + 4 * MachOTestImage.imports.count
+        var pool: [UInt8] = [0]
+        for (index, entry) in MachOTestImage.imports.enumerated() {
+            put(entry.library | UInt32(pool.count) << 9, at: blob + importsOffset + index * 4)
+            pool += Array(entry.name.utf8) + [0]
+        }
+        bytes.replaceSubrange(blob + symbolsOffset..<blob + symbolsOffset + pool.count, with: pool)
+        
+        put(UInt32(startsInImage), at: blob + 4)
+        put(UInt32(importsOffset), at: blob + 8)
+        put(UInt32(symbolsOffset), at: blob + 12)
+        put(UInt32(MachOTestImage.imports.count), at: blob + 16)
+        put(UInt32(1), at: blob + 20)
+        
+        return symbolsOffset + pool.count
+    }
+}
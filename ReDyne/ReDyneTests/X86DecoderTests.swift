@@ -0,0 +1,214 @@
+import XCTest
+@testable import ReDyne
+
+class X86DecoderTests: XCTestCase {
+    
+    private let address: UInt64 = 0x100001000
+    
+    private func decode(_ bytes: [UInt8], available: Int? = nil) -> X86DecodedInstruction {
+        var decoded = X86DecodedInstruction()
+        _ = x86_64_decode(bytes, available ?? bytes.count, &decoded)
+        return decoded
+    }
+    
+    // Text of one instruction as the disassembly view shows it
+    private func text(_ decoded: X86DecodedInstruction) -> String {
+        var decoded = decoded
+        var mnemonic = [CChar](repeating: 0, count: 64)
+        var operands = [CChar](repeating: 0, count: 128)
+        _ = x86_64_format_mnemonic(&decoded, &mnemonic, mnemonic.count)
+        _ = x86_64_format_operands(&decoded, address, &operands, operands.count)
+        
+        let operandText = String(cString: operands)
+        return operandText.isEmpty ? String(cString: mnemonic) : "\(String(cString: mnemonic)) \(operandText)"
+    }
+    
+    private func operands(_ decoded: X86DecodedInstruction) -> [X86DecodedOperand] {
+        return withUnsafeBytes(of: decoded.operands) { raw in
+            Array(raw.bindMemory(to: X86DecodedOperand.self).prefix(Int(decoded.operand_count)))
+        }
+    }
+    
+    // Each case is decoded with exactly its own bytes available, and the
+    // length-only decoder must agree
+    private func assertDecodes(_ cases: [([UInt8], Int, String)], file: StaticString = #filePath, line: UInt = #line) {
+        for (bytes, length, expected) in cases {
+            let hex = bytes.map { String(format: "%02X", $0) }.joined(separator: " ")
+            let decoded = decode(bytes)
+            XCTAssertEqual(Int(decoded.length), length, hex, file: file, line: line)
+            XCTAssertEqual(Int(x86_64_instruction_length(bytes, bytes.count)), length, hex, file: file, line: line)
+            XCTAssertEqual(text(decoded), expected, hex, file: file, line: line)
+        }
+    }
+    
+    func testLegacyAndREXPrefixes() throws {
+        assertDecodes([
+            ([0x48, 0x89, 0xE5], 3, "MOV rbp, rsp"),
+            ([0x66, 0x89, 0xC8], 3, "MOV ax, cx"),
+            ([0x41, 0x50], 2, "PUSH r8"),
+            ([0xF3, 0x48, 0xAB], 3, "REP STOSQ"),
+            ([0xF0, 0x48, 0x0F, 0xB1, 0x0A], 5, "LOCK CMPXCHG qword ptr [rdx], rcx"),
+            ([0x66, 0x2E, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00], 10, "NOP word ptr [rax+rax*1]"),
+        ])
+        
+        // Fourteen prefixes still fit the 15-byte limit; fifteen do not
+        let prefixes = [UInt8](repeating: 0x66, count: 14)
+        XCTAssertEqual(decode(prefixes + [0x90]).length, 15)
+        XCTAssertEqual(decode(prefixes + [0x66, 0x90]).mnemonic, UInt16(X86_MNEMONIC_BYTE.rawValue))
+    }
+    
+    func testSegmentOverride() throws {
+        // MOV rax, fs:[0x28]: SIB with no base and no index, disp32
+        let decoded = decode([0x64, 0x48, 0x8B, 0x04, 0x25, 0x28, 0x00, 0x00, 0x00])
+        XCTAssertEqual(decoded.length, 9)
+        XCTAssertEqual(text(decoded), "MOV rax, qword ptr fs:[0x28]")
+        
+        let memory = operands(decoded)[1]
+        XCTAssertEqual(Int(memory.kind), X86_OPND_MEM)
+        XCTAssertEqual(Int32(memory.reg), X86_REG_NONE)
+        XCTAssertEqual(Int32(memory.index), X86_REG_NONE)
+        XCTAssertEqual(memory.segment, 5, "1 + FS")
+        XCTAssertEqual(memory.imm, 0x28)
+    }
+    
+    func testVEX() throws {
+        let cases: [([UInt8], Int)] = [
+            ([0xC5, 0xF8, 0x77], 3),                                        // VZEROUPPER
+            ([0xC5, 0xFD, 0x6F, 0x07], 4),                                  // VMOVDQA ymm0, [rdi]
+            ([0xC4, 0xC1, 0x78, 0x28, 0xC0], 5),                            // VMOVAPS xmm0, xmm8
+            ([0xC4, 0xE2, 0x7D, 0x18, 0x05, 0x10, 0x00, 0x00, 0x00], 9),    // VBROADCASTSS ymm0, [rip+0x10]
+            ([0xC4, 0xE3, 0x79, 0x0F, 0xC1, 0x04], 6),                      // VPALIGNR xmm0, xmm0, xmm1, 4
+        ]
+        for (bytes, length) in cases {
+            let decoded = decode(bytes)
+            XCTAssertEqual(Int(decoded.length), length)
+            XCTAssertEqual(Int(x86_64_instruction_length(bytes, bytes.count)), length)
+            XCTAssertEqual(decoded.mnemonic, UInt16(X86_MNEMONIC_SIMD.rawValue))
+        }
+    }
+    
+    func testModRMAndSIBDisplacements() throws {
+        assertDecodes([
+            ([0x8B, 0x45, 0xFC], 3, "MOV eax, dword ptr [rbp-0x4]"),
+            ([0x8B, 0x04, 0x8F], 3, "MOV eax, dword ptr [rdi+rcx*4]"),
+            ([0x48, 0x8B, 0x44, 0x24, 0x08], 5, "MOV rax, qword ptr [rsp+0x8]"),
+            ([0x48, 0x8D, 0x44, 0xCB, 0xF8], 5, "LEA rax, [rbx+rcx*8-0x8]"),
+            ([0x48, 0x8B, 0x84, 0x24, 0x00, 0x01, 0x00, 0x00], 8, "MOV rax, qword ptr [rsp+0x100]"),
+        ])
+        
+        let memory = operands(decode([0x48, 0x8D, 0x44, 0xCB, 0xF8]))[1]
+        XCTAssertEqual(memory.reg, 3)
+        XCTAssertEqual(memory.index, 1)
+        XCTAssertEqual(memory.scale, 8)
+        XCTAssertEqual(memory.imm, -8)
+    }
+    
+    func testRIPRelativeOperands() throws {
+        assertDecodes([
+            ([0x48, 0x8B, 0x05, 0x78, 0x56, 0x34, 0x12], 7, "MOV rax, qword ptr [rip+0x12345678]"),
+            ([0x48, 0x8D, 0x0D, 0xF9, 0xFF, 0xFF, 0xFF], 7, "LEA rcx, [rip-0x7]"),
+            ([0xC7, 0x05, 0x10, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00], 10, "MOV dword ptr [rip+0x10], 0x1"),
+        ])
+        
+        // The displacement is kept from the start of the instruction, so the
+        // immediate that follows it is counted in
+        let load = operands(decode([0x48, 0x8B, 0x05, 0x78, 0x56, 0x34, 0x12]))[1]
+        XCTAssertEqual(UInt8(X86_REG_RIP), load.reg)
+        XCTAssertEqual(load.imm, 0x12345678 + 7)
+        
+        let store = operands(decode([0xC7, 0x05, 0x10, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00]))[0]
+        XCTAssertEqual(UInt8(X86_REG_RIP), store.reg)
+        XCTAssertEqual(store.imm, 0x10 + 10)
+        
+        XCTAssertEqual(operands(decode([0x48, 0x8D, 0x0D, 0xF9, 0xFF, 0xFF, 0xFF]))[1].imm, 0)
+    }
+    
+    func testImmediates() throws {
+        assertDecodes([
+            ([0x66, 0xB8, 0x34, 0x12], 4, "MOV ax, 0x1234"),
+            ([0x66, 0x05, 0x34, 0x12], 4, "ADD ax, 0x1234"),
+            ([0x66, 0xC7, 0x45, 0xF0, 0x34, 0x12], 6, "MOV word ptr [rbp-0x10], 0x1234"),
+            ([0x66, 0x68, 0x34, 0x12], 4, "PUSH 0x1234"),
+            ([0xC2, 0x08, 0x00], 3, "RET 0x8"),
+            ([0xC8, 0x10, 0x00, 0x01], 4, "ENTER 0x10, 0x1"),
+            ([0xB8, 0x78, 0x56, 0x34, 0x12], 5, "MOV eax, 0x12345678"),
+            ([0x48, 0x81, 0xEC, 0x00, 0x01, 0x00, 0x00], 7, "SUB rsp, 0x100"),
+            ([0x48, 0x83, 0xEC, 0x18], 4, "SUB rsp, 0x18"),
+            ([0x48, 0xC7, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF], 7, "MOV rax, -0x1"),
+            ([0x48, 0xB8, 0x88, 0x77, 0x66, 0x55, 0x44, 0x33, 0x22, 0x11], 10, "MOV rax, 0x1122334455667788"),
+        ])
+        
+        let imm16 = operands(decode([0x66, 0xB8, 0x34, 0x12]))[1]
+        XCTAssertEqual(Int(imm16.kind), X86_OPND_IMM)
+        XCTAssertEqual(imm16.size, 2)
+        XCTAssertEqual(imm16.imm, 0x1234)
+        
+        // Sign-extended for an 8-byte operation
+        XCTAssertEqual(operands(decode([0x48, 0xC7, 0xC0, 0xFF, 0xFF, 0xFF, 0xFF]))[1].imm, -1)
+    }
+    
+    func testShiftAndBitTestCounts() throws {
+        // The imm8 is a count, never sign-extended to the operand size
+        assertDecodes([
+            ([0x48, 0xC1, 0xFF, 0xFF], 4, "SAR rdi, 0xff"),
+            ([0xC1, 0xE0, 0xFF], 3, "SHL eax, 0xff"),
+            ([0x66, 0xC1, 0xE0, 0xFF], 4, "SHL ax, 0xff"),
+            ([0xC0, 0xC8, 0x81], 3, "ROR al, 0x81"),
+            ([0x48, 0x0F, 0xBA, 0xE0, 0xFF], 5, "BT rax, 0xff"),
+            ([0x0F, 0xBA, 0x28, 0x05], 4, "BTS dword ptr [rax], 0x5"),
+            ([0x48, 0x83, 0xC0, 0xFF], 4, "ADD rax, -0x1"),
+        ])
+        XCTAssertEqual(operands(decode([0x48, 0xC1, 0xFF, 0xFF]))[1].imm, 0xFF)
+        
+        // 0F 18 is named by its ModRM reg field too
+        assertDecodes([
+            ([0x0F, 0x18, 0x08], 3, "PREFETCH byte ptr [rax]"),
+            ([0x0F, 0x18, 0x20], 3, "NOP dword ptr [rax]"),
+        ])
+    }
+    
+    func testDirectCall() throws {
+        let decoded = decode([0xE8, 0x10, 0x00, 0x00, 0x00])
+        XCTAssertEqual(decoded.length, 5)
+        XCTAssertEqual(UInt32(decoded.branch_type), BRANCH_CALL.rawValue)
+        XCTAssertEqual(decoded.branch_delta, 0x15)
+        XCTAssertEqual(text(decoded), String(format: "CALL 0x%llx", address + 0x15))
+    }
+    
+    func testEscapeMaps() throws {
+        let cases: [([UInt8], Int)] = [
+            ([0x66, 0x0F, 0x38, 0x00, 0xC1], 5),                    // PSHUFB xmm0, xmm1
+            ([0x66, 0x0F, 0x38, 0x00, 0x44, 0x24, 0x10], 7),        // PSHUFB xmm0, [rsp+0x10]
+            ([0x0F, 0x38, 0xF0, 0x07], 4),                          // MOVBE eax, [rdi]
+            ([0x66, 0x0F, 0x3A, 0x0F, 0xC1, 0x08], 6),              // PALIGNR xmm0, xmm1, 8
+            ([0x66, 0x0F, 0x3A, 0x16, 0xC0, 0x01], 6),              // PEXTRD eax, xmm0, 1
+        ]
+        for (bytes, length) in cases {
+            let decoded = decode(bytes)
+            XCTAssertEqual(Int(decoded.length), length)
+            XCTAssertEqual(Int(x86_64_instruction_length(bytes, bytes.count)), length)
+            XCTAssertEqual(decoded.mnemonic, UInt16(X86_MNEMONIC_SIMD.rawValue))
+        }
+    }
+    
+    func testTruncatedInput() throws {
+        // Cut short by the end of the buffer: one byte, so a sweep still advances
+        let cases: [([UInt8], Int)] = [
+            ([0xE8, 0x00, 0x00, 0x00, 0x00], 3),
+            ([0x48, 0x8B, 0x84, 0x24, 0x00, 0x01, 0x00, 0x00], 6),
+            ([0x48, 0x89, 0xE5], 1),
+            ([0xC4, 0xE2, 0x7D, 0x18], 2),
+            ([0xC5, 0xF8, 0x77], 2),
+        ]
+        for (bytes, available) in cases {
+            let decoded = decode(bytes, available: available)
+            XCTAssertEqual(decoded.length, 1)
+            XCTAssertEqual(decoded.mnemonic, UInt16(X86_MNEMONIC_BYTE.rawValue))
+            XCTAssertEqual(x86_64_instruction_length(bytes, available), 1)
+        }
+        
+        // With every byte available the same instructions decode in full
+        XCTAssertEqual(decode([0xE8, 0x00, 0x00, 0x00, 0x00]).length, 5)
+        XCTAssertEqual(decode([0xC5, 0xF8, 0x77]).length, 3)
+    }
+}
@@ -0,0 +1,102 @@
+// Headless driver for the C analysis core. Walks directories or file lists of
+// Mach-O binaries and runs the full pipeline on each; see BUILD_GUIDE.md.
+
+#include "BatchAnalyzer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+static void print_usage(const char *argv0) {
+    fprintf(stderr,
+            "Usage: %s -o <output dir> [-j workers] [-m memory MB] [-c cache dir] [-v] <path|@list>...\n"
+            "  <path>   a binary or a directory searched recursively for Mach-O files\n"
+            "  @list    a text file with one path per line\n",
+            argv0);
+}
+
+static bool append_paths(char ***all, uint32_t *count, char **paths, uint32_t path_count) {
+    if (path_count == 0) return true;
+    
+    char **grown = (char**)realloc(*all, (*count + path_count) * sizeof(char*));
+    if (!grown) return false;
+    
+    memcpy(grown + *count, paths, path_count * sizeof(char*));
+    *all = grown;
+    *count += path_count;
+    free(paths);
+    return true;
+}
+
+static void add_input(const char *input, char ***all, uint32_t *count) {
+    char **paths = NULL;
+    uint32_t path_count = 0;
+    
+    if (input[0] != '@') {
+        path_count = batch_collect_paths(input, &paths);
+        if (!append_paths(all, count, paths, path_count)) batch_free_paths(paths, path_count);
+        return;
+    }
+    
+    FILE *list = fopen(input + 1, "r");
+    if (!list) {
+        fprintf(stderr, "Cannot open list %s\n", input + 1);
+        return;
+    }
+    
+    char line[4096];
+    while (fgets(line, sizeof(line), list)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') continue;
+        
+        path_count = batch_collect_paths(line, &paths);
+        if (!append_paths(all, count, paths, path_count)) batch_free_paths(paths, path_count);
+    }
+    
+    fclose(list);
+}
+
+int main(int argc, char **argv) {
+    BatchOptions options;
+    memset(&options, 0, sizeof(options));
+    
+    int opt;
+    while ((opt = getopt(argc, argv, "o:j:m:c:vh")) != -1) {
+        switch (opt) {
+            case 'o': options.output_dir = optarg; break;
+            case 'j': options.worker_count = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'm': options.memory_budget = strtoull(optarg, NULL, 10) * 1024 * 1024; break;
+            case 'c': options.cache_dir = optarg; break;
+            case 'v': options.verbose = true; break;
+            default:
+                print_usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    
+    if (!options.output_dir || optind >= argc) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    
+    // The stages log their progress to stdout, which is noise at this scale
+    if (!options.verbose) freopen("/dev/null", "w", stdout);
+    
+    char **paths = NULL;
+    uint32_t count = 0;
+    for (int i = optind; i < argc; i++) {
+        add_input(argv[i], &paths, &count);
+    }
+    
+    if (count == 0) {
+        fprintf(stderr, "No Mach-O files found\n");
+        return 1;
+    }
+    
+    BatchStats stats;
+    bool ok = batch_run((const char *const *)paths, count, &options, &stats);
+    batch_print_stats(&stats);
+    
+    batch_free_paths(paths, count);
+    return ok && stats.files_failed == 0 ? 0 : 1;
+}
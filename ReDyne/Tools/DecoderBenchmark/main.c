@@ -0,0 +1,220 @@
+// Decoder throughput benchmark. Times the structured decode, the text
+// rendering used for display, the full sweep into the instruction store and
+// the vectorized branch pre-scan over the __text section of an ARM64 binary,
+// or the length decoder, the structured decode, the rendering and the sweep
+// over an x86_64 one; see BUILD_GUIDE.md.
+
+#include "AnalysisSession.h"
+#include "DisassemblyEngine.h"
+#include "BranchScan.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef enum {
+    BENCH_LENGTH,
+    BENCH_DECODE,
+    BENCH_RENDER,
+    BENCH_SWEEP_SERIAL,
+    BENCH_SWEEP_PARALLEL,
+    BENCH_BRANCH_SCAN,
+    BENCH_COUNT
+} BenchKind;
+
+static const char *const bench_names[BENCH_COUNT] = {
+    "length decode",
+    "decode (structured)",
+    "decode + render text",
+    "sweep into store, 1 thread",
+    "sweep into store, parallel",
+    "branch pre-scan",
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void print_usage(const char *argv0) {
+    fprintf(stderr,
+            "Usage: %s [-n rounds] [-j threads] <binary>\n"
+            "  -n  timed rounds per benchmark, the best one is reported (default 5)\n"
+            "  -j  threads for the parallel sweep (default: one per core)\n",
+            argv0);
+}
+
+static uint32_t load_word(const DisassemblyContext *ctx, uint64_t offset, bool swapped) {
+    uint32_t bytes;
+    memcpy(&bytes, ctx->code_data + offset, sizeof(bytes));
+    return swapped ? swap_uint32(bytes) : bytes;
+}
+
+// Fixed-width code has no length to decode; variable-length code is neither
+// split across threads nor pre-scanned
+static bool bench_supported(BenchKind kind, Architecture arch) {
+    switch (kind) {
+        case BENCH_LENGTH:
+            return arch == ARCH_X86_64;
+        case BENCH_SWEEP_PARALLEL:
+        case BENCH_BRANCH_SCAN:
+            return arch == ARCH_ARM64;
+        default:
+            return true;
+    }
+}
+
+static uint64_t run_once_x86_64(DisassemblyContext *ctx, BenchKind kind) {
+    uint64_t checksum = 0;
+    uint64_t offset = 0;
+    
+    switch (kind) {
+        case BENCH_LENGTH:
+            while (offset < ctx->code_size) {
+                uint8_t length = x86_64_instruction_length(ctx->code_data + offset, ctx->code_size - offset);
+                offset += length ? length : 1;
+                checksum += length;
+            }
+            break;
+        case BENCH_DECODE: {
+            X86DecodedInstruction decoded;
+            while (offset < ctx->code_size) {
+                x86_64_decode(ctx->code_data + offset, ctx->code_size - offset, &decoded);
+                offset += decoded.length;
+                checksum += decoded.mnemonic + decoded.flags + (uint64_t)decoded.branch_delta + decoded.operand_count;
+            }
+            break;
+        }
+        case BENCH_RENDER: {
+            // disasm_x86_64() may read a whole instruction's worth of bytes
+            DisassembledInstruction inst;
+            while (offset + X86_MAX_INSTRUCTION_LENGTH <= ctx->code_size) {
+                disasm_x86_64(ctx->code_data + offset, ctx->code_base_addr + offset, &inst);
+                offset += inst.length;
+                checksum += (uint8_t)inst.operands[0] + inst.branch_target;
+            }
+            break;
+        }
+        case BENCH_SWEEP_SERIAL:
+            checksum = disasm_all(ctx);
+            break;
+        default:
+            break;
+    }
+    
+    return checksum;
+}
+
+// Returns a checksum of the results so the decode loops cannot be optimized out
+static uint64_t run_once(DisassemblyContext *ctx, BenchKind kind, uint32_t threads, bool swapped) {
+    if (ctx->arch == ARCH_X86_64) return run_once_x86_64(ctx, kind);
+    
+    uint64_t checksum = 0;
+    
+    switch (kind) {
+        case BENCH_DECODE: {
+            ARM64DecodedWord decoded;
+            for (uint64_t offset = 0; offset + 4 <= ctx->code_size; offset += 4) {
+                arm64_decode_word(load_word(ctx, offset, swapped), &decoded);
+                checksum += decoded.mnemonic + decoded.flags + (uint64_t)decoded.branch_delta + decoded.operand_count;
+            }
+            break;
+        }
+        case BENCH_RENDER: {
+            DisassembledInstruction inst;
+            for (uint64_t offset = 0; offset + 4 <= ctx->code_size; offset += 4) {
+                disasm_arm64(load_word(ctx, offset, swapped), ctx->code_base_addr + offset, &inst);
+                checksum += (uint8_t)inst.operands[0] + inst.branch_target;
+            }
+            break;
+        }
+        case BENCH_SWEEP_SERIAL:
+            checksum = disasm_all_parallel(ctx, 1);
+            break;
+        case BENCH_SWEEP_PARALLEL:
+            checksum = disasm_all_parallel(ctx, threads);
+            break;
+        case BENCH_BRANCH_SCAN: {
+            BranchScanResult branches;
+            if (branch_scan_arm64(ctx, &branches)) {
+                checksum = branches.count + (branches.count ? branches.targets[branches.count - 1] : 0);
+                branch_scan_free(&branches);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    
+    return checksum;
+}
+
+int main(int argc, char **argv) {
+    uint32_t rounds = 5;
+    uint32_t threads = 0;
+    
+    int opt;
+    while ((opt = getopt(argc, argv, "n:j:h")) != -1) {
+        switch (opt) {
+            case 'n': rounds = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'j': threads = (uint32_t)strtoul(optarg, NULL, 10); break;
+            default:
+                print_usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    
+    if (optind >= argc) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    if (rounds == 0) rounds = 1;
+    
+    char error_msg[256] = { 0 };
+    AnalysisSession *session = session_open(argv[optind], NULL, error_msg);
+    if (!session) {
+        fprintf(stderr, "%s: %s\n", argv[optind], error_msg[0] ? error_msg : "Failed to open file");
+        return 1;
+    }
+    
+    MachOContext *macho_ctx = session_macho_context(session);
+    DisassemblyContext *ctx = disasm_create(macho_ctx);
+    if (!ctx || (ctx->arch != ARCH_ARM64 && ctx->arch != ARCH_X86_64) || !disasm_load_section(ctx, "__text")) {
+        fprintf(stderr, "%s: no ARM64 or x86_64 __text section\n", argv[optind]);
+        disasm_free(ctx);
+        session_release(session);
+        return 1;
+    }
+    
+    bool swapped = macho_ctx->header.is_swapped;
+    uint64_t words = ctx->arch == ARCH_X86_64 ? disasm_all(ctx) : ctx->code_size / 4;
+    printf("%s: %llu %s instructions (%.1f MB of __text), best of %u rounds, %s branch scan\n",
+           argv[optind], (unsigned long long)words, ctx->arch == ARCH_X86_64 ? "x86_64" : "ARM64",
+           ctx->code_size / (1024.0 * 1024.0), rounds, branch_scan_implementation());
+    
+    for (uint32_t kind = 0; kind < BENCH_COUNT; kind++) {
+        if (!bench_supported((BenchKind)kind, ctx->arch)) continue;
+        
+        // One untimed round warms the page cache and the decode table
+        uint64_t checksum = run_once(ctx, (BenchKind)kind, threads, swapped);
+        double best = 0;
+        
+        for (uint32_t round = 0; round < rounds; round++) {
+            double start = now_seconds();
+            checksum += run_once(ctx, (BenchKind)kind, threads, swapped);
+            double elapsed = now_seconds() - start;
+            if (round == 0 || elapsed < best) best = elapsed;
+        }
+        
+        double per_second = best > 0 ? words / best : 0;
+        printf("  %-28s %8.2f M inst/s %8.1f ns/inst  (checksum %llx)\n",
+               bench_names[kind], per_second / 1e6, best * 1e9 / (words ? words : 1),
+               (unsigned long long)checksum);
+    }
+    
+    disasm_free(ctx);
+    session_release(session);
+    return 0;
+}